@@ -31,6 +31,7 @@ static s32 SYSEX_Cmd(u8 cmd_state, u8 midi_in);
 
 static s32 SYSEX_Cmd_InfoRequest(u8 cmd_state, u8 midi_in);
 static s32 SYSEX_Cmd_Ping(u8 cmd_state, u8 midi_in);
+static s32 SYSEX_Cmd_LedFrame(u8 cmd_state, u8 midi_in);
 
 
 /////////////////////////////////////////////////////////////////////////////
@@ -42,6 +43,9 @@ static u8 sysex_cmd;
 
 static mios32_midi_port_t sysex_port = DEFAULT;
 
+static u8 led_frame_record[5];
+static u8 led_frame_record_ix;
+
 
 /////////////////////////////////////////////////////////////////////////////
 // constant definitions
@@ -105,6 +109,9 @@ s32 SYSEX_SendLayoutInfo(mios32_midi_port_t port)
   // number of extra buttons (e.g. shift)
   sysex_buffer[sysex_buffer_ix++] = 1;
 
+  // feature flags: bit 0: LED frame command (0x02) supported
+  sysex_buffer[sysex_buffer_ix++] = 0x01;
+
   // footer
   sysex_buffer[sysex_buffer_ix++] = 0xf7;
 
@@ -232,6 +239,9 @@ s32 SYSEX_Cmd(u8 cmd_state, u8 midi_in)
     case 0x00:
       SYSEX_Cmd_InfoRequest(cmd_state, midi_in);
       break;
+    case 0x02:
+      SYSEX_Cmd_LedFrame(cmd_state, midi_in);
+      break;
     case 0x01: // Layout Info
     case 0x0e: // error
       // ignore to avoid feedback loops
@@ -304,3 +314,65 @@ s32 SYSEX_Cmd_Ping(u8 cmd_state, u8 midi_in)
 }
 
 
+/////////////////////////////////////////////////////////////////////////////
+// Command 02: LED Frame
+// Run-length encoded LED patterns, each record consists of 5 bytes:
+// <rotate*0x40 + colour*0x10 + first row> <number of rows - 1>
+// <pattern[6:0]> <pattern[13:7]> <pattern[15:14]>
+// colour: 0=green, 1=red, 2=green and red
+// The records are forwarded as optimized CC patterns to APP_MIDI_NotifyPackage()
+/////////////////////////////////////////////////////////////////////////////
+s32 SYSEX_Cmd_LedFrame(u8 cmd_state, u8 midi_in)
+{
+  switch( cmd_state ) {
+
+    case SYSEX_CMD_STATE_BEGIN:
+      led_frame_record_ix = 0;
+      break;
+
+    case SYSEX_CMD_STATE_CONT: {
+      led_frame_record[led_frame_record_ix++] = midi_in;
+      if( led_frame_record_ix < sizeof(led_frame_record) )
+	break;
+      led_frame_record_ix = 0;
+
+      u8 first_row = led_frame_record[0] & 0x0f;
+      u8 colour = (led_frame_record[0] >> 4) & 0x03;
+      u8 cc_offset = (led_frame_record[0] & 0x40) ? 0x08 : 0x00;
+      u8 num_rows = led_frame_record[1] + 1;
+      u16 pattern = led_frame_record[2] | ((u16)led_frame_record[3] << 7) | ((u16)led_frame_record[4] << 14);
+
+      mios32_midi_package_t p;
+      p.ALL = 0;
+      p.type = CC;
+      p.event = CC;
+
+      int row;
+      for(row=first_row; row<(first_row+num_rows) && row<16; ++row) {
+	p.chn = row;
+
+	int c;
+	for(c=0; c<2; ++c) {
+	  if( colour != 2 && colour != c )
+	    continue;
+
+	  u8 cc_base = 0x10 + 0x10*c + cc_offset;
+
+	  p.cc_number = cc_base + 0 + ((pattern & 0x0080) ? 1 : 0);
+	  p.value = pattern & 0x7f;
+	  APP_MIDI_NotifyPackage(sysex_port, p);
+
+	  p.cc_number = cc_base + 2 + ((pattern & 0x8000) ? 1 : 0);
+	  p.value = (pattern >> 8) & 0x7f;
+	  APP_MIDI_NotifyPackage(sysex_port, p);
+	}
+      }
+    } break;
+
+    default: // SYSEX_CMD_STATE_END
+      SYSEX_SendFooter(0);
+      break;
+  }
+
+  return 0; // no error
+}
@@ -149,6 +149,7 @@ s32 PRESETS_Init(u32 mode)
       kc->scan_release_velocity = (misc & (1 << 4)) ? 1 : 0;
       kc->make_debounced        = (misc & (1 << 5)) ? 1 : 0;
       kc->break_is_make         = (misc & (1 << 6)) ? 1 : 0;
+      kc->velocity_curve        = (misc >> 7) & 3;
 
       kc->delay_fastest                    = PRESETS_Read16(PRESETS_ADDR_KB1_DELAY_FASTEST + offset);
       kc->delay_slowest                    = PRESETS_Read16(PRESETS_ADDR_KB1_DELAY_SLOWEST + offset);
@@ -335,7 +336,8 @@ s32 PRESETS_StoreAll(void)
 	(kc->scan_optimized        << 3) |
         (kc->scan_release_velocity << 4) |
         (kc->make_debounced        << 5) |
-        (kc->break_is_make         << 6);
+        (kc->break_is_make         << 6) |
+        ((kc->velocity_curve & 3)  << 7);
       status |= PRESETS_Write16(PRESETS_ADDR_KB1_MISC + offset, misc);
 
       status |= PRESETS_Write16(PRESETS_ADDR_KB1_DELAY_FASTEST + offset, kc->delay_fastest);
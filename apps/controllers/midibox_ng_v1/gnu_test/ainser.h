@@ -0,0 +1,3 @@
+// AINSER definitions used by mbng_patch.h
+#define AINSER_NUM_MODULES 2
+#define AINSER_NUM_PINS    64
@@ -0,0 +1,93 @@
+// minimal MIOS32 environment to compile mbng_file_r.c on the host
+#ifndef _MIOS32_H
+#define _MIOS32_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+typedef uint8_t  u8;
+typedef uint16_t u16;
+typedef uint32_t u32;
+typedef uint64_t u64;
+typedef int8_t   s8;
+typedef int16_t  s16;
+typedef int32_t  s32;
+
+typedef enum {
+  DEFAULT = 0x00,
+  USB0 = 0x10,
+  UART0 = 0x20,
+  UART1 = 0x21,
+} mios32_midi_port_t;
+
+typedef enum {
+  Chn1, Chn2, Chn3, Chn4, Chn5, Chn6, Chn7, Chn8,
+  Chn9, Chn10, Chn11, Chn12, Chn13, Chn14, Chn15, Chn16
+} mios32_midi_chn_t;
+
+typedef enum {
+  NoteOff       = 0x8,
+  NoteOn        = 0x9,
+  PolyPressure  = 0xa,
+  CC            = 0xb,
+  ProgramChange = 0xc,
+  Aftertouch    = 0xd,
+  PitchBend     = 0xe
+} mios32_midi_event_t;
+
+typedef union {
+  u32 ALL;
+  struct {
+    u8 cin_cable;
+    u8 evnt0;
+    u8 evnt1;
+    u8 evnt2;
+  };
+  struct {
+    u8 type:4;
+    u8 cable:4;
+    u8 chn:4;
+    u8 event:4;
+    u8 value1;
+    u8 value2;
+  };
+  struct {
+    u8 cin:4;
+    u8 dummy1_cable:4;
+    u8 dummy1_chn:4;
+    u8 dummy1_event:4;
+    u8 note;
+    u8 velocity;
+  };
+  struct {
+    u8 dummy2_cin_cable;
+    u8 dummy2_chn:4;
+    u8 dummy2_event:4;
+    u8 cc_number;
+    u8 value;
+  };
+} mios32_midi_package_t;
+
+#define MIOS32_AIN_CHANNEL_MASK 0x3f
+
+// no FreeRTOS (see ../src/tasks.h), the script is executed from a single thread
+#define pvPortMalloc malloc
+#define vPortFree    free
+
+extern s32 MIOS32_MIDI_SendPackage(mios32_midi_port_t port, mios32_midi_package_t package);
+extern s32 MIOS32_MIDI_SendNoteOn(mios32_midi_port_t port, mios32_midi_chn_t chn, u8 note, u8 vel);
+extern s32 MIOS32_MIDI_SendNoteOff(mios32_midi_port_t port, mios32_midi_chn_t chn, u8 note, u8 vel);
+extern s32 MIOS32_MIDI_SendPolyPressure(mios32_midi_port_t port, mios32_midi_chn_t chn, u8 note, u8 val);
+extern s32 MIOS32_MIDI_SendCC(mios32_midi_port_t port, mios32_midi_chn_t chn, u8 cc, u8 val);
+extern s32 MIOS32_MIDI_SendProgramChange(mios32_midi_port_t port, mios32_midi_chn_t chn, u8 prg);
+extern s32 MIOS32_MIDI_SendAftertouch(mios32_midi_port_t port, mios32_midi_chn_t chn, u8 val);
+extern s32 MIOS32_MIDI_SendPitchBend(mios32_midi_port_t port, mios32_midi_chn_t chn, u16 val);
+extern s32 MIOS32_MIDI_SendDebugString(const char *str);
+extern s32 MIOS32_MIDI_SendDebugHexDump(const u8 *src, u32 len);
+extern s32 MIOS32_MIDI_SendDebugMessage(const char *format, ...);
+extern s32 MIOS32_STOPWATCH_Reset(void);
+extern u32 MIOS32_STOPWATCH_ValueGet(void);
+#define DEBUG_MSG MIOS32_MIDI_SendDebugMessage
+
+#endif /* _MIOS32_H */
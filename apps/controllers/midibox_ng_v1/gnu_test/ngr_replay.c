@@ -0,0 +1,654 @@
+// Host replay of .NGR run scripts
+//
+// mbng_file_r.c is compiled for the tokenized interpreter of the STM32F4,
+// the event pool, MIDI, LCD and file layers are replaced by the stubs below.
+// The pool contains 256 filler items plus all items which are referenced by
+// the script, so that the searches walk through a pool of realistic size.
+//
+// Each script of the ../cfg directory is loaded once, then a random stream of
+// ^section/^value run requests is played. Before each request, a random item
+// changes its value (as if received via MIDI), after the request the script
+// runs for 200 mS, so that DELAY_MS commands continue.
+//
+// All MIDI events, item changes, meta events, LCD and LOG outputs are added
+// to a checksum. The makefile builds this harness twice: with the folded
+// constants, item references and linked IF/ELSE jumps (NGR_OPTIMIZED=1) and
+// with the plain token interpreter (NGR_OPTIMIZED=0). "make test" checks that
+// both produce the same output, and both report the executed tokens, pool
+// searches and CPU time per request.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+#include <ctype.h>
+#include "mios32.h"
+#include "tasks.h"
+#include "file.h"
+#include "midi_port.h"
+#include "seq_bpm.h"
+#include "seq_midi_out.h"
+#include "mbng_event.h"
+#include "mbng_file_r.h"
+#include "mbng_patch.h"
+#include "mbng_lcd.h"
+
+#define NUM_REQUESTS   500
+#define TICKS_PER_REQ  200 // mS
+#define POOL_FILLER    256
+#define POOL_MAX       2048
+#define FILE_MAX_SIZE  65536
+
+#ifndef NGR_OPTIMIZED
+# define NGR_OPTIMIZED 1
+#endif
+
+static const char *scripts[] = {
+  "../cfg/tests/runscr1.ngr",
+  "../cfg/tests/runscr2.ngr",
+  "../cfg/tests/runscr3.ngr",
+  "../cfg/tests/runscr4.ngr",
+  "../cfg/tests/runscr5.ngr",
+  "../cfg/tests/runscr6.ngr",
+  "../cfg/tests/kb_6.ngr",
+  "../cfg/tests/multibnk.ngr",
+  "../cfg/tests/rgbled_2.ngr",
+  "../cfg/tests/seq1.ngr",
+  "../cfg/tests/seq2.ngr",
+  "../cfg/tests/seq3.ngr",
+  "../cfg/midiphy/fluxtest.ngr",
+};
+#define NUM_SCRIPTS (sizeof(scripts)/sizeof(scripts[0]))
+
+mbng_patch_cfg_t mbng_patch_cfg;
+
+static mbng_event_item_t pool[POOL_MAX];
+static u32 pool_num_items;
+static u16 pool_generation = 1;
+static u8 selected_bank = 1;
+
+static u32 checksum = 2166136261u; // FNV-1a
+static u32 bpm_tick;
+
+typedef struct {
+  u32 searches;
+  u32 search_steps;
+  u32 exec_tokens;
+  u32 errors;
+} stats_t;
+
+static stats_t stats;
+static u8 capture_token_ctr;
+static u32 last_exec_tokens;
+
+
+// ------- output checksum -------
+static void add_checksum(const void *data, u32 len)
+{
+  const u8 *p = data;
+  while( len-- )
+    checksum = (checksum ^ *p++) * 16777619u;
+}
+
+static void add_record(char type, u32 a, u32 b)
+{
+  add_checksum(&type, 1);
+  add_checksum(&a, 4);
+  add_checksum(&b, 4);
+}
+
+
+// ------- MIOS32 stubs -------
+s32 MIOS32_MIDI_SendPackage(mios32_midi_port_t port, mios32_midi_package_t package)
+{
+  add_record('P', port, package.ALL);
+  return 0;
+}
+
+static s32 send_event(mios32_midi_port_t port, u8 event, mios32_midi_chn_t chn, u8 evnt1, u8 evnt2)
+{
+  mios32_midi_package_t p;
+  p.ALL = 0;
+  p.type = p.event = event;
+  p.chn = chn;
+  p.evnt1 = evnt1;
+  p.evnt2 = evnt2;
+  return MIOS32_MIDI_SendPackage(port, p);
+}
+
+s32 MIOS32_MIDI_SendNoteOn(mios32_midi_port_t port, mios32_midi_chn_t chn, u8 note, u8 vel) { return send_event(port, NoteOn, chn, note, vel); }
+s32 MIOS32_MIDI_SendNoteOff(mios32_midi_port_t port, mios32_midi_chn_t chn, u8 note, u8 vel) { return send_event(port, NoteOff, chn, note, vel); }
+s32 MIOS32_MIDI_SendPolyPressure(mios32_midi_port_t port, mios32_midi_chn_t chn, u8 note, u8 val) { return send_event(port, PolyPressure, chn, note, val); }
+s32 MIOS32_MIDI_SendCC(mios32_midi_port_t port, mios32_midi_chn_t chn, u8 cc, u8 val) { return send_event(port, CC, chn, cc, val); }
+s32 MIOS32_MIDI_SendProgramChange(mios32_midi_port_t port, mios32_midi_chn_t chn, u8 prg) { return send_event(port, ProgramChange, chn, prg, 0); }
+s32 MIOS32_MIDI_SendAftertouch(mios32_midi_port_t port, mios32_midi_chn_t chn, u8 val) { return send_event(port, Aftertouch, chn, val, 0); }
+s32 MIOS32_MIDI_SendPitchBend(mios32_midi_port_t port, mios32_midi_chn_t chn, u16 val) { return send_event(port, PitchBend, chn, val & 0x7f, val >> 7); }
+
+s32 MIOS32_MIDI_SendDebugString(const char *str)
+{
+  add_checksum("LOG", 3);
+  add_checksum(str, strlen(str));
+  return 0;
+}
+
+s32 MIOS32_MIDI_SendDebugHexDump(const u8 *src, u32 len)
+{
+  return 0;
+}
+
+// error messages contain token memory positions, which differ between both
+// interpreters: they are only counted
+s32 MIOS32_MIDI_SendDebugMessage(const char *format, ...)
+{
+  char str[256];
+  va_list args;
+
+  va_start(args, format);
+  vsnprintf(str, sizeof(str), format, args);
+  va_end(args);
+
+  if( capture_token_ctr ) {
+    sscanf(str, "Executed tokens: %u", &last_exec_tokens);
+    return 0;
+  }
+
+  if( strstr(str, "ERROR") ) {
+    if( ++stats.errors <= 3 )
+      printf("%s\n", str);
+  }
+  return 0;
+}
+
+s32 MIOS32_STOPWATCH_Reset(void) { return 0; }
+u32 MIOS32_STOPWATCH_ValueGet(void) { return 0; }
+
+void TASKS_MIDIOUTSemaphoreTake(void) {}
+void TASKS_MIDIOUTSemaphoreGive(void) {}
+void TASKS_SDCardSemaphoreTake(void) {}
+void TASKS_SDCardSemaphoreGive(void) {}
+void TASKS_LCDSemaphoreTake(void) {}
+void TASKS_LCDSemaphoreGive(void) {}
+
+
+// ------- MIDI port, sequencer, LCD and patch stubs -------
+static const char *port_names[] = { "Default", "USB1", "OUT1", "OUT2" };
+static const mios32_midi_port_t port_values[] = { DEFAULT, USB0, UART0, UART1 };
+
+s32 MIDI_PORT_OutNumGet(void) { return 4; }
+char *MIDI_PORT_OutNameGet(u8 port_ix) { return (char *)port_names[port_ix & 3]; }
+mios32_midi_port_t MIDI_PORT_OutPortGet(u8 port_ix) { return port_values[port_ix & 3]; }
+
+s32 SEQ_BPM_IsRunning(void) { return 1; }
+u32 SEQ_BPM_TickGet(void) { return bpm_tick; }
+
+s32 SEQ_MIDI_OUT_Send(mios32_midi_port_t port, mios32_midi_package_t midi_package, seq_midi_out_event_type_t event_type, u32 timestamp, u32 len)
+{
+  add_record('Q', port, midi_package.ALL);
+  add_record('T', event_type, timestamp);
+  add_record('L', len, 0);
+  return 0;
+}
+
+s32 MBNG_LCD_PrintItemLabel(mbng_event_item_t *item, char *out_buffer, u32 max_buffer_len)
+{
+  add_checksum("LCD", 3);
+  if( item->label )
+    add_checksum(item->label, strlen(item->label));
+  add_record('l', item->value, 0);
+  return 0;
+}
+
+s32 MBNG_PATCH_Load(char *filename)
+{
+  add_checksum("LOAD", 4);
+  add_checksum(filename, strlen(filename));
+  return 0;
+}
+
+
+// ------- file stubs: the script is read from the host file system -------
+static const char *script_path;
+static u8 file_data[FILE_MAX_SIZE];
+static u32 file_size;
+static u32 file_pos;
+
+s32 FILE_ReadOpen(file_t* file, char *filepath)
+{
+  FILE *f = fopen(script_path, "rb");
+  if( !f )
+    return FILE_ERR_OPEN_READ;
+  file_size = fread(file_data, 1, FILE_MAX_SIZE, f);
+  fclose(f);
+  file_pos = 0;
+  return 0;
+}
+
+static s32 load_script(const char *path)
+{
+  script_path = path;
+  if( FILE_ReadOpen(NULL, NULL) < 0 ) {
+    printf("ERROR: can't read %s\n", path);
+    return -1;
+  }
+  return 0;
+}
+
+s32 FILE_ReadReOpen(file_t* file) { return 0; }
+s32 FILE_ReadClose(file_t* file) { return 0; }
+
+s32 FILE_ReadSeek(u32 offset)
+{
+  file_pos = offset;
+  return 0;
+}
+
+// like FILE_ReadLine() of modules/file/file.c
+s32 FILE_ReadLine(u8 *buffer, u32 max_len)
+{
+  u32 num_read = 0;
+
+  while( file_pos < file_size ) {
+    *buffer = file_data[file_pos++];
+    ++num_read;
+
+    if( *buffer == '\n' || *buffer == '\r' )
+      break;
+
+    if( num_read < max_len )
+      ++buffer;
+  }
+
+  *buffer = 0;
+  return num_read;
+}
+
+
+// ------- event pool stubs -------
+static const struct {
+  const char *name;
+  mbng_event_item_id_t id;
+} controllers[] = {
+  { "SENDER",   MBNG_EVENT_CONTROLLER_SENDER },
+  { "RECEIVER", MBNG_EVENT_CONTROLLER_RECEIVER },
+  { "BUTTON",   MBNG_EVENT_CONTROLLER_BUTTON },
+  { "LED",      MBNG_EVENT_CONTROLLER_LED },
+  { "ENC",      MBNG_EVENT_CONTROLLER_ENC },
+  { "AIN",      MBNG_EVENT_CONTROLLER_AIN },
+  { "KB",       MBNG_EVENT_CONTROLLER_KB },
+  { "RGBLED",   MBNG_EVENT_CONTROLLER_RGBLED },
+};
+#define NUM_CONTROLLERS (sizeof(controllers)/sizeof(controllers[0]))
+
+const char *MBNG_EVENT_ItemControllerStrGet(mbng_event_item_id_t id)
+{
+  int i;
+  for(i=0; i<NUM_CONTROLLERS; ++i)
+    if( controllers[i].id == (id & 0xf000) )
+      return controllers[i].name;
+  return "DISABLED";
+}
+
+mbng_event_item_id_t MBNG_EVENT_ItemIdFromControllerStrGet(char *event)
+{
+  int i;
+  for(i=0; i<NUM_CONTROLLERS; ++i)
+    if( strcasecmp(event, controllers[i].name) == 0 )
+      return controllers[i].id;
+  return MBNG_EVENT_CONTROLLER_DISABLED;
+}
+
+mbng_event_type_t MBNG_EVENT_ItemTypeFromStrGet(char *event_type)
+{
+  if( strcasecmp(event_type, "NoteOff") == 0 )       return MBNG_EVENT_TYPE_NOTE_OFF;
+  if( strcasecmp(event_type, "NoteOnOff") == 0 )     return MBNG_EVENT_TYPE_NOTE_ON_OFF;
+  if( strcasecmp(event_type, "NoteOn") == 0 || strcasecmp(event_type, "Note") == 0 ) return MBNG_EVENT_TYPE_NOTE_ON;
+  if( strcasecmp(event_type, "PolyPressure") == 0 )  return MBNG_EVENT_TYPE_POLY_PRESSURE;
+  if( strcasecmp(event_type, "CC") == 0 )            return MBNG_EVENT_TYPE_CC;
+  if( strcasecmp(event_type, "ProgramChange") == 0 ) return MBNG_EVENT_TYPE_PROGRAM_CHANGE;
+  if( strcasecmp(event_type, "Aftertouch") == 0 )    return MBNG_EVENT_TYPE_AFTERTOUCH;
+  if( strcasecmp(event_type, "Pitchbend") == 0 )     return MBNG_EVENT_TYPE_PITCHBEND;
+  if( strcasecmp(event_type, "SysEx") == 0 )         return MBNG_EVENT_TYPE_SYSEX;
+  if( strcasecmp(event_type, "NRPN") == 0 )          return MBNG_EVENT_TYPE_NRPN;
+  return MBNG_EVENT_TYPE_UNDEFINED;
+}
+
+mbng_event_sysex_var_t MBNG_EVENT_ItemSysExVarFromStrGet(char *sysex_var)
+{
+  if( strcasecmp(sysex_var, "dev") == 0 ) return MBNG_EVENT_SYSEX_VAR_DEV;
+  if( strcasecmp(sysex_var, "val") == 0 || strcasecmp(sysex_var, "value") == 0 ) return MBNG_EVENT_SYSEX_VAR_VAL;
+  return MBNG_EVENT_SYSEX_VAR_UNDEFINED;
+}
+
+static const struct {
+  const char *name;
+  mbng_event_meta_type_t type;
+  u8 num_bytes;
+} meta_types[] = {
+  { "SetBank",        MBNG_EVENT_META_TYPE_SET_BANK,         0 },
+  { "DecBank",        MBNG_EVENT_META_TYPE_DEC_BANK,         0 },
+  { "IncBank",        MBNG_EVENT_META_TYPE_INC_BANK,         0 },
+  { "RunSection",     MBNG_EVENT_META_TYPE_RUN_SECTION,      1 },
+  { "RunStop",        MBNG_EVENT_META_TYPE_RUN_STOP,         0 },
+  { "MClkPlay",       MBNG_EVENT_META_TYPE_MCLK_PLAY,        0 },
+  { "MClkStop",       MBNG_EVENT_META_TYPE_MCLK_STOP,        0 },
+  { "MClkSetTempo",   MBNG_EVENT_META_TYPE_MCLK_SET_TEMPO,   0 },
+  { "MClkSetDivider", MBNG_EVENT_META_TYPE_MCLK_SET_DIVIDER, 0 },
+  { "UpdateLcd",      MBNG_EVENT_META_TYPE_UPDATE_LCD,       0 },
+};
+#define NUM_META_TYPES (sizeof(meta_types)/sizeof(meta_types[0]))
+
+mbng_event_meta_type_t MBNG_EVENT_ItemMetaTypeFromStrGet(char *meta_type)
+{
+  int i;
+  for(i=0; i<NUM_META_TYPES; ++i)
+    if( strcasecmp(meta_type, meta_types[i].name) == 0 )
+      return meta_types[i].type;
+  return MBNG_EVENT_META_TYPE_UNDEFINED;
+}
+
+const char *MBNG_EVENT_ItemMetaTypeStrGet(mbng_event_meta_type_t meta_type)
+{
+  int i;
+  for(i=0; i<NUM_META_TYPES; ++i)
+    if( meta_types[i].type == meta_type )
+      return meta_types[i].name;
+  return "Undefined";
+}
+
+u8 MBNG_EVENT_ItemMetaNumBytesGet(mbng_event_meta_type_t meta_type)
+{
+  int i;
+  for(i=0; i<NUM_META_TYPES; ++i)
+    if( meta_types[i].type == meta_type )
+      return meta_types[i].num_bytes;
+  return 0;
+}
+
+s32 MBNG_EVENT_ItemInit(mbng_event_item_t *item, mbng_event_item_id_t id)
+{
+  memset(item, 0, sizeof(mbng_event_item_t));
+  item->id = id;
+  item->hw_id = id;
+  item->pool_address = 0xffff; // invalid address
+  item->max = 127;
+  return 0;
+}
+
+static void pool_add(mbng_event_item_id_t id)
+{
+  u32 i;
+  for(i=0; i<pool_num_items; ++i)
+    if( pool[i].id == id )
+      return;
+
+  if( pool_num_items < POOL_MAX ) {
+    mbng_event_item_t *item = &pool[pool_num_items];
+    MBNG_EVENT_ItemInit(item, id);
+    item->pool_address = pool_num_items++;
+    item->flags.active = 1;
+    if( ++pool_generation == 0 ) // like MBNG_EVENT_PoolChanged()
+      pool_generation = 1;
+  }
+}
+
+// adds all controllers which are referenced in the script
+static void pool_add_script_items(void)
+{
+  int c;
+  for(c=0; c<NUM_CONTROLLERS; ++c) {
+    const char *name = controllers[c].name;
+    int len = strlen(name);
+    u32 pos;
+    for(pos=0; pos+len+1 < file_size; ++pos) {
+      if( strncasecmp((char *)&file_data[pos], name, len) == 0 && file_data[pos+len] == ':' &&
+	  (pos == 0 || (file_data[pos-1] != '_' && (file_data[pos-1] < 'A' || file_data[pos-1] > 'Z'))) ) {
+	char *end;
+	int first = strtol((char *)&file_data[pos+len+1], &end, 10);
+	int last = first;
+	if( end[0] == '.' && end[1] == '.' )
+	  last = strtol(end+2, NULL, 10);
+	for(; first >= 1 && first <= last && first <= 0xfff; ++first)
+	  pool_add(controllers[c].id | first);
+      }
+    }
+  }
+}
+
+static void pool_init(void)
+{
+  int i;
+  pool_num_items = 0;
+  for(i=1; i<=POOL_FILLER/2; ++i) {
+    pool_add(MBNG_EVENT_CONTROLLER_BUTTON | (0x800 + i));
+    pool_add(MBNG_EVENT_CONTROLLER_LED | (0x800 + i));
+  }
+}
+
+static s32 pool_search(mbng_event_item_id_t id, mbng_event_item_id_t id_end_range, u8 is_hw_id, mbng_event_item_t *item, u32 *continue_ix)
+{
+  u32 i;
+  ++stats.searches;
+  for(i=*continue_ix; i<pool_num_items; ++i) {
+    mbng_event_item_t *pool_item = &pool[i];
+    u16 pool_id = is_hw_id ? pool_item->hw_id : pool_item->id;
+    ++stats.search_steps;
+    if( is_hw_id && !pool_item->flags.active )
+      continue;
+    if( (!id_end_range && pool_id == id) ||
+	(id_end_range && pool_id >= id && pool_id <= id_end_range) ) {
+      *item = *pool_item;
+      *continue_ix = (i+1 < pool_num_items) ? (i+1) : 0;
+      return 0;
+    }
+  }
+  return -1;
+}
+
+s32 MBNG_EVENT_ItemSearchById(mbng_event_item_id_t id, mbng_event_item_id_t id_end_range, mbng_event_item_t *item, u32 *continue_ix)
+{
+  return pool_search(id, id_end_range, 0, item, continue_ix);
+}
+
+s32 MBNG_EVENT_ItemSearchByHwId(mbng_event_item_id_t hw_id, mbng_event_item_id_t hw_id_end_range, mbng_event_item_t *item, u32 *continue_ix)
+{
+  return pool_search(hw_id, hw_id_end_range, 1, item, continue_ix);
+}
+
+// like MBNG_EVENT_ItemValueGetByRef() of mbng_event.c
+s32 MBNG_EVENT_ItemValueGetByRef(mbng_event_item_id_t id, u8 is_hw_id, mbng_event_item_ref_t *ref, s16 *value)
+{
+  u32 i;
+
+  if( ref->generation == pool_generation ) {
+    *value = pool[ref->pool_offset].value;
+    return 0;
+  }
+
+  ++stats.searches;
+  for(i=0; i<pool_num_items; ++i) {
+    mbng_event_item_t *pool_item = &pool[i];
+    ++stats.search_steps;
+    if( (!is_hw_id && pool_item->id == id) ||
+	(is_hw_id && pool_item->flags.active && pool_item->hw_id == id) ) {
+      ref->generation = pool_generation;
+      ref->pool_offset = i;
+      *value = pool_item->value;
+      return 0;
+    }
+  }
+  return -1;
+}
+
+s32 MBNG_EVENT_ItemModify(mbng_event_item_t *item)
+{
+  if( item->pool_address >= pool_num_items )
+    return -1;
+  pool[item->pool_address] = *item;
+  add_record('M', item->id, item->min | (item->max << 16));
+  add_record('c', item->rgb.ALL, item->hsv.ALL);
+  add_record('k', item->custom_flags.ALL, 0);
+  return 0;
+}
+
+s32 MBNG_EVENT_ItemReceive(mbng_event_item_t *item, u16 value, u8 from_midi, u8 fwd_enabled)
+{
+  item->value = value;
+  if( item->pool_address < pool_num_items )
+    pool[item->pool_address].value = value;
+  add_record('R', item->id, value);
+  return 0;
+}
+
+s32 MBNG_EVENT_NotifySendValue(mbng_event_item_t *item)
+{
+  add_record('N', item->id, item->value);
+  return 0;
+}
+
+s32 MBNG_EVENT_ItemSendVirtual(mbng_event_item_t *item, mbng_event_item_id_t send_id)
+{
+  add_record('V', send_id, item->value);
+  add_record('c', item->rgb.ALL, item->hsv.ALL);
+  return 0;
+}
+
+static s32 set_flag(mbng_event_item_t *item, char type, u8 value)
+{
+  if( item->pool_address >= pool_num_items )
+    return -1;
+  if( type == 'A' )
+    pool[item->pool_address].flags.active = value;
+  add_record(type, item->id, value);
+  return 0;
+}
+
+s32 MBNG_EVENT_ItemSetLock(mbng_event_item_t *item, u8 lock) { return set_flag(item, 'W', lock); }
+s32 MBNG_EVENT_ItemSetActive(mbng_event_item_t *item, u8 active) { return set_flag(item, 'A', active); }
+s32 MBNG_EVENT_ItemSetNoDump(mbng_event_item_t *item, u8 no_dump) { return set_flag(item, 'D', no_dump); }
+
+s32 MBNG_EVENT_SelectedBankGet(void) { return selected_bank; }
+
+s32 MBNG_EVENT_SelectedBankSet(u8 new_bank)
+{
+  selected_bank = new_bank;
+  add_record('B', new_bank, 0);
+  return 0;
+}
+
+s32 MBNG_EVENT_ExecMeta(mbng_event_item_t *item)
+{
+  add_record('X', item->stream[0], item->value);
+  if( item->stream[0] == MBNG_EVENT_META_TYPE_RUN_SECTION )
+    MBNG_FILE_R_ReadRequest(NULL, item->stream[1], item->value, 0);
+  else if( item->stream[0] == MBNG_EVENT_META_TYPE_RUN_STOP )
+    MBNG_FILE_R_RunStop();
+  return 0;
+}
+
+s32 MBNG_EVENT_SendOptimizedNRPN(mios32_midi_port_t port, mios32_midi_chn_t chn, u16 nrpn_address, u16 nrpn_value, u8 msb_only)
+{
+  add_record('n', port | (chn << 8), nrpn_address | (nrpn_value << 16));
+  return 0;
+}
+
+s32 MBNG_EVENT_SendSysExStream(mios32_midi_port_t port, mbng_event_item_t *item)
+{
+  add_record('s', port, item->stream_size);
+  add_checksum(item->stream, item->stream_size);
+  return 0;
+}
+
+
+// ------- replay -------
+static u64 now_ns(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (u64)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static u64 run_request(u8 section, s16 value)
+{
+  u64 t = now_ns();
+  int tick;
+
+  MBNG_FILE_R_ReadRequest(NULL, section, value, 0);
+  for(tick=0; tick<TICKS_PER_REQ; ++tick) {
+    ++bpm_tick;
+    MBNG_FILE_R_CheckRequest();
+  }
+  t = now_ns() - t;
+
+  // tokens of this request, including continuations after DELAY_MS
+  capture_token_ctr = 1;
+  MBNG_FILE_R_TokenMemPrint();
+  capture_token_ctr = 0;
+  stats.exec_tokens += last_exec_tokens;
+
+  return t;
+}
+
+static void replay(const char *path, u32 *total_tokens, u64 *total_ns)
+{
+  const char *name = strrchr(path, '/') + 1;
+  char filename[MBNG_FILE_R_FILENAME_LEN+1];
+  u64 ns = 0;
+  int i;
+
+  // script name without extension, upper case like on the SD card
+  for(i=0; i<MBNG_FILE_R_FILENAME_LEN && name[i] && name[i] != '.'; ++i)
+    filename[i] = toupper((int)name[i]);
+  filename[i] = 0;
+
+  if( load_script(path) < 0 )
+    exit(1);
+  MBNG_FILE_R_Init(0);
+  pool_init();
+  pool_add_script_items();
+
+  // the first request reads and tokenizes the script
+  MBNG_FILE_R_ReadRequest(filename, 0, 0, 0);
+  MBNG_FILE_R_CheckRequest();
+
+  memset(&stats, 0, sizeof(stats));
+  srand(1);
+  for(i=0; i<NUM_REQUESTS; ++i) {
+    // a random item has been changed via MIDI
+    pool[rand() % pool_num_items].value = rand() % 17;
+    ns += run_request(rand() % 12, rand() % 17);
+  }
+
+  printf("%-9s %6u %10.1f %10.1f %10.1f %8.0f %6u\n",
+	 filename, pool_num_items,
+	 (double)stats.exec_tokens / NUM_REQUESTS,
+	 (double)stats.searches / NUM_REQUESTS,
+	 (double)stats.search_steps / NUM_REQUESTS,
+	 (double)ns / NUM_REQUESTS,
+	 stats.errors);
+
+  *total_tokens += stats.exec_tokens;
+  *total_ns += ns;
+}
+
+int main(int argc, char *argv[])
+{
+  u32 total_tokens = 0;
+  u64 total_ns = 0;
+  int i;
+
+  printf("%s, %d requests per script:\n",
+	 NGR_OPTIMIZED ? "optimized tokens" : "plain tokens", NUM_REQUESTS);
+  printf("%-9s %6s %10s %10s %10s %8s %6s\n",
+	 "script", "items", "tokens/req", "search/req", "steps/req", "nS/req", "errors");
+
+  for(i=0; i<NUM_SCRIPTS; ++i)
+    replay(scripts[i], &total_tokens, &total_ns);
+
+  printf("total: %.1f tokens, %.0f nS per request\n",
+	 (double)total_tokens / (NUM_SCRIPTS * NUM_REQUESTS),
+	 (double)total_ns / (NUM_SCRIPTS * NUM_REQUESTS));
+  printf("checksum of the script output: %08x\n", checksum);
+  return 0;
+}
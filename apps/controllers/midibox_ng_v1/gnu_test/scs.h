@@ -0,0 +1,2 @@
+// SCS definitions used by mbng_patch.h
+#define SCS_NUM_MENU_ITEMS 4
@@ -0,0 +1 @@
+// not used by mbng_file_r.c
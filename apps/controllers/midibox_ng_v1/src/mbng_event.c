@@ -129,6 +129,9 @@ static u16 event_pool_maps_begin;
 static u16 event_pool_num_items;
 static u16 event_pool_num_maps;
 
+// incremented whenever items are moved or (de)activated, invalidates mbng_event_item_ref_t
+static u16 event_pool_generation = 1;
+
 // last active event
 mbng_event_item_id_t last_event_item_id;
 
@@ -184,6 +187,7 @@ static u8 lc_meters[LC_METERS_NUM_PORTS][LC_METERS_NUM_ITEMS];
 /////////////////////////////////////////////////////////////////////////////
 static s32 MBNG_EVENT_ItemCopy2User(mbng_event_pool_item_t* pool_item, mbng_event_item_t *item);
 static s32 MBNG_EVENT_ItemCopy2Pool(mbng_event_item_t *item, mbng_event_pool_item_t* pool_item);
+static void MBNG_EVENT_PoolChanged(void);
 
 static s32 MBNG_EVENT_LCMeters_Update(void);
 static s32 MBNG_EVENT_LCMeters_Set(u8 port_ix, u8 lc_meter_value);
@@ -361,6 +365,16 @@ s32 MBNG_EVENT_Tick(void)
 }
 
 
+/////////////////////////////////////////////////////////////////////////////
+//! Local function: invalidates all item references
+/////////////////////////////////////////////////////////////////////////////
+static void MBNG_EVENT_PoolChanged(void)
+{
+  if( ++event_pool_generation == 0 )
+    event_pool_generation = 1; // 0 is reserved for unresolved references
+}
+
+
 /////////////////////////////////////////////////////////////////////////////
 //! Clear the event pool
 /////////////////////////////////////////////////////////////////////////////
@@ -370,6 +384,7 @@ s32 MBNG_EVENT_PoolClear(void)
   event_pool_maps_begin = 0;
   event_pool_num_items = 0;
   event_pool_num_maps = 0;
+  MBNG_EVENT_PoolChanged();
 
   last_event_item_id = 0;
 
@@ -385,6 +400,7 @@ s32 MBNG_EVENT_PoolClear(void)
 s32 MBNG_EVENT_PoolUpdate(void)
 {
   num_banks = 0;
+  MBNG_EVENT_PoolChanged();
 
   u8 *pool_ptr = (u8 *)&event_pool[0];
   u32 i;
@@ -855,6 +871,7 @@ s32 MBNG_EVENT_SelectedBankSet(u8 new_bank)
     return -1; // invalid bank
 
   selected_bank = new_bank;
+  MBNG_EVENT_PoolChanged();
 
   // update active flag of all elements depending on the bank
   u8 *pool_ptr = (u8 *)&event_pool[0];
@@ -901,6 +918,8 @@ s32 MBNG_EVENT_HwIdBankGet(u16 hw_id)
 /////////////////////////////////////////////////////////////////////////////
 s32 MBNG_EVENT_HwIdBankSet(u16 hw_id, u8 new_bank)
 {
+  MBNG_EVENT_PoolChanged();
+
   // update all items which are banked and which belong to the given hw_id
   u8 *pool_ptr = (u8 *)&event_pool[0];
   u32 i;
@@ -1425,6 +1444,7 @@ s32 MBNG_EVENT_ItemAdd(mbng_event_item_t *item)
   MBNG_EVENT_ItemCopy2Pool(item, pool_item);
   event_pool_size += pool_item->len;
   ++event_pool_num_items;
+  MBNG_EVENT_PoolChanged();
   event_pool_maps_begin += pool_item_len;
 
   return 0; // no error
@@ -1442,6 +1462,7 @@ s32 MBNG_EVENT_ItemModify(mbng_event_item_t *item)
     mbng_event_pool_item_t *pool_item = (mbng_event_pool_item_t *)pool_ptr;
     if( pool_item->id == item->id ) {
       u32 label_len = item->label ? (strlen(item->label)+1) : 0;
+      MBNG_EVENT_PoolChanged();
       u32 pool_item_len = MBNG_EVENT_ItemCalcPoolItemLen(item);
 
       if( pool_item_len > 255 )
@@ -1578,6 +1599,44 @@ s32 MBNG_EVENT_ItemSearchByHwId(mbng_event_item_id_t hw_id, mbng_event_item_id_t
 }
 
 
+/////////////////////////////////////////////////////////////////////////////
+//! Returns the value of the first item which matches with the ID\n
+//! (is_hw_id == 0) or the HW ID (is_hw_id == 1, only active items).\n
+//! The location of the item is stored in *ref, so that the pool doesn't
+//! need to be searched again as long as it hasn't been changed (used by
+//! tokenized .NGR scripts)
+//! \returns 0 and copies the value into *value if found
+//! \returns -1 if item not found
+/////////////////////////////////////////////////////////////////////////////
+s32 MBNG_EVENT_ItemValueGetByRef(mbng_event_item_id_t id, u8 is_hw_id, mbng_event_item_ref_t *ref, s16 *value)
+{
+  mbng_event_pool_item_t *pool_item;
+
+  if( ref->generation == event_pool_generation ) {
+    pool_item = (mbng_event_pool_item_t *)&event_pool[ref->pool_offset];
+    *value = pool_item->value;
+    return 0; // item found
+  }
+
+  u8 *pool_ptr = (u8 *)&event_pool[0];
+  u32 i;
+  for(i=0; i<event_pool_num_items; ++i) {
+    pool_item = (mbng_event_pool_item_t *)pool_ptr;
+
+    if( (!is_hw_id && pool_item->id == id) ||
+	(is_hw_id && pool_item->flags.active && pool_item->hw_id == id) ) {
+      ref->generation = event_pool_generation;
+      ref->pool_offset = (u32)pool_ptr - (u32)event_pool;
+      *value = pool_item->value;
+      return 0; // item found
+    }
+    pool_ptr += pool_item->len;
+  }
+
+  return -1; // not found
+}
+
+
 /////////////////////////////////////////////////////////////////////////////
 //! Iterates through the event pool to retrieve values/secondary values\n
 //! Used to store a snapshot in \ref MBNG_FILE_S_Write
@@ -1647,6 +1706,7 @@ s32 MBNG_EVENT_ItemSetActive(mbng_event_item_t *item, u8 active)
     mbng_event_pool_item_t *pool_item = (mbng_event_pool_item_t *)((u32)&event_pool[0] + item->pool_address);
     pool_item->flags.active = active;
     item->flags.active = active;
+    MBNG_EVENT_PoolChanged();
 
     if( active ) {
       u8 allow_refresh = 1;
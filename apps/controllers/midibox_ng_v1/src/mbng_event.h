@@ -406,6 +406,12 @@ typedef struct {
   char *label;
 } mbng_event_item_t;
 
+// reference to a pool item, used by MBNG_EVENT_ItemValueGetByRef()
+typedef struct {
+  u16 generation; // 0: not resolved yet
+  u16 pool_offset;
+} mbng_event_item_ref_t;
+
 
 /////////////////////////////////////////////////////////////////////////////
 // Prototypes
@@ -446,6 +452,7 @@ extern s32 MBNG_EVENT_ItemAdd(mbng_event_item_t *item);
 extern s32 MBNG_EVENT_ItemModify(mbng_event_item_t *item);
 extern s32 MBNG_EVENT_ItemSearchById(mbng_event_item_id_t id, mbng_event_item_id_t id_end_range, mbng_event_item_t *item, u32 *continue_ix);
 extern s32 MBNG_EVENT_ItemSearchByHwId(mbng_event_item_id_t hw_id, mbng_event_item_id_t hw_id_end_range, mbng_event_item_t *item, u32 *continue_ix);
+extern s32 MBNG_EVENT_ItemValueGetByRef(mbng_event_item_id_t id, u8 is_hw_id, mbng_event_item_ref_t *ref, s16 *value);
 extern s32 MBNG_EVENT_ItemRetrieveValues(mbng_event_item_id_t *id, s16 *value, u8 *secondary_value, u32 *continue_ix);
 extern s32 MBNG_EVENT_ItemCopyValueToPool(mbng_event_item_t *item);
 extern s32 MBNG_EVENT_ItemSetLock(mbng_event_item_t *item, u8 lock);
@@ -59,6 +59,14 @@
 # define NGR_TOKENIZED 0
 #endif
 
+/////////////////////////////////////////////////////////////////////////////
+//! Fold constants, pre-resolve item references and link IF/ELSE jumps?
+//! (can be disabled to compare with the plain token interpreter, see gnu_test)
+/////////////////////////////////////////////////////////////////////////////
+#ifndef NGR_OPTIMIZED
+# define NGR_OPTIMIZED 1
+#endif
+
 
 /////////////////////////////////////////////////////////////////////////////
 //! Nesting vars
@@ -75,7 +83,16 @@ static u8 if_state[IF_MAX_NESTING_LEVEL];
 #define NGR_TOKEN_MEM_SIZE 16384
 static u8 ngr_token_mem[NGR_TOKEN_MEM_SIZE];
 static u32 ngr_token_mem_end;
-static u8 if_offset[IF_MAX_NESTING_LEVEL];
+
+// pre-resolved event pool references of (id) and (hw_id) values
+#define NGR_ITEM_REF_NUM 64
+#define NGR_ITEM_REF_NONE 0xff
+static mbng_event_item_ref_t ngr_item_ref[NGR_ITEM_REF_NUM];
+static u8 ngr_item_ref_num;
+
+// number of executed tokens (for performance checks)
+static u32 ngr_exec_token_ctr;
+static u32 ngr_exec_token_ctr_max;
 #endif
 
 static u32 ngr_token_mem_run_pos; // used by some debug messages
@@ -132,8 +149,8 @@ typedef enum {
 
   TOKEN_VALUE_CONST8    = 0xb0, // +1 byte for the constant value
   TOKEN_VALUE_CONST16   = 0xb1, // +1 byte for the constant value
-  TOKEN_VALUE_ID        = 0xb2, // +2 bytes for ID
-  TOKEN_VALUE_HW_ID     = 0xb3, // +2 bytes for ID
+  TOKEN_VALUE_ID        = 0xb2, // +2 bytes for ID (+1 byte for item reference if used as value)
+  TOKEN_VALUE_HW_ID     = 0xb3, // +2 bytes for ID (+1 byte for item reference if used as value)
   TOKEN_VALUE_ID_RANGE  = 0xb4, // +2*2 bytes for IDs
   TOKEN_VALUE_HW_ID_RANGE = 0xb5, // +2*2 bytes for IDs
 
@@ -284,6 +301,7 @@ s32 MBNG_FILE_R_Unload(void)
 #if NGR_TOKENIZED
   ngr_token_mem_run_pos = 0;
   ngr_token_mem_end = 0;
+  ngr_item_ref_num = 0;
 #endif
 
   return 0; // no error
@@ -335,6 +353,8 @@ s32 MBNG_FILE_R_TokenMemPrint(void)
   DEBUG_MSG("Token memory allocation: %d of %d bytes", ngr_token_mem_end, NGR_TOKEN_MEM_SIZE);
   DEBUG_MSG("%s.NGR file is: %s", mbng_file_r_script_name, mbng_file_r_info.valid ? "valid" : "invalid");
   DEBUG_MSG("Tokens are: %s", mbng_file_r_info.tokenized ? "valid" : "invalid");
+  DEBUG_MSG("Item references: %d of %d", ngr_item_ref_num, NGR_ITEM_REF_NUM);
+  DEBUG_MSG("Executed tokens: %d in last run, max: %d", ngr_exec_token_ctr, ngr_exec_token_ctr_max);
 
   if( ngr_token_mem_end > 0 ) {
     MIOS32_MIDI_SendDebugHexDump(ngr_token_mem, ngr_token_mem_end);
@@ -427,6 +447,43 @@ s32 MBNG_FILE_R_PushMemory(u8 *src, u32 src_size, u8 line)
 
   return 0; // no error
 }
+
+/////////////////////////////////////////////////////////////////////////////
+//! Pushes a constant value to the ngr memory
+//! returns < 0 on errors
+/////////////////////////////////////////////////////////////////////////////
+static s32 pushTokenizedConst(s32 value, u8 line)
+{
+  if( value & 0xff00 ) {
+    if( MBNG_FILE_R_PushToken(TOKEN_VALUE_CONST16, line) < 0 ||
+	MBNG_FILE_R_PushToken((value >> 0) & 0xff, line) < 0 ||
+	MBNG_FILE_R_PushToken((value >> 8) & 0xff, line) < 0 )
+      return -1;
+  } else {
+    if( MBNG_FILE_R_PushToken(TOKEN_VALUE_CONST8, line) < 0 ||
+	MBNG_FILE_R_PushToken((value >> 0) & 0xff, line) < 0 )
+      return -1;
+  }
+
+  return 0; // no error
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//! \returns the length of a constant value token at the given mem pos
+//! \returns 0 if no constant value is located at this position
+/////////////////////////////////////////////////////////////////////////////
+static u32 tokenizedConstLen(u32 pos)
+{
+  if( pos >= ngr_token_mem_end )
+    return 0;
+
+  switch( ngr_token_mem[pos] ) {
+  case TOKEN_VALUE_CONST8:  return 2;
+  case TOKEN_VALUE_CONST16: return 3;
+  }
+
+  return 0;
+}
 #endif
 
 
@@ -567,6 +624,9 @@ static s32 get_dec(char *word)
 /////////////////////////////////////////////////////////////////////////////
 s32 lineIsEmpty(char *line)
 {
+  if( !line )
+    return 1; // ngr_strtok_r() reached the end of line
+
   while( *line ) {
     if( *line == '#' )
       return 1; // line is empty (allow comment)
@@ -664,6 +724,9 @@ static s32 parseValue(u32 line, char *command, char *value_str, u8 tokenize_req)
     char *lOperand = value_str;
     char *rOperand = value_str;
     ngr_token_t math_token = TOKEN_NOP;
+#if NGR_TOKENIZED
+    u32 math_token_pos = ngr_token_mem_end;
+#endif
     {
       int i;
       for(i=0; i<len; ++i, ++rOperand) {
@@ -720,21 +783,37 @@ static s32 parseValue(u32 line, char *command, char *value_str, u8 tokenize_req)
       return -1000000000;
     }
 
+    s32 value;
     switch( math_token ) {
-    case TOKEN_MATH_PLUS:   return lValue + rValue;
-    case TOKEN_MATH_MINUS:  return lValue - rValue;
-    case TOKEN_MATH_MUL:    return lValue * rValue;
-    case TOKEN_MATH_DIV:    return lValue / rValue;
-    case TOKEN_MATH_REMAIN: return lValue % rValue;
-    case TOKEN_MATH_AND:    return lValue & rValue;
-    case TOKEN_MATH_OR:     return lValue | rValue;
-    case TOKEN_MATH_XOR:    return lValue ^ rValue;
+    case TOKEN_MATH_PLUS:   value = lValue + rValue; break;
+    case TOKEN_MATH_MINUS:  value = lValue - rValue; break;
+    case TOKEN_MATH_MUL:    value = lValue * rValue; break;
+    case TOKEN_MATH_DIV:    value = lValue / rValue; break;
+    case TOKEN_MATH_REMAIN: value = lValue % rValue; break;
+    case TOKEN_MATH_AND:    value = lValue & rValue; break;
+    case TOKEN_MATH_OR:     value = lValue | rValue; break;
+    case TOKEN_MATH_XOR:    value = lValue ^ rValue; break;
+    default:
+#if DEBUG_VERBOSE_LEVEL >= 1
+      DEBUG_MSG("[MBNG_FILE_R:%d] ERROR: unsupported operator in math operation '%s'!", line, value_str);
+#endif
+      return -1000000000;
     }
 
-#if DEBUG_VERBOSE_LEVEL >= 1
-    DEBUG_MSG("[MBNG_FILE_R:%d] ERROR: unsupported operator in math operation '%s'!", line, value_str);
+#if NGR_TOKENIZED
+    // constant folding: if both operands are constants, replace the operation by the result
+    if( NGR_OPTIMIZED && tokenize_req && value >= -16384 && value <= 16383 ) {
+      u32 lLen = tokenizedConstLen(math_token_pos + 1);
+      u32 rLen = lLen ? tokenizedConstLen(math_token_pos + 1 + lLen) : 0;
+      if( rLen && (math_token_pos + 1 + lLen + rLen) == ngr_token_mem_end ) {
+	ngr_token_mem_end = math_token_pos;
+	if( pushTokenizedConst(value, line) < 0 )
+	  return -1000000000; // exit due to error
+      }
+    }
 #endif
-    return -1000000000;
+
+    return value;
   }
 
   if( value_str[0] == '^' ) {
@@ -819,9 +898,17 @@ static s32 parseValue(u32 line, char *command, char *value_str, u8 tokenize_req)
         return -1000000000; // exit due to error
       }
 
+      // allocate an item reference, so that the item doesn't need to be searched on each run
+      u8 ref_ix = NGR_ITEM_REF_NONE;
+      if( NGR_OPTIMIZED && ngr_item_ref_num < NGR_ITEM_REF_NUM ) {
+	ref_ix = ngr_item_ref_num++;
+	ngr_item_ref[ref_ix].generation = 0; // not resolved yet
+      }
+
       if( MBNG_FILE_R_PushToken(id.is_hw_id ? TOKEN_VALUE_HW_ID : TOKEN_VALUE_ID, line) < 0 ||
 	  MBNG_FILE_R_PushToken((id.id >> 0) & 0xff, line) < 0 ||
-	  MBNG_FILE_R_PushToken((id.id >> 8) & 0xff, line) < 0 )
+	  MBNG_FILE_R_PushToken((id.id >> 8) & 0xff, line) < 0 ||
+	  MBNG_FILE_R_PushToken(ref_ix, line) < 0 )
 	return -1000000000; // exit due to error
     }
 #endif
@@ -852,16 +939,8 @@ static s32 parseValue(u32 line, char *command, char *value_str, u8 tokenize_req)
 	return -1000000000;
       }
 
-      if( value & 0xff00 ) {
-	if( MBNG_FILE_R_PushToken(TOKEN_VALUE_CONST16, line) < 0 ||
-	    MBNG_FILE_R_PushToken((value >> 0) & 0xff, line) < 0 ||
-	    MBNG_FILE_R_PushToken((value >> 8) & 0xff, line) < 0 )
-	  return -1000000000; // exit due to error
-      } else {
-	if( MBNG_FILE_R_PushToken(TOKEN_VALUE_CONST8, line) < 0 ||
-	    MBNG_FILE_R_PushToken((value >> 0) & 0xff, line) < 0 )
-	  return -1000000000; // exit due to error
-      }
+      if( pushTokenizedConst(value, line) < 0 )
+	return -1000000000; // exit due to error
     }
 #endif
 
@@ -942,11 +1021,18 @@ static s32 parseTokenizedValue(void)
     u8 is_hw_id = token == TOKEN_VALUE_HW_ID;
     u16 id = (u16)ngr_token_mem[ngr_token_mem_run_pos++];
     id |= ((u16)ngr_token_mem[ngr_token_mem_run_pos++] << 8);
-    mbng_event_item_t item;
-    u32 continue_ix = 0;
-    if( (is_hw_id && MBNG_EVENT_ItemSearchByHwId(id, 0, &item, &continue_ix) >= 0) ||
-	(!is_hw_id && MBNG_EVENT_ItemSearchById(id, 0, &item, &continue_ix) >= 0) ) {
-      return (s16)item.value;
+    u8 ref_ix = ngr_token_mem[ngr_token_mem_run_pos++];
+    if( ref_ix < NGR_ITEM_REF_NUM ) {
+      s16 value;
+      if( MBNG_EVENT_ItemValueGetByRef(id, is_hw_id, &ngr_item_ref[ref_ix], &value) >= 0 )
+	return value;
+    } else {
+      mbng_event_item_t item;
+      u32 continue_ix = 0;
+      if( (is_hw_id && MBNG_EVENT_ItemSearchByHwId(id, 0, &item, &continue_ix) >= 0) ||
+	  (!is_hw_id && MBNG_EVENT_ItemSearchById(id, 0, &item, &continue_ix) >= 0) ) {
+	return (s16)item.value;
+      }
     }
     DEBUG_MSG("[MBNG_FILE_R_Exec] ERROR: (%s)%s:%d not found in event pool at mem pos 0x%x!", 
 	      is_hw_id ? "hw_id" : "id", MBNG_EVENT_ItemControllerStrGet(id), id & 0xfff, init_ngr_token_mem_run_pos);
@@ -1699,7 +1785,7 @@ s32 parseExecMeta(u32 line, char *command, char **brkt, u8 tokenize_req)
     item.stream[item.stream_size++] = value;
   }
 
-  if( strlen(brkt_local) ) {
+  if( brkt_local && strlen(brkt_local) ) {
 #if DEBUG_VERBOSE_LEVEL >= 1
     DEBUG_MSG("[MBNG_FILE_R:%d] WARNING: more values specified than expected for meta type %s\n", line, MBNG_EVENT_ItemMetaTypeStrGet(meta_type));
 #endif
@@ -2614,6 +2700,234 @@ s32 MBNG_FILE_R_Parser(u32 line, char *line_buffer, u8 *if_state, u8 *nesting_le
 }
 
 
+#if NGR_TOKENIZED
+/////////////////////////////////////////////////////////////////////////////
+//! help function which reads the jump offset of IF/ELSEIF/ELSE tokens
+//! \returns the mem pos of the next ELSEIF/ELSE/ENDIF token
+//! \returns 0 if the jump offset hasn't been determined
+/////////////////////////////////////////////////////////////////////////////
+static u16 getTokenizedJump(void)
+{
+  u16 jump_pos = (u16)ngr_token_mem[ngr_token_mem_run_pos++];
+  jump_pos |= ((u16)ngr_token_mem[ngr_token_mem_run_pos++] << 8);
+  return jump_pos;
+}
+
+#if NGR_OPTIMIZED
+/////////////////////////////////////////////////////////////////////////////
+//! help function which determines the end of a tokenized value
+//! \returns the mem pos after the value
+//! \returns 0 if the value is invalid
+/////////////////////////////////////////////////////////////////////////////
+static u32 tokenizedValueEnd(u32 pos)
+{
+  if( pos >= ngr_token_mem_end )
+    return 0;
+
+  ngr_token_t token = ngr_token_mem[pos++];
+
+  if( token >= TOKEN_MATH_BEGIN && token <= TOKEN_MATH_END ) {
+    if( !(pos = tokenizedValueEnd(pos)) )
+      return 0;
+    return tokenizedValueEnd(pos);
+  }
+
+  switch( token ) {
+  case TOKEN_VALUE_SECTION:
+  case TOKEN_VALUE_VALUE:
+  case TOKEN_VALUE_BANK:
+  case TOKEN_VALUE_SYSEX_DEV:
+  case TOKEN_VALUE_SYSEX_PAT:
+  case TOKEN_VALUE_SYSEX_BNK:
+  case TOKEN_VALUE_SYSEX_INS:
+  case TOKEN_VALUE_SYSEX_CHN:    break;
+  case TOKEN_VALUE_CONST8:       pos += 1; break;
+  case TOKEN_VALUE_CONST16:      pos += 2; break;
+  case TOKEN_VALUE_ID:
+  case TOKEN_VALUE_HW_ID:        pos += 3; break; // ID + item reference
+  case TOKEN_VALUE_ID_RANGE:
+  case TOKEN_VALUE_HW_ID_RANGE:  pos += 4; break;
+  default:
+    return 0; // invalid value
+  }
+
+  return (pos <= ngr_token_mem_end) ? pos : 0;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//! help function which determines the end of a tokenized command
+//! \returns the mem pos after the command
+//! \returns 0 if the command is invalid
+/////////////////////////////////////////////////////////////////////////////
+static u32 tokenizedCommandEnd(u32 pos)
+{
+  ngr_token_t command_token = ngr_token_mem[pos++];
+
+  switch( command_token ) {
+  case TOKEN_IF:
+  case TOKEN_ELSEIF:
+    pos += 2 + 1; // jump offset + condition
+    if( !(pos = tokenizedValueEnd(pos)) )
+      return 0;
+    return tokenizedValueEnd(pos);
+
+  case TOKEN_ELSE:
+    return pos + 2; // jump offset
+
+  case TOKEN_ENDIF:
+  case TOKEN_EXIT:
+    return pos;
+
+  case TOKEN_DELAY_MS:
+    return tokenizedValueEnd(pos);
+
+  case TOKEN_LCD:
+  case TOKEN_LOG:
+  case TOKEN_LOAD:
+    while( pos < ngr_token_mem_end && ngr_token_mem[pos] != 0 )
+      ++pos;
+    return (pos < ngr_token_mem_end) ? (pos + 1) : 0;
+
+  case TOKEN_SEND_SEQ:
+    if( !(pos = tokenizedValueEnd(pos)) || !(pos = tokenizedValueEnd(pos)) )
+      return 0;
+    // no break! continue with SEND parameters
+
+  case TOKEN_SEND: {
+    if( (pos + 3) > ngr_token_mem_end )
+      return 0;
+    u8 stream_size = ngr_token_mem[pos + 2]; // after event_type and port
+    pos += 3;
+
+    int i;
+    for(i=0; i<stream_size; ++i) {
+      if( !(pos = tokenizedValueEnd(pos)) )
+	return 0;
+    }
+    return pos;
+  }
+
+  case TOKEN_EXEC_META: {
+    if( pos >= ngr_token_mem_end )
+      return 0;
+    pos += 1 + ngr_token_mem[pos]; // stream_size + stream
+    return tokenizedValueEnd(pos);
+  }
+
+  case TOKEN_SET:
+  case TOKEN_CHANGE:
+  case TOKEN_TRIGGER:
+  case TOKEN_SET_RGB:
+  case TOKEN_SET_HSV:
+  case TOKEN_SET_LOCK:
+  case TOKEN_SET_ACTIVE:
+  case TOKEN_SET_NO_DUMP:
+  case TOKEN_SET_MIN:
+  case TOKEN_SET_MAX:
+  case TOKEN_SET_KB_TRANSPOSE:
+  case TOKEN_SET_KB_VELOCITY_MAP: {
+    if( pos >= ngr_token_mem_end )
+      return 0;
+    ngr_token_t value_token = ngr_token_mem[pos++];
+    if( value_token == TOKEN_VALUE_ID || value_token == TOKEN_VALUE_HW_ID )
+      pos += 2;
+    else if( value_token == TOKEN_VALUE_ID_RANGE || value_token == TOKEN_VALUE_HW_ID_RANGE )
+      pos += 4;
+
+    if( command_token == TOKEN_TRIGGER )
+      return pos;
+    if( command_token == TOKEN_SET_RGB )
+      return pos + 2;
+    if( command_token == TOKEN_SET_HSV )
+      return pos + 4;
+    return tokenizedValueEnd(pos);
+  }
+
+  default:
+    break;
+  }
+
+  return 0; // invalid command
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//! 2nd pass: links each IF/ELSEIF/ELSE token with the next ELSEIF/ELSE/ENDIF
+//! token of the same nesting level, so that non-matching blocks can be skipped
+//! during execution instead of parsing them token by token.
+//! \returns < 0 on errors (jump offsets are cleared in this case)
+/////////////////////////////////////////////////////////////////////////////
+static s32 linkTokenizedJumps(void)
+{
+  u16 branch_pos[IF_MAX_NESTING_LEVEL];
+  u8 level = 0;
+  u32 pos = 0;
+  s32 status = 0;
+
+  while( pos < ngr_token_mem_end ) {
+    ngr_token_t command_token = ngr_token_mem[pos];
+
+    switch( command_token ) {
+    case TOKEN_IF:
+      if( level >= IF_MAX_NESTING_LEVEL ) {
+	status = -1;
+      } else {
+	branch_pos[level++] = pos;
+      }
+      break;
+
+    case TOKEN_ELSEIF:
+    case TOKEN_ELSE:
+    case TOKEN_ENDIF:
+      if( level == 0 ) {
+	status = -1;
+      } else {
+	u16 prev_pos = branch_pos[level-1];
+	ngr_token_mem[prev_pos+1] = (pos >> 0) & 0xff;
+	ngr_token_mem[prev_pos+2] = (pos >> 8) & 0xff;
+
+	if( command_token == TOKEN_ENDIF )
+	  --level;
+	else
+	  branch_pos[level-1] = pos;
+      }
+      break;
+
+    default:
+      break;
+    }
+
+    u32 next_pos = (status < 0) ? 0 : tokenizedCommandEnd(pos);
+    if( !next_pos ) {
+      status = -1;
+      break;
+    }
+    pos = next_pos;
+  }
+
+  if( status < 0 ) {
+    // clear the offsets which have been linked so far, so that all IF/ELSE
+    // blocks are processed sequentially by MBNG_FILE_R_Exec()
+    u32 err_pos = pos;
+    pos = 0;
+    while( pos < err_pos ) {
+      ngr_token_t command_token = ngr_token_mem[pos];
+      if( command_token == TOKEN_IF || command_token == TOKEN_ELSEIF || command_token == TOKEN_ELSE ) {
+	ngr_token_mem[pos+1] = 0;
+	ngr_token_mem[pos+2] = 0;
+      }
+      if( !(pos = tokenizedCommandEnd(pos)) )
+	break;
+    }
+
+    return -1;
+  }
+
+  return 0; // no error
+}
+#endif
+#endif
+
+
 /////////////////////////////////////////////////////////////////////////////
 //! Executes the tokenized content of a NGR file
 //! \returns < 0 on errors
@@ -2627,12 +2941,18 @@ s32 MBNG_FILE_R_Exec(u8 cont_script, u8 determine_if_offsets)
   return -1; // not supported!
 #else
 
-  if( determine_if_offsets )
-    return -1; // 2nd pass not supported yet...
+  if( determine_if_offsets ) {
+#if NGR_OPTIMIZED
+    return linkTokenizedJumps();
+#else
+    return 0; // jumps not linked, IF/ELSE blocks are processed token by token
+#endif
+  }
 
   if( !cont_script ) {
     ngr_token_mem_run_pos = 0;
     nesting_level = 0;
+    ngr_exec_token_ctr = 0;
   }
 
   while( ngr_token_mem_run_pos < ngr_token_mem_end ) {
@@ -2640,6 +2960,9 @@ s32 MBNG_FILE_R_Exec(u8 cont_script, u8 determine_if_offsets)
     ngr_token_t command_token = ngr_token_mem[ngr_token_mem_run_pos++];
     u8 if_condition_matching = nesting_level == 0 || if_state[nesting_level-1] == 1;
 
+    if( ++ngr_exec_token_ctr > ngr_exec_token_ctr_max )
+      ngr_exec_token_ctr_max = ngr_exec_token_ctr;
+
     //DEBUG_MSG("[MBNG_FILE_R_Exec:%d] %02x\n", init_ngr_token_mem_run_pos, token);
 
     /////////////////////////////////////////////////////////////////////////
@@ -2648,8 +2971,7 @@ s32 MBNG_FILE_R_Exec(u8 cont_script, u8 determine_if_offsets)
 
     /////////////////////////////////////////////////////////////////////////
     case TOKEN_IF: {
-      if_offset[nesting_level] = init_ngr_token_mem_run_pos;
-      ngr_token_mem_run_pos += 2; // offset not used yet!
+      u16 jump_pos = getTokenizedJump();
 
       if( nesting_level >= IF_MAX_NESTING_LEVEL ) {
 #if DEBUG_VERBOSE_LEVEL >= 1
@@ -2661,7 +2983,10 @@ s32 MBNG_FILE_R_Exec(u8 cont_script, u8 determine_if_offsets)
 
 	if( nesting_level >= 2 && if_state[nesting_level-2] != 1 ) { // this IF is executed inside a non-matching block
 	  if_state[nesting_level-1] = 0;
-	  parseTokenizedCondition(); // dummy
+	  if( jump_pos )
+	    ngr_token_mem_run_pos = jump_pos;
+	  else
+	    parseTokenizedCondition(); // dummy
 	} else {
 	  s32 match = parseTokenizedCondition();
 
@@ -2669,6 +2994,8 @@ s32 MBNG_FILE_R_Exec(u8 cont_script, u8 determine_if_offsets)
 	    return -2; // exit due to error
 	  } else {
 	    if_state[nesting_level-1] = match ? 1 : 0;
+	    if( !match && jump_pos )
+	      ngr_token_mem_run_pos = jump_pos; // continue at next ELSEIF/ELSE/ENDIF
 	  }
 	}
       }
@@ -2681,11 +3008,14 @@ s32 MBNG_FILE_R_Exec(u8 cont_script, u8 determine_if_offsets)
       DEBUG_MSG("[MBNG_FILE_R_Exec] ERROR: tried to execute an unexpected ELSEIF token at mem pos 0x%x!", init_ngr_token_mem_run_pos);
 #endif
       } else {
-	ngr_token_mem_run_pos += 2; // offset not used yet!
+	u16 jump_pos = getTokenizedJump();
 
 	if( nesting_level >= 2 && if_state[nesting_level-2] != 1 ) { // this ELSIF is executed inside a non-matching block
 	  if_state[nesting_level-1] = 0;
-	  parseTokenizedCondition(); // dummy
+	  if( jump_pos )
+	    ngr_token_mem_run_pos = jump_pos;
+	  else
+	    parseTokenizedCondition(); // dummy
 	} else {
 	  if( if_state[nesting_level-1] == 0 ) { // no matching IF condition yet?
 	    s32 match = parseTokenizedCondition();
@@ -2693,10 +3023,15 @@ s32 MBNG_FILE_R_Exec(u8 cont_script, u8 determine_if_offsets)
 	      return -2; // exit due to error
 	    } else {
 	      if_state[nesting_level-1] = match ? 1 : 0;
+	      if( !match && jump_pos )
+		ngr_token_mem_run_pos = jump_pos; // continue at next ELSEIF/ELSE/ENDIF
 	    }
 	  } else {
-	    parseTokenizedCondition(); // dummy
 	    if_state[nesting_level-1] = 2; // IF has been processed
+	    if( jump_pos )
+	      ngr_token_mem_run_pos = jump_pos;
+	    else
+	      parseTokenizedCondition(); // dummy
 	  }
 	}
       }
@@ -2709,15 +3044,19 @@ s32 MBNG_FILE_R_Exec(u8 cont_script, u8 determine_if_offsets)
 	DEBUG_MSG("[MBNG_FILE_R_Exec] ERROR: tried to execute an unexpected ELSE token at mem pos 0x%x!", init_ngr_token_mem_run_pos);
 #endif
       } else {
-	ngr_token_mem_run_pos += 2; // offset not used yet!
+	u16 jump_pos = getTokenizedJump();
 
 	if( nesting_level >= 2 && if_state[nesting_level-2] != 1 ) { // this ELSE is executed inside a non-matching block
 	  if_state[nesting_level-1] = 0;
+	  if( jump_pos )
+	    ngr_token_mem_run_pos = jump_pos;
 	} else {
 	  if( if_state[nesting_level-1] == 0 ) { // no matching IF condition yet?
 	    if_state[nesting_level-1] = 1; // matching condition
 	  } else {
 	    if_state[nesting_level-1] = 2; // IF has been processed
+	    if( jump_pos )
+	      ngr_token_mem_run_pos = jump_pos;
 	  }
 	}
       }
@@ -2950,6 +3289,7 @@ s32 MBNG_FILE_R_Read(char *filename, u8 cont_script, u8 tokenize_req)
   if( tokenize_req && !cont_script ) {
     ngr_token_mem_end = 0;
     ngr_token_mem_run_pos = 0;
+    ngr_item_ref_num = 0;
   }
 #endif
 
@@ -3036,7 +3376,12 @@ s32 MBNG_FILE_R_Read(char *filename, u8 cont_script, u8 tokenize_req)
     info->tokenized = 1;
 
     // run 2nd pass to insert jump offsets after IF/ELSE/ELSEIF
-    MBNG_FILE_R_Exec(0, 1); // cont_script, determine_if_offsets
+    // on errors the offsets are cleared, and IF/ELSE blocks are skipped token by token
+    if( MBNG_FILE_R_Exec(0, 1) < 0 ) { // cont_script, determine_if_offsets
+#if DEBUG_VERBOSE_LEVEL >= 1
+      DEBUG_MSG("[MBNG_FILE_R] WARNING: failed to link IF/ELSE jumps in %s, executing without them!\n", filename);
+#endif
+    }
   }
 #endif
 
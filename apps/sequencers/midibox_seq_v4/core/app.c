@@ -32,6 +32,7 @@
 #include <blm_cheapo.h>
 #endif
 #include <blm_scalar_master.h>
+#include <freertos_utils.h>
 
 #include "tasks.h"
 
@@ -108,6 +109,11 @@ void APP_Init(void)
   // disable DIN test mode by default
   app_din_testmode = 0;
 
+#if FREERTOS_UTILS_TRACE_SIZE
+  // start capturing task switches (before the tasks are created)
+  FREERTOS_UTILS_TraceInit(0);
+#endif
+
 #ifdef MBSEQV4L
   // MBSEQV4L: set default port to 0xc0: multiple outputs
   MIOS32_MIDI_DefaultPortSet(0xc0);
@@ -147,6 +153,7 @@ void APP_Init(void)
   SEQ_MIDI_SYSEX_Init(0);
   SEQ_BLM_Init(0);
   SEQ_MIDI_OUT_Init(0);
+  SEQ_STATISTICS_Init(0);
   SEQ_MIDI_ROUTER_Init(0);
   SEQ_TERMINAL_Init(0);
 
@@ -552,6 +559,9 @@ void SEQ_TASK_Period1mS(void)
 void SEQ_TASK_Period1mS_LowPrio(void)
 {
 #if MEASURE_IDLE_CTR == 0
+  // fetch requested patterns into RAM
+  SEQ_PATTERN_PrefetchHandler();
+
   // call LCD Handler
   SEQ_UI_LCD_Handler();
 
@@ -821,12 +831,25 @@ void SEQ_TASK_MIDI(void)
 #if MEASURE_IDLE_CTR == 0
   MUTEX_MIDIOUT_TAKE;
 
+#if SEQ_STATISTICS_TIMING
+  u32 timestamp = SEQ_BPM_TICK_TIMESTAMP();
+#endif
+
   // execute sequencer handler
   SEQ_CORE_Handler();
 
+#if SEQ_STATISTICS_TIMING
+  timestamp = SEQ_STATISTICS_HandlerDurationAdd(SEQ_STATISTICS_HANDLER_CORE, timestamp);
+  SEQ_STATISTICS_QueueDepthAdd(seq_midi_out_allocated);
+#endif
+
   // send timestamped MIDI events
   SEQ_MIDI_OUT_Handler();
 
+#if SEQ_STATISTICS_TIMING
+  SEQ_STATISTICS_HandlerDurationAdd(SEQ_STATISTICS_HANDLER_MIDI_OUT, timestamp);
+#endif
+
 #if !defined(MIOS32_DONT_USE_AOUT)
   // update CV and gates
   SEQ_CV_Update();
@@ -98,7 +98,11 @@ typedef struct {
   u16  p_layer_size;  // size per parameter layer, e.g. 256 steps
   u16  t_layer_size;  // size per trigger layer (divided by 8, as each step has it's own bit)
   u8   cc[128];       // contains all CC parameters, prepared for 128
-} seq_file_b_track_t; // 156 bytes
+} seq_file_b_track_t; // 216 bytes
+
+// the header sizes are exported to seq_file_b.h, compilation fails here if they don't match
+typedef char seq_file_b_pattern_header_size_check[(sizeof(seq_file_b_pattern_t) == SEQ_FILE_B_PATTERN_HEADER_SIZE) ? 1 : -1];
+typedef char seq_file_b_track_header_size_check[(sizeof(seq_file_b_track_t) == SEQ_FILE_B_TRACK_HEADER_SIZE) ? 1 : -1];
 
 
 
@@ -127,6 +131,11 @@ static u8 cached_pattern_name[21];
 static u8 cached_bank;
 static u8 cached_pattern;
 
+// source of SEQ_FILE_B_PatternParse(): NULL: file, else RAM buffer
+static u8 *pattern_read_buffer;
+static u32 pattern_read_buffer_len;
+static u32 pattern_read_buffer_pos;
+
 
 /////////////////////////////////////////////////////////////////////////////
 // Initialisation
@@ -183,6 +192,9 @@ s32 SEQ_FILE_B_UnloadAllBanks(void)
   for(bank=0; bank<SEQ_FILE_B_NUM_BANKS; ++bank)
     seq_file_b_info[bank].valid = 0;
 
+  // cached patterns are not valid anymore
+  SEQ_PATTERN_CacheInvalidate(0xff, 0xff);
+
   return 0; // no error
 }
 
@@ -234,6 +246,7 @@ s32 SEQ_FILE_B_Create(char *session, u8 bank)
 
   seq_file_b_info_t *info = &seq_file_b_info[bank];
   info->valid = 0; // set to invalid as long as we are not sure if file can be accessed
+  SEQ_PATTERN_CacheInvalidate(bank, 0xff);
 
   char filepath[MAX_PATH];
   sprintf(filepath, "%s/%s/MBSEQ_B%d.V4", SEQ_FILE_SESSION_PATH, session, bank+1);
@@ -319,6 +332,7 @@ s32 SEQ_FILE_B_Open(char *session, u8 bank)
   seq_file_b_info_t *info = &seq_file_b_info[bank];
 
   info->valid = 0; // will be set to valid if bank header has been read successfully
+  SEQ_PATTERN_CacheInvalidate(bank, 0xff);
 
   char filepath[MAX_PATH];
   sprintf(filepath, "%s/%s/MBSEQ_B%d.V4", SEQ_FILE_SESSION_PATH, session, bank+1);
@@ -383,58 +397,77 @@ s32 SEQ_FILE_B_Open(char *session, u8 bank)
 
 
 /////////////////////////////////////////////////////////////////////////////
-// reads a pattern from bank into given group
-// returns < 0 on errors (error codes are documented in seq_file.h)
+// help functions for the pattern parser: read either from the bank file
+// or from a RAM buffer which has been filled by SEQ_FILE_B_PatternFetch()
 /////////////////////////////////////////////////////////////////////////////
-s32 SEQ_FILE_B_PatternRead(u8 bank, u8 pattern, u8 target_group, u16 remix_map)
+static s32 SEQ_FILE_B_PatternReadBuffer(u8 *buffer, u32 len)
 {
-  if( bank >= SEQ_FILE_B_NUM_BANKS )
-    return SEQ_FILE_B_ERR_INVALID_BANK;
+  if( !pattern_read_buffer )
+    return FILE_ReadBuffer(buffer, len);
 
-  if( target_group >= SEQ_CORE_NUM_GROUPS )
-    return SEQ_FILE_B_ERR_INVALID_GROUP;
+  if( (pattern_read_buffer_pos + len) > pattern_read_buffer_len )
+    return SEQ_FILE_B_ERR_READ;
 
-  seq_file_b_info_t *info = &seq_file_b_info[bank];
+  memcpy(buffer, &pattern_read_buffer[pattern_read_buffer_pos], len);
+  pattern_read_buffer_pos += len;
 
-  if( !info->valid )
-    return SEQ_FILE_B_ERR_NO_FILE;
+  return 0; // no error
+}
 
-  if( pattern >= info->header.num_patterns )
-    return SEQ_FILE_B_ERR_INVALID_PATTERN;
+static s32 SEQ_FILE_B_PatternReadByte(u8 *byte)
+{
+  return SEQ_FILE_B_PatternReadBuffer(byte, 1);
+}
 
-  // re-open file
-  if( FILE_ReadReOpen((file_t*)&info->file) < 0 )
-    return -1; // file cannot be re-opened
+static s32 SEQ_FILE_B_PatternReadHWord(u16 *hword)
+{
+  // ensure little endian coding
+  u8 tmp[2];
+  s32 status = SEQ_FILE_B_PatternReadBuffer(tmp, 2);
+  *hword = ((u16)tmp[0] << 0) | ((u16)tmp[1] << 8);
+  return status;
+}
 
-  // change to file position
-  s32 status;
-  u32 offset = 10 + sizeof(seq_file_b_header_t) + pattern * info->header.pattern_size;
-  if( (status=FILE_ReadSeek(offset)) < 0 ) {
-#if DEBUG_VERBOSE_LEVEL >= 1
-    DEBUG_MSG("[SEQ_FILE_B] failed to change pattern offset in file, status: %d\n", status);
-#endif
-    // close file (so that it can be re-opened)
-    FILE_ReadClose((file_t*)&info->file);
+static s32 SEQ_FILE_B_PatternReadSkip(u32 len)
+{
+  if( !pattern_read_buffer )
+    return FILE_ReadSeek(FILE_ReadGetCurrentPosition() + len);
+
+  if( (pattern_read_buffer_pos + len) > pattern_read_buffer_len )
     return SEQ_FILE_B_ERR_READ;
-  }
 
-  status |= FILE_ReadBuffer((u8 *)seq_pattern_name[target_group], 20);
+  pattern_read_buffer_pos += len;
+
+  return 0; // no error
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// parses a pattern and takes it over into the given group
+// the source has to be selected via pattern_read_buffer before
+// returns < 0 on errors
+/////////////////////////////////////////////////////////////////////////////
+static s32 SEQ_FILE_B_PatternParse(u8 target_group, u16 remix_map)
+{
+  s32 status = 0;
+
+  status |= SEQ_FILE_B_PatternReadBuffer((u8 *)seq_pattern_name[target_group], 20);
   seq_pattern_name[target_group][20] = 0;
 
   u8 num_tracks;
-  status |= FILE_ReadByte(&num_tracks);
+  status |= SEQ_FILE_B_PatternReadByte(&num_tracks);
 
   u8 mixer_map;
-  status |= FILE_ReadByte(&mixer_map);
+  status |= SEQ_FILE_B_PatternReadByte(&mixer_map);
 
   u8 sysex_setup;
-  status |= FILE_ReadByte(&sysex_setup);
+  status |= SEQ_FILE_B_PatternReadByte(&sysex_setup);
 
   u8 reserved;
-  status |= FILE_ReadByte(&reserved);
+  status |= SEQ_FILE_B_PatternReadByte(&reserved);
 
 #if DEBUG_VERBOSE_LEVEL >= 1
-  DEBUG_MSG("[SEQ_FILE_B] read pattern B%d:P%d '%s', %d tracks\n", bank+1, pattern, seq_pattern_name[target_group], num_tracks);
+  DEBUG_MSG("[SEQ_FILE_B] read pattern '%s', %d tracks\n", seq_pattern_name[target_group], num_tracks);
 #endif
 
   // reduce number of tracks if required
@@ -452,66 +485,61 @@ s32 SEQ_FILE_B_PatternRead(u8 bank, u8 pattern, u8 target_group, u16 remix_map)
 
 DEBUG_MSG("Skipping Track %d\n", track);
       u8 dummy_name[80];
-      status |= FILE_ReadBuffer(dummy_name, 80); // dummy! don't take over track name
+      status |= SEQ_FILE_B_PatternReadBuffer(dummy_name, 80); // dummy! don't take over track name
 
       u8 num_p_instruments;
-      status |= FILE_ReadByte(&num_p_instruments);
+      status |= SEQ_FILE_B_PatternReadByte(&num_p_instruments);
 
       u8 num_t_instruments;
-      status |= FILE_ReadByte(&num_t_instruments);
+      status |= SEQ_FILE_B_PatternReadByte(&num_t_instruments);
 
       u8 num_p_layers;
-      status |= FILE_ReadByte(&num_p_layers);
+      status |= SEQ_FILE_B_PatternReadByte(&num_p_layers);
 
       u8 num_t_layers;
-      status |= FILE_ReadByte(&num_t_layers);
+      status |= SEQ_FILE_B_PatternReadByte(&num_t_layers);
 
       u16 p_layer_size;
-      status |= FILE_ReadHWord(&p_layer_size);
+      status |= SEQ_FILE_B_PatternReadHWord(&p_layer_size);
 
       u16 t_layer_size;
-      status |= FILE_ReadHWord(&t_layer_size);
+      status |= SEQ_FILE_B_PatternReadHWord(&t_layer_size);
 
       // skip CC and Par/Trg layer
       u32 par_size = num_p_instruments * num_p_layers * p_layer_size;
       u32 trg_size = num_t_instruments * num_t_layers * t_layer_size;
-      u32 new_pos = FILE_ReadGetCurrentPosition() + 128 + par_size + trg_size;
- DEBUG_MSG("Pos change: %d -> %d\n", FILE_ReadGetCurrentPosition(), new_pos);
-      if( (status=FILE_ReadSeek(new_pos)) < 0 ) {
+      if( (status=SEQ_FILE_B_PatternReadSkip(128 + par_size + trg_size)) < 0 ) {
 #if DEBUG_VERBOSE_LEVEL >= 1
 	DEBUG_MSG("[SEQ_FILE_B] failed to change pattern offset in file, status: %d\n", status);
 #endif
-	// close file (so that it can be re-opened)
-	FILE_ReadClose((file_t*)&info->file);
 	return SEQ_FILE_B_ERR_READ;
       }
- DEBUG_MSG("New pos: %d\n", FILE_ReadGetCurrentPosition());
 
     } else {
 			
-      status |= FILE_ReadBuffer((u8 *)seq_core_trk[track].name, 80);
+      status |= SEQ_FILE_B_PatternReadBuffer((u8 *)seq_core_trk[track].name, 80);
       seq_core_trk[track].name[80] = 0;
 
       u8 num_p_instruments;
-      status |= FILE_ReadByte(&num_p_instruments);
+      status |= SEQ_FILE_B_PatternReadByte(&num_p_instruments);
 
       u8 num_t_instruments;
-      status |= FILE_ReadByte(&num_t_instruments);
+      status |= SEQ_FILE_B_PatternReadByte(&num_t_instruments);
 
       u8 num_p_layers;
-      status |= FILE_ReadByte(&num_p_layers);
+      status |= SEQ_FILE_B_PatternReadByte(&num_p_layers);
 
       u8 num_t_layers;
-      status |= FILE_ReadByte(&num_t_layers);
+      status |= SEQ_FILE_B_PatternReadByte(&num_t_layers);
 
       u16 p_layer_size;
-      status |= FILE_ReadHWord(&p_layer_size);
+      status |= SEQ_FILE_B_PatternReadHWord(&p_layer_size);
 
       u16 t_layer_size;
-      status |= FILE_ReadHWord(&t_layer_size);
+      status |= SEQ_FILE_B_PatternReadHWord(&t_layer_size);
 
       u8 cc_buffer[128];
-      status |= FILE_ReadBuffer(cc_buffer, 128);
+      status |= SEQ_FILE_B_PatternReadBuffer(cc_buffer, 128);
     
       // before changing CCs: we should stop here on error if read failed
       if( status < 0 ) {
@@ -541,14 +569,11 @@ DEBUG_MSG("Skipping Track %d\n", track);
       u32 par_size = num_p_instruments * num_p_layers * p_layer_size;
       u32 par_size_taken = (par_size > SEQ_PAR_MAX_BYTES) ? SEQ_PAR_MAX_BYTES : par_size;
       if( par_size_taken )
-	FILE_ReadBuffer((u8 *)&seq_par_layer_value[track], par_size_taken);
+	SEQ_FILE_B_PatternReadBuffer((u8 *)&seq_par_layer_value[track], par_size_taken);
 
-      // read remaining bytes into dummy buffer
-      while( par_size > par_size_taken ) {
-	u8 dummy;
-	FILE_ReadByte(&dummy);
-	++par_size_taken;
-      }
+      // skip remaining bytes
+      if( par_size > par_size_taken )
+	SEQ_FILE_B_PatternReadSkip(par_size - par_size_taken);
 
       // partitionate trigger layer and clear all steps
       SEQ_TRG_TrackInit(track, t_layer_size*8, num_t_layers, num_t_instruments);
@@ -557,14 +582,11 @@ DEBUG_MSG("Skipping Track %d\n", track);
       u32 trg_size = num_t_instruments * num_t_layers * t_layer_size;
       u32 trg_size_taken = (trg_size > SEQ_TRG_MAX_BYTES) ? SEQ_TRG_MAX_BYTES : trg_size;
       if( trg_size_taken )
-	FILE_ReadBuffer((u8 *)&seq_trg_layer_value[track], trg_size_taken);
+	SEQ_FILE_B_PatternReadBuffer((u8 *)&seq_trg_layer_value[track], trg_size_taken);
 
-      // read remaining bytes into dummy buffer
-      while( trg_size > trg_size_taken ) {
-	u8 dummy;
-	FILE_ReadByte(&dummy);
-	++trg_size_taken;
-      }
+      // skip remaining bytes
+      if( trg_size > trg_size_taken )
+	SEQ_FILE_B_PatternReadSkip(trg_size - trg_size_taken);
 
       // finally update CC links again, because some of them depend on SEQ_PAR_NumLayersGet()!!!
       SEQ_CC_LinkUpdate(track);
@@ -572,6 +594,53 @@ DEBUG_MSG("Skipping Track %d\n", track);
     }
   }
 
+  return status;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// reads a pattern from bank into given group
+// returns < 0 on errors (error codes are documented in seq_file.h)
+/////////////////////////////////////////////////////////////////////////////
+s32 SEQ_FILE_B_PatternRead(u8 bank, u8 pattern, u8 target_group, u16 remix_map)
+{
+  if( bank >= SEQ_FILE_B_NUM_BANKS )
+    return SEQ_FILE_B_ERR_INVALID_BANK;
+
+  if( target_group >= SEQ_CORE_NUM_GROUPS )
+    return SEQ_FILE_B_ERR_INVALID_GROUP;
+
+  seq_file_b_info_t *info = &seq_file_b_info[bank];
+
+  if( !info->valid )
+    return SEQ_FILE_B_ERR_NO_FILE;
+
+  if( pattern >= info->header.num_patterns )
+    return SEQ_FILE_B_ERR_INVALID_PATTERN;
+
+  // re-open file
+  if( FILE_ReadReOpen((file_t*)&info->file) < 0 )
+    return -1; // file cannot be re-opened
+
+  // change to file position
+  s32 status;
+  u32 offset = 10 + sizeof(seq_file_b_header_t) + pattern * info->header.pattern_size;
+  if( (status=FILE_ReadSeek(offset)) < 0 ) {
+#if DEBUG_VERBOSE_LEVEL >= 1
+    DEBUG_MSG("[SEQ_FILE_B] failed to change pattern offset in file, status: %d\n", status);
+#endif
+    // close file (so that it can be re-opened)
+    FILE_ReadClose((file_t*)&info->file);
+    return SEQ_FILE_B_ERR_READ;
+  }
+
+  // read from file
+  // (previous source is restored, since a higher prio task could interrupt SEQ_FILE_B_PatternReadFromBuffer())
+  u8 *prev_read_buffer = pattern_read_buffer;
+  pattern_read_buffer = NULL;
+  status = SEQ_FILE_B_PatternParse(target_group, remix_map);
+  pattern_read_buffer = prev_read_buffer;
+
   // close file (so that it can be re-opened)
   FILE_ReadClose((file_t*)&info->file);
 
@@ -586,6 +655,85 @@ DEBUG_MSG("Skipping Track %d\n", track);
 }
 
 
+/////////////////////////////////////////////////////////////////////////////
+// reads the raw data of a pattern into a RAM buffer, so that it can be
+// taken over later with SEQ_FILE_B_PatternReadFromBuffer() without SD Card access
+// returns < 0 on errors (error codes are documented in seq_file.h)
+// returns number of read bytes on success
+/////////////////////////////////////////////////////////////////////////////
+s32 SEQ_FILE_B_PatternFetch(u8 bank, u8 pattern, u8 *buffer, u32 buffer_size)
+{
+  if( bank >= SEQ_FILE_B_NUM_BANKS )
+    return SEQ_FILE_B_ERR_INVALID_BANK;
+
+  seq_file_b_info_t *info = &seq_file_b_info[bank];
+
+  if( !info->valid )
+    return SEQ_FILE_B_ERR_NO_FILE;
+
+  if( pattern >= info->header.num_patterns )
+    return SEQ_FILE_B_ERR_INVALID_PATTERN;
+
+  if( info->header.pattern_size > buffer_size )
+    return SEQ_FILE_B_ERR_P_TOO_LARGE;
+
+  // re-open file
+  if( FILE_ReadReOpen((file_t*)&info->file) < 0 )
+    return -1; // file cannot be re-opened
+
+  // change to file position
+  s32 status;
+  u32 offset = 10 + sizeof(seq_file_b_header_t) + pattern * info->header.pattern_size;
+  if( (status=FILE_ReadSeek(offset)) >= 0 )
+    status = FILE_ReadBuffer(buffer, info->header.pattern_size);
+
+  // close file (so that it can be re-opened)
+  FILE_ReadClose((file_t*)&info->file);
+
+  if( status < 0 ) {
+#if DEBUG_VERBOSE_LEVEL >= 1
+    DEBUG_MSG("[SEQ_FILE_B] error while fetching pattern, status: %d\n", status);
+#endif
+    return SEQ_FILE_B_ERR_READ;
+  }
+
+  return info->header.pattern_size;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// takes over a pattern which has been read by SEQ_FILE_B_PatternFetch() into given group
+// returns < 0 on errors (error codes are documented in seq_file.h)
+/////////////////////////////////////////////////////////////////////////////
+s32 SEQ_FILE_B_PatternReadFromBuffer(u8 *buffer, u32 len, u8 target_group, u16 remix_map)
+{
+  if( target_group >= SEQ_CORE_NUM_GROUPS )
+    return SEQ_FILE_B_ERR_INVALID_GROUP;
+
+  // read from RAM buffer
+  // (previous source is restored, since this function could interrupt another read operation)
+  u8 *prev_read_buffer = pattern_read_buffer;
+  u32 prev_read_buffer_len = pattern_read_buffer_len;
+  u32 prev_read_buffer_pos = pattern_read_buffer_pos;
+  pattern_read_buffer = buffer;
+  pattern_read_buffer_len = len;
+  pattern_read_buffer_pos = 0;
+  s32 status = SEQ_FILE_B_PatternParse(target_group, remix_map);
+  pattern_read_buffer = prev_read_buffer;
+  pattern_read_buffer_len = prev_read_buffer_len;
+  pattern_read_buffer_pos = prev_read_buffer_pos;
+
+  if( status < 0 ) {
+#if DEBUG_VERBOSE_LEVEL >= 1
+    DEBUG_MSG("[SEQ_FILE_B] error while reading pattern from buffer, status: %d\n", status);
+#endif
+    return SEQ_FILE_B_ERR_READ;
+  }
+
+  return 0; // no error
+}
+
+
 /////////////////////////////////////////////////////////////////////////////
 // writes a pattern of a given group into bank
 // returns < 0 on errors (error codes are documented in seq_file.h)
@@ -603,6 +751,9 @@ s32 SEQ_FILE_B_PatternWrite(char *session, u8 bank, u8 pattern, u8 source_group,
   if( !info->valid )
     return SEQ_FILE_B_ERR_FORMAT;
 
+  // pattern will be overwritten: cached copy is not valid anymore
+  SEQ_PATTERN_CacheInvalidate(bank, pattern);
+
   if( pattern >= info->header.num_patterns )
     return SEQ_FILE_B_ERR_INVALID_PATTERN;
 
@@ -21,6 +21,15 @@
 
 #define SEQ_FILE_B_NUM_BANKS 4
 
+// sizes of the pattern and track headers in a bank file (see seq_file_b.c)
+#define SEQ_FILE_B_PATTERN_HEADER_SIZE 24
+#define SEQ_FILE_B_TRACK_HEADER_SIZE   216
+
+// size of a pattern with SEQ_PAR_MAX_BYTES parameter and SEQ_TRG_MAX_BYTES trigger bytes per track
+// (this is also the pattern size of the default bank format)
+#define SEQ_FILE_B_PATTERN_SIZE(num_tracks, par_bytes, trg_bytes) \
+  (SEQ_FILE_B_PATTERN_HEADER_SIZE + (num_tracks) * (SEQ_FILE_B_TRACK_HEADER_SIZE + (par_bytes) + (trg_bytes)))
+
 
 /////////////////////////////////////////////////////////////////////////////
 // Global Types
@@ -42,6 +51,8 @@ extern s32 SEQ_FILE_B_Create(char *session, u8 bank);
 extern s32 SEQ_FILE_B_Open(char *session, u8 bank);
 
 extern s32 SEQ_FILE_B_PatternRead(u8 bank, u8 pattern, u8 target_group,  u16 remix_map);
+extern s32 SEQ_FILE_B_PatternFetch(u8 bank, u8 pattern, u8 *buffer, u32 buffer_size);
+extern s32 SEQ_FILE_B_PatternReadFromBuffer(u8 *buffer, u32 len, u8 target_group, u16 remix_map);
 extern s32 SEQ_FILE_B_PatternWrite(char *session, u8 bank, u8 pattern, u8 source_group, u8 rename_if_empty_name);
 
 extern s32 SEQ_FILE_B_PatternPeekName(u8 bank, u8 pattern, u8 non_cached, char *pattern_name);
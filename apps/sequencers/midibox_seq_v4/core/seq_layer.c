@@ -595,6 +595,10 @@ s32 SEQ_LAYER_GetEvents(u8 track, u16 step, seq_layer_evnt_t layer_events[16], u
     u8 instrument = 0;
     int par_layer;
 
+    // fetch all parameter layers of the step at once
+    u8 par_values[SEQ_PAR_MAX_LAYERS];
+    u8 num_p_layers = SEQ_PAR_StepGet(track, step, instrument, par_values);
+
     // get velocity and length from first parameter layer which holds it
     // if not assigned, we will get back a default value
     
@@ -603,7 +607,7 @@ s32 SEQ_LAYER_GetEvents(u8 track, u16 step, seq_layer_evnt_t layer_events[16], u
     if( tcc->event_mode != SEQ_EVENT_MODE_Combined ) {
       if( (par_layer=tcc->link_par_layer_velocity) >= 0 ) {
 	if( insert_empty_notes || !(layer_muted & (1 << par_layer)) ) {
-	  velocity = SEQ_PAR_Get(track, step, par_layer, instrument);
+	  velocity = par_values[par_layer];
 	  if( !insert_empty_notes && !gate )
 	    velocity = 0;
 	} else {
@@ -623,7 +627,7 @@ s32 SEQ_LAYER_GetEvents(u8 track, u16 step, seq_layer_evnt_t layer_events[16], u
     if( tcc->event_mode != SEQ_EVENT_MODE_Combined ) {
       if( (par_layer=tcc->link_par_layer_length) >= 0 ) {
 	if( (insert_empty_notes || !(layer_muted & (1 << par_layer))) ) {
-	  length = SEQ_PAR_Get(track, step, par_layer, instrument) + 1;
+	  length = par_values[par_layer] + 1;
 	  if( length > 96 )
 	    length = 96;
 	}
@@ -658,8 +662,8 @@ s32 SEQ_LAYER_GetEvents(u8 track, u16 step, seq_layer_evnt_t layer_events[16], u
     }
 
     // go through all layers to generate events
+    // (num_p_layers is limited to SEQ_PAR_MAX_LAYERS by SEQ_PAR_StepGet())
     u8 *layer_type_ptr = (u8 *)&tcc->lay_const[0*16];
-    u8 num_p_layers = SEQ_PAR_NumLayersGet(track);
     for(par_layer=0; par_layer<num_p_layers; ++par_layer, ++layer_type_ptr) {
 
       // usually no function assigned to layer - skip it immediately to speed up the loop
@@ -672,7 +676,7 @@ s32 SEQ_LAYER_GetEvents(u8 track, u16 step, seq_layer_evnt_t layer_events[16], u
         case SEQ_PAR_Type_Note: {
 	  seq_layer_evnt_t *e = &layer_events[num_events];
 	  mios32_midi_package_t *p = &e->midi_package;
-	  u8 note = SEQ_PAR_Get(track, step, par_layer, instrument);
+	  u8 note = par_values[par_layer];
 
 	  if( tcc->event_mode == SEQ_EVENT_MODE_Combined ) {
 	    if( (track&7) == 1 || (track&7) == 2)
@@ -714,7 +718,7 @@ s32 SEQ_LAYER_GetEvents(u8 track, u16 step, seq_layer_evnt_t layer_events[16], u
         case SEQ_PAR_Type_Chord1:
         case SEQ_PAR_Type_Chord2:
         case SEQ_PAR_Type_Chord3: {
-	  u8 chord_value = SEQ_PAR_Get(track, step, par_layer, instrument);
+	  u8 chord_value = par_values[par_layer];
 	  int i;
 
 	  if( tcc->event_mode == SEQ_EVENT_MODE_Combined ) {
@@ -778,7 +782,7 @@ s32 SEQ_LAYER_GetEvents(u8 track, u16 step, seq_layer_evnt_t layer_events[16], u
 	  seq_layer_evnt_t *e = &layer_events[num_events];
 	  mios32_midi_package_t *p = &e->midi_package;
 	  u8 cc_number = tcc->lay_const[1*16 + par_layer];
-	  u8 value = SEQ_PAR_Get(track, step, par_layer, instrument);
+	  u8 value = par_values[par_layer];
 
 	  if( !insert_empty_notes ) {
 	    // new: don't send CC if assigned to invalid CC number
@@ -823,7 +827,7 @@ s32 SEQ_LAYER_GetEvents(u8 track, u16 step, seq_layer_evnt_t layer_events[16], u
 
         case SEQ_PAR_Type_Ctrl: {
 	  u8 cc_number = tcc->lay_const[1*16 + par_layer];
-	  u8 value = SEQ_PAR_Get(track, step, par_layer, instrument);
+	  u8 value = par_values[par_layer];
 
 	  if( !insert_empty_notes ) {
 	    // new: don't send CC if assigned to invalid CC number
@@ -849,7 +853,7 @@ s32 SEQ_LAYER_GetEvents(u8 track, u16 step, seq_layer_evnt_t layer_events[16], u
         case SEQ_PAR_Type_PitchBend: {
 	  seq_layer_evnt_t *e = &layer_events[num_events];
 	  mios32_midi_package_t *p = &e->midi_package;
-	  u8 value = SEQ_PAR_Get(track, step, par_layer, instrument);
+	  u8 value = par_values[par_layer];
 
 	  // don't send pitchbender if value hasn't changed
 	  if( !insert_empty_notes ) {
@@ -886,7 +890,7 @@ s32 SEQ_LAYER_GetEvents(u8 track, u16 step, seq_layer_evnt_t layer_events[16], u
         case SEQ_PAR_Type_ProgramChange: {
 	  seq_layer_evnt_t *e = &layer_events[num_events];
 	  mios32_midi_package_t *p = &e->midi_package;
-	  u8 value = SEQ_PAR_Get(track, step, par_layer, instrument);
+	  u8 value = par_values[par_layer];
 
 	  // don't send program change if value hasn't changed
 	  if( !insert_empty_notes ) {
@@ -920,7 +924,7 @@ s32 SEQ_LAYER_GetEvents(u8 track, u16 step, seq_layer_evnt_t layer_events[16], u
         case SEQ_PAR_Type_Aftertouch: {
 	  seq_layer_evnt_t *e = &layer_events[num_events];
 	  mios32_midi_package_t *p = &e->midi_package;
-	  u8 value = SEQ_PAR_Get(track, step, par_layer, instrument);
+	  u8 value = par_values[par_layer];
 
 	  // don't send aftertouch if value hasn't changed
 	  if( !insert_empty_notes ) {
@@ -44,6 +44,18 @@
 #define DEBUG_VERBOSE_LEVEL 0
 
 
+/////////////////////////////////////////////////////////////////////////////
+// Local defines
+/////////////////////////////////////////////////////////////////////////////
+
+// the output is collected in a buffer and written in blocks which are
+// aligned to the SD Card sectors
+#define EXPORT_BUFFER_SIZE 512
+
+// number of UI progress updates per track
+#define EXPORT_PROGRESS_STEPS 8
+
+
 /////////////////////////////////////////////////////////////////////////////
 // Local variables
 /////////////////////////////////////////////////////////////////////////////
@@ -54,6 +66,11 @@ static u8 export_steps_per_measure;
 
 static s8 export_track;
 
+static u8 export_buffer[EXPORT_BUFFER_SIZE];
+static u16 export_buffer_len;
+static u16 export_buffer_limit; // number of bytes until the next sector boundary
+static s32 export_file_status;
+
 /////////////////////////////////////////////////////////////////////////////
 // Initialisation
 /////////////////////////////////////////////////////////////////////////////
@@ -114,23 +131,45 @@ s32 SEQ_MIDEXP_ExportStepsPerMeasureSet(u8 steps_per_measure)
 /////////////////////////////////////////////////////////////////////////////
 // help functions
 /////////////////////////////////////////////////////////////////////////////
+
+// writes the buffered bytes into the file
+static s32 SEQ_MIDEXP_Flush(void)
+{
+  if( export_buffer_len ) {
+    export_file_status |= FILE_WriteBuffer(export_buffer, export_buffer_len);
+    export_buffer_len = 0;
+  }
+
+  // next flush at sector boundary
+  export_buffer_limit = EXPORT_BUFFER_SIZE - (FILE_WriteGetCurrentPosition() % EXPORT_BUFFER_SIZE);
+
+  return export_file_status;
+}
+
+static s32 SEQ_MIDEXP_WriteByte(u8 byte)
+{
+  export_buffer[export_buffer_len++] = byte;
+  if( export_buffer_len >= export_buffer_limit )
+    SEQ_MIDEXP_Flush();
+
+  return 0; // no error
+}
+
 static s32 SEQ_MIDEXP_WriteWord(u32 word, u8 len)
 {
   int i;
-  s32 status = 0;
 
   // ensure big endian coding, therefore byte writes
   for(i=0; i<len; ++i)
-    status |= FILE_WriteByte((u8)(word >> (8*(len-1-i))));
+    SEQ_MIDEXP_WriteByte((u8)(word >> (8*(len-1-i))));
 
-  return (status < 0) ? status : len;
+  return len;
 }
 
 
 static s32 SEQ_MIDEXP_WriteVarLen(u32 value)
 {
   // based on code example from MIDI file spec
-  s32 status = 0;
   u32 buffer;
 
   buffer = value & 0x7f;
@@ -142,14 +181,23 @@ static s32 SEQ_MIDEXP_WriteVarLen(u32 value)
   int num_bytes = 0;
   while( 1 ) {
     ++num_bytes;
-    status |= FILE_WriteByte((u8)(buffer & 0xff));
+    SEQ_MIDEXP_WriteByte((u8)(buffer & 0xff));
     if( buffer & 0x80 )
       buffer >>= 8;
     else
       break;
   }
 
-  return (status < 0) ? status : num_bytes;
+  return num_bytes;
+}
+
+static s32 SEQ_MIDEXP_WriteString(char *str, u32 len)
+{
+  u32 i;
+  for(i=0; i<len; ++i)
+    SEQ_MIDEXP_WriteByte((u8)str[i]);
+
+  return len;
 }
 
 
@@ -281,20 +329,24 @@ s32 SEQ_MIDEXP_GenerateFile(char *path)
     goto error;
   }
 
+  // the file is kept open during the whole export, output is buffered
+  export_buffer_len = 0;
+  export_file_status = 0;
+  SEQ_MIDEXP_Flush();
+
   // write file header
   u32 header_size = 6;
-  status |= FILE_WriteBuffer((u8*)"MThd", 4);
-  status |= SEQ_MIDEXP_WriteWord(header_size, 4);
-  status |= SEQ_MIDEXP_WriteWord(1, 2); // MIDI File Format
-  status |= SEQ_MIDEXP_WriteWord(last_track-first_track+1, 2); // Number of Tracks
-  status |= SEQ_MIDEXP_WriteWord(ppqn, 2); // PPQN
-  status |= FILE_WriteClose();
+  SEQ_MIDEXP_WriteString("MThd", 4);
+  SEQ_MIDEXP_WriteWord(header_size, 4);
+  SEQ_MIDEXP_WriteWord(1, 2); // MIDI File Format
+  SEQ_MIDEXP_WriteWord(last_track-first_track+1, 2); // Number of Tracks
+  SEQ_MIDEXP_WriteWord(ppqn, 2); // PPQN
 
   // check file status
-  if( status < 0 ) {
+  if( SEQ_MIDEXP_Flush() < 0 ) {
     // File Access Error
     status = -2;
-    goto error;
+    goto error_close;
   }
 
 
@@ -313,61 +365,38 @@ s32 SEQ_MIDEXP_GenerateFile(char *path)
   // select song mode if required
   SEQ_SONG_ActiveSet(seq_midexp_mode == SEQ_MIDEXP_MODE_Song);
 
+  // progress will be displayed in steps of 1/EXPORT_PROGRESS_STEPS of a track
+  u32 progress_ticks = number_ticks / EXPORT_PROGRESS_STEPS;
+  if( !progress_ticks )
+    progress_ticks = 1;
+  u32 total_ticks = (last_track-first_track+1) * number_ticks;
+
   // generate events track by track
   for(export_track=first_track; export_track<=last_track; ++export_track) {
 
-    // print message on screen
-    char str_buffer[21];
-    sprintf(str_buffer, "Exporting G%dT%d to",
-	    (export_track / SEQ_CORE_NUM_TRACKS_PER_GROUP) + 1,
-	    (export_track % SEQ_CORE_NUM_TRACKS_PER_GROUP) + 1);
-
-    SEQ_UI_Msg(SEQ_UI_MSG_USER_R, 2000, str_buffer, path);
-
-#ifndef MIOS32_FAMILY_EMULATION
-    // workaround: give UI some time to update screen!
-    // background: buttons have higher priority than LCD output, especially with MUTEX_MIDI_OUT the priority
-    // will be even higher, so that the LCD update task is starving.
-    // waiting for some mS ensures that the other tasks are serviced.
-    vTaskDelay(100 / portTICK_RATE_MS);
-#endif
-
     // reset sequencer
     SEQ_SONG_Reset(0);
     SEQ_CORE_Reset(0);
 
-    // open file again
-    if( (status=FILE_WriteOpen(path, 0)) < 0 ) {
-#if DEBUG_VERBOSE_LEVEL >= 1
-      DEBUG_MSG("[SEQ_MIDEXP_WriteFile] Failed to open %s again, status: %d\n", path, status);
-#endif
-      status = -3; // file re-open error
-      goto error;
-    }
-
     // write Track header
-    u32 track_header_filepos = FILE_WriteGetCurrentSize();
-    status |= FILE_WriteSeek(track_header_filepos);
+    u32 track_header_filepos = FILE_WriteGetCurrentPosition() + export_buffer_len;
     export_trk_size = 0;
     export_trk_tick = 0;
-    status |= FILE_WriteBuffer((u8*)"MTrk", 4);
-    status |= SEQ_MIDEXP_WriteWord(export_trk_size, 4); // Placeholder
+    SEQ_MIDEXP_WriteString("MTrk", 4);
+    SEQ_MIDEXP_WriteWord(export_trk_size, 4); // Placeholder
 
     // add track name as meta event
     {
       char buffer[20];
 
       export_trk_size += SEQ_MIDEXP_WriteVarLen(0);
-      buffer[0] = 0xff; // Meta
-      export_trk_size += SEQ_MIDEXP_WriteWord(buffer[0], 1);
-      buffer[0] = 0x03; // Sequence/Track Name
-      export_trk_size += SEQ_MIDEXP_WriteWord(buffer[0], 1);
+      export_trk_size += SEQ_MIDEXP_WriteWord(0xff, 1); // Meta
+      export_trk_size += SEQ_MIDEXP_WriteWord(0x03, 1); // Sequence/Track Name
       export_trk_size += SEQ_MIDEXP_WriteVarLen(4); // String Length (4 chars)
       sprintf(buffer, "G%dT%d",
 	      (export_track / SEQ_CORE_NUM_TRACKS_PER_GROUP) + 1,
 	      (export_track % SEQ_CORE_NUM_TRACKS_PER_GROUP) + 1);
-      status |= FILE_WriteBuffer((u8*)buffer, 4);
-      export_trk_size += 4;
+      export_trk_size += SEQ_MIDEXP_WriteString(buffer, 4);
     }
 
 #if DEBUG_VERBOSE_LEVEL >= 1
@@ -375,11 +404,30 @@ s32 SEQ_MIDEXP_GenerateFile(char *path)
     DEBUG_MSG("[SEQ_MIDEXP_WriteFile] generating track G%dT%d at filepos %d\n",
 	      (export_track / SEQ_CORE_NUM_TRACKS_PER_GROUP) + 1,
 	      (export_track % SEQ_CORE_NUM_TRACKS_PER_GROUP) + 1,
-	      track_header_filepos - 4);
+	      track_header_filepos);
 #endif
 
     // start export of selected track
     for(export_tick=0; export_tick < number_ticks; ++export_tick) {
+      // print progress on screen
+      if( (export_tick % progress_ticks) == 0 ) {
+	u32 ticks_done = (export_track-first_track) * number_ticks + export_tick;
+	char str_buffer[32]; // (SEQ_UI_Msg() limits the line to the display width)
+	snprintf(str_buffer, sizeof(str_buffer), "Export G%dT%d %3d%% to",
+		(export_track / SEQ_CORE_NUM_TRACKS_PER_GROUP) + 1,
+		(export_track % SEQ_CORE_NUM_TRACKS_PER_GROUP) + 1,
+		(int)(((unsigned long long)ticks_done * 100) / total_ticks));
+	SEQ_UI_Msg(SEQ_UI_MSG_USER_R, 2000, str_buffer, path);
+
+#ifndef MIOS32_FAMILY_EMULATION
+	// workaround: give UI some time to update screen!
+	// background: buttons have higher priority than LCD output, especially with MUTEX_MIDI_OUT the priority
+	// will be even higher, so that the LCD update task is starving.
+	// waiting for some mS ensures that the other tasks are serviced.
+	vTaskDelay(((export_track == first_track && export_tick == 0) ? 100 : 10) / portTICK_RATE_MS);
+#endif
+      }
+
       // propagate tick
       SEQ_CORE_Tick(export_tick, export_track, 0);
 
@@ -396,24 +444,40 @@ s32 SEQ_MIDEXP_GenerateFile(char *path)
       SEQ_MIDI_OUT_Handler();
     }
 
-    // close file
-    status |= FILE_WriteClose();
+    // write remaining bytes of the track
+    SEQ_MIDEXP_Flush();
 
     if( export_trk_size ) {
       // switch back to first byte of track and write final track size
-      if( (status=FILE_WriteOpen(path, 0)) < 0 ) {
+      u32 end_filepos = FILE_WriteGetCurrentPosition();
+      u8 size_buffer[4];
+      size_buffer[0] = (u8)(export_trk_size >> 24);
+      size_buffer[1] = (u8)(export_trk_size >> 16);
+      size_buffer[2] = (u8)(export_trk_size >> 8);
+      size_buffer[3] = (u8)(export_trk_size >> 0);
+      export_file_status |= FILE_WriteSeek(track_header_filepos + 4);
+      export_file_status |= FILE_WriteBuffer(size_buffer, 4);
+      export_file_status |= FILE_WriteSeek(end_filepos);
+    }
+
+    if( export_file_status < 0 ) {
 #if DEBUG_VERBOSE_LEVEL >= 1
-	DEBUG_MSG("[SEQ_MIDEXP_WriteFile] Failed to open %s again, status: %d\n", path, status);
+      DEBUG_MSG("[SEQ_MIDEXP_WriteFile] Failed to write track into %s, status: %d\n", path, export_file_status);
 #endif
-	status = -3; // file re-open error
-	goto error;
-      }
-      status |= FILE_WriteSeek(track_header_filepos + 4);
-      status |= SEQ_MIDEXP_WriteWord(export_trk_size, 4);
-      status |= FILE_WriteClose();
+      status = -3; // file write error
+      goto error_close;
     }
   }
 
+error_close:
+  // the last sector is written while closing the file
+  if( FILE_WriteClose() < 0 && status >= 0 ) {
+#if DEBUG_VERBOSE_LEVEL >= 1
+    DEBUG_MSG("[SEQ_MIDEXP_WriteFile] Failed to close %s\n", path);
+#endif
+    status = -3; // file write error
+  }
+
 error:
   // MIDI scheduler: restore default MIDI/BPM handlers
   SEQ_MIDI_OUT_Callback_MIDI_SendPackage_Set(NULL);
@@ -432,5 +496,5 @@ error:
   MUTEX_MIDIOUT_GIVE;
   MUTEX_SDCARD_GIVE;
 
-  return 0; // no error
+  return status;
 }
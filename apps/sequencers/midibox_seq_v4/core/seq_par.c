@@ -42,6 +42,7 @@ u8 AHB_SECTION seq_par_layer_value[SEQ_CORE_NUM_TRACKS][SEQ_PAR_MAX_BYTES];
 static u16 par_layer_num_steps[SEQ_CORE_NUM_TRACKS];
 static u8 par_layer_num_layers[SEQ_CORE_NUM_TRACKS];
 static u8 par_layer_num_instruments[SEQ_CORE_NUM_TRACKS];
+static u16 par_layer_instrument_size[SEQ_CORE_NUM_TRACKS]; // layers * steps, precalculated in SEQ_PAR_TrackInit()
 
 static const char seq_par_type_names[SEQ_PAR_NUM_TYPES][6] = {
   "None ", // 0
@@ -175,6 +176,7 @@ s32 SEQ_PAR_TrackInit(u8 track, u16 steps, u8 par_layers, u8 instruments)
   par_layer_num_layers[track] = par_layers;
   par_layer_num_steps[track] = steps;
   par_layer_num_instruments[track] = instruments;
+  par_layer_instrument_size[track] = par_layers * steps;
 
   // init parameter layer values
   memset((u8 *)&seq_par_layer_value[track], 0, SEQ_PAR_MAX_BYTES);
@@ -241,7 +243,7 @@ s32 SEQ_PAR_Set(u8 track, u16 step, u8 par_layer, u8 par_instrument, u8 value)
   // modulo of num_p_steps to allow mirroring of parameter layer in drum mode
   step %= num_p_steps;
 
-  u16 step_ix = (par_instrument * num_p_layers * num_p_steps) + (par_layer * num_p_steps) + step;
+  u16 step_ix = (par_instrument * par_layer_instrument_size[track]) + (par_layer * num_p_steps) + step;
   if( step_ix >= SEQ_PAR_MAX_BYTES )
     return -4; // invalid step position
 
@@ -257,13 +259,12 @@ s32 SEQ_PAR_Set(u8 track, u16 step, u8 par_layer, u8 par_instrument, u8 value)
 /////////////////////////////////////////////////////////////////////////////
 s32 SEQ_PAR_Get(u8 track, u16 step, u8 par_layer, u8 par_instrument)
 {
-  u8 num_p_layers = par_layer_num_layers[track];
   u16 num_p_steps = par_layer_num_steps[track];
 
   // modulo of num_p_steps to allow mirroring of parameter layer in drum mode
   step %= num_p_steps;
 
-  u16 step_ix = (par_instrument * num_p_layers * num_p_steps) + (par_layer * num_p_steps) + step;
+  u16 step_ix = (par_instrument * par_layer_instrument_size[track]) + (par_layer * num_p_steps) + step;
   if( step_ix >= SEQ_PAR_MAX_BYTES )
     return 0; // invalid step position: return 0 (parameter not set)
 
@@ -271,6 +272,44 @@ s32 SEQ_PAR_Get(u8 track, u16 step, u8 par_layer, u8 par_instrument)
 }
 
 
+/////////////////////////////////////////////////////////////////////////////
+// Returns the values of all parameter layers of a step
+// Faster than calling SEQ_PAR_Get() for each layer, since the step offset
+// is only calculated once, and the layers are fetched with a constant stride
+// values[] has to provide SEQ_PAR_MAX_LAYERS entries, layers which are not
+// available are set to 0
+// Returns the number of layers, which is limited to SEQ_PAR_MAX_LAYERS
+/////////////////////////////////////////////////////////////////////////////
+s32 SEQ_PAR_StepGet(u8 track, u16 step, u8 par_instrument, u8 *values)
+{
+  u8 num_p_layers = par_layer_num_layers[track];
+  u16 num_p_steps = par_layer_num_steps[track];
+  int par_layer = 0;
+
+  // lay_const[] only provides types for SEQ_PAR_MAX_LAYERS layers, the remaining ones
+  // (of a layout which has been read from a bank or track file) can't be played
+  if( num_p_layers > SEQ_PAR_MAX_LAYERS )
+    num_p_layers = SEQ_PAR_MAX_LAYERS;
+
+  if( par_instrument < par_layer_num_instruments[track] ) {
+    // modulo of num_p_steps to allow mirroring of parameter layer in drum mode
+    step %= num_p_steps;
+
+    // no range check required: SEQ_PAR_TrackInit() ensures that all layers fit into SEQ_PAR_MAX_BYTES
+    u8 *ptr = &seq_par_layer_value[track][(par_instrument * par_layer_instrument_size[track]) + step];
+    for(; par_layer<num_p_layers; ++par_layer, ptr += num_p_steps)
+      values[par_layer] = *ptr;
+  } else {
+    num_p_layers = 0;
+  }
+
+  for(; par_layer<SEQ_PAR_MAX_LAYERS; ++par_layer)
+    values[par_layer] = 0;
+
+  return num_p_layers;
+}
+
+
 /////////////////////////////////////////////////////////////////////////////
 // returns the first layer which plays a note
 /////////////////////////////////////////////////////////////////////////////
@@ -28,6 +28,9 @@
 //   - 64 steps, 16 parameter layers: 16*64 = 1024
 // don't change this value - it directly affects the constraints of the bank file format!
 
+// maximum number of parameter layers per track (limited by the layer_muted flags)
+#define SEQ_PAR_MAX_LAYERS  16
+
 
 /////////////////////////////////////////////////////////////////////////////
 // Global Types
@@ -86,6 +89,7 @@ extern seq_par_layer_type_t SEQ_PAR_AssignmentGet(u8 track, u8 par_layer);
 
 extern s32 SEQ_PAR_Set(u8 track, u16 step, u8 par_layer, u8 par_instrument, u8 value);
 extern s32 SEQ_PAR_Get(u8 track, u16 step, u8 par_layer, u8 par_instrument);
+extern s32 SEQ_PAR_StepGet(u8 track, u16 step, u8 par_instrument, u8 *values);
 
 extern s32 SEQ_PAR_NoteGet(u8 track, u8 step, u8 par_instrument, u16 layer_muted);
 extern s32 SEQ_PAR_ChordGet(u8 track, u8 step, u8 par_instrument, u16 layer_muted);
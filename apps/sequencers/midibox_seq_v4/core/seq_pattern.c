@@ -24,6 +24,8 @@
 #include "seq_pattern.h"
 #include "seq_cc.h"
 #include "seq_core.h"
+#include "seq_par.h"
+#include "seq_trg.h"
 #include "seq_ui.h"
 #include "seq_file.h"
 #include "seq_file_b.h"
@@ -40,6 +42,58 @@
 // (LED toggling in APP_Background() has to be disabled!)
 #define LED_PERFORMANCE_MEASURING 0
 
+// number of patterns which are kept in RAM (prefetched pattern requests and recently used patterns)
+// 0 disables the cache - can be overruled in mios32_config.h
+#ifndef SEQ_PATTERN_CACHE_NUM_SLOTS
+# if defined(MIOS32_FAMILY_STM32F4xx) || defined(MIOS32_FAMILY_EMULATION)
+#  define SEQ_PATTERN_CACHE_NUM_SLOTS 4
+# else
+#  define SEQ_PATTERN_CACHE_NUM_SLOTS 0 // not enough RAM available
+# endif
+#endif
+
+// maximum pattern size which can be cached: a group with completely filled parameter and trigger layers
+// (default bank format: 24 + 4 * (216 + 16*64 + 8*256/8) = 6008 bytes, see seq_file_b.c)
+#ifndef SEQ_PATTERN_CACHE_SLOT_SIZE
+#define SEQ_PATTERN_CACHE_SLOT_SIZE SEQ_FILE_B_PATTERN_SIZE(SEQ_CORE_NUM_TRACKS_PER_GROUP, SEQ_PAR_MAX_BYTES, SEQ_TRG_MAX_BYTES)
+#endif
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Local types
+/////////////////////////////////////////////////////////////////////////////
+
+typedef struct {
+  u8  valid;      // slot contains the data of bank/pattern
+  u8  bank;
+  u8  pattern;
+  u16 len;
+  u32 last_used;  // for LRU replacement
+  u8  data[SEQ_PATTERN_CACHE_SLOT_SIZE];
+} seq_pattern_cache_slot_t;
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Local variables
+/////////////////////////////////////////////////////////////////////////////
+
+#if SEQ_PATTERN_CACHE_NUM_SLOTS
+static seq_pattern_cache_slot_t seq_pattern_cache[SEQ_PATTERN_CACHE_NUM_SLOTS];
+static u32 seq_pattern_cache_use_ctr;
+#endif
+
+// groups for which a pattern should be prefetched
+static u8 seq_pattern_prefetch_req;
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Local prototypes
+/////////////////////////////////////////////////////////////////////////////
+
+static seq_pattern_cache_slot_t *SEQ_PATTERN_CacheFind(u8 bank, u8 pattern);
+static seq_pattern_cache_slot_t *SEQ_PATTERN_CacheFetch(u8 bank, u8 pattern);
+static u8 SEQ_PATTERN_RequestsCached(void);
+
 
 /////////////////////////////////////////////////////////////////////////////
 // Global variables
@@ -63,6 +117,8 @@ s32 SEQ_PATTERN_Init(u32 mode)
   seq_pattern_mixer_num = 0;
   seq_pattern_remix_map = 0;
   seq_pattern_log_load_time = 0;
+  seq_pattern_prefetch_req = 0;
+  SEQ_PATTERN_CacheInvalidate(0xff, 0xff);
 	
   // pre-init pattern numbers
   u8 group;
@@ -139,6 +195,7 @@ s32 SEQ_PATTERN_Change(u8 group, seq_pattern_t pattern, u8 force_immediate_chang
     portENTER_CRITICAL();
     pattern.REQ = 1;
     seq_pattern_req[group] = pattern;
+    seq_pattern_prefetch_req |= (1 << group); // fetch pattern into RAM with SEQ_PATTERN_PrefetchHandler()
     portEXIT_CRITICAL();
 
     if( seq_core_options.SYNCHED_PATTERN_CHANGE && !SEQ_SONG_ActiveGet() ) {
@@ -177,9 +234,24 @@ s32 SEQ_PATTERN_Handler(void)
   MIOS32_BOARD_LED_Set(0x00000001, 1);
 #endif
 
-  MUTEX_SDCARD_TAKE; // take SD Card Mutex before entering critical section, because within the section we won't get it anymore -> hangup
+  // SD Card access only required if a requested pattern hasn't been prefetched,
+  // this ensures that we don't have to wait for an ongoing SD Card transfer
+  u8 sdcard_access = seq_core_options.PATTERN_MIXER_MAP_COUPLING || !SEQ_PATTERN_RequestsCached();
+
+  if( sdcard_access )
+    MUTEX_SDCARD_TAKE; // take SD Card Mutex before entering critical section, because within the section we won't get it anymore -> hangup
   portENTER_CRITICAL();
 
+  // check again: meanwhile a request could have been changed, or a cache slot
+  // could have been invalidated (e.g. by SEQ_FILE_B_PatternWrite)
+  // -> leave the critical section again to take the SD Card Mutex
+  if( !sdcard_access && !SEQ_PATTERN_RequestsCached() ) {
+    portEXIT_CRITICAL();
+    sdcard_access = 1;
+    MUTEX_SDCARD_TAKE;
+    portENTER_CRITICAL();
+  }
+
   if( seq_pattern_log_load_time ) {
     MIOS32_STOPWATCH_Reset(); // note: conflicts with SEQ_STATISTICS_Stopwatch, but can be accepted if executed in critical section
   }
@@ -233,7 +305,8 @@ s32 SEQ_PATTERN_Handler(void)
   }
   u32 stopwatch_delta = MIOS32_STOPWATCH_ValueGet();
   portEXIT_CRITICAL();
-  MUTEX_SDCARD_GIVE;
+  if( sdcard_access )
+    MUTEX_SDCARD_GIVE;
   
 #if LED_PERFORMANCE_MEASURING
   MIOS32_BOARD_LED_Set(0x00000001, 0);
@@ -256,7 +329,155 @@ s32 SEQ_PATTERN_Handler(void)
 
 
 /////////////////////////////////////////////////////////////////////////////
-// Load a pattern from SD Card
+// This function should be called periodically from a low-priority task
+// to fetch requested patterns into the RAM cache before they are switched
+/////////////////////////////////////////////////////////////////////////////
+s32 SEQ_PATTERN_PrefetchHandler(void)
+{
+  u8 group;
+
+  if( !seq_pattern_prefetch_req )
+    return 0; // nothing to do
+
+  for(group=0; group<SEQ_CORE_NUM_GROUPS; ++group) {
+    portENTER_CRITICAL();
+    u8 prefetch = (seq_pattern_prefetch_req & (1 << group)) ? 1 : 0;
+    seq_pattern_prefetch_req &= ~(1 << group);
+    seq_pattern_t pattern = seq_pattern_req[group];
+    portEXIT_CRITICAL();
+
+    // pattern already loaded by SEQ_PATTERN_Handler()?
+    if( !prefetch || !pattern.REQ )
+      continue;
+
+    MUTEX_SDCARD_TAKE;
+    seq_pattern_cache_slot_t *slot = SEQ_PATTERN_CacheFetch(pattern.bank, pattern.pattern);
+    MUTEX_SDCARD_GIVE;
+
+    if( seq_pattern_log_load_time ) {
+      DEBUG_MSG("[SEQ_PATTERN:%d] Prefetch G%d %c%d %s", SEQ_BPM_TickGet(), group+1, 'A'+pattern.group, pattern.num+1, slot ? "done" : "failed");
+    }
+  }
+
+  return 0; // no error
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Returns the cache slot which contains the given pattern, NULL if not cached
+/////////////////////////////////////////////////////////////////////////////
+static seq_pattern_cache_slot_t *SEQ_PATTERN_CacheFind(u8 bank, u8 pattern)
+{
+#if SEQ_PATTERN_CACHE_NUM_SLOTS
+  int i;
+  seq_pattern_cache_slot_t *slot = &seq_pattern_cache[0];
+  for(i=0; i<SEQ_PATTERN_CACHE_NUM_SLOTS; ++i, ++slot) {
+    if( slot->valid && slot->bank == bank && slot->pattern == pattern )
+      return slot;
+  }
+#endif
+
+  return NULL; // not cached
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Returns 1 if all requested patterns are in the cache
+/////////////////////////////////////////////////////////////////////////////
+static u8 SEQ_PATTERN_RequestsCached(void)
+{
+  u8 group;
+
+  for(group=0; group<SEQ_CORE_NUM_GROUPS; ++group) {
+    seq_pattern_t req = seq_pattern_req[group];
+    if( req.REQ && !SEQ_PATTERN_CacheFind(req.bank, req.pattern) )
+      return 0;
+  }
+
+  return 1;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Returns the cache slot which contains the given pattern
+// If the pattern isn't cached yet, it will be read from SD Card into the
+// least recently used slot. Slots of requested patterns are not replaced.
+// SD Card mutex has to be taken by the caller!
+// Returns NULL if pattern can't be cached
+/////////////////////////////////////////////////////////////////////////////
+static seq_pattern_cache_slot_t *SEQ_PATTERN_CacheFetch(u8 bank, u8 pattern)
+{
+#if SEQ_PATTERN_CACHE_NUM_SLOTS
+  seq_pattern_cache_slot_t *slot;
+
+  if( (slot=SEQ_PATTERN_CacheFind(bank, pattern)) != NULL )
+    return slot;
+
+  // search for free or least recently used slot
+  seq_pattern_cache_slot_t *victim = NULL;
+  int i;
+  for(i=0, slot=&seq_pattern_cache[0]; i<SEQ_PATTERN_CACHE_NUM_SLOTS; ++i, ++slot) {
+    if( !slot->valid ) {
+      victim = slot;
+      break;
+    }
+
+    // don't replace patterns which are requested
+    u8 group;
+    u8 requested = 0;
+    for(group=0; group<SEQ_CORE_NUM_GROUPS; ++group) {
+      seq_pattern_t req = seq_pattern_req[group];
+      if( req.REQ && req.bank == slot->bank && req.pattern == slot->pattern )
+	requested = 1;
+    }
+
+    if( !requested && (victim == NULL || slot->last_used < victim->last_used) )
+      victim = slot;
+  }
+
+  if( victim == NULL )
+    return NULL; // all slots are allocated by requests
+
+  victim->valid = 0;
+
+  s32 status = SEQ_FILE_B_PatternFetch(bank, pattern, victim->data, SEQ_PATTERN_CACHE_SLOT_SIZE);
+  if( status < 0 )
+    return NULL; // e.g. pattern too large for slot, or file not available
+
+  victim->bank = bank;
+  victim->pattern = pattern;
+  victim->len = status;
+  victim->last_used = ++seq_pattern_cache_use_ctr;
+  victim->valid = 1;
+
+  return victim;
+#else
+  return NULL; // cache disabled
+#endif
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Invalidates cached patterns, should be called whenever a bank is changed
+// bank/pattern 0xff: all banks/patterns
+/////////////////////////////////////////////////////////////////////////////
+s32 SEQ_PATTERN_CacheInvalidate(u8 bank, u8 pattern)
+{
+#if SEQ_PATTERN_CACHE_NUM_SLOTS
+  int i;
+  seq_pattern_cache_slot_t *slot = &seq_pattern_cache[0];
+  for(i=0; i<SEQ_PATTERN_CACHE_NUM_SLOTS; ++i, ++slot) {
+    if( (bank == 0xff || slot->bank == bank) && (pattern == 0xff || slot->pattern == pattern) )
+      slot->valid = 0;
+  }
+#endif
+
+  return 0; // no error
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Load a pattern from RAM cache or SD Card
 /////////////////////////////////////////////////////////////////////////////
 s32 SEQ_PATTERN_Load(u8 group, seq_pattern_t pattern)
 {
@@ -264,14 +485,31 @@ s32 SEQ_PATTERN_Load(u8 group, seq_pattern_t pattern)
 
   seq_pattern[group] = pattern;
 
-  MUTEX_SDCARD_TAKE;
+  seq_pattern_cache_slot_t *slot = SEQ_PATTERN_CacheFind(pattern.bank, pattern.pattern);
+  if( slot != NULL ) {
+    // prefetched: no SD Card access required
+    if( seq_pattern_log_load_time ) {
+      DEBUG_MSG("[SEQ_PATTERN:%d] G%d %c%d taken from cache", SEQ_BPM_TickGet(), group+1, 'A'+pattern.group, pattern.num+1);
+    }
+#if SEQ_PATTERN_CACHE_NUM_SLOTS
+    slot->last_used = ++seq_pattern_cache_use_ctr;
+#endif
+    status = SEQ_FILE_B_PatternReadFromBuffer(slot->data, slot->len, group, seq_pattern_remix_map);
+  } else {
+    MUTEX_SDCARD_TAKE;
+
+    if( (slot=SEQ_PATTERN_CacheFetch(pattern.bank, pattern.pattern)) != NULL )
+      status = SEQ_FILE_B_PatternReadFromBuffer(slot->data, slot->len, group, seq_pattern_remix_map);
+    else
+      status = SEQ_FILE_B_PatternRead(pattern.bank, pattern.pattern, group, seq_pattern_remix_map);
 
-  if( (status=SEQ_FILE_B_PatternRead(pattern.bank, pattern.pattern, group, seq_pattern_remix_map)) < 0 )
+    MUTEX_SDCARD_GIVE;
+  }
+
+  if( status < 0 )
     SEQ_UI_SDCardErrMsg(2000, status);
-	
-  seq_pattern_start_time = MIOS32_SYS_TimeGet();
 
-  MUTEX_SDCARD_GIVE;
+  seq_pattern_start_time = MIOS32_SYS_TimeGet();
 
   // cancel sustain if there are no notes played by the track anymore
   {
@@ -16,11 +16,23 @@
 /////////////////////////////////////////////////////////////////////////////
 
 #include <mios32.h>
+#include <string.h>
+#include <seq_bpm.h>
+#include <seq_midi_out.h>
 #include "seq_statistics.h"
 
 #include "tasks.h"
 
 
+/////////////////////////////////////////////////////////////////////////////
+// Local definitions
+/////////////////////////////////////////////////////////////////////////////
+
+#if SEQ_STATISTICS_TIMING && !defined(SEQ_BPM_TICK_TIMESTAMP)
+# error "SEQ_STATISTICS_TIMING requires SEQ_BPM_TICK_TIMESTAMP() - see seq_bpm.h"
+#endif
+
+
 /////////////////////////////////////////////////////////////////////////////
 // Local variables
 /////////////////////////////////////////////////////////////////////////////
@@ -30,12 +42,31 @@ static s32 cpu_load_in_percent;
 static u32 stopwatch_value;
 static u32 stopwatch_value_max;
 
+#if SEQ_STATISTICS_TIMING
+static seq_statistics_histogram_t handler_histogram[SEQ_STATISTICS_NUM_HANDLERS];
+static seq_statistics_histogram_t latency_histogram[SEQ_STATISTICS_TIMING_PORTS];
+static mios32_midi_port_t latency_port[SEQ_STATISTICS_TIMING_PORTS];
+static u8 latency_num_ports;
+static u32 queue_depth_max;
+#endif
+
 
 /////////////////////////////////////////////////////////////////////////////
 // Initialisation
 /////////////////////////////////////////////////////////////////////////////
 s32 SEQ_STATISTICS_Init(u32 mode)
 {
+#if SEQ_STATISTICS_TIMING
+#if SEQ_STATISTICS_TIMING_CYCLES
+  // enable the CPU cycle counter
+  MIOS32_CYCLES_Init(0);
+#endif
+
+  // measure the latency of each sent MIDI event
+  // (has to be installed after SEQ_MIDI_OUT_Init())
+  SEQ_MIDI_OUT_Callback_Sent_Set(SEQ_STATISTICS_MIDI_OutSent);
+#endif
+
   return SEQ_STATISTICS_Reset();
 }
 
@@ -48,6 +79,9 @@ s32 SEQ_STATISTICS_Reset(void)
   cpu_load_in_percent = 0;
   stopwatch_value = 0;
   stopwatch_value_max = 0;
+#if SEQ_STATISTICS_TIMING
+  SEQ_STATISTICS_TimingReset();
+#endif
   return 0; // no error;
 }
 
@@ -147,3 +181,194 @@ extern u32 SEQ_STATISTICS_StopwatchGetValueMax(void)
   return stopwatch_value_max;
 }
 
+
+#if SEQ_STATISTICS_TIMING
+/////////////////////////////////////////////////////////////////////////////
+// Optional timing measurements
+// Handler durations and the MIDI output latency (scheduled bpm_tick ->
+// event sent) are collected in histograms with two bins per octave.
+// Enabled with SEQ_STATISTICS_TIMING in mios32_config.h
+/////////////////////////////////////////////////////////////////////////////
+s32 SEQ_STATISTICS_TimingReset(void)
+{
+  portENTER_CRITICAL();
+  memset(handler_histogram, 0, sizeof(handler_histogram));
+  memset(latency_histogram, 0, sizeof(latency_histogram));
+  latency_num_ports = 0;
+  queue_depth_max = 0;
+  portEXIT_CRITICAL();
+
+  return 0; // no error
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Adds a value to a histogram
+/////////////////////////////////////////////////////////////////////////////
+static void SEQ_STATISTICS_HistogramAdd(seq_statistics_histogram_t *histogram, u32 value_us)
+{
+  u8 bin;
+
+  if( value_us < 2 ) {
+    bin = value_us;
+  } else {
+    // the bit below the MSB selects the lower or upper half of the octave
+    u8 msb = 1;
+    while( value_us >> (msb+1) )
+      ++msb;
+    bin = 2*msb + ((value_us >> (msb-1)) & 1);
+    if( bin >= SEQ_STATISTICS_HISTOGRAM_BINS )
+      bin = SEQ_STATISTICS_HISTOGRAM_BINS-1;
+  }
+
+  // keep the distribution on overflow
+  if( histogram->bin[bin] == 0xffff ) {
+    int i;
+    for(i=0; i<SEQ_STATISTICS_HISTOGRAM_BINS; ++i)
+      histogram->bin[i] >>= 1;
+  }
+
+  ++histogram->bin[bin];
+  ++histogram->count;
+  if( value_us > histogram->max )
+    histogram->max = value_us;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Records the duration of a handler which has been started at
+// begin_timestamp (SEQ_BPM_TICK_TIMESTAMP() value), only considered
+// while the sequencer is running.
+// Returns the current timestamp, so that it can be used for the next handler
+/////////////////////////////////////////////////////////////////////////////
+u32 SEQ_STATISTICS_HandlerDurationAdd(seq_statistics_handler_t handler, u32 begin_timestamp)
+{
+  u32 timestamp = SEQ_BPM_TICK_TIMESTAMP();
+
+  if( handler < SEQ_STATISTICS_NUM_HANDLERS && SEQ_BPM_IsRunning() ) {
+    portENTER_CRITICAL();
+    SEQ_STATISTICS_HistogramAdd(&handler_histogram[handler], (timestamp - begin_timestamp) / SEQ_STATISTICS_TIMING_TICKS_PER_US);
+    portEXIT_CRITICAL();
+  }
+
+  return timestamp;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Records the number of events in the MIDI scheduler queue
+/////////////////////////////////////////////////////////////////////////////
+s32 SEQ_STATISTICS_QueueDepthAdd(u32 depth)
+{
+  if( depth > queue_depth_max )
+    queue_depth_max = depth;
+
+  return 0; // no error
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Called by SEQ_MIDI_OUT_Handler() after an event has been sent
+// Records the time between the scheduled bpm_tick and the output
+/////////////////////////////////////////////////////////////////////////////
+s32 SEQ_STATISTICS_MIDI_OutSent(mios32_midi_port_t port, mios32_midi_package_t midi_package, u32 timestamp, u32 bpm_tick)
+{
+  s32 latency = (s32)(SEQ_BPM_TICK_TIMESTAMP() - SEQ_BPM_TickTimestampGet(timestamp));
+  if( latency < 0 )
+    latency = 0; // tick timestamp has been extrapolated
+
+  portENTER_CRITICAL();
+  u8 slot;
+  for(slot=0; slot<latency_num_ports; ++slot) {
+    if( latency_port[slot] == port )
+      break;
+  }
+
+  if( slot >= latency_num_ports && latency_num_ports < SEQ_STATISTICS_TIMING_PORTS ) {
+    latency_port[slot] = port;
+    ++latency_num_ports;
+  }
+
+  if( slot < latency_num_ports )
+    SEQ_STATISTICS_HistogramAdd(&latency_histogram[slot], (u32)latency / SEQ_STATISTICS_TIMING_TICKS_PER_US);
+  portEXIT_CRITICAL();
+
+  return 0; // no error
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Returns the duration histogram of a handler
+/////////////////////////////////////////////////////////////////////////////
+const seq_statistics_histogram_t *SEQ_STATISTICS_HandlerHistogramGet(seq_statistics_handler_t handler)
+{
+  return (handler < SEQ_STATISTICS_NUM_HANDLERS) ? &handler_histogram[handler] : NULL;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Returns the latency histogram of a port slot (in the order of the first
+// event), NULL if the slot isn't used
+/////////////////////////////////////////////////////////////////////////////
+const seq_statistics_histogram_t *SEQ_STATISTICS_LatencyHistogramGet(u8 slot, mios32_midi_port_t *port)
+{
+  if( slot >= latency_num_ports )
+    return NULL;
+
+  if( port != NULL )
+    *port = latency_port[slot];
+
+  return &latency_histogram[slot];
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Returns the max. number of events in the MIDI scheduler queue
+/////////////////////////////////////////////////////////////////////////////
+u32 SEQ_STATISTICS_QueueDepthMaxGet(void)
+{
+  return queue_depth_max;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Returns the value in uS below which the given percentage of measurements
+// has been recorded (upper end of the bin, limited to the max value)
+/////////////////////////////////////////////////////////////////////////////
+u32 SEQ_STATISTICS_HistogramPercentileGet(const seq_statistics_histogram_t *histogram, u8 percent)
+{
+  u32 total = 0;
+  int bin;
+  for(bin=0; bin<SEQ_STATISTICS_HISTOGRAM_BINS; ++bin)
+    total += histogram->bin[bin];
+
+  if( !total )
+    return 0;
+
+  u32 threshold = (total * percent + 99) / 100;
+  u32 sum = 0;
+  for(bin=0; bin<(SEQ_STATISTICS_HISTOGRAM_BINS-1); ++bin) {
+    sum += histogram->bin[bin];
+    if( sum >= threshold ) {
+      u32 end = SEQ_STATISTICS_HistogramBinBeginGet(bin+1) - 1;
+      return (end < histogram->max) ? end : histogram->max;
+    }
+  }
+
+  return histogram->max;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Returns the first value in uS which is counted by the given bin
+/////////////////////////////////////////////////////////////////////////////
+u32 SEQ_STATISTICS_HistogramBinBeginGet(u8 bin)
+{
+  if( bin < 2 )
+    return bin;
+
+  u8 msb = bin / 2;
+  return (1 << msb) | ((bin & 1) << (msb-1));
+}
+#endif
+
@@ -19,11 +19,49 @@
 // Global definitions
 /////////////////////////////////////////////////////////////////////////////
 
+// optional measurement of the MIDI output latency, handler durations and
+// MIDI scheduler queue depth (can be enabled in mios32_config.h)
+// requires SEQ_BPM_TICK_TIMESTAMP() as time base
+#ifndef SEQ_STATISTICS_TIMING
+#define SEQ_STATISTICS_TIMING 0
+#endif
+
+// resolution of SEQ_BPM_TICK_TIMESTAMP()
+#ifndef SEQ_STATISTICS_TIMING_TICKS_PER_US
+#define SEQ_STATISTICS_TIMING_TICKS_PER_US (MIOS32_SYS_CPU_FREQUENCY/1000000)
+#endif
+
+// set to 0 if SEQ_BPM_TICK_TIMESTAMP() isn't based on MIOS32_CYCLES_Get()
+#ifndef SEQ_STATISTICS_TIMING_CYCLES
+#define SEQ_STATISTICS_TIMING_CYCLES 1
+#endif
+
+// max number of MIDI ports for which the output latency is recorded
+#ifndef SEQ_STATISTICS_TIMING_PORTS
+#define SEQ_STATISTICS_TIMING_PORTS 8
+#endif
+
+// two bins per octave, the last bin collects all values >= 49152 uS
+#define SEQ_STATISTICS_HISTOGRAM_BINS 32
+
 
 /////////////////////////////////////////////////////////////////////////////
 // Global Types
 /////////////////////////////////////////////////////////////////////////////
 
+typedef enum {
+  SEQ_STATISTICS_HANDLER_CORE,
+  SEQ_STATISTICS_HANDLER_MIDI_OUT,
+} seq_statistics_handler_t;
+
+#define SEQ_STATISTICS_NUM_HANDLERS 2
+
+typedef struct {
+  u32 count; // number of measurements
+  u32 max;   // in uS
+  u16 bin[SEQ_STATISTICS_HISTOGRAM_BINS]; // halved on overflow
+} seq_statistics_histogram_t;
+
 
 /////////////////////////////////////////////////////////////////////////////
 // Prototypes
@@ -41,6 +79,20 @@ extern s32 SEQ_STATISTICS_StopwatchCapture(void);
 extern u32 SEQ_STATISTICS_StopwatchGetValue(void);
 extern u32 SEQ_STATISTICS_StopwatchGetValueMax(void);
 
+#if SEQ_STATISTICS_TIMING
+extern s32 SEQ_STATISTICS_TimingReset(void);
+extern u32 SEQ_STATISTICS_HandlerDurationAdd(seq_statistics_handler_t handler, u32 begin_timestamp);
+extern s32 SEQ_STATISTICS_QueueDepthAdd(u32 depth);
+extern s32 SEQ_STATISTICS_MIDI_OutSent(mios32_midi_port_t port, mios32_midi_package_t midi_package, u32 timestamp, u32 bpm_tick);
+
+extern const seq_statistics_histogram_t *SEQ_STATISTICS_HandlerHistogramGet(seq_statistics_handler_t handler);
+extern const seq_statistics_histogram_t *SEQ_STATISTICS_LatencyHistogramGet(u8 slot, mios32_midi_port_t *port);
+extern u32 SEQ_STATISTICS_QueueDepthMaxGet(void);
+
+extern u32 SEQ_STATISTICS_HistogramPercentileGet(const seq_statistics_histogram_t *histogram, u8 percent);
+extern u32 SEQ_STATISTICS_HistogramBinBeginGet(u8 bin);
+#endif
+
 
 /////////////////////////////////////////////////////////////////////////////
 // Export global variables
@@ -24,6 +24,7 @@
 
 #include <aout.h>
 #include <app_lcd.h>
+#include <freertos_utils.h>
 
 #include "tasks.h"
 
@@ -354,6 +355,42 @@ s32 SEQ_TERMINAL_ParseLine(char *input, void *_output_function)
       }	else {
 	SEQ_TERMINAL_PrintMemoryInfo(out);
       }
+#if !defined(MIOS32_FAMILY_EMULATION) && FREERTOS_UTILS_TRACE_SIZE
+    } else if( strcmp(parameter, "trace") == 0 ) {
+      char *arg = strtok_r(NULL, separators, &brkt);
+      if( !arg || strcmp(arg, "dump") == 0 ) {
+	MUTEX_MIDIOUT_TAKE;
+	s32 status = FREERTOS_UTILS_TraceDump(MIOS32_MIDI_DebugPortGet());
+	MUTEX_MIDIOUT_GIVE;
+	if( status < 0 )
+	  out("ERROR: trace dump failed (status %d)", status);
+	else
+	  out("Trace dump has been sent.");
+      } else if( strcmp(arg, "hist") == 0 ) {
+	FREERTOS_UTILS_TraceHistogramsPrint();
+      } else if( strcmp(arg, "start") == 0 ) {
+	FREERTOS_UTILS_TraceStart();
+	out("Trace capture started.");
+      } else if( strcmp(arg, "stop") == 0 ) {
+	FREERTOS_UTILS_TraceStop();
+	out("Trace capture stopped.");
+      } else if( strcmp(arg, "clear") == 0 ) {
+	FREERTOS_UTILS_TraceClear();
+	out("Trace buffer and histograms cleared.");
+      } else {
+	out("SYNTAX: trace [dump|hist|start|stop|clear]");
+      }
+#endif
+    } else if( strcmp(parameter, "timing") == 0 ) {
+      char *arg = strtok_r(NULL, separators, &brkt);
+      if( arg && strcmp(arg, "reset") == 0 ) {
+#if SEQ_STATISTICS_TIMING
+	SEQ_STATISTICS_TimingReset();
+#endif
+	out("Timing statistics have been reset.");
+      } else {
+	SEQ_TERMINAL_PrintTiming(out);
+      }
     } else if( strcmp(parameter, "sdcard") == 0 ) {
       SEQ_TERMINAL_PrintSdCardInfo(out);
     } else if( strcmp(parameter, "sdcard_format") == 0 ) {
@@ -828,10 +865,32 @@ s32 SEQ_TERMINAL_ParseLine(char *input, void *_output_function)
 	MUTEX_SDCARD_TAKE;
 	portENTER_CRITICAL();
 	u8 max_depth = 3;
-	FILE_BackupDiskAutoName(max_depth);
+	char *arg = strtok_r(NULL, separators, &brkt);
+	if( arg && strcasecmp(arg, "inc") == 0 ) {
+	  FILE_BackupDiskIncrementalAutoName(max_depth);
+	} else {
+	  FILE_BackupDiskAutoName(max_depth);
+	}
 	portEXIT_CRITICAL();
 	MUTEX_SDCARD_GIVE;
       }
+    } else if( strcmp(parameter, "untar") == 0 ) {
+      char *filename = strtok_r(NULL, separators, &brkt);
+      char *dst_path = strtok_r(NULL, separators, &brkt);
+      if( seq_ui_backup_req || seq_ui_format_req ) {
+	out("Ongoing session creation - please wait!");
+      } else if( !filename ) {
+	out("Please specify a .tar file, e.g. \"untar /bak1.tar\"!");
+      } else {
+	MUTEX_SDCARD_TAKE;
+	s32 status = FILE_ExtractTar(filename, dst_path ? dst_path : "");
+	MUTEX_SDCARD_GIVE;
+	if( status < 0 ) {
+	  out("ERROR: failed to extract %s (status %d)\n", filename, status);
+	} else if( !dst_path ) {
+	  out("%s has been extracted - enter 'restore' to reload the session!\n", filename);
+	}
+      }
     } else if( strcmp(parameter, "dbg_record") == 0 ) {
       SEQ_RECORD_DebugActiveNotes();
     } else if( strcmp(parameter, "session") == 0 ) {
@@ -908,6 +967,10 @@ s32 SEQ_TERMINAL_PrintHelp(void *_output_function)
   out("Following commands are available:");
   out("  system:         print system info");
   out("  memory:         print memory allocation info");
+  out("  timing [reset]: print MIDI output latency and handler durations");
+#if !defined(MIOS32_FAMILY_EMULATION) && FREERTOS_UTILS_TRACE_SIZE
+  out("  trace [dump|hist|start|stop|clear]: sends the task trace as SysEx, or prints the response time histograms");
+#endif
   out("  sdcard:         print SD Card info");
   out("  sdcard_format:  formats the SD Card (you will be asked for confirmation)");
   out("  global:         print global configuration");
@@ -955,6 +1018,8 @@ s32 SEQ_TERMINAL_PrintHelp(void *_output_function)
   out("  new <name>:     creates a new session");
   out("  delete <name>:  deletes a session");
   out("  backup:         creates a .tar file of the entire SD card");
+  out("  backup inc:     creates a .tar file with the files changed since the last backup");
+  out("  untar <file> [<dir>]: extracts a .tar file (default: into the original location)");
   out("  session:        prints the current session name");
   out("  sessions:       prints all available sessions");
   out("  dbg_record:     prints active notes which are recorded");
@@ -1265,6 +1330,66 @@ s32 SEQ_TERMINAL_PrintMemoryInfo(void *_output_function)
   return 0; // no error
 }
 
+s32 SEQ_TERMINAL_PrintTiming(void *_output_function)
+{
+  void (*out)(char *format, ...) = _output_function;
+
+#if !SEQ_STATISTICS_TIMING
+  out("Timing statistics not enabled (SEQ_STATISTICS_TIMING in mios32_config.h)!");
+#else
+  out("Timing Statistics:");
+  out("==================");
+  out("MIDI Scheduler Queue: max. %d events (%d allocated, %d drops)",
+      SEQ_STATISTICS_QueueDepthMaxGet(), seq_midi_out_allocated, seq_midi_out_dropouts);
+
+  out("Handler durations while sequencer is running:");
+  out("  Handler          calls    p50    p90    p99    max [uS]");
+  {
+    const char *handler_name[SEQ_STATISTICS_NUM_HANDLERS] = { "SEQ_CORE", "SEQ_MIDI_OUT" };
+    int handler;
+    for(handler=0; handler<SEQ_STATISTICS_NUM_HANDLERS; ++handler) {
+      const seq_statistics_histogram_t *h = SEQ_STATISTICS_HandlerHistogramGet(handler);
+      out("  %-12s %9d %6d %6d %6d %6d",
+	  handler_name[handler], h->count,
+	  SEQ_STATISTICS_HistogramPercentileGet(h, 50),
+	  SEQ_STATISTICS_HistogramPercentileGet(h, 90),
+	  SEQ_STATISTICS_HistogramPercentileGet(h, 99),
+	  h->max);
+    }
+  }
+
+  out("MIDI output latency (scheduled tick -> sent):");
+  {
+    u8 slot;
+    const seq_statistics_histogram_t *h;
+    mios32_midi_port_t port;
+    for(slot=0; (h=SEQ_STATISTICS_LatencyHistogramGet(slot, &port)) != NULL; ++slot) {
+      out("  Port %s: %d events, p50 %d uS, p90 %d uS, p99 %d uS, max %d uS",
+	  SEQ_MIDI_PORT_OutNameGet(SEQ_MIDI_PORT_OutIxGet(port)), h->count,
+	  SEQ_STATISTICS_HistogramPercentileGet(h, 50),
+	  SEQ_STATISTICS_HistogramPercentileGet(h, 90),
+	  SEQ_STATISTICS_HistogramPercentileGet(h, 99),
+	  h->max);
+
+      u8 bin;
+      for(bin=0; bin<SEQ_STATISTICS_HISTOGRAM_BINS; ++bin) {
+	if( h->bin[bin] ) {
+	  if( bin == (SEQ_STATISTICS_HISTOGRAM_BINS-1) )
+	    out("    >= %5d uS: %d", SEQ_STATISTICS_HistogramBinBeginGet(bin), h->bin[bin]);
+	  else
+	    out("    %5d..%5d uS: %d", SEQ_STATISTICS_HistogramBinBeginGet(bin), SEQ_STATISTICS_HistogramBinBeginGet(bin+1)-1, h->bin[bin]);
+	}
+      }
+    }
+
+    if( slot == 0 )
+      out("  no events sent yet");
+  }
+#endif
+
+  return 0; // no error
+}
+
 
 ///////////////////////////////////////////////////////////////////
 // These time and date functions and other bits of following code were adapted from 
@@ -39,6 +39,7 @@ u8 seq_trg_layer_value[SEQ_CORE_NUM_TRACKS][SEQ_TRG_MAX_BYTES];
 static u8 trg_layer_num_steps8[SEQ_CORE_NUM_TRACKS];
 static u8 trg_layer_num_layers[SEQ_CORE_NUM_TRACKS];
 static u8 trg_layer_num_instruments[SEQ_CORE_NUM_TRACKS];
+static u16 trg_layer_instrument_size[SEQ_CORE_NUM_TRACKS]; // layers * steps/8, precalculated in SEQ_TRG_TrackInit()
 
 static const char seq_trg_names[SEQ_TRG_ASG_NUM][6] = {
   "Gate ", // 0
@@ -104,6 +105,7 @@ s32 SEQ_TRG_TrackInit(u8 track, u16 steps, u8 trg_layers, u8 instruments)
   trg_layer_num_layers[track] = trg_layers;
   trg_layer_num_steps8[track] = steps/8;
   trg_layer_num_instruments[track] = instruments;
+  trg_layer_instrument_size[track] = trg_layers * (steps/8);
 
   // init trigger layer values
   memset((u8 *)&seq_trg_layer_value[track], 0, SEQ_TRG_MAX_BYTES);
@@ -153,9 +155,8 @@ s32 SEQ_TRG_AssignmentGet(u8 track, u8 trg_num)
 /////////////////////////////////////////////////////////////////////////////
 s32 SEQ_TRG_Get(u8 track, u16 step, u8 trg_layer, u8 trg_instrument)
 {
-  u8 num_t_layers = trg_layer_num_layers[track];
   u8 num_t_steps8 = trg_layer_num_steps8[track];
-  u16 step_ix = (trg_instrument * num_t_layers * num_t_steps8) + (trg_layer * num_t_steps8) + (step/8);
+  u16 step_ix = (trg_instrument * trg_layer_instrument_size[track]) + (trg_layer * num_t_steps8) + (step/8);
   if( step_ix >= SEQ_TRG_MAX_BYTES )
     return 0; // invalid step position: return 0 (trigger not set)
 
@@ -170,9 +171,8 @@ s32 SEQ_TRG_Get(u8 track, u16 step, u8 trg_layer, u8 trg_instrument)
 /////////////////////////////////////////////////////////////////////////////
 s32 SEQ_TRG_Get8(u8 track, u8 step8, u8 trg_layer, u8 trg_instrument)
 {
-  u8 num_t_layers = trg_layer_num_layers[track];
   u8 num_t_steps8 = trg_layer_num_steps8[track];
-  u16 step_ix = (trg_instrument * num_t_layers * num_t_steps8) + (trg_layer * num_t_steps8) + step8;
+  u16 step_ix = (trg_instrument * trg_layer_instrument_size[track]) + (trg_layer * num_t_steps8) + step8;
   if( step_ix >= SEQ_TRG_MAX_BYTES )
     return 0; // invalid step position: return 0 (trigger not set)
 
@@ -186,9 +186,8 @@ s32 SEQ_TRG_Get8(u8 track, u8 step8, u8 trg_layer, u8 trg_instrument)
 /////////////////////////////////////////////////////////////////////////////
 s32 SEQ_TRG_Get16(u8 track, u8 step16, u8 trg_layer, u8 trg_instrument)
 {
-  u8 num_t_layers = trg_layer_num_layers[track];
   u8 num_t_steps8 = trg_layer_num_steps8[track];
-  u16 step_ix = (trg_instrument * num_t_layers * num_t_steps8) + (trg_layer * num_t_steps8) + 2*step16;
+  u16 step_ix = (trg_instrument * trg_layer_instrument_size[track]) + (trg_layer * num_t_steps8) + 2*step16;
   if( step_ix >= SEQ_TRG_MAX_BYTES )
     return 0; // invalid step position: return 0 (trigger not set)
 
@@ -275,7 +274,7 @@ s32 SEQ_TRG_Set(u8 track, u16 step, u8 trg_layer, u8 trg_instrument, u8 value)
   if( (step/8) >= num_t_steps8 )
     return -3;
 
-  u16 step_ix = (trg_instrument * num_t_layers * num_t_steps8) + (trg_layer * num_t_steps8) + (step/8);
+  u16 step_ix = (trg_instrument * trg_layer_instrument_size[track]) + (trg_layer * num_t_steps8) + (step/8);
   if( step_ix >= SEQ_TRG_MAX_BYTES )
     return -4; // invalid step position
 
@@ -304,7 +303,7 @@ s32 SEQ_TRG_Set8(u8 track, u8 step8, u8 trg_layer, u8 trg_instrument, u8 value)
   if( step8 >= num_t_steps8 )
     return -3;
 
-  u16 step_ix = (trg_instrument * num_t_layers * num_t_steps8) + (trg_layer * num_t_steps8) + step8;
+  u16 step_ix = (trg_instrument * trg_layer_instrument_size[track]) + (trg_layer * num_t_steps8) + step8;
   if( step_ix >= SEQ_TRG_MAX_BYTES )
     return -4; // invalid step position
 
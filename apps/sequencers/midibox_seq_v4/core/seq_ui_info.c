@@ -64,6 +64,7 @@
 
 typedef enum {
     LIST_ITEM_SYSTEM,
+    LIST_ITEM_TIMING,
     LIST_ITEM_GLOBALS,
     LIST_ITEM_CONFIG,
     LIST_ITEM_TRACKS,
@@ -88,6 +89,7 @@ typedef enum {
 static char list_entries[NUM_LIST_ITEMS*LIST_ENTRY_WIDTH] =
 //<--------->
   "System   "
+  "Timing   "
   "Globals  "
   "Config   "
   "Tracks   "
@@ -140,6 +142,11 @@ static s32 Encoder_Handler(seq_ui_encoder_t encoder, s32 incrementer)
       case LIST_ITEM_SYSTEM:
 	SEQ_STATISTICS_Reset();
 	break;
+#if SEQ_STATISTICS_TIMING
+      case LIST_ITEM_TIMING:
+	SEQ_STATISTICS_TimingReset();
+	break;
+#endif
     }
     return 1;
   }
@@ -180,6 +187,11 @@ static s32 Button_Handler(seq_ui_button_t button, s32 depressed)
 	SEQ_TERMINAL_PrintSystem(DEBUG_MSG);
 	break;
 
+      //////////////////////////////////////////////////////////////////////////////////////////////
+      case LIST_ITEM_TIMING:
+	SEQ_TERMINAL_PrintTiming(DEBUG_MSG);
+	break;
+
       //////////////////////////////////////////////////////////////////////////////////////////////
       case LIST_ITEM_GLOBALS:
 	SEQ_TERMINAL_PrintGlobalConfig(DEBUG_MSG);
@@ -293,6 +305,10 @@ static s32 LCD_Handler(u8 high_prio)
   // About this MIDIbox:             00:00:00Stopwatch:   100/  300 uS  CPU Load: 40%
   //   System   Globals    Tracks  TrackInfo>MIDI Scheduler: Alloc   0/  0 Drops:   0
 
+  // Timing page (values in uS, reset with GP9..16):
+  // p99/max Core:  12/   45 Out:   8/   30uS
+  // Latency: 890/ 1302uS (USB1) Queue:  42
+
 
   // Select MIDI Device with GP Button:      10 Devices found under /sysex           
   //  xxxxxxxx  xxxxxxxx  xxxxxxxx  xxxxxxxx  xxxxxxxx  xxxxxxxx  xxxxxxxx  xxxxxxxx>
@@ -336,6 +352,43 @@ static s32 LCD_Handler(u8 high_prio)
       }
     } break;
 
+#if SEQ_STATISTICS_TIMING
+    case LIST_ITEM_TIMING: {
+      const seq_statistics_histogram_t *core = SEQ_STATISTICS_HandlerHistogramGet(SEQ_STATISTICS_HANDLER_CORE);
+      const seq_statistics_histogram_t *midi_out = SEQ_STATISTICS_HandlerHistogramGet(SEQ_STATISTICS_HANDLER_MIDI_OUT);
+
+      SEQ_LCD_CursorSet(40, 0);
+      SEQ_LCD_PrintFormattedString("p99/max Core:%4d/%5d Out:%4d/%5duS",
+				   SEQ_STATISTICS_HistogramPercentileGet(core, 99), core->max,
+				   SEQ_STATISTICS_HistogramPercentileGet(midi_out, 99), midi_out->max);
+
+      // display the port with the worst latency
+      const seq_statistics_histogram_t *h;
+      const seq_statistics_histogram_t *worst = NULL;
+      mios32_midi_port_t port, worst_port = DEFAULT;
+      u32 worst_p99 = 0;
+      u8 slot;
+      for(slot=0; (h=SEQ_STATISTICS_LatencyHistogramGet(slot, &port)) != NULL; ++slot) {
+	u32 p99 = SEQ_STATISTICS_HistogramPercentileGet(h, 99);
+	if( worst == NULL || p99 > worst_p99 ) {
+	  worst = h;
+	  worst_p99 = p99;
+	  worst_port = port;
+	}
+      }
+
+      SEQ_LCD_CursorSet(40, 1);
+      if( worst == NULL ) {
+	SEQ_LCD_PrintFormattedString("Latency: no events   ");
+      } else {
+	SEQ_LCD_PrintFormattedString("Latency:%4d/%5duS ", worst_p99, worst->max);
+      }
+      SEQ_LCD_PrintFormattedString("(%-4.4s) Queue:%4d  ",
+				   worst ? SEQ_MIDI_PORT_OutNameGet(SEQ_MIDI_PORT_OutIxGet(worst_port)) : "----",
+				   SEQ_STATISTICS_QueueDepthMaxGet());
+    } break;
+#endif
+
     default:
       SEQ_LCD_CursorSet(40, 0);
       //                  <---------------------------------------->
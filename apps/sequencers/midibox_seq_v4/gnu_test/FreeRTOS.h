@@ -0,0 +1,10 @@
+// heap functions used by seq_midi_out.c
+#ifndef _FREERTOS_H
+#define _FREERTOS_H
+
+#include <stdlib.h>
+
+#define pvPortMalloc(size) malloc(size)
+#define vPortFree(ptr)     free(ptr)
+
+#endif /* _FREERTOS_H */
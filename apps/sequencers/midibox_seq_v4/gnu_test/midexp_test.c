@@ -0,0 +1,519 @@
+// Host test of the MIDI file export
+//
+// Runs the real seq_midexp.c with a simulated sequencer core, which sends
+// pseudo random events of all tracks (plus MIDI clock and events which
+// aren't exported), and an in-memory file. The exported file is compared
+// byte by byte with a reference encoding of the events, and the writes are
+// checked for SD Card sector alignment.
+//
+// File errors are injected on open, write, seek and close: the export has
+// to fail, close the file and give back the mutexes and MIDI scheduler hooks.
+//
+// The export time is compared with the previous exporter (seq_midexp_prev.c,
+// built as midexp_test_prev with TEST_PREVIOUS_EXPORTER): the host wall clock
+// of each export is measured, and the time on the target is estimated with a
+// model of FatFs on a SD Card: each FILE_* call has a fixed overhead, and the
+// sector window of the file is read and written like f_write(), f_lseek()
+// and f_close() do it. The delays which give the LCD task some time to show
+// the progress message (vTaskDelay() before SEQ_UI_Msg()) are added as well.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "mios32.h"
+#include "tasks.h"
+#include "file.h"
+#include "seq_midexp.h"
+#include "seq_core.h"
+#include "seq_ui.h"
+
+#define PPQN             384
+#define SECTOR_SIZE      512
+#define MAX_FILE_SIZE    (1024*1024)
+#define MAX_QUEUE        32
+
+// assumed costs on the target: STM32F4, SD Card connected via SPI
+#define SD_CALL_US           2 // FILE_* function with FatFs bookkeeping
+#define SD_SECTOR_READ_US  300
+#define SD_SECTOR_WRITE_US 800 // incl. busy time of the card
+#define UI_DELAY_FIRST_MS  100 // vTaskDelay() before the first progress message
+#ifdef TEST_PREVIOUS_EXPORTER
+#define UI_DELAY_MS        100 // before each track
+#else
+#define UI_DELAY_MS         10 // before each progress update
+#endif
+
+static int errors;
+
+
+// ------- simulated file -------
+static u8 file_data[MAX_FILE_SIZE];
+static u32 file_len;
+static u32 file_pos;
+static u8 file_is_open;
+static u32 file_num_writes;
+static u32 file_num_unaligned;
+
+// SD Card model
+static s32 sd_window = -1; // sector in the FatFs buffer
+static u8 sd_window_dirty;
+static u32 sd_calls;
+static u32 sd_reads;
+static u32 sd_writes;
+static u32 ui_msgs;
+
+// error injection: number of calls until the function fails (0: never)
+static u32 fail_open;
+static u32 fail_write;
+static u32 fail_seek;
+static u32 fail_close;
+
+static int fail_now(u32 *ctr)
+{
+  return *ctr && --*ctr == 0;
+}
+
+static void sd_flush(void)
+{
+  if( sd_window_dirty ) {
+    ++sd_writes;
+    sd_window_dirty = 0;
+  }
+}
+
+// loads the sector of the given position into the window
+static void sd_load(u32 pos)
+{
+  s32 sector = pos / SECTOR_SIZE;
+  if( sector != sd_window ) {
+    sd_flush();
+    // a new sector at the end of the file doesn't need to be read
+    if( pos < file_len )
+      ++sd_reads;
+    sd_window = sector;
+  }
+}
+
+static void sd_write(u32 pos, u32 len)
+{
+  ++sd_calls;
+  while( len ) {
+    u32 chunk = SECTOR_SIZE - (pos % SECTOR_SIZE);
+    if( chunk > len )
+      chunk = len;
+
+    if( chunk == SECTOR_SIZE ) {
+      // complete sectors are written directly
+      if( sd_window == pos / SECTOR_SIZE )
+	sd_window = -1;
+      ++sd_writes;
+    } else {
+      sd_load(pos);
+      sd_window_dirty = 1;
+    }
+
+    pos += chunk;
+    len -= chunk;
+  }
+}
+
+s32 FILE_WriteOpen(char *filepath, u8 create)
+{
+  if( fail_now(&fail_open) )
+    return FILE_ERR_OPEN_WRITE;
+  if( file_is_open )
+    return FILE_ERR_OPEN_WRITE_WITHOUT_CLOSE;
+
+  // directory lookup, and the new entry is written
+  ++sd_calls;
+  ++sd_reads;
+  if( create )
+    ++sd_writes;
+  sd_window = -1;
+
+  file_is_open = 1;
+  if( create )
+    file_len = 0;
+  file_pos = 0;
+  return 0;
+}
+
+s32 FILE_WriteClose(void)
+{
+  // the window and the directory entry are written
+  ++sd_calls;
+  sd_flush();
+  ++sd_reads;
+  ++sd_writes;
+
+  file_is_open = 0;
+  if( fail_now(&fail_close) )
+    return FILE_ERR_WRITECLOSE;
+  return 0;
+}
+
+s32 FILE_WriteBuffer(u8 *buffer, u32 len)
+{
+  if( !file_is_open || fail_now(&fail_write) )
+    return FILE_ERR_WRITE;
+  if( file_pos + len > MAX_FILE_SIZE )
+    return FILE_ERR_WRITECOUNT;
+
+  // appended data shouldn't cross a sector boundary (track sizes are patched in place)
+  ++file_num_writes;
+  if( file_pos == file_len && ((file_pos % SECTOR_SIZE) + len) > SECTOR_SIZE )
+    ++file_num_unaligned;
+
+  sd_write(file_pos, len);
+  memcpy(&file_data[file_pos], buffer, len);
+  file_pos += len;
+  if( file_pos > file_len )
+    file_len = file_pos;
+  return 0;
+}
+
+s32 FILE_WriteSeek(u32 offset)
+{
+  if( !file_is_open || fail_now(&fail_seek) || offset > file_len )
+    return FILE_ERR_SEEK;
+
+  // f_lseek() loads the new sector if the position isn't sector aligned
+  ++sd_calls;
+  if( offset / SECTOR_SIZE != sd_window ) {
+    sd_flush();
+    sd_window = -1;
+    if( offset % SECTOR_SIZE )
+      sd_load(offset);
+  }
+
+  file_pos = offset;
+  return 0;
+}
+
+u32 FILE_WriteGetCurrentPosition(void)
+{
+  return file_pos;
+}
+
+u32 FILE_WriteGetCurrentSize(void)
+{
+  return file_len;
+}
+
+s32 FILE_WriteByte(u8 byte)
+{
+  return FILE_WriteBuffer(&byte, 1);
+}
+
+
+// ------- simulated sequencer -------
+seq_core_options_t seq_core_options;
+seq_core_state_t seq_core_state;
+u8 seq_core_steps_per_pattern = 15;
+u8 ui_selected_group;
+static u8 visible_track;
+
+static s32 (*send_package)(mios32_midi_port_t port, mios32_midi_package_t package);
+static void *hook_is_running, *hook_tick_get, *hook_bpm_set;
+static mios32_midi_package_t queue[MAX_QUEUE];
+static int queue_len;
+static int sdcard_taken, midiout_taken;
+
+void TASKS_SDCardSemaphoreTake(void) { ++sdcard_taken; }
+void TASKS_SDCardSemaphoreGive(void) { --sdcard_taken; }
+void TASKS_MIDIOUTSemaphoreTake(void) { ++midiout_taken; }
+void TASKS_MIDIOUTSemaphoreGive(void) { --midiout_taken; }
+
+s32 SEQ_MIDI_OUT_Callback_MIDI_SendPackage_Set(void *_callback_midi_send_package) { send_package = _callback_midi_send_package; return 0; }
+s32 SEQ_MIDI_OUT_Callback_BPM_IsRunning_Set(void *_callback_bpm_is_running) { hook_is_running = _callback_bpm_is_running; return 0; }
+s32 SEQ_MIDI_OUT_Callback_BPM_TickGet_Set(void *_callback_bpm_tick_get) { hook_tick_get = _callback_bpm_tick_get; return 0; }
+s32 SEQ_MIDI_OUT_Callback_BPM_Set_Set(void *_callback_bpm_set) { hook_bpm_set = _callback_bpm_set; return 0; }
+
+s32 SEQ_BPM_PPQN_Get(void) { return PPQN; }
+s32 SEQ_BPM_Stop(void) { return 0; }
+s32 SEQ_CORE_Reset(u32 bpm_start) { queue_len = 0; return 0; }
+s32 SEQ_CORE_PlayOffEvents(void) { return 0; }
+s32 SEQ_SONG_Reset(u32 bpm_start) { return 0; }
+s32 SEQ_SONG_ActiveGet(void) { return 0; }
+s32 SEQ_SONG_ActiveSet(u8 active) { return 0; }
+s32 SEQ_SONG_NextPos(void) { return 0; }
+s32 SEQ_PATTERN_Handler(void) { return 0; }
+s32 SEQ_MIDPLY_Reset(void) { return 0; }
+s32 SEQ_MIDPLY_DisableFile(void) { return 0; }
+s32 SEQ_MIDPLY_PlayOffEvents(void) { return 0; }
+s32 SEQ_MIDI_ROUTER_SendMIDIClockEvent(u8 evnt0, u32 bpm_tick) { return 0; }
+s32 SEQ_UI_Msg(seq_ui_msg_type_t msg_type, u16 delay, char *line1, char *line2) { ++ui_msgs; return 0; }
+u8 SEQ_UI_VisibleTrackGet(void) { return visible_track; }
+
+// returns the number of events of a track at the given tick, and the events
+static int track_events(u8 track, u32 tick, mios32_midi_package_t *p)
+{
+  u32 hash = (track * 2654435761u) ^ (tick * 40503u);
+  hash ^= hash >> 13;
+  hash *= 0x5bd1e995;
+  hash ^= hash >> 15;
+
+  if( (hash % 5) != 0 )
+    return 0;
+
+  int num = 1 + ((hash >> 8) % 2);
+  int i;
+  for(i=0; i<num; ++i) {
+    static const u8 types[] = { NoteOn, NoteOff, NoteOn, CC, PitchBend, ProgramChange, Aftertouch, PolyPressure };
+    u8 type = types[(hash >> (12 + 3*i)) % sizeof(types)];
+    p[i].ALL = 0;
+    p[i].type = type;
+    p[i].cable = track;
+    p[i].evnt0 = (type << 4) | (track & 0x0f);
+    p[i].evnt1 = (hash >> (i*8)) & 0x7f;
+    p[i].evnt2 = (hash >> (i*8 + 16)) & 0x7f;
+  }
+  return num;
+}
+
+s32 SEQ_CORE_Tick(u32 bpm_tick, s8 export_track, u8 mute_nonloopback_tracks)
+{
+  mios32_midi_package_t p[2];
+  u8 track;
+  int i, num;
+
+  // MIDI clock
+  if( (bpm_tick % (PPQN/24)) == 0 && queue_len < MAX_QUEUE ) {
+    queue[queue_len].ALL = 0;
+    queue[queue_len].type = 0xf;
+    queue[queue_len].evnt0 = 0xf8;
+    ++queue_len;
+  }
+
+  // SysEx (not exported)
+  if( (bpm_tick % 1000) == 7 && queue_len < MAX_QUEUE ) {
+    queue[queue_len].ALL = 0;
+    queue[queue_len].type = 0x5;
+    queue[queue_len].cable = export_track;
+    queue[queue_len].evnt0 = 0xf7;
+    ++queue_len;
+  }
+
+  // events of all tracks, only the exported track should be written
+  for(track=0; track<SEQ_CORE_NUM_TRACKS; ++track) {
+    num = track_events(track, bpm_tick, p);
+    for(i=0; i<num && queue_len < MAX_QUEUE; ++i)
+      queue[queue_len++] = p[i];
+  }
+
+  return 0;
+}
+
+s32 SEQ_MIDI_OUT_Handler(void)
+{
+  int i;
+  for(i=0; i<queue_len; ++i)
+    send_package(USB0, queue[i]);
+  queue_len = 0;
+  return 0;
+}
+
+
+// ------- reference encoding -------
+static u8 ref_data[MAX_FILE_SIZE];
+static u32 ref_len;
+
+static void ref_byte(u8 b)
+{
+  ref_data[ref_len++] = b;
+}
+
+static void ref_word(u32 word, int len)
+{
+  while( len-- )
+    ref_byte(word >> (8*len));
+}
+
+static u32 ref_varlen(u32 value)
+{
+  u8 bytes[5];
+  int num = 0;
+
+  bytes[num++] = value & 0x7f;
+  while( (value >>= 7) > 0 )
+    bytes[num++] = 0x80 | (value & 0x7f);
+
+  u32 size = num;
+  while( num-- )
+    ref_byte(bytes[num]);
+  return size;
+}
+
+static void ref_file(u8 first_track, u8 last_track, u32 number_ticks)
+{
+  u8 track;
+
+  ref_len = 0;
+  ref_word(0x4d546864, 4); // MThd
+  ref_word(6, 4);
+  ref_word(1, 2);
+  ref_word(last_track-first_track+1, 2);
+  ref_word(PPQN, 2);
+
+  for(track=first_track; track<=last_track; ++track) {
+    u32 size_pos, size = 0, last_tick = 0, tick;
+    mios32_midi_package_t p[2];
+    int i, num;
+
+    ref_word(0x4d54726b, 4); // MTrk
+    size_pos = ref_len;
+    ref_word(0, 4);
+
+    size += ref_varlen(0);
+    ref_byte(0xff);
+    ref_byte(0x03);
+    ref_byte(4);
+    ref_byte('G');
+    ref_byte('1' + track / SEQ_CORE_NUM_TRACKS_PER_GROUP);
+    ref_byte('T');
+    ref_byte('1' + track % SEQ_CORE_NUM_TRACKS_PER_GROUP);
+    size += 7;
+
+    for(tick=0; tick<number_ticks; ++tick) {
+      num = track_events(track, tick, p);
+      for(i=0; i<num; ++i) {
+	int len = (p[i].type == ProgramChange || p[i].type == Aftertouch) ? 2 : 3;
+	size += ref_varlen(tick - last_tick);
+	ref_byte(p[i].evnt0);
+	ref_byte(p[i].evnt1);
+	if( len == 3 )
+	  ref_byte(p[i].evnt2);
+	size += len;
+	last_tick = tick;
+      }
+    }
+
+    ref_data[size_pos+0] = size >> 24;
+    ref_data[size_pos+1] = size >> 16;
+    ref_data[size_pos+2] = size >> 8;
+    ref_data[size_pos+3] = size >> 0;
+  }
+}
+
+
+// ------- tests -------
+static u64 now_ns(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (u64)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static void check_cleanup(const char *name)
+{
+  if( file_is_open ) {
+    printf("ERROR: %s: file not closed\n", name);
+    ++errors;
+  }
+  if( sdcard_taken || midiout_taken ) {
+    printf("ERROR: %s: mutexes not given back\n", name);
+    ++errors;
+  }
+  if( send_package || hook_is_running || hook_tick_get || hook_bpm_set ) {
+    printf("ERROR: %s: MIDI scheduler hooks not restored\n", name);
+    ++errors;
+  }
+}
+
+static void test_export(const char *name, seq_midexp_mode_t mode, u8 first_track, u8 last_track, u16 measures)
+{
+  s32 status;
+  u32 number_ticks = (measures + 1) * 16 * (PPQN/4);
+
+  SEQ_MIDEXP_ModeSet(mode);
+  SEQ_MIDEXP_ExportMeasuresSet(measures);
+  SEQ_MIDEXP_ExportStepsPerMeasureSet(15);
+  file_num_writes = 0;
+  file_num_unaligned = 0;
+  sd_calls = sd_reads = sd_writes = 0;
+  ui_msgs = 0;
+
+  u64 t = now_ns();
+  if( (status=SEQ_MIDEXP_GenerateFile("/TEST.MID")) < 0 ) {
+    printf("ERROR: %s: export failed with status %d\n", name, status);
+    ++errors;
+  }
+  t = now_ns() - t;
+  check_cleanup(name);
+
+  ref_file(first_track, last_track, number_ticks);
+  if( file_len != ref_len || memcmp(file_data, ref_data, ref_len) != 0 ) {
+    u32 i;
+    for(i=0; i<file_len && i<ref_len && file_data[i] == ref_data[i]; ++i);
+    printf("ERROR: %s: file differs from reference at byte %u (%u/%u bytes)\n", name, i, file_len, ref_len);
+    ++errors;
+  }
+
+#ifndef TEST_PREVIOUS_EXPORTER
+  if( file_num_unaligned ) {
+    printf("ERROR: %s: %u writes cross a sector boundary\n", name, file_num_unaligned);
+    ++errors;
+  }
+#endif
+
+  u32 sd_ms = (sd_calls * SD_CALL_US + sd_reads * SD_SECTOR_READ_US + sd_writes * SD_SECTOR_WRITE_US) / 1000;
+  u32 ui_ms = ui_msgs ? (UI_DELAY_FIRST_MS + (ui_msgs - 1) * UI_DELAY_MS) : 0;
+  printf("%-12s %7u bytes, %6u writes (%u bytes per write), host %6.2f mS\n",
+	 name, file_len, file_num_writes, file_num_writes ? file_len / file_num_writes : 0, t / 1e6);
+  printf("%-12s target estimation: %6u FILE calls, %4u sector reads, %4u sector writes: %5u mS SD Card + %4u mS UI delays\n",
+	 "", sd_calls, sd_reads, sd_writes, sd_ms, ui_ms);
+}
+
+#ifndef TEST_PREVIOUS_EXPORTER
+static void test_error(const char *name, u32 *fail_ctr, u32 calls)
+{
+  s32 status;
+
+  SEQ_MIDEXP_ModeSet(SEQ_MIDEXP_MODE_AllGroups);
+  SEQ_MIDEXP_ExportMeasuresSet(1);
+  *fail_ctr = calls;
+
+  if( (status=SEQ_MIDEXP_GenerateFile("/TEST.MID")) >= 0 ) {
+    printf("ERROR: %s error not reported\n", name);
+    ++errors;
+  } else {
+    printf("%-12s error reported with status %d\n", name, status);
+  }
+  check_cleanup(name);
+
+  *fail_ctr = 0;
+}
+#endif
+
+
+int main(int argc, char *argv[])
+{
+  SEQ_MIDEXP_Init(0);
+#ifdef TEST_PREVIOUS_EXPORTER
+  printf("previous exporter:\n");
+#endif
+
+  test_export("All Groups", SEQ_MIDEXP_MODE_AllGroups, 0, SEQ_CORE_NUM_TRACKS-1, 3);
+  ui_selected_group = 2;
+  test_export("Group 3", SEQ_MIDEXP_MODE_Group, 2*SEQ_CORE_NUM_TRACKS_PER_GROUP, 3*SEQ_CORE_NUM_TRACKS_PER_GROUP-1, 7);
+  visible_track = 5;
+  test_export("Track G2T2", SEQ_MIDEXP_MODE_Track, 5, 5, 0);
+
+#ifndef TEST_PREVIOUS_EXPORTER
+  // (the previous exporter didn't report errors)
+  test_error("Open", &fail_open, 1);
+  test_error("Header", &fail_write, 1);
+  test_error("Write", &fail_write, 5);
+  test_error("Seek", &fail_seek, 3);
+  test_error("Close", &fail_close, 1);
+#endif
+
+  if( errors ) {
+    printf("%d errors\n", errors);
+    return 1;
+  }
+
+  printf("Export test passed.\n");
+  return 0;
+}
@@ -0,0 +1,109 @@
+// minimal MIOS32 environment to compile seq_statistics.c, seq_bpm.c,
+// seq_midi_out.c, seq_pattern.c, seq_file_b.c, seq_par.c and seq_midexp.c on the host
+#ifndef _MIOS32_H
+#define _MIOS32_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+typedef uint8_t  u8;
+typedef uint16_t u16;
+typedef uint32_t u32;
+typedef uint64_t u64;
+typedef int8_t   s8;
+typedef int16_t  s16;
+typedef int32_t  s32;
+
+typedef enum {
+  DEFAULT = 0x00,
+  USB0 = 0x10,
+  UART0 = 0x20,
+  UART1 = 0x21,
+} mios32_midi_port_t;
+
+typedef enum {
+  Chn1, Chn2, Chn3, Chn4, Chn5, Chn6, Chn7, Chn8,
+  Chn9, Chn10, Chn11, Chn12, Chn13, Chn14, Chn15, Chn16
+} mios32_midi_chn_t;
+
+typedef enum {
+  NoteOff       = 0x8,
+  NoteOn        = 0x9,
+  PolyPressure  = 0xa,
+  CC            = 0xb,
+  ProgramChange = 0xc,
+  Aftertouch    = 0xd,
+  PitchBend     = 0xe
+} mios32_midi_event_t;
+
+typedef union {
+  u32 ALL;
+  struct {
+    u8 cin_cable;
+    u8 evnt0;
+    u8 evnt1;
+    u8 evnt2;
+  };
+  struct {
+    u8 type:4;
+    u8 cable:4;
+    u8 chn:4;
+    u8 event:4;
+    u8 value1;
+    u8 value2;
+  };
+  struct {
+    u8 cin:4;
+    u8 dummy1_cable:4;
+    u8 dummy1_chn:4;
+    u8 dummy1_event:4;
+    u8 note;
+    u8 velocity;
+  };
+} mios32_midi_package_t;
+
+typedef struct {
+  u32 seconds;
+  u16 fraction_ms;
+} mios32_sys_time_t;
+
+// simulated time, 100 timestamp ticks per uS
+extern u32 test_time_us;
+#define SEQ_STATISTICS_TIMING 1
+#define SEQ_STATISTICS_TIMING_TICKS_PER_US 100
+#define SEQ_STATISTICS_TIMING_CYCLES 0
+#define SEQ_BPM_TICK_TIMESTAMP() (test_time_us * 100)
+
+#define SEQ_MIDI_OUT_MAX_EVENTS 256
+#define SEQ_MIDI_OUT_MALLOC_ANALYSIS 1
+
+#define MAX_IDLE_CTR 1000
+
+// no FreeRTOS (see ../core/tasks.h), the statistics are only updated from the simulated MIDI task
+// TEST_CRITICAL_HOOKS: the test tracks critical sections (see pattern_test.c)
+#ifdef TEST_CRITICAL_HOOKS
+extern void TEST_EnterCritical(void);
+extern void TEST_ExitCritical(void);
+#define portENTER_CRITICAL() TEST_EnterCritical()
+#define portEXIT_CRITICAL()  TEST_ExitCritical()
+#else
+#define portENTER_CRITICAL() do {} while(0)
+#define portEXIT_CRITICAL()  do {} while(0)
+#endif
+
+#define MIOS32_IRQ_PRIO_HIGHEST 4
+#define MIOS32_IRQ_Disable() do {} while(0)
+#define MIOS32_IRQ_Enable()  do {} while(0)
+
+extern s32 MIOS32_TIMER_Init(u8 timer, u32 period, void (*_irq_handler)(void), u8 irq_priority);
+extern s32 MIOS32_TIMER_ReInit(u8 timer, u32 period);
+extern s32 MIOS32_MIDI_SendPackage(mios32_midi_port_t port, mios32_midi_package_t package);
+extern s32 MIOS32_MIDI_SendPackageMulti(mios32_midi_port_t port, mios32_midi_package_t *packages, u32 num);
+extern mios32_sys_time_t MIOS32_SYS_TimeGet(void);
+extern s32 MIOS32_STOPWATCH_Init(u32 resolution);
+extern s32 MIOS32_STOPWATCH_Reset(void);
+extern u32 MIOS32_STOPWATCH_ValueGet(void);
+#define MIOS32_MIDI_SendDebugMessage printf
+#define DEBUG_MSG MIOS32_MIDI_SendDebugMessage
+
+#endif /* _MIOS32_H */
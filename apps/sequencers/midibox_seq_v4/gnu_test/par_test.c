@@ -0,0 +1,246 @@
+// Host test of the parameter layer step fetch
+//
+// Partitions a track with different layouts (steps, layers, instruments),
+// fills it with random values and checks that SEQ_PAR_StepGet() returns the
+// same values like SEQ_PAR_Get() for each layer. Covers mirrored steps
+// (step >= number of steps), instruments which are not available, and
+// layouts with more than SEQ_PAR_MAX_LAYERS layers (which could be read from
+// a bank or track file): the values[] buffer must never be written beyond
+// SEQ_PAR_MAX_LAYERS entries.
+//
+// The benchmark measures the step fetch of the sequencer at 16 tracks with
+// all layers active (64 steps, 16 parameter and 8 trigger layers). Each tick
+// advances all tracks to the next step, as if they would run with the
+// fastest clock divider, and fetches the triggers which are checked by
+// SEQ_CORE_Tick() and all parameter layers: with one SEQ_PAR_Get() call per
+// layer (as SEQ_LAYER_GetEvents() did before), and with SEQ_PAR_StepGet().
+// Both variants have to return the same values.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "mios32.h"
+#include "seq_par.h"
+#include "seq_trg.h"
+#include "seq_cc.h"
+#include "seq_core.h"
+
+#define GUARD_BYTES 16
+#define GUARD_VALUE 0xaa
+
+#define BENCH_TRACKS 16
+#define BENCH_STEPS  64
+#define BENCH_TICKS  200000
+
+// referenced by seq_par.c
+seq_cc_trk_t seq_cc_trk[SEQ_CORE_NUM_TRACKS];
+seq_core_options_t seq_core_options;
+
+s32 SEQ_CC_Get(u8 track, u8 cc)
+{
+  return 0;
+}
+
+static int errors;
+static u32 num_layouts;
+static u32 num_fetches;
+
+
+static void check_layout(u8 track, u16 steps, u8 layers, u8 instruments)
+{
+  u8 values[SEQ_PAR_MAX_LAYERS + GUARD_BYTES];
+  u8 expected_layers = (layers > SEQ_PAR_MAX_LAYERS) ? SEQ_PAR_MAX_LAYERS : layers;
+  u16 step;
+  u8 layer, instrument;
+  int i;
+
+  if( SEQ_PAR_TrackInit(track, steps, layers, instruments) < 0 ) {
+    printf("ERROR: layout %d steps, %d layers, %d instruments rejected\n", steps, layers, instruments);
+    ++errors;
+    return;
+  }
+  ++num_layouts;
+
+  for(instrument=0; instrument<instruments; ++instrument)
+    for(layer=0; layer<layers; ++layer)
+      for(step=0; step<steps; ++step)
+	SEQ_PAR_Set(track, step, layer, instrument, rand() & 0x7f);
+
+  // one instrument more than available: no values
+  for(instrument=0; instrument<=instruments; ++instrument) {
+    // twice the number of steps: mirrored steps
+    for(step=0; step<2*steps; ++step) {
+      s32 num;
+
+      memset(values, GUARD_VALUE, sizeof(values));
+      num = SEQ_PAR_StepGet(track, step, instrument, values);
+      ++num_fetches;
+
+      if( num != ((instrument < instruments) ? expected_layers : 0) ) {
+	printf("ERROR: %d steps, %d layers, %d instruments: got %d layers for instrument %d\n",
+	       steps, layers, instruments, num, instrument);
+	++errors;
+	return;
+      }
+
+      for(i=0; i<SEQ_PAR_MAX_LAYERS; ++i) {
+	u8 expected = (i < num) ? SEQ_PAR_Get(track, step, i, instrument) : 0;
+	if( values[i] != expected ) {
+	  printf("ERROR: %d steps, %d layers, %d instruments: instrument %d step %d layer %d is %d, expected %d\n",
+		 steps, layers, instruments, instrument, step, i, values[i], expected);
+	  ++errors;
+	  return;
+	}
+      }
+
+      for(i=SEQ_PAR_MAX_LAYERS; i<sizeof(values); ++i) {
+	if( values[i] != GUARD_VALUE ) {
+	  printf("ERROR: %d steps, %d layers, %d instruments: values[] overrun at %d\n",
+		 steps, layers, instruments, i);
+	  ++errors;
+	  return;
+	}
+      }
+    }
+  }
+}
+
+
+static u64 now_ns(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (u64)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+// returns the checksum of all fetched triggers and parameters
+static u32 bench_ticks(u8 use_step_get, double *ticks_per_s)
+{
+  u32 checksum = 0;
+  u32 tick;
+  u64 t;
+
+  t = now_ns();
+  for(tick=0; tick<BENCH_TICKS; ++tick) {
+    u16 step = tick % BENCH_STEPS;
+    u8 track;
+
+    for(track=0; track<BENCH_TRACKS; ++track) {
+      u8 values[SEQ_PAR_MAX_LAYERS];
+      u8 layer;
+      u32 triggers =
+	(SEQ_TRG_GateGet(track, step, 0) << 0) |
+	(SEQ_TRG_AccentGet(track, step, 0) << 1) |
+	(SEQ_TRG_RollGet(track, step, 0) << 2) |
+	(SEQ_TRG_GlideGet(track, step, 0) << 3) |
+	(SEQ_TRG_SkipGet(track, step, 0) << 4) |
+	(SEQ_TRG_RandomGateGet(track, step, 0) << 5) |
+	(SEQ_TRG_NoFxGet(track, step, 0) << 6) |
+	(SEQ_TRG_RollGateGet(track, step, 0) << 7);
+
+      if( use_step_get ) {
+	SEQ_PAR_StepGet(track, step, 0, values);
+      } else {
+	for(layer=0; layer<SEQ_PAR_MAX_LAYERS; ++layer)
+	  values[layer] = SEQ_PAR_Get(track, step, layer, 0);
+      }
+
+      checksum = checksum * 31 + triggers;
+      for(layer=0; layer<SEQ_PAR_MAX_LAYERS; ++layer)
+	checksum = checksum * 31 + values[layer];
+    }
+  }
+  t = now_ns() - t;
+
+  *ticks_per_s = BENCH_TICKS / (t / 1e9);
+  return checksum;
+}
+
+static void benchmark(void)
+{
+  double ticks_per_s_get, ticks_per_s_step_get;
+  u32 checksum_get, checksum_step_get;
+  u8 track, layer;
+  u16 step;
+
+  for(track=0; track<BENCH_TRACKS; ++track) {
+    seq_trg_assignments_t *trg = &seq_cc_trk[track].trg_assignments;
+
+    SEQ_PAR_TrackInit(track, BENCH_STEPS, SEQ_PAR_MAX_LAYERS, 1);
+    SEQ_TRG_TrackInit(track, BENCH_STEPS, 8, 1);
+
+    trg->ALL = 0;
+    trg->gate = 1;
+    trg->accent = 2;
+    trg->roll = 3;
+    trg->glide = 4;
+    trg->skip = 5;
+    trg->random_gate = 6;
+    trg->no_fx = 7;
+    trg->roll_gate = 8;
+
+    for(step=0; step<BENCH_STEPS; ++step) {
+      for(layer=0; layer<SEQ_PAR_MAX_LAYERS; ++layer)
+	SEQ_PAR_Set(track, step, layer, 0, rand() & 0x7f);
+      for(layer=0; layer<8; ++layer)
+	SEQ_TRG_Set(track, step, layer, 0, (rand() & 3) == 0);
+    }
+  }
+
+  checksum_get = bench_ticks(0, &ticks_per_s_get);
+  checksum_step_get = bench_ticks(1, &ticks_per_s_step_get);
+
+  printf("%d tracks, %d steps, %d parameter and 8 trigger layers, step change on each tick:\n",
+	 BENCH_TRACKS, BENCH_STEPS, SEQ_PAR_MAX_LAYERS);
+  printf("SEQ_PAR_Get() per layer: %10.0f ticks/s\n", ticks_per_s_get);
+  printf("SEQ_PAR_StepGet():       %10.0f ticks/s\n", ticks_per_s_step_get);
+
+  if( checksum_get != checksum_step_get ) {
+    printf("ERROR: the benchmark fetched different values (%08x vs. %08x)\n", checksum_get, checksum_step_get);
+    ++errors;
+  }
+}
+
+
+int main(int argc, char *argv[])
+{
+  static const u16 steps_list[] = { 1, 16, 32, 64, 128, 256, 1024 };
+  static const u8 layers_list[] = { 1, 2, 4, 8, 16, 17, 32, 64 };
+  static const u8 instruments_list[] = { 1, 2, 4, 16 };
+  int s, l, i;
+
+  srand(1);
+  SEQ_PAR_Init(0);
+
+  for(s=0; s<sizeof(steps_list)/sizeof(u16); ++s)
+    for(l=0; l<sizeof(layers_list); ++l)
+      for(i=0; i<sizeof(instruments_list); ++i) {
+	u16 steps = steps_list[s];
+	u8 layers = layers_list[l];
+	u8 instruments = instruments_list[i];
+
+	if( (steps * layers * instruments) > SEQ_PAR_MAX_BYTES ) {
+	  // invalid layouts have to be rejected
+	  if( SEQ_PAR_TrackInit(0, steps, layers, instruments) >= 0 ) {
+	    printf("ERROR: layout %d steps, %d layers, %d instruments not rejected\n", steps, layers, instruments);
+	    ++errors;
+	  }
+	  continue;
+	}
+
+	check_layout((s + l + i) % SEQ_CORE_NUM_TRACKS, steps, layers, instruments);
+      }
+
+  printf("%u layouts, %u step fetches checked\n", num_layouts, num_fetches);
+
+  benchmark();
+
+  if( errors ) {
+    printf("%d errors\n", errors);
+    return 1;
+  }
+
+  printf("Step fetch test passed.\n");
+  return 0;
+}
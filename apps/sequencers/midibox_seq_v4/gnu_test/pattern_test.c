@@ -0,0 +1,517 @@
+// Host test of the pattern switch latency
+//
+// Simulates synched pattern changes with the real seq_pattern.c: patterns are
+// requested at random times within a measure and switched at the end of the
+// measure by SEQ_PATTERN_Handler(). Meanwhile the low-prio task prefetches
+// them with SEQ_PATTERN_PrefetchHandler(), and other tasks access the SD Card
+// in background. SD Card and parsing costs are accounted in simulated time.
+//
+// The test reports how long the sequencer is blocked per switch, and checks
+// that always the latest version of a pattern is loaded. Races between the
+// cache check of SEQ_PATTERN_Handler() and its critical section (changed
+// requests, invalidated cache slots) are injected on purpose: the SD Card
+// mutex must never be taken within a critical section.
+//
+// The patterns are fetched, parsed and stored by the real seq_file_b.c in
+// bank files on a simulated SD Card, created in the default bank format.
+// Each stored pattern gets a name with its bank, number and version, so
+// that the loaded version can be checked after the switch.
+//
+// pattern_test uses the default cache and expects that most switches are
+// served from it, pattern_test_nocache is compiled with
+// SEQ_PATTERN_CACHE_NUM_SLOTS 0 and TEST_NO_CACHE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "mios32.h"
+#include "tasks.h"
+#include "seq_pattern.h"
+#include "seq_core.h"
+#include "seq_cc.h"
+#include "seq_par.h"
+#include "seq_trg.h"
+#include "seq_file.h"
+#include "seq_file_b.h"
+#include "file.h"
+
+#define NUM_MEASURES        1000
+#define MEASURE_MS          2000 // 4/4 at 120 BPM
+
+#define SD_READ_US          12000 // read a pattern from the bank file
+#define SD_WRITE_US         25000 // store a pattern
+#define PARSE_US            400   // copy a pattern into the tracks
+
+#define BG_ACCESS_RATE      250   // a background SD Card access starts each 250 mS in average...
+#define BG_ACCESS_MIN_US    2000  // ...and takes 2..40 mS
+#define BG_ACCESS_RANGE_US  38000
+
+#define NUM_PATTERNS        64
+
+// header of the bank file and 64 patterns in the default format
+#define BANK_FILE_SIZE      (10 + 24 + NUM_PATTERNS * SEQ_FILE_B_PATTERN_SIZE(SEQ_CORE_NUM_TRACKS_PER_GROUP, SEQ_PAR_MAX_BYTES, SEQ_TRG_MAX_BYTES))
+
+u32 test_time_us;
+
+seq_core_options_t seq_core_options;
+seq_core_state_t seq_core_state;
+u16 seq_core_trk_muted;
+u16 seq_core_trk_synched_mute;
+u16 seq_core_trk_synched_unmute;
+u8 seq_core_pattern_switch_margin_ms;
+char seq_file_session_name[13];
+u8 ui_seq_pause;
+seq_core_trk_t seq_core_trk[SEQ_CORE_NUM_TRACKS];
+u8 seq_par_layer_value[SEQ_CORE_NUM_TRACKS][SEQ_PAR_MAX_BYTES];
+u8 seq_trg_layer_value[SEQ_CORE_NUM_TRACKS][SEQ_TRG_MAX_BYTES];
+
+static int errors;
+
+// simulated SD Card: bank files, content version of each pattern, busy until given time
+static u8 bank_file[SEQ_FILE_B_NUM_BANKS][BANK_FILE_SIZE];
+static u32 bank_file_len[SEQ_FILE_B_NUM_BANKS];
+static s32 read_bank = -1;
+static u32 read_pos;
+static s32 write_bank = -1;
+static u32 write_pos;
+static u32 pattern_version[SEQ_FILE_B_NUM_BANKS][NUM_PATTERNS];
+static u32 sd_busy_until_us;
+static u32 sd_mutex_depth;
+static u32 sd_reads_in_handler;
+
+// 1: the sequencer executes SEQ_PATTERN_Handler(), costs block the sequencer
+// 0: background task, SD Card costs delay other SD Card accesses only
+static u8 in_handler;
+
+static u32 critical_nesting;
+static void (*race_hook)(void);
+static u8 race_group;
+
+
+// ------- local helpers -------
+static void check(int condition, const char *msg)
+{
+  if( !condition ) {
+    printf("ERROR at %u mS: %s\n", test_time_us / 1000, msg);
+    ++errors;
+  }
+}
+
+static void sd_access(u32 us)
+{
+  if( in_handler ) {
+    test_time_us += us;
+  } else {
+    if( (s32)(test_time_us - sd_busy_until_us) > 0 )
+      sd_busy_until_us = test_time_us;
+    sd_busy_until_us += us;
+  }
+}
+
+
+// ------- FreeRTOS and MIOS32 stubs -------
+void TEST_EnterCritical(void)
+{
+  // inject a race: another task runs right before the critical section is entered
+  if( race_hook && critical_nesting == 0 ) {
+    void (*hook)(void) = race_hook;
+    u8 prev_in_handler = in_handler;
+    race_hook = NULL;
+    in_handler = 0;
+    hook();
+    in_handler = prev_in_handler;
+  }
+
+  ++critical_nesting;
+}
+
+void TEST_ExitCritical(void)
+{
+  check(critical_nesting > 0, "unbalanced critical section");
+  --critical_nesting;
+}
+
+void TASKS_SDCardSemaphoreTake(void)
+{
+  if( sd_mutex_depth == 0 ) {
+    check(critical_nesting == 0, "SD Card mutex taken within a critical section (hangs on the target)");
+
+    // wait for the ongoing SD Card access
+    if( in_handler && (s32)(sd_busy_until_us - test_time_us) > 0 )
+      test_time_us = sd_busy_until_us;
+  }
+  ++sd_mutex_depth;
+}
+
+void TASKS_SDCardSemaphoreGive(void)
+{
+  check(sd_mutex_depth > 0, "SD Card mutex given without take");
+  --sd_mutex_depth;
+}
+
+void TASKS_MIDIOUTSemaphoreTake(void) {}
+void TASKS_MIDIOUTSemaphoreGive(void) {}
+
+mios32_sys_time_t MIOS32_SYS_TimeGet(void)
+{
+  mios32_sys_time_t t = { test_time_us / 1000000, (test_time_us / 1000) % 1000 };
+  return t;
+}
+
+s32 MIOS32_STOPWATCH_Reset(void) { return 0; }
+u32 MIOS32_STOPWATCH_ValueGet(void) { return 0; }
+
+
+// ------- sequencer stubs -------
+u32 SEQ_BPM_TickGet(void) { return 1 + test_time_us / 1000; }
+s32 SEQ_BPM_IsRunning(void) { return 1; }
+s32 SEQ_SONG_ActiveGet(void) { return 0; }
+s32 SEQ_CORE_AddForwardDelay(u16 delay_ms) { return 0; }
+s32 SEQ_CORE_CancelSustainedNotes(u8 track) { return 0; }
+s32 SEQ_LAYER_ResetLatchedValues(void) { return 0; }
+s32 SEQ_LAYER_SendPCBankValues(u8 track, u8 force, u8 send_now) { return 0; }
+s32 SEQ_MIXER_NumSet(u8 map) { return 0; }
+s32 SEQ_MIXER_Load(u8 map) { return 0; }
+s32 SEQ_MIXER_SendAllByChannel(u8 chn) { return 0; }
+
+s32 SEQ_UI_SDCardErrMsg(u16 delay, s32 status)
+{
+  check(0, "SD Card error message");
+  return 0;
+}
+
+
+// ------- simulated SD Card -------
+static s32 bank_of_path(char *filepath)
+{
+  char *name = strrchr(filepath, '/');
+  int bank;
+
+  if( !name || sscanf(name, "/MBSEQ_B%d.V4", &bank) != 1 || bank < 1 || bank > SEQ_FILE_B_NUM_BANKS )
+    return -1;
+  return bank - 1;
+}
+
+s32 FILE_ReadOpen(file_t* file, char *filepath)
+{
+  s32 bank = bank_of_path(filepath);
+  if( bank < 0 || !bank_file_len[bank] )
+    return FILE_ERR_OPEN_READ;
+
+  file->org_clust = bank;
+  return FILE_ReadReOpen(file);
+}
+
+s32 FILE_ReadReOpen(file_t* file)
+{
+  check(sd_mutex_depth > 0, "bank file read without SD Card mutex");
+  if( read_bank >= 0 )
+    return FILE_ERR_OPEN_READ_WITHOUT_CLOSE;
+
+  read_bank = file->org_clust;
+  read_pos = 0;
+
+  // each access seeks to and reads a pattern
+  sd_access(SD_READ_US);
+  if( in_handler )
+    ++sd_reads_in_handler;
+  return 0;
+}
+
+s32 FILE_ReadClose(file_t* file)
+{
+  read_bank = -1;
+  return 0;
+}
+
+s32 FILE_ReadSeek(u32 offset)
+{
+  if( read_bank < 0 || offset > bank_file_len[read_bank] )
+    return FILE_ERR_SEEK;
+  read_pos = offset;
+  return 0;
+}
+
+u32 FILE_ReadGetCurrentPosition(void)
+{
+  return read_pos;
+}
+
+s32 FILE_ReadBuffer(u8 *buffer, u32 len)
+{
+  if( read_bank < 0 || read_pos + len > bank_file_len[read_bank] )
+    return FILE_ERR_READ;
+  memcpy(buffer, &bank_file[read_bank][read_pos], len);
+  read_pos += len;
+  return 0;
+}
+
+s32 FILE_ReadHWord(u16 *hword)
+{
+  u8 tmp[2];
+  s32 status = FILE_ReadBuffer(tmp, 2);
+  *hword = tmp[0] | ((u16)tmp[1] << 8);
+  return status;
+}
+
+s32 FILE_WriteOpen(char *filepath, u8 create)
+{
+  s32 bank = bank_of_path(filepath);
+
+  check(sd_mutex_depth > 0, "bank file written without SD Card mutex");
+  if( bank < 0 || (!create && !bank_file_len[bank]) )
+    return FILE_ERR_OPEN_WRITE;
+  if( write_bank >= 0 )
+    return FILE_ERR_OPEN_WRITE_WITHOUT_CLOSE;
+
+  write_bank = bank;
+  write_pos = 0;
+  if( create )
+    bank_file_len[bank] = 0;
+
+  sd_access(SD_WRITE_US);
+  return 0;
+}
+
+s32 FILE_WriteClose(void)
+{
+  write_bank = -1;
+  return 0;
+}
+
+s32 FILE_WriteSeek(u32 offset)
+{
+  if( write_bank < 0 || offset > bank_file_len[write_bank] )
+    return FILE_ERR_SEEK;
+  write_pos = offset;
+  return 0;
+}
+
+s32 FILE_WriteBuffer(u8 *buffer, u32 len)
+{
+  if( write_bank < 0 || write_pos + len > BANK_FILE_SIZE )
+    return FILE_ERR_WRITE;
+  memcpy(&bank_file[write_bank][write_pos], buffer, len);
+  write_pos += len;
+  if( write_pos > bank_file_len[write_bank] )
+    bank_file_len[write_bank] = write_pos;
+  return 0;
+}
+
+s32 FILE_WriteByte(u8 byte)
+{
+  return FILE_WriteBuffer(&byte, 1);
+}
+
+s32 FILE_WriteHWord(u16 hword)
+{
+  u8 tmp[2] = { hword & 0xff, hword >> 8 };
+  return FILE_WriteBuffer(tmp, 2);
+}
+
+
+// ------- track stubs: all tracks use the default layer configuration -------
+s32 SEQ_PAR_NumInstrumentsGet(u8 track) { return 1; }
+s32 SEQ_PAR_NumLayersGet(u8 track) { return 16; }
+s32 SEQ_PAR_NumStepsGet(u8 track) { return 64; }
+s32 SEQ_TRG_NumInstrumentsGet(u8 track) { return 1; }
+s32 SEQ_TRG_NumLayersGet(u8 track) { return 8; }
+s32 SEQ_TRG_NumStepsGet(u8 track) { return 256; }
+s32 SEQ_TRG_TrackInit(u8 track, u16 steps, u8 trg_layers, u8 instruments) { return 0; }
+s32 SEQ_CC_Set(u8 track, u8 cc, u8 value) { return 0; }
+s32 SEQ_CC_Get(u8 track, u8 cc) { return 0; }
+s32 SEQ_CC_LinkUpdate(u8 track) { return 0; }
+
+s32 SEQ_PAR_TrackInit(u8 track, u16 steps, u8 par_layers, u8 instruments)
+{
+  // the pattern is taken over track by track
+  if( in_handler )
+    test_time_us += PARSE_US / SEQ_CORE_NUM_TRACKS_PER_GROUP;
+  return 0;
+}
+
+
+// ------- pattern versions -------
+// the name of a stored pattern contains its bank, number and version
+static void store_pattern(u8 group, seq_pattern_t p)
+{
+  char name[32];
+  snprintf(name, sizeof(name), "B%u P%02u V%-12u", p.bank, p.pattern, ++pattern_version[p.bank][p.pattern]);
+  memcpy(seq_pattern_name[group], name, 20);
+  seq_pattern_name[group][20] = 0;
+  SEQ_PATTERN_Save(group, p);
+}
+
+static void create_banks(void)
+{
+  u8 bank, pattern;
+
+  TASKS_SDCardSemaphoreTake();
+  for(bank=0; bank<SEQ_FILE_B_NUM_BANKS; ++bank) {
+    check(SEQ_FILE_B_Create(seq_file_session_name, bank) >= 0, "bank file can't be created");
+    for(pattern=0; pattern<NUM_PATTERNS; ++pattern) {
+      seq_pattern_t p;
+      p.ALL = 0;
+      p.bank = bank;
+      p.pattern = pattern;
+      TASKS_SDCardSemaphoreGive();
+      store_pattern(0, p);
+      TASKS_SDCardSemaphoreTake();
+    }
+  }
+  check(SEQ_FILE_B_LoadAllBanks(seq_file_session_name) >= 0, "bank files can't be opened");
+  TASKS_SDCardSemaphoreGive();
+
+  test_time_us = 0;
+  sd_busy_until_us = 0;
+}
+
+
+// ------- races -------
+static seq_pattern_t random_pattern(void)
+{
+  seq_pattern_t p;
+  p.ALL = 0;
+  p.bank = rand() % SEQ_FILE_B_NUM_BANKS;
+  p.pattern = rand() % NUM_PATTERNS;
+  return p;
+}
+
+// the UI stores the requested pattern, so that the cache slot is invalidated
+static void race_store_requested_pattern(void)
+{
+  store_pattern(race_group, seq_pattern_req[race_group]);
+}
+
+// the UI requests another pattern which isn't cached yet
+static void race_change_request(void)
+{
+  SEQ_PATTERN_Change(race_group, random_pattern(), 0);
+}
+
+
+// ------- simulation -------
+int main(int argc, char *argv[])
+{
+  u32 measure, ms, group;
+  u32 num_switches = 0;
+  u32 num_switches_from_cache = 0;
+  u32 num_races = 0;
+  u64 latency_sum_us = 0;
+  u32 latency_max_us = 0;
+
+  srand(1);
+
+  seq_core_options.SYNCHED_PATTERN_CHANGE = 1;
+  strcpy(seq_file_session_name, "TEST");
+  SEQ_PATTERN_Init(0);
+  SEQ_FILE_B_Init(0);
+  create_banks();
+
+  for(measure=0; measure<NUM_MEASURES; ++measure) {
+    // request times of the groups within this measure (0: no request)
+    u32 request_ms[SEQ_CORE_NUM_GROUPS];
+    for(group=0; group<SEQ_CORE_NUM_GROUPS; ++group) {
+      if( rand() % 2 )
+	request_ms[group] = 0;
+      else if( rand() % 8 )
+	request_ms[group] = 1 + rand() % (MEASURE_MS - 200);
+      else
+	request_ms[group] = MEASURE_MS - 1 - rand() % 20; // too late for a prefetch
+    }
+
+    for(ms=0; ms<MEASURE_MS; ++ms, test_time_us += 1000) {
+      for(group=0; group<SEQ_CORE_NUM_GROUPS; ++group) {
+	if( request_ms[group] && request_ms[group] == ms )
+	  SEQ_PATTERN_Change(group, random_pattern(), 0);
+      }
+
+      // other tasks access the SD Card, e.g. the UI stores a pattern
+      if( (s32)(test_time_us - sd_busy_until_us) >= 0 ) {
+	if( (rand() % 2000) == 0 ) {
+	  group = rand() % SEQ_CORE_NUM_GROUPS;
+	  if( seq_pattern_req[group].REQ )
+	    store_pattern(group, seq_pattern_req[group]);
+	} else if( (rand() % BG_ACCESS_RATE) == 0 ) {
+	  sd_busy_until_us = test_time_us + BG_ACCESS_MIN_US + rand() % BG_ACCESS_RANGE_US;
+	}
+      }
+
+      // low-prio task: has to wait for the SD Card
+      if( (s32)(test_time_us - sd_busy_until_us) >= 0 )
+	SEQ_PATTERN_PrefetchHandler();
+    }
+
+    // end of measure: switch the requested patterns
+    u8 requested = 0;
+    for(group=0; group<SEQ_CORE_NUM_GROUPS; ++group) {
+      if( seq_pattern_req[group].REQ )
+	requested |= (1 << group);
+    }
+    if( !requested )
+      continue;
+
+    if( (measure % 8) == 7 ) {
+      race_group = __builtin_ctz(requested);
+      race_hook = (measure % 16) == 7 ? race_store_requested_pattern : race_change_request;
+      ++num_races;
+    }
+
+    in_handler = 1;
+    sd_reads_in_handler = 0;
+    u32 start_us = test_time_us;
+    SEQ_PATTERN_Handler();
+    u32 latency_us = test_time_us - start_us;
+    in_handler = 0;
+    race_hook = NULL;
+
+    check(critical_nesting == 0, "critical section left open");
+    check(sd_mutex_depth == 0, "SD Card mutex not given");
+
+    for(group=0; group<SEQ_CORE_NUM_GROUPS; ++group) {
+      if( seq_pattern_req[group].REQ ) {
+	check(0, "request not processed");
+      } else if( requested & (1 << group) ) {
+	seq_pattern_t p = seq_pattern[group];
+	unsigned bank, pattern, version;
+	if( sscanf(seq_pattern_name[group], "B%u P%u V%u", &bank, &pattern, &version) != 3 ) {
+	  check(0, "no pattern loaded");
+	} else if( bank != p.bank || pattern != p.pattern ) {
+	  check(0, "wrong pattern loaded");
+	} else if( version != pattern_version[p.bank][p.pattern] ) {
+	  check(0, "outdated pattern loaded");
+	}
+      }
+    }
+
+    ++num_switches;
+    if( !sd_reads_in_handler )
+      ++num_switches_from_cache;
+    latency_sum_us += latency_us;
+    if( latency_us > latency_max_us )
+      latency_max_us = latency_us;
+
+    // test time continues after the switch
+    test_time_us = start_us;
+  }
+
+  printf("%s: %u pattern switches, %u without SD Card access, %u injected races\n",
+	 argv[0], num_switches, num_switches_from_cache, num_races);
+  printf("Sequencer blocked per switch: avg %u.%03u mS, max %u.%03u mS\n",
+	 (u32)(latency_sum_us / num_switches) / 1000, (u32)(latency_sum_us / num_switches) % 1000,
+	 latency_max_us / 1000, latency_max_us % 1000);
+
+#ifndef TEST_NO_CACHE
+  // most requests are early enough for a prefetch
+  if( num_switches_from_cache * 2 < num_switches )
+    check(0, "the pattern cache is not effective, does a pattern of the default bank fit into a cache slot?");
+#endif
+
+  if( errors ) {
+    printf("%d errors\n", errors);
+    return 1;
+  }
+
+  printf("Test passed.\n");
+  return 0;
+}
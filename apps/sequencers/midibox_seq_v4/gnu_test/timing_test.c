@@ -0,0 +1,357 @@
+// Host test of the MBSEQ timing statistics
+//
+// Simulates a heavy session (16 tracks playing 4 note chords on each step,
+// MIDI clock output) with the real BPM generator and MIDI scheduler:
+// the BPM timer fires at 120 BPM/384 ppqn, the MIDI task is executed each mS,
+// handler and MIDI output costs are accounted in simulated time.
+// A long SD card access delays the MIDI task once.
+// Afterwards the collected histograms are checked.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "mios32.h"
+#include <seq_bpm.h>
+#include <seq_midi_out.h>
+#include "seq_statistics.h"
+
+#define SESSION_MS          10000
+#define STALL_TICK          (40*96 - 2) // two ticks before a step
+#define STALL_US            10000
+
+#define TICK_COST_US        10
+#define EVENT_COST_US       3
+#define SEND_COST_US        4
+#define SEND_BLOCK_COST_US  1 // per package of a USB block
+
+#define NUM_TRACKS          16
+#define NOTES_PER_STEP      4
+#define NOTE_LENGTH         48
+
+u32 test_time_us;
+
+static void (*timer_handler)(void);
+static u32 timer_period_us;
+static u32 timer_next_us;
+
+static int errors;
+
+static u32 sent_events[3]; // USB0, UART0, UART1
+static u32 sent_blocks;
+static u32 sent_block_events;
+static u32 queue_depth_max;
+
+
+// ------- MIOS32 stubs -------
+s32 MIOS32_TIMER_Init(u8 timer, u32 period, void (*_irq_handler)(void), u8 irq_priority)
+{
+  timer_handler = _irq_handler;
+  timer_period_us = period;
+  timer_next_us = test_time_us + period;
+  return 0;
+}
+
+s32 MIOS32_TIMER_ReInit(u8 timer, u32 period)
+{
+  timer_period_us = period;
+  return 0;
+}
+
+mios32_sys_time_t MIOS32_SYS_TimeGet(void)
+{
+  mios32_sys_time_t t = { test_time_us / 1000000, (test_time_us / 1000) % 1000 };
+  return t;
+}
+
+s32 MIOS32_STOPWATCH_Init(u32 resolution) { return 0; }
+s32 MIOS32_STOPWATCH_Reset(void) { return 0; }
+u32 MIOS32_STOPWATCH_ValueGet(void) { return 0; }
+
+// time advances while events are sent
+static void run_us(u32 us);
+static void count_event(mios32_midi_port_t port)
+{
+  switch( port ) {
+  case USB0:  ++sent_events[0]; break;
+  case UART0: ++sent_events[1]; break;
+  case UART1: ++sent_events[2]; break;
+  default: break;
+  }
+}
+
+s32 MIOS32_MIDI_SendPackage(mios32_midi_port_t port, mios32_midi_package_t package)
+{
+  count_event(port);
+  run_us(SEND_COST_US);
+  return 0;
+}
+
+// USB packages are copied into the Tx buffer as one block,
+// other ports send each package (like mios32_midi.c)
+s32 MIOS32_MIDI_SendPackageMulti(mios32_midi_port_t port, mios32_midi_package_t *packages, u32 num)
+{
+  ++sent_blocks;
+  sent_block_events += num;
+
+  if( port == USB0 ) {
+    u32 i;
+    for(i=0; i<num; ++i)
+      count_event(port);
+    run_us(SEND_COST_US + num*SEND_BLOCK_COST_US);
+  } else {
+    for(; num; --num, ++packages)
+      MIOS32_MIDI_SendPackage(port, *packages);
+  }
+  return 0;
+}
+
+
+// ------- local helpers -------
+
+// advances the simulated time and calls the BPM timer interrupt
+static void run_us(u32 us)
+{
+  u32 end = test_time_us + us;
+  while( timer_handler != NULL && (s32)(end - timer_next_us) >= 0 ) {
+    test_time_us = timer_next_us;
+    timer_handler();
+    timer_next_us += timer_period_us;
+  }
+  test_time_us = end;
+}
+
+static void check(int condition, const char *msg)
+{
+  if( !condition ) {
+    printf("ERROR: %s\n", msg);
+    ++errors;
+  }
+}
+
+static u32 histogram_sum(const seq_statistics_histogram_t *h)
+{
+  u32 sum = 0;
+  int bin;
+  for(bin=0; bin<SEQ_STATISTICS_HISTOGRAM_BINS; ++bin)
+    sum += h->bin[bin];
+  return sum;
+}
+
+static const seq_statistics_histogram_t *latency_get(mios32_midi_port_t port)
+{
+  u8 slot;
+  const seq_statistics_histogram_t *h;
+  mios32_midi_port_t slot_port;
+  for(slot=0; (h=SEQ_STATISTICS_LatencyHistogramGet(slot, &slot_port)) != NULL; ++slot)
+    if( slot_port == port )
+      return h;
+  return NULL;
+}
+
+static void print_histogram(const char *name, const seq_statistics_histogram_t *h)
+{
+  printf("%-12s %6u samples, p50 %5u uS, p90 %5u uS, p99 %5u uS, max %5u uS\n", name, h->count,
+	 SEQ_STATISTICS_HistogramPercentileGet(h, 50),
+	 SEQ_STATISTICS_HistogramPercentileGet(h, 90),
+	 SEQ_STATISTICS_HistogramPercentileGet(h, 99),
+	 h->max);
+}
+
+
+// ------- simplified SEQ_CORE_Handler -------
+static void core_handler(void)
+{
+  SEQ_BPM_ChkReqStart();
+
+  u32 bpm_tick;
+  while( SEQ_BPM_ChkReqClk(&bpm_tick) > 0 ) {
+    run_us(TICK_COST_US);
+
+    // MIDI clock at 24 ppqn
+    if( (bpm_tick % 16) == 0 ) {
+      mios32_midi_package_t p;
+      p.ALL = 0;
+      p.evnt0 = 0xf8;
+      SEQ_MIDI_OUT_Send(UART1, p, SEQ_MIDI_OUT_ClkEvent, bpm_tick, 0);
+    }
+
+    // 16th notes
+    if( (bpm_tick % 96) == 0 ) {
+      int track, note;
+      for(track=0; track<NUM_TRACKS; ++track) {
+	for(note=0; note<NOTES_PER_STEP; ++note) {
+	  mios32_midi_package_t p;
+	  p.ALL = 0;
+	  p.evnt0 = 0x90 | (track & 7);
+	  p.evnt1 = 0x3c + 4*note;
+	  p.evnt2 = 100;
+	  SEQ_MIDI_OUT_Send((track < 8) ? USB0 : UART0, p, SEQ_MIDI_OUT_OnOffEvent, bpm_tick, NOTE_LENGTH);
+	  run_us(EVENT_COST_US);
+	}
+      }
+    }
+  }
+}
+
+
+// ------- same sequence like SEQ_TASK_MIDI() -------
+static void midi_task(void)
+{
+  u32 timestamp = SEQ_BPM_TICK_TIMESTAMP();
+
+  core_handler();
+
+  timestamp = SEQ_STATISTICS_HandlerDurationAdd(SEQ_STATISTICS_HANDLER_CORE, timestamp);
+  SEQ_STATISTICS_QueueDepthAdd(seq_midi_out_allocated);
+  if( seq_midi_out_allocated > queue_depth_max )
+    queue_depth_max = seq_midi_out_allocated;
+
+  SEQ_MIDI_OUT_Handler();
+
+  SEQ_STATISTICS_HandlerDurationAdd(SEQ_STATISTICS_HANDLER_MIDI_OUT, timestamp);
+}
+
+
+// private BPM tick for the rendering check
+static u32 render_tick;
+static u32 Hook_BPM_TickGet(void)
+{
+  return render_tick;
+}
+
+
+// ------- main -------
+int main(int argc, char *argv[])
+{
+  // percentiles of a known distribution: 1..100 uS
+  {
+    seq_statistics_histogram_t h;
+    memset(&h, 0, sizeof(h));
+    int i;
+    for(i=1; i<=100; ++i) {
+      int bin;
+      for(bin=SEQ_STATISTICS_HISTOGRAM_BINS-1; SEQ_STATISTICS_HistogramBinBeginGet(bin) > i; --bin);
+      ++h.bin[bin];
+    }
+    h.count = 100;
+    h.max = 100;
+    // bins: 48..63 contains the 50th value, 96..127 the 90th/99th value
+    check(SEQ_STATISTICS_HistogramPercentileGet(&h, 50) == 63, "p50 of 1..100 should be 63");
+    check(SEQ_STATISTICS_HistogramPercentileGet(&h, 90) == 95, "p90 of 1..100 should be 95");
+    check(SEQ_STATISTICS_HistogramPercentileGet(&h, 99) == 100, "p99 of 1..100 should be limited to max");
+    check(SEQ_STATISTICS_HistogramBinBeginGet(SEQ_STATISTICS_HISTOGRAM_BINS-1) == 49152, "last bin should begin at 49152 uS");
+  }
+
+  SEQ_BPM_Init(0);
+  SEQ_BPM_PPQN_Set(384);
+  SEQ_BPM_Set(120.0);
+  SEQ_MIDI_OUT_Init(0);
+  SEQ_STATISTICS_Init(0);
+
+  // nothing recorded while the sequencer is stopped
+  midi_task();
+  check(SEQ_STATISTICS_HandlerHistogramGet(SEQ_STATISTICS_HANDLER_CORE)->count == 0, "handler recorded while stopped");
+
+  SEQ_BPM_Start();
+
+  int ms;
+  int stalled = 0;
+  u32 task_calls = 0;
+  for(ms=1; ms<=SESSION_MS; ++ms) {
+    run_us(ms*1000 - test_time_us);
+
+    // long SD card access delays the MIDI task
+    if( !stalled && SEQ_BPM_TickGet() >= STALL_TICK ) {
+      stalled = 1;
+      run_us(STALL_US);
+    }
+
+    midi_task();
+    ++task_calls;
+  }
+
+  const seq_statistics_histogram_t *core = SEQ_STATISTICS_HandlerHistogramGet(SEQ_STATISTICS_HANDLER_CORE);
+  const seq_statistics_histogram_t *midi_out = SEQ_STATISTICS_HandlerHistogramGet(SEQ_STATISTICS_HANDLER_MIDI_OUT);
+  const seq_statistics_histogram_t *usb0 = latency_get(USB0);
+  const seq_statistics_histogram_t *uart0 = latency_get(UART0);
+  const seq_statistics_histogram_t *uart1 = latency_get(UART1);
+
+  print_histogram("SEQ_CORE", core);
+  print_histogram("SEQ_MIDI_OUT", midi_out);
+  if( usb0 ) print_histogram("USB0", usb0);
+  if( uart0 ) print_histogram("UART0", uart0);
+  if( uart1 ) print_histogram("UART1", uart1);
+  printf("Queue depth: max %u\n", SEQ_STATISTICS_QueueDepthMaxGet());
+  printf("Sent blocks: %u (%.1f events per block)\n", sent_blocks, sent_blocks ? (double)sent_block_events / sent_blocks : 0.0);
+
+  // handler durations
+  check(core->count == task_calls, "one core duration per task call expected");
+  check(midi_out->count == task_calls, "one MIDI out duration per task call expected");
+  check(histogram_sum(core) == core->count, "core histogram doesn't match count");
+  // most calls process a single tick without events
+  check(SEQ_STATISTICS_HistogramPercentileGet(core, 50) == 11, "core p50 should be in the 8..11 uS bin");
+  // the longest call processes all ticks of the stall plus a step
+  check(core->max > (STALL_US/1302)*TICK_COST_US + NUM_TRACKS*NOTES_PER_STEP*EVENT_COST_US, "core max too small");
+  check(core->max < 2*(STALL_US/1302)*TICK_COST_US + NUM_TRACKS*NOTES_PER_STEP*EVENT_COST_US, "core max too large");
+  // MIDI out sends all on events of a step (+ clock): tracks 1..8 as USB0 blocks, 9..16 to UART0
+  check(midi_out->max >= (NUM_TRACKS/2)*NOTES_PER_STEP*(SEND_COST_US + SEND_BLOCK_COST_US), "MIDI out max too small");
+
+  // the scheduler sends all events as blocks with the default callback
+  check(sent_block_events == sent_events[0] + sent_events[1] + sent_events[2], "events have been sent without MIOS32_MIDI_SendPackageMulti()");
+  // up to SEQ_MIDI_OUT_BATCH_SIZE notes of a step are sent together
+  check(sent_block_events > 4*sent_blocks, "too many blocks");
+
+  // latencies
+  check(usb0 != NULL && uart0 != NULL && uart1 != NULL, "latency histogram missing");
+  if( usb0 && uart0 && uart1 ) {
+    check(usb0->count == sent_events[0], "USB0 latency count doesn't match sent events");
+    check(uart0->count == sent_events[1], "UART0 latency count doesn't match sent events");
+    check(uart1->count == sent_events[2], "UART1 latency count doesn't match sent events");
+    check(histogram_sum(usb0) == usb0->count, "USB0 histogram doesn't match count");
+
+    // clock: 10 seconds @ 120 BPM, 24 ppqn
+    check(uart1->count >= 475 && uart1->count <= 481, "unexpected number of clock events");
+
+    // without stall the latency is below one BPM tick (the sequencer gets the clock request
+    // for a tick with the next tick) + the task period + handler costs
+    // this bound (~2750 uS) is located in the 2048..3071 uS bin
+    u32 bound = 1302 + 1000 + 2*TICK_COST_US + NUM_TRACKS*NOTES_PER_STEP*(EVENT_COST_US + SEND_COST_US);
+    check(SEQ_STATISTICS_HistogramPercentileGet(usb0, 99) <= 3071, "USB0 p99 latency too high");
+    check(SEQ_STATISTICS_HistogramPercentileGet(uart0, 99) <= 3071, "UART0 p99 latency too high");
+    check(SEQ_STATISTICS_HistogramPercentileGet(uart1, 99) <= 3071, "UART1 p99 latency too high");
+    // Off events (half of the note events) are scheduled in advance and sent within the task period
+    check(SEQ_STATISTICS_HistogramPercentileGet(usb0, 45) <= 1023, "USB0 Off events should be sent within 1 mS");
+    check(SEQ_STATISTICS_HistogramPercentileGet(usb0, 55) >= 1024, "USB0 On events should be delayed by one tick");
+
+    // the step during the stall has been played late
+    check(usb0->max > STALL_US - 2*1302 && usb0->max < STALL_US + bound, "USB0 max latency should reflect the stall");
+    check(uart0->max > STALL_US - 2*1302 && uart0->max < STALL_US + bound, "UART0 max latency should reflect the stall");
+    check(uart0->max > usb0->max, "UART0 notes are sent after USB0 notes");
+  }
+
+  // queue depth: all notes of a step + clock
+  check(SEQ_STATISTICS_QueueDepthMaxGet() == queue_depth_max, "queue depth max doesn't match");
+  check(queue_depth_max >= NUM_TRACKS*NOTES_PER_STEP, "queue depth max too small");
+
+  // rendering (e.g. MIDI export) isn't recorded
+  {
+    u32 count = usb0 ? usb0->count : 0;
+    SEQ_MIDI_OUT_Callback_BPM_TickGet_Set(Hook_BPM_TickGet);
+    mios32_midi_package_t p;
+    p.ALL = 0x00643c90;
+    render_tick = 0xfffff000;
+    SEQ_MIDI_OUT_Send(USB0, p, SEQ_MIDI_OUT_OnEvent, render_tick, 0);
+    SEQ_MIDI_OUT_Handler();
+    SEQ_MIDI_OUT_Callback_BPM_TickGet_Set(NULL);
+    check(usb0 && usb0->count == count, "rendered events shouldn't be recorded");
+  }
+
+  SEQ_STATISTICS_TimingReset();
+  check(SEQ_STATISTICS_HandlerHistogramGet(SEQ_STATISTICS_HANDLER_CORE)->count == 0, "reset failed");
+  check(SEQ_STATISTICS_LatencyHistogramGet(0, NULL) == NULL, "reset failed");
+  check(SEQ_STATISTICS_QueueDepthMaxGet() == 0, "reset failed");
+
+  printf(errors ? "FAILED with %d errors\n" : "PASSED\n", errors);
+
+  return errors ? 1 : 0;
+}
@@ -209,6 +209,22 @@ extern void APP_SendDebugMessage(char *format, ...);
 #define portGET_RUN_TIME_COUNTER_VALUE          FREERTOS_UTILS_PerfCounterGet
 #endif
 
+// optional trace capture of task switches and response time histograms
+// (power of 2, each event allocates 8 bytes). Enable with "trace" in the MIOS terminal,
+// the dump can be converted with $MIOS32_PATH/modules/freertos_utils/tools/trace_decode
+#define FREERTOS_UTILS_TRACE_SIZE               0
+#if FREERTOS_UTILS_TRACE_SIZE
+#include <freertos_utils_trace.h>
+#endif
+
+// optional measurement of the MIDI output latency (per port), SEQ_CORE/SEQ_MIDI_OUT handler durations
+// and the MIDI scheduler queue depth. Results are displayed in the INFO->Timing page and with "timing" in the MIOS terminal
+// Uses the CPU cycle counter, costs ~750 bytes RAM and a hook per sent MIDI event, therefore disabled by default
+#define SEQ_STATISTICS_TIMING                   0
+#if SEQ_STATISTICS_TIMING
+#define SEQ_BPM_TICK_TIMESTAMP()                MIOS32_CYCLES_Get()
+#endif
+
 
 // maximum idle counter value to be expected
 #if defined(MIOS32_FAMILY_LPC17xx)
@@ -0,0 +1,125 @@
+// Host replay of the syeng voice allocator
+//
+// syeng.c is compiled with stubs of the VGM, file and front panel layers
+// (see stubs.c), nothing is sent to the Genesis chips. Programs with
+// different voice usages (single FM voices, FM pairs, LFO, PSG, noise, DAC,
+// whole chips) are assigned to the 16 channels of the first port, then a
+// dense random stream of note on/off events is played.
+//
+// After each note on, the voice usage of all chips and the mappings of all
+// program instances are added to a checksum. The makefile builds this
+// harness twice: with the free masks (SYENG_VOICE_FREE_MASKS=1) and with the
+// scan over all voices of the previous allocator (SYENG_VOICE_FREE_MASKS=0).
+// "make test" checks that both choose the same voices, and both report the
+// CPU time per note on.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "mios32.h"
+#include "syeng.h"
+
+#define NUM_EVENTS   200000
+#define MAX_HELD     8 // notes held per channel
+
+TIM_TypeDef test_tim2;
+TIM_TypeDef test_tim5;
+
+static synprogram_t programs[16];
+static u8 held[16][MAX_HELD];
+static u8 num_held[16];
+static u32 checksum = 2166136261u; // FNV-1a
+
+static void add_checksum(const void* data, u32 len){
+    const u8* p = data;
+    while(len--){
+        checksum = (checksum ^ *p++) * 16777619u;
+    }
+}
+
+static void add_state(){
+    u8 g, v, i;
+    for(g=0; g<GENESIS_COUNT; ++g){
+        add_checksum(&syngenesis[g].optionbits, 1);
+        for(v=0; v<12; ++v){
+            add_checksum(&syngenesis[g].channels[v].ALL, 2);
+        }
+    }
+    for(i=0; i<MBQG_NUM_PROGINSTANCES; ++i){
+        add_checksum(proginstances[i].mapping, sizeof(proginstances[i].mapping));
+    }
+}
+
+static void init_programs(){
+    u8 c;
+    VgmUsageBits u;
+    for(c=0; c<16; ++c){
+        u.all = 0;
+        switch(c){
+            case 0: case 1: case 2: case 3: case 4: case 5:
+                u.fm1 = 1; break;                                //single FM voice
+            case 6: u.fm1 = u.fm2 = 1; break;                    //FM pair
+            case 7: u.fm1 = u.fm1_lfo = 1; u.lfomode = 1; u.lfofixedspeed = 3; break;
+            case 8: u.fm1 = u.fm1_lfo = 1; u.lfomode = 2; break; //LFO messed with
+            case 9: u.sq1 = 1; break;
+            case 10: u.noise = 1; break;
+            case 11: u.sq1 = u.sq2 = 1; break;
+            case 12: u.fm6 = u.dac = 1; break;
+            case 13: u.opn2_globals = 1; break;                  //whole chip
+            case 14: u.fm1 = u.sq1 = 1; break;
+            default: u.fm3 = u.fm3_special = 1; break;
+        }
+        programs[c].usage = u;
+        programs[c].rootnote = 60;
+        channels[c].program = &programs[c];
+    }
+}
+
+static u64 now_ns(){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (u64)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+int main(int argc, char* argv[]){
+    u32 i, note_ons = 0;
+    u64 t, total_ns = 0;
+    mios32_midi_package_t pkg;
+
+    SyEng_Init();
+    voiceclearfull = 0; //no clearing VGMs, the chip layer is stubbed
+    init_programs();
+    srand(1);
+
+    for(i=0; i<NUM_EVENTS; ++i){
+        //the single FM voice channels play most of the notes
+        u8 c = (rand() & 1) ? (rand() % 6) : (rand() % 16);
+        test_tim5.CNT += rand() % 2000; //VGM time (44.1 kHz)
+        pkg.ALL = 0;
+        pkg.chn = c;
+        if(num_held[c] && (num_held[c] >= MAX_HELD || (rand() % 100) < 45)){
+            //note off of a random held note
+            u8 h = rand() % num_held[c];
+            pkg.note = held[c][h];
+            held[c][h] = held[c][--num_held[c]];
+            SyEng_Note_Off(pkg);
+        }else{
+            pkg.note = 24 + rand() % 72;
+            pkg.velocity = 1 + rand() % 127;
+            held[c][num_held[c]++] = pkg.note;
+            t = now_ns();
+            SyEng_Note_On(pkg);
+            t = now_ns() - t;
+            total_ns += t;
+            ++note_ons;
+            add_state();
+        }
+    }
+
+    printf("%s: %u note ons, %.0f nS per note on\n",
+           SYENG_VOICE_FREE_MASKS ? "free masks" : "full scan",
+           note_ons, (double)total_ns / note_ons);
+    printf("checksum of the voice choices: %08x\n", checksum);
+    return 0;
+}
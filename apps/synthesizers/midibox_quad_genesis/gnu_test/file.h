@@ -0,0 +1,26 @@
+// the file functions of syeng.c aren't used by the host test
+#ifndef _FILE_H
+#define _FILE_H
+
+typedef struct {
+  u32 flag;
+} file_t;
+
+extern s32 FILE_DirExists(char *path);
+extern s32 FILE_FileExists(char *filepath);
+extern s32 FILE_MakeDir(char *path);
+extern s32 FILE_ReadOpen(file_t* file, char *filepath);
+extern s32 FILE_ReadReOpen(file_t* file);
+extern s32 FILE_ReadClose(file_t* file);
+extern s32 FILE_ReadSeek(u32 offset);
+extern s32 FILE_ReadBuffer(u8 *buffer, u32 len);
+extern s32 FILE_ReadByte(u8 *byte);
+extern s32 FILE_ReadWord(u32 *word);
+extern s32 FILE_WriteOpen(char *filepath, u8 create_dir);
+extern s32 FILE_WriteClose(void);
+extern s32 FILE_WriteBuffer(u8 *buffer, u32 len);
+extern s32 FILE_WriteByte(u8 byte);
+extern s32 FILE_WriteWord(u32 word);
+extern s32 FILE_Remove(char *path);
+
+#endif /* _FILE_H */
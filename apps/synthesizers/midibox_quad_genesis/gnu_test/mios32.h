@@ -0,0 +1,49 @@
+// minimal MIOS32 environment to compile syeng.c on the host
+#ifndef _MIOS32_H
+#define _MIOS32_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+typedef uint8_t  u8;
+typedef uint16_t u16;
+typedef uint32_t u32;
+typedef uint64_t u64;
+typedef int8_t   s8;
+typedef int16_t  s16;
+typedef int32_t  s32;
+
+typedef union {
+  u32 ALL;
+  struct {
+    u8 cin_cable;
+    u8 evnt0;
+    u8 evnt1;
+    u8 evnt2;
+  };
+  struct {
+    u8 type:4;
+    u8 cable:4;
+    u8 chn:4;
+    u8 event:4;
+    u8 note:8;
+    u8 velocity:8;
+  };
+} mios32_midi_package_t;
+
+typedef u8 mios32_midi_port_t;
+
+// like the MBHP_Genesis configuration of the app
+#define MIOS32_BOARD_MBHP_CORE_STM32F4
+#define GENESIS_COUNT 4
+
+#define MIOS32_IRQ_Disable() 0
+#define MIOS32_IRQ_Enable()  0
+
+#define DEBUG_MSG(...) 0
+#define DBG(...) 0
+
+#include <stm32f4xx.h>
+
+#endif /* _MIOS32_H */
@@ -0,0 +1 @@
+// FreeRTOS isn't required by the host test
@@ -0,0 +1,7 @@
+// the host test is single threaded
+typedef void *xSemaphoreHandle;
+typedef u32 portTickType;
+#define pdTRUE 1
+#define xSemaphoreTakeRecursive(s, t) pdTRUE
+#define xSemaphoreGiveRecursive(s) 0
+#define vTaskDelay(t) do {} while(0)
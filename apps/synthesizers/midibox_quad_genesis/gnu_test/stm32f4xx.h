@@ -0,0 +1,17 @@
+#ifndef _STM32F4XX_H
+#define _STM32F4XX_H
+
+// the timers of the VGM player are driven by the host test
+typedef struct {
+  u32 CNT;
+} TIM_TypeDef;
+
+extern TIM_TypeDef test_tim2;
+extern TIM_TypeDef test_tim5;
+#define TIM2 (&test_tim2)
+#define TIM5 (&test_tim5)
+
+// the CCM RAM of the heap is only used by vgm_heap2.c, which isn't part of the host test
+#define CCMDATARAM_BASE 0
+
+#endif /* _STM32F4XX_H */
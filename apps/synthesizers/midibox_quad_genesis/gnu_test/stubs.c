@@ -0,0 +1,55 @@
+// stubs of the layers which syeng.c uses besides the voice allocation
+#include <string.h>
+#include "mios32.h"
+#include "syeng.h"
+
+VgmSource* selvgm;
+
+void DemoPrograms_Init(){}
+void Mode_Vgm_SelectVgm(VgmSource* newselvgm){}
+void Mode_Vgm_InvalidateVgm(VgmSource* maybeselvgm){}
+void Mode_Vgm_InvalidatePI(synproginstance_t* maybestaticpi){}
+
+void* vgmh2_malloc(size_t size){ return malloc(size); }
+void vgmh2_free(void* ptr){ free(ptr); }
+
+VgmSource* VGM_SourceRAM_Create(){
+    VgmSource* source = calloc(1, sizeof(VgmSource));
+    source->type = VGM_SOURCE_TYPE_RAM;
+    source->data = calloc(1, sizeof(VgmSourceRAM));
+    return source;
+}
+s32 VGM_Source_Delete(VgmSource* source){ return 0; }
+void VGM_Source_UpdateUsage(VgmSource* source){}
+void VGM_Cmd_DebugPrintUsage(VgmUsageBits usage){}
+
+VgmHead* VGM_Head_Create(VgmSource* source, u32 freqmult, u32 tempomult, u32 tloffs){
+    return calloc(1, sizeof(VgmHead));
+}
+s32 VGM_Head_Delete(VgmHead* head){ free(head); return 0; }
+void VGM_Head_Restart(VgmHead* head, u32 vgm_time){}
+
+void VGM_Tracker_Enqueue(VgmChipWriteCmd cmd, u8 fixfreq){}
+void VGM_ResetChipVoiceAsync(u8 g, u8 v){}
+void VGM_PartialResetChipVoiceAsync(u8 g, u8 v){}
+u32 VGM_getFreqMultiplier(s8 deltanote){ return 0x1000; }
+
+s32 VGM_File_Load(char* filename, VgmSource** ss, char* resultMsg){ return -1; }
+s32 VGM_File_SaveRAM(VgmSource* sourceram, char* filename){ return -1; }
+
+s32 FILE_DirExists(char *path){ return 0; }
+s32 FILE_FileExists(char *filepath){ return 0; }
+s32 FILE_MakeDir(char *path){ return -1; }
+s32 FILE_ReadOpen(file_t* file, char *filepath){ return -1; }
+s32 FILE_ReadReOpen(file_t* file){ return -1; }
+s32 FILE_ReadClose(file_t* file){ return -1; }
+s32 FILE_ReadSeek(u32 offset){ return -1; }
+s32 FILE_ReadBuffer(u8 *buffer, u32 len){ return -1; }
+s32 FILE_ReadByte(u8 *byte){ return -1; }
+s32 FILE_ReadWord(u32 *word){ return -1; }
+s32 FILE_WriteOpen(char *filepath, u8 create_dir){ return -1; }
+s32 FILE_WriteClose(void){ return -1; }
+s32 FILE_WriteBuffer(u8 *buffer, u32 len){ return -1; }
+s32 FILE_WriteByte(u8 byte){ return -1; }
+s32 FILE_WriteWord(u32 word){ return -1; }
+s32 FILE_Remove(char *path){ return -1; }
@@ -17,6 +17,7 @@
 #include <mios32.h>
 #include "app.h"
 
+#include <string.h>
 #include <blm_x.h>
 #include <file.h>
 #include <genesis.h>
@@ -67,6 +68,33 @@ static const u8 charset_mbvgm[8*8] = {
   0,0,0,0,0,0,0,0
 };
 
+/////////////////////////////////////////////////////////////////////////////
+// Terminal commands from MIOS Studio
+/////////////////////////////////////////////////////////////////////////////
+
+#define TERMINAL_LINE_LEN 32
+static char terminal_line[TERMINAL_LINE_LEN];
+static u8 terminal_line_pos = 0;
+
+static s32 APP_TerminalParse(mios32_midi_port_t port, char c){
+    if(c == '\r') return 0;
+    if(c != '\n'){
+        if(terminal_line_pos < TERMINAL_LINE_LEN-1) terminal_line[terminal_line_pos++] = c;
+        return 0;
+    }
+    terminal_line[terminal_line_pos] = 0;
+    terminal_line_pos = 0;
+    if(strcmp(terminal_line, "heap") == 0){
+        VGM_PerfMon_PrintHeapStats();
+    }else if(strcmp(terminal_line, "heap reset") == 0){
+        vgmh2_resetstats();
+        DBG("Heap2 statistics reset.");
+    }else{
+        DBG("Commands: heap, heap reset");
+    }
+    return 0;
+}
+
 /////////////////////////////////////////////////////////////////////////////
 // This hook is called after startup to initialize the application
 /////////////////////////////////////////////////////////////////////////////
@@ -97,6 +125,9 @@ void APP_Init(void){
     //Initialize interface
     Interface_Init();
     
+    //Install terminal command parser
+    MIOS32_MIDI_DebugCommandCallback_Init(APP_TerminalParse);
+    
     
 }
 
@@ -180,7 +180,7 @@ void Mode_Chan_BtnGVoice(u8 gvoice, u8 state){
                 submode = 2;
             }else{
                 SyEng_ClearVoice(g, v);
-                syngenesis[g].channels[v].use = 3;
+                SyEng_SetVoiceUse(g, v, 3);
                 channels[selchan].trackervoice = (g << 4) | v;
                 channels[selchan].trackermode = 1;
                 FrontPanel_GenesisLEDSet(g, v, 0, 1);
@@ -210,7 +210,7 @@ void Mode_Chan_BtnSoftkey(u8 softkey, u8 state){
                             }
                         }
                         if(c == 16*MBQG_NUM_PORTS){ //there was none
-                            syngenesis[g].channels[3].use = 0;
+                            SyEng_SetVoiceUse(g, 3, 0);
                             //Also clear trackermode from voices controlling Ch3 operator frequencies
                             for(c=0; c<16*MBQG_NUM_PORTS; ++c){
                                 if(channels[c].trackermode){
@@ -232,7 +232,7 @@ void Mode_Chan_BtnSoftkey(u8 softkey, u8 state){
                             }
                         }
                         if(c == 16*MBQG_NUM_PORTS){ //there was none
-                            syngenesis[g].channels[v].use = 0;
+                            SyEng_SetVoiceUse(g, v, 0);
                         }
                     }
                     FrontPanel_GenesisLEDSet(g, v, 0, 0);
@@ -251,7 +251,7 @@ void Mode_Chan_BtnSoftkey(u8 softkey, u8 state){
         case 2:
             if(softkey == 3){
                 SyEng_ClearVoice(cursor, 3);
-                syngenesis[cursor].channels[3].use = 3;
+                SyEng_SetVoiceUse(cursor, 3, 3);
                 channels[selchan].trackervoice = (cursor << 4) | 3;
             }else if(softkey <= 2){
                 channels[selchan].trackervoice = (cursor << 4) | (0xC + softkey);
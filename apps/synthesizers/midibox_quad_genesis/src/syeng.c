@@ -92,6 +92,21 @@ synchannel_t channels[16*MBQG_NUM_PORTS];
 u8 voiceclearfull;
 static VgmSource* voiceclearsource;
 static voiceclearlink* voiceclearlist;
+static u16 voicefree[GENESIS_COUNT]; //Bit v set if voice v of this chip has use == 0
+
+void SyEng_SetVoiceUse(u8 g, u8 v, u8 use){
+    syngenesis[g].channels[v].use = use;
+    if(use){
+        voicefree[g] &= ~(1 << v);
+    }else{
+        voicefree[g] |= (1 << v);
+    }
+}
+
+static void ResetVoiceUsage(u8 g, u8 v){
+    syngenesis[g].channels[v].ALL = 0;
+    voicefree[g] |= (1 << v);
+}
 
 
 
@@ -142,7 +157,7 @@ static void ReleaseAllPI(synproginstance_t* pi){
         }else if(i >= 1 && i <= 6){
             //FM voice
             v = pimap.map_voice+1;
-            sg->channels[v].ALL = 0;
+            ResetVoiceUsage(g, v);
             VoiceReset(g, v);
             //See if this chip has any voice using LFO
             for(v=1; v<7; ++v) if(sg->channels[v].lfo) break;
@@ -151,16 +166,16 @@ static void ReleaseAllPI(synproginstance_t* pi){
             }
         }else if(i == 7){
             //DAC
-            sg->channels[7].ALL = 0;
+            ResetVoiceUsage(g, 7);
             VoiceReset(g, 7);
         }else if(i >= 8 && i <= 10){
             //SQ voice
             v = pimap.map_voice+8;
-            sg->channels[v].ALL = 0;
+            ResetVoiceUsage(g, v);
             VoiceReset(g, v);
         }else{
             //Noise
-            sg->channels[11].ALL = 0;
+            ResetVoiceUsage(g, 11);
             sg->noisefreqsq3 = 0;
             VoiceReset(g, 11);
         }
@@ -197,17 +212,17 @@ void SyEng_ClearVoice(u8 g, u8 v){
     }else{
         ClearPI(&proginstances[syngenesis[g].channels[v].pi_using]);
     }
-    syngenesis[g].channels[v].use = 0;
+    SyEng_SetVoiceUse(g, v, 0);
 }
 
 static void SetPIMappedVoicesUse(synproginstance_t* pi, u8 use){
     u8 i, v;
     VgmHead_Channel pimap;
-    syngenesis_t* sg;
+    u8 g;
     for(i=0; i<12; ++i){
         pimap = pi->mapping[i];
         if(pimap.nodata) continue;
-        sg = &syngenesis[pimap.map_chip];
+        g = pimap.map_chip;
         if(i == 0){
             if(pimap.option){
                 //Only using globals for LFO
@@ -215,7 +230,7 @@ static void SetPIMappedVoicesUse(synproginstance_t* pi, u8 use){
             }else{
                 //We were using OPN2 globals
                 for(v=0; v<8; ++v){
-                    sg->channels[v].use = use;
+                    SyEng_SetVoiceUse(g, v, use);
                 }
                 //Skip to PSG section
                 i = 7;
@@ -224,17 +239,17 @@ static void SetPIMappedVoicesUse(synproginstance_t* pi, u8 use){
         }else if(i >= 1 && i <= 6){
             //FM voice
             v = pimap.map_voice;
-            sg->channels[v+1].use = use;
+            SyEng_SetVoiceUse(g, v+1, use);
         }else if(i == 7){
             //DAC
-            sg->channels[7].use = use;
+            SyEng_SetVoiceUse(g, 7, use);
         }else if(i >= 8 && i <= 10){
             //SQ voice
             v = pimap.map_voice;
-            sg->channels[v+8].use = use;
+            SyEng_SetVoiceUse(g, v+8, use);
         }else{
             //Noise
-            sg->channels[11].use = use;
+            SyEng_SetVoiceUse(g, 11, use);
         }
     }
 }
@@ -301,7 +316,7 @@ static void AssignVoiceToGenesis(u8 piindex, synproginstance_t* pi, u8 g, u8 vso
         proper = 0;
         map_voice = 0;
     }
-    sgusage->use = 2; //pi->isstatic ? 3 : 2;
+    SyEng_SetVoiceUse(g, vdest, 2); //pi->isstatic ? 3 : 2;
     sgusage->pi_using = piindex;
     //Map PI
     pi->mapping[vsource] = (VgmHead_Channel){.nodata = 0, .mute = 0, .map_chip = g, .map_voice = map_voice, .option = vlfo};
@@ -330,6 +345,32 @@ static void FindBestVoice(s8* bestg, s8* bestv, u32 now, s8 forceg, u8 vstart, u
     syngenesis_usage_t* sgu; synproginstance_t* pi;
     *bestg = -1;
     *bestv = -1;
+#if SYENG_VOICE_FREE_MASKS
+    //A free voice (or a whole free range) always scores best, and ties between
+    //free voices go to the first one found, so look those up in the free masks
+    u16 rangemask = ((1 << (vend+1)) - 1) & ~((1 << vstart) - 1);
+    u16 prefmask = rangemask;
+    if(vstart == 1 && vend == 6) prefmask &= ~((1 << 3) | (1 << 6)); //Same penalty for 3+6 as below
+    for(g=gstart; g<gend; ++g){
+        if(sumoverv ? ((voicefree[g] & rangemask) == rangemask) : (voicefree[g] & prefmask)){
+            *bestg = g;
+            *bestv = sumoverv ? vstart : __builtin_ctz(voicefree[g] & prefmask);
+            DBG("FindBestVoice asked forceg %d voices %d-%d sumoverv %d, result G%d V%d (free)", forceg, vstart, vend, sumoverv, *bestg, *bestv);
+            return;
+        }
+    }
+    if(!sumoverv && prefmask != rangemask){
+        for(g=gstart; g<gend; ++g){
+            if(voicefree[g] & rangemask){
+                *bestg = g;
+                *bestv = __builtin_ctz(voicefree[g] & rangemask);
+                DBG("FindBestVoice asked forceg %d voices %d-%d sumoverv %d, result G%d V%d (free)", forceg, vstart, vend, sumoverv, *bestg, *bestv);
+                return;
+            }
+        }
+    }
+#endif
+    //No free voices, score the voices in use to choose one to steal
     for(g=gstart; g<gend; ++g){
         totalscore = 0;
         totalrecency = 0;
@@ -696,7 +737,7 @@ void SyEng_Init(){
     for(i=0; i<GENESIS_COUNT; ++i){
         syngenesis[i].optionbits = 0;
         for(j=0; j<12; ++j){
-            syngenesis[i].channels[j].ALL = 0;
+            ResetVoiceUsage(i, j);
         }
     }
     //Initialize proginstances
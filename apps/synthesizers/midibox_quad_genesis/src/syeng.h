@@ -80,6 +80,12 @@ typedef struct {
 #define MBQG_NUM_PROGINSTANCES 10*GENESIS_COUNT
 #endif
 
+//Look up free voices in the per-chip free masks before scoring the voices in
+//use (0: always score all voices, used by gnu_test/ to compare the choices)
+#ifndef SYENG_VOICE_FREE_MASKS
+#define SYENG_VOICE_FREE_MASKS 1
+#endif
+
 extern synproginstance_t proginstances[MBQG_NUM_PROGINSTANCES];
 
 
@@ -110,6 +116,7 @@ extern void SyEng_Note_On(mios32_midi_package_t pkg);
 extern void SyEng_Note_Off(mios32_midi_package_t pkg);
 
 extern void SyEng_ClearVoice(u8 g, u8 v);
+extern void SyEng_SetVoiceUse(u8 g, u8 v, u8 use);
 extern void SyEng_HardFlushProgram(synprogram_t* prog);
 extern void SyEng_SoftFlushProgram(synprogram_t* prog);
 extern void SyEng_RecalcSourceAndProgramUsage(synprogram_t* prog, VgmSource* srcchanged);
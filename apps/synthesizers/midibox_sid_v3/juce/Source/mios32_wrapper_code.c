@@ -44,6 +44,9 @@ s32 MIOS32_STOPWATCH_Init(u32 resolution) { return -1; }
 s32 MIOS32_STOPWATCH_Reset(void) { return -1; }
 u32 MIOS32_STOPWATCH_ValueGet(void) { return -1; }
 
+s32 MIOS32_CYCLES_Init(u32 mode) { return -1; }
+u32 MIOS32_CYCLES_Get(void) { return 0; }
+
 s32 MIOS32_BOARD_LED_Init(u32 leds) { return -1; }
 s32 MIOS32_BOARD_LED_Set(u32 leds, u32 value) { return -1; }
 u32 MIOS32_BOARD_LED_Get(void) { return -1; }
@@ -0,0 +1,41 @@
+// $Id$
+/*
+ * Header file for the CPU Cycle Counter
+ *
+ * ==========================================================================
+ *
+ *  Copyright (C) 2026 agent (agent@local)
+ *  Licensed for personal non-commercial use only.
+ *  All other rights reserved.
+ * 
+ * ==========================================================================
+ */
+
+#ifndef _MIOS32_CYCLES_H
+#define _MIOS32_CYCLES_H
+
+/////////////////////////////////////////////////////////////////////////////
+// Global definitions
+/////////////////////////////////////////////////////////////////////////////
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Global Types
+/////////////////////////////////////////////////////////////////////////////
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Prototypes
+/////////////////////////////////////////////////////////////////////////////
+
+extern s32 MIOS32_CYCLES_Init(u32 mode);
+
+extern u32 MIOS32_CYCLES_Get(void);
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Export global variables
+/////////////////////////////////////////////////////////////////////////////
+
+
+#endif /* _MIOS32_CYCLES_H */
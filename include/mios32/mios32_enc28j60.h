@@ -96,6 +96,7 @@ extern s32 MIOS32_ENC28J60_MACGet(void);
 extern s32 MIOS32_ENC28J60_MACGetArray(u8 *buffer, u16 len);
 extern s32 MIOS32_ENC28J60_MACPut(u8 value);
 extern s32 MIOS32_ENC28J60_MACPutArray(u8 *buffer, u16 len);
+extern s32 MIOS32_ENC28J60_TransferBlock(u8 *send_buffer, u8 *receive_buffer, u16 len);
 
 
 /////////////////////////////////////////////////////////////////////////////
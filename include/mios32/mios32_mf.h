@@ -36,6 +36,16 @@
 #define MIOS32_MF_SPI_RC_PIN 0
 #endif
 
+// Motorfader control algorithm:
+// 0: bang-bang control with repeat/timeout counters and optional PWM (default)
+// 1: fixed point PID controller with velocity feed-forward. The target is
+//    approached along a trapezoidal velocity profile, the motor dead zone
+//    and the travel speed of each fader are calibrated during operation.
+//    Parameters: see MIOS32_MF_PidConfigSet() and MIOS32_MF_CalibrationSet()
+#ifndef MIOS32_MF_PID_CONTROL
+#define MIOS32_MF_PID_CONTROL 0
+#endif
+
 
 /////////////////////////////////////////////////////////////////////////////
 // Global Types
@@ -61,6 +71,23 @@ typedef union {
 } mios32_mf_config_t;
 
 
+// only used if MIOS32_MF_PID_CONTROL is enabled
+typedef struct {
+  u8  kp;          // proportional gain (Q4: 16 = 1.0)
+  u8  ki;          // integral gain (Q8: 256 = 1.0)
+  u8  kd;          // derivative gain on velocity error (duty cycle per AIN unit/tick)
+  u8  kff;         // velocity feed-forward gain (Q4)
+  u16 max_speed;   // trajectory speed in AIN units per tick, 0: derived from calibrated travel speed
+  u16 accel;       // trajectory acceleration in AIN units per tick^2 (Q8), 0: no velocity profile
+} mios32_mf_pid_config_t;
+
+typedef struct {
+  u8  min_duty_up;   // smallest duty cycle (0..255) which keeps the fader moving in MF_Up direction
+  u8  min_duty_down; // same for MF_Down direction
+  u16 travel_speed;  // AIN units per tick at full duty cycle (Q4)
+} mios32_mf_calibration_t;
+
+
 /////////////////////////////////////////////////////////////////////////////
 // Prototypes
 /////////////////////////////////////////////////////////////////////////////
@@ -78,6 +105,11 @@ extern s32 MIOS32_MF_TouchDetectionReset(u32 mf);
 extern s32 MIOS32_MF_ConfigSet(u32 mf, mios32_mf_config_t config);
 extern mios32_mf_config_t MIOS32_MF_ConfigGet(u32 mf);
 
+extern s32 MIOS32_MF_PidConfigSet(u32 mf, mios32_mf_pid_config_t pid_config);
+extern mios32_mf_pid_config_t MIOS32_MF_PidConfigGet(u32 mf);
+extern s32 MIOS32_MF_CalibrationSet(u32 mf, mios32_mf_calibration_t calibration);
+extern mios32_mf_calibration_t MIOS32_MF_CalibrationGet(u32 mf);
+
 extern s32 MIOS32_MF_Tick(u16 *ain_values, u16 *ain_deltas);
 
 
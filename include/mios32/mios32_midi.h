@@ -212,6 +212,7 @@ extern s32 MIOS32_MIDI_RS_Reset(mios32_midi_port_t port);
 
 extern s32 MIOS32_MIDI_SendPackage_NonBlocking(mios32_midi_port_t port, mios32_midi_package_t package);
 extern s32 MIOS32_MIDI_SendPackage(mios32_midi_port_t port, mios32_midi_package_t package);
+extern s32 MIOS32_MIDI_SendPackageMulti(mios32_midi_port_t port, mios32_midi_package_t *packages, u32 num);
 
 extern s32 MIOS32_MIDI_SendEvent(mios32_midi_port_t port, u8 evnt0, u8 evnt1, u8 evnt2);
 extern s32 MIOS32_MIDI_SendNoteOff(mios32_midi_port_t port, mios32_midi_chn_t chn, u8 note, u8 vel);
@@ -250,6 +251,7 @@ extern s32 MIOS32_MIDI_Periodic_mS(void);
 
 extern s32 MIOS32_MIDI_DirectTxCallback_Init(s32 (*callback_tx)(mios32_midi_port_t port, mios32_midi_package_t package));
 extern s32 MIOS32_MIDI_DirectRxCallback_Init(s32 (*callback_rx)(mios32_midi_port_t port, u8 midi_byte));
+extern s32 MIOS32_MIDI_RxNotifyCallback_Init(void (*callback_notify)(void));
 
 extern s32 MIOS32_MIDI_SendByteToRxCallback(mios32_midi_port_t port, u8 midi_byte);
 extern s32 MIOS32_MIDI_SendPackageToRxCallback(mios32_midi_port_t port, mios32_midi_package_t midi_package);
@@ -26,6 +26,16 @@
 #endif
 
 
+// number of 32bit words which are required to store one flag per SR
+#define MIOS32_SRIO_NUM_SR_WORDS ((MIOS32_SRIO_NUM_SR+31)/32)
+
+// DIN/ENC handlers only check the SRs which have been flagged in mios32_srio_din_changed_sr
+// (can be disabled to compare with the previous scan over all SRs and encoders, see mios32/common/gnu_test)
+#ifndef MIOS32_SRIO_SKIP_UNCHANGED
+#define MIOS32_SRIO_SKIP_UNCHANGED 1
+#endif
+
+
 // how many DOUT pages are supported (used for dimmed LED and optimized matrix handling support)
 #ifndef MIOS32_SRIO_NUM_DOUT_PAGES
 #define MIOS32_SRIO_NUM_DOUT_PAGES 1
@@ -96,6 +106,7 @@ extern volatile u8 mios32_srio_dout[MIOS32_SRIO_NUM_DOUT_PAGES][MIOS32_SRIO_NUM_
 extern volatile u8 mios32_srio_din[MIOS32_SRIO_NUM_SR];
 extern volatile u8 mios32_srio_din_buffer[MIOS32_SRIO_NUM_SR]; // only required for emulation
 extern volatile u8 mios32_srio_din_changed[MIOS32_SRIO_NUM_SR];
+extern volatile u32 mios32_srio_din_changed_sr[MIOS32_SRIO_NUM_SR_WORDS];
 
 // the current DOUT page
 #if MIOS32_SRIO_NUM_DOUT_PAGES > 1
@@ -42,6 +42,30 @@
 #define MIOS32_UART_RX_BUFFER_SIZE 64
 #endif
 
+// STM32F4 only: selects the UARTs which should be serviced via DMA instead
+// of one interrupt per byte (bit 0: UART0, bit 1: UART1, ...)
+// Reception uses a circular buffer, which is transfered into the Rx buffer
+// on half/complete transfer and idle line events. Transmission is chained
+// directly from the Tx buffer.
+// Please note that some DMA streams are shared with other drivers:
+//   UART0 Rx: DMA1 Stream5 (SPI2 Tx and I2S)
+//   UART1 Tx: DMA1 Stream3 (SPI1 Rx, default SRIO port)
+// mios32_uart.c stops with an #error if one of these drivers is enabled as well.
+//   UART3 Rx: DMA1 Stream0 (WS2812 module)
+#ifndef MIOS32_UART_DMA_RX_MASK
+#define MIOS32_UART_DMA_RX_MASK 0x00
+#endif
+#ifndef MIOS32_UART_DMA_TX_MASK
+#define MIOS32_UART_DMA_TX_MASK 0x00
+#endif
+
+// size of the circular DMA receive buffer (2..256)
+// incoming bytes are transfered into the Rx buffer after each half, which
+// takes 32*320 uS at 31250 baud with the default size
+#ifndef MIOS32_UART_DMA_RX_BUFFER_SIZE
+#define MIOS32_UART_DMA_RX_BUFFER_SIZE 64
+#endif
+
 // Baudrate of UART first interface
 #ifndef MIOS32_UART0_BAUDRATE
 #define MIOS32_UART0_BAUDRATE 31250
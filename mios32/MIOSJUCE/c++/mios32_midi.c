@@ -62,6 +62,17 @@ s32 MIOS32_MIDI_SendPackage(mios32_midi_port_t port, mios32_midi_package_t packa
 	return 1;
 }
 
+s32 MIOS32_MIDI_SendPackageMulti(mios32_midi_port_t port, mios32_midi_package_t *packages, u32 num)
+{
+	for(; num; --num, ++packages) {
+		s32 status;
+		if( (status=MIOS32_MIDI_SendPackage(port, *packages)) < 0 )
+			return status;
+	}
+
+	return 0;
+}
+
 s32 MIOS32_MIDI_SendNoteOff(mios32_midi_port_t port, mios32_midi_chn_t chn, u8 note, u8 vel)
 {
 	return JUCE_MIDI_SendNoteOff((int) port, (char) chn, (char) note, (char) vel);
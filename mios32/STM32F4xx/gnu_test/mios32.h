@@ -0,0 +1,27 @@
+// minimal MIOS32 environment to compile mios32_usb_midi.c in device mode on the host
+#ifndef _MIOS32_H
+#define _MIOS32_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+typedef uint8_t  u8;
+typedef uint16_t u16;
+typedef uint32_t u32;
+typedef uint64_t u64;
+typedef int8_t   s8;
+typedef int16_t  s16;
+typedef int32_t  s32;
+
+// the USB host mode isn't covered by usb_midi_ep.c
+#define MIOS32_DONT_USE_USB_HOST
+
+// interrupts are emulated by usb_midi_ep.c
+extern s32 MIOS32_IRQ_Disable(void);
+extern s32 MIOS32_IRQ_Enable(void);
+
+#include "mios32_midi.h"
+#include "mios32_usb_midi.h"
+
+#endif /* _MIOS32_H */
@@ -0,0 +1,21 @@
+// USB OTG core stand-in, see usb_midi_ep.c
+#ifndef _USB_CORE_H
+#define _USB_CORE_H
+
+typedef struct {
+  uint32_t xfer_count;
+} USB_OTG_EP;
+
+typedef struct {
+  struct {
+    void *class_cb;
+    USB_OTG_EP out_ep[4];
+  } dev;
+} USB_OTG_CORE_HANDLE;
+
+extern uint8_t USB_OTG_IsDeviceMode(USB_OTG_CORE_HANDLE *pdev);
+extern uint8_t USB_OTG_IsHostMode(USB_OTG_CORE_HANDLE *pdev);
+extern uint32_t DCD_EP_Tx(USB_OTG_CORE_HANDLE *pdev, uint8_t ep_addr, uint8_t *pbuf, uint32_t buf_len);
+extern uint32_t DCD_EP_PrepareRx(USB_OTG_CORE_HANDLE *pdev, uint8_t ep_addr, uint8_t *pbuf, uint16_t buf_len);
+
+#endif /* _USB_CORE_H */
@@ -0,0 +1,352 @@
+// Host test of the USB MIDI Tx path in device mode
+//
+// mios32_usb_midi.c is compiled on the host against a stand-in of the USB
+// OTG core (usb_core.h). The IN endpoint double accepts one transfer at a
+// time with DCD_EP_Tx(), reads the packages out of the given buffer when
+// the host polls the endpoint (like the Tx FIFO is filled on the target),
+// and calls MIOS32_USB_MIDI_EP1_IN_Callback() afterwards. The host polls
+// the endpoint POLLS_PER_MS times per mS (19 bulk packets of 64 bytes is
+// the upper limit of a full speed frame).
+//
+// MIOS32_IRQ_Disable()/Enable() are measured: the longest section with
+// disabled interrupts is reported in nS (host time). An "interrupt" can be
+// armed to fire when interrupts are enabled again; the reconnect test uses
+// this to disconnect and re-connect the cable at arbitrary points of the
+// Tx handler, followed by a higher priority task which sends new packages
+// and starts the next transfer.
+//
+// Each package carries a connection number and a sequence number. The
+// endpoint double checks that the packages of the current connection
+// arrive in order without gaps or duplicates, and that no package of a
+// previous connection is sent after a re-connection.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "mios32.h"
+#include "usb_core.h"
+
+#define POLLS_PER_MS     19
+#define NUM_MS           2000
+#define NUM_RECONNECTS   100000
+#define NUM_RUNS         5 // the lowest IRQ off maximum of all runs is reported (host noise)
+
+// imported by mios32_usb_midi.c
+USB_OTG_CORE_HANDLE USB_OTG_dev;
+uint32_t USB_rx_buffer[MIOS32_USB_MIDI_DATA_OUT_SIZE/4];
+
+// IN endpoint double
+static u8 in_flight;
+static u32 *in_buf;
+static u32 in_len;
+static u32 transfers;
+static u32 packages_received;
+
+// IRQ emulation
+static int irq_nesting;
+static u64 irq_disabled_ns;
+static u64 irq_max_ns;
+static u32 irq_sections;
+static int isr_countdown; // fires the ISR at the n'th enable (0: disarmed)
+static u8 in_isr;
+static void (*isr_func)(void);
+
+// sender and checker
+static u8 connection;
+static u32 send_seq;
+static u32 expected_seq;
+static u32 lfsr;
+static int errors;
+
+
+static u64 now_ns(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (u64)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static u32 random_number(void)
+{
+  lfsr ^= lfsr << 13;
+  lfsr ^= lfsr >> 17;
+  lfsr ^= lfsr << 5;
+  return lfsr;
+}
+
+
+// ------- MIOS32 stubs -------
+s32 MIOS32_IRQ_Disable(void)
+{
+  if( irq_nesting++ == 0 )
+    irq_disabled_ns = now_ns();
+  return 0;
+}
+
+s32 MIOS32_IRQ_Enable(void)
+{
+  if( --irq_nesting == 0 ) {
+    u64 duration = now_ns() - irq_disabled_ns;
+    if( duration > irq_max_ns )
+      irq_max_ns = duration;
+    ++irq_sections;
+
+    // pending interrupt?
+    if( isr_countdown && !in_isr && --isr_countdown == 0 ) {
+      in_isr = 1;
+      isr_func();
+      in_isr = 0;
+    }
+  }
+  return 0;
+}
+
+s32 MIOS32_MIDI_SendPackageToRxCallback(mios32_midi_port_t port, mios32_midi_package_t midi_package)
+{
+  return 0;
+}
+
+
+// ------- USB OTG core stand-in -------
+uint8_t USB_OTG_IsDeviceMode(USB_OTG_CORE_HANDLE *pdev) { return 1; }
+uint8_t USB_OTG_IsHostMode(USB_OTG_CORE_HANDLE *pdev) { return 0; }
+
+uint32_t DCD_EP_PrepareRx(USB_OTG_CORE_HANDLE *pdev, uint8_t ep_addr, uint8_t *pbuf, uint16_t buf_len)
+{
+  return 0;
+}
+
+uint32_t DCD_EP_Tx(USB_OTG_CORE_HANDLE *pdev, uint8_t ep_addr, uint8_t *pbuf, uint32_t buf_len)
+{
+  if( in_flight ) {
+    if( errors < 10 )
+      printf("ERROR: IN transfer started while the previous one is in flight\n");
+    ++errors;
+    return 0;
+  }
+
+  if( ep_addr != MIOS32_USB_MIDI_DATA_IN_EP || !buf_len || (buf_len % 4) || buf_len > MIOS32_USB_MIDI_DATA_IN_SIZE ) {
+    if( errors < 10 )
+      printf("ERROR: invalid IN transfer of %u bytes\n", buf_len);
+    ++errors;
+    return 0;
+  }
+
+  in_flight = 1;
+  in_buf = (u32 *)pbuf;
+  in_len = buf_len / 4;
+  ++transfers;
+  return 0;
+}
+
+static mios32_midi_package_t make_package(u32 seq)
+{
+  mios32_midi_package_t p;
+  p.ALL = 0;
+  p.cin = NoteOn;
+  p.event = NoteOn;
+  p.chn = connection & 0xf;
+  p.note = seq & 0x7f;
+  p.velocity = (seq >> 7) & 0x7f;
+  return p;
+}
+
+// the host polls the IN endpoint
+static void endpoint_poll(void)
+{
+  u32 i;
+
+  if( !in_flight )
+    return;
+
+  // the packages are read out of the buffer now
+  for(i=0; i<in_len; ++i) {
+    mios32_midi_package_t p;
+    p.ALL = in_buf[i];
+
+    if( p.chn != (connection & 0xf) ) {
+      if( errors < 10 )
+	printf("ERROR: package of a previous connection sent after re-connection\n");
+      ++errors;
+    } else if( p.ALL != make_package(expected_seq).ALL ) {
+      if( errors < 10 )
+	printf("ERROR: expected package #%u, got %08x\n", expected_seq, p.ALL);
+      ++errors;
+      expected_seq = (p.note | (p.velocity << 7)) + 1; // resync
+    } else {
+      expected_seq = (expected_seq + 1) & 0x3fff;
+    }
+    ++packages_received;
+  }
+
+  in_flight = 0;
+  in_isr = 1;
+  MIOS32_USB_MIDI_EP1_IN_Callback(MIOS32_USB_MIDI_DATA_IN_EP, 0);
+  in_isr = 0;
+}
+
+
+// ------- sender -------
+// sends up to num packages, returns the number of packages which went into the buffer
+static u32 send(u32 num, u32 block_size)
+{
+  mios32_midi_package_t packages[16];
+  u32 sent = 0;
+
+  while( sent < num ) {
+    u32 block = (num - sent) < block_size ? (num - sent) : block_size;
+    u8 sender_connection = connection;
+    u32 i;
+    s32 status;
+
+    for(i=0; i<block; ++i)
+      packages[i] = make_package((send_seq + i) & 0x3fff);
+
+    status = MIOS32_USB_MIDI_PackageSendMulti_NonBlocking(packages, block);
+    if( status <= 0 || connection != sender_connection )
+      break; // buffer full (or the sent packages have been dropped by a re-connection)
+
+    send_seq = (send_seq + status) & 0x3fff;
+    sent += status;
+  }
+
+  return sent;
+}
+
+static void connect(void)
+{
+  in_flight = 0; // a bus reset cancels the transfer
+  MIOS32_USB_MIDI_ChangeConnectionState(0);
+  MIOS32_USB_MIDI_ChangeConnectionState(1);
+  ++connection;
+  send_seq = expected_seq = 0;
+}
+
+
+// ------- throughput -------
+static u64 benchmark_run(u32 packages_per_ms, u32 block_size)
+{
+  u32 ms, poll, backlog = 0;
+  u32 sent_total = 0;
+
+  connect();
+  transfers = packages_received = 0;
+  irq_max_ns = 0;
+  irq_sections = 0;
+
+  for(ms=0; ms<NUM_MS; ++ms) {
+    // a burst at the begin of each mS, like the notes of a sequencer step
+    backlog += packages_per_ms;
+
+    for(poll=0; poll<POLLS_PER_MS; ++poll) {
+      u32 sent = send(backlog, block_size);
+      backlog -= sent;
+      sent_total += sent;
+      endpoint_poll();
+    }
+
+    MIOS32_USB_MIDI_Periodic_mS();
+  }
+
+  // drain the buffer
+  for(poll=0; poll<1000 && packages_received < sent_total; ++poll) {
+    endpoint_poll();
+    MIOS32_USB_MIDI_Periodic_mS();
+  }
+
+  if( packages_received != sent_total ) {
+    printf("ERROR: %u packages sent, but %u received\n", sent_total, packages_received);
+    ++errors;
+  }
+
+  return irq_max_ns;
+}
+
+static void benchmark(u32 packages_per_ms, u32 block_size)
+{
+  u64 irq_min_max_ns = ~0ull;
+  int run;
+
+  for(run=0; run<NUM_RUNS; ++run) {
+    u64 ns = benchmark_run(packages_per_ms, block_size);
+    if( ns < irq_min_max_ns )
+      irq_min_max_ns = ns;
+  }
+
+  printf("%8u %6u %12.2f %12.1f %12.1f %12.1f %10u\n",
+	 packages_per_ms, block_size,
+	 (double)transfers / NUM_MS, transfers ? (double)packages_received / transfers : 0.0,
+	 (double)packages_received / NUM_MS, (double)irq_sections / NUM_MS, (u32)irq_min_max_ns);
+}
+
+
+// ------- re-connection during the Tx handler -------
+static void reconnect_isr(void)
+{
+  connect();
+
+  // a higher priority task sends new packages and starts the next transfer
+  send(1 + random_number() % 16, 16);
+  MIOS32_USB_MIDI_Periodic_mS();
+}
+
+static void reconnect_test(void)
+{
+  u32 i;
+
+  lfsr = 2463534242u;
+  connect();
+  isr_func = reconnect_isr;
+
+  for(i=0; i<NUM_RECONNECTS; ++i) {
+    u32 poll, num_polls;
+
+    // the buffer runs empty sometimes, so that the Tx handler of the task
+    // (and not only the IN callback) starts new transfers
+    send(random_number() % 40, 1 + random_number() % 16);
+
+    // fire at one of the next IRQ enables: sender, Rx handler, Tx handler claim or commit
+    isr_countdown = 1 + random_number() % 4;
+    send(random_number() % 8, 1 + random_number() % 16);
+    MIOS32_USB_MIDI_Periodic_mS();
+
+    num_polls = random_number() % 4;
+    for(poll=0; poll<num_polls; ++poll)
+      endpoint_poll();
+  }
+  isr_countdown = 0;
+
+  printf("%u re-connections at random points of the Tx path, %u packages checked\n",
+	 NUM_RECONNECTS, packages_received);
+}
+
+
+int main(int argc, char *argv[])
+{
+  static const u32 loads[] = { 4, 16, 64, 256, 1024 };
+  u32 i;
+
+  USB_OTG_dev.dev.class_cb = &USB_OTG_dev; // configured
+  MIOS32_USB_MIDI_Init(0);
+
+  printf("IN endpoint polled %d times per mS, Tx buffer %d packages, %d bytes per transfer\n",
+	 POLLS_PER_MS, MIOS32_USB_MIDI_TX_BUFFER_SIZE, MIOS32_USB_MIDI_DATA_IN_SIZE);
+  printf("%8s %6s %12s %12s %12s %12s %10s\n",
+	 "pkg/mS", "block", "transfers/mS", "pkg/transfer", "sent pkg/mS", "IRQ offs/mS", "max nS");
+
+  for(i=0; i<sizeof(loads)/sizeof(u32); ++i) {
+    benchmark(loads[i], 1);
+    benchmark(loads[i], 16);
+  }
+
+  reconnect_test();
+
+  if( errors ) {
+    printf("%d errors\n", errors);
+    return 1;
+  }
+
+  printf("USB MIDI endpoint test passed.\n");
+  return 0;
+}
@@ -0,0 +1 @@
+// empty, see usb_core.h
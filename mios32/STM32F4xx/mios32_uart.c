@@ -78,6 +78,93 @@
 #define MIOS32_UART3_REMAP_FUNC  { GPIO_PinAFConfig(GPIOC, GPIO_PinSource12, GPIO_AF_UART5); GPIO_PinAFConfig(GPIOD, GPIO_PinSource2, GPIO_AF_UART5); }
 
 
+/////////////////////////////////////////////////////////////////////////////
+// DMA mappings (only used for UARTs selected in MIOS32_UART_DMA_RX_MASK/TX_MASK)
+/////////////////////////////////////////////////////////////////////////////
+
+// UARTs which are enabled and handled by this driver
+#define UART_ENABLED_MASK ( \
+  ((NUM_SUPPORTED_UARTS >= 1 && MIOS32_UART0_ASSIGNMENT != 0) ? 0x01 : 0) | \
+  ((NUM_SUPPORTED_UARTS >= 2 && MIOS32_UART1_ASSIGNMENT != 0) ? 0x02 : 0) | \
+  ((NUM_SUPPORTED_UARTS >= 3 && MIOS32_UART2_ASSIGNMENT != 0) ? 0x04 : 0) | \
+  ((NUM_SUPPORTED_UARTS >= 4 && MIOS32_UART3_ASSIGNMENT != 0) ? 0x08 : 0) )
+
+#define UART_DMA_RX_MASK (MIOS32_UART_DMA_RX_MASK & UART_ENABLED_MASK)
+#define UART_DMA_TX_MASK (MIOS32_UART_DMA_TX_MASK & UART_ENABLED_MASK)
+
+// USART3 Tx can only be served by DMA1 Stream3 or Stream4, both are allocated by SPI1 (SRIO)
+#if (UART_DMA_TX_MASK & 0x02) && !defined(MIOS32_DONT_USE_SPI) && !defined(MIOS32_DONT_USE_SPI1)
+# error "MIOS32_UART_DMA_TX_MASK: UART1 can't use DMA while SPI1 is enabled (DMA1 Stream3/4 conflict)"
+#endif
+
+// USART2 Rx can only be served by DMA1 Stream5, which is allocated by SPI2 Tx and I2S
+#if (UART_DMA_RX_MASK & 0x01) && !defined(MIOS32_DONT_USE_SPI) && !defined(MIOS32_DONT_USE_SPI2)
+# error "MIOS32_UART_DMA_RX_MASK: UART0 can't use DMA while SPI2 is enabled (DMA1 Stream5 conflict)"
+#endif
+#if (UART_DMA_RX_MASK & 0x01) && defined(MIOS32_USE_I2S)
+# error "MIOS32_UART_DMA_RX_MASK: UART0 can't use DMA together with I2S (DMA1 Stream5 conflict)"
+#endif
+
+#define MIOS32_UART0_DMA_RX_PTR DMA1_Stream5
+#define MIOS32_UART0_DMA_RX_CHN DMA_Channel_4
+#define MIOS32_UART0_DMA_RX_IRQ_FLAGS (DMA_FLAG_TCIF5 | DMA_FLAG_TEIF5 | DMA_FLAG_HTIF5 | DMA_FLAG_FEIF5 | DMA_FLAG_DMEIF5)
+#define MIOS32_UART0_DMA_RX_IRQ_CHANNEL DMA1_Stream5_IRQn
+#define MIOS32_UART0_DMA_RX_IRQHANDLER_FUNC void DMA1_Stream5_IRQHandler(void)
+#define MIOS32_UART0_DMA_TX_PTR DMA1_Stream6
+#define MIOS32_UART0_DMA_TX_CHN DMA_Channel_4
+#define MIOS32_UART0_DMA_TX_IRQ_FLAGS (DMA_FLAG_TCIF6 | DMA_FLAG_TEIF6 | DMA_FLAG_HTIF6 | DMA_FLAG_FEIF6 | DMA_FLAG_DMEIF6)
+#define MIOS32_UART0_DMA_TX_IRQ_CHANNEL DMA1_Stream6_IRQn
+#define MIOS32_UART0_DMA_TX_IRQHANDLER_FUNC void DMA1_Stream6_IRQHandler(void)
+
+#define MIOS32_UART1_DMA_RX_PTR DMA1_Stream1
+#define MIOS32_UART1_DMA_RX_CHN DMA_Channel_4
+#define MIOS32_UART1_DMA_RX_IRQ_FLAGS (DMA_FLAG_TCIF1 | DMA_FLAG_TEIF1 | DMA_FLAG_HTIF1 | DMA_FLAG_FEIF1 | DMA_FLAG_DMEIF1)
+#define MIOS32_UART1_DMA_RX_IRQ_CHANNEL DMA1_Stream1_IRQn
+#define MIOS32_UART1_DMA_RX_IRQHANDLER_FUNC void DMA1_Stream1_IRQHandler(void)
+#define MIOS32_UART1_DMA_TX_PTR DMA1_Stream3
+#define MIOS32_UART1_DMA_TX_CHN DMA_Channel_4
+#define MIOS32_UART1_DMA_TX_IRQ_FLAGS (DMA_FLAG_TCIF3 | DMA_FLAG_TEIF3 | DMA_FLAG_HTIF3 | DMA_FLAG_FEIF3 | DMA_FLAG_DMEIF3)
+#define MIOS32_UART1_DMA_TX_IRQ_CHANNEL DMA1_Stream3_IRQn
+#define MIOS32_UART1_DMA_TX_IRQHANDLER_FUNC void DMA1_Stream3_IRQHandler(void)
+
+#define MIOS32_UART2_DMA_RX_PTR DMA2_Stream5
+#define MIOS32_UART2_DMA_RX_CHN DMA_Channel_4
+#define MIOS32_UART2_DMA_RX_IRQ_FLAGS (DMA_FLAG_TCIF5 | DMA_FLAG_TEIF5 | DMA_FLAG_HTIF5 | DMA_FLAG_FEIF5 | DMA_FLAG_DMEIF5)
+#define MIOS32_UART2_DMA_RX_IRQ_CHANNEL DMA2_Stream5_IRQn
+#define MIOS32_UART2_DMA_RX_IRQHANDLER_FUNC void DMA2_Stream5_IRQHandler(void)
+#define MIOS32_UART2_DMA_TX_PTR DMA2_Stream6
+#define MIOS32_UART2_DMA_TX_CHN DMA_Channel_5
+#define MIOS32_UART2_DMA_TX_IRQ_FLAGS (DMA_FLAG_TCIF6 | DMA_FLAG_TEIF6 | DMA_FLAG_HTIF6 | DMA_FLAG_FEIF6 | DMA_FLAG_DMEIF6)
+#define MIOS32_UART2_DMA_TX_IRQ_CHANNEL DMA2_Stream6_IRQn
+#define MIOS32_UART2_DMA_TX_IRQHANDLER_FUNC void DMA2_Stream6_IRQHandler(void)
+
+#define MIOS32_UART3_DMA_RX_PTR DMA1_Stream0
+#define MIOS32_UART3_DMA_RX_CHN DMA_Channel_4
+#define MIOS32_UART3_DMA_RX_IRQ_FLAGS (DMA_FLAG_TCIF0 | DMA_FLAG_TEIF0 | DMA_FLAG_HTIF0 | DMA_FLAG_FEIF0 | DMA_FLAG_DMEIF0)
+#define MIOS32_UART3_DMA_RX_IRQ_CHANNEL DMA1_Stream0_IRQn
+#define MIOS32_UART3_DMA_RX_IRQHANDLER_FUNC void DMA1_Stream0_IRQHandler(void)
+#define MIOS32_UART3_DMA_TX_PTR DMA1_Stream7
+#define MIOS32_UART3_DMA_TX_CHN DMA_Channel_4
+#define MIOS32_UART3_DMA_TX_IRQ_FLAGS (DMA_FLAG_TCIF7 | DMA_FLAG_TEIF7 | DMA_FLAG_HTIF7 | DMA_FLAG_FEIF7 | DMA_FLAG_DMEIF7)
+#define MIOS32_UART3_DMA_TX_IRQ_CHANNEL DMA1_Stream7_IRQn
+#define MIOS32_UART3_DMA_TX_IRQHANDLER_FUNC void DMA1_Stream7_IRQHandler(void)
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Local types
+/////////////////////////////////////////////////////////////////////////////
+
+#if UART_DMA_RX_MASK || UART_DMA_TX_MASK
+typedef struct {
+  USART_TypeDef *usart;
+  DMA_Stream_TypeDef *stream;
+  u32 channel;
+  u32 irq_flags;
+  u8  irq_channel;
+} uart_dma_t;
+#endif
+
+
 /////////////////////////////////////////////////////////////////////////////
 // Local variables
 /////////////////////////////////////////////////////////////////////////////
@@ -97,6 +184,46 @@ static volatile u8 tx_buffer_head[NUM_SUPPORTED_UARTS];
 static volatile u8 tx_buffer_size[NUM_SUPPORTED_UARTS];
 #endif
 
+#if UART_DMA_RX_MASK
+static const uart_dma_t uart_dma_rx[4] = {
+  { MIOS32_UART0,    MIOS32_UART0_DMA_RX_PTR, MIOS32_UART0_DMA_RX_CHN, MIOS32_UART0_DMA_RX_IRQ_FLAGS, MIOS32_UART0_DMA_RX_IRQ_CHANNEL },
+  { MIOS32_UART1,    MIOS32_UART1_DMA_RX_PTR, MIOS32_UART1_DMA_RX_CHN, MIOS32_UART1_DMA_RX_IRQ_FLAGS, MIOS32_UART1_DMA_RX_IRQ_CHANNEL },
+  { MIOS32_UART2_RX, MIOS32_UART2_DMA_RX_PTR, MIOS32_UART2_DMA_RX_CHN, MIOS32_UART2_DMA_RX_IRQ_FLAGS, MIOS32_UART2_DMA_RX_IRQ_CHANNEL },
+  { MIOS32_UART3,    MIOS32_UART3_DMA_RX_PTR, MIOS32_UART3_DMA_RX_CHN, MIOS32_UART3_DMA_RX_IRQ_FLAGS, MIOS32_UART3_DMA_RX_IRQ_CHANNEL },
+};
+
+static u8 dma_rx_buffer[NUM_SUPPORTED_UARTS][MIOS32_UART_DMA_RX_BUFFER_SIZE];
+static u16 dma_rx_tail[NUM_SUPPORTED_UARTS];
+#endif
+
+#if UART_DMA_TX_MASK
+static const uart_dma_t uart_dma_tx[4] = {
+  { MIOS32_UART0,    MIOS32_UART0_DMA_TX_PTR, MIOS32_UART0_DMA_TX_CHN, MIOS32_UART0_DMA_TX_IRQ_FLAGS, MIOS32_UART0_DMA_TX_IRQ_CHANNEL },
+  { MIOS32_UART1,    MIOS32_UART1_DMA_TX_PTR, MIOS32_UART1_DMA_TX_CHN, MIOS32_UART1_DMA_TX_IRQ_FLAGS, MIOS32_UART1_DMA_TX_IRQ_CHANNEL },
+  { MIOS32_UART2_TX, MIOS32_UART2_DMA_TX_PTR, MIOS32_UART2_DMA_TX_CHN, MIOS32_UART2_DMA_TX_IRQ_FLAGS, MIOS32_UART2_DMA_TX_IRQ_CHANNEL },
+  { MIOS32_UART3,    MIOS32_UART3_DMA_TX_PTR, MIOS32_UART3_DMA_TX_CHN, MIOS32_UART3_DMA_TX_IRQ_FLAGS, MIOS32_UART3_DMA_TX_IRQ_CHANNEL },
+};
+
+// number of bytes which are currently transfered from the Tx buffer (0: DMA idle)
+static volatile u8 dma_tx_len[NUM_SUPPORTED_UARTS];
+#endif
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Local prototypes
+/////////////////////////////////////////////////////////////////////////////
+
+#if UART_DMA_RX_MASK || UART_DMA_TX_MASK
+static void MIOS32_UART_DMA_Init(u8 uart);
+#endif
+#if UART_DMA_RX_MASK
+static void MIOS32_UART_DMA_RxHandler(u8 uart);
+#endif
+#if UART_DMA_TX_MASK
+static void MIOS32_UART_DMA_TxStart(u8 uart);
+static void MIOS32_UART_DMA_TxHandler(u8 uart);
+#endif
+
 
 /////////////////////////////////////////////////////////////////////////////
 //! Initializes UART interfaces
@@ -147,24 +274,44 @@ s32 MIOS32_UART_Init(u32 mode)
   // configure and enable UART interrupts
 #if MIOS32_UART0_ASSIGNMENT != 0
   MIOS32_IRQ_Install(MIOS32_UART0_IRQ_CHANNEL, MIOS32_IRQ_UART_PRIORITY);
+#if !(UART_DMA_RX_MASK & 0x01) // DMA ports only use the IDLE interrupt
   USART_ITConfig(MIOS32_UART0, USART_IT_RXNE, ENABLE);
 #endif
+#endif
 
 #if NUM_SUPPORTED_UARTS >= 2 && MIOS32_UART1_ASSIGNMENT != 0
   MIOS32_IRQ_Install(MIOS32_UART1_IRQ_CHANNEL, MIOS32_IRQ_UART_PRIORITY);
+#if !(UART_DMA_RX_MASK & 0x02) // DMA ports only use the IDLE interrupt
   USART_ITConfig(MIOS32_UART1, USART_IT_RXNE, ENABLE);
 #endif
+#endif
 
 #if NUM_SUPPORTED_UARTS >= 3 && MIOS32_UART2_ASSIGNMENT != 0
   MIOS32_IRQ_Install(MIOS32_UART2_TX_IRQ_CHANNEL, MIOS32_IRQ_UART_PRIORITY);
   MIOS32_IRQ_Install(MIOS32_UART2_RX_IRQ_CHANNEL, MIOS32_IRQ_UART_PRIORITY);
+#if !(UART_DMA_RX_MASK & 0x04) // DMA ports only use the IDLE interrupt
   USART_ITConfig(MIOS32_UART2_RX, USART_IT_RXNE, ENABLE);
 #endif
+#endif
 
 #if NUM_SUPPORTED_UARTS >= 4 && MIOS32_UART3_ASSIGNMENT != 0
   MIOS32_IRQ_Install(MIOS32_UART3_IRQ_CHANNEL, MIOS32_IRQ_UART_PRIORITY);
+#if !(UART_DMA_RX_MASK & 0x08) // DMA ports only use the IDLE interrupt
   USART_ITConfig(MIOS32_UART3, USART_IT_RXNE, ENABLE);
 #endif
+#endif
+
+#if UART_DMA_RX_MASK || UART_DMA_TX_MASK
+  // switch selected UARTs to DMA transfers
+  RCC_AHB1PeriphClockCmd(RCC_AHB1Periph_DMA1 | RCC_AHB1Periph_DMA2, ENABLE);
+  {
+    u8 uart;
+    for(uart=0; uart<NUM_SUPPORTED_UARTS; ++uart) {
+      if( (UART_DMA_RX_MASK | UART_DMA_TX_MASK) & (1 << uart) )
+        MIOS32_UART_DMA_Init(uart);
+    }
+  }
+#endif
 
   // enable UARTs
 #if MIOS32_UART0_ASSIGNMENT != 0
@@ -685,7 +832,8 @@ s32 MIOS32_UART_TxBufferPutMore_NonBlocking(u8 uart, u8 *buffer, u16 len)
       tx_buffer_head[uart] = 0;
 
     // enable Tx interrupt if buffer was empty
-    if( ++tx_buffer_size[uart] == 1 ) {
+    // (DMA transfers are started after all bytes have been copied)
+    if( ++tx_buffer_size[uart] == 1 && !(UART_DMA_TX_MASK & (1 << uart)) ) {
       switch( uart ) {
         case 0: MIOS32_UART0->CR1 |= (1 << 7); break; // enable TXE interrupt (TXEIE=1)
         case 1: MIOS32_UART1->CR1 |= (1 << 7); break; // enable TXE interrupt (TXEIE=1)
@@ -696,6 +844,12 @@ s32 MIOS32_UART_TxBufferPutMore_NonBlocking(u8 uart, u8 *buffer, u16 len)
     }
   }
 
+#if UART_DMA_TX_MASK
+  // start DMA transfer if not already running (will be continued by MIOS32_UART_DMA_TxHandler)
+  if( (UART_DMA_TX_MASK & (1 << uart)) && !dma_tx_len[uart] )
+    MIOS32_UART_DMA_TxStart(uart);
+#endif
+
   MIOS32_IRQ_Enable();
 
   return 0; // no error
@@ -767,6 +921,14 @@ s32 MIOS32_UART_TxBufferPut(u8 uart, u8 b)
 #if NUM_SUPPORTED_UARTS >= 1
 MIOS32_UART0_IRQHANDLER_FUNC
 {
+#if UART_DMA_RX_MASK & 0x01
+  if( MIOS32_UART0->SR & (1 << 4) ) { // check if IDLE flag is set
+    u8 b = MIOS32_UART0->DR; // flag cleared by reading SR, then DR
+    if( b ); // prevent "unused variable" warning
+    MIOS32_UART_DMA_RxHandler(0);
+  }
+#else
+  // (skipped if DMA reception is enabled: reading DR here would steal bytes from the DMA)
   if( MIOS32_UART0->SR & (1 << 5) ) { // check if RXNE flag is set
     u8 b = MIOS32_UART0->DR;
 
@@ -776,6 +938,7 @@ MIOS32_UART0_IRQHANDLER_FUNC
       // here we could add some error handling
     }
   }
+#endif
 
   if( MIOS32_UART0->SR & (1 << 7) ) { // check if TXE flag is set
     if( MIOS32_UART_TxBufferUsed(0) > 0 ) {
@@ -800,6 +963,14 @@ MIOS32_UART0_IRQHANDLER_FUNC
 #if NUM_SUPPORTED_UARTS >= 2
 MIOS32_UART1_IRQHANDLER_FUNC
 {
+#if UART_DMA_RX_MASK & 0x02
+  if( MIOS32_UART1->SR & (1 << 4) ) { // check if IDLE flag is set
+    u8 b = MIOS32_UART1->DR; // flag cleared by reading SR, then DR
+    if( b ); // prevent "unused variable" warning
+    MIOS32_UART_DMA_RxHandler(1);
+  }
+#else
+  // (skipped if DMA reception is enabled: reading DR here would steal bytes from the DMA)
   if( MIOS32_UART1->SR & (1 << 5) ) { // check if RXNE flag is set
     u8 b = MIOS32_UART1->DR;
 
@@ -809,6 +980,7 @@ MIOS32_UART1_IRQHANDLER_FUNC
       // here we could add some error handling
     }
   }
+#endif
   
   if( MIOS32_UART1->SR & (1 << 7) ) { // check if TXE flag is set
     if( MIOS32_UART_TxBufferUsed(1) > 0 ) {
@@ -856,6 +1028,14 @@ MIOS32_UART2_TX_IRQHANDLER_FUNC
 
 MIOS32_UART2_RX_IRQHANDLER_FUNC
 {
+#if UART_DMA_RX_MASK & 0x04
+  if( MIOS32_UART2_RX->SR & (1 << 4) ) { // check if IDLE flag is set
+    u8 b = MIOS32_UART2_RX->DR; // flag cleared by reading SR, then DR
+    if( b ); // prevent "unused variable" warning
+    MIOS32_UART_DMA_RxHandler(2);
+  }
+#else
+  // (skipped if DMA reception is enabled: reading DR here would steal bytes from the DMA)
   if( MIOS32_UART2_RX->SR & (1 << 5) ) { // check if RXNE flag is set
     u8 b = MIOS32_UART2_RX->DR;
 
@@ -865,6 +1045,7 @@ MIOS32_UART2_RX_IRQHANDLER_FUNC
       // here we could add some error handling
     }
   }
+#endif
   
   if( MIOS32_UART2_RX->SR & (1 << 7) ) { // check if TXE flag is set
     // dummy... this UART is only used for output transfers
@@ -880,6 +1061,14 @@ MIOS32_UART2_RX_IRQHANDLER_FUNC
 #if NUM_SUPPORTED_UARTS >= 4
 MIOS32_UART3_IRQHANDLER_FUNC
 {
+#if UART_DMA_RX_MASK & 0x08
+  if( MIOS32_UART3->SR & (1 << 4) ) { // check if IDLE flag is set
+    u8 b = MIOS32_UART3->DR; // flag cleared by reading SR, then DR
+    if( b ); // prevent "unused variable" warning
+    MIOS32_UART_DMA_RxHandler(3);
+  }
+#else
+  // (skipped if DMA reception is enabled: reading DR here would steal bytes from the DMA)
   if( MIOS32_UART3->SR & (1 << 5) ) { // check if RXNE flag is set
     u8 b = MIOS32_UART3->DR;
 
@@ -889,6 +1078,7 @@ MIOS32_UART3_IRQHANDLER_FUNC
       // here we could add some error handling
     }
   }
+#endif
   
   if( MIOS32_UART3->SR & (1 << 7) ) { // check if TXE flag is set
     if( MIOS32_UART_TxBufferUsed(3) > 0 ) {
@@ -907,4 +1097,217 @@ MIOS32_UART3_IRQHANDLER_FUNC
 #endif
 
 
+#if UART_DMA_RX_MASK || UART_DMA_TX_MASK
+/////////////////////////////////////////////////////////////////////////////
+// Switches a UART to DMA based reception and/or transmission
+// (called from MIOS32_UART_Init() after the interrupts have been configured)
+/////////////////////////////////////////////////////////////////////////////
+static void MIOS32_UART_DMA_Init(u8 uart)
+{
+  DMA_InitTypeDef DMA_InitStructure;
+  DMA_StructInit(&DMA_InitStructure);
+  DMA_InitStructure.DMA_PeripheralInc = DMA_PeripheralInc_Disable;
+  DMA_InitStructure.DMA_MemoryInc = DMA_MemoryInc_Enable;
+  DMA_InitStructure.DMA_PeripheralDataSize = DMA_PeripheralDataSize_Byte;
+  DMA_InitStructure.DMA_MemoryDataSize = DMA_MemoryDataSize_Byte;
+  DMA_InitStructure.DMA_Priority = DMA_Priority_Medium;
+
+#if UART_DMA_RX_MASK
+  if( UART_DMA_RX_MASK & (1 << uart) ) {
+    const uart_dma_t *dma = &uart_dma_rx[uart];
+
+    // bytes are received by DMA, the IDLE interrupt notifies the end of a transfer
+    USART_ITConfig(dma->usart, USART_IT_RXNE, DISABLE);
+
+    // circular buffer, read out on half/complete transfer and idle line
+    DMA_Cmd(dma->stream, DISABLE);
+    DMA_InitStructure.DMA_Channel = dma->channel;
+    DMA_InitStructure.DMA_PeripheralBaseAddr = (u32)&dma->usart->DR;
+    DMA_InitStructure.DMA_Memory0BaseAddr = (u32)&dma_rx_buffer[uart][0];
+    DMA_InitStructure.DMA_DIR = DMA_DIR_PeripheralToMemory;
+    DMA_InitStructure.DMA_BufferSize = MIOS32_UART_DMA_RX_BUFFER_SIZE;
+    DMA_InitStructure.DMA_Mode = DMA_Mode_Circular;
+    DMA_Init(dma->stream, &DMA_InitStructure);
+    dma_rx_tail[uart] = 0;
+
+    DMA_ClearFlag(dma->stream, dma->irq_flags);
+    DMA_ITConfig(dma->stream, DMA_IT_HT | DMA_IT_TC, ENABLE);
+    MIOS32_IRQ_Install(dma->irq_channel, MIOS32_IRQ_UART_PRIORITY);
+    DMA_Cmd(dma->stream, ENABLE);
+
+    USART_DMACmd(dma->usart, USART_DMAReq_Rx, ENABLE);
+    USART_ITConfig(dma->usart, USART_IT_IDLE, ENABLE);
+  }
+#endif
+
+#if UART_DMA_TX_MASK
+  if( UART_DMA_TX_MASK & (1 << uart) ) {
+    const uart_dma_t *dma = &uart_dma_tx[uart];
+
+    // stream is enabled by MIOS32_UART_DMA_TxStart() whenever the Tx buffer is filled
+    DMA_Cmd(dma->stream, DISABLE);
+    DMA_InitStructure.DMA_Channel = dma->channel;
+    DMA_InitStructure.DMA_PeripheralBaseAddr = (u32)&dma->usart->DR;
+    DMA_InitStructure.DMA_Memory0BaseAddr = (u32)&tx_buffer[uart][0];
+    DMA_InitStructure.DMA_DIR = DMA_DIR_MemoryToPeripheral;
+    DMA_InitStructure.DMA_BufferSize = 1;
+    DMA_InitStructure.DMA_Mode = DMA_Mode_Normal;
+    DMA_Init(dma->stream, &DMA_InitStructure);
+    dma_tx_len[uart] = 0;
+
+    DMA_ClearFlag(dma->stream, dma->irq_flags);
+    DMA_ITConfig(dma->stream, DMA_IT_TC, ENABLE);
+    MIOS32_IRQ_Install(dma->irq_channel, MIOS32_IRQ_UART_PRIORITY);
+
+    USART_DMACmd(dma->usart, USART_DMAReq_Tx, ENABLE);
+  }
+#endif
+}
+#endif
+
+
+#if UART_DMA_RX_MASK
+/////////////////////////////////////////////////////////////////////////////
+// Transfers the bytes which have been received by DMA into the Rx buffer
+// Called on idle line and half/complete DMA transfer with UART priority
+/////////////////////////////////////////////////////////////////////////////
+static void MIOS32_UART_DMA_RxHandler(u8 uart)
+{
+  // DMA write position (NDTR counts down, reloaded in circular mode)
+  u16 head = MIOS32_UART_DMA_RX_BUFFER_SIZE - uart_dma_rx[uart].stream->NDTR;
+  if( head >= MIOS32_UART_DMA_RX_BUFFER_SIZE )
+    head = 0;
+
+  u16 tail = dma_rx_tail[uart];
+  u8 is_midi = MIOS32_UART_IsAssignedToMIDI(uart);
+  while( tail != head ) {
+    u8 b = dma_rx_buffer[uart][tail];
+
+    s32 status = is_midi ? MIOS32_MIDI_SendByteToRxCallback(UART0 + uart, b) : 0;
+
+    if( status == 0 && MIOS32_UART_RxBufferPut(uart, b) < 0 ) {
+      // here we could add some error handling
+    }
+
+    if( ++tail >= MIOS32_UART_DMA_RX_BUFFER_SIZE )
+      tail = 0;
+  }
+  dma_rx_tail[uart] = tail;
+}
+#endif
+
+
+#if UART_DMA_TX_MASK
+/////////////////////////////////////////////////////////////////////////////
+// Starts a DMA transfer of the continuous part of the Tx buffer
+// IRQs have to be disabled, or function has to be called from the DMA IRQ
+/////////////////////////////////////////////////////////////////////////////
+static void MIOS32_UART_DMA_TxStart(u8 uart)
+{
+  const uart_dma_t *dma = &uart_dma_tx[uart];
+
+  u16 len = tx_buffer_size[uart];
+  if( !len )
+    return; // nothing to send
+
+  // transfer until end of ring buffer, the remaining bytes will be sent with the next transfer
+  u16 tail = tx_buffer_tail[uart];
+  if( len > (MIOS32_UART_TX_BUFFER_SIZE - tail) )
+    len = MIOS32_UART_TX_BUFFER_SIZE - tail;
+
+  // bytes are taken from the buffer once the transfer has been completed
+  dma_tx_len[uart] = len;
+  dma->stream->M0AR = (u32)&tx_buffer[uart][tail];
+  dma->stream->NDTR = len;
+  DMA_ClearFlag(dma->stream, dma->irq_flags);
+  dma->stream->CR |= DMA_SxCR_EN;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// Called when a DMA transmission has been completed
+/////////////////////////////////////////////////////////////////////////////
+static void MIOS32_UART_DMA_TxHandler(u8 uart)
+{
+  u8 len = dma_tx_len[uart];
+
+  if( len ) {
+    u16 tail = tx_buffer_tail[uart] + len;
+    if( tail >= MIOS32_UART_TX_BUFFER_SIZE )
+      tail -= MIOS32_UART_TX_BUFFER_SIZE;
+    tx_buffer_tail[uart] = tail;
+    tx_buffer_size[uart] -= len;
+    dma_tx_len[uart] = 0;
+  }
+
+  // chain next transfer
+  MIOS32_UART_DMA_TxStart(uart);
+}
+#endif
+
+
+#if UART_DMA_RX_MASK & 0x01
+MIOS32_UART0_DMA_RX_IRQHANDLER_FUNC
+{
+  DMA_ClearFlag(MIOS32_UART0_DMA_RX_PTR, MIOS32_UART0_DMA_RX_IRQ_FLAGS);
+  MIOS32_UART_DMA_RxHandler(0);
+}
+#endif
+
+#if UART_DMA_TX_MASK & 0x01
+MIOS32_UART0_DMA_TX_IRQHANDLER_FUNC
+{
+  DMA_ClearFlag(MIOS32_UART0_DMA_TX_PTR, MIOS32_UART0_DMA_TX_IRQ_FLAGS);
+  MIOS32_UART_DMA_TxHandler(0);
+}
+#endif
+
+#if UART_DMA_RX_MASK & 0x02
+MIOS32_UART1_DMA_RX_IRQHANDLER_FUNC
+{
+  DMA_ClearFlag(MIOS32_UART1_DMA_RX_PTR, MIOS32_UART1_DMA_RX_IRQ_FLAGS);
+  MIOS32_UART_DMA_RxHandler(1);
+}
+#endif
+
+#if UART_DMA_TX_MASK & 0x02
+MIOS32_UART1_DMA_TX_IRQHANDLER_FUNC
+{
+  DMA_ClearFlag(MIOS32_UART1_DMA_TX_PTR, MIOS32_UART1_DMA_TX_IRQ_FLAGS);
+  MIOS32_UART_DMA_TxHandler(1);
+}
+#endif
+
+#if UART_DMA_RX_MASK & 0x04
+MIOS32_UART2_DMA_RX_IRQHANDLER_FUNC
+{
+  DMA_ClearFlag(MIOS32_UART2_DMA_RX_PTR, MIOS32_UART2_DMA_RX_IRQ_FLAGS);
+  MIOS32_UART_DMA_RxHandler(2);
+}
+#endif
+
+#if UART_DMA_TX_MASK & 0x04
+MIOS32_UART2_DMA_TX_IRQHANDLER_FUNC
+{
+  DMA_ClearFlag(MIOS32_UART2_DMA_TX_PTR, MIOS32_UART2_DMA_TX_IRQ_FLAGS);
+  MIOS32_UART_DMA_TxHandler(2);
+}
+#endif
+
+#if UART_DMA_RX_MASK & 0x08
+MIOS32_UART3_DMA_RX_IRQHANDLER_FUNC
+{
+  DMA_ClearFlag(MIOS32_UART3_DMA_RX_PTR, MIOS32_UART3_DMA_RX_IRQ_FLAGS);
+  MIOS32_UART_DMA_RxHandler(3);
+}
+#endif
+
+#if UART_DMA_TX_MASK & 0x08
+MIOS32_UART3_DMA_TX_IRQHANDLER_FUNC
+{
+  DMA_ClearFlag(MIOS32_UART3_DMA_TX_PTR, MIOS32_UART3_DMA_TX_IRQ_FLAGS);
+  MIOS32_UART_DMA_TxHandler(3);
+}
+#endif
+
+
 #endif /* MIOS32_DONT_USE_UART */
@@ -75,6 +75,7 @@ static USBH_MIDI_transfer_state_t USBH_MIDI_transfer_state;
 
 static void MIOS32_USB_MIDI_TxBufferHandler(void);
 static void MIOS32_USB_MIDI_RxBufferHandler(void);
+static u16 MIOS32_USB_MIDI_TxBufferUsed(void);
 
 
 /////////////////////////////////////////////////////////////////////////////
@@ -89,11 +90,15 @@ static volatile u16 rx_buffer_size;
 static volatile u8 rx_buffer_new_data;
 
 // Tx buffer
-static u32 tx_buffer[MIOS32_USB_MIDI_TX_BUFFER_SIZE];
+// tx_buffer_head is only modified by the senders, tx_buffer_tail only by the
+// Tx handlers, so that they don't need to lock out each other
+static volatile u32 tx_buffer[MIOS32_USB_MIDI_TX_BUFFER_SIZE];
 static volatile u16 tx_buffer_tail;
 static volatile u16 tx_buffer_head;
-static volatile u16 tx_buffer_size;
 static volatile u8 tx_buffer_busy;
+// incremented on each connection change, so that a Tx handler which copied
+// packages meanwhile doesn't commit its tail into the reset buffer
+static volatile u8 tx_buffer_generation;
 
 // transfer possible?
 static u8 transfer_possible = 0;
@@ -127,7 +132,8 @@ s32 MIOS32_USB_MIDI_ChangeConnectionState(u8 connected)
   // clear buffer counters and busy/wait signals again (e.g., so that no invalid data will be sent out)
   rx_buffer_tail = rx_buffer_head = rx_buffer_size = 0;
   rx_buffer_new_data = 0; // no data received yet
-  tx_buffer_tail = tx_buffer_head = tx_buffer_size = 0;
+  tx_buffer_tail = tx_buffer_head = 0;
+  ++tx_buffer_generation;
 
   if( connected ) {
     transfer_possible = 1;
@@ -176,13 +182,69 @@ s32 MIOS32_USB_MIDI_CheckAvailable(u8 cable)
 //! \note Applications shouldn't call this function directly, instead please use \ref MIOS32_MIDI layer functions
 /////////////////////////////////////////////////////////////////////////////
 s32 MIOS32_USB_MIDI_PackageSend_NonBlocking(mios32_midi_package_t package)
+{
+  s32 status = MIOS32_USB_MIDI_PackageSendMulti_NonBlocking(&package, 1);
+  return (status > 0) ? 0 : status;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//! This function puts a new MIDI package into the Tx buffer
+//! (blocking function)
+//! \param[in] package MIDI package
+//! \return 0: no error
+//! \return -1: USB not connected
+//! \note Applications shouldn't call this function directly, instead please use \ref MIOS32_MIDI layer functions
+/////////////////////////////////////////////////////////////////////////////
+s32 MIOS32_USB_MIDI_PackageSend(mios32_midi_package_t package)
+{
+  return MIOS32_USB_MIDI_PackageSendMulti(&package, 1);
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//! This function puts multiple MIDI packages into the Tx buffer
+//!
+//! The packages are made visible to the Tx handler at once, so that they
+//! are sent with as few USB transfers as possible. Interrupts are only
+//! disabled to serialize concurrent senders, at most for one USB frame
+//! (MIOS32_USB_MIDI_DATA_IN_SIZE/4 packages).
+//! \param[in] *packages pointer to MIDI packages
+//! \param[in] num number of packages
+//! \return > 0: number of packages which have been put into the buffer
+//!             (can be less than num, caller should retry with the remaining packages)
+//! \return -1: USB not connected
+//! \return -2: buffer is full
+//!             caller should retry until buffer is free again
+//! \note Applications shouldn't call this function directly, instead please use \ref MIOS32_MIDI layer functions
+/////////////////////////////////////////////////////////////////////////////
+s32 MIOS32_USB_MIDI_PackageSendMulti_NonBlocking(mios32_midi_package_t *packages, u16 num)
 {
   // device available?
   if( !transfer_possible )
     return -1;
 
+  if( num > (MIOS32_USB_MIDI_DATA_IN_SIZE/4) )
+    num = MIOS32_USB_MIDI_DATA_IN_SIZE/4;
+
+  // put packages into buffer
+  // only the head pointer is modified, it's updated after all packages have been copied
+  MIOS32_IRQ_Disable();
+  u16 num_free = (MIOS32_USB_MIDI_TX_BUFFER_SIZE-1) - MIOS32_USB_MIDI_TxBufferUsed();
+  if( num > num_free )
+    num = num_free;
+
+  u16 head = tx_buffer_head;
+  int i;
+  for(i=0; i<num; ++i) {
+    tx_buffer[head] = packages[i].ALL;
+    if( ++head >= MIOS32_USB_MIDI_TX_BUFFER_SIZE )
+      head = 0;
+  }
+  tx_buffer_head = head;
+  MIOS32_IRQ_Enable();
+
   // buffer full?
-  if( tx_buffer_size >= (MIOS32_USB_MIDI_TX_BUFFER_SIZE-1) ) {
+  if( !num ) {
     if( USB_OTG_IsDeviceMode(&USB_OTG_dev) ) {
       // call USB handler, so that we are able to get the buffer free again on next execution
       // (this call simplifies polling loops!)
@@ -198,26 +260,19 @@ s32 MIOS32_USB_MIDI_PackageSend_NonBlocking(mios32_midi_package_t package)
     return -2;
   }
 
-  // put package into buffer - this operation should be atomic!
-  MIOS32_IRQ_Disable();
-  tx_buffer[tx_buffer_head++] = package.ALL;
-  if( tx_buffer_head >= MIOS32_USB_MIDI_TX_BUFFER_SIZE )
-    tx_buffer_head = 0;
-  ++tx_buffer_size;
-  MIOS32_IRQ_Enable();
-
-  return 0;
+  return num;
 }
 
 /////////////////////////////////////////////////////////////////////////////
-//! This function puts a new MIDI package into the Tx buffer
+//! This function puts multiple MIDI packages into the Tx buffer
 //! (blocking function)
-//! \param[in] package MIDI package
+//! \param[in] *packages pointer to MIDI packages
+//! \param[in] num number of packages
 //! \return 0: no error
 //! \return -1: USB not connected
 //! \note Applications shouldn't call this function directly, instead please use \ref MIOS32_MIDI layer functions
 /////////////////////////////////////////////////////////////////////////////
-s32 MIOS32_USB_MIDI_PackageSend(mios32_midi_package_t package)
+s32 MIOS32_USB_MIDI_PackageSendMulti(mios32_midi_package_t *packages, u16 num)
 {
   static u16 timeout_ctr = 0;
   // this function could hang up if USB is available, but MIDI port won't be
@@ -228,18 +283,24 @@ s32 MIOS32_USB_MIDI_PackageSend(mios32_midi_package_t package)
   // was successfull (MIDI port will be used by host), timeout value is
   // reset again
 
-  s32 error;
-
-  while( (error=MIOS32_USB_MIDI_PackageSend_NonBlocking(package)) == -2 ) {
-    if( timeout_ctr >= 10000 )
-      break;
-    ++timeout_ctr;
+  while( num ) {
+    s32 status = MIOS32_USB_MIDI_PackageSendMulti_NonBlocking(packages, num);
+
+    if( status == -2 ) {
+      if( timeout_ctr >= 10000 )
+	return status;
+      ++timeout_ctr;
+    } else if( status < 0 ) {
+      return status;
+    } else {
+      // no error: reset timeout counter
+      timeout_ctr = 0;
+      packages += status;
+      num -= status;
+    }
   }
 
-  if( error >= 0 ) // no error: reset timeout counter
-    timeout_ctr = 0;
-
-  return error;
+  return 0; // no error
 }
 
 
@@ -317,33 +378,57 @@ static void MIOS32_USB_MIDI_TxBufferHandler(void)
   //   - new packages are in the buffer
   //   - the device is configured
 
-  // atomic operation to avoid conflict with other interrupts
+  // claim the IN pipe (atomic operation to avoid conflict with the IN callback)
   MIOS32_IRQ_Disable();
+  u16 count = MIOS32_USB_MIDI_TxBufferUsed();
+  if( tx_buffer_busy || !count || !transfer_possible ) {
+    MIOS32_IRQ_Enable();
+    return;
+  }
+  // notify that new package is sent
+  tx_buffer_busy = 1;
+  u16 tail = tx_buffer_tail;
+  u8 generation = tx_buffer_generation;
+  MIOS32_IRQ_Enable();
 
-  if( !tx_buffer_busy && tx_buffer_size && transfer_possible ) {
-    s16 count = (tx_buffer_size > (MIOS32_USB_MIDI_DATA_IN_SIZE/4)) ? (MIOS32_USB_MIDI_DATA_IN_SIZE/4) : tx_buffer_size;
-
-    // notify that new package is sent
-    tx_buffer_busy = 1;
-
-    // send to IN pipe
-    tx_buffer_size -= count;
+  // pack as many packages as possible into the transfer
+  if( count > (MIOS32_USB_MIDI_DATA_IN_SIZE/4) )
+    count = MIOS32_USB_MIDI_DATA_IN_SIZE/4;
 
-    u32 *buf_addr = (u32 *)USB_tx_buffer;
-    int i;
-    for(i=0; i<count; ++i) {
-      *(buf_addr++) = tx_buffer[tx_buffer_tail];
-      if( ++tx_buffer_tail >= MIOS32_USB_MIDI_TX_BUFFER_SIZE )
-	tx_buffer_tail = 0;
-    }
+  // the senders don't touch the tail, therefore no need to disable IRQs while copying
+  // (into a local buffer: after a re-connection, USB_tx_buffer could already be in use by another transfer)
+  u32 packages[MIOS32_USB_MIDI_DATA_IN_SIZE/4];
+  int i;
+  for(i=0; i<count; ++i) {
+    packages[i] = tx_buffer[tail];
+    if( ++tail >= MIOS32_USB_MIDI_TX_BUFFER_SIZE )
+      tail = 0;
+  }
 
+  // send to IN pipe
+  // could have been disconnected meanwhile: a re-connection resets the buffer and tx_buffer_busy,
+  // and another handler could already have claimed the pipe again, therefore check the generation
+  MIOS32_IRQ_Disable();
+  if( transfer_possible && tx_buffer_busy && generation == tx_buffer_generation ) {
+    tx_buffer_tail = tail;
+    for(i=0; i<count; ++i)
+      USB_tx_buffer[i] = packages[i];
     DCD_EP_Tx(&USB_OTG_dev, MIOS32_USB_MIDI_DATA_IN_EP, (uint8_t*)&USB_tx_buffer, count*4);
   }
-
   MIOS32_IRQ_Enable();
 }
 
 
+/////////////////////////////////////////////////////////////////////////////
+//! returns the number of packages in the Tx buffer
+/////////////////////////////////////////////////////////////////////////////
+static u16 MIOS32_USB_MIDI_TxBufferUsed(void)
+{
+  s32 used = (s32)tx_buffer_head - (s32)tx_buffer_tail;
+  return (used < 0) ? (used + MIOS32_USB_MIDI_TX_BUFFER_SIZE) : used;
+}
+
+
 /////////////////////////////////////////////////////////////////////////////
 //! USB Device Mode
 //!
@@ -617,23 +702,25 @@ static USBH_Status USBH_Handle(USB_OTG_CORE_HANDLE *pdev, void *phost)
 
 
       if( USBH_MIDI_transfer_state == USBH_MIDI_IDLE ) {
-	if( !force_rx_req && tx_buffer_size && transfer_possible ) {
-	  // atomic operation to avoid conflict with other interrupts
-	  MIOS32_IRQ_Disable();
-
-	  s16 count = (tx_buffer_size > (USBH_BulkOutEpSize/4)) ? (USBH_BulkOutEpSize/4) : tx_buffer_size;
+	// atomic operation to avoid conflict with other interrupts
+	// the connection state and the buffer counters are checked within the same
+	// section, since a disconnection resets tx_buffer_head/tail
+	MIOS32_IRQ_Disable();
+	u16 tx_count = transfer_possible ? MIOS32_USB_MIDI_TxBufferUsed() : 0;
+	if( !force_rx_req && tx_count ) {
+	  s16 count = (tx_count > (USBH_BulkOutEpSize/4)) ? (USBH_BulkOutEpSize/4) : tx_count;
 
 	  // send to IN pipe
-	  tx_buffer_size -= count;
-
 	  u32 *buf_addr = (u32 *)USB_tx_buffer;
+	  u16 tail = tx_buffer_tail;
 	  int i;
 	  for(i=0; i<count; ++i) {
-	    *(buf_addr++) = tx_buffer[tx_buffer_tail];
-	    if( ++tx_buffer_tail >= MIOS32_USB_MIDI_TX_BUFFER_SIZE )
-	      tx_buffer_tail = 0;
+	    *(buf_addr++) = tx_buffer[tail];
+	    if( ++tail >= MIOS32_USB_MIDI_TX_BUFFER_SIZE )
+	      tail = 0;
 	  }
-	  
+	  tx_buffer_tail = tail;
+
 	  USBH_tx_count = count * 4;
 	  USBH_BulkSendData(&USB_OTG_dev, (u8 *)USB_tx_buffer, USBH_tx_count, USBH_hc_num_out);
 
@@ -641,6 +728,8 @@ static USBH_Status USBH_Handle(USB_OTG_CORE_HANDLE *pdev, void *phost)
 
 	  MIOS32_IRQ_Enable();
 	} else {
+	  MIOS32_IRQ_Enable();
+
 	  // request data from device
 	  USBH_BulkReceiveData(&USB_OTG_dev, (u8 *)USB_rx_buffer, USBH_BulkInEpSize, USBH_hc_num_in);
 	  USBH_MIDI_transfer_state = USBH_MIDI_RX;
@@ -0,0 +1,566 @@
+// Host simulation of the ENC28J60 driver under an OSC flood
+//
+// mios32_enc28j60.c is compiled on the host against a register-level model
+// of the ENC28J60: SPI opcodes (RCR/WCR/BFS/BFC/RBM/WBM/SR), four register
+// banks selected by ECON1, the 8k buffer memory with the Rx ring, EPKTCNT,
+// the MII registers and the Tx logic. The model runs on a virtual clock:
+//
+// - SPI at ca. 18 MBit/s (prescaler 4), 444 nS per byte
+// - a polled MIOS32_SPI_TransferByte() keeps the CPU busy for the byte time
+//   plus the polling overhead
+// - a block transfer without callback is polled as well. With a callback
+//   only the DMA setup is CPU time, the byte time passes in
+//   MIOS32_ENC28J60_DMA_WAIT (other tasks run), followed by a task switch
+//   back and the completion callback
+// - the Rx frames arrive on a 10 MBit/s wire with random length
+//
+// The uIP task of modules/uip_task_standard is modeled: each mS it reads a
+// single frame with MIOS32_ENC28J60_PackageReceive(), and each 8th frame
+// results in a reply frame which is sent with MIOS32_ENC28J60_PackageSend().
+// The "drain" mode reads all pending frames each mS to measure how many
+// frames per second the driver itself can handle.
+//
+// Received and sent frames are compared against the generated data.
+//
+// The makefile builds this simulation twice: with the current driver
+// (enc28j60_sim) and with the previous driver, which selects the bank for
+// each register access and transfers the frames with polled SPI block
+// transfers (enc28j60_sim_prev).
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "mios32.h"
+#include "mios32_enc28j60_regs.h"
+
+#define SPI_BYTE_NS       444   // 18 MBit/s
+#define POLLED_BYTE_NS    250   // polling overhead of MIOS32_SPI_TransferByte()
+#define CS_NS              50
+#define MODE_INIT_NS      500
+#define DMA_SETUP_NS     1500
+#define TASK_SWITCH_NS   1000   // yield to the other tasks and back
+#define WIRE_BYTE_NS      800   // 10 MBit/s
+#define WIRE_GAP_NS      9600   // inter packet gap
+
+// SPI opcodes (like in the driver)
+#define RCR (0x0<<5)
+#define WCR (0x2<<5)
+#define BFS (0x4<<5)
+#define BFC (0x5<<5)
+#define RBM ((0x1<<5) | 0x1A)
+#define WBM ((0x3<<5) | 0x1A)
+#define SR  ((0x7<<5) | 0x1F)
+
+#define NUM_MS           2000
+#define RX_RING_START  0x0000
+#define RX_RING_END    0x0fff
+#define RX_RING_SIZE   (RX_RING_END - RX_RING_START + 1)
+#define MAX_FRAMES      20000
+
+// ------- virtual clock -------
+static u64 sim_ns;   // current time
+static u64 cpu_ns;   // CPU time consumed by the driver
+
+// ------- ENC28J60 model -------
+static u8 regs[4][32];
+static u8 mem[0x2000];
+static u16 phy[32];
+static u8 rx_wrpt_l, rx_wrpt_h; // ERXWRPT (read only)
+static u16 rx_rdpt;             // ERXRDPT, taken over when the high byte is written
+static u8 cs_active;
+static u8 opcode;
+static u32 byte_ctr;
+static u64 tx_done_ns;
+
+// statistics
+static u32 spi_transactions;
+static u32 bank_selects;
+
+// generated frames
+typedef struct {
+  u64 arrival_ns;
+  u16 len;
+  u32 seq;
+} frame_t;
+
+static frame_t rx_frames[MAX_FRAMES];
+static u32 rx_num_frames;
+static u32 rx_next_arrival;  // next frame which arrives on the wire
+static u32 rx_next_expected; // next frame which should be received
+static u32 rx_received;
+static u32 rx_dropped;
+static u32 tx_expected_seq;
+static u32 tx_sent;
+static u32 tx_received;
+
+static u32 lfsr;
+static int errors;
+
+// DMA completion
+static void (*dma_callback)(void);
+static u64 dma_pending_ns;
+
+
+static u32 random_number(void)
+{
+  lfsr ^= lfsr << 13;
+  lfsr ^= lfsr >> 17;
+  lfsr ^= lfsr << 5;
+  return lfsr;
+}
+
+static void error(const char *msg, u32 value)
+{
+  if( errors < 10 )
+    printf("ERROR: %s (%u)\n", msg, value);
+  ++errors;
+}
+
+static void consume(u32 ns, u8 cpu)
+{
+  sim_ns += ns;
+  if( cpu )
+    cpu_ns += ns;
+}
+
+static u8 *reg(u8 address)
+{
+  // EIE..ECON1 are available in all banks
+  return (address >= 0x1b) ? &regs[0][address] : &regs[regs[0][ECON1] & 3][address];
+}
+
+static u16 reg16(u8 bank, u8 address)
+{
+  return regs[bank][address] | (regs[bank][address+1] << 8);
+}
+
+static void reg16_set(u8 bank, u8 address, u16 value)
+{
+  regs[bank][address] = value & 0xff;
+  regs[bank][address+1] = value >> 8;
+}
+
+static u8 frame_byte(u32 seq, u32 pos)
+{
+  return (u8)((seq * 31) ^ (pos * 7) ^ (pos >> 3));
+}
+
+// writes a received frame into the Rx ring like the MAC does
+static void rx_frame_store(frame_t *f)
+{
+  u16 wrpt = rx_wrpt_l | (rx_wrpt_h << 8);
+  u16 rdpt = rx_rdpt;
+  u16 byte_count = f->len + 4; // incl. CRC
+  u16 size = (6 + byte_count + 1) & ~1;
+  u16 free = (rdpt - wrpt + RX_RING_SIZE) % RX_RING_SIZE;
+  u16 next, pos;
+  u8 header[6];
+  u32 i;
+
+  if( !(regs[0][ECON1] & ECON1_RXEN) || size >= free || regs[1][EPKTCNT & 0xff] == 0xff ) {
+    ++rx_dropped;
+    regs[0][EIR] |= EIR_RXERIF;
+    return;
+  }
+
+  next = wrpt + size;
+  if( next > RX_RING_END )
+    next -= RX_RING_SIZE;
+
+  header[0] = next & 0xff;
+  header[1] = next >> 8;
+  header[2] = byte_count & 0xff;
+  header[3] = byte_count >> 8;
+  header[4] = 0x80; // Receive OK
+  header[5] = 0x00;
+
+  pos = wrpt;
+  for(i=0; i<6+f->len+4; ++i) {
+    mem[pos] = (i < 6) ? header[i] : (i < 6+f->len) ? frame_byte(f->seq, i-6) : 0xcc;
+    pos = (pos == RX_RING_END) ? RX_RING_START : pos + 1;
+  }
+
+  rx_wrpt_l = next & 0xff;
+  rx_wrpt_h = next >> 8;
+  ++regs[1][EPKTCNT & 0xff];
+}
+
+static void rx_arrivals(void)
+{
+  while( rx_next_arrival < rx_num_frames && rx_frames[rx_next_arrival].arrival_ns <= sim_ns ) {
+    rx_frame_store(&rx_frames[rx_next_arrival++]);
+  }
+}
+
+static void tx_start(void)
+{
+  u16 start = reg16(0, ETXSTL);
+  u16 end = reg16(0, ETXNDL);
+  u16 len = end - start; // without control byte
+  u32 i;
+
+  if( mem[start] != 0x07 && mem[start] != 0x00 )
+    error("invalid Tx control byte", mem[start]);
+
+  if( len != 42 + 32 ) {
+    error("unexpected Tx frame length", len);
+  } else {
+    for(i=0; i<len; ++i)
+      if( mem[start+1+i] != frame_byte(tx_expected_seq, i) ) {
+	error("Tx frame corrupted at byte", i);
+	break;
+      }
+  }
+  ++tx_expected_seq;
+  ++tx_received;
+
+  tx_done_ns = sim_ns + (len + 4 + 8) * WIRE_BYTE_NS + WIRE_GAP_NS;
+}
+
+static u8 spi_byte(u8 b)
+{
+  u8 ret = 0xff;
+
+  if( !cs_active )
+    return ret;
+
+  if( byte_ctr++ == 0 ) {
+    opcode = b;
+    if( opcode == SR ) {
+      memset(regs, 0, sizeof(regs));
+      regs[0][ESTAT] = ESTAT_CLKRDY;
+      regs[0][ECON2] = ECON2_AUTOINC;
+      regs[3][EREVID & 0xff] = 6; // rev. B7
+      phy[PHSTAT1] = PHSTAT1_LLSTAT;
+      rx_wrpt_l = rx_wrpt_h = 0;
+      rx_rdpt = 0;
+    }
+    return ret;
+  }
+
+  {
+    u8 address = opcode & 0x1f;
+
+    switch( opcode & 0xe0 ) {
+    case RCR:
+      if( address == ECON1 && (regs[0][ECON1] & ECON1_TXRTS) && sim_ns >= tx_done_ns )
+	regs[0][ECON1] &= ~ECON1_TXRTS;
+      if( (regs[0][ECON1] & 3) == 0 && address == (ERXWRPTL & 0xff) )
+	return rx_wrpt_l;
+      if( (regs[0][ECON1] & 3) == 0 && address == (ERXWRPTH & 0xff) )
+	return rx_wrpt_h;
+      return *reg(address);
+
+    case WCR:
+      *reg(address) = b;
+      if( address == ECON1 )
+	++bank_selects;
+      if( (regs[0][ECON1] & 3) == 0 && address == (ERXSTH & 0xff) ) {
+	rx_wrpt_l = regs[0][ERXSTL];
+	rx_wrpt_h = regs[0][ERXSTH];
+      }
+      if( (regs[0][ECON1] & 3) == 0 && address == (ERXRDPTH & 0xff) )
+	rx_rdpt = reg16(0, ERXRDPTL);
+      if( (regs[0][ECON1] & 3) == 2 && address == (MIWRH & 0xff) )
+	phy[regs[2][MIREGADR & 0xff] & 0x1f] = regs[2][MIWRL & 0xff] | (b << 8);
+      if( (regs[0][ECON1] & 3) == 2 && address == (MICMD & 0xff) && (b & MICMD_MIIRD) ) {
+	u16 value = phy[regs[2][MIREGADR & 0xff] & 0x1f];
+	regs[2][MIRDL & 0xff] = value & 0xff;
+	regs[2][MIRDH & 0xff] = value >> 8;
+      }
+      return ret;
+
+    case BFS:
+      if( address == ECON1 && (b & (ECON1_BSEL1 | ECON1_BSEL0)) )
+	++bank_selects;
+      if( address == ECON1 && b == 0 )
+	++bank_selects; // bank 0 after BFC
+      if( address == ECON2 && (b & ECON2_PKTDEC) ) {
+	if( regs[1][EPKTCNT & 0xff] )
+	  --regs[1][EPKTCNT & 0xff];
+	b &= ~ECON2_PKTDEC;
+      }
+      if( address == ECON1 && (b & ECON1_TXRTS) && !(regs[0][ECON1] & ECON1_TXRTS) ) {
+	regs[0][ECON1] |= ECON1_TXRTS;
+	tx_start();
+      }
+      *reg(address) |= b;
+      return ret;
+
+    case BFC:
+      if( address == ECON1 && (b & (ECON1_BSEL1 | ECON1_BSEL0)) )
+	++bank_selects;
+      *reg(address) &= ~b;
+      return ret;
+
+    default:
+      if( opcode == RBM ) {
+	u16 rdpt = reg16(0, ERDPTL);
+	ret = mem[rdpt];
+	if( rdpt == reg16(0, ERXNDL) )
+	  rdpt = reg16(0, ERXSTL);
+	else
+	  rdpt = (rdpt + 1) & 0x1fff;
+	reg16_set(0, ERDPTL, rdpt);
+      } else if( opcode == WBM ) {
+	u16 wrpt = reg16(0, EWRPTL);
+	mem[wrpt] = b;
+	reg16_set(0, EWRPTL, (wrpt + 1) & 0x1fff);
+      }
+      return ret;
+    }
+  }
+}
+
+
+// ------- MIOS32 stubs -------
+s32 MIOS32_SPI_IO_Init(u8 spi, u32 pin_driver)
+{
+  return 0;
+}
+
+s32 MIOS32_SPI_TransferModeInit(u8 spi, u32 spi_mode, u32 spi_prescaler)
+{
+  consume(MODE_INIT_NS, 1);
+  return 0;
+}
+
+s32 MIOS32_SPI_RC_PinSet(u8 spi, u8 rc_pin, u8 pin_value)
+{
+  consume(CS_NS, 1);
+
+  if( !pin_value && !cs_active ) {
+    rx_arrivals();
+    cs_active = 1;
+    byte_ctr = 0;
+    ++spi_transactions;
+  } else if( pin_value ) {
+    cs_active = 0;
+  }
+  return 0;
+}
+
+s32 MIOS32_SPI_TransferByte(u8 spi, u8 b)
+{
+  consume(SPI_BYTE_NS + POLLED_BYTE_NS, 1);
+  return spi_byte(b);
+}
+
+s32 MIOS32_SPI_TransferBlock(u8 spi, u8 *send_buffer, u8 *receive_buffer, u16 len, void *callback)
+{
+  u32 i;
+
+  if( dma_callback )
+    error("DMA transfer started while the previous one is in progress", len);
+
+  for(i=0; i<len; ++i) {
+    u8 b = spi_byte(send_buffer ? send_buffer[i] : 0xff);
+    if( receive_buffer )
+      receive_buffer[i] = b;
+  }
+
+  consume(DMA_SETUP_NS, 1);
+  if( callback == NULL ) {
+    consume(len * SPI_BYTE_NS, 1); // polled
+  } else {
+    dma_callback = callback;
+    dma_pending_ns = len * SPI_BYTE_NS;
+  }
+
+  return 0;
+}
+
+void SIM_DMA_Wait(void)
+{
+  // other tasks run until the DMA interrupt fires
+  consume(dma_pending_ns, 0);
+  dma_pending_ns = 0;
+  consume(TASK_SWITCH_NS, 1);
+
+  if( dma_callback ) {
+    void (*callback)(void) = dma_callback;
+    dma_callback = NULL;
+    callback();
+  }
+}
+
+s32 MIOS32_DELAY_Wait_uS(u16 uS)
+{
+  consume(uS * 1000, 1);
+  return 0;
+}
+
+s32 MIOS32_SYS_SerialNumberGet(char *str)
+{
+  strcpy(str, "000000000001");
+  return 0;
+}
+
+s32 MIOS32_MIDI_SendDebugMessage(const char *format, ...)
+{
+  error("driver detected a glitch", 0);
+  return 0;
+}
+
+
+// ------- OSC flood -------
+static void flood_generate(u32 frames_per_s)
+{
+  u64 t = 0;
+  u64 interval = frames_per_s ? (1000000000ull / frames_per_s) : 0;
+
+  rx_num_frames = 0;
+  if( !frames_per_s )
+    return;
+
+  while( rx_num_frames < MAX_FRAMES ) {
+    frame_t *f = &rx_frames[rx_num_frames];
+    u64 wire_ns;
+
+    f->len = 42 + 20 + random_number() % 81; // Ethernet/IP/UDP header + OSC message
+    f->seq = rx_num_frames;
+
+    // the interval varies by +/- 50%, but can't be shorter than the frame on the wire
+    wire_ns = (f->len + 4 + 8) * WIRE_BYTE_NS + WIRE_GAP_NS;
+    t += interval / 2 + random_number() % (interval + 1);
+    if( rx_num_frames && t < rx_frames[rx_num_frames-1].arrival_ns + wire_ns )
+      t = rx_frames[rx_num_frames-1].arrival_ns + wire_ns;
+    f->arrival_ns = t;
+
+    if( t >= (u64)NUM_MS * 1000000 )
+      break;
+    ++rx_num_frames;
+  }
+}
+
+static void frame_check(u8 *buffer, s32 len)
+{
+  frame_t *f;
+  u32 i;
+
+  // find the frame: frames which got lost in a full Rx ring are skipped
+  while( rx_next_expected < rx_next_arrival && rx_frames[rx_next_expected].len + 4 != len )
+    ++rx_next_expected;
+
+  if( rx_next_expected >= rx_next_arrival ) {
+    error("received a frame which hasn't been sent", len);
+    return;
+  }
+
+  f = &rx_frames[rx_next_expected];
+  for(i=0; i<f->len; ++i)
+    if( buffer[i] != frame_byte(f->seq, i) ) {
+      // frame was dropped, and the next one has the same length
+      ++rx_next_expected;
+      frame_check(buffer, len);
+      return;
+    }
+
+  ++rx_next_expected;
+  ++rx_received;
+}
+
+static void reply(void)
+{
+  u8 header[42];
+  u8 payload[32];
+  u32 i;
+  s32 status;
+
+  for(i=0; i<42; ++i)
+    header[i] = frame_byte(tx_sent, i);
+  for(i=0; i<32; ++i)
+    payload[i] = frame_byte(tx_sent, 42+i);
+
+  if( (status=MIOS32_ENC28J60_PackageSend(header, 42, payload, 32)) < 0 )
+    error("PackageSend failed", -status);
+  ++tx_sent;
+}
+
+static void run(u32 frames_per_s, u8 drain)
+{
+  static u8 buffer[MIOS32_ENC28J60_MAX_FRAME_SIZE+4];
+  u32 ms, transactions_begin, bank_selects_begin;
+  u64 cpu_begin;
+  s32 status;
+
+  sim_ns = cpu_ns = 0;
+  tx_done_ns = 0;
+  rx_num_frames = rx_next_arrival = rx_next_expected = rx_received = rx_dropped = 0;
+  tx_expected_seq = tx_sent = tx_received = 0;
+  spi_transactions = bank_selects = 0;
+
+  if( (status=MIOS32_ENC28J60_Init(0)) < 0 ) {
+    error("MIOS32_ENC28J60_Init failed", -status);
+    return;
+  }
+
+  // the flood starts after the initialisation
+  lfsr = 2463534242u;
+  flood_generate(frames_per_s);
+  sim_ns = 0;
+  cpu_begin = cpu_ns;
+  transactions_begin = spi_transactions;
+  bank_selects_begin = bank_selects;
+
+  for(ms=0; ms<NUM_MS; ++ms) {
+    // vTaskDelayUntil() of the uIP task
+    if( sim_ns < (u64)ms * 1000000 )
+      sim_ns = (u64)ms * 1000000;
+
+    do {
+      status = MIOS32_ENC28J60_PackageReceive(buffer, sizeof(buffer));
+      if( status < 0 ) {
+	error("PackageReceive failed", -status);
+	break;
+      }
+      if( status > 0 ) {
+	frame_check(buffer, status);
+	if( (rx_received % 8) == 0 )
+	  reply();
+      }
+    } while( drain && status > 0 );
+  }
+
+  // all frames which arrived during the run are either received, pending or dropped
+  if( rx_received + rx_dropped + regs[1][EPKTCNT & 0xff] != rx_next_arrival )
+    error("frames got lost", rx_next_arrival - rx_received - rx_dropped);
+  if( tx_received != tx_sent )
+    error("replies got lost", tx_sent - tx_received);
+
+  printf("%-10s %8.0f %10.0f %8u %8.2f %10.1f %10.2f %12.2f\n",
+	 drain ? "drain" : "uip_task", rx_num_frames * 1000.0 / NUM_MS,
+	 rx_received * 1000.0 / NUM_MS, rx_dropped,
+	 (cpu_ns - cpu_begin) * 100.0 / sim_ns,
+	 rx_received ? (cpu_ns - cpu_begin) / 1000.0 / rx_received : 0.0,
+	 (double)(spi_transactions - transactions_begin) / NUM_MS,
+	 (double)(bank_selects - bank_selects_begin) / NUM_MS);
+}
+
+
+int main(int argc, char *argv[])
+{
+  static const u32 rates[] = { 0, 1000, 2000, 4000, 8000 };
+  u32 i;
+
+#ifdef ENC28J60_SIM_PREV
+  printf("previous driver: bank selection for each access, polled block transfers\n");
+#else
+  printf("current driver: cached bank selection, DMA block transfers with completion callback\n");
+#endif
+  printf("OSC flood for %d mS, frames of 62..142 bytes\n", NUM_MS);
+  printf("%-10s %8s %10s %8s %8s %10s %10s %12s\n",
+	 "mode", "frames/s", "received/s", "dropped", "CPU %", "CPU uS/rx", "SPI/mS", "ECON1 wr/mS");
+
+  for(i=0; i<sizeof(rates)/sizeof(u32); ++i)
+    run(rates[i], 0);
+  for(i=0; i<sizeof(rates)/sizeof(u32); ++i)
+    run(rates[i], 1);
+
+  if( errors ) {
+    printf("%d errors\n", errors);
+    return 1;
+  }
+
+  return 0;
+}
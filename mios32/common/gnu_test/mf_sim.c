@@ -0,0 +1,438 @@
+// Host simulation of the motorfader PID control
+//
+// A fader model with a motor dead zone (static friction), limited travel
+// speed, inertia and mechanical end stops which don't reach the full AIN
+// range is driven by MIOS32_MF_Tick() once per mS. The motor direction is
+// taken from the shift register output of MIOS32_MF_UpdateSR().
+//
+// Scenarios:
+// - stuck start: the dead zone is much higher than the initial calibration
+//   and the fader was never moved before. The calibration has to converge to
+//   the dead zone of the motor, so that the fader reaches its targets.
+// - end stops: targets beyond the mechanical end stops time out. Neither the
+//   stalls at the end stops nor the timeouts may change the calibration.
+// - blocked: the fader is held during a move. The calibration may only be
+//   relaxed again by moves which reach their target.
+// - automation replay: a recorded automation lane with jumps, ramps and LFO
+//   curves is played back, ramps and LFOs are streamed with a new target
+//   each 10 mS like a DAW sends them. Settling time and overshoot after the
+//   last target of each segment, tracking error while streaming and the
+//   time the motor is driven are reported.
+//
+// The makefile builds this simulation twice: with PID control (mf_sim) and
+// with the bang-bang control (mf_sim_bangbang), which only runs the replay.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "mios32.h"
+
+#define AIN_MAX       4095
+#define MOVE_TICKS    1000 // mS per move, more than the timeout of the driver
+#define STREAM_TICKS    10 // mS between the targets of streamed automation
+
+typedef struct {
+  double pos;       // position in AIN units
+  double vel;       // AIN units per tick
+  double drive;     // filtered motor drive (-1..1), the motor integrates the PWM
+  double dead_zone; // smallest drive which moves the motor (0..1)
+  double speed;     // AIN units per tick at full drive
+  double end_min;   // mechanical end stops
+  double end_max;
+  u8 held;          // fader held by the user
+} fader_t;
+
+static fader_t fader;
+static u16 ain_pin_value; // last value outside the deadband, like the AIN driver
+static u8 sr_byte;
+static u8 sr_out;
+static u32 motor_on_ticks;
+static int errors;
+
+
+// ------- MIOS32 stubs -------
+s32 MIOS32_SPI_RC_PinSet(u8 spi, u8 rc_pin, u8 pin_value)
+{
+  if( pin_value ) // rising edge: transfer to output register
+    sr_out = sr_byte;
+  return 0;
+}
+
+s32 MIOS32_SPI_IO_Init(u8 spi, u32 pin_driver)
+{
+  return 0;
+}
+
+s32 MIOS32_SPI_TransferModeInit(u8 spi, u32 spi_mode, u32 spi_prescaler)
+{
+  return 0;
+}
+
+s32 MIOS32_SPI_TransferByte(u8 spi, u8 b)
+{
+  sr_byte = b; // the last byte contains the first fader
+  return 0;
+}
+
+s32 MIOS32_AIN_PinGet(u32 pin)
+{
+  return pin ? 0 : ain_pin_value;
+}
+
+
+// ------- fader model -------
+static void fader_init(double pos, double dead_zone, double end_min, double end_max)
+{
+  memset(&fader, 0, sizeof(fader));
+  fader.pos = pos;
+  fader.dead_zone = dead_zone;
+  fader.speed = 40.0;
+  fader.end_min = end_min;
+  fader.end_max = end_max;
+}
+
+static void fader_tick(void)
+{
+  // MF_Down moves to higher values (see MIOS32_MF_UpdateSR())
+  double in = (sr_out & 0x40) ? 1.0 : ((sr_out & 0x80) ? -1.0 : 0.0);
+  double target_vel = 0.0;
+
+  fader.drive += (in - fader.drive) / 8;
+
+  if( fader.held ) {
+    fader.vel = 0.0;
+    return;
+  }
+
+  if( fader.drive > fader.dead_zone )
+    target_vel = fader.speed * (fader.drive - fader.dead_zone) / (1.0 - fader.dead_zone);
+  else if( fader.drive < -fader.dead_zone )
+    target_vel = fader.speed * (fader.drive + fader.dead_zone) / (1.0 - fader.dead_zone);
+
+  fader.vel += (target_vel - fader.vel) / 4;
+  fader.pos += fader.vel;
+
+  if( fader.pos < fader.end_min ) {
+    fader.pos = fader.end_min;
+    fader.vel = 0.0;
+  } else if( fader.pos > fader.end_max ) {
+    fader.pos = fader.end_max;
+    fader.vel = 0.0;
+  }
+}
+
+// one mS: fader model, AIN conversion and MF driver
+static void tick(void)
+{
+  static u16 ain_values[MIOS32_MF_NUM];
+  static u16 ain_deltas[MIOS32_MF_NUM];
+
+  fader_tick();
+  if( sr_out & 0xc0 )
+    ++motor_on_ticks;
+  ain_values[0] = (u16)(fader.pos + 0.5);
+  if( (ain_deltas[0] = abs(ain_values[0] - ain_pin_value)) > MIOS32_AIN_DEADBAND )
+    ain_pin_value = ain_values[0];
+  MIOS32_MF_Tick(ain_values, ain_deltas);
+}
+
+// runs one move, returns the distance to the target at the end
+static int move(u16 target)
+{
+  int i;
+
+  MIOS32_MF_FaderMove(0, target);
+  for(i=0; i<MOVE_TICKS; ++i)
+    tick();
+
+  return abs((int)(fader.pos + 0.5) - target);
+}
+
+static void init(double pos, double dead_zone, double end_min, double end_max)
+{
+  int i;
+
+  MIOS32_MF_Init(0);
+  sr_byte = sr_out = 0;
+  fader_init(pos, dead_zone, end_min, end_max);
+  ain_pin_value = pos;
+
+  // the driver is running before the first move is requested
+  for(i=0; i<MOVE_TICKS; ++i)
+    tick();
+}
+
+
+// ------- scenarios -------
+#if MIOS32_MF_PID_CONTROL
+static void stuck_start(void)
+{
+  const double dead_zone = 0.6;
+  const int moves = 80;
+  int i, reached = 0, reached_last = 0;
+  mios32_mf_calibration_t cal;
+
+  init(2048, dead_zone, 0, AIN_MAX);
+  srand(1);
+
+  for(i=0; i<moves; ++i) {
+    u16 target = 200 + (rand() % 3700);
+    if( move(target) <= 2*MIOS32_MF_ConfigGet(0).cfg.deadband ) {
+      ++reached;
+      if( i >= moves/2 )
+	++reached_last;
+    }
+  }
+
+  cal = MIOS32_MF_CalibrationGet(0);
+  printf("stuck start: dead zone %d, %d/%d moves reached, %d/%d of the last half, min_duty up %d down %d\n",
+	 (int)(dead_zone*256), reached, moves, reached_last, moves/2, cal.min_duty_up, cal.min_duty_down);
+
+  if( reached_last < moves/2 ) {
+    printf("ERROR: targets not reached after calibration\n");
+    ++errors;
+  }
+
+  // the calibrated dead zone should be close to the dead zone of the motor
+  if( cal.min_duty_up < (int)(dead_zone*256*0.85) || cal.min_duty_up > (int)(dead_zone*256*1.15) ||
+      cal.min_duty_down < (int)(dead_zone*256*0.85) || cal.min_duty_down > (int)(dead_zone*256*1.15) ) {
+    printf("ERROR: calibration didn't converge\n");
+    ++errors;
+  }
+}
+
+static void end_stops(void)
+{
+  const int moves = 40;
+  mios32_mf_calibration_t cal_before, cal;
+  int i;
+
+  init(2048, 0.15, 60, AIN_MAX-40);
+  cal_before = MIOS32_MF_CalibrationGet(0);
+
+  // targets beyond the end stops can't be reached: timeout
+  for(i=0; i<moves; ++i)
+    move((i & 1) ? 0x020 : AIN_MAX);
+
+  cal = MIOS32_MF_CalibrationGet(0);
+  printf("end stops: %d moves to unreachable targets, min_duty up %d -> %d, down %d -> %d\n",
+	 moves, cal_before.min_duty_up, cal.min_duty_up, cal_before.min_duty_down, cal.min_duty_down);
+
+  if( cal.min_duty_up != cal_before.min_duty_up || cal.min_duty_down != cal_before.min_duty_down ) {
+    printf("ERROR: calibration changed at the end stops\n");
+    ++errors;
+  }
+
+  if( move(2048) > 2*MIOS32_MF_ConfigGet(0).cfg.deadband ) {
+    printf("ERROR: target not reached after the end stop moves\n");
+    ++errors;
+  }
+}
+
+static void blocked(void)
+{
+  mios32_mf_calibration_t cal_before, cal_blocked, cal;
+  int i;
+
+  init(1000, 0.15, 0, AIN_MAX);
+  cal_before = MIOS32_MF_CalibrationGet(0);
+
+  fader.held = 1;
+  move(3000);
+  fader.held = 0;
+  cal_blocked = MIOS32_MF_CalibrationGet(0);
+
+  // the next move is a manual move (no repositioning), afterwards moves are executed again
+  for(i=0; i<4; ++i)
+    move((i & 1) ? 1000 : 3000);
+  cal = MIOS32_MF_CalibrationGet(0);
+
+  printf("blocked: min_duty down %d -> %d while held, %d after 4 moves\n",
+	 cal_before.min_duty_down, cal_blocked.min_duty_down, cal.min_duty_down);
+
+  if( cal_blocked.min_duty_down < cal_before.min_duty_down ) {
+    printf("ERROR: timeout of the blocked fader relaxed the calibration\n");
+    ++errors;
+  }
+
+  if( cal.min_duty_down >= cal_blocked.min_duty_down ) {
+    printf("ERROR: calibration not relaxed after successful moves\n");
+    ++errors;
+  }
+}
+#endif
+
+
+// ------- automation replay -------
+typedef enum {
+  SEGMENT_JUMP,
+  SEGMENT_RAMP,
+  SEGMENT_LFO,
+} segment_type_t;
+
+typedef struct {
+  segment_type_t type;
+  u16 target;    // jump/ramp: final target, LFO: center
+  u16 amplitude; // LFO only
+  u16 period;    // LFO only, in mS
+  u16 duration;  // mS in which the targets are streamed (0 for jumps)
+  u16 hold;      // mS with the final target
+} segment_t;
+
+static const segment_t automation[] = {
+  { SEGMENT_JUMP, 3500,    0,    0,    0, 800 },
+  { SEGMENT_JUMP,  500,    0,    0,    0, 800 },
+  { SEGMENT_JUMP, 2048,    0,    0,    0, 800 },
+  { SEGMENT_JUMP, 2300,    0,    0,    0, 800 },
+  { SEGMENT_JUMP, 1800,    0,    0,    0, 800 },
+  { SEGMENT_JUMP, 4000,    0,    0,    0, 800 },
+  { SEGMENT_JUMP,  150,    0,    0,    0, 800 },
+  { SEGMENT_JUMP, 3000,    0,    0,    0, 800 },
+  { SEGMENT_JUMP, 2900,    0,    0,    0, 800 },
+  { SEGMENT_JUMP, 1000,    0,    0,    0, 800 },
+  { SEGMENT_RAMP, 3000,    0,    0,  500, 800 },
+  { SEGMENT_RAMP,  800,    0,    0, 1000, 800 },
+  { SEGMENT_RAMP, 3800,    0,    0,  250, 800 },
+  { SEGMENT_RAMP, 2000,    0,    0, 2000, 800 },
+  { SEGMENT_RAMP, 2600,    0,    0,  300, 800 },
+  { SEGMENT_LFO,  2048, 1200, 2000, 4000, 800 },
+  { SEGMENT_LFO,  2048,  600,  500, 2000, 800 },
+  { SEGMENT_LFO,  1500,  300, 1000, 2000, 800 },
+};
+
+typedef struct {
+  u32 segments;
+  u32 not_settled;
+  u32 settle_sum;
+  u32 settle_max;
+  u32 overshoot_sum;
+  u32 overshoot_max;
+  u32 motor_on;
+  u32 ticks;
+  u32 track_error_sum;
+  u32 track_ticks;
+} replay_stats_t;
+
+static void replay_segment(const segment_t *seg, replay_stats_t *stats)
+{
+  int tolerance = 2*MIOS32_MF_ConfigGet(0).cfg.deadband;
+  u16 start = (u16)(fader.pos + 0.5);
+  u16 target = seg->target;
+  int t, last_outside = -1, overshoot = 0, direction;
+
+  motor_on_ticks = 0;
+
+  // streamed part
+  for(t=0; t<seg->duration; ++t) {
+    if( (t % STREAM_TICKS) == 0 ) {
+      if( seg->type == SEGMENT_RAMP ) {
+	target = start + ((int)seg->target - (int)start) * (t + STREAM_TICKS) / seg->duration;
+      } else {
+	target = seg->target + (int)(seg->amplitude * sin(2*M_PI * t / seg->period));
+      }
+      MIOS32_MF_FaderMove(0, target);
+    }
+    tick();
+    stats->track_error_sum += abs((int)(fader.pos + 0.5) - target);
+    ++stats->track_ticks;
+  }
+
+  // final target: settling time and overshoot
+  target = seg->target;
+  direction = (target >= (int)(fader.pos + 0.5)) ? 1 : -1;
+  MIOS32_MF_FaderMove(0, target);
+
+  for(t=0; t<seg->hold; ++t) {
+    int pos, error;
+
+    tick();
+    pos = (int)(fader.pos + 0.5);
+    error = pos - target;
+
+    if( abs(error) > tolerance )
+      last_outside = t;
+    if( error * direction > overshoot )
+      overshoot = error * direction;
+  }
+
+  ++stats->segments;
+  if( last_outside >= seg->hold - 1 ) {
+    ++stats->not_settled;
+  } else {
+    stats->settle_sum += last_outside + 1;
+    if( last_outside + 1 > stats->settle_max )
+      stats->settle_max = last_outside + 1;
+  }
+  stats->overshoot_sum += overshoot;
+  if( overshoot > stats->overshoot_max )
+    stats->overshoot_max = overshoot;
+  stats->motor_on += motor_on_ticks;
+  stats->ticks += seg->duration + seg->hold;
+}
+
+static void replay_print(const char *name, replay_stats_t *stats)
+{
+  u32 settled = stats->segments - stats->not_settled;
+
+  char track_error[16] = "-";
+
+  if( stats->track_ticks )
+    sprintf(track_error, "%.1f", (double)stats->track_error_sum / stats->track_ticks);
+
+  printf("  %-6s %8.0f %8u %8u %8.1f %8u %9.1f %9s\n", name,
+	 settled ? (double)stats->settle_sum / settled : 0.0, stats->settle_max, stats->not_settled,
+	 (double)stats->overshoot_sum / stats->segments, stats->overshoot_max,
+	 100.0 * stats->motor_on / stats->ticks, track_error);
+
+  if( MIOS32_MF_PID_CONTROL && stats->not_settled ) {
+    printf("ERROR: %u %s segments didn't settle with PID control\n", stats->not_settled, name);
+    ++errors;
+  }
+}
+
+static void automation_replay(void)
+{
+  replay_stats_t stats[3];
+  int i;
+
+  init(2048, 0.3, 0, AIN_MAX);
+  memset(stats, 0, sizeof(stats));
+
+  // the PID calibration has been done by previous moves
+  srand(1);
+  for(i=0; i<20; ++i)
+    move(200 + (rand() % 3700));
+
+  for(i=0; i<sizeof(automation)/sizeof(segment_t); ++i)
+    replay_segment(&automation[i], &stats[automation[i].type]);
+
+  printf("automation replay with %s control, tolerance +/-%d:\n",
+	 MIOS32_MF_PID_CONTROL ? "PID" : "bang-bang", 2*MIOS32_MF_ConfigGet(0).cfg.deadband);
+  printf("  %-6s %8s %8s %8s %8s %8s %9s %9s\n",
+	 "", "settle", "max", "unsettl.", "oversh.", "max", "motor on", "track");
+  printf("  %-6s %8s %8s %8s %8s %8s %9s %9s\n",
+	 "", "mS", "mS", "", "AIN", "AIN", "%", "err AIN");
+  replay_print("jumps", &stats[SEGMENT_JUMP]);
+  replay_print("ramps", &stats[SEGMENT_RAMP]);
+  replay_print("LFOs", &stats[SEGMENT_LFO]);
+}
+
+
+int main(int argc, char *argv[])
+{
+#if MIOS32_MF_PID_CONTROL
+  stuck_start();
+  end_stops();
+  blocked();
+#endif
+  automation_replay();
+
+  if( errors ) {
+    printf("%d errors\n", errors);
+    return 1;
+  }
+
+  printf("Fader simulation passed.\n");
+  return 0;
+}
@@ -0,0 +1,62 @@
+// minimal MIOS32 environment to compile mios32_mf.c with PID control,
+// mios32_din.c/mios32_enc.c and mios32_enc28j60.c on the host
+#ifndef _MIOS32_H
+#define _MIOS32_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+typedef uint8_t  u8;
+typedef uint16_t u16;
+typedef uint32_t u32;
+typedef uint64_t u64;
+typedef int8_t   s8;
+typedef int16_t  s16;
+typedef int32_t  s32;
+
+// MF configuration (one MBHP_MF module, only the first fader is simulated)
+#define MIOS32_MF_NUM 8
+#ifndef MIOS32_MF_PID_CONTROL
+#define MIOS32_MF_PID_CONTROL 1
+#endif
+
+#define MIOS32_AIN_OVERSAMPLING_RATE 1
+#define MIOS32_AIN_DEADBAND 31
+
+#define MIOS32_SPI_PIN_DRIVER_STRONG 0
+#define MIOS32_SPI_MODE_CLK0_PHASE0  0
+#define MIOS32_SPI_MODE_CLK1_PHASE1  0
+#define MIOS32_SPI_PRESCALER_4       0
+#define MIOS32_SPI_PRESCALER_128     0
+
+// SRIO chain of srio_sim.c: 16 SRs with 4 encoders each, 24 SRs with buttons
+#define MIOS32_SRIO_NUM_SR 40
+#define MIOS32_ENC_NUM_MAX 64
+
+#define MIOS32_IRQ_Disable() do {} while(0)
+#define MIOS32_IRQ_Enable()  do {} while(0)
+
+extern s32 MIOS32_SPI_RC_PinSet(u8 spi, u8 rc_pin, u8 pin_value);
+extern s32 MIOS32_SPI_IO_Init(u8 spi, u32 pin_driver);
+extern s32 MIOS32_SPI_TransferModeInit(u8 spi, u32 spi_mode, u32 spi_prescaler);
+extern s32 MIOS32_SPI_TransferByte(u8 spi, u8 b);
+extern s32 MIOS32_SPI_TransferBlock(u8 spi, u8 *send_buffer, u8 *receive_buffer, u16 len, void *callback);
+extern s32 MIOS32_AIN_PinGet(u32 pin);
+
+// ENC28J60 of enc28j60_sim.c: no RTOS, the DMA wait hands the time to the simulated other tasks
+#define MIOS32_DONT_USE_FREERTOS
+#define MIOS32_DONT_USE_SPI_MIDI
+#define MIOS32_ENC28J60_DMA_WAIT { SIM_DMA_Wait(); }
+extern void SIM_DMA_Wait(void);
+extern s32 MIOS32_DELAY_Wait_uS(u16 uS);
+extern s32 MIOS32_SYS_SerialNumberGet(char *str);
+extern s32 MIOS32_MIDI_SendDebugMessage(const char *format, ...);
+
+#include "mios32_mf.h"
+#include "mios32_srio.h"
+#include "mios32_din.h"
+#include "mios32_enc.h"
+#include "mios32_enc28j60.h"
+
+#endif /* _MIOS32_H */
@@ -0,0 +1,272 @@
+// Host simulation of the DIN and encoder handlers
+//
+// mios32_din.c and mios32_enc.c are compiled on the host. The SRIO scan is
+// emulated like the DMA callback of mios32_srio.c does: changed pins are
+// taken over from mios32_srio_din_buffer[] and the SR is flagged in
+// mios32_srio_din_changed_sr[]. After each scan MIOS32_ENC_UpdateStates(),
+// MIOS32_DIN_Handler() and MIOS32_ENC_Handler() are called, as the
+// traditional programming model does.
+//
+// The surface has 64 detented encoders on the first 16 SRs and buttons on
+// the remaining 24 SRs. Scenarios:
+// - idle: nothing is moved
+// - one encoder: a single encoder is turned continuously
+// - busy: 8 encoders are turned at different speeds, some buttons are pressed
+// - everything: all encoders are turned and all buttons are toggled
+//
+// The notifications are added to a checksum, and the increments of each
+// encoder have to match the number of turned detents. The makefile builds
+// this harness twice: with the handlers which only check the flagged SRs and
+// busy encoders (MIOS32_SRIO_SKIP_UNCHANGED=1), and with the previous scan
+// over all SRs and encoders (MIOS32_SRIO_SKIP_UNCHANGED=0). "make test"
+// checks that both deliver the same notifications, and both report the CPU
+// time of the three handlers per scan. The surface and the SRIO emulation
+// are timed separately and subtracted.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "mios32.h"
+
+#define NUM_ENC_SR     16
+#define NUM_SCANS      200000 // 1 mS per scan
+
+// scenarios
+#define SCENARIO_IDLE        0
+#define SCENARIO_ONE_ENCODER 1
+#define SCENARIO_BUSY        2
+#define SCENARIO_EVERYTHING  3
+
+volatile u8 mios32_srio_din[MIOS32_SRIO_NUM_SR];
+volatile u8 mios32_srio_din_buffer[MIOS32_SRIO_NUM_SR];
+volatile u8 mios32_srio_din_changed[MIOS32_SRIO_NUM_SR];
+volatile u32 mios32_srio_din_changed_sr[MIOS32_SRIO_NUM_SR_WORDS];
+
+typedef struct {
+  u16 period;   // scans per quadrature step, 0: not turned
+  s8  dir;
+  u8  phase;    // position in the quadrature sequence
+  s32 steps;    // quadrature steps done
+  s32 increments; // reported by MIOS32_ENC_Handler
+} encoder_t;
+
+static encoder_t encoders[MIOS32_ENC_NUM_MAX];
+static u32 button_rate; // toggles per 1024 scans on each button SR, 0: no buttons
+static int button_srs;  // number of button SRs which are used
+static u32 lfsr;
+static u32 checksum;
+static u32 din_events;
+static u32 enc_events;
+static int errors;
+
+
+// ------- MIOS32 stubs -------
+u8 MIOS32_SRIO_ScanNumGet(void)
+{
+  return MIOS32_SRIO_NUM_SR;
+}
+
+s32 MIOS32_SRIO_DebounceStart(void)
+{
+  return 0;
+}
+
+
+// ------- callbacks -------
+static void add_checksum(u32 value)
+{
+  int i;
+  for(i=0; i<4; ++i, value >>= 8)
+    checksum = (checksum ^ (value & 0xff)) * 16777619u; // FNV-1a
+}
+
+static void DIN_NotifyToggle(u32 pin, u32 pin_value)
+{
+  ++din_events;
+  add_checksum((pin << 1) | pin_value);
+}
+
+static void ENC_NotifyChange(u32 encoder, s32 incrementer)
+{
+  ++enc_events;
+  encoders[encoder].increments += incrementer;
+  add_checksum(0x10000 | (encoder << 8) | (incrementer & 0xff));
+}
+
+
+// ------- surface -------
+static u32 random_number(void)
+{
+  lfsr ^= lfsr << 13;
+  lfsr ^= lfsr >> 17;
+  lfsr ^= lfsr << 5;
+  return lfsr;
+}
+
+// moves the encoders and buttons of one scan
+static void surface_tick(u32 scan)
+{
+  // quadrature sequence of a detented encoder, pins are low active
+  static const u8 sequence[4] = { 3, 2, 0, 1 };
+  int enc, sr;
+
+  for(enc=0; enc<MIOS32_ENC_NUM_MAX; ++enc) {
+    encoder_t *e = &encoders[enc];
+    if( e->period && (scan % e->period) == 0 ) {
+      u8 sr = enc / 4;
+      u8 pos = 2 * (enc % 4);
+      e->phase = (e->phase + e->dir) & 3;
+      ++e->steps;
+      mios32_srio_din_buffer[sr] = (mios32_srio_din_buffer[sr] & ~(3 << pos)) | (sequence[e->phase] << pos);
+    }
+  }
+
+  if( button_rate ) {
+    for(sr=NUM_ENC_SR; sr<NUM_ENC_SR+button_srs; ++sr) {
+      u32 r = random_number();
+      if( (r & 1023) < button_rate )
+	mios32_srio_din_buffer[sr] ^= 1 << ((r >> 10) & 7);
+    }
+  }
+}
+
+// like the DMA callback of mios32_srio.c
+static void srio_scan(void)
+{
+  int i;
+  for(i=0; i<MIOS32_SRIO_NUM_SR; ++i) {
+    u8 change_mask = mios32_srio_din[i] ^ mios32_srio_din_buffer[i];
+    if( change_mask ) {
+      mios32_srio_din_changed[i] |= change_mask;
+      mios32_srio_din_changed_sr[i >> 5] |= (1 << (i & 31));
+      mios32_srio_din[i] = mios32_srio_din_buffer[i];
+    }
+  }
+}
+
+static void init(u8 scenario)
+{
+  int enc;
+
+  memset(encoders, 0, sizeof(encoders));
+  memset((void *)mios32_srio_din_buffer, 0xff, sizeof(mios32_srio_din_buffer));
+  memset((void *)mios32_srio_din, 0xff, sizeof(mios32_srio_din));
+  memset((void *)mios32_srio_din_changed_sr, 0, sizeof(mios32_srio_din_changed_sr));
+  MIOS32_DIN_Init(0);
+  MIOS32_ENC_Init(0);
+
+  for(enc=0; enc<MIOS32_ENC_NUM_MAX; ++enc) {
+    mios32_enc_config_t config;
+    config.all.ALL = 0;
+    config.cfg.type = DETENTED3;
+    config.cfg.speed = NORMAL;
+    config.cfg.sr = enc / 4 + 1;
+    config.cfg.pos = 2 * (enc % 4);
+    MIOS32_ENC_ConfigSet(enc, config);
+    encoders[enc].dir = (enc & 1) ? -1 : 1;
+  }
+
+  button_rate = 0;
+  button_srs = 0;
+  lfsr = 2463534242u;
+  din_events = 0;
+  enc_events = 0;
+
+  switch( scenario ) {
+  case SCENARIO_ONE_ENCODER:
+    encoders[21].period = 20;
+    break;
+
+  case SCENARIO_BUSY:
+    for(enc=0; enc<8; ++enc)
+      encoders[7*enc + 3].period = 6 + 5*enc;
+    button_srs = 8;
+    button_rate = 2;
+    break;
+
+  case SCENARIO_EVERYTHING:
+    for(enc=0; enc<MIOS32_ENC_NUM_MAX; ++enc)
+      encoders[enc].period = 4 + (enc % 7);
+    button_srs = MIOS32_SRIO_NUM_SR - NUM_ENC_SR;
+    button_rate = 64;
+    break;
+  }
+}
+
+static u64 now_ns(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (u64)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static void run(u8 scenario, const char *name)
+{
+  u32 scan;
+  int enc;
+  u64 t, t_surface;
+
+  // surface and SRIO emulation only
+  init(scenario);
+  t_surface = now_ns();
+  for(scan=1; scan<=NUM_SCANS; ++scan) {
+    surface_tick(scan);
+    srio_scan();
+  }
+  t_surface = now_ns() - t_surface;
+
+  init(scenario);
+
+  // the initial scan takes over the configuration
+  srio_scan();
+  MIOS32_ENC_UpdateStates();
+  MIOS32_DIN_Handler(DIN_NotifyToggle);
+  MIOS32_ENC_Handler(ENC_NotifyChange);
+
+  t = now_ns();
+  for(scan=1; scan<=NUM_SCANS; ++scan) {
+    surface_tick(scan);
+    srio_scan();
+    MIOS32_ENC_UpdateStates();
+    MIOS32_DIN_Handler(DIN_NotifyToggle);
+    MIOS32_ENC_Handler(ENC_NotifyChange);
+  }
+  t = now_ns() - t;
+
+  printf("%-13s %8.1f %10u %10u\n", name,
+	 (t > t_surface) ? (double)(t - t_surface) / NUM_SCANS : 0.0, din_events, enc_events);
+
+  // one increment per detent (4 quadrature steps), the last detent may be incomplete
+  for(enc=0; enc<MIOS32_ENC_NUM_MAX; ++enc) {
+    encoder_t *e = &encoders[enc];
+    if( abs(e->increments) != e->steps / 4 && abs(e->increments) != (e->steps + 3) / 4 ) {
+      printf("ERROR: encoder %d turned %d detents, but %d increments were reported\n",
+	     enc, e->steps / 4, e->increments);
+      ++errors;
+    }
+  }
+}
+
+
+int main(int argc, char *argv[])
+{
+  printf("%s: %d SRs, %d encoders, %d scans\n",
+	 MIOS32_SRIO_SKIP_UNCHANGED ? "changed SRs only" : "all SRs and encoders",
+	 MIOS32_SRIO_NUM_SR, MIOS32_ENC_NUM_MAX, NUM_SCANS);
+  printf("%-13s %8s %10s %10s\n", "", "nS/scan", "DIN events", "ENC events");
+  checksum = 2166136261u;
+  run(SCENARIO_IDLE, "idle");
+  run(SCENARIO_ONE_ENCODER, "one encoder");
+  run(SCENARIO_BUSY, "busy");
+  run(SCENARIO_EVERYTHING, "everything");
+
+  printf("checksum of the notifications: %08x\n", checksum);
+
+  if( errors ) {
+    printf("%d errors\n", errors);
+    return 1;
+  }
+
+  return 0;
+}
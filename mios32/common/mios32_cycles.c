@@ -0,0 +1,82 @@
+// $Id$
+//! \defgroup MIOS32_CYCLES
+//!
+//! CPU Cycle Counter for MIOS32
+//!
+//! Free running 32bit counter of the CPU clock cycles, e.g. for time
+//! measurements in statistics and traces. It's the cycle counter of the
+//! DWT unit of the Cortex-M3/M4 core, which is accessed via its fixed
+//! address, since the CMSIS headers of the supported families don't all
+//! define DWT.
+//!
+//! The counter runs at MIOS32_SYS_CPU_FREQUENCY and rolls over after
+//! 2^32 cycles (about 25 seconds at 168 MHz).
+//! \{
+/* ==========================================================================
+ *
+ *  Copyright (C) 2026 agent (agent@local)
+ *  Licensed for personal non-commercial use only.
+ *  All other rights reserved.
+ * 
+ * ==========================================================================
+ */
+
+/////////////////////////////////////////////////////////////////////////////
+// Include files
+/////////////////////////////////////////////////////////////////////////////
+
+#include <mios32.h>
+
+// this module can be optionally disabled in a local mios32_config.h file (included from mios32.h)
+#if !defined(MIOS32_DONT_USE_CYCLES)
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Local definitions
+/////////////////////////////////////////////////////////////////////////////
+
+#define DWT_CTRL   (*(volatile u32 *)0xe0001000)
+#define DWT_CYCCNT (*(volatile u32 *)0xe0001004)
+
+#define DWT_CTRL_CYCCNTENA (1 << 0)
+
+
+/////////////////////////////////////////////////////////////////////////////
+//! Enables the cycle counter.\n
+//! Can be called by each module which uses the counter, the counter isn't
+//! reset if it's already running.
+//! \param[in] mode currently only mode 0 supported
+//! \return < 0 if initialisation failed
+/////////////////////////////////////////////////////////////////////////////
+s32 MIOS32_CYCLES_Init(u32 mode)
+{
+  // currently only mode 0 supported
+  if( mode != 0 )
+    return -1; // unsupported mode
+
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+  DWT_CTRL |= DWT_CTRL_CYCCNTENA;
+
+  return 0; // no error
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//! Returns the current value of the cycle counter.\n
+//! Durations are calculated by subtracting two values, this also works
+//! across a roll over:
+//! \code
+//!   u32 cycles = MIOS32_CYCLES_Get();
+//!   // ... do something ...
+//!   cycles = MIOS32_CYCLES_Get() - cycles;
+//! \endcode
+//! \return the current cycle count
+/////////////////////////////////////////////////////////////////////////////
+u32 MIOS32_CYCLES_Get(void)
+{
+  return DWT_CYCCNT;
+}
+
+//! \}
+
+#endif /* MIOS32_DONT_USE_CYCLES */
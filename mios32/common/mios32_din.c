@@ -42,6 +42,10 @@ s32 MIOS32_DIN_Init(u32 mode)
     mios32_srio_din_changed[i] = 0;
   }
 
+  for(i=0; i<MIOS32_SRIO_NUM_SR_WORDS; ++i) {
+    mios32_srio_din_changed_sr[i] = 0;
+  }
+
   return 0;
 }
 
@@ -140,6 +144,9 @@ s32 MIOS32_DIN_Handler(void *_callback)
 {
   s32 sr;
   s32 sr_pin;
+#if MIOS32_SRIO_SKIP_UNCHANGED
+  s32 word;
+#endif
   u8 changed;
   void (*callback)(u32 pin, u32 value) = _callback;
   u8 num_sr = MIOS32_SRIO_ScanNumGet();
@@ -156,6 +163,38 @@ s32 MIOS32_DIN_Handler(void *_callback)
   if( _callback == NULL )
     return -1;
 
+#if MIOS32_SRIO_SKIP_UNCHANGED
+  // check only the shift registers which have been flagged by the SRIO driver
+  // (32 SRs are checked at once, unchanged SRs don't cost anything)
+  for(word=0; word<MIOS32_SRIO_NUM_SR_WORDS; ++word) {
+    // get and clear SR flags - must be atomic!
+    MIOS32_IRQ_Disable();
+    u32 sr_mask = mios32_srio_din_changed_sr[word];
+    mios32_srio_din_changed_sr[word] = 0;
+    MIOS32_IRQ_Enable();
+
+    while( sr_mask ) {
+      sr = 32*word + __builtin_ctz(sr_mask);
+      sr_mask &= sr_mask - 1; // clear lowest flag
+
+      // check if there are pin changes (mask all pins)
+      // note: flags could have been already cleared by another handler (e.g. ENC)
+      changed = MIOS32_DIN_SRChangedGetAndClear(sr, 0xff);
+
+      // notify only the changed pins of the SR
+      while( changed ) {
+	sr_pin = __builtin_ctz(changed);
+	changed &= changed - 1; // clear lowest flag
+
+	// call the notification function
+	callback(8*sr+sr_pin, (mios32_srio_din[sr] & (1 << sr_pin)) ? 1 : 0);
+
+	// start debouncing (if enabled in SRIO driver)
+	MIOS32_SRIO_DebounceStart();
+      }
+    }
+  }
+#else
   // check all shift registers for DIN pin changes
   for(sr=0; sr<num_sr; ++sr) {
     
@@ -176,6 +215,7 @@ s32 MIOS32_DIN_Handler(void *_callback)
 	MIOS32_SRIO_DebounceStart();
       }
   }
+#endif
 
   return 0;
 }
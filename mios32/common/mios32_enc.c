@@ -59,6 +59,25 @@ mios32_enc_config_t enc_config[MIOS32_ENC_NUM_MAX];
 
 enc_state_t enc_state[MIOS32_ENC_NUM_MAX];
 
+// one flag per encoder
+#define ENC_NUM_WORDS ((MIOS32_ENC_NUM_MAX+31)/32)
+
+// encoders which have to be updated on each scan:
+// enc_busy: pins have been changed, or accelerator not zero yet
+// enc_app: state is controlled by the application (SR == 0)
+static u32 enc_busy[ENC_NUM_WORDS];
+static u32 enc_app[ENC_NUM_WORDS];
+
+// encoders with incrementer != 0 (checked by MIOS32_ENC_Handler)
+static volatile u32 enc_pending[ENC_NUM_WORDS];
+
+// maps the 4 pin pairs of a SR to an encoder number (0xff: no encoder)
+#define ENC_SR_MAP_NONE 0xff
+static u8 enc_sr_map[MIOS32_SRIO_NUM_SR][4];
+
+// set if multiple encoders are assigned to the same pins - all encoders will be updated on each scan in this case
+static u8 enc_sr_map_conflict;
+
 
 /////////////////////////////////////////////////////////////////////////////
 //! Initializes encoder driver
@@ -87,6 +106,20 @@ s32 MIOS32_ENC_Init(u32 mode)
     enc_state[i].predivider = 0;
   }
 
+  for(i=0; i<ENC_NUM_WORDS; ++i) {
+    enc_busy[i] = 0;
+    enc_app[i] = 0;
+    enc_pending[i] = 0;
+  }
+
+  for(i=0; i<MIOS32_SRIO_NUM_SR; ++i) {
+    enc_sr_map[i][0] = ENC_SR_MAP_NONE;
+    enc_sr_map[i][1] = ENC_SR_MAP_NONE;
+    enc_sr_map[i][2] = ENC_SR_MAP_NONE;
+    enc_sr_map[i][3] = ENC_SR_MAP_NONE;
+  }
+  enc_sr_map_conflict = 0;
+
   return 0; // no error
 }
 
@@ -111,9 +144,44 @@ s32 MIOS32_ENC_ConfigSet(u32 encoder, mios32_enc_config_t config)
   if( encoder >= MIOS32_ENC_NUM_MAX )
     return -1; // invalid number
 
+  u32 word = encoder >> 5;
+  u32 mask = 1 << (encoder & 31);
+
+  // this operation should be atomic
+  MIOS32_IRQ_Disable();
+
+  // remove old SR assignment
+  mios32_enc_config_t old_config = enc_config[encoder];
+  if( old_config.cfg.sr > 0 && old_config.cfg.sr <= MIOS32_SRIO_NUM_SR ) {
+    u8 *map_ptr = &enc_sr_map[old_config.cfg.sr-1][(old_config.cfg.pos & 6) >> 1];
+    if( *map_ptr == encoder )
+      *map_ptr = ENC_SR_MAP_NONE;
+  }
+  enc_app[word] &= ~mask;
+
   // take over new configuration
   enc_config[encoder] = config;
 
+  // add new SR assignment
+  if( config.cfg.type != DISABLED ) {
+    if( config.cfg.sr == 0 ) {
+      enc_app[word] |= mask;
+    } else if( config.cfg.sr <= MIOS32_SRIO_NUM_SR ) {
+      u8 *map_ptr = &enc_sr_map[config.cfg.sr-1][(config.cfg.pos & 6) >> 1];
+      if( *map_ptr == ENC_SR_MAP_NONE || *map_ptr == encoder )
+	*map_ptr = encoder;
+      else
+	enc_sr_map_conflict = 1;
+    } else {
+      enc_sr_map_conflict = 1; // SR not mapped
+    }
+
+    // take over current pin state with the next scan
+    enc_busy[word] |= mask;
+  }
+
+  MIOS32_IRQ_Enable();
+
   return 0; // no error
 }
 
@@ -191,11 +259,43 @@ s32 MIOS32_ENC_StateGet(u32 encoder)
 /////////////////////////////////////////////////////////////////////////////
 s32 MIOS32_ENC_UpdateStates(void)
 {
-  u8 enc;
+  u32 enc;
+  int word;
+
+  // mark the encoders of SRs with changed DIN pins as busy
+  // (only the SRs which have been flagged by the SRIO driver have to be checked)
+  for(word=0; word<MIOS32_SRIO_NUM_SR_WORDS; ++word) {
+    u32 sr_mask = mios32_srio_din_changed_sr[word];
+
+    while( sr_mask ) {
+      u8 *map_ptr = &enc_sr_map[32*word + __builtin_ctz(sr_mask)][0];
+      sr_mask &= sr_mask - 1; // clear lowest flag
+
+      int i;
+      for(i=0; i<4; ++i, ++map_ptr) {
+	if( *map_ptr != ENC_SR_MAP_NONE )
+	  enc_busy[*map_ptr >> 5] |= (1 << (*map_ptr & 31));
+      }
+    }
+  }
 
-  // check all encoders
-  // Note: scanning of 64 encoders takes ca. 30 uS @ 72 MHz :-)
+  // check all busy encoders
+  // Note: scanning of 64 encoders took ca. 30 uS @ 72 MHz - now unmoved encoders are skipped
   for(enc=0; enc<MIOS32_ENC_NUM_MAX; ++enc) {
+    u32 enc_word = enc >> 5;
+    u32 enc_mask = (!MIOS32_SRIO_SKIP_UNCHANGED || enc_sr_map_conflict) ? 0xffffffff : (enc_busy[enc_word] | enc_app[enc_word]);
+    enc_mask >>= (enc & 31);
+    if( !enc_mask ) {
+      enc |= 31; // no busy encoder in the remaining part of this word
+      continue;
+    }
+    enc += __builtin_ctz(enc_mask);
+    if( enc >= MIOS32_ENC_NUM_MAX )
+      break;
+
+    // will be set again below as long as the accelerator is running
+    enc_busy[enc_word] &= ~(1 << (enc & 31));
+
     mios32_enc_config_t *enc_config_ptr = &enc_config[enc];
 
     // skip if encoder not configured
@@ -208,6 +308,8 @@ s32 MIOS32_ENC_UpdateStates(void)
     if( enc_state_ptr->accelerator )
       --enc_state_ptr->accelerator;
 
+    s8 prev_incrementer = enc_state_ptr->incrementer;
+
     // take over encoder state from SRIO handler if SR != 0
     // (if SR configured with 0 we expect that the state is controlled from application, e.g. by scanning GPIOs)
     if( enc_config_ptr->cfg.sr != 0 ) {
@@ -356,6 +458,14 @@ s32 MIOS32_ENC_UpdateStates(void)
 	}
       }
     }
+
+    // notify MIOS32_ENC_Handler
+    if( enc_state_ptr->incrementer != prev_incrementer )
+      enc_pending[enc_word] |= (1 << (enc & 31));
+
+    // keep encoder busy until the accelerator has been decremented to zero
+    if( enc_state_ptr->accelerator )
+      enc_busy[enc_word] |= (1 << (enc & 31));
   }
   return 0; // no error
 }
@@ -372,7 +482,10 @@ s32 MIOS32_ENC_UpdateStates(void)
 /////////////////////////////////////////////////////////////////////////////
 s32 MIOS32_ENC_Handler(void *_callback)
 {
-  u8 enc;
+  u32 enc;
+#if MIOS32_SRIO_SKIP_UNCHANGED
+  int word;
+#endif
   s32 incrementer;
   void (*callback)(u32 pin, u32 value) = _callback;
 
@@ -380,6 +493,33 @@ s32 MIOS32_ENC_Handler(void *_callback)
   if( _callback == NULL )
     return -1;
 
+#if MIOS32_SRIO_SKIP_UNCHANGED
+  // check only the encoders which have been flagged by MIOS32_ENC_UpdateStates
+  for(word=0; word<ENC_NUM_WORDS; ++word) {
+    // get and clear flags - must be atomic!
+    MIOS32_IRQ_Disable();
+    u32 enc_mask = enc_pending[word];
+    enc_pending[word] = 0;
+    MIOS32_IRQ_Enable();
+
+    while( enc_mask ) {
+      enc = 32*word + __builtin_ctz(enc_mask);
+      enc_mask &= enc_mask - 1; // clear lowest flag
+
+      // following check/modify operation must be atomic
+      MIOS32_IRQ_Disable();
+      if( (incrementer = enc_state[enc].incrementer) ) {
+	enc_state[enc].incrementer = 0;
+	MIOS32_IRQ_Enable();
+
+	// call the hook
+	callback(enc, incrementer);
+      } else {
+	MIOS32_IRQ_Enable();
+      }
+    }
+  }
+#else
   // check all encoders
   for(enc=0; enc<MIOS32_ENC_NUM_MAX; ++enc) {
 
@@ -395,6 +535,7 @@ s32 MIOS32_ENC_Handler(void *_callback)
       MIOS32_IRQ_Enable();
     }
   }
+#endif
 
   return 0; // no error
 }
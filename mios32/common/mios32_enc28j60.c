@@ -40,6 +40,11 @@
 #include <mios32.h>
 #include <string.h>
 
+#ifndef MIOS32_DONT_USE_FREERTOS
+#include <FreeRTOS.h>
+#include <task.h>
+#endif
+
 // this module can be optionally disabled in a local mios32_config.h file (included from mios32.h)
 #if !defined(MIOS32_DONT_USE_ENC28J60)
 
@@ -50,6 +55,19 @@
 #define MIOS32_ENC28J60_MUTEX_GIVE {}
 #endif
 
+// executed while a frame is transfered via DMA
+// by default other tasks get CPU time once the scheduler is running. Tasks of
+// higher priority could preempt the transfer anyway, so yielding doesn't add
+// new conflicts, but the SPI port shouldn't be accessed by other tasks without
+// the ENC28J60 mutex. Can be overruled in mios32_config.h, e.g. with {} for polling
+#if !defined(MIOS32_ENC28J60_DMA_WAIT)
+# ifndef MIOS32_DONT_USE_FREERTOS
+#  define MIOS32_ENC28J60_DMA_WAIT { if( xTaskGetSchedulerState() == taskSCHEDULER_RUNNING ) taskYIELD(); }
+# else
+#  define MIOS32_ENC28J60_DMA_WAIT {}
+# endif
+#endif
+
 
 /////////////////////////////////////////////////////////////////////////////
 // Local definitions
@@ -106,6 +124,11 @@ static u16 NextPacketLocation;
 
 static u8 rev_id;
 
+// cached bank selection (0xff: unknown, has to be selected)
+static u8 current_bank = 0xff;
+
+static volatile u8 dma_transfer_active;
+
 static u8 mac_addr[6];
 
 
@@ -563,16 +586,19 @@ s32 MIOS32_ENC28J60_PackageSend(u8 *buffer, u16 len, u8 *buffer2, u16 len2)
   if( status < 0 ) 
     goto error;
   
-  // per-packet control byte:
-  status |= MIOS32_ENC28J60_MACPut(0x07); // enable CRC calculation and padding to 60 bytes
+  // per-packet control byte and payload with a single Write Buffer Memory command
+  CSN_0;
+  status |= MIOS32_SPI_TransferByte(MIOS32_ENC28J60_SPI, WBM);
+  status |= MIOS32_SPI_TransferByte(MIOS32_ENC28J60_SPI, 0x07); // enable CRC calculation and padding to 60 bytes
 
   // send buffer
-  status |= MIOS32_ENC28J60_MACPutArray(buffer, len);
+  status |= MIOS32_ENC28J60_TransferBlock(buffer, NULL, len);
 
   // send second buffer if available
   if( buffer2 != NULL && len2 ) {
-    status |= MIOS32_ENC28J60_MACPutArray(buffer2, len2);
+    status |= MIOS32_ENC28J60_TransferBlock(buffer2, NULL, len2);
   }
+  CSN_1;
 
   // Reset transmit logic if a TX Error has previously occured
   // This is a silicon errata workaround
@@ -629,9 +655,10 @@ s32 MIOS32_ENC28J60_PackageReceive(u8 *buffer, u16 buffer_size)
     goto error;
 	
   // Test if at least one packet has been received and is waiting
+  // Bank 1 stays selected if no packet is available, so that polling only
+  // requires a single register read while the bank selection is cached
   status |= MIOS32_ENC28J60_BankSel(EPKTCNT);
   package_count = MIOS32_ENC28J60_ReadETHReg((u8)EPKTCNT);
-  status |= MIOS32_ENC28J60_BankSel(ERDPTL);
 
   if( status < 0 ) 
     goto error;
@@ -649,6 +676,7 @@ s32 MIOS32_ENC28J60_PackageReceive(u8 *buffer, u16 buffer_size)
 
   // Set the SPI read pointer to the beginning of the next unprocessed packet
   u16 CurrentPacketLocation = NextPacketLocation;
+  status |= MIOS32_ENC28J60_BankSel(ERDPTL);
   status |= MIOS32_ENC28J60_WriteReg(ERDPTL, CurrentPacketLocation & 0xff);
   status |= MIOS32_ENC28J60_WriteReg(ERDPTH, (CurrentPacketLocation >> 8) & 0xff);
 
@@ -993,15 +1021,25 @@ s32 MIOS32_ENC28J60_WritePHYReg(u8 reg, u16 data)
 //! Takes the high byte of a register address and changes the bank select 
 //! bits in ETHCON1 to match.
 //!
+//! The selected bank is cached, ECON1 will only be written if it changes.
+//! Therefore the bank select bits must not be modified by other functions.
+//!
 //! \param[in] reg Register address with the high byte containing the two bank select bits.
 //! \return < 0 on errors
 /////////////////////////////////////////////////////////////////////////////
 s32 MIOS32_ENC28J60_BankSel(u16 reg)
 {
   s32 status = 0;
+  u8 bank = (u8)(reg>>8);
+
+  if( bank == current_bank )
+    return 0; // already selected
 
   status |= MIOS32_ENC28J60_BFCReg(ECON1, ECON1_BSEL1 | ECON1_BSEL0);
-  status |= MIOS32_ENC28J60_BFSReg(ECON1, (u8)(reg>>8));
+  status |= MIOS32_ENC28J60_BFSReg(ECON1, bank);
+
+  // on errors the bank has to be selected again with the next call
+  current_bank = (status < 0) ? 0xff : bank;
 
   return status;
 }
@@ -1031,6 +1069,7 @@ s32 MIOS32_ENC28J60_SendSystemReset(void)
 #endif
   // Execute the System Reset command
   status = 0;
+  current_bank = 0xff; // will be reset to bank 0, but ensure that it's selected again
   CSN_0;
   status |= MIOS32_SPI_TransferByte(MIOS32_ENC28J60_SPI, SR);
   CSN_1;
@@ -1081,7 +1120,7 @@ s32 MIOS32_ENC28J60_MACGetArray(u8 *buffer, u16 len)
 
   CSN_0;
   status |= MIOS32_SPI_TransferByte(MIOS32_ENC28J60_SPI, RBM);
-  status |= MIOS32_SPI_TransferBlock(MIOS32_ENC28J60_SPI, NULL, buffer, len, NULL);
+  status |= MIOS32_ENC28J60_TransferBlock(NULL, buffer, len);
   CSN_1;
 
   return status;
@@ -1123,13 +1162,52 @@ s32 MIOS32_ENC28J60_MACPutArray(u8 *buffer, u16 len)
 
   CSN_0;
   status |= MIOS32_SPI_TransferByte(MIOS32_ENC28J60_SPI, WBM);
-  status |= MIOS32_SPI_TransferBlock(MIOS32_ENC28J60_SPI, buffer, NULL, len, NULL);
+  status |= MIOS32_ENC28J60_TransferBlock(buffer, NULL, len);
   CSN_1;
 
   return status;
 }
 
 
+/////////////////////////////////////////////////////////////////////////////
+//! Called from the SPI DMA interrupt once a block transfer has been finished
+/////////////////////////////////////////////////////////////////////////////
+static void MIOS32_ENC28J60_DMA_Callback(void)
+{
+  dma_transfer_active = 0;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//! Transfers a block via DMA and waits until it has been finished.
+//!
+//! Instead of polling the SPI DMA channel, MIOS32_ENC28J60_DMA_WAIT is
+//! executed until the completion callback has been called. This allows
+//! the calling task to give other tasks CPU time during frame transfers.
+//!
+//! Chip select has to be controlled by the caller.
+//! \param[in] send_buffer bytes which should be sent (NULL: send 0xff)
+//! \param[in] receive_buffer received bytes (NULL: ignore)
+//! \param[in] len number of bytes
+//! \return < 0 on errors
+/////////////////////////////////////////////////////////////////////////////
+s32 MIOS32_ENC28J60_TransferBlock(u8 *send_buffer, u8 *receive_buffer, u16 len)
+{
+  s32 status;
+
+  dma_transfer_active = 1;
+  if( (status=MIOS32_SPI_TransferBlock(MIOS32_ENC28J60_SPI, send_buffer, receive_buffer, len, MIOS32_ENC28J60_DMA_Callback)) < 0 ) {
+    dma_transfer_active = 0;
+    return status;
+  }
+
+  while( dma_transfer_active ) {
+    MIOS32_ENC28J60_DMA_WAIT;
+  }
+
+  return 0; // no error
+}
+
+
 //! \}
 
 #endif /* MIOS32_DONT_USE_ENC28J60 */
@@ -18,6 +18,7 @@
 /////////////////////////////////////////////////////////////////////////////
 
 #include <mios32.h>
+#include <string.h>
 
 // this module can be optionally disabled in a local mios32_config.h file (included from mios32.h)
 #if !defined(MIOS32_DONT_USE_MF)
@@ -31,6 +32,16 @@
 #define TIMEOUT_CTR_RELOAD       255 // give up after how many mS
 #define MANUAL_MOVE_CTR_RELOAD   255 // ignore new position request for how many mS
 
+#if MIOS32_MF_PID_CONTROL
+#define PID_STALL_CTR_RELOAD      24 // ticks without movement before the dead zone calibration is increased
+#define PID_STALL_DISTANCE         8 // fader stalls if it moved less than this distance during these ticks
+#define PID_SPEED_MEASURE_TICKS   16 // ticks of steady trajectory speed before travel speed is measured
+#define PID_MIN_DUTY_MAX         224 // upper limit for dead zone calibration
+#define PID_POS_MAX               (4096*MIOS32_AIN_OVERSAMPLING_RATE-1) // resolution of the AIN values
+#define PID_END_STOP_RANGE        ((PID_POS_MAX+1)/32) // stalls within this range are expected at the end stops
+#define PID_TRAVEL_SEEN_RANGE     ((PID_POS_MAX+1)*3/4) // learned end stops are valid after this travel
+#endif
+
 
 /////////////////////////////////////////////////////////////////////////////
 // Local types
@@ -64,6 +75,29 @@ typedef union {
   };
 } mf_state_t;
 
+#if MIOS32_MF_PID_CONTROL
+typedef struct {
+  s32 sp;           // trajectory setpoint (Q8)
+  s32 sp_vel;       // trajectory velocity (Q8 units/tick)
+  s32 vel;          // filtered measured velocity (Q8 units/tick)
+  s32 integ;        // integral of position error
+  u16 last_pos;     // position of previous tick
+  u16 stall_pos;    // position at which stall detection has been started
+  u16 travel_min;   // lowest position seen so far (end stop detection)
+  u16 travel_max;   // highest position seen so far (end stop detection)
+  u16 duty_acc;     // sigma-delta accumulator for PWM
+  u8  stall_ctr;
+  u8  steady_ctr;
+  u8  stalled:1;    // stall detected during current move
+  u8  reached:1;    // target reached during current move
+  u8  stall_down:1; // direction in which the stall detection has been started
+  u8  active:1;     // trajectory has been started
+
+  mios32_mf_pid_config_t config;
+  mios32_mf_calibration_t cal;
+} mf_pid_state_t;
+#endif
+
 
 /////////////////////////////////////////////////////////////////////////////
 // Local variables
@@ -74,6 +108,11 @@ typedef union {
 // control variables for motorfaders
 static mf_state_t mf_state[MIOS32_MF_NUM];
 
+#if MIOS32_MF_PID_CONTROL
+// PID controller and calibration state
+static mf_pid_state_t mf_pid_state[MIOS32_MF_NUM];
+#endif
+
 #endif
 
 
@@ -82,6 +121,9 @@ static mf_state_t mf_state[MIOS32_MF_NUM];
 /////////////////////////////////////////////////////////////////////////////
 #if MIOS32_MF_NUM
 static void MIOS32_MF_UpdateSR(void);
+#if MIOS32_MF_PID_CONTROL
+static void MIOS32_MF_PID_Control(mf_state_t *mf, mf_pid_state_t *pid, u16 current_pos, u16 ain_delta);
+#endif
 #endif
 
 
@@ -119,6 +161,21 @@ s32 MIOS32_MF_Init(u32 mode)
     mf_state[i].config.cfg.pwm_period = 3;
     mf_state[i].config.cfg.pwm_duty_cycle_down = 1;
     mf_state[i].config.cfg.pwm_duty_cycle_up = 1;
+
+#if MIOS32_MF_PID_CONTROL
+    mf_pid_state_t *pid = &mf_pid_state[i];
+    memset(pid, 0, sizeof(mf_pid_state_t));
+    pid->travel_min = 0xffff;
+    pid->config.kp = 48;
+    pid->config.ki = 4;
+    pid->config.kd = 16;
+    pid->config.kff = 16;
+    pid->config.max_speed = 0;
+    pid->config.accel = 512;
+    pid->cal.min_duty_up = 64;
+    pid->cal.min_duty_down = 64;
+    pid->cal.travel_speed = 16 << 4;
+#endif
   }
 
   return 0;
@@ -322,6 +379,127 @@ mios32_mf_config_t MIOS32_MF_ConfigGet(u32 mf)
 }
 
 
+/////////////////////////////////////////////////////////////////////////////
+//! This function configures the PID controller which is used if
+//! MIOS32_MF_PID_CONTROL is enabled in mios32_config.h
+//! \param[in] mf motor number (0..MIOS32_MF_NUM-1)
+//! \param[in] pid_config a structure with following members:
+//! <UL>
+//!   <LI>pid_config.kp: proportional gain (Q4)
+//!   <LI>pid_config.ki: integral gain (Q8)
+//!   <LI>pid_config.kd: derivative gain on the velocity error (duty cycle per AIN unit/tick)
+//!   <LI>pid_config.kff: velocity feed-forward gain (Q4)
+//!   <LI>pid_config.max_speed: trajectory speed in AIN units per tick
+//!       (0: 7/8 of the calibrated travel speed)
+//!   <LI>pid_config.accel: trajectory acceleration in AIN units per tick^2 (Q8)
+//!       (0: setpoint jumps to the target without velocity profile)
+//! </UL>
+//! The deadband of MIOS32_MF_ConfigSet() defines the target window, the
+//! PWM parameters are not used by the PID controller.
+//! \return -1 if motor doesn't exist or PID control not enabled
+/////////////////////////////////////////////////////////////////////////////
+s32 MIOS32_MF_PidConfigSet(u32 mf, mios32_mf_pid_config_t pid_config)
+{
+#if !MIOS32_MF_NUM || !MIOS32_MF_PID_CONTROL
+  return -1; // no motors or no PID control
+#else
+  // check if motor exists
+  if( mf >= MIOS32_MF_NUM )
+    return -1;
+
+  MIOS32_IRQ_Disable();
+  mf_pid_state[mf].config = pid_config;
+  MIOS32_IRQ_Enable();
+
+  return 0; // no error
+#endif
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//! returns the PID controller configuration
+//! \param[in] mf motor number (0..MIOS32_MF_NUM-1)
+//! \return the configuration structure (zeroed if motor doesn't exist)
+/////////////////////////////////////////////////////////////////////////////
+mios32_mf_pid_config_t MIOS32_MF_PidConfigGet(u32 mf)
+{
+  const mios32_mf_pid_config_t dummy = { .kp=0, .ki=0, .kd=0, .kff=0, .max_speed=0, .accel=0 };
+
+#if !MIOS32_MF_NUM || !MIOS32_MF_PID_CONTROL
+  return dummy;
+#else
+  // MF number valid?
+  if( mf >= MIOS32_MF_NUM )
+    return dummy;
+
+  return mf_pid_state[mf].config;
+#endif
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//! Sets the calibration values of a fader.<BR>
+//! The values are continuously adapted by the PID controller: the minimum
+//! duty cycles are increased whenever the fader stalls and slowly decreased
+//! after each successful move, the travel speed is measured while the
+//! fader follows the trajectory at constant speed.<BR>
+//! An application can store the values returned by MIOS32_MF_CalibrationGet()
+//! and restore them after power-on to skip the learning phase.
+//! \param[in] mf motor number (0..MIOS32_MF_NUM-1)
+//! \param[in] calibration a structure with following members:
+//! <UL>
+//!   <LI>calibration.min_duty_up: dead zone of the motor in MF_Up direction (0..255)
+//!   <LI>calibration.min_duty_down: dead zone of the motor in MF_Down direction (0..255)
+//!   <LI>calibration.travel_speed: AIN units per tick at full duty cycle (Q4)
+//! </UL>
+//! \return -1 if motor doesn't exist or PID control not enabled
+/////////////////////////////////////////////////////////////////////////////
+s32 MIOS32_MF_CalibrationSet(u32 mf, mios32_mf_calibration_t calibration)
+{
+#if !MIOS32_MF_NUM || !MIOS32_MF_PID_CONTROL
+  return -1; // no motors or no PID control
+#else
+  // check if motor exists
+  if( mf >= MIOS32_MF_NUM )
+    return -1;
+
+  if( calibration.min_duty_up > PID_MIN_DUTY_MAX )
+    calibration.min_duty_up = PID_MIN_DUTY_MAX;
+  if( calibration.min_duty_down > PID_MIN_DUTY_MAX )
+    calibration.min_duty_down = PID_MIN_DUTY_MAX;
+  if( calibration.travel_speed < (1 << 4) )
+    calibration.travel_speed = 1 << 4;
+
+  MIOS32_IRQ_Disable();
+  mf_pid_state[mf].cal = calibration;
+  MIOS32_IRQ_Enable();
+
+  return 0; // no error
+#endif
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//! returns the current calibration values of a fader
+//! \param[in] mf motor number (0..MIOS32_MF_NUM-1)
+//! \return the calibration structure (zeroed if motor doesn't exist)
+/////////////////////////////////////////////////////////////////////////////
+mios32_mf_calibration_t MIOS32_MF_CalibrationGet(u32 mf)
+{
+  const mios32_mf_calibration_t dummy = { .min_duty_up=0, .min_duty_down=0, .travel_speed=0 };
+
+#if !MIOS32_MF_NUM || !MIOS32_MF_PID_CONTROL
+  return dummy;
+#else
+  // MF number valid?
+  if( mf >= MIOS32_MF_NUM )
+    return dummy;
+
+  return mf_pid_state[mf].cal;
+#endif
+}
+
+
 /////////////////////////////////////////////////////////////////////////////
 //! Called from AIN DMA interrupt whenever new conversion results are available
 //! \param[in] *ain_values pointer to current conversion results
@@ -402,6 +580,9 @@ s32 MIOS32_MF_Tick(u16 *ain_values, u16 *ain_deltas)
         mf->timeout_ctr = TIMEOUT_CTR_RELOAD;
       }
       
+#if MIOS32_MF_PID_CONTROL
+      MIOS32_MF_PID_Control(mf, &mf_pid_state[i], current_pos, ain_delta);
+#else
       // continue if motor control hasn't reached idle state
       if( !mf->idle ) {
         // don't move motor if speed too fast
@@ -455,6 +636,7 @@ s32 MIOS32_MF_Tick(u16 *ain_values, u16 *ain_deltas)
 	  }
         }
       }
+#endif
     }
     
     // switch to next motorfader
@@ -469,6 +651,221 @@ s32 MIOS32_MF_Tick(u16 *ain_values, u16 *ain_deltas)
 #endif
 }
 
+#if MIOS32_MF_NUM && MIOS32_MF_PID_CONTROL
+/////////////////////////////////////////////////////////////////////////////
+// local function which replaces the bang-bang control if
+// MIOS32_MF_PID_CONTROL is enabled
+// The setpoint follows the target position along a trapezoidal velocity
+// profile, the PID output (+ velocity feed-forward) is mapped above the
+// calibrated dead zone of the motor and converted into a sigma-delta
+// modulated up/down signal, since the H bridges can only be switched on/off
+/////////////////////////////////////////////////////////////////////////////
+static void MIOS32_MF_PID_Control(mf_state_t *mf, mf_pid_state_t *pid, u16 current_pos, u16 ain_delta)
+{
+  mios32_mf_pid_config_t *cfg = &pid->config;
+  mios32_mf_calibration_t *cal = &pid->cal;
+
+  // track end stops of the fader, stalls at these positions are expected
+  if( current_pos < pid->travel_min )
+    pid->travel_min = current_pos;
+  if( current_pos > pid->travel_max )
+    pid->travel_max = current_pos;
+
+  // filtered velocity (Q8)
+  s32 pos_delta = (s32)current_pos - (s32)pid->last_pos;
+  pid->last_pos = current_pos;
+  pid->vel += ((pos_delta << 8) - pid->vel) >> 2;
+
+  // timeout or target reached: stop motor and let the setpoint follow the fader
+  if( mf->idle || !mf->repeat_ctr ) {
+    if( pid->active ) {
+      pid->active = 0;
+      // successful move: allow the dead zone calibration to decrease again
+      // (not after a timeout or touch, the fader could have been blocked)
+      if( pid->reached && !pid->stalled ) {
+        if( cal->min_duty_up )
+          --cal->min_duty_up;
+        if( cal->min_duty_down )
+          --cal->min_duty_down;
+      }
+    }
+    mf->repeat_ctr = 0;
+    mf->direction = MF_Standby;
+    pid->sp = current_pos << 8;
+    pid->sp_vel = 0;
+    pid->integ = 0;
+    pid->stall_ctr = 0;
+    pid->stalled = 0;
+    return;
+  }
+
+  // new move?
+  if( !pid->active ) {
+    pid->active = 1;
+    pid->reached = 0;
+    pid->stall_pos = current_pos;
+  }
+
+  // don't move motor if speed too fast (manual move)
+  if( ain_delta > 500 ) {
+    mf->direction = MF_Standby;
+    return;
+  }
+
+  // special case: if target and current position <= 0x01f, stop motor
+  // (workaround for ALPS faders which never reach the 0x000 value)
+  if( mf->pos < 0x1f && current_pos < 0x1f ) {
+    mf->direction = MF_Standby;
+    pid->reached = 1;
+    --mf->repeat_ctr;
+    return;
+  }
+
+  // trajectory: accelerate towards the target, decelerate early enough to stop there
+  s32 target = mf->pos << 8;
+  s32 dist = target - pid->sp;
+  s32 dir = (dist >= 0) ? 1 : -1;
+  s32 max_speed = cfg->max_speed ? (cfg->max_speed << 8) : ((cal->travel_speed << 4) * 7 / 8);
+  u8 steady = 0;
+
+  if( !cfg->accel ) {
+    pid->sp = target;
+    pid->sp_vel = 0;
+  } else {
+    s32 accel = cfg->accel;
+    s32 speed = dir * pid->sp_vel; // speed in direction of the target, negative while reversing
+    dist = dir * dist;
+
+    if( speed > 0 && (long long)speed * speed >= (long long)2 * accel * dist ) {
+      speed -= accel; // braking distance reached
+      if( speed < accel )
+        speed = accel;
+    } else if( speed < max_speed ) {
+      speed += accel;
+      if( speed > max_speed )
+        speed = max_speed;
+    } else {
+      speed = max_speed;
+      steady = 1;
+    }
+
+    if( speed >= dist ) {
+      pid->sp = target;
+      pid->sp_vel = 0;
+    } else {
+      pid->sp += dir * speed;
+      pid->sp_vel = dir * speed;
+    }
+  }
+
+  // position error (positive: fader has to move to higher values)
+  s32 error = (pid->sp >> 8) - (s32)current_pos;
+  u32 abs_error = abs(error);
+
+  // target reached? (fader has to be slow enough, otherwise it has to be braked)
+  if( pid->sp == target && abs_error <= mf->config.cfg.deadband && abs(pid->vel) < (1 << 8) ) {
+    mf->direction = MF_Standby;
+    pid->stall_ctr = 0;
+    pid->stall_pos = current_pos;
+    pid->reached = 1;
+    --mf->repeat_ctr;
+    return;
+  }
+
+  // integral with anti-windup: limit the contribution to the full duty cycle
+  if( cfg->ki ) {
+    s32 integ_max = (255 << 8) / cfg->ki;
+    pid->integ += error;
+    if( pid->integ > integ_max )
+      pid->integ = integ_max;
+    else if( pid->integ < -integ_max )
+      pid->integ = -integ_max;
+  } else {
+    pid->integ = 0;
+  }
+
+  // controller output in duty cycle units (-255..255) without dead zone
+  s32 travel_speed = cal->travel_speed << 4; // Q8
+  s32 out = (cfg->kff * ((pid->sp_vel * 255) / travel_speed)) >> 4;
+  out += (cfg->kp * error) >> 4;
+  out += (cfg->ki * pid->integ) >> 8;
+  out += (cfg->kd * (pid->sp_vel - pid->vel)) >> 8;
+  if( out > 255 )
+    out = 255;
+  else if( out < -255 )
+    out = -255;
+
+  // positive output moves the fader to higher values (MF_Down, see bang-bang control)
+  mios32_mf_direction_t direction = (out >= 0) ? MF_Down : MF_Up;
+  u8 *min_duty = (out >= 0) ? &cal->min_duty_down : &cal->min_duty_up;
+  u32 abs_out = abs(out);
+
+  // map output above the dead zone of the motor
+  u32 duty = abs_out ? (*min_duty + ((abs_out * (256 - *min_duty)) >> 8)) : 0;
+
+  // dead zone calibration: increase the minimum duty cycle if the fader doesn't move
+  // although it's driven (but not at the end stop it's driven to)
+  // The end stops seen so far are only considered once the fader has travelled over
+  // most of the range, otherwise a fader which never moved would never be calibrated
+  // A direction change restarts the detection, the motor doesn't move if the output
+  // alternates around zero near the target
+  if( abs(current_pos - pid->stall_pos) > PID_STALL_DISTANCE || duty >= 255 ||
+      pid->stall_down != (direction == MF_Down) ) {
+    pid->stall_ctr = 0;
+    pid->stall_pos = current_pos;
+    pid->stall_down = direction == MF_Down;
+  } else if( ++pid->stall_ctr >= PID_STALL_CTR_RELOAD ) {
+    u8 travel_seen = (pid->travel_max - pid->travel_min) >= PID_TRAVEL_SEEN_RANGE;
+    u8 at_end_stop;
+
+    if( direction == MF_Down ) // to higher values
+      at_end_stop = current_pos >= (PID_POS_MAX - PID_END_STOP_RANGE) ||
+	(travel_seen && current_pos >= (pid->travel_max - 2*MIOS32_AIN_DEADBAND));
+    else
+      at_end_stop = current_pos <= PID_END_STOP_RANGE ||
+	(travel_seen && current_pos <= (pid->travel_min + 2*MIOS32_AIN_DEADBAND));
+
+    pid->stall_ctr = 0;
+    if( !at_end_stop ) {
+      pid->stalled = 1;
+      if( *min_duty < (PID_MIN_DUTY_MAX-4) )
+	*min_duty += 4;
+    }
+  }
+
+  // travel speed calibration while the trajectory runs at constant speed:
+  // - motor saturated: the measured speed is the travel speed
+  // - fader follows without saturation: travel speed is higher than assumed, increase it slowly
+  if( steady ) {
+    if( ++pid->steady_ctr >= PID_SPEED_MEASURE_TICKS ) {
+      pid->steady_ctr = PID_SPEED_MEASURE_TICKS;
+      s32 travel_speed_q4 = cal->travel_speed;
+      if( duty >= 255 )
+	travel_speed_q4 += ((abs(pid->vel) >> 4) - travel_speed_q4) >> 3;
+      else
+	travel_speed_q4 += (travel_speed_q4 >> 7) + 1;
+
+      if( travel_speed_q4 < (1 << 4) )
+	travel_speed_q4 = 1 << 4;
+      else if( travel_speed_q4 > 0xffff )
+	travel_speed_q4 = 0xffff;
+      cal->travel_speed = travel_speed_q4;
+    }
+  } else {
+    pid->steady_ctr = 0;
+  }
+
+  // sigma-delta modulation of the duty cycle
+  pid->duty_acc += duty;
+  if( pid->duty_acc >= 256 ) {
+    pid->duty_acc -= 256;
+    mf->direction = direction;
+  } else {
+    mf->direction = MF_Standby;
+  }
+}
+#endif
+
 /////////////////////////////////////////////////////////////////////////////
 // local function to update the shift registers of MBHP_MF module
 /////////////////////////////////////////////////////////////////////////////
@@ -136,6 +136,7 @@ static mios32_midi_port_t default_port = MIOS32_MIDI_DEFAULT_PORT;
 static mios32_midi_port_t debug_port   = MIOS32_MIDI_DEBUG_PORT;
 
 static s32 (*direct_rx_callback_func)(mios32_midi_port_t port, u8 midi_byte);
+static void (*rx_notify_callback_func)(void);
 static s32 (*direct_tx_callback_func)(mios32_midi_port_t port, mios32_midi_package_t package);
 static s32 (*sysex_callback_func)(mios32_midi_port_t port, u8 sysex_byte);
 static s32 (*timeout_callback_func)(mios32_midi_port_t port);
@@ -200,6 +201,7 @@ s32 MIOS32_MIDI_Init(u32 mode)
 
   // disable callback functions
   direct_rx_callback_func = NULL;
+  rx_notify_callback_func = NULL;
   direct_tx_callback_func = NULL;
   sysex_callback_func = NULL;
   timeout_callback_func = NULL;
@@ -561,6 +563,70 @@ s32 MIOS32_MIDI_SendPackage(mios32_midi_port_t port, mios32_midi_package_t packa
 }
 
 
+/////////////////////////////////////////////////////////////////////////////
+//! Sends multiple packages over given port
+//!
+//! Should be used if several events have to be sent at once (e.g. all events
+//! of a sequencer step). For USB the packages are put into the Tx buffer in
+//! blocks, so that they are transfered with as few USB frames as possible.
+//! Other ports send the packages individually via MIOS32_MIDI_SendPackage()
+//!
+//! The optional Tx Callback function is called for each package.
+//! (blocking function)
+//! \param[in] port MIDI port (DEFAULT, USB0..USB7, UART0..UART3, IIC0..IIC7, SPIM0..SPIM7)
+//! \param[in] *packages pointer to MIDI packages
+//! \param[in] num number of packages
+//! \return -1 if port not available
+//! \return 0 on success
+/////////////////////////////////////////////////////////////////////////////
+s32 MIOS32_MIDI_SendPackageMulti(mios32_midi_port_t port, mios32_midi_package_t *packages, u32 num)
+{
+#if !defined(MIOS32_DONT_USE_USB) && !defined(MIOS32_DONT_USE_USB_MIDI) && defined(MIOS32_FAMILY_STM32F4xx)
+  // if default/debug port: select mapped port
+  if( !(port & 0xf0) ) {
+    port = (port == MIDI_DEBUG) ? debug_port : default_port;
+  }
+
+  if( (port & 0xf0) == USB0 ) {
+    mios32_midi_package_t block[MIOS32_USB_MIDI_DATA_IN_SIZE/4];
+
+    while( num ) {
+      u32 block_len = 0;
+
+      for(; num && block_len < (MIOS32_USB_MIDI_DATA_IN_SIZE/4); --num, ++packages) {
+	mios32_midi_package_t package = *packages;
+
+	// insert subport number into package
+	package.cable = port & 0xf;
+
+	// forward to Tx callback function and skip package if it has been filtered
+	if( direct_tx_callback_func != NULL && direct_tx_callback_func(port, package) )
+	  continue;
+
+	block[block_len++] = package;
+      }
+
+      if( block_len ) {
+	s32 status;
+	if( (status=MIOS32_USB_MIDI_PackageSendMulti(block, block_len)) < 0 )
+	  return status;
+      }
+    }
+
+    return 0; // no error
+  }
+#endif
+
+  for(; num; --num, ++packages) {
+    s32 status;
+    if( (status=MIOS32_MIDI_SendPackage(port, *packages)) < 0 )
+      return status;
+  }
+
+  return 0; // no error
+}
+
+
 /////////////////////////////////////////////////////////////////////////////
 //! Sends a MIDI Event
 //! This function is provided for a more comfortable use model
@@ -1493,10 +1559,17 @@ s32 MIOS32_MIDI_DirectRxCallback_Init(s32 (*callback_rx)(mios32_midi_port_t port
 /////////////////////////////////////////////////////////////////////////////
 s32 MIOS32_MIDI_SendByteToRxCallback(mios32_midi_port_t port, u8 midi_byte)
 {
+  s32 status = 0;
+
   // note: here we could filter the user hook execution on special situations
   if( direct_rx_callback_func != NULL )
-    return direct_rx_callback_func(port, midi_byte);
-  return 0; // no error
+    status = direct_rx_callback_func(port, midi_byte);
+
+  // byte will be put into Rx queue: notify receive task
+  if( status == 0 && rx_notify_callback_func != NULL )
+    rx_notify_callback_func();
+
+  return status;
 }
 
 /////////////////////////////////////////////////////////////////////////////
@@ -1518,8 +1591,37 @@ s32 MIOS32_MIDI_SendPackageToRxCallback(mios32_midi_port_t port, mios32_midi_pac
     s32 status = 0;
     for(i=0; i<len; ++i)
       status |= direct_rx_callback_func(port, buffer[i]);
-    return status;
+    if( status != 0 )
+      return status;
   }
+
+  // package will be put into Rx queue: notify receive task
+  if( rx_notify_callback_func != NULL )
+    rx_notify_callback_func();
+
+  return 0; // no error
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//! Installs a callback function which is executed whenever a MIDI driver
+//! has put new data into its receive queue.
+//!
+//! It's used by the programming model to wake up the task which calls
+//! MIOS32_MIDI_Receive_Handler(), so that incoming events are processed
+//! immediately instead of the next mS.
+//!
+//! Note that the function is mostly called from interrupt handlers which
+//! are running at a priority higher than the RTOS, therefore it mustn't
+//! call RTOS functions directly (instead, a low priority interrupt could
+//! be triggered which notifies the task)
+//! \param[in] *callback_notify pointer to callback function, NULL disables the callback
+//! \return < 0 on errors
+/////////////////////////////////////////////////////////////////////////////
+s32 MIOS32_MIDI_RxNotifyCallback_Init(void (*callback_notify)(void))
+{
+  rx_notify_callback_func = callback_notify;
+
   return 0; // no error
 }
 
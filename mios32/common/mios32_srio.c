@@ -49,6 +49,10 @@ volatile u8 mios32_srio_din_buffer[MIOS32_SRIO_NUM_SR];
 // change notification flags
 volatile u8 mios32_srio_din_changed[MIOS32_SRIO_NUM_SR];
 
+// one flag per SR which is set if mios32_srio_din_changed[sr] could be != 0
+// allows DIN/ENC handlers to skip unchanged SRs with a single word check
+volatile u32 mios32_srio_din_changed_sr[MIOS32_SRIO_NUM_SR_WORDS];
+
 // the current DOUT page
 #if MIOS32_SRIO_NUM_DOUT_PAGES > 1
 u8 mios32_srio_dout_page_ctr;
@@ -119,6 +123,10 @@ s32 MIOS32_SRIO_Init(u32 mode)
     mios32_srio_din_changed[i] = 0;   // no change
   }
 
+  for(i=0; i<MIOS32_SRIO_NUM_SR_WORDS; ++i) {
+    mios32_srio_din_changed_sr[i] = 0;
+  }
+
   // initial debounce time (debouncing disabled)
   debounce_time = 0;
   debounce_ctr = 0;
@@ -355,8 +363,11 @@ static void MIOS32_SRIO_DMA_Callback(void)
   int i;
   for(i=0; i<num_sr; ++i) {
     u8 change_mask = mios32_srio_din[i] ^ mios32_srio_din_buffer[i]; // these are the changed pins
-    mios32_srio_din_changed[i] |= change_mask;
-    mios32_srio_din[i] = mios32_srio_din_buffer[i];
+    if( change_mask ) {
+      mios32_srio_din_changed[i] |= change_mask;
+      mios32_srio_din_changed_sr[i >> 5] |= (1 << (i & 31));
+      mios32_srio_din[i] = mios32_srio_din_buffer[i];
+    }
   }
 
   // call user specific hook if requested
@@ -379,6 +390,10 @@ static void MIOS32_SRIO_DMA_Callback(void)
       mios32_srio_din[i] ^= mios32_srio_din_changed[i];
       mios32_srio_din_changed[i] = 0;
     }
+
+    for(i=0; i<MIOS32_SRIO_NUM_SR_WORDS; ++i) {
+      mios32_srio_din_changed_sr[i] = 0;
+    }
   }
 
   // next transfer has to be started with MIOS32_SRIO_ScanStart
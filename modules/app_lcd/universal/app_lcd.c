@@ -60,6 +60,26 @@ static u8 lcd_testmode = 0;
 static u8 lcd_alt_pinning = 0; // alternative LCD pinning (e.g. for MIDIbox CV which accesses a CLCD at J15, and SSD1306 displays at J5/J28 (STM32F4: J5/J10B))
 static u8 prev_glcd_selection = 0xfe; // 0..MAX_LCDS-1: the previous mios32_lcd_device, 0xff: all CS were activated, 0xfe: will force the update
 
+#if APP_LCD_FRAMEBUFFER_NUM_DEVICES
+#define FB_NUM_PAGES (APP_LCD_FRAMEBUFFER_HEIGHT/8)
+#define FB_NUM_DIRTY_WORDS ((APP_LCD_FRAMEBUFFER_WIDTH+31)/32)
+static u8 fb_data[APP_LCD_FRAMEBUFFER_NUM_DEVICES][FB_NUM_PAGES][APP_LCD_FRAMEBUFFER_WIDTH];
+static u32 fb_dirty[APP_LCD_FRAMEBUFFER_NUM_DEVICES][FB_NUM_PAGES][FB_NUM_DIRTY_WORDS]; // one flag per pixel column
+static u8 fb_flush_active; // if set, data and cursor changes are forwarded to the LCD
+
+/////////////////////////////////////////////////////////////////////////////
+// Returns 1 if graphical output of the current device goes into the framebuffer
+/////////////////////////////////////////////////////////////////////////////
+static inline u8 APP_LCD_FrameBufferUsed(void)
+{
+  return !fb_flush_active &&
+    mios32_lcd_device < APP_LCD_FRAMEBUFFER_NUM_DEVICES &&
+    MIOS32_LCD_TypeIsGLCD() &&
+    mios32_lcd_parameters.width <= APP_LCD_FRAMEBUFFER_WIDTH &&
+    mios32_lcd_parameters.height <= APP_LCD_FRAMEBUFFER_HEIGHT;
+}
+#endif
+
 
 /////////////////////////////////////////////////////////////////////////////
 // Derivative dependent IO access functions for CS lines
@@ -523,6 +543,14 @@ s32 APP_LCD_Init(u32 mode)
   // enable display by default
   display_available |= (1ULL << mios32_lcd_device);
 
+#if APP_LCD_FRAMEBUFFER_NUM_DEVICES
+  // content of the display is unknown: ensure that all columns will be transfered with the next flush
+  if( mios32_lcd_device < APP_LCD_FRAMEBUFFER_NUM_DEVICES ) {
+    memset(fb_data[mios32_lcd_device], 0x00, sizeof(fb_data[0]));
+    memset(fb_dirty[mios32_lcd_device], 0xff, sizeof(fb_dirty[0]));
+  }
+#endif
+
   switch( mios32_lcd_parameters.lcd_type ) {
   case MIOS32_LCD_TYPE_GLCD_KS0108:
   case MIOS32_LCD_TYPE_GLCD_KS0108_INVCS: {
@@ -783,6 +811,25 @@ s32 APP_LCD_Data(u8 data)
   if( lcd_testmode )
     return -1; // direct access disabled in testmode
 
+#if APP_LCD_FRAMEBUFFER_NUM_DEVICES
+  if( APP_LCD_FrameBufferUsed() ) {
+    // abort if max. width or height reached
+    if( mios32_lcd_x >= mios32_lcd_parameters.width || mios32_lcd_y >= mios32_lcd_parameters.height )
+      return -1;
+
+    // only changed columns will be transfered by APP_LCD_FrameBufferFlush()
+    u16 x = mios32_lcd_x++;
+    u8 page = mios32_lcd_y >> 3;
+    u8 *ptr = &fb_data[mios32_lcd_device][page][x];
+    if( *ptr != data ) {
+      *ptr = data;
+      fb_dirty[mios32_lcd_device][page][x >> 5] |= (1 << (x & 31));
+    }
+
+    return 0; // no error
+  }
+#endif
+
   // check if if display already has been disabled
   if( !(display_available & (1ULL << mios32_lcd_device)) )
     return -1;
@@ -1032,6 +1079,36 @@ s32 APP_LCD_Clear(void)
   if( lcd_testmode )
     return -1; // direct access disabled in testmode
 
+#if APP_LCD_FRAMEBUFFER_NUM_DEVICES
+  if( APP_LCD_FrameBufferUsed() ) {
+    // like on direct access: serial GLCDs are cleared at once, parallel GLCDs only for the selected device
+    u8 all = mios32_lcd_parameters.lcd_type == MIOS32_LCD_TYPE_GLCD_DOG ||
+             mios32_lcd_parameters.lcd_type == MIOS32_LCD_TYPE_GLCD_SSD1306 ||
+             mios32_lcd_parameters.lcd_type == MIOS32_LCD_TYPE_GLCD_SSD1306_ROTATED;
+    int device, page, x;
+    for(device=0; device<APP_LCD_FRAMEBUFFER_NUM_DEVICES; ++device) {
+      if( !all && device != mios32_lcd_device )
+	continue;
+
+      for(page=0; page<FB_NUM_PAGES; ++page) {
+	u8 *ptr = fb_data[device][page];
+	for(x=0; x<APP_LCD_FRAMEBUFFER_WIDTH; ++x, ++ptr) {
+	  if( *ptr ) {
+	    *ptr = 0x00;
+	    fb_dirty[device][page][x >> 5] |= (1 << (x & 31));
+	  }
+	}
+      }
+    }
+
+    // use default font
+    MIOS32_LCD_FontInit((u8 *)GLCD_FONT_NORMAL);
+
+    // set X=0, Y=0
+    return MIOS32_LCD_CursorSet(0, 0);
+  }
+#endif
+
   switch( mios32_lcd_parameters.lcd_type ) {
   case MIOS32_LCD_TYPE_GLCD_KS0108:
   case MIOS32_LCD_TYPE_GLCD_KS0108_INVCS:
@@ -1163,6 +1240,11 @@ s32 APP_LCD_GCursorSet(u16 x, u16 y)
   if( lcd_testmode )
     return -1; // direct access disabled in testmode
 
+#if APP_LCD_FRAMEBUFFER_NUM_DEVICES
+  if( APP_LCD_FrameBufferUsed() )
+    return 0; // position will be set by APP_LCD_FrameBufferFlush()
+#endif
+
   switch( mios32_lcd_parameters.lcd_type ) {
   case MIOS32_LCD_TYPE_GLCD_KS0108:
   case MIOS32_LCD_TYPE_GLCD_KS0108_INVCS: {
@@ -1354,6 +1436,107 @@ s32 APP_LCD_BitmapPrint(mios32_lcd_bitmap_t bitmap)
 }
 
 
+/////////////////////////////////////////////////////////////////////////////
+// Transfers the changed pixel columns of the framebuffer to the GLCDs
+// Consecutive changed columns of a page are sent as a single block; small
+// gaps of unchanged columns are sent as well if this is cheaper than
+// setting a new cursor position.
+// IN: if force != 0, all columns will be transfered
+// OUT: returns < 0 on errors
+/////////////////////////////////////////////////////////////////////////////
+s32 APP_LCD_FrameBufferFlush(u8 force)
+{
+#if !APP_LCD_FRAMEBUFFER_NUM_DEVICES
+  return -3; // not supported
+#else
+  if( lcd_testmode )
+    return -1; // direct access disabled in testmode
+
+  if( !MIOS32_LCD_TypeIsGLCD() ||
+      mios32_lcd_parameters.width > APP_LCD_FRAMEBUFFER_WIDTH ||
+      mios32_lcd_parameters.height > APP_LCD_FRAMEBUFFER_HEIGHT )
+    return 0; // framebuffer not used
+
+  // number of command bytes which are required to set the cursor
+  // (KS0108, SED1520: X and page, DOG and SSD1306: two X nibbles and page)
+  u8 gap_max = (mios32_lcd_parameters.lcd_type == MIOS32_LCD_TYPE_GLCD_DOG ||
+		mios32_lcd_parameters.lcd_type == MIOS32_LCD_TYPE_GLCD_SSD1306 ||
+		mios32_lcd_parameters.lcd_type == MIOS32_LCD_TYPE_GLCD_SSD1306_ROTATED) ? 3 : 2;
+
+  u8 prev_device = mios32_lcd_device;
+  u16 prev_x = mios32_lcd_x;
+  u16 prev_y = mios32_lcd_y;
+
+  int num_devices = mios32_lcd_parameters.num_x * mios32_lcd_parameters.num_y;
+  if( num_devices > APP_LCD_FRAMEBUFFER_NUM_DEVICES )
+    num_devices = APP_LCD_FRAMEBUFFER_NUM_DEVICES;
+
+  int width = mios32_lcd_parameters.width;
+  int num_pages = mios32_lcd_parameters.height / 8;
+
+  fb_flush_active = 1;
+
+  int device, page;
+  for(device=0; device<num_devices; ++device) {
+    mios32_lcd_device = device;
+
+    for(page=0; page<num_pages; ++page) {
+      u32 *dirty = fb_dirty[device][page];
+      u8 *data = fb_data[device][page];
+      int x;
+
+      if( force ) {
+	for(x=0; x<FB_NUM_DIRTY_WORDS; ++x)
+	  dirty[x] = 0xffffffff;
+      }
+
+      for(x=0; x<width; ++x) {
+	// skip unchanged columns, 32 at once if possible
+	if( !dirty[x >> 5] ) {
+	  x |= 31;
+	  continue;
+	}
+	if( !(dirty[x >> 5] & (1 << (x & 31))) )
+	  continue;
+
+	// search for the end of the block
+	int end = x;
+	int gap = 0;
+	int i;
+	for(i=x+1; i<width && gap<=gap_max; ++i) {
+	  if( dirty[i >> 5] & (1 << (i & 31)) ) {
+	    end = i;
+	    gap = 0;
+	  } else {
+	    ++gap;
+	  }
+	}
+
+	// transfer block
+	mios32_lcd_x = x;
+	mios32_lcd_y = page * 8;
+	APP_LCD_GCursorSet(mios32_lcd_x, mios32_lcd_y);
+	for(i=x; i<=end; ++i) {
+	  APP_LCD_Data(data[i]);
+	  dirty[i >> 5] &= ~(1 << (i & 31));
+	}
+
+	x = end;
+      }
+    }
+  }
+
+  fb_flush_active = 0;
+
+  mios32_lcd_device = prev_device;
+  mios32_lcd_x = prev_x;
+  mios32_lcd_y = prev_y;
+
+  return 0; // no error
+#endif
+}
+
+
 /////////////////////////////////////////////////////////////////////////////
 // Optional alternative pinning options
 // E.g. for MIDIbox CV which accesses a CLCD at J15, and SSD1306 displays at J5/J28 (STM32F4: J5/J10B)
@@ -1592,6 +1775,9 @@ s32 APP_LCD_TerminalPrintConfig(void *_output_function)
   out("lcd_num_y: %d\n", mios32_lcd_parameters.num_y);
   out("lcd_width: %d\n", mios32_lcd_parameters.width);
   out("lcd_height: %d\n", mios32_lcd_parameters.height);
+#if APP_LCD_FRAMEBUFFER_NUM_DEVICES
+  out("lcd_framebuffer: %d devices with %dx%d pixels\n", APP_LCD_FRAMEBUFFER_NUM_DEVICES, APP_LCD_FRAMEBUFFER_WIDTH, APP_LCD_FRAMEBUFFER_HEIGHT);
+#endif
 
   return 0; // no error
 }
@@ -22,6 +22,23 @@ extern "C" {
 // Global definitions
 /////////////////////////////////////////////////////////////////////////////
 
+// optional pixel framebuffer for GLCDs, disabled by default to save RAM.
+// Can be enabled in mios32_config.h, e.g. with "#define APP_LCD_FRAMEBUFFER_NUM_DEVICES 2"
+// Graphical output to the first APP_LCD_FRAMEBUFFER_NUM_DEVICES displays will
+// be rendered into RAM, and APP_LCD_FrameBufferFlush() has to be called periodically
+// to transfer the changed pixel columns (BUFLCD_Update() takes care for this)
+#ifndef APP_LCD_FRAMEBUFFER_NUM_DEVICES
+#define APP_LCD_FRAMEBUFFER_NUM_DEVICES 0
+#endif
+
+// maximum dimensions of a buffered GLCD (in pixels)
+#ifndef APP_LCD_FRAMEBUFFER_WIDTH
+#define APP_LCD_FRAMEBUFFER_WIDTH 128
+#endif
+#ifndef APP_LCD_FRAMEBUFFER_HEIGHT
+#define APP_LCD_FRAMEBUFFER_HEIGHT 64
+#endif
+
 
 /////////////////////////////////////////////////////////////////////////////
 // Global Types
@@ -45,6 +62,8 @@ extern s32 APP_LCD_FColourSet(u32 rgb);
 extern s32 APP_LCD_BitmapPixelSet(mios32_lcd_bitmap_t bitmap, u16 x, u16 y, u32 colour);
 extern s32 APP_LCD_BitmapPrint(mios32_lcd_bitmap_t bitmap);
 
+extern s32 APP_LCD_FrameBufferFlush(u8 force);
+
 extern s32 APP_LCD_TerminalHelp(void *_output_function);
 extern s32 APP_LCD_TerminalParseLine(char *input, void *_output_function);
 extern s32 APP_LCD_TerminalPrintConfig(void *_output_function);
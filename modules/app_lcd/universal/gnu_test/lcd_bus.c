@@ -0,0 +1,302 @@
+// Host stand-in of the LCD bus for the GLCD framebuffer
+//
+// app_lcd.c, mios32_lcd.c and buflcd.c are compiled on the host for eight
+// SSD1306 OLEDs (4x2 layout, 128x64 pixels each), which are connected to the
+// serial J15 port. MIOS32_BOARD_J15_*() record the bus: data and command
+// bytes are counted, and a model of each SSD1306 takes over the page/column
+// commands and the display RAM writes of the selected chip select lines.
+//
+// Screens:
+// - BUFLCD page: a text page of 21x8 characters per display, written with
+//   BUFLCD_PrintString() and transfered with BUFLCD_Update(). A play
+//   position marker moves each frame and a value changes every 4th frame,
+//   like on a MBSEQ step view
+// - labels: each display shows a label and a value in the big font, printed
+//   directly with MIOS32_LCD_PrintString(). Three encoders are turned, and
+//   their label and value strings are printed again each frame, like MBNG
+//   does on value changes
+// - full redraw: all displays are cleared and drawn again each frame, while
+//   only a single value changes
+//
+// The makefile builds this stand-in twice: without framebuffer (direct
+// transfer of each glyph), and with APP_LCD_FRAMEBUFFER_NUM_DEVICES 8
+// (glyphs are rendered into RAM, changed columns are sent by
+// APP_LCD_FrameBufferFlush()). "make test" checks that both builds result
+// in the same display contents after each frame, and both report the bytes
+// sent per frame.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "mios32.h"
+#include "app_lcd.h"
+#include "glcd_font.h"
+#include "buflcd.h"
+
+#define NUM_DEVICES  8
+#define NUM_FRAMES   200
+#define LCD_WIDTH    128
+#define LCD_HEIGHT   64
+#define NUM_PAGES    (LCD_HEIGHT/8)
+
+// model of a SSD1306 in page addressing mode
+typedef struct {
+  u8 ram[NUM_PAGES][LCD_WIDTH];
+  u8 column;
+  u8 page;
+} ssd1306_t;
+
+static ssd1306_t displays[NUM_DEVICES];
+static u8 bus_rs;      // 0: command, 1: data
+static u8 bus_cs_mask; // selected displays (CS lines are low active)
+
+typedef struct {
+  u32 data_bytes;
+  u32 cmd_bytes;
+  u32 cs_changes;
+} bus_stats_t;
+
+static bus_stats_t frame_stats;
+static u32 checksum;
+static int errors;
+
+
+// ------- J15 stubs -------
+s32 MIOS32_BOARD_J15_PortInit(u32 mode) { return 0; }
+s32 MIOS32_BOARD_J15_RW_Set(u8 rw) { return 0; }
+s32 MIOS32_BOARD_J15_E_Set(u8 lcd, u8 e) { return 0; }
+s32 MIOS32_BOARD_J15_GetD7In(void) { return 0; }
+s32 MIOS32_BOARD_J15_D7InPullUpEnable(u8 enable) { return 0; }
+s32 MIOS32_BOARD_J15_PollUnbusy(u8 lcd, u32 time_out) { return 0; }
+s32 MIOS32_BOARD_J5_PinInit(u8 pin, u32 mode) { return 0; }
+s32 MIOS32_BOARD_J5_PinSet(u8 pin, u8 value) { return 0; }
+s32 MIOS32_BOARD_J10_PinInit(u8 pin, u32 mode) { return 0; }
+s32 MIOS32_BOARD_J10_PinSet(u8 pin, u8 value) { return 0; }
+s32 MIOS32_BOARD_J28_PinInit(u8 pin, u32 mode) { return 0; }
+s32 MIOS32_BOARD_J28_PinSet(u8 pin, u8 value) { return 0; }
+s32 MIOS32_DELAY_Wait_uS(u16 uS) { return 0; }
+
+s32 MIOS32_BOARD_J15_RS_Set(u8 rs)
+{
+  bus_rs = rs;
+  return 0;
+}
+
+// the data port of the serial J15 drives the CS lines of the OLEDs
+s32 MIOS32_BOARD_J15_DataSet(u8 data)
+{
+  if( (u8)~data != bus_cs_mask ) {
+    bus_cs_mask = ~data;
+    ++frame_stats.cs_changes;
+  }
+  return 0;
+}
+
+s32 MIOS32_BOARD_J15_SerDataShift(u8 data)
+{
+  int device;
+
+  if( bus_rs )
+    ++frame_stats.data_bytes;
+  else
+    ++frame_stats.cmd_bytes;
+
+  for(device=0; device<NUM_DEVICES; ++device) {
+    ssd1306_t *d = &displays[device];
+    if( !(bus_cs_mask & (1 << device)) )
+      continue;
+
+    if( bus_rs ) {
+      d->ram[d->page][d->column] = data;
+      d->column = (d->column + 1) % LCD_WIDTH;
+    } else if( data < 0x10 ) {
+      d->column = (d->column & 0xf0) | data;
+    } else if( data < 0x20 ) {
+      d->column = (d->column & 0x0f) | ((data & 0x07) << 4);
+    } else if( data >= 0xb0 && data < 0xb8 ) {
+      d->page = data & 0x07;
+    }
+    // other commands (and their parameters) are only sent during initialisation
+  }
+
+  return 0;
+}
+
+
+// ------- screens -------
+static const char *labels[NUM_DEVICES] = {
+  "Cutoff", "Resonance", "Env Mod", "Decay", "Accent", "Volume", "Tempo", "Swing"
+};
+
+static void print_at(u8 device, u16 column, u16 line, char *str)
+{
+  MIOS32_LCD_DeviceSet(device);
+  MIOS32_LCD_CursorSet(column, line);
+  MIOS32_LCD_PrintString(str);
+}
+
+static void screen_buflcd(u32 frame)
+{
+  int device, line;
+  char str[32];
+
+  // BUFLCD handles the 8 displays as a single 84x16 character screen
+  for(device=0; device<NUM_DEVICES; ++device) {
+    int x = (device % 4) * 21;
+    int y = (device / 4) * 8;
+
+    BUFLCD_CursorSet(x, y);
+    sprintf(str, "Trk G%dT%d  %-10s", device/4 + 1, device%4 + 1, labels[device]);
+    BUFLCD_PrintString(str);
+
+    for(line=1; line<8; ++line) {
+      int step;
+      BUFLCD_CursorSet(x, y + line);
+      for(step=0; step<16; ++step) {
+	u8 gate = ((step * 7 + line * 3 + device) % 5) < 2;
+	if( line == 1 && step == (frame % 16) )
+	  BUFLCD_PrintChar('>'); // play position
+	else
+	  BUFLCD_PrintChar(gate ? '*' : '.');
+      }
+      sprintf(str, " %3d ", (line == 7) ? (int)((frame / 4 + device * 13) % 128) : line * 16);
+      BUFLCD_PrintString(str);
+    }
+  }
+
+  BUFLCD_Update(0);
+}
+
+static void print_label(u8 device, u32 value)
+{
+  char str[32];
+
+  MIOS32_LCD_FontInit((u8 *)GLCD_FONT_NORMAL);
+  sprintf(str, "ENC%-2d %-15s", device + 1, labels[device]);
+  print_at(device, 0, 0, str);
+
+  MIOS32_LCD_FontInit((u8 *)GLCD_FONT_BIG);
+  sprintf(str, "%5d   ", value);
+  print_at(device, 0, 1, str);
+}
+
+static void screen_labels(u32 frame)
+{
+  int device;
+
+  if( frame == 0 ) {
+    for(device=0; device<NUM_DEVICES; ++device)
+      print_label(device, 64);
+  } else {
+    // three encoders are turned, MBNG prints the complete label again
+    for(device=1; device<=5; device+=2)
+      print_label(device, (64 + frame * device) % 128);
+  }
+}
+
+static void screen_full_redraw(u32 frame)
+{
+  int device;
+
+  // clears all OLEDs at once
+  MIOS32_LCD_DeviceSet(0);
+  MIOS32_LCD_Clear();
+
+  for(device=0; device<NUM_DEVICES; ++device)
+    print_label(device, (device == 2) ? (frame % 128) : 64);
+}
+
+
+// ------- test -------
+static void add_checksum(u8 value)
+{
+  checksum = (checksum ^ value) * 16777619u; // FNV-1a
+}
+
+static void init(void)
+{
+  mios32_lcd_parameters_t p;
+  int device;
+
+  p.lcd_type = MIOS32_LCD_TYPE_GLCD_SSD1306;
+  p.num_x = 4;
+  p.num_y = 2;
+  p.width = LCD_WIDTH;
+  p.height = LCD_HEIGHT;
+  p.colour_depth = 1;
+  MIOS32_LCD_ParametersSet(p);
+
+  for(device=0; device<NUM_DEVICES; ++device) {
+    MIOS32_LCD_DeviceSet(device);
+    APP_LCD_Init(0);
+  }
+
+  MIOS32_LCD_DeviceSet(0);
+  MIOS32_LCD_Clear();
+  MIOS32_LCD_FontInit((u8 *)GLCD_FONT_NORMAL);
+  BUFLCD_Init(0);
+  BUFLCD_Update(1);
+#if APP_LCD_FRAMEBUFFER_NUM_DEVICES
+  APP_LCD_FrameBufferFlush(1);
+#endif
+}
+
+static void run(void (*screen)(u32 frame), const char *name)
+{
+  bus_stats_t total, max;
+  u32 frame;
+  int device, page, x;
+
+  init();
+  memset(&total, 0, sizeof(total));
+  memset(&max, 0, sizeof(max));
+
+  for(frame=0; frame<NUM_FRAMES; ++frame) {
+    memset(&frame_stats, 0, sizeof(frame_stats));
+
+    screen(frame);
+#if APP_LCD_FRAMEBUFFER_NUM_DEVICES
+    APP_LCD_FrameBufferFlush(0);
+#endif
+
+    total.data_bytes += frame_stats.data_bytes;
+    total.cmd_bytes += frame_stats.cmd_bytes;
+    total.cs_changes += frame_stats.cs_changes;
+    if( frame_stats.data_bytes + frame_stats.cmd_bytes > max.data_bytes + max.cmd_bytes )
+      max = frame_stats;
+
+    // content of all displays after the frame
+    for(device=0; device<NUM_DEVICES; ++device)
+      for(page=0; page<NUM_PAGES; ++page)
+	for(x=0; x<LCD_WIDTH; ++x)
+	  add_checksum(displays[device].ram[page][x]);
+  }
+
+  // the first frame draws the screen, the others update it
+  printf("%-12s %9.1f %9.1f %9.1f %9u\n", name,
+	 (double)total.data_bytes / NUM_FRAMES, (double)total.cmd_bytes / NUM_FRAMES,
+	 (double)total.cs_changes / NUM_FRAMES, max.data_bytes + max.cmd_bytes);
+}
+
+
+int main(int argc, char *argv[])
+{
+  printf("%s: %d SSD1306 with %dx%d pixels, %d frames\n",
+	 APP_LCD_FRAMEBUFFER_NUM_DEVICES ? "framebuffer" : "direct transfer",
+	 NUM_DEVICES, LCD_WIDTH, LCD_HEIGHT, NUM_FRAMES);
+  printf("%-12s %9s %9s %9s %9s\n", "per frame", "data", "commands", "CS", "max bytes");
+
+  checksum = 2166136261u;
+  run(screen_buflcd, "BUFLCD page");
+  run(screen_labels, "labels");
+  run(screen_full_redraw, "full redraw");
+
+  printf("checksum of the display contents: %08x\n", checksum);
+
+  if( errors ) {
+    printf("%d errors\n", errors);
+    return 1;
+  }
+
+  return 0;
+}
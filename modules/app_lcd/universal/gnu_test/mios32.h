@@ -0,0 +1,58 @@
+// minimal MIOS32 environment to compile app_lcd.c, mios32_lcd.c and
+// buflcd.c on the host, see lcd_bus.c
+#ifndef _MIOS32_H
+#define _MIOS32_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+typedef uint8_t  u8;
+typedef uint16_t u16;
+typedef uint32_t u32;
+typedef uint64_t u64;
+typedef int8_t   s8;
+typedef int16_t  s16;
+typedef int32_t  s32;
+
+#define MIOS32_FAMILY_STM32F4xx
+
+// GPIO accesses of the extension port are not simulated
+#define GPIOC 0
+#define GPIO_Pin_13 0
+#define GPIO_Pin_14 0
+#define MIOS32_SYS_STM_PINSET(port, pin, value) do {} while(0)
+#define MIOS32_SYS_STM_PINSET_0(port, pin) do {} while(0)
+#define MIOS32_SYS_STM_PINSET_1(port, pin) do {} while(0)
+
+#define MIOS32_BOARD_PIN_MODE_OUTPUT_PP 0
+#define MIOS32_BOARD_PIN_MODE_INPUT_PU  0
+
+// J15 is the LCD bus which is recorded by lcd_bus.c
+extern s32 MIOS32_BOARD_J15_PortInit(u32 mode);
+extern s32 MIOS32_BOARD_J15_DataSet(u8 data);
+extern s32 MIOS32_BOARD_J15_SerDataShift(u8 data);
+extern s32 MIOS32_BOARD_J15_RS_Set(u8 rs);
+extern s32 MIOS32_BOARD_J15_RW_Set(u8 rw);
+extern s32 MIOS32_BOARD_J15_E_Set(u8 lcd, u8 e);
+extern s32 MIOS32_BOARD_J15_GetD7In(void);
+extern s32 MIOS32_BOARD_J15_D7InPullUpEnable(u8 enable);
+extern s32 MIOS32_BOARD_J15_PollUnbusy(u8 lcd, u32 time_out);
+extern s32 MIOS32_BOARD_J5_PinInit(u8 pin, u32 mode);
+extern s32 MIOS32_BOARD_J5_PinSet(u8 pin, u8 value);
+extern s32 MIOS32_BOARD_J10_PinInit(u8 pin, u32 mode);
+extern s32 MIOS32_BOARD_J10_PinSet(u8 pin, u8 value);
+extern s32 MIOS32_BOARD_J28_PinInit(u8 pin, u32 mode);
+extern s32 MIOS32_BOARD_J28_PinSet(u8 pin, u8 value);
+
+extern s32 MIOS32_DELAY_Wait_uS(u16 uS);
+
+#define MIOS32_IRQ_Disable() do {} while(0)
+#define MIOS32_IRQ_Enable()  do {} while(0)
+
+#define MIOS32_MIDI_SendDebugMessage printf
+
+#include "mios32_config.h"
+#include "mios32_lcd.h"
+
+#endif /* _MIOS32_H */
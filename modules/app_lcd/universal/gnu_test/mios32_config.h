@@ -0,0 +1,5 @@
+// configuration of the host stand-in, see lcd_bus.c
+// APP_LCD_FRAMEBUFFER_NUM_DEVICES is set by the makefile
+
+// BUFLCD handles 8 OLEDs with 21x8 characters
+#define BUFLCD_BUFFER_SIZE (8*21*8)
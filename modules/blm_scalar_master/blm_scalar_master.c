@@ -41,6 +41,16 @@
 
 #define SYSEX_BLM_CMD_REQUEST      0x00
 #define SYSEX_BLM_CMD_LAYOUT       0x01
+#define SYSEX_BLM_CMD_LED_FRAME    0x02
+
+// feature flags which are optionally sent by the BLM after the layout informations
+#define SYSEX_BLM_FEATURE_LED_FRAME 0x01
+
+// LED frame records: <colour/row> <run-1> <pattern[6:0]> <pattern[13:7]> <pattern[15:14]>
+#define BLM_LED_FRAME_RECORD_SIZE 5
+#define BLM_LED_FRAME_COLOUR_GREEN 0
+#define BLM_LED_FRAME_COLOUR_RED   1
+#define BLM_LED_FRAME_COLOUR_BOTH  2
 
 // timeout after 10 seconds (timeout counter is incremented each mS)
 #define BLM_TIMEOUT_RELOAD_VALUE 10000
@@ -85,6 +95,8 @@ typedef union {
     unsigned COLUMNS_RECEIVED:1;
     unsigned ROWS_RECEIVED:1;
     unsigned COLOURS_RECEIVED:1;
+    unsigned EXTRA_CTR:2;
+    unsigned FEATURES_RECEIVED:1;
   } blm;
 
 } sysex_state_t;
@@ -125,6 +137,8 @@ static u8 blm_num_columns;
 static u8 blm_num_rows;
 static u8 blm_num_colours;
 static u8 blm_force_update;
+static u8 blm_features;
+static u8 blm_features_received;
 
 static s32 (*blm_button_callback_func)(u8 blm, blm_scalar_master_element_t element_id, u8 button_x, u8 button_y, u8 button_depressed);
 static s32 (*blm_fader_callback_func)(u8 blm, u8 fader, u8 value);
@@ -159,6 +173,7 @@ static s32 BLM_SCALAR_MASTER_SYSEX_Cmd_Ping(mios32_midi_port_t port, sysex_cmd_s
 static s32 BLM_SCALAR_MASTER_SYSEX_SendAck(mios32_midi_port_t port, u8 ack_code, u8 ack_arg);
 
 static s32 BLM_SendPackets(mios32_midi_package_t *packets, u8 num_packets);
+static s32 BLM_SendLedFrame(u8 force_update);
 
 
 /////////////////////////////////////////////////////////////////////////////
@@ -179,6 +194,8 @@ s32 BLM_SCALAR_MASTER_Init(u32 mode)
   blm_num_rows = 16;
   blm_num_colours = 2;
   blm_force_update = 0;
+  blm_features = 0;
+  blm_features_received = 0;
   blm_leds_rotate_view = 0;
   blm_led_row_offset = 0;
 
@@ -648,6 +665,7 @@ static s32 BLM_SCALAR_MASTER_SYSEX_Cmd_Layout(mios32_midi_port_t port, sysex_cmd
   switch( cmd_state ) {
 
     case SYSEX_CMD_STATE_BEGIN:
+      blm_features_received = 0; // old firmwares don't send feature flags
       break;
 
     case SYSEX_CMD_STATE_CONT:
@@ -664,6 +682,11 @@ static s32 BLM_SCALAR_MASTER_SYSEX_Cmd_Layout(mios32_midi_port_t port, sysex_cmd
       } else if( !sysex_state.blm.COLOURS_RECEIVED ) {
 	sysex_state.blm.COLOURS_RECEIVED = 1;
 	blm_num_colours = midi_in;
+      } else if( sysex_state.blm.EXTRA_CTR < 3 ) {
+	++sysex_state.blm.EXTRA_CTR; // number of extra rows/columns/buttons: not evaluated
+      } else if( !sysex_state.blm.FEATURES_RECEIVED ) {
+	sysex_state.blm.FEATURES_RECEIVED = 1;
+	blm_features_received = midi_in;
       }
       // ignore all other bytes
       // don't sent error message to allow future extensions
@@ -672,6 +695,7 @@ static s32 BLM_SCALAR_MASTER_SYSEX_Cmd_Layout(mios32_midi_port_t port, sysex_cmd
     default: // SYSEX_CMD_STATE_END
       // change connection state
       blm_connection_state = BLM_SCALAR_MASTER_CONNECTION_STATE_SYSEX;
+      blm_features = blm_features_received;
 
       // update BLM
       blm_force_update = 1;
@@ -798,6 +822,7 @@ s32 BLM_SCALAR_MASTER_Periodic_mS(void)
 
   if( --blm_timeout_ctr == 0 ) {
     blm_connection_state = BLM_SCALAR_MASTER_CONNECTION_STATE_IDLE;
+    blm_features = 0;
     return 0;
   }
 
@@ -831,7 +856,10 @@ s32 BLM_SCALAR_MASTER_Periodic_mS(void)
   p.cin = CC;
   p.event = CC;
 
-  {
+  if( (blm_features & SYSEX_BLM_FEATURE_LED_FRAME) && blm_connection_state == BLM_SCALAR_MASTER_CONNECTION_STATE_SYSEX ) {
+    // BLM supports run-length encoded LED frames: send changed rows via SysEx
+    BLM_SendLedFrame(force_update);
+  } else {
     int i;
     int num_rows = blm_leds_rotate_view ? BLM_SCALAR_MASTER_NUM_ROWS : blm_num_rows;
     for(i=0; i<num_rows; ++i) {
@@ -994,6 +1022,126 @@ s32 BLM_SCALAR_MASTER_Periodic_mS(void)
   return 0; // no error
 }
 
+/////////////////////////////////////////////////////////////////////////////
+//! Help function to send changed BLM16x16 rows as a run-length encoded
+//! SysEx LED frame:
+//!   F0 00 00 7E 4E <device-id> 02 <record>* F7
+//! Each record consists of 5 bytes:
+//!   <rotate*0x40 + colour*0x10 + first row> <number of rows - 1>
+//!   <pattern[6:0]> <pattern[13:7]> <pattern[15:14]>
+//! colour: 0=green, 1=red, 2=same pattern for green and red
+//! Consecutive rows with the same pattern are combined into a single record.
+//! Rows which don't fit into BLM_SCALAR_MASTER_LED_FRAME_BUDGET stay
+//! dirty and will be sent with the next frame.
+/////////////////////////////////////////////////////////////////////////////
+static s32 BLM_SendLedFrame(u8 force_update)
+{
+  u8 sysex_buffer[sizeof(blm_sysex_header) + 3 + BLM_SCALAR_MASTER_LED_FRAME_BUDGET];
+  u8 *sysex_buffer_ptr = &sysex_buffer[0];
+  u8 *records_end = &sysex_buffer[sizeof(blm_sysex_header) + 2 + BLM_SCALAR_MASTER_LED_FRAME_BUDGET];
+  u8 dirty_green[BLM_SCALAR_MASTER_NUM_ROWS];
+  u8 dirty_red[BLM_SCALAR_MASTER_NUM_ROWS];
+  int i;
+
+  int num_rows = blm_leds_rotate_view ? BLM_SCALAR_MASTER_NUM_ROWS : blm_num_rows;
+  if( num_rows > 16 )
+    num_rows = 16; // limited by 4bit row field
+
+  int num_dirty = 0;
+  for(i=0; i<num_rows; ++i) {
+    u8 led_row = i + blm_led_row_offset;
+    dirty_green[i] = force_update || blm_scalar_master_leds_green[led_row] != blm_scalar_master_leds_green_sent[led_row];
+    dirty_red[i] = force_update || blm_scalar_master_leds_red[led_row] != blm_scalar_master_leds_red_sent[led_row];
+    num_dirty += dirty_green[i] + dirty_red[i];
+  }
+
+  if( !num_dirty )
+    return 0; // nothing to send
+
+  for(i=0; i<sizeof(blm_sysex_header); ++i)
+    *sysex_buffer_ptr++ = blm_sysex_header[i];
+
+  // device ID
+  *sysex_buffer_ptr++ = sysex_device_id;
+
+  // command
+  *sysex_buffer_ptr++ = SYSEX_BLM_CMD_LED_FRAME;
+
+  // rows which have to be updated for both colours with the same pattern are sent first,
+  // thereafter the remaining green and red rows
+  int colour;
+  for(colour=BLM_LED_FRAME_COLOUR_BOTH; colour>=BLM_LED_FRAME_COLOUR_GREEN; --colour) {
+    for(i=0; i<num_rows; ++i) {
+      u8 led_row = i + blm_led_row_offset;
+      u8 both = dirty_green[i] && dirty_red[i] && blm_scalar_master_leds_green[led_row] == blm_scalar_master_leds_red[led_row];
+      u8 match = (colour == BLM_LED_FRAME_COLOUR_BOTH) ? both : (!both && ((colour == BLM_LED_FRAME_COLOUR_GREEN) ? dirty_green[i] : dirty_red[i]));
+      if( !match )
+	continue;
+
+      if( (sysex_buffer_ptr + BLM_LED_FRAME_RECORD_SIZE) > records_end )
+	break; // budget exhausted, remaining rows will be sent with next frame
+
+      u16 pattern = (colour == BLM_LED_FRAME_COLOUR_RED) ? blm_scalar_master_leds_red[led_row] : blm_scalar_master_leds_green[led_row];
+
+      // combine consecutive rows with same pattern
+      int run;
+      for(run=1; (i+run) < num_rows; ++run) {
+	int j = i + run;
+	u8 next_row = j + blm_led_row_offset;
+	u8 next_both = dirty_green[j] && dirty_red[j] && blm_scalar_master_leds_green[next_row] == blm_scalar_master_leds_red[next_row];
+	u8 next_match = (colour == BLM_LED_FRAME_COLOUR_BOTH) ? next_both : (!next_both && ((colour == BLM_LED_FRAME_COLOUR_GREEN) ? dirty_green[j] : dirty_red[j]));
+	u16 next_pattern = (colour == BLM_LED_FRAME_COLOUR_RED) ? blm_scalar_master_leds_red[next_row] : blm_scalar_master_leds_green[next_row];
+	if( !next_match || next_pattern != pattern )
+	  break;
+      }
+
+      *sysex_buffer_ptr++ = (blm_leds_rotate_view ? 0x40 : 0x00) | (colour << 4) | i;
+      *sysex_buffer_ptr++ = run - 1;
+      *sysex_buffer_ptr++ = (pattern >> 0) & 0x7f;
+      *sysex_buffer_ptr++ = (pattern >> 7) & 0x7f;
+      *sysex_buffer_ptr++ = (pattern >> 14) & 0x03;
+
+      // take over sent patterns
+      int j;
+      for(j=i; j<(i+run); ++j) {
+	u8 sent_row = j + blm_led_row_offset;
+	if( colour != BLM_LED_FRAME_COLOUR_RED ) {
+	  blm_scalar_master_leds_green_sent[sent_row] = pattern;
+	  dirty_green[j] = 0;
+	}
+	if( colour != BLM_LED_FRAME_COLOUR_GREEN ) {
+	  blm_scalar_master_leds_red_sent[sent_row] = pattern;
+	  dirty_red[j] = 0;
+	}
+      }
+
+      i += run - 1;
+    }
+  }
+
+  // send footer
+  *sysex_buffer_ptr++ = 0xf7;
+
+  // rows which haven't been sent due to the budget have to be invalidated,
+  // so that they are considered even if no additional change happens until the next frame
+  if( force_update ) {
+    for(i=0; i<num_rows; ++i) {
+      u8 led_row = i + blm_led_row_offset;
+      if( dirty_green[i] )
+	blm_scalar_master_leds_green_sent[led_row] = ~blm_scalar_master_leds_green[led_row];
+      if( dirty_red[i] )
+	blm_scalar_master_leds_red_sent[led_row] = ~blm_scalar_master_leds_red[led_row];
+    }
+  }
+
+  // finally send SysEx stream
+  BLM_SCALAR_MASTER_MUTEX_MIDIOUT_TAKE;
+  s32 status = MIOS32_MIDI_SendSysEx(blm_midi_port, (u8 *)sysex_buffer, (u32)sysex_buffer_ptr - ((u32)&sysex_buffer[0]));
+  BLM_SCALAR_MASTER_MUTEX_MIDIOUT_GIVE;
+
+  return status;
+}
+
 /////////////////////////////////////////////////////////////////////////////
 //! Help function to send MIDI packets for LED layout changes
 /////////////////////////////////////////////////////////////////////////////
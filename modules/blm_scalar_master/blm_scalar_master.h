@@ -37,6 +37,13 @@
 #define BLM_SCALAR_MASTER_NUM_COLUMNS 16
 #endif
 
+// maximum number of LED record bytes which are packed into a single SysEx LED frame
+// (only used if the BLM announced support for the frame command in its layout info)
+// rows which don't fit into the budget are sent with the next BLM_SCALAR_MASTER_Periodic_mS() call
+#ifndef BLM_SCALAR_MASTER_LED_FRAME_BUDGET
+#define BLM_SCALAR_MASTER_LED_FRAME_BUDGET 40
+#endif
+
 // enable this switch if the application supports OSC (based on osc_server module)
 #ifndef BLM_SCALAR_MASTER_OSC_SUPPORT
 #define BLM_SCALAR_MASTER_OSC_SUPPORT 0
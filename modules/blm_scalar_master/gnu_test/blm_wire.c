@@ -0,0 +1,320 @@
+// Host test of the BLM_SCALAR LED protocols
+//
+// blm_scalar_master.c is compiled on the host and connected to a BLM model
+// which decodes the CC and SysEx LED frame protocols, like
+// apps/controllers/blm_scalar does. The BLM answers the layout request
+// either without feature flags (old firmware: CC protocol) or with the LED
+// frame feature (SysEx protocol).
+//
+// Animated patterns are written into the 16x16 LED arrays, a new animation
+// frame every 40 mS, and BLM_SCALAR_MASTER_Periodic_mS() is called each mS.
+// The bytes on the wire are counted with running status, as the MIOS32 UART
+// MIDI driver sends them. At the end of each animation frame the LEDs of
+// the BLM model have to match the LEDs of the master, and no SysEx frame
+// may exceed BLM_SCALAR_MASTER_LED_FRAME_BUDGET.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "mios32.h"
+#include "blm_scalar_master.h"
+
+#define BLM_PORT       UART0
+#define NUM_FRAMES     250
+#define FRAME_MS       40
+#define DIN_BYTES_PER_S 3125 // 31250 baud, 10 bits per byte
+
+static const u8 sysex_header[6] = { 0xf0, 0x00, 0x00, 0x7e, 0x4e, 0x00 };
+
+// BLM model
+static u16 blm_green[16];
+static u16 blm_red[16];
+
+// wire statistics
+static u8  running_status;
+static u32 frame_bytes;
+static u32 tick_bytes;
+static u32 max_tick_bytes;
+static u32 max_sysex_len;
+static u32 total_bytes;
+static u32 max_frame_bytes;
+static u32 num_sysex;
+static u32 num_cc;
+
+static u32 lfsr;
+static int errors;
+
+
+// ------- MIDI stubs: the wire to the BLM -------
+static void wire_bytes(u32 count)
+{
+  frame_bytes += count;
+  tick_bytes += count;
+}
+
+s32 MIOS32_MIDI_SendPackage(mios32_midi_port_t port, mios32_midi_package_t package)
+{
+  u8 status = package.evnt0;
+
+  wire_bytes((status == running_status) ? 2 : 3);
+  running_status = status;
+
+  // BLM: CC 16..19 green, 32..35 red, channel = row
+  if( package.event == CC ) {
+    u8 cc = package.cc_number;
+    u8 pattern8 = package.value | ((cc & 1) ? 0x80 : 0x00);
+    u16 *row = NULL;
+
+    ++num_cc;
+    if( package.chn < 16 && cc >= 16 && cc <= 19 )
+      row = &blm_green[package.chn];
+    else if( package.chn < 16 && cc >= 32 && cc <= 35 )
+      row = &blm_red[package.chn];
+
+    if( row ) {
+      if( cc & 2 )
+	*row = (*row & 0x00ff) | ((u16)pattern8 << 8);
+      else
+	*row = (*row & 0xff00) | pattern8;
+    }
+  }
+
+  return 0;
+}
+
+s32 MIOS32_MIDI_SendCC(mios32_midi_port_t port, mios32_midi_chn_t chn, u8 cc, u8 val)
+{
+  mios32_midi_package_t p;
+  p.ALL = 0;
+  p.cin = CC;
+  p.event = CC;
+  p.chn = chn;
+  p.cc_number = cc;
+  p.value = val;
+  return MIOS32_MIDI_SendPackage(port, p);
+}
+
+s32 MIOS32_MIDI_SendSysEx(mios32_midi_port_t port, u8 *stream, u32 count)
+{
+  u32 i;
+
+  wire_bytes(count);
+  running_status = 0; // SysEx cancels the running status
+
+  if( count > max_sysex_len )
+    max_sysex_len = count;
+
+  // BLM: LED frame
+  if( count >= 8 && memcmp(stream, sysex_header, sizeof(sysex_header)) == 0 && stream[6] == 0x02 ) {
+    ++num_sysex;
+    if( (count - 8) % 5 ) {
+      printf("ERROR: LED frame with incomplete record\n");
+      ++errors;
+    }
+
+    for(i=7; i+5 <= count-1; i+=5) {
+      u8 colour = (stream[i] >> 4) & 0x3;
+      u8 row = stream[i] & 0xf;
+      u8 run = stream[i+1] + 1;
+      u16 pattern = stream[i+2] | ((u16)stream[i+3] << 7) | ((u16)stream[i+4] << 14);
+
+      if( row + run > 16 || colour > 2 ) {
+	printf("ERROR: invalid LED frame record\n");
+	++errors;
+	continue;
+      }
+
+      for(; run; --run, ++row) {
+	if( colour != 1 )
+	  blm_green[row] = pattern;
+	if( colour != 0 )
+	  blm_red[row] = pattern;
+      }
+    }
+  }
+
+  return 0;
+}
+
+
+// ------- BLM handshake -------
+static void blm_send(const u8 *stream, u32 count)
+{
+  u32 i;
+  for(i=0; i<count; ++i)
+    BLM_SCALAR_MASTER_SYSEX_Parser(BLM_PORT, stream[i]);
+}
+
+static void blm_layout(u8 with_features)
+{
+  // columns, rows, colours, extra rows, extra columns, extra buttons, [feature flags]
+  const u8 layout[] = { 0xf0, 0x00, 0x00, 0x7e, 0x4e, 0x00, 0x01, 16, 16, 2, 1, 1, 1, 0x01, 0xf7 };
+  const u8 layout_old[] = { 0xf0, 0x00, 0x00, 0x7e, 0x4e, 0x00, 0x01, 16, 16, 2, 1, 1, 1, 0xf7 };
+
+  if( with_features )
+    blm_send(layout, sizeof(layout));
+  else
+    blm_send(layout_old, sizeof(layout_old));
+}
+
+static void blm_ping(void)
+{
+  const u8 ping[] = { 0xf0, 0x00, 0x00, 0x7e, 0x4e, 0x00, 0x0f, 0xf7 };
+  blm_send(ping, sizeof(ping));
+}
+
+
+// ------- animations -------
+static u32 random_number(void)
+{
+  lfsr ^= lfsr << 13;
+  lfsr ^= lfsr >> 17;
+  lfsr ^= lfsr << 5;
+  return lfsr;
+}
+
+typedef enum {
+  ANIM_CURSOR,
+  ANIM_BAR,
+  ANIM_FLASH,
+  ANIM_NOISE,
+  ANIM_SEQUENCER,
+  ANIM_NUM
+} animation_t;
+
+static const char *animation_name[ANIM_NUM] = {
+  "cursor",
+  "moving bar",
+  "flash",
+  "noise",
+  "sequencer",
+};
+
+static void animate(animation_t anim, u32 frame)
+{
+  static u16 steps[16];
+  int row;
+
+  for(row=0; row<16; ++row) {
+    u16 green = 0, red = 0;
+
+    switch( anim ) {
+    case ANIM_CURSOR: // single LED which moves through the grid
+      if( row == (frame / 16) % 16 )
+	green = 1 << (frame % 16);
+      break;
+
+    case ANIM_BAR: // vertical bar with a red trail
+      green = 1 << (frame % 16);
+      red = green | (1 << ((frame + 15) % 16));
+      break;
+
+    case ANIM_FLASH: // whole screen toggles each frame
+      green = red = (frame & 1) ? 0xffff : 0x0000;
+      break;
+
+    case ANIM_NOISE:
+      green = random_number();
+      red = random_number();
+      break;
+
+    case ANIM_SEQUENCER: // step patterns which are changed sometimes, red play position
+      if( frame == 0 || (random_number() % 64) == 0 )
+	steps[row] = random_number();
+      green = steps[row];
+      red = 1 << (frame % 16);
+      break;
+
+    default:
+      break;
+    }
+
+    blm_scalar_master_leds_green[row] = green;
+    blm_scalar_master_leds_red[row] = red;
+  }
+}
+
+
+// ------- test -------
+static void run(animation_t anim, u8 with_features)
+{
+  u32 frame, ms;
+
+  BLM_SCALAR_MASTER_Init(0);
+  BLM_SCALAR_MASTER_MIDI_PortSet(0, BLM_PORT);
+  memset(blm_green, 0, sizeof(blm_green));
+  memset(blm_red, 0, sizeof(blm_red));
+  memset(blm_scalar_master_leds_green, 0, sizeof(blm_scalar_master_leds_green));
+  memset(blm_scalar_master_leds_red, 0, sizeof(blm_scalar_master_leds_red));
+  blm_layout(with_features);
+
+  // initial update of all LEDs
+  for(ms=0; ms<FRAME_MS; ++ms)
+    BLM_SCALAR_MASTER_Periodic_mS();
+
+  running_status = 0;
+  total_bytes = max_frame_bytes = max_tick_bytes = max_sysex_len = 0;
+  num_sysex = num_cc = 0;
+  lfsr = 2463534242u;
+
+  for(frame=0; frame<NUM_FRAMES; ++frame) {
+    animate(anim, frame);
+    frame_bytes = 0;
+
+    if( (frame % 25) == 0 )
+      blm_ping(); // keep the connection alive
+
+    for(ms=0; ms<FRAME_MS; ++ms) {
+      tick_bytes = 0;
+      BLM_SCALAR_MASTER_Periodic_mS();
+      if( tick_bytes > max_tick_bytes )
+	max_tick_bytes = tick_bytes;
+    }
+
+    total_bytes += frame_bytes;
+    if( frame_bytes > max_frame_bytes )
+      max_frame_bytes = frame_bytes;
+
+    if( memcmp(blm_green, blm_scalar_master_leds_green, sizeof(blm_green)) != 0 ||
+	memcmp(blm_red, blm_scalar_master_leds_red, sizeof(blm_red)) != 0 ) {
+      printf("ERROR: %s: BLM LEDs differ from the master after frame %u\n", animation_name[anim], frame);
+      ++errors;
+      break;
+    }
+  }
+
+  printf("%-12s %-6s %8.1f %6u %9.1f %8u %8u %6u %7u\n",
+	 animation_name[anim], with_features ? "SysEx" : "CC",
+	 (double)total_bytes / NUM_FRAMES, max_frame_bytes,
+	 100.0 * total_bytes / (NUM_FRAMES * FRAME_MS * DIN_BYTES_PER_S / 1000.0),
+	 max_tick_bytes, max_sysex_len, num_sysex, num_cc);
+
+  // header, device id, command, records, F7
+  if( max_sysex_len > sizeof(sysex_header) + 2 + BLM_SCALAR_MASTER_LED_FRAME_BUDGET ) {
+    printf("ERROR: LED frame exceeds the byte budget\n");
+    ++errors;
+  }
+}
+
+
+int main(int argc, char *argv[])
+{
+  animation_t anim;
+
+  printf("%d frames of %d mS, LED frame budget %d bytes\n", NUM_FRAMES, FRAME_MS, BLM_SCALAR_MASTER_LED_FRAME_BUDGET);
+  printf("%-12s %-6s %8s %6s %9s %8s %8s %6s %7s\n",
+	 "animation", "proto", "B/frame", "max", "DIN load%", "max B/mS", "max SysEx", "SysEx", "CCs");
+
+  for(anim=0; anim<ANIM_NUM; ++anim) {
+    run(anim, 0);
+    run(anim, 1);
+  }
+
+  if( errors ) {
+    printf("%d errors\n", errors);
+    return 1;
+  }
+
+  printf("BLM wire test passed.\n");
+  return 0;
+}
@@ -0,0 +1,91 @@
+// minimal MIOS32 environment to compile blm_scalar_master.c on the host
+#ifndef _MIOS32_H
+#define _MIOS32_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+typedef uint8_t  u8;
+typedef uint16_t u16;
+typedef uint32_t u32;
+typedef uint64_t u64;
+typedef int8_t   s8;
+typedef int16_t  s16;
+typedef int32_t  s32;
+
+typedef enum {
+  DEFAULT = 0x00,
+  USB0 = 0x10,
+  UART0 = 0x20,
+  UART1 = 0x21,
+  OSC0 = 0x40,
+} mios32_midi_port_t;
+
+typedef enum {
+  Chn1, Chn2, Chn3, Chn4, Chn5, Chn6, Chn7, Chn8,
+  Chn9, Chn10, Chn11, Chn12, Chn13, Chn14, Chn15, Chn16
+} mios32_midi_chn_t;
+
+typedef enum {
+  NoteOff       = 0x8,
+  NoteOn        = 0x9,
+  PolyPressure  = 0xa,
+  CC            = 0xb,
+  ProgramChange = 0xc,
+  Aftertouch    = 0xd,
+  PitchBend     = 0xe
+} mios32_midi_event_t;
+
+typedef union {
+  u32 ALL;
+  struct {
+    u8 cin_cable;
+    u8 evnt0;
+    u8 evnt1;
+    u8 evnt2;
+  };
+  struct {
+    u8 type:4;
+    u8 cable:4;
+    u8 chn:4;
+    u8 event:4;
+    u8 value1;
+    u8 value2;
+  };
+  struct {
+    u8 cin:4;
+    u8 dummy1_cable:4;
+    u8 dummy1_chn:4;
+    u8 dummy1_event:4;
+    u8 note;
+    u8 velocity;
+  };
+  struct {
+    u8 dummy2_cin_cable;
+    u8 dummy2_chn:4;
+    u8 dummy2_event:4;
+    u8 cc_number;
+    u8 value;
+  };
+} mios32_midi_package_t;
+
+// command states
+typedef enum {
+  MIOS32_MIDI_SYSEX_CMD_STATE_BEGIN,
+  MIOS32_MIDI_SYSEX_CMD_STATE_CONT,
+  MIOS32_MIDI_SYSEX_CMD_STATE_END
+} mios32_midi_sysex_cmd_state_t;
+
+#define MIOS32_MIDI_SYSEX_DISACK   0x0e
+#define MIOS32_MIDI_SYSEX_ACK      0x0f
+#define MIOS32_MIDI_SYSEX_DISACK_INVALID_COMMAND 0x0e
+
+#define MIOS32_IRQ_Disable() do {} while(0)
+#define MIOS32_IRQ_Enable()  do {} while(0)
+
+extern s32 MIOS32_MIDI_SendPackage(mios32_midi_port_t port, mios32_midi_package_t package);
+extern s32 MIOS32_MIDI_SendCC(mios32_midi_port_t port, mios32_midi_chn_t chn, u8 cc, u8 val);
+extern s32 MIOS32_MIDI_SendSysEx(mios32_midi_port_t port, u8 *stream, u32 count);
+
+#endif /* _MIOS32_H */
@@ -0,0 +1 @@
+// blm_scalar_master.h includes the application configuration, the defaults are used
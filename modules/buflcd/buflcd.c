@@ -20,6 +20,10 @@
 //!
 //! BUFLCD_Update() has to be called periodically from a low-priority task!
 //!
+//! If the GLCD framebuffer of the app_lcd driver is enabled (APP_LCD_FRAMEBUFFER_NUM_DEVICES),
+//! characters are only rendered into RAM, and BUFLCD_Update() flushes the changed
+//! pixel columns to the displays at the end.
+//!
 //! Usage examples:\n
 //!   $MIOS32_PATH/apps/controllers/midibox_lc\n
 //!   $MIOS32_PATH/apps/controllers/midibox_mm
@@ -41,6 +45,7 @@
 #include <mios32.h>
 #include <stdarg.h>
 #include <string.h>
+#include <app_lcd.h>
 
 #if BUFLCD_SUPPORT_GLCD_FONTS
 #include <glcd_font.h>
@@ -478,6 +483,12 @@ s32 BUFLCD_Update(u8 force)
     }
   }
 
+#if APP_LCD_FRAMEBUFFER_NUM_DEVICES
+  // transfer changed pixel columns
+  if( MIOS32_LCD_TypeIsGLCD() )
+    APP_LCD_FrameBufferFlush(force);
+#endif
+
   return 0; // no error
 }
 
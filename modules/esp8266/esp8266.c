@@ -45,6 +45,10 @@ static char com_line_buffer[LINE_BUFFER_LEN];
 static u16 com_line_ix;
 
 static u32 com_timestamp_last_access;
+static u8 com_receiving_slip; // 0: text line, 1: SLIP frame, 2: SLIP escape
+
+static u8 slip_tx_buffer[ESP8266_SLIP_TX_BUFFER_SIZE];
+static u16 slip_tx_buffer_len;
 
 static s32 (*udp_rx_callback_func)(u32 ip, u16 udp, u8 *payload, u32 len);
 
@@ -55,6 +59,7 @@ static s32 (*udp_rx_callback_func)(u32 ip, u16 udp, u8 *payload, u32 len);
 
 static s32 ESP8266_COM_Parse(mios32_midi_port_t port, char byte);
 static s32 ESP8266_COM_ParseLine(char *input, void *_output_function);
+static s32 ESP8266_COM_TxFlush(void);
 
 
 /////////////////////////////////////////////////////////////////////////////
@@ -76,6 +81,8 @@ s32 ESP8266_Init(u32 mode)
   com_line_buffer[0] = 0;
   com_line_ix = 0;
   com_timestamp_last_access = 0;
+  com_receiving_slip = 0;
+  slip_tx_buffer_len = 0;
 
   // install the callback function which is called on incoming characters
   // from COM port
@@ -97,10 +104,16 @@ s32 ESP8266_Periodic_mS(void)
   ESP8266_FW_Periodic_mS();
 #endif
 
+#if ESP8266_SLIP_TX_BATCHING
+  // transfer collected UDP packets
+  ESP8266_COM_Flush();
+#endif
+
   {
     u32 timestamp = MIOS32_TIMESTAMP_Get();
     if( com_line_ix > 0 && (timestamp - com_timestamp_last_access) > 1000 ) {
       com_line_ix = 0;
+      com_receiving_slip = 0;
 #if 0
       DEBUG_MSG("[ESP8266] COM timeout detected!\n");
 #endif
@@ -204,56 +217,75 @@ static s32 get_dec(char *word)
 
 
 /////////////////////////////////////////////////////////////////////////////
-//! COM Parser
+// SLIP decoder for a single byte
 /////////////////////////////////////////////////////////////////////////////
-s32 ESP8266_COM_Parse(mios32_midi_port_t port, char byte)
+static s32 ESP8266_COM_ParseSlip(u8 byte)
 {
-  static u8 receiving_slip = 0;
-
-  if( !dev_uart || port != dev_uart )
-    return -1; // ignore messages from other UARTs
-
-  //DEBUG_MSG("R 0x%02x (%c)\n", byte, byte);
-
-  com_timestamp_last_access = MIOS32_TIMESTAMP_Get();
-
   if( byte == 0xbf ) { // SLIP start
-    receiving_slip = 1;
+    com_receiving_slip = 1;
     com_line_ix = 0;
   } else if( byte == 0xc0 ) { // SLIP end
-    receiving_slip = 0;
+    com_receiving_slip = 0;
+
+    if( com_line_ix < 6 ) {
+      com_line_ix = 0;
+      return -1; // incomplete header
+    }
 
-    u32 ip = ((u32)com_line_buffer[0] << 0) |
-             ((u32)com_line_buffer[1] << 8) |
-             ((u32)com_line_buffer[2] << 16) |
-             ((u32)com_line_buffer[3] << 24);
-    u16 port = ((u32)com_line_buffer[4] << 0) |
-               ((u32)com_line_buffer[5] << 8);
+    // (u8) casts: com_line_buffer is a char array, which is signed on some compilers
+    u32 ip = ((u32)(u8)com_line_buffer[0] << 0) |
+             ((u32)(u8)com_line_buffer[1] << 8) |
+             ((u32)(u8)com_line_buffer[2] << 16) |
+             ((u32)(u8)com_line_buffer[3] << 24);
+    u16 port = ((u32)(u8)com_line_buffer[4] << 0) |
+               ((u32)(u8)com_line_buffer[5] << 8);
 
     // forward packet to hook
     if( udp_rx_callback_func )
       udp_rx_callback_func(ip, port, (u8 *)&com_line_buffer[6], com_line_ix-6);
 
     com_line_ix = 0;
-  } else if( receiving_slip ) {
-    if( byte == 0xdb ) {
-      receiving_slip = 2; // escape
-    } else if( receiving_slip == 2 ) {
-      if( byte == 0xdd ) {
-	if( com_line_ix < LINE_BUFFER_LEN )
-	  com_line_buffer[com_line_ix++] = 0xdb;
-      } else if( byte == 0xdc ) {
-	if( com_line_ix < LINE_BUFFER_LEN )
-	  com_line_buffer[com_line_ix++] = 0xc0;
-      } else if( byte == 0xda ) {
-	if( com_line_ix < LINE_BUFFER_LEN )
-	  com_line_buffer[com_line_ix++] = 0xbf;
-      }
-      receiving_slip = 1;
-    } else {
+  } else if( com_receiving_slip == 2 ) {
+    if( byte == 0xdd ) {
+      if( com_line_ix < LINE_BUFFER_LEN )
+	com_line_buffer[com_line_ix++] = 0xdb;
+    } else if( byte == 0xdc ) {
+      if( com_line_ix < LINE_BUFFER_LEN )
+	com_line_buffer[com_line_ix++] = 0xc0;
+    } else if( byte == 0xda ) {
       if( com_line_ix < LINE_BUFFER_LEN )
-	com_line_buffer[com_line_ix++] = byte;
+	com_line_buffer[com_line_ix++] = 0xbf;
     }
+    com_receiving_slip = 1;
+  } else if( byte == 0xdb ) {
+    com_receiving_slip = 2; // escape
+  } else if( com_line_ix < LINE_BUFFER_LEN ) {
+    com_line_buffer[com_line_ix++] = byte;
+  }
+
+  return 0; // no error
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//! COM Parser
+/////////////////////////////////////////////////////////////////////////////
+s32 ESP8266_COM_Parse(mios32_midi_port_t port, char byte)
+{
+  if( !dev_uart || port != dev_uart )
+    return -1; // ignore messages from other UARTs
+
+  //DEBUG_MSG("R 0x%02x (%c)\n", byte, byte);
+
+  com_timestamp_last_access = MIOS32_TIMESTAMP_Get();
+
+  if( com_receiving_slip || (u8)byte == 0xbf ) {
+    ESP8266_COM_ParseSlip(byte);
+
+    // fetch the remaining bytes of the frame directly from the UART Rx buffer,
+    // this bypasses the per-byte callback of MIOS32_COM_Receive_Handler()
+    s32 b;
+    while( com_receiving_slip && (b=MIOS32_UART_RxBufferGet(dev_uart & 0xf)) >= 0 )
+      ESP8266_COM_ParseSlip(b);
   } else {
     if( byte == '\r' ) {
       // ignore
@@ -331,12 +363,63 @@ s32 ESP8266_SendCommand(const char* cmd)
 }
 
 
+/////////////////////////////////////////////////////////////////////////////
+// Copies the SLIP buffer into the UART Tx buffer
+// Has to be called with ESP8266_MUTEX_TX_TAKE
+/////////////////////////////////////////////////////////////////////////////
+static s32 ESP8266_COM_TxFlush(void)
+{
+  s32 status = 0;
+  u8 *ptr = slip_tx_buffer;
+  u16 len = slip_tx_buffer_len;
+
+  // the UART Tx buffer can't take more than MIOS32_UART_TX_BUFFER_SIZE-1 bytes at once,
+  // use half of its size so that the interrupt handler can transmit while we are waiting
+  while( len && status >= 0 ) {
+    u16 block_len = (len > (MIOS32_UART_TX_BUFFER_SIZE/2)) ? (MIOS32_UART_TX_BUFFER_SIZE/2) : len;
+    status = MIOS32_COM_SendBuffer(dev_uart, ptr, block_len);
+    ptr += block_len;
+    len -= block_len;
+  }
+
+  slip_tx_buffer_len = 0;
+
+  return status;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//! Transfers all UDP packets which have been collected in the SLIP buffer
+//! Only required if ESP8266_SLIP_TX_BATCHING is enabled, it's called
+//! periodically from ESP8266_Periodic_mS() in this case.
+//! \return < 0 on errors
+/////////////////////////////////////////////////////////////////////////////
+s32 ESP8266_COM_Flush(void)
+{
+  if( !dev_uart )
+    return -1; // no device selected
+
+  s32 status = 0;
+  ESP8266_MUTEX_TX_TAKE;
+  if( slip_tx_buffer_len )
+    status = ESP8266_COM_TxFlush();
+  ESP8266_MUTEX_TX_GIVE;
+
+  return status;
+}
+
 /////////////////////////////////////////////////////////////////////////////
 //! Sends a SLIP (propritary) Start Frame
 /////////////////////////////////////////////////////////////////////////////
 static s32 ESP8266_COM_SendSlipFrameStart(void)
 {
-  return MIOS32_COM_SendChar(dev_uart, 0xbf);
+  s32 status = 0;
+
+  if( slip_tx_buffer_len >= ESP8266_SLIP_TX_BUFFER_SIZE )
+    status = ESP8266_COM_TxFlush();
+
+  slip_tx_buffer[slip_tx_buffer_len++] = 0xbf;
+
+  return status;
 }
 
 /////////////////////////////////////////////////////////////////////////////
@@ -344,32 +427,52 @@ static s32 ESP8266_COM_SendSlipFrameStart(void)
 /////////////////////////////////////////////////////////////////////////////
 static s32 ESP8266_COM_SendSlipFrameEnd(void)
 {
-  return MIOS32_COM_SendChar(dev_uart, 0xc0);
+  s32 status = 0;
+
+  if( slip_tx_buffer_len >= ESP8266_SLIP_TX_BUFFER_SIZE )
+    status = ESP8266_COM_TxFlush();
+
+  slip_tx_buffer[slip_tx_buffer_len++] = 0xc0;
+
+  return status;
 }
 
 /////////////////////////////////////////////////////////////////////////////
 //! Sends data with SLIP protocol
+//! The data is encoded into the SLIP buffer, which is transfered to the
+//! UART whenever it's full
 /////////////////////////////////////////////////////////////////////////////
 static s32 ESP8266_COM_SendSlipData(u8 *payload, u32 len)
 {
   s32 status = 0;
+  u8 *ptr = &slip_tx_buffer[slip_tx_buffer_len];
+  u8 *ptr_end = &slip_tx_buffer[ESP8266_SLIP_TX_BUFFER_SIZE-1]; // reserve one byte for escape sequences
 
   u32 i;
   for(i=0; i<len; ++i, ++payload) {
-    if( *payload == 0xdb ) { // escape
-      status |= MIOS32_COM_SendChar(dev_uart, 0xdb);
-      status |= MIOS32_COM_SendChar(dev_uart, 0xdd);
-    } else if( *payload == 0xc0 ) { // frame end
-      status |= MIOS32_COM_SendChar(dev_uart, 0xdb);
-      status |= MIOS32_COM_SendChar(dev_uart, 0xdc);
-    } else if( *payload == 0xbf ) { // (non-standard) frame begin
-      status |= MIOS32_COM_SendChar(dev_uart, 0xdb);
-      status |= MIOS32_COM_SendChar(dev_uart, 0xda);
+    if( ptr >= ptr_end ) {
+      slip_tx_buffer_len = ptr - slip_tx_buffer;
+      status |= ESP8266_COM_TxFlush();
+      ptr = slip_tx_buffer;
+    }
+
+    u8 b = *payload;
+    if( b == 0xdb ) { // escape
+      *ptr++ = 0xdb;
+      *ptr++ = 0xdd;
+    } else if( b == 0xc0 ) { // frame end
+      *ptr++ = 0xdb;
+      *ptr++ = 0xdc;
+    } else if( b == 0xbf ) { // (non-standard) frame begin
+      *ptr++ = 0xdb;
+      *ptr++ = 0xda;
     } else {
-      status |= MIOS32_COM_SendChar(dev_uart, *payload);
+      *ptr++ = b;
     }
   }
 
+  slip_tx_buffer_len = ptr - slip_tx_buffer;
+
   return status;
 }
 
@@ -384,34 +487,38 @@ static s32 ESP8266_COM_SendSlipData(u8 *payload, u32 len)
 /////////////////////////////////////////////////////////////////////////////
 s32 ESP8266_COM_SendUdpPacket(u32 ip, u16 port, u8 *payload, u16 len)
 {
-  ESP8266_COM_SendSlipFrameStart();
+  if( !dev_uart )
+    return -1; // no device selected
 
-  // IP Address
-  {
-    u32 v = ip;
-    int i;
-    for(i=0; i<4; ++i, v >>= 8) {
-      u8 b = v;
-      ESP8266_COM_SendSlipData(&b, 1);
-    }
-  }
-  
-  // IP Port
+  s32 status = 0;
+  ESP8266_MUTEX_TX_TAKE;
+
+  status |= ESP8266_COM_SendSlipFrameStart();
+
+  // IP Address and Port
   {
-    u16 v = port;
-    int i;
-    for(i=0; i<2; ++i, v >>= 8) {
-      u8 b = v;
-      ESP8266_COM_SendSlipData(&b, 1);
-    }
+    u8 header[6];
+    header[0] = ip >> 0;
+    header[1] = ip >> 8;
+    header[2] = ip >> 16;
+    header[3] = ip >> 24;
+    header[4] = port >> 0;
+    header[5] = port >> 8;
+    status |= ESP8266_COM_SendSlipData(header, 6);
   }
-    
+
   // Payload
-  ESP8266_COM_SendSlipData(payload, len);
+  status |= ESP8266_COM_SendSlipData(payload, len);
 
-  ESP8266_COM_SendSlipFrameEnd();
+  status |= ESP8266_COM_SendSlipFrameEnd();
 
-  return 0; // no error
+#if !ESP8266_SLIP_TX_BATCHING
+  status |= ESP8266_COM_TxFlush();
+#endif
+
+  ESP8266_MUTEX_TX_GIVE;
+
+  return status;
 }
 
 /////////////////////////////////////////////////////////////////////////////
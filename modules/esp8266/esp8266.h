@@ -35,6 +35,27 @@ extern "C" {
 #define ESP8266_MUTEX_MIDIOUT_GIVE { }
 #endif
 
+//! size of the buffer in which outgoing SLIP frames are encoded before they
+//! are copied into the UART Tx buffer
+#ifndef ESP8266_SLIP_TX_BUFFER_SIZE
+#define ESP8266_SLIP_TX_BUFFER_SIZE 256
+#endif
+
+//! if enabled, outgoing UDP packets are collected in the SLIP buffer and
+//! transfered with ESP8266_Periodic_mS() or if the buffer is full
+#ifndef ESP8266_SLIP_TX_BATCHING
+#define ESP8266_SLIP_TX_BATCHING 0
+#endif
+
+//! should be assigned in mios32_config.h if ESP8266_COM_SendUdpPacket() is
+//! called from different tasks, or if batching is enabled
+#ifndef ESP8266_MUTEX_TX_TAKE
+#define ESP8266_MUTEX_TX_TAKE { }
+#endif
+#ifndef ESP8266_MUTEX_TX_GIVE
+#define ESP8266_MUTEX_TX_GIVE { }
+#endif
+
 
 /////////////////////////////////////////////////////////////////////////////
 // Prototypes
@@ -57,6 +78,7 @@ extern s32 ESP8266_TerminalParseLine(char *input, void *_output_function);
 
 extern s32 ESP8266_SendCommand(const char* cmd);
 extern s32 ESP8266_COM_SendUdpPacket(u32 ip, u16 port, u8 *payload, u16 len);
+extern s32 ESP8266_COM_Flush(void);
 
 
 /////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,419 @@
+// Host test of the ESP8266 SLIP link with a simulated WiFi bridge
+//
+// esp8266.c is compiled on the host, and its UART is a pseudo terminal.
+// The MIOS32 side works on the master end: MIOS32_COM_SendBuffer() and
+// MIOS32_COM_SendChar() write into it, and received bytes are polled into a
+// Rx buffer of MIOS32_UART_RX_BUFFER_SIZE bytes. The MIOS32_COM_Receive_Handler
+// is emulated: it forwards each byte of the Rx buffer to the callback which
+// has been installed with MIOS32_COM_ReceiveCallback_Init(), and
+// ESP8266_COM_Parse() fetches the remaining bytes of a SLIP frame with
+// MIOS32_UART_RxBufferGet().
+//
+// A thread plays the MBHP_WIFI_BRIDGE firmware on the slave end: it decodes
+// the SLIP frames (0xbf start, 0xc0 end, 0xdb escape), and sends each UDP
+// packet back as SLIP frame, as if a remote host would echo it. A text line
+// is sent before the first packet.
+//
+// The test sends packets with random IPs, ports and payloads which contain
+// the SLIP control characters, and each packet has to be received again by
+// the UDP Rx callback. At most WINDOW packets are in flight, so that the
+// pseudo terminal never blocks both threads.
+//
+// Measured are the round trip packets per second, the host CPU time of the
+// MIOS32 side per packet (without the read/write system calls), and the
+// UART driver calls per packet: MIOS32_COM_SendBuffer() calls on the Tx
+// side, callbacks of the receive handler on the Rx side. The makefile builds
+// this test without and with ESP8266_SLIP_TX_BATCHING; with batching the
+// packets are transfered by ESP8266_Periodic_mS(), which is called once per
+// loop iteration.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <pty.h>
+#include <termios.h>
+#include "mios32.h"
+#include "esp8266.h"
+
+#define NUM_PACKETS  100000
+#define WINDOW       16
+#define MAX_PAYLOAD  64
+#define ESP_UART     UART0
+
+typedef struct {
+  u32 ip;
+  u16 port;
+  u16 len;
+  u8  payload[MAX_PAYLOAD];
+} packet_t;
+
+static int fd_master;
+static int fd_slave;
+
+// MIOS32 side
+static s32 (*receive_callback)(mios32_com_port_t port, char byte);
+static u8  rx_buffer[MIOS32_UART_RX_BUFFER_SIZE];
+static u32 rx_head, rx_tail;
+
+static packet_t sent[WINDOW];
+static u32 num_sent;
+static u32 num_received;
+
+static u32 tx_calls;
+static u32 tx_bytes;
+static u32 rx_bytes;
+static u32 rx_callbacks;
+static u32 debug_lines;
+static u64 io_ns; // CPU time of the system calls, excluded from the driver time
+
+// bridge
+static u32 bridge_packets;
+static u32 bridge_errors;
+
+static u32 lfsr;
+static int errors;
+
+
+// ------- helpers -------
+static u64 thread_cpu_ns(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+  return (u64)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static u64 now_ns(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (u64)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static u32 random_number(void)
+{
+  lfsr ^= lfsr << 13;
+  lfsr ^= lfsr >> 17;
+  lfsr ^= lfsr << 5;
+  return lfsr;
+}
+
+static void write_all(int fd, const u8 *buffer, u32 len)
+{
+  while( len ) {
+    ssize_t n = write(fd, buffer, len);
+    if( n < 0 ) {
+      perror("write");
+      exit(1);
+    }
+    buffer += n;
+    len -= n;
+  }
+}
+
+
+// ------- MIOS32 stubs -------
+s32 MIOS32_UART_InitPort(u8 uart, u32 baudrate, u32 tx_pin_mode, u8 is_midi) { return 0; }
+s32 MIOS32_UART_InitPortDefault(u8 uart) { return 0; }
+u32 MIOS32_UART_BaudrateGet(u8 uart) { return 115200; }
+u32 MIOS32_TIMESTAMP_Get(void) { return 0; }
+s32 MIOS32_MIDI_SendDebugHexDump(const u8 *src, u32 len) { return 0; }
+
+void test_debug_msg(char *format, ...)
+{
+  ++debug_lines;
+}
+
+s32 MIOS32_COM_ReceiveCallback_Init(void *callback_receive)
+{
+  receive_callback = callback_receive;
+  return 0;
+}
+
+s32 MIOS32_COM_SendBuffer(mios32_com_port_t port, u8 *buffer, u16 len)
+{
+  u64 t = thread_cpu_ns();
+
+  if( len >= MIOS32_UART_TX_BUFFER_SIZE ) {
+    printf("ERROR: %d bytes don't fit into the UART Tx buffer\n", len);
+    ++errors;
+  }
+
+  ++tx_calls;
+  tx_bytes += len;
+  write_all(fd_master, buffer, len);
+  io_ns += thread_cpu_ns() - t;
+  return 0;
+}
+
+s32 MIOS32_COM_SendChar(mios32_com_port_t port, char c)
+{
+  return MIOS32_COM_SendBuffer(port, (u8 *)&c, 1);
+}
+
+s32 MIOS32_COM_SendString(mios32_com_port_t port, const char *str)
+{
+  return MIOS32_COM_SendBuffer(port, (u8 *)str, strlen(str));
+}
+
+s32 MIOS32_UART_RxBufferGet(u8 uart)
+{
+  if( rx_tail == rx_head )
+    return -1; // no new byte received
+
+  ++rx_bytes;
+  return rx_buffer[rx_tail++ % MIOS32_UART_RX_BUFFER_SIZE];
+}
+
+// fills the Rx buffer like the UART interrupt does
+static void uart_rx_poll(int timeout_ms)
+{
+  u8 buffer[MIOS32_UART_RX_BUFFER_SIZE];
+  u32 free_bytes = MIOS32_UART_RX_BUFFER_SIZE - (rx_head - rx_tail);
+  struct pollfd pfd;
+  u64 t;
+  ssize_t n, i;
+
+  if( !free_bytes )
+    return;
+
+  t = thread_cpu_ns();
+  pfd.fd = fd_master;
+  pfd.events = POLLIN;
+  if( poll(&pfd, 1, timeout_ms) > 0 ) {
+    n = read(fd_master, buffer, free_bytes);
+    for(i=0; i<n; ++i)
+      rx_buffer[rx_head++ % MIOS32_UART_RX_BUFFER_SIZE] = buffer[i];
+  }
+  io_ns += thread_cpu_ns() - t;
+}
+
+// like MIOS32_COM_Receive_Handler()
+static void com_receive_handler(void)
+{
+  s32 b;
+
+  while( (b=MIOS32_UART_RxBufferGet(ESP_UART & 0xf)) >= 0 ) {
+    ++rx_callbacks;
+    if( receive_callback )
+      receive_callback(ESP_UART, b);
+  }
+}
+
+static s32 udp_rx(u32 ip, u16 port, u8 *payload, u32 len)
+{
+  packet_t *p = &sent[num_received % WINDOW];
+
+  if( num_received >= num_sent ) {
+    printf("ERROR: received packet which hasn't been sent\n");
+    ++errors;
+    return -1;
+  }
+
+  if( ip != p->ip || port != p->port || len != p->len || memcmp(payload, p->payload, len) != 0 ) {
+    if( errors < 10 )
+      printf("ERROR: packet #%u: got %08x:%u with %u bytes, expected %08x:%u with %u bytes\n",
+	     num_received, ip, port, len, p->ip, p->port, p->len);
+    ++errors;
+  }
+
+  ++num_received;
+  return 0;
+}
+
+
+// ------- simulated MBHP_WIFI_BRIDGE -------
+static u32 bridge_encode(u8 *dst, const u8 *src, u32 len)
+{
+  u8 *ptr = dst;
+  u32 i;
+
+  *ptr++ = 0xbf;
+  for(i=0; i<len; ++i) {
+    u8 b = src[i];
+    if( b == 0xdb ) {
+      *ptr++ = 0xdb; *ptr++ = 0xdd;
+    } else if( b == 0xc0 ) {
+      *ptr++ = 0xdb; *ptr++ = 0xdc;
+    } else if( b == 0xbf ) {
+      *ptr++ = 0xdb; *ptr++ = 0xda;
+    } else {
+      *ptr++ = b;
+    }
+  }
+  *ptr++ = 0xc0;
+
+  return ptr - dst;
+}
+
+static void *bridge_thread(void *arg)
+{
+  u8 packet[6+MAX_PAYLOAD]; // IP, port, payload
+  u8 frame[2*sizeof(packet) + 2];
+  u8 buffer[256];
+  u32 len = 0;
+  u8 in_frame = 0;
+  u8 escape = 0;
+
+  write_all(fd_slave, (u8 *)"WIFI bridge ready\r\n", 19);
+
+  while( bridge_packets < NUM_PACKETS ) {
+    ssize_t n = read(fd_slave, buffer, sizeof(buffer));
+    ssize_t i;
+
+    if( n <= 0 )
+      break;
+
+    for(i=0; i<n; ++i) {
+      u8 b = buffer[i];
+
+      if( b == 0xbf ) {
+	in_frame = 1;
+	escape = 0;
+	len = 0;
+      } else if( !in_frame ) {
+	++bridge_errors; // garbage between frames
+      } else if( b == 0xc0 ) {
+	// the remote host echoes the packet
+	if( escape || len < 7 )
+	  ++bridge_errors;
+	else
+	  write_all(fd_slave, frame, bridge_encode(frame, packet, len));
+	in_frame = 0;
+	++bridge_packets;
+      } else if( escape ) {
+	if( b == 0xdd )
+	  b = 0xdb;
+	else if( b == 0xdc )
+	  b = 0xc0;
+	else if( b == 0xda )
+	  b = 0xbf;
+	else
+	  ++bridge_errors; // invalid escape sequence
+	escape = 0;
+	if( len < sizeof(packet) )
+	  packet[len++] = b;
+      } else if( b == 0xdb ) {
+	escape = 1;
+      } else if( b == 0xbf || b == 0xc0 ) {
+	++bridge_errors;
+      } else if( len < sizeof(packet) ) {
+	packet[len++] = b;
+      } else {
+	++bridge_errors; // packet too long
+      }
+    }
+  }
+
+  return NULL;
+}
+
+
+// ------- test -------
+static void send_packet(void)
+{
+  packet_t *p = &sent[num_sent % WINDOW];
+  static const u8 special[4] = { 0xbf, 0xc0, 0xdb, 0xdd };
+  u32 i;
+
+  p->ip = random_number();
+  p->port = random_number();
+  p->len = 1 + random_number() % MAX_PAYLOAD;
+  for(i=0; i<p->len; ++i) {
+    u32 r = random_number();
+    p->payload[i] = ((r & 0xff) < 16) ? special[(r >> 8) & 3] : (r >> 16);
+  }
+
+  ++num_sent;
+  ESP8266_COM_SendUdpPacket(p->ip, p->port, p->payload, p->len);
+}
+
+int main(int argc, char *argv[])
+{
+  struct termios tio;
+  pthread_t bridge;
+  u64 t_wall, t_cpu;
+  u32 payload_bytes = 0;
+
+  if( openpty(&fd_master, &fd_slave, NULL, NULL, NULL) < 0 ) {
+    perror("openpty");
+    return 1;
+  }
+  tcgetattr(fd_slave, &tio);
+  cfmakeraw(&tio);
+  tcsetattr(fd_slave, TCSANOW, &tio);
+
+  lfsr = 2463534242u;
+  ESP8266_Init(0);
+  ESP8266_InitUart(ESP_UART, 115200);
+  ESP8266_UdpRxCallback_Init(udp_rx);
+
+  if( pthread_create(&bridge, NULL, bridge_thread, NULL) != 0 ) {
+    perror("pthread_create");
+    return 1;
+  }
+
+  t_wall = now_ns();
+  t_cpu = thread_cpu_ns();
+
+  while( num_received < NUM_PACKETS ) {
+    u32 received = num_received;
+
+    while( num_sent < NUM_PACKETS && (num_sent - num_received) < WINDOW ) {
+      send_packet();
+      payload_bytes += sent[(num_sent-1) % WINDOW].len;
+    }
+
+    // 1 mS tick, transfers the batched packets
+    ESP8266_Periodic_mS();
+
+    uart_rx_poll(1000);
+    com_receive_handler();
+
+    if( received == num_received && rx_head == rx_tail && num_sent == num_received ) {
+      printf("ERROR: the link stalled after %u packets\n", num_received);
+      ++errors;
+      break;
+    }
+  }
+
+  t_cpu = thread_cpu_ns() - t_cpu;
+  t_wall = now_ns() - t_wall;
+  pthread_join(bridge, NULL);
+
+  printf("%s: %u packets, %.1f payload bytes per packet, window %d\n",
+	 ESP8266_SLIP_TX_BATCHING ? "Tx batching" : "no Tx batching",
+	 NUM_PACKETS, (double)payload_bytes / NUM_PACKETS, WINDOW);
+  printf("round trip:          %9.0f packets/s\n", NUM_PACKETS / (t_wall / 1e9));
+  printf("driver CPU:          %9.2f uS per packet (host, without system calls)\n",
+	 (t_cpu > io_ns) ? (double)(t_cpu - io_ns) / 1000.0 / NUM_PACKETS : 0.0);
+  printf("Tx bytes:            %9.1f per packet\n", (double)tx_bytes / NUM_PACKETS);
+  printf("Tx SendBuffer calls: %9.2f per packet\n", (double)tx_calls / NUM_PACKETS);
+  printf("Rx bytes:            %9.1f per packet\n", (double)rx_bytes / NUM_PACKETS);
+  printf("Rx handler callbacks:%9.2f per packet\n", (double)rx_callbacks / NUM_PACKETS);
+  printf("UART limit:          %9.0f packets/s at 115200, %.0f at 921600 baud\n",
+	 11520.0 * NUM_PACKETS / tx_bytes, 92160.0 * NUM_PACKETS / tx_bytes);
+
+  if( debug_lines != 1 ) {
+    printf("ERROR: %u text lines received, expected 1\n", debug_lines);
+    ++errors;
+  }
+
+  if( bridge_errors ) {
+    printf("ERROR: bridge received %u invalid SLIP bytes\n", bridge_errors);
+    ++errors;
+  }
+
+  if( errors ) {
+    printf("%d errors\n", errors);
+    return 1;
+  }
+
+  printf("ESP8266 bridge test passed.\n");
+  return 0;
+}
@@ -0,0 +1,48 @@
+// minimal MIOS32 environment to compile esp8266.c on the host, see esp_bridge.c
+#ifndef _MIOS32_H
+#define _MIOS32_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+typedef uint8_t  u8;
+typedef uint16_t u16;
+typedef uint32_t u32;
+typedef uint64_t u64;
+typedef int8_t   s8;
+typedef int16_t  s16;
+typedef int32_t  s32;
+
+typedef enum {
+  DEFAULT = 0x00,
+  USB0 = 0x10,
+  UART0 = 0x20,
+  UART1 = 0x21,
+} mios32_midi_port_t;
+
+typedef mios32_midi_port_t mios32_com_port_t;
+
+#include "mios32_config.h"
+
+#define MIOS32_UART_TX_BUFFER_SIZE 64
+#define MIOS32_UART_RX_BUFFER_SIZE 64
+
+#define MIOS32_BOARD_PIN_MODE_OUTPUT_PP 0
+
+extern s32 MIOS32_UART_InitPort(u8 uart, u32 baudrate, u32 tx_pin_mode, u8 is_midi);
+extern s32 MIOS32_UART_InitPortDefault(u8 uart);
+extern u32 MIOS32_UART_BaudrateGet(u8 uart);
+extern s32 MIOS32_UART_RxBufferGet(u8 uart);
+
+extern s32 MIOS32_COM_SendChar(mios32_com_port_t port, char c);
+extern s32 MIOS32_COM_SendString(mios32_com_port_t port, const char *str);
+extern s32 MIOS32_COM_SendBuffer(mios32_com_port_t port, u8 *buffer, u16 len);
+extern s32 MIOS32_COM_ReceiveCallback_Init(void *callback_receive);
+
+extern u32 MIOS32_TIMESTAMP_Get(void);
+
+#define MIOS32_MIDI_SendDebugMessage printf
+extern s32 MIOS32_MIDI_SendDebugHexDump(const u8 *src, u32 len);
+
+#endif /* _MIOS32_H */
@@ -0,0 +1,11 @@
+// configuration of the host test, see esp_bridge.c
+// ESP8266_SLIP_TX_BATCHING is set by the makefile
+
+#ifndef _MIOS32_CONFIG_H
+#define _MIOS32_CONFIG_H
+
+// text lines of the bridge are counted by the test instead of being printed
+extern void test_debug_msg(char *format, ...);
+#define DEBUG_MSG test_debug_msg
+
+#endif /* _MIOS32_CONFIG_H */
@@ -48,6 +48,8 @@
 # include <FreeRTOS.h>
 # include <portmacro.h>
 # include <task.h>
+#else
+# include <stdlib.h>
 #endif
 
 
@@ -103,6 +105,18 @@ typedef struct
                                 /* 512 */
 } tar_posix_header;
 
+// state of FILE_CreateTar() and FILE_ExtractTar()
+typedef struct {
+  u8  *buffer;      // stream buffer
+  u32 buffer_size;  // multiple of 512
+  u32 buffer_fill;  // number of valid bytes in buffer, multiple of 512
+  u32 since;        // FAT timestamp for incremental backups, 0: all files
+  u32 num_dirs;
+  u32 num_files;
+  u32 num_bytes;
+  char path[128];   // top directory while creating, current file while extracting
+} tar_stream_t;
+
 
 /////////////////////////////////////////////////////////////////////////////
 // Local prototypes
@@ -110,8 +124,6 @@ typedef struct
 
 static s32 FILE_MountFS(void);
 
-static s32 FILE_CreateTarRecursive(char *filename, char *src_path, u8 exclude_tar_files, u8 depth, u8 max_depth, u32 *num_dirs, u32 *num_files);
-static s32 FILE_CreateTarHeader(char *filename, char *src_path, u8 is_dir, u32 filesize);
 
 
 /////////////////////////////////////////////////////////////////////////////
@@ -1459,91 +1471,199 @@ s32 FILE_SendSyxDump(char *path, mios32_midi_port_t port, u32 ms_delay_between_d
 
 
 /////////////////////////////////////////////////////////////////////////////
-// Creates a tar file (recursively)
+// Tar engine
+//
+// Headers, file data and padding are collected in a stream buffer of
+// FILE_TAR_BUFFER_SIZE bytes. Since every tar record is 512 bytes, the
+// buffer content always starts at a sector boundary of the archive, so that
+// FatFs transfers it with a single multi-sector write directly from the
+// buffer (no read-modify-write of partial sectors). Source files are read
+// in buffer sized chunks the same way.
 /////////////////////////////////////////////////////////////////////////////
-s32 FILE_CreateTar(char *filename, char *src_path, u8 exclude_tar_files, u8 max_depth)
+
+/////////////////////////////////////////////////////////////////////////////
+// Allocates the stream buffer
+// if no memory is available, the (slower) single sector tmp_buffer is used
+/////////////////////////////////////////////////////////////////////////////
+static void FILE_TarStreamInit(tar_stream_t *tar)
 {
-  s32 status = 0;
+  memset(tar, 0, sizeof(tar_stream_t));
 
-  if( !volume_available ) {
+#ifndef MIOS32_FAMILY_EMULATION
+  tar->buffer = (u8 *)pvPortMalloc(FILE_TAR_BUFFER_SIZE);
+#else
+  tar->buffer = (u8 *)malloc(FILE_TAR_BUFFER_SIZE);
+#endif
+  tar->buffer_size = FILE_TAR_BUFFER_SIZE;
+
+  if( tar->buffer == NULL ) {
 #if DEBUG_VERBOSE_LEVEL >= 2
-    DEBUG_MSG("[FILE_CreateTar] ERROR: volume doesn't exist!\n");
+    DEBUG_MSG("[FILE_Tar] not enough memory for stream buffer - using single sector transfers\n");
 #endif
-    return FILE_ERR_NO_VOLUME;
+    tar->buffer = tmp_buffer;
+    tar->buffer_size = TMP_BUFFER_SIZE;
   }
+}
 
-  // convert filename to uppercase
-  {
-    char *filename_ptr = filename;
-    while( *filename_ptr != 0 ) {
-      *filename_ptr = toupper((int)*filename_ptr);
-      ++filename_ptr;
-    }
+static void FILE_TarStreamFree(tar_stream_t *tar)
+{
+  if( tar->buffer != tmp_buffer ) {
+#ifndef MIOS32_FAMILY_EMULATION
+    vPortFree(tar->buffer);
+#else
+    free(tar->buffer);
+#endif
   }
+  tar->buffer = NULL;
+}
 
-  // create file
-  if( (status=FILE_WriteOpen(filename, 1)) < 0 ) {
+
+/////////////////////////////////////////////////////////////////////////////
+// Writes the stream buffer into the archive
+/////////////////////////////////////////////////////////////////////////////
+static s32 FILE_TarFlush(tar_stream_t *tar)
+{
+  if( tar->buffer_fill ) {
+    UINT successcount;
+    if( (file_dfs_errno=f_write(&file_write, tar->buffer, tar->buffer_fill, &successcount)) != FR_OK || successcount != tar->buffer_fill ) {
 #if DEBUG_VERBOSE_LEVEL >= 1
-    DEBUG_MSG("[FILE_CreateTar] ERROR: failed to create %s (error code: %d)!\n", filename, status);
+      DEBUG_MSG("[FILE_Tar] Failed to write sector at position 0x%08x, status: %u\n", file_write.fptr, file_dfs_errno);
 #endif
-    return status;
+      return FILE_ERR_WRITE;
+    }
+    tar->buffer_fill = 0;
   }
 
-#if DEBUG_VERBOSE_LEVEL >= 1
-  DEBUG_MSG("[FILE_CreateTar] Creating %s for path: %s\n", filename, src_path);
-#endif
+  return 0; // no error
+}
 
-  // walk directory
-  u32 num_dirs = 1;
-  u32 num_files = 0;
-  status = FILE_CreateTarRecursive(filename, src_path, exclude_tar_files, 1, max_depth, &num_dirs, &num_files);
 
-  if( status < 0 ) {
-    DEBUG_MSG("[FILE_CreateTar] failed with error code: %d\n", status);
-  } else {
-#if DEBUG_VERBOSE_LEVEL >= 1
-    DEBUG_MSG("[FILE_CreateTar] archived %d files in %d directories under %s (%d bytes)\n", num_files, num_dirs, filename, FILE_WriteGetCurrentSize());
-#endif
-  }
+/////////////////////////////////////////////////////////////////////////////
+// Conversion between FAT timestamps (see get_fattime()) and the UNIX time
+// stored in tar headers (valid for 1980..2107)
+/////////////////////////////////////////////////////////////////////////////
+static const u16 tar_days_before_month[12] = { 0, 31, 59, 90, 120, 151, 181, 212, 243, 273, 304, 334 };
 
-  // finalize file by adding two dummy all-zero blocks
-  {
-    u8 dummy[512];
-    memset(dummy, 0, 512);
+static u8 FILE_TarIsLeapYear(u32 year)
+{
+  return (year % 4) == 0 && year != 2100;
+}
 
-    int i;
-    for(i=0; i<2; ++i) {
-      UINT successcount;  
-      if( (file_dfs_errno=f_write(&file_write, &dummy, 512, &successcount)) != FR_OK || successcount != 512 ) {
-#if DEBUG_VERBOSE_LEVEL >= 1
-	DEBUG_MSG("[FILE_CreateTar] Failed to write sector at position 0x%08x, status: %u\n", file_write.fptr, file_dfs_errno);
-#endif
-	status = FILE_ERR_WRITE;
-      }
+static u32 FILE_TarFatTime2Unix(u32 fattime)
+{
+  u32 year = 1980 + (fattime >> 25);
+  u32 month = (fattime >> 21) & 0x0f;
+  u32 day = (fattime >> 16) & 0x1f;
+
+  if( month < 1 || month > 12 || day < 1 )
+    return 0; // invalid date (e.g. no RTC)
+
+  u32 days = 365*(year - 1970) + (year - 1969)/4 - (year > 2100) + tar_days_before_month[month-1] + day - 1;
+  if( month > 2 && FILE_TarIsLeapYear(year) )
+    ++days;
+
+  return 86400*days + 3600*((fattime >> 11) & 0x1f) + 60*((fattime >> 5) & 0x3f) + 2*(fattime & 0x1f);
+}
+
+static u32 FILE_TarUnix2FatTime(u32 time)
+{
+  u32 days = time / 86400;
+  u32 secs = time % 86400;
+  u32 year, month;
+
+  if( time < 315532800 ) // before 1980
+    return (1 << 21) | (1 << 16);
+
+  for(year=1970;; ++year) {
+    u32 year_days = FILE_TarIsLeapYear(year) ? 366 : 365;
+    if( days < year_days )
+      break;
+    days -= year_days;
+  }
+
+  for(month=12; month>1; --month) {
+    u32 first_day = tar_days_before_month[month-1] + ((month > 2 && FILE_TarIsLeapYear(year)) ? 1 : 0);
+    if( days >= first_day ) {
+      days -= first_day;
+      break;
     }
   }
 
-  FILE_WriteClose();
-  
-  return status;
+  if( year > (1980+127) )
+    year = 1980+127;
+
+  return ((year-1980) << 25) | (month << 21) | ((days+1) << 16) |
+    ((secs / 3600) << 11) | (((secs / 60) % 60) << 5) | ((secs % 60) / 2);
 }
 
 
-static s32 FILE_CreateTarHeader(char *filename, char *src_path, u8 is_dir, u32 filesize)
+/////////////////////////////////////////////////////////////////////////////
+// Octal number with trailing space as used in tar headers
+/////////////////////////////////////////////////////////////////////////////
+static void FILE_TarOctal(char *field, u8 digits, u32 value)
+{
+  int i;
+  for(i=digits-1; i>=0; --i, value >>= 3) {
+    field[i] = '0' + (value & 0x7);
+  }
+  field[digits] = ' ';
+}
+
+static u32 FILE_TarParseOctal(char *field, u8 len)
 {
-  s32 status = 0;
-  tar_posix_header *header;
-  header = (tar_posix_header *)&tmp_buffer;
+  u32 value = 0;
+
+  while( len && (*field == ' ' || *field == '0') ) {
+    ++field;
+    --len;
+  }
+
+  while( len && *field >= '0' && *field <= '7' ) {
+    value = (value << 3) | (*field++ - '0');
+    --len;
+  }
 
-#if TMP_BUFFER_SIZE != 512
-# error "We've a problem here!"
+  return value;
+}
+
+static u32 FILE_TarChecksum(tar_posix_header *header)
+{
+  u32 chksum = 0;
+  u8 *header_ptr = (u8 *)header;
+  int i;
+
+  for(i=0; i<512; ++i, ++header_ptr) {
+    // the checksum field itself is counted as spaces
+    chksum += (i >= 148 && i < 156) ? ' ' : *header_ptr;
+  }
+
+  return chksum;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Adds a header to the stream buffer
+/////////////////////////////////////////////////////////////////////////////
+static s32 FILE_TarHeader(tar_stream_t *tar, char *path, u8 is_dir, u32 filesize, u32 fattime)
+{
+  s32 status;
+
+  // the archive name is the top directory of all entries
+  if( (strlen(tar->path) + strlen(path) + (is_dir ? 1 : 0)) >= sizeof(((tar_posix_header *)0)->name) ) {
+#if DEBUG_VERBOSE_LEVEL >= 1
+    DEBUG_MSG("[FILE_CreateTar] path too long: %s%s\n", tar->path, path);
 #endif
+    return FILE_ERR_TAR_PATH;
+  }
 
-  memset(header, 0, sizeof(header));
+  if( tar->buffer_fill >= tar->buffer_size && (status=FILE_TarFlush(tar)) < 0 )
+    return status;
+
+  tar_posix_header *header = (tar_posix_header *)&tar->buffer[tar->buffer_fill];
+  memset(header, 0, 512);
 
-  strncpy(header->name, &filename[1], strlen(filename)-5); // remove initial / and .tar
-  header->name[strlen(filename)-5] = 0;
-  strcat(header->name, src_path);
+  strcpy(header->name, tar->path);
+  strcat(header->name, path);
   if( is_dir ) {
     strcat(header->name, "/");
   }
@@ -1551,56 +1671,87 @@ static s32 FILE_CreateTarHeader(char *filename, char *src_path, u8 is_dir, u32 f
   strcpy(header->mode, is_dir ? "000755 " : "000644 ");
   strcpy(header->uid, "000000 ");
   strcpy(header->gid, "000000 ");
-
-  // filesize in octal format
-  {
-    int i;
-    for(i=0; i<11; ++i) {
-      header->size[i] = '0' + ((filesize >> 3*(10-i)) & 0x7);
-    }
-    header->size[11] = ' ';
-  }
-
-  strcpy(header->mtime, "00000000000 ");
-  strcat(header->chksum, "        "); // will be calculated once header is complete
+  FILE_TarOctal(header->size, 11, filesize);
+  FILE_TarOctal(header->mtime, 11, FILE_TarFatTime2Unix(fattime));
   header->typeflag = is_dir ? '5' : '0';
-  //strcpy(header->linkname, "");
   strcpy(header->magic, "ustar");
-  strcpy(header->version, "00");
+  memcpy(header->version, "00", 2);
   strcpy(header->uname, "mios32");
   strcpy(header->gname, "mios32");
-  strcat(header->devmajor, "000000 ");
+  strcpy(header->devmajor, "000000 ");
   strcpy(header->devminor, "000000 ");
-  //strcpy(header->prefix, "");
 
-  {
-    u32 chksum = 0;
-    int i;
-    u8 *header_ptr = (u8 *)header;
-    for(i=0; i<512; ++i, header_ptr++) {
-      chksum += *header_ptr;
-    }
+  // checksum in octal format, terminated by NUL and space
+  FILE_TarOctal(header->chksum, 6, FILE_TarChecksum(header));
+  header->chksum[6] = 0;
+  header->chksum[7] = ' ';
 
-    // checksum in octal format
-    for(i=0; i<6; ++i) {
-      header->chksum[i] = '0' + ((chksum >> 3*(5-i)) & 0x7);
-    }
-    header->chksum[6] = 0;
+  tar->buffer_fill += 512;
+
+  return 0; // no error
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Adds the content of a file to the stream buffer, the last record is
+// padded with zeroes
+/////////////////////////////////////////////////////////////////////////////
+static s32 FILE_TarFileData(tar_stream_t *tar, char *path, u32 filesize)
+{
+  s32 status;
+
+  if( (file_dfs_errno=f_open(&file_read, path, FA_OPEN_EXISTING | FA_READ)) != FR_OK ) {
+#if DEBUG_VERBOSE_LEVEL >= 1
+    DEBUG_MSG("[FILE_CreateTar] Failed to open %s!\n", path);
+#endif
+    return FILE_ERR_COPY_NO_FILE;
   }
 
+  u32 remaining = filesize;
+  while( remaining ) {
+    if( tar->buffer_fill >= tar->buffer_size && (status=FILE_TarFlush(tar)) < 0 )
+      return status;
+
+    UINT len = tar->buffer_size - tar->buffer_fill;
+    if( len > remaining )
+      len = remaining;
+
+    UINT successcount;
+    if( (file_dfs_errno=f_read(&file_read, &tar->buffer[tar->buffer_fill], len, &successcount)) != FR_OK ) {
+#if DEBUG_VERBOSE_LEVEL >= 1
+      DEBUG_MSG("[FILE_CreateTar] Failed to read sector at position 0x%08x, status: %u\n", file_read.fptr, file_dfs_errno);
+#endif
+      return FILE_ERR_READ;
+    }
 
-  UINT successcount;  
-  if( (file_dfs_errno=f_write(&file_write, header, 512, &successcount)) != FR_OK || successcount != 512 ) {
+    if( successcount != len ) {
+      // the size has to match with the header which has already been written
 #if DEBUG_VERBOSE_LEVEL >= 1
-    DEBUG_MSG("[FILE_CreateTarHeader] Failed to write sector at position 0x%08x, status: %u\n", file_write.fptr, file_dfs_errno);
+      DEBUG_MSG("[FILE_CreateTar] %s is shorter than expected!\n", path);
 #endif
-    status = FILE_ERR_WRITE;
+      return FILE_ERR_READCOUNT;
+    }
+
+    remaining -= len;
+    tar->num_bytes += len;
+
+    if( len % 512 ) {
+      memset(&tar->buffer[tar->buffer_fill + len], 0, 512 - (len % 512));
+      len += 512 - (len % 512);
+    }
+    tar->buffer_fill += len;
   }
 
-  return status;
+  //f_close(&file_read); // never close read files to avoid "invalid object"
+
+  return 0; // no error
 }
 
-static s32 FILE_CreateTarRecursive(char *filename, char *src_path, u8 exclude_tar_files, u8 depth, u8 max_depth, u32 *num_dirs, u32 *num_files)
+
+/////////////////////////////////////////////////////////////////////////////
+// Archives a directory (recursively)
+/////////////////////////////////////////////////////////////////////////////
+static s32 FILE_CreateTarRecursive(tar_stream_t *tar, char *filename, char *src_path, u32 fattime, u8 exclude_tar_files, u8 depth, u8 max_depth)
 {
   s32 status = 0;
 
@@ -1617,7 +1768,8 @@ static s32 FILE_CreateTarRecursive(char *filename, char *src_path, u8 exclude_ta
   }
 
   // create header for new directory
-  if( (status=FILE_CreateTarHeader(filename, src_path, 1, 0)) < 0 ) {
+  // (always stored, also for incremental backups, so that the tree can be restored)
+  if( (status=FILE_TarHeader(tar, src_path, 1, 0, fattime)) < 0 ) {
     return status;
   }
 
@@ -1627,7 +1779,7 @@ static s32 FILE_CreateTarRecursive(char *filename, char *src_path, u8 exclude_ta
 
     if( de.fname[0] && de.fname[0] != '.' ) {
       if( (de.fattrib & AM_DIR) && !(de.fattrib & AM_HID) ) {
-	*num_dirs += 1;
+	tar->num_dirs += 1;
 
 #if DEBUG_VERBOSE_LEVEL >= 1
 	DEBUG_MSG("[FILE_CreateTar] D %s\n", full_path);
@@ -1637,78 +1789,401 @@ static s32 FILE_CreateTarRecursive(char *filename, char *src_path, u8 exclude_ta
 	  DEBUG_MSG("[FILE_CreateTar] Maximum depth of %d reached - won't go down further!\n", max_depth);
 #endif
 	} else {
-	  status = FILE_CreateTarRecursive(filename, full_path, exclude_tar_files, depth+1, max_depth, num_dirs, num_files);
+	  status = FILE_CreateTarRecursive(tar, filename, full_path, ((u32)de.fdate << 16) | de.ftime, exclude_tar_files, depth+1, max_depth);
 	  if( status < 0 )
 	    break;
 	}
       } else if( !(de.fattrib & AM_DIR) && !(de.fattrib & AM_HID) ) {
-	if( strcasecmp(de.fname, (char *)&filename[1]) == 0 ) {
+	u32 fattime = ((u32)de.fdate << 16) | de.ftime;
+
+	if( strcasecmp(full_path, filename) == 0 ) {
 #if DEBUG_VERBOSE_LEVEL >= 1
 	  DEBUG_MSG("[FILE_CreateTar] Skip %s (same file)\n", full_path);
 #endif
 	} else if( exclude_tar_files && strcasestr(de.fname, ".TAR") != 0 ) {
 #if DEBUG_VERBOSE_LEVEL >= 1
 	  DEBUG_MSG("[FILE_CreateTar] Skip %s\n", full_path);
+#endif
+	} else if( fattime < tar->since ) {
+#if DEBUG_VERBOSE_LEVEL >= 2
+	  DEBUG_MSG("[FILE_CreateTar] Skip %s (unchanged)\n", full_path);
 #endif
 	} else {
-	  *num_files += 1;
+	  tar->num_files += 1;
 #if DEBUG_VERBOSE_LEVEL >= 1
 	  DEBUG_MSG("[FILE_CreateTar] F %s (%d bytes)\n", full_path, de.fsize);
 #endif
 
-	  // create header for new file
-	  if( (status=FILE_CreateTarHeader(filename, full_path, 0, de.fsize)) < 0 ) {
-	    return status;
-	  }
+	  if( (status=FILE_TarHeader(tar, full_path, 0, de.fsize, fattime)) < 0 ||
+	      (status=FILE_TarFileData(tar, full_path, de.fsize)) < 0 )
+	    break;
+	}
+      }
+    }
+  }
+
+  return status;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//! Creates a tar file (recursively)
+//! \param[in] filename the archive (will be converted to uppercase), its
+//!            name without extension is the top directory of all entries
+//! \param[in] src_path the directory which should be archived ("" for the whole disk)
+//! \param[in] exclude_tar_files skip other .tar files if != 0
+//! \param[in] max_depth maximum number of directory levels
+//! \return < 0 on errors (error codes are documented in file.h)
+/////////////////////////////////////////////////////////////////////////////
+s32 FILE_CreateTar(char *filename, char *src_path, u8 exclude_tar_files, u8 max_depth)
+{
+  return FILE_CreateTarIncremental(filename, src_path, exclude_tar_files, max_depth, 0);
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//! Creates a tar file which only contains files which have been modified
+//! since the given FAT timestamp (see get_fattime()).\n
+//! The directory tree is always stored completely.
+//! \param[in] since 0: all files, otherwise files with an older timestamp
+//!            are skipped
+//! \return < 0 on errors (error codes are documented in file.h)
+/////////////////////////////////////////////////////////////////////////////
+s32 FILE_CreateTarIncremental(char *filename, char *src_path, u8 exclude_tar_files, u8 max_depth, u32 since)
+{
+  s32 status = 0;
+
+  if( !volume_available ) {
+#if DEBUG_VERBOSE_LEVEL >= 2
+    DEBUG_MSG("[FILE_CreateTar] ERROR: volume doesn't exist!\n");
+#endif
+    return FILE_ERR_NO_VOLUME;
+  }
+
+  // convert filename to uppercase
+  {
+    char *filename_ptr = filename;
+    while( *filename_ptr != 0 ) {
+      *filename_ptr = toupper((int)*filename_ptr);
+      ++filename_ptr;
+    }
+  }
 
-	  // copy file
-	  if( (file_dfs_errno=f_open(&file_read, full_path, FA_OPEN_EXISTING | FA_READ)) != FR_OK ) {
+  // create file
+  if( (status=FILE_WriteOpen(filename, 1)) < 0 ) {
 #if DEBUG_VERBOSE_LEVEL >= 1
-	    DEBUG_MSG("[FILE_CreateTar] Failed to open %s!\n", full_path);
+    DEBUG_MSG("[FILE_CreateTar] ERROR: failed to create %s (error code: %d)!\n", filename, status);
 #endif
-	    return FILE_ERR_COPY_NO_FILE;
-	  }
+    return status;
+  }
 
-	  UINT successcount;
-	  UINT successcount_wr;
-	  u32 num_bytes = 0;
-	  do {
-	    if( (file_dfs_errno=f_read(&file_read, tmp_buffer, TMP_BUFFER_SIZE, &successcount)) != FR_OK ) {
 #if DEBUG_VERBOSE_LEVEL >= 1
-	      DEBUG_MSG("[FILE_CreateTar] Failed to read sector at position 0x%08x, status: %u\n", file_read.fptr, file_dfs_errno);
+  DEBUG_MSG("[FILE_CreateTar] Creating %s for path: %s\n", filename, src_path);
 #endif
-	      successcount = 0;
-	      status = FILE_ERR_READ;
-	    } else if( successcount && (file_dfs_errno=f_write(&file_write, tmp_buffer, successcount, &successcount_wr)) != FR_OK ) {
+
+  tar_stream_t tar;
+  FILE_TarStreamInit(&tar);
+  tar.since = since;
+  tar.num_dirs = 1;
+
+  // top directory: archive name without path and extension
+  {
+    char *name = strrchr(filename, '/');
+    name = name ? (name+1) : filename;
+    strncpy(tar.path, name, sizeof(tar.path)-1);
+    char *ext = strrchr(tar.path, '.');
+    if( ext )
+      *ext = 0;
+  }
+
+  // walk directory
+  status = FILE_CreateTarRecursive(&tar, filename, src_path, 0, exclude_tar_files, 1, max_depth);
+
+  // finalize file by adding two dummy all-zero blocks
+  int i;
+  for(i=0; status >= 0 && i<2; ++i) {
+    if( tar.buffer_fill >= tar.buffer_size && (status=FILE_TarFlush(&tar)) < 0 )
+      break;
+    memset(&tar.buffer[tar.buffer_fill], 0, 512);
+    tar.buffer_fill += 512;
+  }
+
+  if( status >= 0 )
+    status = FILE_TarFlush(&tar);
+
+  FILE_TarStreamFree(&tar);
+
+  if( status < 0 ) {
+    DEBUG_MSG("[FILE_CreateTar] failed with error code: %d\n", status);
+  } else {
 #if DEBUG_VERBOSE_LEVEL >= 1
-	      DEBUG_MSG("[FILE_CreateTar] Failed to write sector at position 0x%08x, status: %u\n", file_write.fptr, file_dfs_errno);
+    DEBUG_MSG("[FILE_CreateTar] archived %d files in %d directories under %s (%d bytes)\n", tar.num_files, tar.num_dirs, filename, FILE_WriteGetCurrentSize());
 #endif
-	      status = FILE_ERR_WRITE;
-	    } else {
-	      num_bytes += successcount_wr;
-	    }
-	  } while( status == 0 && successcount > 0 );
+  }
+
+  FILE_WriteClose();
+  
+  return status;
+}
 
-	  if( status >= 0 && (de.fsize % 512) != 0 ) {
-	    // fill remaining space
-	    memset(tmp_buffer, 0, 512);
-	    if( (file_dfs_errno=f_write(&file_write, tmp_buffer, 512 - (de.fsize % 512), &successcount_wr)) != FR_OK ) {
+
+/////////////////////////////////////////////////////////////////////////////
+// Creates all parent directories of a path
+/////////////////////////////////////////////////////////////////////////////
+static void FILE_TarMakeParentDirs(char *path)
+{
+  char *slash;
+  for(slash=strchr(path+1, '/'); slash != NULL; slash=strchr(slash+1, '/')) {
+    *slash = 0;
+    f_mkdir(path); // errors (e.g. if directory exists) are ignored here, f_open will fail
+    *slash = '/';
+  }
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Prepares the extraction of a tar entry
+// \return 1 if the file data should be written into file_write,
+//         0 if the entry should be skipped
+/////////////////////////////////////////////////////////////////////////////
+static s32 FILE_ExtractTarEntry(tar_stream_t *tar, tar_posix_header *header, char *dst_path)
+{
+  char name[sizeof(header->prefix) + 1 + sizeof(header->name) + 1];
+  char *entry;
+  u32 len = 0;
+
+  // prefix/name (name and prefix aren't terminated if they use the whole field)
+  if( header->prefix[0] ) {
+    len = strnlen(header->prefix, sizeof(header->prefix));
+    memcpy(name, header->prefix, len);
+    name[len++] = '/';
+  }
+  u32 name_len = strnlen(header->name, sizeof(header->name));
+  memcpy(&name[len], header->name, name_len);
+  name[len + name_len] = 0;
+
+  // the first directory is the name of the archive (see FILE_CreateTar)
+  entry = strchr(name, '/');
+  entry = entry ? (entry+1) : name;
+
+  // remove trailing slash of directories
+  if( entry[0] && entry[strlen(entry)-1] == '/' )
+    entry[strlen(entry)-1] = 0;
+
+  if( !entry[0] )
+    return 0; // top directory
+
+  // skip paths which leave the destination directory or don't fit into tar->path
+  if( strstr(entry, "..") != NULL ||
+      snprintf(tar->path, sizeof(tar->path), "%s/%s", dst_path, entry) >= (int)sizeof(tar->path) ) {
 #if DEBUG_VERBOSE_LEVEL >= 1
-	      DEBUG_MSG("[FILE_CreateTar] Failed to write sector at position 0x%08x, status: %u\n", file_write.fptr, file_dfs_errno);
+    DEBUG_MSG("[FILE_ExtractTar] Skip %s (invalid path)\n", name);
 #endif
-	      status = FILE_ERR_WRITE;
-	    }
-	  }
+    return 0;
+  }
 
-	  //f_close(&file_read); // never close read files to avoid "invalid object"
+  if( header->typeflag == '5' ) {
+#if DEBUG_VERBOSE_LEVEL >= 1
+    DEBUG_MSG("[FILE_ExtractTar] D %s\n", tar->path);
+#endif
+    file_dfs_errno = f_mkdir(tar->path);
+    if( file_dfs_errno != FR_OK && file_dfs_errno != FR_EXIST ) {
+      FILE_TarMakeParentDirs(tar->path);
+      if( (file_dfs_errno=f_mkdir(tar->path)) != FR_OK )
+	return FILE_ERR_MKDIR;
+    }
+    tar->num_dirs += 1;
+    return 0;
+  }
 
-	  if( status < 0 )
-	    break;
+  if( header->typeflag != '0' && header->typeflag != 0 ) {
+#if DEBUG_VERBOSE_LEVEL >= 1
+    DEBUG_MSG("[FILE_ExtractTar] Skip %s (unsupported type '%c')\n", tar->path, header->typeflag);
+#endif
+    return 0;
+  }
+
+#if DEBUG_VERBOSE_LEVEL >= 1
+  DEBUG_MSG("[FILE_ExtractTar] F %s (%d bytes)\n", tar->path, FILE_TarParseOctal(header->size, sizeof(header->size)));
+#endif
+
+  if( (file_dfs_errno=f_open(&file_write, tar->path, FA_CREATE_ALWAYS | FA_WRITE)) != FR_OK ) {
+    FILE_TarMakeParentDirs(tar->path);
+    if( (file_dfs_errno=f_open(&file_write, tar->path, FA_CREATE_ALWAYS | FA_WRITE)) != FR_OK ) {
+#if DEBUG_VERBOSE_LEVEL >= 1
+      DEBUG_MSG("[FILE_ExtractTar] wasn't able to create %s!\n", tar->path);
+#endif
+      return FILE_ERR_OPEN_WRITE;
+    }
+  }
+
+  tar->num_files += 1;
+
+  return 1;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Closes an extracted file and restores its modification time
+/////////////////////////////////////////////////////////////////////////////
+static s32 FILE_ExtractTarClose(tar_stream_t *tar, u32 mtime)
+{
+  if( (file_dfs_errno=f_close(&file_write)) != FR_OK )
+    return FILE_ERR_WRITECLOSE;
+
+  if( mtime ) {
+    FILINFO fno;
+    u32 fattime = FILE_TarUnix2FatTime(mtime);
+    fno.fdate = (WORD)(fattime >> 16);
+    fno.ftime = (WORD)fattime;
+    f_utime(tar->path, &fno);
+  }
+
+  return 0; // no error
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//! Extracts a tar file which has been created with FILE_CreateTar().\n
+//! The top directory of the entries (the archive name) is replaced by
+//! dst_path, existing files will be overwritten.\n
+//! Incremental backups are restored by extracting the full backup and
+//! thereafter all incremental backups in the order of creation.
+//! \param[in] filename the archive
+//! \param[in] dst_path the destination directory ("" for the original location)
+//! \return < 0 on errors (error codes are documented in file.h)
+/////////////////////////////////////////////////////////////////////////////
+s32 FILE_ExtractTar(char *filename, char *dst_path)
+{
+  s32 status = 0;
+
+  if( !volume_available ) {
+#if DEBUG_VERBOSE_LEVEL >= 2
+    DEBUG_MSG("[FILE_ExtractTar] ERROR: volume doesn't exist!\n");
+#endif
+    return FILE_ERR_NO_VOLUME;
+  }
+
+  if( (file_dfs_errno=f_open(&file_read, filename, FA_OPEN_EXISTING | FA_READ)) != FR_OK ) {
+#if DEBUG_VERBOSE_LEVEL >= 1
+    DEBUG_MSG("[FILE_ExtractTar] ERROR: %s doesn't exist!\n", filename);
+#endif
+    return FILE_ERR_OPEN_READ;
+  }
+
+  if( dst_path[0] )
+    f_mkdir(dst_path);
+
+#if DEBUG_VERBOSE_LEVEL >= 1
+  DEBUG_MSG("[FILE_ExtractTar] Extracting %s to %s/\n", filename, dst_path);
+#endif
+
+  tar_stream_t tar;
+  FILE_TarStreamInit(&tar);
+
+  u32 pos = 0;
+  u32 file_remaining = 0;
+  u32 file_mtime = 0;
+  s32 file_write_open = 0;
+  while( status >= 0 ) {
+    // get next chunk of the archive
+    if( pos >= tar.buffer_fill ) {
+      UINT successcount;
+      if( (file_dfs_errno=f_read(&file_read, tar.buffer, tar.buffer_size, &successcount)) != FR_OK ) {
+#if DEBUG_VERBOSE_LEVEL >= 1
+	DEBUG_MSG("[FILE_ExtractTar] Failed to read sector at position 0x%08x, status: %u\n", file_read.fptr, file_dfs_errno);
+#endif
+	status = FILE_ERR_READ;
+	break;
+      }
+
+      if( successcount == 0 ) {
+	if( file_remaining )
+	  status = FILE_ERR_READCOUNT; // truncated archive
+	break; // otherwise: end of archive without trailing zero blocks
+      }
+
+      if( successcount % 512 ) {
+	status = FILE_ERR_TAR_HEADER; // not a tar file
+	break;
+      }
+
+      tar.buffer_fill = successcount;
+      pos = 0;
+    }
+
+    if( file_remaining ) {
+      // file data: write all records which are available in the buffer
+      u32 len = tar.buffer_fill - pos;
+      if( len > file_remaining )
+	len = file_remaining;
+
+      if( file_write_open ) {
+	UINT successcount;
+	if( (file_dfs_errno=f_write(&file_write, &tar.buffer[pos], len, &successcount)) != FR_OK || successcount != len ) {
+#if DEBUG_VERBOSE_LEVEL >= 1
+	  DEBUG_MSG("[FILE_ExtractTar] Failed to write sector at position 0x%08x, status: %u\n", file_write.fptr, file_dfs_errno);
+#endif
+	  status = FILE_ERR_WRITE;
+	  break;
 	}
+	tar.num_bytes += len;
+      }
+
+      file_remaining -= len;
+      pos += (len + 511) & ~511; // skip padding
+
+      if( !file_remaining && file_write_open ) {
+	file_write_open = 0;
+	status = FILE_ExtractTarClose(&tar, file_mtime);
+      }
+    } else {
+      tar_posix_header *header = (tar_posix_header *)&tar.buffer[pos];
+      pos += 512;
+
+      // end of archive?
+      if( header->name[0] == 0 )
+	break;
+
+      if( FILE_TarParseOctal(header->chksum, sizeof(header->chksum)) != FILE_TarChecksum(header) ) {
+#if DEBUG_VERBOSE_LEVEL >= 1
+	DEBUG_MSG("[FILE_ExtractTar] invalid header checksum at position 0x%08x\n", file_read.fptr - tar.buffer_fill + pos - 512);
+#endif
+	status = FILE_ERR_TAR_HEADER;
+	break;
+      }
+
+      file_remaining = FILE_TarParseOctal(header->size, sizeof(header->size));
+      file_mtime = FILE_TarParseOctal(header->mtime, sizeof(header->mtime));
+      if( header->typeflag == '5' )
+	file_remaining = 0; // directories don't have data
+
+      if( (file_write_open=FILE_ExtractTarEntry(&tar, header, dst_path)) < 0 ) {
+	status = file_write_open;
+	file_write_open = 0;
+      } else if( file_write_open && !file_remaining ) {
+	// empty file
+	file_write_open = 0;
+	status = FILE_ExtractTarClose(&tar, file_mtime);
       }
     }
   }
 
+  if( file_write_open )
+    f_close(&file_write);
+
+  //f_close(&file_read); // never close read files to avoid "invalid object"
+
+  FILE_TarStreamFree(&tar);
+
+  if( status < 0 ) {
+    DEBUG_MSG("[FILE_ExtractTar] failed with error code: %d\n", status);
+  } else {
+#if DEBUG_VERBOSE_LEVEL >= 1
+    DEBUG_MSG("[FILE_ExtractTar] extracted %d files in %d directories from %s (%d bytes)\n", tar.num_files, tar.num_dirs, filename, tar.num_bytes);
+#endif
+  }
+
   return status;
 }
 
@@ -1740,6 +2215,49 @@ s32 FILE_BackupDiskAutoName(u8 max_depth)
   return 0; // no error
 }
 
+
+/////////////////////////////////////////////////////////////////////////////
+//! This function creates an incremental backup with the next free
+//! "bak<number>.tar" name, which contains all files which have been modified
+//! since the previous backup file has been written.\n
+//! If no previous backup exists, the entire disk will be archived.
+/////////////////////////////////////////////////////////////////////////////
+s32 FILE_BackupDiskIncrementalAutoName(u8 max_depth)
+{
+  u32 since = 0;
+
+  if( !volume_available ) {
+#if DEBUG_VERBOSE_LEVEL >= 2
+    DEBUG_MSG("[FILE_BackupDiskIncrementalAutoName] ERROR: volume doesn't exist!\n");
+#endif
+    return FILE_ERR_NO_VOLUME;
+  }
+
+  int i;
+  for(i=1;;++i) {
+    char filename[20];
+    FILINFO fno;
+    sprintf(filename, "/BAK%d.TAR", i);
+    file_dfs_errno = f_stat(filename, &fno);
+    if( file_dfs_errno == FR_OK ) {
+      since = ((u32)fno.fdate << 16) | fno.ftime;
+    } else if( file_dfs_errno == FR_NO_FILE ) {
+#if DEBUG_VERBOSE_LEVEL >= 1
+      if( since )
+	DEBUG_MSG("[FILE_BackupDiskIncrementalAutoName] archiving files changed since /BAK%d.TAR\n", i-1);
+#endif
+      return FILE_CreateTarIncremental(filename, "", 1, max_depth, since);
+    } else {
+#if DEBUG_VERBOSE_LEVEL >= 2
+      DEBUG_MSG("[FILE_BackupDiskIncrementalAutoName] ERROR: during disk access, status: %d!\n", file_dfs_errno);
+#endif
+      return FILE_ERR_SD_CARD;
+    }
+  }
+
+  return 0; // no error
+}
+
 /////////////////////////////////////////////////////////////////////////////
 //! This function prints some useful SD card informations on the MIOS terminal
 /////////////////////////////////////////////////////////////////////////////
@@ -1851,6 +2369,8 @@ s32 FILE_SendErrorMessage(s32 error_status)
   case FILE_ERR_MKDIR: DEBUG_MSG("[SDCARD_ERROR:%d] FILE_MakeDir() failed\n", error_status); break;
   case FILE_ERR_INVALID_SESSION_NAME: DEBUG_MSG("[SDCARD_ERROR:%d] FILE_LoadSessionName()\n", error_status); break;
   case FILE_ERR_UPDATE_FREE: DEBUG_MSG("[SDCARD_ERROR:%d] FILE_UpdateFreeBytes()\n", error_status); break;
+  case FILE_ERR_TAR_HEADER: DEBUG_MSG("[SDCARD_ERROR:%d] invalid tar header\n", error_status); break;
+  case FILE_ERR_TAR_PATH: DEBUG_MSG("[SDCARD_ERROR:%d] path too long for tar header\n", error_status); break;
 
   default:
     // remaining errors just print the number
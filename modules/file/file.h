@@ -51,6 +51,15 @@ extern "C" {
 #define FILE_ERR_INVALID_SESSION_NAME -24 // FILE_LoadSessionName()
 #define FILE_ERR_UPDATE_FREE      -25 // FILE_UpdateFreeBytes()
 #define FILE_ERR_REMOVE           -26 // FILE_Remove() failed
+#define FILE_ERR_TAR_HEADER       -27 // FILE_ExtractTar() found an invalid header
+#define FILE_ERR_TAR_PATH         -28 // FILE_CreateTar() path doesn't fit into the tar header
+
+
+// size of the stream buffer used by FILE_CreateTar() and FILE_ExtractTar()
+// it's allocated from the heap during the operation and has to be a multiple of 512
+#ifndef FILE_TAR_BUFFER_SIZE
+#define FILE_TAR_BUFFER_SIZE 4096
+#endif
 
 
 /////////////////////////////////////////////////////////////////////////////
@@ -133,7 +142,10 @@ extern s32 FILE_FindPreviousFile(char *path, char *filename, char *ext_filter, c
 extern s32 FILE_SendSyxDump(char *path, mios32_midi_port_t port, u32 ms_delay_between_dumps);
 
   extern s32 FILE_CreateTar(char *filename, char *src_path, u8 exclude_tar_files, u8 max_depth);
+extern s32 FILE_CreateTarIncremental(char *filename, char *src_path, u8 exclude_tar_files, u8 max_depth, u32 since);
+extern s32 FILE_ExtractTar(char *filename, char *dst_path);
 extern s32 FILE_BackupDiskAutoName(u8 max_depth);
+extern s32 FILE_BackupDiskIncrementalAutoName(u8 max_depth);
 
 extern s32 FILE_PrintSDCardInfos(void);
 
@@ -0,0 +1,6 @@
+// minimal FreeRTOS environment for file.c
+#include <stdlib.h>
+#define pvPortMalloc(size) malloc(size)
+#define vPortFree(ptr)     free(ptr)
+#define vTaskDelay(ticks)  do {} while(0)
+#define taskYIELD()        do {} while(0)
@@ -0,0 +1,29 @@
+// minimal MIOS32 environment to compile file.c and FatFs on the host
+#ifndef _MIOS32_H
+#define _MIOS32_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+typedef uint8_t  u8;
+typedef uint16_t u16;
+typedef uint32_t u32;
+typedef int8_t   s8;
+typedef int16_t  s16;
+typedef int32_t  s32;
+typedef u8 mios32_midi_port_t;
+
+#include "../../../include/mios32/mios32_sdcard.h"
+
+extern s32 MIOS32_MIDI_SendSysEx(mios32_midi_port_t port, u8 *stream, u32 count);
+extern s32 MIOS32_MIDI_SendDebugStringHeader(mios32_midi_port_t port, char command, char first_byte);
+extern s32 MIOS32_MIDI_SendDebugStringBody(mios32_midi_port_t port, char *str_from_second_byte, u32 len);
+extern s32 MIOS32_MIDI_SendDebugStringFooter(mios32_midi_port_t port);
+extern s32 MIOS32_MIDI_SendDebugHexDump(const u8 *src, u32 len);
+
+// only print error messages of the FILE module
+extern u8 test_verbose;
+#define MIOS32_MIDI_SendDebugMessage(...) (test_verbose ? printf(__VA_ARGS__) : 0)
+
+#endif /* _MIOS32_H */
@@ -0,0 +1 @@
+// FatFs configuration of the host test (see ffconf.h)
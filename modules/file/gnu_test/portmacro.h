@@ -0,0 +1 @@
+// see FreeRTOS.h
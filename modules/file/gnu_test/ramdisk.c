@@ -0,0 +1,75 @@
+// FatFs disk I/O layer for a FAT image in RAM
+// counts the device accesses to compare the I/O efficiency
+
+#include <stdlib.h>
+#include <string.h>
+#include "mios32.h"
+#include "diskio.h"
+#include "ramdisk.h"
+
+u8 *ramdisk_image;
+u32 ramdisk_sectors;
+ramdisk_stats_t ramdisk_stats;
+u32 ramdisk_fattime;
+
+
+s32 RAMDISK_Init(u32 sectors)
+{
+  free(ramdisk_image);
+  ramdisk_image = calloc(sectors, 512);
+  ramdisk_sectors = sectors;
+  memset(&ramdisk_stats, 0, sizeof(ramdisk_stats));
+  return ramdisk_image ? 0 : -1;
+}
+
+
+DSTATUS disk_initialize(BYTE drv)
+{
+  return (drv == 0 && ramdisk_image) ? 0 : STA_NOINIT;
+}
+
+DSTATUS disk_status(BYTE drv)
+{
+  return (drv == 0 && ramdisk_image) ? 0 : STA_NOINIT;
+}
+
+DRESULT disk_read(BYTE drv, BYTE *buff, DWORD sector, BYTE count)
+{
+  if( drv != 0 || (sector + count) > ramdisk_sectors )
+    return RES_PARERR;
+
+  memcpy(buff, &ramdisk_image[512*sector], 512*count);
+  ++ramdisk_stats.read_cmds;
+  ramdisk_stats.read_sectors += count;
+  return RES_OK;
+}
+
+DRESULT disk_write(BYTE drv, const BYTE *buff, DWORD sector, BYTE count)
+{
+  if( drv != 0 || (sector + count) > ramdisk_sectors )
+    return RES_PARERR;
+
+  memcpy(&ramdisk_image[512*sector], buff, 512*count);
+  ++ramdisk_stats.write_cmds;
+  ramdisk_stats.write_sectors += count;
+  return RES_OK;
+}
+
+DRESULT disk_ioctl(BYTE drv, BYTE ctrl, void *buff)
+{
+  if( drv != 0 )
+    return RES_PARERR;
+
+  switch( ctrl ) {
+  case CTRL_SYNC: return RES_OK;
+  case GET_SECTOR_COUNT: *(DWORD *)buff = ramdisk_sectors; return RES_OK;
+  case GET_SECTOR_SIZE: *(WORD *)buff = 512; return RES_OK;
+  case GET_BLOCK_SIZE: *(DWORD *)buff = 1; return RES_OK;
+  }
+  return RES_PARERR;
+}
+
+DWORD get_fattime(void)
+{
+  return ramdisk_fattime;
+}
@@ -0,0 +1,22 @@
+// FatFs disk I/O layer for a FAT image in RAM
+
+#ifndef _RAMDISK_H
+#define _RAMDISK_H
+
+typedef struct {
+  u32 read_cmds;
+  u32 read_sectors;
+  u32 write_cmds;
+  u32 write_sectors;
+} ramdisk_stats_t;
+
+extern s32 RAMDISK_Init(u32 sectors);
+
+extern u8 *ramdisk_image;
+extern u32 ramdisk_sectors;
+extern ramdisk_stats_t ramdisk_stats;
+
+// returned by get_fattime()
+extern u32 ramdisk_fattime;
+
+#endif /* _RAMDISK_H */
@@ -0,0 +1,354 @@
+// Host test of the tar engine
+//
+// Creates a MBSEQ like directory tree in a FAT image, archives it with
+// FILE_CreateTar(), extracts it again with FILE_ExtractTar() and checks
+// content, size and modification time of all files. Thereafter files are
+// modified, an incremental backup is created, and the full + incremental
+// backups are restored into the original location.
+//
+// The throughput and the number of device accesses are reported for each
+// operation. The archives are exported to bak1.tar and bak2.tar, so that
+// they can be checked with GNU tar (see makefile).
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "mios32.h"
+#include "ff.h"
+#include "../file.h"
+#include "ramdisk.h"
+
+#define DISK_SECTORS (64*1024) // 32 MB
+
+#define FATTIME(year, month, day, hour, min, sec) \
+  ((((year)-1980) << 25) | ((month) << 21) | ((day) << 16) | ((hour) << 11) | ((min) << 5) | ((sec) / 2))
+
+u8 test_verbose;
+static int errors;
+static u8 sdcard_available;
+
+typedef struct {
+  char path[64];
+  u32 size;
+  u32 seed;
+  u32 fattime;
+} model_file_t;
+
+#define MAX_MODEL_FILES 64
+static model_file_t model[MAX_MODEL_FILES];
+static int num_model_files;
+
+static const char *model_dirs[] = {
+  "/SESSIONS", "/SESSIONS/DEFAULT", "/SESSIONS/LIVE", "/SESSIONS/LIVE/TRACKS", "/PRESETS", "/MIDI", NULL
+};
+
+static u8 data[2*1024*1024];
+
+
+// ------- MIOS32 stubs -------
+s32 MIOS32_SDCARD_Init(u32 mode) { return 0; }
+s32 MIOS32_SDCARD_CheckAvailable(u8 was_available) { return sdcard_available; }
+s32 MIOS32_SDCARD_CIDRead(mios32_sdcard_cid_t *cid) { return -1; }
+s32 MIOS32_SDCARD_CSDRead(mios32_sdcard_csd_t *csd) { return -1; }
+s32 MIOS32_MIDI_SendSysEx(mios32_midi_port_t port, u8 *stream, u32 count) { return 0; }
+s32 MIOS32_MIDI_SendDebugStringHeader(mios32_midi_port_t port, char command, char first_byte) { return 0; }
+s32 MIOS32_MIDI_SendDebugStringBody(mios32_midi_port_t port, char *str_from_second_byte, u32 len) { return 0; }
+s32 MIOS32_MIDI_SendDebugStringFooter(mios32_midi_port_t port) { return 0; }
+s32 MIOS32_MIDI_SendDebugHexDump(const u8 *src, u32 len) { return 0; }
+
+
+// ------- local helpers -------
+static void check(int condition, const char *msg)
+{
+  if( !condition ) {
+    printf("ERROR: %s\n", msg);
+    ++errors;
+  }
+}
+
+static u8 data_byte(u32 seed, u32 pos)
+{
+  u32 x = seed * 2654435761u + pos * 40503u;
+  x ^= x >> 13;
+  return (u8)(x * 0x5bd1e995u >> 24);
+}
+
+static model_file_t *model_find(const char *path)
+{
+  int i;
+  for(i=0; i<num_model_files; ++i)
+    if( strcmp(model[i].path, path) == 0 )
+      return &model[i];
+  return NULL;
+}
+
+// writes the file in odd sized chunks like the applications do
+static void write_file(const char *path, u32 size, u32 seed, u8 append)
+{
+  model_file_t *m = model_find(path);
+  u32 offset = (append && m) ? m->size : 0;
+  u32 i;
+
+  if( !m ) {
+    m = &model[num_model_files++];
+    strcpy(m->path, path);
+  }
+
+  check(FILE_WriteOpen((char *)path, !append) >= 0, "FILE_WriteOpen failed");
+  if( append )
+    FILE_WriteSeek(offset);
+  else
+    m->seed = seed;
+
+  for(i=0; i<size; ++i)
+    data[i] = data_byte(m->seed, offset + i);
+  for(i=0; i<size; i += 300)
+    FILE_WriteBuffer(&data[i], (size - i) > 300 ? 300 : (size - i));
+  check(FILE_WriteClose() >= 0, "FILE_WriteClose failed");
+
+  m->size = offset + size;
+  m->fattime = ramdisk_fattime;
+}
+
+// compares the files under prefix with the model
+static int verify_tree(const char *prefix)
+{
+  int i, failed = 0;
+
+  for(i=0; i<num_model_files; ++i) {
+    model_file_t *m = &model[i];
+    char path[128];
+    FILINFO fno;
+    FIL fil;
+    UINT count;
+    u32 pos;
+
+    sprintf(path, "%s%s", prefix, m->path);
+    if( f_stat(path, &fno) != FR_OK ) {
+      printf("ERROR: %s is missing\n", path);
+      ++failed;
+      continue;
+    }
+    if( fno.fsize != m->size ) {
+      printf("ERROR: %s has %u bytes, expected %u\n", path, (unsigned)fno.fsize, m->size);
+      ++failed;
+      continue;
+    }
+    if( ((u32)fno.fdate << 16 | fno.ftime) != m->fattime ) {
+      printf("ERROR: %s has timestamp 0x%08x, expected 0x%08x\n", path, (u32)fno.fdate << 16 | fno.ftime, m->fattime);
+      ++failed;
+    }
+
+    f_open(&fil, path, FA_OPEN_EXISTING | FA_READ);
+    f_read(&fil, data, m->size, &count);
+    f_close(&fil);
+    for(pos=0; pos<m->size; ++pos) {
+      if( data[pos] != data_byte(m->seed, pos) ) {
+	printf("ERROR: %s differs at position %u\n", path, pos);
+	++failed;
+	break;
+      }
+    }
+  }
+
+  errors += failed;
+  return failed;
+}
+
+static void delete_tree(const char *path)
+{
+  DIR dir;
+  FILINFO fno;
+  char child[128];
+
+  if( f_opendir(&dir, path) != FR_OK )
+    return;
+
+  // restart the search after each deletion
+  while( f_readdir(&dir, &fno) == FR_OK && fno.fname[0] ) {
+    if( fno.fname[0] == '.' )
+      continue;
+    sprintf(child, "%s/%s", path, fno.fname);
+    if( fno.fattrib & AM_DIR )
+      delete_tree(child);
+    else
+      f_unlink(child);
+    f_opendir(&dir, path);
+  }
+
+  f_unlink(path);
+}
+
+// returns the number of files in an archive
+static int count_tar_files(const char *filename, const char *export_filename)
+{
+  FIL fil;
+  UINT count;
+  int num_files = 0;
+  u32 pos;
+
+  f_open(&fil, filename, FA_OPEN_EXISTING | FA_READ);
+  f_read(&fil, data, sizeof(data), &count);
+  f_close(&fil);
+
+  for(pos=0; pos+512 <= count && data[pos]; ) {
+    u32 size = strtoul((char *)&data[pos+124], NULL, 8);
+    if( data[pos+156] == '0' )
+      ++num_files;
+    pos += 512 + ((size + 511) & ~511);
+  }
+
+  FILE *f = fopen(export_filename, "wb");
+  if( f ) {
+    fwrite(data, 1, count, f);
+    fclose(f);
+  }
+
+  return num_files;
+}
+
+// measurement of a single operation
+static struct timespec start_time;
+static ramdisk_stats_t start_stats;
+
+static void measure_start(void)
+{
+  start_stats = ramdisk_stats;
+  clock_gettime(CLOCK_MONOTONIC, &start_time);
+}
+
+static void measure_print(const char *operation, u32 num_bytes)
+{
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  double ms = (t.tv_sec - start_time.tv_sec) * 1000.0 + (t.tv_nsec - start_time.tv_nsec) / 1000000.0;
+
+  printf("%-22s %8u bytes %8.2f ms %7.1f MB/s | device reads: %5u cmds %6u sectors, writes: %5u cmds %6u sectors\n",
+	 operation, num_bytes, ms, ms > 0 ? (num_bytes / 1048576.0) / (ms / 1000.0) : 0,
+	 ramdisk_stats.read_cmds - start_stats.read_cmds,
+	 ramdisk_stats.read_sectors - start_stats.read_sectors,
+	 ramdisk_stats.write_cmds - start_stats.write_cmds,
+	 ramdisk_stats.write_sectors - start_stats.write_sectors);
+}
+
+
+// ------- main -------
+int main(int argc, char *argv[])
+{
+  int i;
+  char name[64];
+
+  test_verbose = argc >= 2 && strcmp(argv[1], "-v") == 0;
+
+  printf("Tar engine test, stream buffer: %d bytes\n", FILE_TAR_BUFFER_SIZE);
+
+  // format the FAT image
+  RAMDISK_Init(DISK_SECTORS);
+  FILE_Init(0);
+  sdcard_available = 1;
+  FILE_CheckSDCard(); // fails, but registers the work area
+  check(f_mkfs(0, 1, 0) == FR_OK, "f_mkfs failed");
+  sdcard_available = 0;
+  FILE_CheckSDCard();
+  sdcard_available = 1;
+  check(FILE_CheckSDCard() == 1, "mounting the FAT image failed");
+  check(FILE_VolumeAvailable(), "volume not available");
+
+  // create the tree
+  ramdisk_fattime = FATTIME(2024, 5, 1, 10, 0, 0);
+  for(i=0; model_dirs[i]; ++i)
+    FILE_MakeDir((char *)model_dirs[i]);
+
+  u32 total_bytes = 0;
+  for(i=1; i<=4; ++i) {
+    sprintf(name, "/SESSIONS/DEFAULT/MBSEQ_B%d.V4", i);
+    write_file(name, 50000 + 25000*i, i, 0);
+    sprintf(name, "/SESSIONS/LIVE/MBSEQ_B%d.V4", i);
+    write_file(name, 40000 + 10000*i, 10+i, 0);
+  }
+  write_file("/SESSIONS/DEFAULT/MBSEQ_M.V4", 2839, 20, 0);
+  write_file("/SESSIONS/DEFAULT/MBSEQ_S.V4", 16384, 21, 0);
+  write_file("/SESSIONS/DEFAULT/MBSEQ_G.V4", 511, 22, 0);
+  write_file("/SESSIONS/DEFAULT/MBSEQ_C.V4", 512, 23, 0);
+  write_file("/SESSIONS/DEFAULT/MBSEQ_BM.V4", 513, 24, 0);
+  write_file("/SESSIONS/DEFAULT/MBSEQ_HW.V4", 7215, 25, 0);
+  write_file("/SESSIONS/LIVE/TRACKS/EMPTY.V4", 0, 26, 0);
+  write_file("/SESSIONS/LIVE/TRACKS/T1.V4T", 1, 27, 0);
+  write_file("/PRESETS/LABELS.V4P", 4100, 28, 0);
+  write_file("/PRESETS/SCALES.V4P", 1200, 29, 0);
+  write_file("/MIDI/SONG1.MID", 200000, 30, 0);
+  write_file("/MIDI/SONG2.MID", 33333, 31, 0);
+  write_file("/MBSEQ_HW.V4", 3000, 32, 0);
+  write_file("/MBSEQ_GC.V4", 1500, 33, 0);
+  write_file("/OLD.TAR", 5000, 34, 0); // excluded from backups
+  --num_model_files; // (and not part of the verification)
+
+  u32 expected_size = 1024; // two zero records at the end
+  for(i=0; i<num_model_files; ++i) {
+    total_bytes += model[i].size;
+    expected_size += 512 + ((model[i].size + 511) & ~511);
+  }
+  for(i=0; model_dirs[i]; ++i)
+    expected_size += 512;
+  expected_size += 512; // root
+
+  // full backup
+  ramdisk_fattime = FATTIME(2024, 5, 2, 18, 30, 10);
+  measure_start();
+  check(FILE_BackupDiskAutoName(4) >= 0, "full backup failed");
+  measure_print("create BAK1.TAR", total_bytes);
+
+  FILINFO fno;
+  check(f_stat("/BAK1.TAR", &fno) == FR_OK, "/BAK1.TAR missing");
+  if( fno.fsize != expected_size ) {
+    printf("ERROR: /BAK1.TAR has %u bytes, expected %u\n", (unsigned)fno.fsize, expected_size);
+    ++errors;
+  }
+  check(count_tar_files("/BAK1.TAR", "bak1.tar") == num_model_files, "unexpected number of files in /BAK1.TAR");
+
+  // extract into another directory
+  measure_start();
+  check(FILE_ExtractTar("/BAK1.TAR", "/RESTORE") >= 0, "extraction into /RESTORE failed");
+  measure_print("extract to /RESTORE", total_bytes);
+  verify_tree("/RESTORE");
+  delete_tree("/RESTORE");
+
+  // modify files and create an incremental backup
+  ramdisk_fattime = FATTIME(2024, 5, 3, 9, 15, 0);
+  write_file("/SESSIONS/DEFAULT/MBSEQ_B2.V4", 90001, 40, 0);
+  write_file("/SESSIONS/DEFAULT/MBSEQ_M.V4", 1000, 0, 1);
+  write_file("/SESSIONS/LIVE/TRACKS/T2.V4T", 4096, 41, 0);
+
+  ramdisk_fattime = FATTIME(2024, 5, 3, 20, 0, 0);
+  measure_start();
+  check(FILE_BackupDiskIncrementalAutoName(4) >= 0, "incremental backup failed");
+  measure_print("create BAK2.TAR (inc)", 90001 + 3839 + 4096);
+  check(count_tar_files("/BAK2.TAR", "bak2.tar") == 3, "3 files expected in incremental backup /BAK2.TAR");
+
+  // restore everything from the full and incremental backup
+  for(i=0; i<num_model_files; ++i)
+    f_unlink(model[i].path);
+  delete_tree("/SESSIONS");
+  delete_tree("/PRESETS");
+  delete_tree("/MIDI");
+  check(f_stat("/SESSIONS", &fno) != FR_OK, "/SESSIONS hasn't been deleted");
+
+  measure_start();
+  check(FILE_ExtractTar("/BAK1.TAR", "") >= 0, "restore of /BAK1.TAR failed");
+  check(FILE_ExtractTar("/BAK2.TAR", "") >= 0, "restore of /BAK2.TAR failed");
+  measure_print("restore BAK1+BAK2", total_bytes + 90001 + 3839 + 4096);
+  verify_tree("");
+
+  // invalid archive
+  memset(data, 'x', 1024);
+  FILE_WriteOpen("/BAD.TAR", 1);
+  FILE_WriteBuffer(data, 1024);
+  FILE_WriteClose();
+  check(FILE_ExtractTar("/BAD.TAR", "/BAD") == FILE_ERR_TAR_HEADER, "invalid header not detected");
+  check(FILE_ExtractTar("/MISSING.TAR", "") == FILE_ERR_OPEN_READ, "missing archive not detected");
+
+  printf(errors ? "FAILED with %d errors\n" : "PASSED\n", errors);
+
+  return errors ? 1 : 0;
+}
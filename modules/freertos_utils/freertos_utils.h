@@ -28,11 +28,72 @@
 #define FREERTOS_UTILS_PERF_TIMER_PERIOD 10 // uS
 #endif
 
+// number of events stored in the trace ring buffer (must be a power of 2)
+// 0 disables the trace, each event allocates 8 bytes
+#ifndef FREERTOS_UTILS_TRACE_SIZE
+#define FREERTOS_UTILS_TRACE_SIZE 0
+#endif
+
+// maximum number of tasks which can be distinguished by the trace
+#ifndef FREERTOS_UTILS_TRACE_MAX_TASKS
+#define FREERTOS_UTILS_TRACE_MAX_TASKS 16
+#endif
+
+// number of response time histogram bins per task
+// bin 0: 0 uS, bin n: 2^(n-1)..2^n-1 uS, last bin: everything above
+#ifndef FREERTOS_UTILS_TRACE_HISTOGRAM_BINS
+#define FREERTOS_UTILS_TRACE_HISTOGRAM_BINS 16
+#endif
+
+// timestamp source of the trace (free running 32bit counter)
+// by default the CPU cycle counter, it will be enabled by FREERTOS_UTILS_TraceInit()
+#ifndef FREERTOS_UTILS_TRACE_TIMESTAMP
+#define FREERTOS_UTILS_TRACE_TIMESTAMP() MIOS32_CYCLES_Get()
+#define FREERTOS_UTILS_TRACE_TIMESTAMP_MIOS32
+#endif
+
+// frequency of the timestamp source
+#ifndef FREERTOS_UTILS_TRACE_TIMESTAMP_FREQUENCY
+#define FREERTOS_UTILS_TRACE_TIMESTAMP_FREQUENCY MIOS32_SYS_CPU_FREQUENCY
+#endif
+
+// SysEx debug command which is used by FREERTOS_UTILS_TraceDump
+// (0x40 is used for terminal strings, 0x41 for the filebrowser)
+#define FREERTOS_UTILS_TRACE_SYSEX_CMD 0x42
+
+// helpers to trace interrupt handlers (they are not hooked automatically), e.g.
+//   void UART0_IRQHandler(void) { FREERTOS_UTILS_TRACE_ISR_ENTER(1); ...; FREERTOS_UTILS_TRACE_ISR_EXIT(1); }
+#if FREERTOS_UTILS_TRACE_SIZE
+#define FREERTOS_UTILS_TRACE_ISR_ENTER(id) FREERTOS_UTILS_TraceEvent(FREERTOS_UTILS_TRACE_EVENT_ISR_ENTER, id)
+#define FREERTOS_UTILS_TRACE_ISR_EXIT(id)  FREERTOS_UTILS_TraceEvent(FREERTOS_UTILS_TRACE_EVENT_ISR_EXIT, id)
+#else
+#define FREERTOS_UTILS_TRACE_ISR_ENTER(id)
+#define FREERTOS_UTILS_TRACE_ISR_EXIT(id)
+#endif
+
 
 /////////////////////////////////////////////////////////////////////////////
 // Global Types
 /////////////////////////////////////////////////////////////////////////////
 
+typedef enum {
+  FREERTOS_UTILS_TRACE_EVENT_NONE = 0,
+  FREERTOS_UTILS_TRACE_EVENT_TASK_SWITCHED_IN,    // task: new task, param: response time in uS (0xffff: unknown)
+  FREERTOS_UTILS_TRACE_EVENT_TASK_READY,          // task: running task, param: task which has been made ready
+  FREERTOS_UTILS_TRACE_EVENT_ISR_ENTER,           // param: ISR id
+  FREERTOS_UTILS_TRACE_EVENT_ISR_EXIT,            // param: ISR id
+  FREERTOS_UTILS_TRACE_EVENT_QUEUE_RECEIVE_BLOCK, // param: lower 16 bit of queue/semaphore address
+  FREERTOS_UTILS_TRACE_EVENT_QUEUE_SEND_BLOCK,    // param: lower 16 bit of queue/semaphore address
+  FREERTOS_UTILS_TRACE_EVENT_USER                 // param: application specific
+} freertos_utils_trace_event_t;
+
+typedef struct {
+  u32 timestamp;
+  u8  event;
+  u8  task;
+  u16 param;
+} freertos_utils_trace_record_t;
+
 
 
 /////////////////////////////////////////////////////////////////////////////
@@ -43,6 +104,18 @@ extern s32 FREERTOS_UTILS_PerfCounterInit(void);
 extern u32 FREERTOS_UTILS_PerfCounterGet(void);
 extern s32 FREERTOS_UTILS_RunTimeStats(void);
 
+extern s32 FREERTOS_UTILS_TraceInit(u32 mode);
+extern s32 FREERTOS_UTILS_TraceStart(void);
+extern s32 FREERTOS_UTILS_TraceStop(void);
+extern s32 FREERTOS_UTILS_TraceClear(void);
+extern s32 FREERTOS_UTILS_TraceDump(mios32_midi_port_t port);
+extern s32 FREERTOS_UTILS_TraceHistogramsPrint(void);
+
+extern void FREERTOS_UTILS_TraceEvent(u8 event, u32 param);
+extern void FREERTOS_UTILS_TraceTaskSwitchedIn(void *task_handle);
+extern void FREERTOS_UTILS_TraceTaskReady(void *task_handle);
+extern void FREERTOS_UTILS_TraceQueueBlock(void *queue, unsigned char send);
+
 
 /////////////////////////////////////////////////////////////////////////////
 // Export global variables
@@ -6,7 +6,8 @@ C_INCLUDE += -I $(MIOS32_PATH)/modules/freertos_utils
 
 # add modules to thumb sources (TODO: provide makefile option to add code to ARM sources)
 THUMB_SOURCE += \
-	$(MIOS32_PATH)/modules/freertos_utils/freertos_utils.c
+	$(MIOS32_PATH)/modules/freertos_utils/freertos_utils.c \
+	$(MIOS32_PATH)/modules/freertos_utils/freertos_utils_trace.c
 
 
 # directories and files that should be part of the distribution (release) package
@@ -0,0 +1,516 @@
+// $Id$
+//! \defgroup FREERTOS_UTILS_TRACE
+//!
+//! Trace ring buffer and task response time histograms for FreeRTOS
+//!
+//! The kernel reports task switches, tasks which are made ready and
+//! blocking queue/semaphore accesses via the FreeRTOS trace macros.
+//! Each event is stored as an 8 byte record with a CPU cycle timestamp
+//! in a ring buffer, so that the last FREERTOS_UTILS_TRACE_SIZE events
+//! before an incident can be analysed.<BR>
+//! In addition the time between "task made ready" and "task switched in"
+//! is collected in a logarithmic histogram for each task.
+//!
+//! In order to enable the trace, add following definitions to the end of
+//! your mios32_config.h file:
+//! \code
+//! #define FREERTOS_UTILS_TRACE_SIZE 1024
+//! #include <freertos_utils_trace.h>
+//! \endcode
+//!
+//! and start the trace in APP_Init():
+//! \code
+//!   FREERTOS_UTILS_TraceInit(0);
+//! \endcode
+//!
+//! Interrupt handlers and application code can add own events:
+//! \code
+//!   FREERTOS_UTILS_TRACE_ISR_ENTER(1);
+//!   FREERTOS_UTILS_TraceEvent(FREERTOS_UTILS_TRACE_EVENT_USER, 42);
+//! \endcode
+//!
+//! ISR enter/exit events are only recorded by handlers which call these
+//! macros. FreeRTOS V9 has no traceISR_ENTER/EXIT hooks, and the MIOS32
+//! interrupt handlers are entered directly from the vector table without
+//! a common wrapper, so that they can't be hooked at a single place.
+//!
+//! FREERTOS_UTILS_TraceDump() sends the buffer as binary SysEx stream,
+//! it can be converted into a timeline with
+//! $MIOS32_PATH/modules/freertos_utils/tools/trace_decode.c<BR>
+//! FREERTOS_UTILS_TraceHistogramsPrint() prints the histograms to the
+//! MIOS Terminal.
+//!
+//! \{
+/* ==========================================================================
+ *
+ *  Copyright (C) 2026 agent (agent@local)
+ *  Licensed for personal non-commercial use only.
+ *  All other rights reserved.
+ *
+ * ==========================================================================
+ */
+
+/////////////////////////////////////////////////////////////////////////////
+// Include files
+/////////////////////////////////////////////////////////////////////////////
+
+#include <mios32.h>
+#include <string.h>
+#include <FreeRTOS.h>
+#include <task.h>
+#include "freertos_utils.h"
+
+#if FREERTOS_UTILS_TRACE_SIZE
+
+#if (FREERTOS_UTILS_TRACE_SIZE & (FREERTOS_UTILS_TRACE_SIZE-1))
+# error "FREERTOS_UTILS_TRACE_SIZE must be a power of 2"
+#endif
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Local definitions
+/////////////////////////////////////////////////////////////////////////////
+
+#define TRACE_TASK_NAME_LEN      16
+#define TRACE_TASK_UNKNOWN     0xff
+
+// dump format (payload of the FREERTOS_UTILS_TRACE_SYSEX_CMD debug message)
+#define TRACE_DUMP_VERSION        1
+#define TRACE_DUMP_BLOCK_HEADER   0x00
+#define TRACE_DUMP_BLOCK_TASK     0x01
+#define TRACE_DUMP_BLOCK_RECORDS  0x02
+#define TRACE_DUMP_BLOCK_HISTO    0x03
+#define TRACE_DUMP_BLOCK_END      0x7f
+
+#define TRACE_DUMP_RECORDS_PER_BLOCK 16
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Local types
+/////////////////////////////////////////////////////////////////////////////
+
+typedef struct {
+  void *handle;
+  u32 ready_timestamp;
+  u32 max_us;
+  u16 bins[FREERTOS_UTILS_TRACE_HISTOGRAM_BINS];
+  u8  ready_valid;
+  char name[TRACE_TASK_NAME_LEN];
+} trace_task_t;
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Local variables
+/////////////////////////////////////////////////////////////////////////////
+
+static freertos_utils_trace_record_t trace_buffer[FREERTOS_UTILS_TRACE_SIZE];
+static volatile u32 trace_head; // free running write index
+static volatile u8 trace_enabled;
+
+static trace_task_t trace_tasks[FREERTOS_UTILS_TRACE_MAX_TASKS];
+static u8 trace_num_tasks;
+static u8 trace_current_task = TRACE_TASK_UNKNOWN;
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Local functions
+/////////////////////////////////////////////////////////////////////////////
+
+static inline void TRACE_Store(u32 timestamp, u8 event, u8 task, u16 param)
+{
+  // reserving the slot and writing the record must be atomic, since events
+  // are added from tasks, the scheduler and nested interrupts
+  MIOS32_IRQ_Disable();
+  freertos_utils_trace_record_t *r = &trace_buffer[trace_head & (FREERTOS_UTILS_TRACE_SIZE-1)];
+  r->timestamp = timestamp;
+  r->event = event;
+  r->task = task;
+  r->param = param;
+  ++trace_head;
+  MIOS32_IRQ_Enable();
+}
+
+// returns the task index, registers new tasks
+// only called from the kernel (scheduler suspended or inside critical section)
+static u8 TRACE_TaskIx(void *handle)
+{
+  int i;
+  trace_task_t *t = &trace_tasks[0];
+  for(i=0; i<trace_num_tasks; ++i, ++t)
+    if( t->handle == handle )
+      return i;
+
+  if( trace_num_tasks >= FREERTOS_UTILS_TRACE_MAX_TASKS )
+    return TRACE_TASK_UNKNOWN;
+
+  t->handle = handle;
+  t->ready_valid = 0;
+  t->max_us = 0;
+  memset(t->bins, 0, sizeof(t->bins));
+  strncpy(t->name, pcTaskGetName((TaskHandle_t)handle), TRACE_TASK_NAME_LEN-1);
+  t->name[TRACE_TASK_NAME_LEN-1] = 0;
+
+  return trace_num_tasks++;
+}
+
+static u32 TRACE_CyclesToUs(u32 cycles)
+{
+#if FREERTOS_UTILS_TRACE_TIMESTAMP_FREQUENCY >= 1000000
+  return cycles / (FREERTOS_UTILS_TRACE_TIMESTAMP_FREQUENCY / 1000000);
+#else
+  return cycles * (1000000 / FREERTOS_UTILS_TRACE_TIMESTAMP_FREQUENCY);
+#endif
+}
+
+// sends a 7bit encoded block: every 7 bytes are preceded by a byte which contains their MSBs
+static s32 TRACE_SendBlock(mios32_midi_port_t port, u8 block_type, u8 *data, u32 len)
+{
+  u8 sysex[8 + 1 + ((TRACE_DUMP_RECORDS_PER_BLOCK*sizeof(freertos_utils_trace_record_t) + 6) / 7) * 8 + 1];
+  u32 pos = 0;
+  u32 i;
+
+  for(i=0; i<sizeof(mios32_midi_sysex_header); ++i)
+    sysex[pos++] = mios32_midi_sysex_header[i];
+  sysex[pos++] = MIOS32_MIDI_DeviceIDGet();
+  sysex[pos++] = MIOS32_MIDI_SYSEX_DEBUG;
+  sysex[pos++] = FREERTOS_UTILS_TRACE_SYSEX_CMD;
+  sysex[pos++] = block_type;
+
+  while( len ) {
+    u32 chunk = (len > 7) ? 7 : len;
+    u8 msbs = 0;
+    for(i=0; i<chunk; ++i)
+      if( data[i] & 0x80 )
+	msbs |= (1 << i);
+    sysex[pos++] = msbs;
+    for(i=0; i<chunk; ++i)
+      sysex[pos++] = data[i] & 0x7f;
+    data += chunk;
+    len -= chunk;
+  }
+
+  sysex[pos++] = 0xf7;
+
+  return MIOS32_MIDI_SendSysEx(port, sysex, pos);
+}
+
+static void TRACE_Put32(u8 *buffer, u32 value)
+{
+  buffer[0] = (u8)(value >>  0);
+  buffer[1] = (u8)(value >>  8);
+  buffer[2] = (u8)(value >> 16);
+  buffer[3] = (u8)(value >> 24);
+}
+#endif
+
+
+/////////////////////////////////////////////////////////////////////////////
+//! Initializes the trace and starts recording
+//! \param[in] mode currently only mode 0 supported
+//! \return < 0 if initialisation failed
+/////////////////////////////////////////////////////////////////////////////
+s32 FREERTOS_UTILS_TraceInit(u32 mode)
+{
+#if !FREERTOS_UTILS_TRACE_SIZE
+  return -1; // trace not enabled
+#else
+  if( mode != 0 )
+    return -1; // unsupported mode
+
+#ifdef FREERTOS_UTILS_TRACE_TIMESTAMP_MIOS32
+  // enable the CPU cycle counter which is used as timestamp
+  MIOS32_CYCLES_Init(0);
+#endif
+
+  FREERTOS_UTILS_TraceClear();
+
+  return FREERTOS_UTILS_TraceStart();
+#endif
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//! (Re-)starts recording
+//! \return < 0 if trace not enabled
+/////////////////////////////////////////////////////////////////////////////
+s32 FREERTOS_UTILS_TraceStart(void)
+{
+#if !FREERTOS_UTILS_TRACE_SIZE
+  return -1; // trace not enabled
+#else
+  trace_enabled = 1;
+  return 0; // no error
+#endif
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//! Stops recording, so that the buffer content can be dumped later.<BR>
+//! Can be called from the application when an incident has been detected
+//! (e.g. a late MIDI clock) to freeze the events which led to it.
+//! \return < 0 if trace not enabled
+/////////////////////////////////////////////////////////////////////////////
+s32 FREERTOS_UTILS_TraceStop(void)
+{
+#if !FREERTOS_UTILS_TRACE_SIZE
+  return -1; // trace not enabled
+#else
+  trace_enabled = 0;
+  return 0; // no error
+#endif
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//! Clears the ring buffer and the histograms (task names are kept)
+//! \return < 0 if trace not enabled
+/////////////////////////////////////////////////////////////////////////////
+s32 FREERTOS_UTILS_TraceClear(void)
+{
+#if !FREERTOS_UTILS_TRACE_SIZE
+  return -1; // trace not enabled
+#else
+  int i;
+
+  MIOS32_IRQ_Disable();
+  trace_head = 0;
+  for(i=0; i<trace_num_tasks; ++i) {
+    trace_tasks[i].ready_valid = 0;
+    trace_tasks[i].max_us = 0;
+    memset(trace_tasks[i].bins, 0, sizeof(trace_tasks[i].bins));
+  }
+  MIOS32_IRQ_Enable();
+
+  return 0; // no error
+#endif
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//! Adds an event to the trace, can be called from tasks and interrupts
+//! \param[in] event see freertos_utils_trace_event_t
+//! \param[in] param event specific parameter (only the lower 16 bits are stored)
+/////////////////////////////////////////////////////////////////////////////
+void FREERTOS_UTILS_TraceEvent(u8 event, u32 param)
+{
+#if FREERTOS_UTILS_TRACE_SIZE
+  if( trace_enabled )
+    TRACE_Store(FREERTOS_UTILS_TRACE_TIMESTAMP(), event, trace_current_task, (u16)param);
+#endif
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//! Kernel hook for traceTASK_SWITCHED_IN (see freertos_utils_trace.h)
+//! \param[in] task_handle the task which will be executed next
+/////////////////////////////////////////////////////////////////////////////
+void FREERTOS_UTILS_TraceTaskSwitchedIn(void *task_handle)
+{
+#if FREERTOS_UTILS_TRACE_SIZE
+  if( !trace_enabled )
+    return;
+
+  u32 timestamp = FREERTOS_UTILS_TRACE_TIMESTAMP();
+  u8 task = TRACE_TaskIx(task_handle);
+  u16 response_us = 0xffff;
+
+  if( task != TRACE_TASK_UNKNOWN ) {
+    trace_task_t *t = &trace_tasks[task];
+
+    if( task == trace_current_task && !t->ready_valid )
+      return; // no switch (scheduler selected the running task again)
+
+    if( t->ready_valid ) {
+      t->ready_valid = 0;
+
+      u32 us = TRACE_CyclesToUs(timestamp - t->ready_timestamp);
+      response_us = (us < 0xffff) ? us : 0xffff;
+      if( us > t->max_us )
+	t->max_us = us;
+
+      // logarithmic bin: 0, 1, 2..3, 4..7, ...
+      u32 bin = us ? (32 - __builtin_clz(us)) : 0;
+      if( bin >= FREERTOS_UTILS_TRACE_HISTOGRAM_BINS )
+	bin = FREERTOS_UTILS_TRACE_HISTOGRAM_BINS-1;
+      if( t->bins[bin] < 0xffff )
+	++t->bins[bin];
+    }
+  }
+
+  trace_current_task = task;
+  TRACE_Store(timestamp, FREERTOS_UTILS_TRACE_EVENT_TASK_SWITCHED_IN, task, response_us);
+#endif
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//! Kernel hook for traceMOVED_TASK_TO_READY_STATE (see freertos_utils_trace.h)
+//! \param[in] task_handle the task which has been made ready
+/////////////////////////////////////////////////////////////////////////////
+void FREERTOS_UTILS_TraceTaskReady(void *task_handle)
+{
+#if FREERTOS_UTILS_TRACE_SIZE
+  if( !trace_enabled )
+    return;
+
+  u32 timestamp = FREERTOS_UTILS_TRACE_TIMESTAMP();
+  u8 task = TRACE_TaskIx(task_handle);
+
+  if( task != TRACE_TASK_UNKNOWN ) {
+    trace_task_t *t = &trace_tasks[task];
+    // no response time measurement if the running task is re-added to the ready list (e.g. priority change)
+    if( task != trace_current_task && !t->ready_valid ) {
+      t->ready_valid = 1;
+      t->ready_timestamp = timestamp;
+    }
+  }
+
+  TRACE_Store(timestamp, FREERTOS_UTILS_TRACE_EVENT_TASK_READY, trace_current_task, task);
+#endif
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//! Kernel hook for traceBLOCKING_ON_QUEUE_RECEIVE/SEND (see freertos_utils_trace.h)
+//! \param[in] queue the queue or semaphore
+//! \param[in] send 0 if the task blocks on receive/take, 1 on send/give
+/////////////////////////////////////////////////////////////////////////////
+void FREERTOS_UTILS_TraceQueueBlock(void *queue, unsigned char send)
+{
+#if FREERTOS_UTILS_TRACE_SIZE
+  FREERTOS_UTILS_TraceEvent(send ? FREERTOS_UTILS_TRACE_EVENT_QUEUE_SEND_BLOCK : FREERTOS_UTILS_TRACE_EVENT_QUEUE_RECEIVE_BLOCK,
+			    (u32)(size_t)queue);
+#endif
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//! Sends the trace as binary SysEx stream.<BR>
+//! Each message starts with the MIOS32 debug message header, followed by
+//! FREERTOS_UTILS_TRACE_SYSEX_CMD and a block type. The block content is
+//! 7bit encoded (each group of 7 bytes is preceded by a byte with their MSBs):
+//! <UL>
+//!   <LI>0x00 header: version, number of tasks, timestamp frequency (u32), number of records (u32), histogram bins
+//!   <LI>0x01 task: index, name (16 bytes)
+//!   <LI>0x02 records: sequence number of the first record (u32), followed by up to 16 records
+//!   <LI>0x03 histogram: task index, max response time in uS (u32), bins (u16 each)
+//!   <LI>0x7f end of dump
+//! </UL>
+//! All values are little endian. Recording is paused during the dump.<BR>
+//! The dump can be converted into a timeline with
+//! $MIOS32_PATH/modules/freertos_utils/tools/trace_decode.c
+//! \param[in] port the MIDI port to which the dump should be sent
+//! \return < 0 if MIDI output failed or trace not enabled
+/////////////////////////////////////////////////////////////////////////////
+s32 FREERTOS_UTILS_TraceDump(mios32_midi_port_t port)
+{
+#if !FREERTOS_UTILS_TRACE_SIZE
+  return -1; // trace not enabled
+#else
+  s32 status = 0;
+  u8 buffer[TRACE_DUMP_RECORDS_PER_BLOCK*sizeof(freertos_utils_trace_record_t) + 4];
+  int i;
+
+  u8 prev_enabled = trace_enabled;
+  trace_enabled = 0;
+
+  u32 head = trace_head;
+  u32 num_records = (head > FREERTOS_UTILS_TRACE_SIZE) ? FREERTOS_UTILS_TRACE_SIZE : head;
+  u8 num_tasks = trace_num_tasks;
+
+  buffer[0] = TRACE_DUMP_VERSION;
+  buffer[1] = num_tasks;
+  TRACE_Put32(&buffer[2], FREERTOS_UTILS_TRACE_TIMESTAMP_FREQUENCY);
+  TRACE_Put32(&buffer[6], num_records);
+  buffer[10] = FREERTOS_UTILS_TRACE_HISTOGRAM_BINS;
+  status |= TRACE_SendBlock(port, TRACE_DUMP_BLOCK_HEADER, buffer, 11);
+
+  for(i=0; status >= 0 && i<num_tasks; ++i) {
+    buffer[0] = i;
+    memcpy(&buffer[1], trace_tasks[i].name, TRACE_TASK_NAME_LEN);
+    status |= TRACE_SendBlock(port, TRACE_DUMP_BLOCK_TASK, buffer, 1 + TRACE_TASK_NAME_LEN);
+  }
+
+  u32 seq;
+  for(seq=head-num_records; status >= 0 && seq != head; ) {
+    u32 num = head - seq;
+    if( num > TRACE_DUMP_RECORDS_PER_BLOCK )
+      num = TRACE_DUMP_RECORDS_PER_BLOCK;
+
+    TRACE_Put32(&buffer[0], seq);
+    u8 *p = &buffer[4];
+    u32 j;
+    for(j=0; j<num; ++j, ++seq) {
+      freertos_utils_trace_record_t *r = &trace_buffer[seq & (FREERTOS_UTILS_TRACE_SIZE-1)];
+      TRACE_Put32(p, r->timestamp);
+      p[4] = r->event;
+      p[5] = r->task;
+      p[6] = (u8)(r->param >> 0);
+      p[7] = (u8)(r->param >> 8);
+      p += 8;
+    }
+    status |= TRACE_SendBlock(port, TRACE_DUMP_BLOCK_RECORDS, buffer, p - buffer);
+  }
+
+  for(i=0; status >= 0 && i<num_tasks; ++i) {
+    trace_task_t *t = &trace_tasks[i];
+    int bin;
+    buffer[0] = i;
+    TRACE_Put32(&buffer[1], t->max_us);
+    for(bin=0; bin<FREERTOS_UTILS_TRACE_HISTOGRAM_BINS; ++bin) {
+      buffer[5 + 2*bin + 0] = (u8)(t->bins[bin] >> 0);
+      buffer[5 + 2*bin + 1] = (u8)(t->bins[bin] >> 8);
+    }
+    status |= TRACE_SendBlock(port, TRACE_DUMP_BLOCK_HISTO, buffer, 5 + 2*FREERTOS_UTILS_TRACE_HISTOGRAM_BINS);
+  }
+
+  status |= TRACE_SendBlock(port, TRACE_DUMP_BLOCK_END, buffer, 0);
+
+  trace_enabled = prev_enabled;
+
+  return status;
+#endif
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//! Prints the response time histograms of all tasks to the MIOS Terminal
+//! \return < 0 if MIDI output failed or trace not enabled
+/////////////////////////////////////////////////////////////////////////////
+s32 FREERTOS_UTILS_TraceHistogramsPrint(void)
+{
+#if !FREERTOS_UTILS_TRACE_SIZE
+  return MIOS32_MIDI_SendDebugString("FREERTOS_UTILS_TRACE_SIZE not set!\n");
+#else
+  s32 status = 0;
+  int i;
+
+  status |= MIOS32_MIDI_SendDebugString("================================================\n");
+  status |= MIOS32_MIDI_SendDebugMessage("Task response times (%d events recorded):\n", trace_head);
+
+  for(i=0; status >= 0 && i<trace_num_tasks; ++i) {
+    trace_task_t *t = &trace_tasks[i];
+    u32 total = 0;
+    int bin;
+    for(bin=0; bin<FREERTOS_UTILS_TRACE_HISTOGRAM_BINS; ++bin)
+      total += t->bins[bin];
+
+    status |= MIOS32_MIDI_SendDebugMessage("%-16s %6d wakeups, max %d uS\n", t->name, total, t->max_us);
+    for(bin=0; bin<FREERTOS_UTILS_TRACE_HISTOGRAM_BINS; ++bin) {
+      if( t->bins[bin] ) {
+	u32 from = bin ? (1 << (bin-1)) : 0;
+	if( bin == FREERTOS_UTILS_TRACE_HISTOGRAM_BINS-1 )
+	  status |= MIOS32_MIDI_SendDebugMessage("  >= %6d uS: %d\n", from, t->bins[bin]);
+	else
+	  status |= MIOS32_MIDI_SendDebugMessage("  %6d..%6d uS: %d\n", from, bin ? (2*from-1) : 0, t->bins[bin]);
+      }
+    }
+  }
+
+  status |= MIOS32_MIDI_SendDebugString("================================================\n");
+
+  return status;
+#endif
+}
+
+//! \}
@@ -0,0 +1,39 @@
+// $Id$
+/*
+ * FreeRTOS trace hooks of the FreeRTOS Utility Functions
+ *
+ * Include this file at the end of your mios32_config.h file to connect
+ * the trace ring buffer and response time histograms to the kernel:
+ *
+ *   #define FREERTOS_UTILS_TRACE_SIZE 1024
+ *   #include <freertos_utils_trace.h>
+ *
+ * It's also included by FreeRTOSConfig.h before the MIOS32 datatypes are
+ * available, therefore only plain C types are used here.
+ *
+ * ==========================================================================
+ *
+ *  Copyright (C) 2026 agent (agent@local)
+ *  Licensed for personal non-commercial use only.
+ *  All other rights reserved.
+ *
+ * ==========================================================================
+ */
+
+#ifndef _FREERTOS_UTILS_TRACE_H
+#define _FREERTOS_UTILS_TRACE_H
+
+#if FREERTOS_UTILS_TRACE_SIZE
+
+extern void FREERTOS_UTILS_TraceTaskSwitchedIn(void *task_handle);
+extern void FREERTOS_UTILS_TraceTaskReady(void *task_handle);
+extern void FREERTOS_UTILS_TraceQueueBlock(void *queue, unsigned char send);
+
+#define traceTASK_SWITCHED_IN()                 FREERTOS_UTILS_TraceTaskSwitchedIn(pxCurrentTCB)
+#define traceMOVED_TASK_TO_READY_STATE(pxTCB)   FREERTOS_UTILS_TraceTaskReady(pxTCB)
+#define traceBLOCKING_ON_QUEUE_RECEIVE(pxQueue) FREERTOS_UTILS_TraceQueueBlock(pxQueue, 0)
+#define traceBLOCKING_ON_QUEUE_SEND(pxQueue)    FREERTOS_UTILS_TraceQueueBlock(pxQueue, 1)
+
+#endif
+
+#endif /* _FREERTOS_UTILS_TRACE_H */
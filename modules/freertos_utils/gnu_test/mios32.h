@@ -0,0 +1,32 @@
+// minimal MIOS32 environment to compile freertos_utils_trace.c on the host
+#ifndef _MIOS32_H
+#define _MIOS32_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+typedef uint8_t  u8;
+typedef uint16_t u16;
+typedef uint32_t u32;
+typedef int32_t  s32;
+typedef u8 mios32_midi_port_t;
+
+// trace configuration
+#define FREERTOS_UTILS_TRACE_SIZE 256
+#define FREERTOS_UTILS_TRACE_MAX_TASKS 8
+#define FREERTOS_UTILS_TRACE_TIMESTAMP() (test_cycles)
+#define FREERTOS_UTILS_TRACE_TIMESTAMP_FREQUENCY 100000000 // 100 MHz
+extern u32 test_cycles;
+
+#define MIOS32_MIDI_SYSEX_DEBUG 0x0d
+extern const u8 mios32_midi_sysex_header[5];
+
+#define MIOS32_IRQ_Disable() do {} while(0)
+#define MIOS32_IRQ_Enable()  do {} while(0)
+
+extern u8  MIOS32_MIDI_DeviceIDGet(void);
+extern s32 MIOS32_MIDI_SendSysEx(mios32_midi_port_t port, u8 *stream, u32 count);
+extern s32 MIOS32_MIDI_SendDebugString(const char *str);
+#define MIOS32_MIDI_SendDebugMessage(...) (printf(__VA_ARGS__), 0)
+
+#endif /* _MIOS32_H */
@@ -0,0 +1,3 @@
+// task handles of the host test are pointers to the task names
+typedef void *TaskHandle_t;
+#define pcTaskGetName(handle) ((char *)(handle))
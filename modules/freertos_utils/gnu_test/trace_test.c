@@ -0,0 +1,198 @@
+// Host test of the FreeRTOS trace capture
+//
+// Replays a synthetic schedule through the kernel hooks, checks the
+// response time histograms and writes the SysEx dump into a file
+// which can be converted with ../tools/trace_decode
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "mios32.h"
+#include "../freertos_utils.h"
+
+#define CYCLES_PER_US 100
+
+u32 test_cycles;
+const u8 mios32_midi_sysex_header[5] = { 0xf0, 0x00, 0x00, 0x7e, 0x32 };
+
+static FILE *syx_file;
+static int errors;
+
+// task handles are the task names (see task.h)
+static char task_idle[] = "IDLE";
+static char task_period[] = "Period1mS";
+static char task_midi[] = "MIDI";
+static char task_sd[] = "SD";
+
+// ------- MIOS32 stubs -------
+u8 MIOS32_MIDI_DeviceIDGet(void)
+{
+  return 0x00;
+}
+
+s32 MIOS32_MIDI_SendSysEx(mios32_midi_port_t port, u8 *stream, u32 count)
+{
+  if( stream[0] != 0xf0 || stream[count-1] != 0xf7 ) {
+    printf("ERROR: invalid SysEx frame\n");
+    ++errors;
+  }
+  u32 i;
+  for(i=1; i<count-1; ++i) {
+    if( stream[i] & 0x80 ) {
+      printf("ERROR: SysEx data byte > 0x7f\n");
+      ++errors;
+      break;
+    }
+  }
+  fwrite(stream, 1, count, syx_file);
+  return 0;
+}
+
+s32 MIOS32_MIDI_SendDebugString(const char *str)
+{
+  printf("%s", str);
+  return 0;
+}
+
+
+// ------- local helpers -------
+static void run_us(u32 us)
+{
+  test_cycles += us * CYCLES_PER_US;
+}
+
+// reverts the 7bit encoding of a dump block until F7
+static int decode7(u8 *in, u8 *msg, size_t max_len, u8 *out)
+{
+  int len = 0;
+  while( (in - msg) < max_len && *in != 0xf7 ) {
+    u8 msbs = *in++;
+    int i;
+    for(i=0; i<7 && (in - msg) < max_len && *in != 0xf7; ++i)
+      out[len++] = *in++ | ((msbs & (1 << i)) ? 0x80 : 0x00);
+  }
+  return len;
+}
+
+static void check(int condition, const char *msg)
+{
+  if( !condition ) {
+    printf("ERROR: %s\n", msg);
+    ++errors;
+  }
+}
+
+
+// ------- main -------
+int main(int argc, char *argv[])
+{
+  const char *filename = (argc >= 2) ? argv[1] : "trace.syx";
+  int tick;
+
+  check(FREERTOS_UTILS_TraceInit(0) == 0, "TraceInit failed");
+
+  // task creation
+  FREERTOS_UTILS_TraceTaskReady(task_idle);
+  FREERTOS_UTILS_TraceTaskReady(task_period);
+  FREERTOS_UTILS_TraceTaskReady(task_midi);
+  FREERTOS_UTILS_TraceTaskReady(task_sd);
+  FREERTOS_UTILS_TraceTaskSwitchedIn(task_idle);
+
+  // 100 mS: Period1mS is woken up each mS and served after 20 uS,
+  // MIDI receives data every 10 mS and is served after 5 uS,
+  // except at tick 50 where a long SD access delays it by 2 mS
+  // (the first MIDI wakeup is the task creation, served after 75 uS)
+  for(tick=0; tick<100; ++tick) {
+    FREERTOS_UTILS_TRACE_ISR_ENTER(1); // SysTick
+    FREERTOS_UTILS_TraceTaskReady(task_period);
+    FREERTOS_UTILS_TRACE_ISR_EXIT(1);
+    run_us(20);
+    FREERTOS_UTILS_TraceTaskSwitchedIn(task_period);
+    run_us(50);
+    FREERTOS_UTILS_TraceQueueBlock((void *)0x20001234, 0);
+
+    if( (tick % 10) == 0 ) {
+      FREERTOS_UTILS_TraceTaskReady(task_midi);
+      if( tick == 50 ) {
+	FREERTOS_UTILS_TraceTaskSwitchedIn(task_sd);
+	run_us(2000 - 200);
+	FREERTOS_UTILS_TraceEvent(FREERTOS_UTILS_TRACE_EVENT_USER, 42);
+	run_us(200);
+      } else {
+	run_us(5);
+      }
+      FREERTOS_UTILS_TraceTaskSwitchedIn(task_midi);
+      run_us(30);
+    }
+
+    FREERTOS_UTILS_TraceTaskSwitchedIn(task_idle);
+    run_us(tick == 50 ? 0 : 900);
+  }
+
+  // the scheduler selecting the running task again shouldn't be recorded
+  FREERTOS_UTILS_TraceTaskSwitchedIn(task_idle);
+
+  // stopped trace ignores events
+  FREERTOS_UTILS_TraceStop();
+  FREERTOS_UTILS_TraceTaskReady(task_midi);
+  FREERTOS_UTILS_TraceStart();
+
+  syx_file = fopen(filename, "wb");
+  if( !syx_file ) {
+    printf("ERROR: can't create %s\n", filename);
+    return 1;
+  }
+  check(FREERTOS_UTILS_TraceDump(0) >= 0, "TraceDump failed");
+  fclose(syx_file);
+
+  // check the histograms via the terminal output
+  FREERTOS_UTILS_TraceHistogramsPrint();
+
+  // decode the dump again to check the counters
+  FILE *f = fopen(filename, "rb");
+  static u8 buffer[65536];
+  size_t len = fread(buffer, 1, sizeof(buffer), f);
+  fclose(f);
+
+  int messages = 0, record_blocks = 0;
+  u32 num_records = 0;
+  size_t i;
+  for(i=0; i<len; ++i) {
+    if( buffer[i] != 0xf0 )
+      continue;
+    ++messages;
+
+    // F0 00 00 7E 32 <device> 0D 42 <block type> <7bit encoded data> F7
+    u8 *msg = &buffer[i];
+    u8 data[256];
+    int data_len = decode7(&msg[9], msg, len - i, data);
+    switch( msg[8] ) {
+    case 0x00: num_records = data[6] | (data[7] << 8) | (data[8] << 16) | (data[9] << 24); break;
+    case 0x02: ++record_blocks; break;
+    case 0x03: {
+      u32 max_us = data[1] | (data[2] << 8) | (data[3] << 16) | (data[4] << 24);
+      u16 *bins = (u16 *)&data[5]; // little endian host
+      check(data_len == 5 + 2*FREERTOS_UTILS_TRACE_HISTOGRAM_BINS, "histogram block length");
+      if( data[0] == 1 ) { // Period1mS
+	check(bins[5] == 100, "Period1mS: 100 wakeups in 16..31 uS expected");
+	check(max_us == 20, "Period1mS: max response time 20 uS expected");
+      } else if( data[0] == 2 ) { // MIDI
+	check(bins[3] == 8, "MIDI: 8 wakeups in 4..7 uS expected");
+	check(bins[7] == 1, "MIDI: 1 wakeup in 64..127 uS expected (task creation)");
+	check(bins[11] == 1, "MIDI: 1 wakeup in 1024..2047 uS expected");
+	check(max_us == 2000, "MIDI: max response time 2000 uS expected");
+      }
+    } break;
+    }
+  }
+
+  check(num_records == FREERTOS_UTILS_TRACE_SIZE, "ring buffer should have been wrapped");
+  check(record_blocks == FREERTOS_UTILS_TRACE_SIZE/16, "unexpected number of record blocks");
+  // header + 4 tasks + record blocks + 4 histograms + end
+  check(messages == 1 + 4 + FREERTOS_UTILS_TRACE_SIZE/16 + 4 + 1, "unexpected number of SysEx messages");
+
+  printf("%d SysEx messages written to %s\n", messages, filename);
+  printf(errors ? "FAILED with %d errors\n" : "PASSED\n", errors);
+
+  return errors ? 1 : 0;
+}
@@ -0,0 +1,327 @@
+// $Id$
+/*
+ * Decoder for trace dumps of FREERTOS_UTILS_TraceDump()
+ *
+ * Reads a SysEx file (e.g. captured with the SysEx tool of MIOS Studio,
+ * or with "amidi -d -p <port> > dump.syx"), and prints the recorded events
+ * as timeline, followed by the response time histograms of all tasks.
+ * Other SysEx messages (e.g. terminal output) are skipped.
+ *
+ * Compile with:
+ *   gcc trace_decode.c -o trace_decode
+ *
+ * Usage:
+ *   trace_decode [--csv] <file.syx>
+ *
+ * ==========================================================================
+ *
+ *  Copyright (C) 2026 agent (agent@local)
+ *  Licensed for personal non-commercial use only.
+ *  All other rights reserved.
+ *
+ * ==========================================================================
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Local definitions (see freertos_utils.h and freertos_utils_trace.c)
+/////////////////////////////////////////////////////////////////////////////
+
+#define TRACE_SYSEX_CMD           0x42
+
+#define TRACE_DUMP_VERSION        1
+#define TRACE_DUMP_BLOCK_HEADER   0x00
+#define TRACE_DUMP_BLOCK_TASK     0x01
+#define TRACE_DUMP_BLOCK_RECORDS  0x02
+#define TRACE_DUMP_BLOCK_HISTO    0x03
+#define TRACE_DUMP_BLOCK_END      0x7f
+
+#define MAX_TASKS    256
+#define MAX_BINS     32
+#define TASK_UNKNOWN 0xff
+
+typedef struct {
+  uint32_t seq;
+  uint32_t timestamp;
+  uint8_t  event;
+  uint8_t  task;
+  uint16_t param;
+} record_t;
+
+static const char *event_names[] = {
+  "none",
+  "switched in",
+  "made ready",
+  "ISR enter",
+  "ISR exit",
+  "blocked on queue receive",
+  "blocked on queue send",
+  "user event",
+};
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Local variables
+/////////////////////////////////////////////////////////////////////////////
+
+static uint32_t frequency;
+static uint32_t num_records_announced;
+static int num_bins;
+static int dump_complete;
+
+static char task_names[MAX_TASKS][17];
+static uint32_t task_max_us[MAX_TASKS];
+static uint16_t task_bins[MAX_TASKS][MAX_BINS];
+static int num_tasks;
+
+static record_t *records;
+static uint32_t num_records;
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Helpers
+/////////////////////////////////////////////////////////////////////////////
+
+static uint32_t get32(const uint8_t *p)
+{
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint16_t get16(const uint8_t *p)
+{
+  return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static const char *task_name(uint8_t task)
+{
+  if( task == TASK_UNKNOWN || task >= num_tasks || !task_names[task][0] )
+    return "?";
+  return task_names[task];
+}
+
+// reverts the 7bit encoding: each group of 7 bytes is preceded by their MSBs
+static int decode7(const uint8_t *in, int in_len, uint8_t *out)
+{
+  int len = 0;
+  while( in_len > 0 ) {
+    uint8_t msbs = *in++;
+    --in_len;
+    int i;
+    for(i=0; i<7 && in_len > 0; ++i, --in_len)
+      out[len++] = *in++ | ((msbs & (1 << i)) ? 0x80 : 0x00);
+  }
+  return len;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Parses the payload of a trace block
+/////////////////////////////////////////////////////////////////////////////
+static int parse_block(uint8_t type, const uint8_t *data, int len)
+{
+  switch( type ) {
+  case TRACE_DUMP_BLOCK_HEADER:
+    if( len < 11 || data[0] != TRACE_DUMP_VERSION ) {
+      fprintf(stderr, "ERROR: unsupported dump version %d\n", len ? data[0] : -1);
+      return -1;
+    }
+    num_tasks = data[1];
+    frequency = get32(&data[2]);
+    num_records_announced = get32(&data[6]);
+    num_bins = data[10] > MAX_BINS ? MAX_BINS : data[10];
+    num_records = 0;
+    dump_complete = 0;
+    free(records);
+    records = calloc(num_records_announced ? num_records_announced : 1, sizeof(record_t));
+    memset(task_names, 0, sizeof(task_names));
+    break;
+
+  case TRACE_DUMP_BLOCK_TASK:
+    if( len >= 1 + 16 ) {
+      memcpy(task_names[data[0]], &data[1], 16);
+      task_names[data[0]][16] = 0;
+    }
+    break;
+
+  case TRACE_DUMP_BLOCK_RECORDS: {
+    if( len < 4 || !records )
+      return -1;
+    uint32_t seq = get32(data);
+    const uint8_t *p = &data[4];
+    for(len -= 4; len >= 8 && num_records < num_records_announced; len -= 8, p += 8) {
+      record_t *r = &records[num_records++];
+      r->seq = seq++;
+      r->timestamp = get32(p);
+      r->event = p[4];
+      r->task = p[5];
+      r->param = get16(&p[6]);
+    }
+  } break;
+
+  case TRACE_DUMP_BLOCK_HISTO:
+    if( len >= 5 + 2*num_bins ) {
+      int bin;
+      task_max_us[data[0]] = get32(&data[1]);
+      for(bin=0; bin<num_bins; ++bin)
+	task_bins[data[0]][bin] = get16(&data[5 + 2*bin]);
+    }
+    break;
+
+  case TRACE_DUMP_BLOCK_END:
+    dump_complete = 1;
+    break;
+  }
+
+  return 0;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Prints the timeline
+/////////////////////////////////////////////////////////////////////////////
+static void print_timeline(int csv)
+{
+  uint64_t time = 0;
+  uint32_t i;
+
+  if( csv )
+    printf("seq,time_us,task,event,param\n");
+  else
+    printf("# %u events, timestamp frequency %u Hz\n#\n#   time [uS]    delta [uS]  task             event\n",
+	   num_records, frequency);
+
+  for(i=0; i<num_records; ++i) {
+    record_t *r = &records[i];
+    uint32_t delta = i ? (r->timestamp - records[i-1].timestamp) : 0; // unsigned difference handles the counter overflow
+    time += delta;
+    double t_us = frequency ? (double)time * 1000000.0 / frequency : (double)time;
+    double d_us = frequency ? (double)delta * 1000000.0 / frequency : (double)delta;
+
+    const char *ev = (r->event < sizeof(event_names)/sizeof(event_names[0])) ? event_names[r->event] : "unknown";
+    char param[64];
+    switch( r->event ) {
+    case 1: // switched in
+      if( r->param == 0xffff )
+	strcpy(param, "");
+      else
+	sprintf(param, "response %u uS", r->param);
+      break;
+    case 2: // made ready
+      sprintf(param, "%s", task_name((uint8_t)r->param));
+      break;
+    case 5: case 6: // queue
+      sprintf(param, "queue 0x%04x", r->param);
+      break;
+    default:
+      sprintf(param, "%u", r->param);
+    }
+
+    if( csv )
+      printf("%u,%.3f,%s,%s,%s\n", r->seq, t_us, task_name(r->task), ev, param);
+    else
+      printf("%13.3f %13.3f  %-16s %s%s%s\n", t_us, d_us, task_name(r->task), ev, param[0] ? " " : "", param);
+  }
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Prints the histograms
+/////////////////////////////////////////////////////////////////////////////
+static void print_histograms(void)
+{
+  int task, bin;
+
+  printf("#\n# Task response times (made ready -> switched in)\n");
+  for(task=0; task<num_tasks; ++task) {
+    uint32_t total = 0;
+    for(bin=0; bin<num_bins; ++bin)
+      total += task_bins[task][bin];
+
+    printf("%-16s %6u wakeups, max %u uS\n", task_name(task), total, task_max_us[task]);
+    for(bin=0; bin<num_bins; ++bin) {
+      if( task_bins[task][bin] ) {
+	uint32_t from = bin ? (1u << (bin-1)) : 0;
+	if( bin == num_bins-1 )
+	  printf("  >= %6u uS: %u\n", from, task_bins[task][bin]);
+	else
+	  printf("  %6u..%6u uS: %u\n", from, bin ? (2*from-1) : 0, task_bins[task][bin]);
+      }
+    }
+  }
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Main
+/////////////////////////////////////////////////////////////////////////////
+int main(int argc, char *argv[])
+{
+  int csv = 0;
+  const char *filename = NULL;
+  int i;
+
+  for(i=1; i<argc; ++i) {
+    if( strcmp(argv[i], "--csv") == 0 )
+      csv = 1;
+    else
+      filename = argv[i];
+  }
+
+  if( !filename ) {
+    fprintf(stderr, "Usage: %s [--csv] <file.syx>\n", argv[0]);
+    return 1;
+  }
+
+  FILE *f = fopen(filename, "rb");
+  if( !f ) {
+    fprintf(stderr, "ERROR: can't open %s\n", filename);
+    return 1;
+  }
+
+  // collect SysEx messages
+  static uint8_t msg[4096];
+  static uint8_t payload[4096];
+  int msg_len = -1; // -1: outside of SysEx
+  int c;
+  while( (c=fgetc(f)) != EOF ) {
+    if( c == 0xf0 ) {
+      msg_len = 0;
+    } else if( c == 0xf7 ) {
+      // MIOS32 debug message with trace command?
+      // 00 00 7e 32 <device-id> 0d 42 <block type> <7bit encoded data>
+      if( msg_len >= 8 && msg[0] == 0x00 && msg[1] == 0x00 && msg[2] == 0x7e && msg[3] == 0x32 &&
+	  msg[5] == 0x0d && msg[6] == TRACE_SYSEX_CMD ) {
+	int len = decode7(&msg[8], msg_len - 8, payload);
+	if( parse_block(msg[7], payload, len) < 0 ) {
+	  fclose(f);
+	  return 1;
+	}
+      }
+      msg_len = -1;
+    } else if( msg_len >= 0 && msg_len < (int)sizeof(msg) ) {
+      msg[msg_len++] = (uint8_t)c;
+    }
+  }
+  fclose(f);
+
+  if( !records ) {
+    fprintf(stderr, "ERROR: no trace dump found in %s\n", filename);
+    return 1;
+  }
+
+  if( !dump_complete || num_records != num_records_announced )
+    fprintf(stderr, "WARNING: dump incomplete, got %u of %u events\n", num_records, num_records_announced);
+
+  print_timeline(csv);
+  if( !csv )
+    print_histograms();
+
+  free(records);
+
+  return 0;
+}
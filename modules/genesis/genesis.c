@@ -248,6 +248,59 @@ void Genesis_PSGWrite(u8 board, u8 data){
     MIOS32_IRQ_Enable(); //Turn on interrupts
 }
 
+u8 Genesis_OPN2WriteIsRedundant(u8 board, u8 addrhi, u8 address, u8 data){
+    board &= 0x03;
+    addrhi &= 0x01;
+    u8 chan, op, reg;
+    if(address >= 0x30 && address <= 0x9F){
+        //Operator registers
+        chan = (address & 0x03);
+        if(chan == 0x03) return 0;
+        chan += addrhi + (addrhi << 1);
+        reg = ((address & 0xF0) >> 4) - 3;
+        op = ((address & 0x08) >> 3) | ((address & 0x04) >> 1);
+        return genesis[board].opn2.chan[chan].op[op].ALL[reg] == data;
+    }else if(address >= 0xB0 && address <= 0xB6){
+        //Algorithm/feedback and output/LFO sensitivity registers. Not the
+        //frequency registers, since writes to those go through the latch which
+        //is shared between channels.
+        chan = (address & 0x03);
+        if(chan == 0x03) return 0;
+        chan += addrhi + (addrhi << 1);
+        reg = ((address & 0x10) >> 3) | ((address & 0x04) >> 2);
+        return genesis[board].opn2.chan[chan].ALL[reg] == data;
+    }else if(!addrhi && address == 0x22){
+        return genesis[board].opn2.lforeg == data;
+    }else if(!addrhi && address == 0x2B){
+        return genesis[board].opn2.dacenablereg == data;
+    }
+    //Key on, timers, DAC data, test registers, and frequencies always have to be written
+    return 0;
+}
+
+u8 Genesis_PSGWriteIsRedundant(u8 board, u8 data){
+    board &= 0x03;
+    u8 addr, voice;
+    if(data & 0x80){
+        addr = (data & 0x70) >> 4;
+        voice = (addr >> 1);
+        //A latch write also changes the latched register
+        if(genesis[board].psg.latchedaddr != addr) return 0;
+        if(addr & 1){
+            return genesis[board].psg.voice[voice].atten == (data & 0x0F);
+        }else if(voice != 3){
+            return (genesis[board].psg.square[voice].freq & 0x000F) == (data & 0x0F);
+        }
+        //Writing the noise register resets the noise generator
+        return 0;
+    }else{
+        addr = genesis[board].psg.latchedaddr;
+        voice = (addr >> 1);
+        if((addr & 1) || voice == 3) return 0;
+        return (genesis[board].psg.square[voice].freq >> 4) == (data & 0x3F);
+    }
+}
+
 u8 Genesis_GetOPN2Status(u8 board){
     board &= 0x03;
     MIOS32_IRQ_Disable(); //Turn off interrupts
@@ -438,6 +438,12 @@ extern void Genesis_OPN2Write(u8 board, u8 addrhi, u8 address, u8 data);
 // Write a value to a PSG.
 extern void Genesis_PSGWrite(u8 board, u8 data);
 
+// Check whether a write would not change the chip state, according to the
+// genesis data structures. Writes which have side effects (key on, timers,
+// frequency latches, noise reset, test registers) are never redundant.
+extern u8 Genesis_OPN2WriteIsRedundant(u8 board, u8 addrhi, u8 address, u8 data);
+extern u8 Genesis_PSGWriteIsRedundant(u8 board, u8 data);
+
 // Read data back from the OPN2 (usually the status, unless you've been playing
 // with the test registers).
 extern u8 Genesis_GetOPN2Status(u8 board);
@@ -0,0 +1,323 @@
+// Host test double of the MBHP_Genesis bus
+//
+// genesis.c is compiled against GPIO ports in memory. The timeouts of its
+// wait loops call Bus_WaitLoop() (see mios32.h), which counts every
+// busy-wait iteration as 4 CPU cycles and decodes the bus state on each
+// /CS+/WR strobe. The decoded writes are applied to a register model of the
+// OPN2 and PSG chips, which also checks that no write hits a busy chip.
+//
+// The writes are scheduled like VgmPlayer_WorkCallback() does: each board
+// has a stream of writes, a chip is only written once its busy delay since
+// the last write has elapsed, and meanwhile the other boards are served.
+// The workload is a 60 Hz frame with tremolo, vibrato, patch reloads on
+// each note and PSG envelopes on all 4 boards. It's played with and without
+// dropping the writes which Genesis_OPN2WriteIsRedundant() and
+// Genesis_PSGWriteIsRedundant() detect. Both runs have to end with the
+// same chip registers.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "mios32.h"
+#include "genesis.h"
+
+#define NUM_BOARDS   4
+#define NUM_FRAMES   600
+#define FRAME_TICKS  (84000000/60) // TIM2 runs at 84 MHz
+#define QUEUE_SIZE   512
+
+// busy delays in TIM2 ticks, as in vgmplayer.h
+#define PSG_BUSYDELAY  672
+#define OPN2_BUSYDELAY 2100
+
+typedef struct {
+  u8 psg;
+  u8 addrhi;
+  u8 addr;
+  u8 data;
+} write_t;
+
+typedef struct {
+  u8 opn2[2][256];
+  u8 opn2_latch[2];
+  u8 psg[8]; // frequency (low 4 bits) / attenuation per latch address
+  u16 psg_freq[3];
+  u8 psg_latch;
+} chip_t;
+
+GPIO_TypeDef test_gpioc;
+GPIO_TypeDef test_gpioe;
+TIM_TypeDef test_tim2;
+
+static u64 ticks; // simulated TIM2 time
+static chip_t chips[NUM_BOARDS];
+static u64 opn2_ready[NUM_BOARDS];
+static u64 psg_ready[NUM_BOARDS];
+static u8 strobe_active;
+
+static write_t queue[NUM_BOARDS][QUEUE_SIZE];
+static u32 queue_head[NUM_BOARDS];
+static u32 queue_tail[NUM_BOARDS];
+
+typedef struct {
+  u32 opn2_writes;
+  u32 psg_writes;
+  u32 dropped;
+  u32 busy_violations;
+  u64 wait_loops;
+  u64 idle_ticks;
+  u64 max_frame_ticks;
+  u64 total_frame_ticks;
+} stats_t;
+
+static stats_t stats;
+static int errors;
+
+
+// ------- bus test double -------
+static void bus_strobe(void)
+{
+  u32 e = test_gpioe.ODR;
+  u8 board = (e >> 6) & 0x03;
+  u8 value = (e >> 8) & 0xff;
+  chip_t *c = &chips[board];
+
+  if( !(e & 0x20) ) {
+    // OPN2
+    u8 addrhi = (e >> 4) & 1;
+    if( !(e & 0x04) ) {
+      c->opn2_latch[addrhi] = value;
+    } else {
+      u8 addr = c->opn2_latch[addrhi];
+      if( ticks < opn2_ready[board] )
+	++stats.busy_violations;
+      c->opn2[addrhi][addr] = value;
+      ++stats.opn2_writes;
+      // no busy time after the global registers except key on
+      opn2_ready[board] = (addr >= 0x20 && addr < 0x2f && addr != 0x28) ? ticks : ticks + OPN2_BUSYDELAY;
+    }
+  } else if( !(e & 0x10) ) {
+    // PSG
+    if( ticks < psg_ready[board] )
+      ++stats.busy_violations;
+    if( value & 0x80 ) {
+      c->psg_latch = (value >> 4) & 0x07;
+      c->psg[c->psg_latch] = value & 0x0f;
+    } else if( !(c->psg_latch & 1) && c->psg_latch < 6 ) {
+      c->psg_freq[c->psg_latch >> 1] = (u16)(value & 0x3f) << 4;
+    }
+    ++stats.psg_writes;
+    psg_ready[board] = ticks + PSG_BUSYDELAY;
+  }
+  // else: board bits
+}
+
+void Bus_Delay_uS(u32 us)
+{
+  ticks += 84*us;
+}
+
+u32 Bus_WaitLoop(u32 timeout)
+{
+  u8 strobe = !(test_gpioc.ODR & 0x2000) && !(test_gpioc.ODR & 0x8000); // /CS and /WR low
+
+  if( strobe && !strobe_active )
+    bus_strobe();
+  strobe_active = strobe;
+
+  // one iteration: 4 CPU cycles at 168 MHz
+  ++stats.wait_loops;
+  ticks += 2;
+  test_tim2.CNT = (u32)ticks;
+
+  return timeout;
+}
+
+
+// ------- workload -------
+static void enqueue(u8 board, u8 psg, u8 addrhi, u8 addr, u8 data)
+{
+  write_t *w = &queue[board][queue_tail[board]++ % QUEUE_SIZE];
+  w->psg = psg;
+  w->addrhi = addrhi;
+  w->addr = addr;
+  w->data = data;
+}
+
+static void opn2_write(u8 board, u8 ch, u8 reg, u8 data)
+{
+  enqueue(board, 0, ch / 3, reg + (ch % 3), data);
+}
+
+static void frame_writes(u32 frame, u8 board)
+{
+  static const u8 op_offset[4] = { 0x0, 0x8, 0x4, 0xc };
+  u8 ch, op, v;
+
+  for(ch=0; ch<6; ++ch) {
+    u8 key = (ch < 3) ? ch : (ch + 1);
+    u16 fnum = 0x269 + (u16)(6.0 * sin(frame * 0.3 + ch)); // vibrato
+
+    // a new note every 8 frames: the tracker reloads the patch
+    if( ((frame + ch + board) % 8) == 0 ) {
+      enqueue(board, 0, 0, 0x28, key); // key off
+      for(op=0; op<4; ++op) {
+	u8 r = op_offset[op];
+	opn2_write(board, ch, 0x30 + r, 0x71 - op);
+	opn2_write(board, ch, 0x40 + r, (op == 3) ? 0x00 : 0x23 + 4*op);
+	opn2_write(board, ch, 0x50 + r, 0x5f);
+	opn2_write(board, ch, 0x60 + r, 0x05 + op);
+	opn2_write(board, ch, 0x70 + r, 0x02);
+	opn2_write(board, ch, 0x80 + r, 0x11 + 0x10*op);
+	opn2_write(board, ch, 0x90 + r, 0x00);
+      }
+      opn2_write(board, ch, 0xb0, 0x32);
+      opn2_write(board, ch, 0xb4, 0xc0);
+    }
+
+    // tremolo on the carrier
+    opn2_write(board, ch, 0x4c, (u8)(4.0 + 4.0 * sin(frame * 0.05 + ch)));
+    opn2_write(board, ch, 0xa4, 0x20 | (fnum >> 8));
+    opn2_write(board, ch, 0xa0, fnum & 0xff);
+
+    if( ((frame + ch + board) % 8) == 0 )
+      enqueue(board, 0, 0, 0x28, 0xf0 | key); // key on
+  }
+
+  // PSG: frequencies on new notes, decaying attenuation
+  for(v=0; v<3; ++v) {
+    if( ((frame + v) % 8) == 0 ) {
+      u16 freq = 0x0fe + 0x20*v + (frame % 5);
+      enqueue(board, 1, 0, 0, 0x80 | (v << 5) | (freq & 0x0f));
+      enqueue(board, 1, 0, 0, (freq >> 4) & 0x3f);
+    }
+    enqueue(board, 1, 0, 0, 0x90 | (v << 5) | (((frame + v) % 32) / 4 + 2*v));
+  }
+}
+
+
+// ------- scheduler -------
+static u8 redundant(u8 board, write_t *w)
+{
+  return w->psg ? Genesis_PSGWriteIsRedundant(board, w->data)
+                : Genesis_OPN2WriteIsRedundant(board, w->addrhi, w->addr, w->data);
+}
+
+// writes all queued requests, like VgmPlayer_WorkCallback()
+static void drain(u8 drop_redundant)
+{
+  while( 1 ) {
+    u8 board, pending = 0, wrote = 0;
+    u64 minwait = ~0ull;
+
+    for(board=0; board<NUM_BOARDS; ++board) {
+      write_t *w;
+      if( queue_head[board] == queue_tail[board] )
+	continue;
+      pending = 1;
+      w = &queue[board][queue_head[board] % QUEUE_SIZE];
+
+      if( drop_redundant && redundant(board, w) ) {
+	++stats.dropped;
+	++queue_head[board];
+	wrote = 1;
+      } else {
+	u64 ready = w->psg ? psg_ready[board] : opn2_ready[board];
+	if( ticks < ready ) {
+	  if( ready - ticks < minwait )
+	    minwait = ready - ticks;
+	} else {
+	  if( w->psg )
+	    Genesis_PSGWrite(board, w->data);
+	  else
+	    Genesis_OPN2Write(board, w->addrhi, w->addr, w->data);
+	  ++queue_head[board];
+	  wrote = 1;
+	}
+      }
+    }
+
+    if( !pending )
+      return;
+
+    if( !wrote ) {
+      // all chips with pending writes are busy: the work timer waits
+      ticks += minwait;
+      stats.idle_ticks += minwait;
+    }
+  }
+}
+
+static void run(u8 drop_redundant, chip_t *result)
+{
+  u32 frame;
+  u8 board;
+
+  memset(&stats, 0, sizeof(stats));
+  memset(chips, 0, sizeof(chips));
+  for(board=0; board<NUM_BOARDS; ++board) {
+    // the output bits of all channels are set after a reset
+    memset(&chips[board].opn2[0][0xb4], 0xc0, 3);
+    memset(&chips[board].opn2[1][0xb4], 0xc0, 3);
+  }
+  memset(opn2_ready, 0, sizeof(opn2_ready));
+  memset(psg_ready, 0, sizeof(psg_ready));
+  ticks = 0;
+  Genesis_Init();
+
+  for(frame=0; frame<NUM_FRAMES; ++frame) {
+    u64 start = (u64)(frame + 1) * FRAME_TICKS;
+    if( ticks < start ) {
+      ticks = start;
+    }
+    for(board=0; board<NUM_BOARDS; ++board)
+      frame_writes(frame, board);
+    drain(drop_redundant);
+
+    start = ticks - start;
+    stats.total_frame_ticks += start;
+    if( start > stats.max_frame_ticks )
+      stats.max_frame_ticks = start;
+  }
+
+  memcpy(result, chips, sizeof(chips));
+
+  printf("%-18s %7u %6u %8u %11.1f %9.1f %8.1f %6u\n",
+	 drop_redundant ? "drop redundant" : "write everything",
+	 stats.opn2_writes / NUM_FRAMES, stats.psg_writes / NUM_FRAMES, stats.dropped / NUM_FRAMES,
+	 (double)stats.wait_loops / NUM_FRAMES,
+	 100.0 * stats.total_frame_ticks / NUM_FRAMES / FRAME_TICKS,
+	 100.0 * stats.max_frame_ticks / FRAME_TICKS,
+	 stats.busy_violations);
+
+  if( stats.busy_violations ) {
+    printf("ERROR: writes to busy chips\n");
+    ++errors;
+  }
+}
+
+
+int main(int argc, char *argv[])
+{
+  static chip_t chips_all[NUM_BOARDS], chips_dropped[NUM_BOARDS];
+
+  printf("%d boards, %d frames at 60 Hz, per frame:\n", NUM_BOARDS, NUM_FRAMES);
+  printf("%-18s %7s %6s %8s %11s %9s %8s %6s\n",
+	 "", "OPN2 wr", "PSG wr", "dropped", "wait loops", "load %", "max %", "busy");
+  run(0, chips_all);
+  run(1, chips_dropped);
+
+  if( memcmp(chips_all, chips_dropped, sizeof(chips_all)) != 0 ) {
+    printf("ERROR: dropping redundant writes changed the chip registers\n");
+    ++errors;
+  }
+
+  if( errors ) {
+    printf("%d errors\n", errors);
+    return 1;
+  }
+
+  printf("Genesis bus simulation passed.\n");
+  return 0;
+}
@@ -0,0 +1,55 @@
+// minimal MIOS32 environment to compile genesis.c on the host
+#ifndef _MIOS32_H
+#define _MIOS32_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+typedef uint8_t  u8;
+typedef uint16_t u16;
+typedef uint32_t u32;
+typedef uint64_t u64;
+typedef int8_t   s8;
+typedef int16_t  s16;
+typedef int32_t  s32;
+
+#define MIOS32_BOARD_MBHP_CORE_STM32F4
+#define GENESIS_COUNT 4
+
+#define MIOS32_IRQ_Disable() do {} while(0)
+#define MIOS32_IRQ_Enable()  do {} while(0)
+
+// advances the simulated time
+extern void Bus_Delay_uS(u32 us);
+#define MIOS32_DELAY_Wait_uS(us) Bus_Delay_uS(us)
+
+// GPIO ports of the bus, observed by the test double in bus_sim.c
+typedef struct {
+  u32 MODER;
+  u32 OTYPER;
+  u32 OSPEEDR;
+  u32 PUPDR;
+  u32 IDR;
+  u32 ODR;
+} GPIO_TypeDef;
+
+typedef struct {
+  u32 CNT;
+} TIM_TypeDef;
+
+extern GPIO_TypeDef test_gpioc;
+extern GPIO_TypeDef test_gpioe;
+extern TIM_TypeDef test_tim2;
+#define GPIOC (&test_gpioc)
+#define GPIOE (&test_gpioe)
+#define TIM2  (&test_tim2)
+
+// Each iteration of the wait loops of genesis.c evaluates the timeout, so the
+// test double sees every busy-wait cycle, and the bus state during the strobes
+extern u32 Bus_WaitLoop(u32 timeout);
+#define GENESIS_OPN2_WRITETIMEOUT Bus_WaitLoop(256)
+#define GENESIS_PSG_WRITETIMEOUT  Bus_WaitLoop(28)
+#define GENESIS_SHORTWAITTIME     Bus_WaitLoop(28)
+
+#endif /* _MIOS32_H */
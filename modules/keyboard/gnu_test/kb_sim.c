@@ -0,0 +1,439 @@
+// Host simulation of a break/make keyboard matrix
+//
+// keyboard.c is compiled on the host. The 64 keys of the default keyboard
+// (8 rows, 2 DIN SRs, rows 0/2/4/6 are make and 1/3/5/7 are break
+// contacts) are played by a script of key strikes. Each strike closes the
+// break contact, then the make contact after the travel time. On release,
+// the make contact opens first, then the break contact.
+//
+// The SRIO chain is scanned back to back, as in midibox_kb_v1: each scan
+// takes 32 uS, with some jitter and occasional delays by other interrupts.
+// The DIN value of a scan belongs to the row which was selected by the
+// previous scan. KEYBOARD_Periodic_1mS() is called each mS.
+//
+// The velocity which is sent for each strike is compared with the ideal
+// velocity of the real travel time (linear curve, same delay_fastest and
+// delay_slowest). The makefile builds this harness twice: with the SRIO
+// scan counter as timestamp (default), and with a free running 1 MHz timer
+// (KEYBOARD_TIMESTAMP_GET, KB_SIM_TIMER=1).
+//
+// Afterwards the recorded DIN values are replayed without the matrix
+// model to measure the CPU time of the keyboard driver per scan. The replay
+// has to send the same MIDI events.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "mios32.h"
+#include "keyboard.h"
+
+#define NUM_KEYS       64
+#define NUM_STRIKES    3000
+#define NOTE_OFFSET    36
+#define MAX_SCANS      4000000
+
+// nominal scan time and velocity delays in uS
+#define SCAN_NS               32000
+#define DELAY_FASTEST         1600
+#define DELAY_SLOWEST         32000
+#define DELAY_FASTEST_RELEASE 4800
+#define DELAY_SLOWEST_RELEASE 32000
+
+typedef struct {
+  u8  key;
+  u64 t_break;      // break contact closed (nS)
+  u64 t_make;       // make contact closed
+  u64 t_release;    // make contact opened
+  u64 t_break_open; // break contact opened
+  int vel_on;       // sent velocities, -1: not sent yet
+  int vel_off;
+  int notes_on;
+  int notes_off;
+} strike_t;
+
+static strike_t strikes[NUM_STRIKES];
+static int key_strike[NUM_KEYS]; // strike which is played on the key, -1: none
+
+static u64 now;               // simulated time (nS)
+static u8  dout_sr[2];
+static u8  latched_row;
+static u16 din_sr;
+static u16 timer_value;
+
+static u16 rec_din[MAX_SCANS];
+static u16 rec_timer[MAX_SCANS];
+static u8  rec_tick[MAX_SCANS];
+static u32 num_scans;
+
+static u32 checksum;
+static u8  replaying;
+static u32 lfsr = 2463534242u;
+static int errors;
+
+
+// ------- MIOS32 stubs -------
+u16 KB_SIM_TimerGet(void)
+{
+  return timer_value;
+}
+
+u8 MIOS32_SRIO_ScanNumGet(void)
+{
+  return 2;
+}
+
+s32 MIOS32_DOUT_SRSet(u32 sr, u8 value)
+{
+  dout_sr[sr & 1] = value;
+  return 0;
+}
+
+s32 MIOS32_DIN_SRGet(u32 sr)
+{
+  return sr ? (din_sr >> 8) : (din_sr & 0xff);
+}
+
+u8 MIOS32_DIN_SRChangedGetAndClear(u32 sr, u8 mask)
+{
+  return 0;
+}
+
+s32 MIOS32_MIDI_SendDebugMessage(const char *format, ...)
+{
+  return 0;
+}
+
+static void add_checksum(u32 value)
+{
+  int i;
+  for(i=0; i<4; ++i, value >>= 8)
+    checksum = (checksum ^ (value & 0xff)) * 16777619u; // FNV-1a
+}
+
+static void note_event(u8 note, int vel_on, int vel_off)
+{
+  int key = note - NOTE_OFFSET;
+  strike_t *s;
+
+  add_checksum((note << 16) | ((vel_on & 0xff) << 8) | (vel_off & 0xff));
+  if( replaying )
+    return;
+
+  if( key < 0 || key >= NUM_KEYS || key_strike[key] < 0 ) {
+    printf("ERROR: note %d sent while the key isn't played\n", note);
+    ++errors;
+    return;
+  }
+
+  s = &strikes[key_strike[key]];
+  if( vel_on >= 0 ) {
+    s->vel_on = vel_on;
+    ++s->notes_on;
+  } else {
+    s->vel_off = vel_off;
+    ++s->notes_off;
+  }
+}
+
+s32 MIOS32_MIDI_SendNoteOn(mios32_midi_port_t port, mios32_midi_chn_t chn, u8 note, u8 vel)
+{
+  // Note On with velocity 0 is a Note Off, also used for the max release velocity
+  if( vel )
+    note_event(note, vel, -1);
+  else
+    note_event(note, -1, 127);
+  return 0;
+}
+
+s32 MIOS32_MIDI_SendNoteOff(mios32_midi_port_t port, mios32_midi_chn_t chn, u8 note, u8 vel)
+{
+  note_event(note, -1, vel);
+  return 0;
+}
+
+
+// ------- key strikes -------
+static u32 random_number(void)
+{
+  lfsr ^= lfsr << 13;
+  lfsr ^= lfsr >> 17;
+  lfsr ^= lfsr << 5;
+  return lfsr;
+}
+
+// random value in uS, returned in nS
+static u64 random_us(u32 min, u32 max)
+{
+  return 1000ull * (min + random_number() % (max - min + 1));
+}
+
+static void init_strikes(void)
+{
+  static u64 key_free[NUM_KEYS];
+  u64 t = 10000000; // the first strike after 10 mS
+  int i;
+
+  for(i=0; i<NUM_STRIKES; ++i) {
+    strike_t *s = &strikes[i];
+    u8 key;
+
+    do {
+      key = random_number() % NUM_KEYS;
+    } while( key_free[key] > t );
+
+    s->key = key;
+    s->t_break = t;
+    s->t_make = t + random_us(DELAY_FASTEST + 200, DELAY_SLOWEST - 2000);
+    s->t_release = s->t_make + random_us(20000, 300000);
+    s->t_break_open = s->t_release + random_us(DELAY_FASTEST_RELEASE + 200, DELAY_SLOWEST_RELEASE - 2000);
+
+    key_free[key] = s->t_break_open + 20000000; // 20 mS until the key is played again
+    t += random_us(2000, 40000); // chords and fast runs
+  }
+}
+
+// key state of the matrix pins of a row, pins are low active
+static u16 matrix_row(u8 row)
+{
+  u16 value = 0xffff;
+  int column;
+
+  for(column=0; column<16; ++column) {
+    int key = ((column >= 8) ? 32 : 0) + 8*(row/2) + (column % 8);
+    int i = key_strike[key];
+    if( i >= 0 ) {
+      strike_t *s = &strikes[i];
+      u8 closed = (row & 1) ? (now >= s->t_break && now < s->t_break_open)
+	                    : (now >= s->t_make && now < s->t_release);
+      if( closed )
+	value &= ~(1 << column);
+    }
+  }
+
+  return value;
+}
+
+// assigns the strikes to the keys which are played now
+static void update_keys(int *next_strike)
+{
+  int key;
+
+  for(key=0; key<NUM_KEYS; ++key) {
+    int i = key_strike[key];
+    // keep the strike assigned until the note off has been sent
+    if( i >= 0 && now > strikes[i].t_break_open + 10000000 )
+      key_strike[key] = -1;
+  }
+
+  while( *next_strike < NUM_STRIKES && strikes[*next_strike].t_break <= now + SCAN_NS ) {
+    key_strike[strikes[*next_strike].key] = *next_strike;
+    ++*next_strike;
+  }
+}
+
+
+// ------- velocity accuracy -------
+static int ideal_velocity(u64 delay_ns, u32 fastest, u32 slowest)
+{
+  double delay = delay_ns / 1000.0;
+  double velocity;
+
+  if( delay <= fastest )
+    return 127;
+  velocity = 127.0 - ((delay - fastest) * 127.0) / (slowest - fastest);
+  if( velocity < 1.0 )
+    velocity = 1.0;
+  return (int)(velocity + 0.5);
+}
+
+static void print_accuracy(const char *name, int release)
+{
+  int i, n = 0, max_err = 0, within1 = 0, missing = 0;
+  double sum_err = 0.0;
+
+  for(i=0; i<NUM_STRIKES; ++i) {
+    strike_t *s = &strikes[i];
+    int measured, ideal, err;
+
+    if( s->notes_on != 1 || s->notes_off != 1 ) {
+      ++missing;
+      continue;
+    }
+
+    if( release ) {
+      measured = s->vel_off;
+      ideal = ideal_velocity(s->t_break_open - s->t_release, DELAY_FASTEST_RELEASE, DELAY_SLOWEST_RELEASE);
+    } else {
+      measured = s->vel_on;
+      ideal = ideal_velocity(s->t_make - s->t_break, DELAY_FASTEST, DELAY_SLOWEST);
+    }
+
+    err = abs(measured - ideal);
+    sum_err += err;
+    if( err > max_err )
+      max_err = err;
+    if( err <= 1 )
+      ++within1;
+    ++n;
+  }
+
+  printf("  %-17s mean error %.2f, max error %d, %.1f%% within +-1\n",
+	 name, n ? sum_err / n : 0.0, max_err, n ? 100.0 * within1 / n : 0.0);
+
+  // with the timer only the row scan period (8 scans) limits the resolution
+  if( KB_SIM_TIMER && max_err > 2 ) {
+    printf("ERROR: velocity error too high\n");
+    ++errors;
+  }
+
+  if( missing ) {
+    printf("ERROR: %d strikes didn't send exactly one Note On and one Note Off\n", missing);
+    ++errors;
+  }
+}
+
+
+// ------- simulation -------
+static void init_keyboard(u8 release_velocity)
+{
+  keyboard_config_t *kc = &keyboard_config[0];
+
+  KEYBOARD_Init(0);
+  kc->verbose_level = 0;
+  kc->note_offset = NOTE_OFFSET;
+  kc->scan_release_velocity = release_velocity;
+#if KB_SIM_TIMER
+  // delays in timer ticks
+  kc->delay_fastest = DELAY_FASTEST;
+  kc->delay_slowest = DELAY_SLOWEST;
+  kc->delay_fastest_release = DELAY_FASTEST_RELEASE;
+  kc->delay_slowest_release = DELAY_SLOWEST_RELEASE;
+#else
+  // delays in scans
+  kc->delay_fastest = DELAY_FASTEST * 1000 / SCAN_NS;
+  kc->delay_slowest = DELAY_SLOWEST * 1000 / SCAN_NS;
+  kc->delay_fastest_release = DELAY_FASTEST_RELEASE * 1000 / SCAN_NS;
+  kc->delay_slowest_release = DELAY_SLOWEST_RELEASE * 1000 / SCAN_NS;
+#endif
+  KEYBOARD_Init(1);
+}
+
+static void play(u8 release_velocity)
+{
+  u64 next_ms = 0;
+  u64 end = 0;
+  int next_strike = 0;
+  int i;
+
+  for(i=0; i<NUM_STRIKES; ++i) {
+    if( strikes[i].t_break_open + 50000000 > end )
+      end = strikes[i].t_break_open + 50000000;
+    strikes[i].vel_on = strikes[i].vel_off = -1;
+    strikes[i].notes_on = strikes[i].notes_off = 0;
+  }
+  for(i=0; i<NUM_KEYS; ++i)
+    key_strike[i] = -1;
+  now = 0;
+  latched_row = 0;
+  num_scans = 0;
+  checksum = 2166136261u;
+  init_keyboard(release_velocity);
+
+  while( now < end && num_scans < MAX_SCANS ) {
+    u32 scan_ns;
+
+    rec_tick[num_scans] = 0;
+    if( now >= next_ms ) {
+      KEYBOARD_Periodic_1mS();
+      next_ms += 1000000;
+      rec_tick[num_scans] = 1;
+    }
+
+    update_keys(&next_strike);
+
+    KEYBOARD_SRIO_ServicePrepare();
+
+    // the DINs are loaded at the begin of the scan with the row which was selected by the previous scan
+    din_sr = matrix_row(latched_row);
+    latched_row = __builtin_ctz(~dout_sr[0] & 0xff);
+
+    // scan time: some jitter, sometimes delayed by other interrupts
+    scan_ns = SCAN_NS - 1000 + random_number() % 2000;
+    if( (random_number() % 100) == 0 )
+      scan_ns += 20000 + random_number() % 80000;
+    now += scan_ns;
+    timer_value = (u16)(now / 1000);
+
+    rec_din[num_scans] = din_sr;
+    rec_timer[num_scans] = timer_value;
+    ++num_scans;
+
+    KEYBOARD_SRIO_ServiceFinish();
+  }
+}
+
+static u64 now_ns(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (u64)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+// replays the recorded DIN values, returns nS per scan
+static double replay(u8 release_velocity)
+{
+  u32 expected_checksum = checksum;
+  u32 scan;
+  u64 t;
+
+  checksum = 2166136261u;
+  replaying = 1;
+  init_keyboard(release_velocity);
+
+  t = now_ns();
+  for(scan=0; scan<num_scans; ++scan) {
+    if( rec_tick[scan] )
+      KEYBOARD_Periodic_1mS();
+    KEYBOARD_SRIO_ServicePrepare();
+    din_sr = rec_din[scan];
+    timer_value = rec_timer[scan];
+    KEYBOARD_SRIO_ServiceFinish();
+  }
+  t = now_ns() - t;
+  replaying = 0;
+
+  if( checksum != expected_checksum ) {
+    printf("ERROR: the replay sent different MIDI events\n");
+    ++errors;
+  }
+
+  return (double)t / num_scans;
+}
+
+
+int main(int argc, char *argv[])
+{
+  int release_velocity;
+
+  init_strikes();
+
+  printf("timestamps: %s, %d keys, %d strikes\n",
+	 KB_SIM_TIMER ? "1 MHz timer" : "SRIO scan counter", NUM_KEYS, NUM_STRIKES);
+
+  for(release_velocity=0; release_velocity<2; ++release_velocity) {
+    play(release_velocity);
+    printf("%s: %u scans\n", release_velocity ? "with release velocity" : "note on velocity only", num_scans);
+    print_accuracy("Note On velocity", 0);
+    if( release_velocity )
+      print_accuracy("release velocity", 1);
+    printf("  CPU time %.1f nS per scan\n", replay(release_velocity));
+  }
+
+  if( errors ) {
+    printf("%d errors\n", errors);
+    return 1;
+  }
+
+  return 0;
+}
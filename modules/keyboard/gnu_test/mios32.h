@@ -0,0 +1,51 @@
+// minimal MIOS32 environment to compile keyboard.c on the host
+#ifndef _MIOS32_H
+#define _MIOS32_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+typedef uint8_t  u8;
+typedef uint16_t u16;
+typedef uint32_t u32;
+typedef uint64_t u64;
+typedef int8_t   s8;
+typedef int16_t  s16;
+typedef int32_t  s32;
+
+#define MIOS32_SRIO_NUM_DOUT_PAGES 1
+
+#define KEYBOARD_DONT_USE_MIDI_CFG 1
+#define KEYBOARD_DONT_USE_AIN      1
+
+// optional free running timer of kb_sim.c (1 MHz)
+#ifndef KB_SIM_TIMER
+#define KB_SIM_TIMER 0
+#endif
+#if KB_SIM_TIMER
+extern u16 KB_SIM_TimerGet(void);
+#define KEYBOARD_TIMESTAMP_GET() KB_SIM_TimerGet()
+#endif
+
+#define MIOS32_IRQ_Disable() do {} while(0)
+#define MIOS32_IRQ_Enable()  do {} while(0)
+
+typedef enum {
+  DEFAULT = 0x00,
+} mios32_midi_port_t;
+
+typedef enum {
+  Chn1,
+} mios32_midi_chn_t;
+
+extern s32 MIOS32_MIDI_SendNoteOn(mios32_midi_port_t port, mios32_midi_chn_t chn, u8 note, u8 vel);
+extern s32 MIOS32_MIDI_SendNoteOff(mios32_midi_port_t port, mios32_midi_chn_t chn, u8 note, u8 vel);
+extern s32 MIOS32_MIDI_SendDebugMessage(const char *format, ...);
+
+extern s32 MIOS32_DIN_SRGet(u32 sr);
+extern u8  MIOS32_DIN_SRChangedGetAndClear(u32 sr, u8 mask);
+extern s32 MIOS32_DOUT_SRSet(u32 sr, u8 value);
+extern u8  MIOS32_SRIO_ScanNumGet(void);
+
+#endif /* _MIOS32_H */
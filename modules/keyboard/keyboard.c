@@ -73,6 +73,36 @@ static u16 din_activated_timestamp[KEYBOARD_NUM][KEYBOARD_NUM_PINS];
 static u8 ain_cali_mode_pin;
 #endif
 
+// velocity curves (applied on the linear scaled velocity)
+static const char velocity_curve_name[KEYBOARD_VELOCITY_CURVE_NUM][7] = {
+  "linear",
+  "soft",
+  "hard",
+};
+
+static const u8 velocity_curve_table[KEYBOARD_VELOCITY_CURVE_NUM-1][128] = {
+  { // soft: 127 * sqrt(v/127)
+      0,  11,  16,  20,  23,  25,  28,  30,  32,  34,  36,  37,  39,  41,  42,  44,
+     45,  46,  48,  49,  50,  52,  53,  54,  55,  56,  57,  59,  60,  61,  62,  63,
+     64,  65,  66,  67,  68,  69,  69,  70,  71,  72,  73,  74,  75,  76,  76,  77,
+     78,  79,  80,  80,  81,  82,  83,  84,  84,  85,  86,  87,  87,  88,  89,  89,
+     90,  91,  92,  92,  93,  94,  94,  95,  96,  96,  97,  98,  98,  99, 100, 100,
+    101, 101, 102, 103, 103, 104, 105, 105, 106, 106, 107, 108, 108, 109, 109, 110,
+    110, 111, 112, 112, 113, 113, 114, 114, 115, 115, 116, 117, 117, 118, 118, 119,
+    119, 120, 120, 121, 121, 122, 122, 123, 123, 124, 124, 125, 125, 126, 126, 127,
+  },
+  { // hard: 127 * (v/127)^2
+      0,   1,   1,   1,   1,   1,   1,   1,   1,   1,   1,   1,   1,   1,   2,   2,
+      2,   2,   3,   3,   3,   3,   4,   4,   5,   5,   5,   6,   6,   7,   7,   8,
+      8,   9,   9,  10,  10,  11,  11,  12,  13,  13,  14,  15,  15,  16,  17,  17,
+     18,  19,  20,  20,  21,  22,  23,  24,  25,  26,  26,  27,  28,  29,  30,  31,
+     32,  33,  34,  35,  36,  37,  39,  40,  41,  42,  43,  44,  45,  47,  48,  49,
+     50,  52,  53,  54,  56,  57,  58,  60,  61,  62,  64,  65,  67,  68,  70,  71,
+     73,  74,  76,  77,  79,  80,  82,  84,  85,  87,  88,  90,  92,  94,  95,  97,
+     99, 101, 102, 104, 106, 108, 110, 112, 113, 115, 117, 119, 121, 123, 125, 127,
+  },
+};
+
 /////////////////////////////////////////////////////////////////////////////
 // Local Prototypes
 /////////////////////////////////////////////////////////////////////////////
@@ -87,7 +117,7 @@ extern s32 KEYBOARD_NOTIFY_TOGGLE_HOOK(u8 kb, u8 note_number, u8 velocity);
 static s32 KEYBOARD_MIDI_SendCtrl(u8 kb, u8 ctrl_number, u8 value);
 #endif
 static char *KEYBOARD_GetNoteName(u8 note, char str[4]);
-static int KEYBOARD_GetVelocity(u16 delay, u16 delay_slowest, u16 delay_fastest);
+static int KEYBOARD_GetVelocity(u16 delay, u16 delay_slowest, u16 delay_fastest, u8 velocity_curve);
 
 
 /////////////////////////////////////////////////////////////////////////////
@@ -143,6 +173,7 @@ s32 KEYBOARD_Init(u32 mode)
       kc->make_debounced = 0;
       kc->break_is_make = 0;
       kc->key_calibration = 0;
+      kc->velocity_curve = KEYBOARD_VELOCITY_CURVE_LINEAR;
 
       if( kb == 0 ) {
 	kc->num_rows = 8;
@@ -312,6 +343,15 @@ void KEYBOARD_SRIO_ServicePrepare(void)
 /////////////////////////////////////////////////////////////////////////////
 void KEYBOARD_SRIO_ServiceFinish(void)
 {
+  // the DINs have just been read: take the timestamp for velocity measurements
+#ifdef KEYBOARD_TIMESTAMP_GET
+  u16 row_timestamp = KEYBOARD_TIMESTAMP_GET();
+  if( !row_timestamp ) // skip 0, which is used as reset of ts_make and ts_break values
+    row_timestamp = 1;
+#else
+  u16 row_timestamp = timestamp;
+#endif
+
   // check DINs
   int kb;
   keyboard_config_t *kc = (keyboard_config_t *)&keyboard_config[0];
@@ -355,47 +395,35 @@ void KEYBOARD_SRIO_ServiceFinish(void)
       din_value[kb][prev_row] = sr_value;
 
       // number of pins per row depends on assigned DINs:
-      int pins_per_row = kc->din_sr2 ? 16 : 8;
-      u8 sr_pin;
-      u16 mask = 0x01;
+      u16 ts_mask = kc->din_sr2 ? 0xffff : 0x00ff;
       u16 *ts_ptr = (u16 *)&din_activated_timestamp[kb][prev_row * MATRIX_NUM_ROWS];
 
-      /*-----------------02.03.2013 13:31-----------------
-       * key on velocity only : 40,4 us over all 16 scanlines -> 2,53 us/row
-       * --------------------------------------------------*/
       if ( !kc->scan_release_velocity ) {
-	// store timestamp for changed pin on 1->0 transition
-    	for(sr_pin=0; sr_pin<pins_per_row; ++sr_pin, mask <<= 1, ++ts_ptr) {
-	  if( (changed & mask) && !(sr_value & mask) && !(*ts_ptr)) {
-	    *ts_ptr = timestamp;
-//	    DEBUG_MSG("Scanned TS: pin %d & row %d = %d \n", sr_pin, prev_row, *ts_ptr);
-	  }
-      	}
-      }
-      /* --------------------------------------------------*/
-
-      /*-----------------02.03.2013 13:39-----------------
-       * key on/off velocity : 48,9 us over all 16 scanlines -> 3,06 us/row
-       * --------------------------------------------------*/
-      else {
+	// store timestamp for changed pins on 1->0 transition
+	ts_mask &= changed & ~sr_value;
+      } else {
 	// get related contact row: MKx = BRx - 1; BRx = MK + 1;
 	u8  rel_row = prev_row + ((prev_row & 1) ? (-1) : 1);
 	u16 rel_changed = din_value_changed[kb][rel_row];
 	u16 rel_sr_value = din_value[kb][rel_row];
-      	// check Make and Break Pins
-      	for(sr_pin=0; sr_pin<pins_per_row; ++sr_pin, mask <<= 1, ++ts_ptr) {
-	  // update timestamp only if timestamp is 0 (untouched or previously processed)
-	  //               AND     if Break pin changes and related Make pin remains released (1) without change
-	  //                    OR if Make pin changes and related Break pin remains pressed (0) without change
-	  if( (changed & mask) && !(rel_changed & mask) && !(*ts_ptr) &&
-	      (( (prev_row & 1) &&  (rel_sr_value & mask))||
-	       (!(prev_row & 1) && !(rel_sr_value & mask))  )   		) {
-	    *ts_ptr = timestamp;
-//	    DEBUG_MSG("Scanned TS: pin %d & row %d [%s %s] = %d \n", sr_pin, prev_row, sr_value & mask ? "released" : "pressed", prev_row & 1 ? "BR" : "MK", *ts_ptr);
-	  }
+
+	// update timestamp only
+	//        if Break pin changes and related Make pin remains released (1) without change
+	//     OR if Make pin changes and related Break pin remains pressed (0) without change
+	ts_mask &= changed & ~rel_changed & ((prev_row & 1) ? rel_sr_value : ~rel_sr_value);
+      }
+
+      // process all pins of the row at once, only the selected pins are visited
+      while( ts_mask ) {
+	u8 sr_pin = __builtin_ctz(ts_mask);
+	ts_mask &= ts_mask - 1; // clear lowest flag
+
+	// update timestamp only if timestamp is 0 (untouched or previously processed)
+	if( !ts_ptr[sr_pin] ) {
+	  ts_ptr[sr_pin] = row_timestamp;
+//	  DEBUG_MSG("Scanned TS: pin %d & row %d = %d \n", sr_pin, prev_row, ts_ptr[sr_pin]);
 	}
       }
-/* --------------------------------------------------*/
     }
   }
 }
@@ -605,7 +633,7 @@ static void KEYBOARD_NotifyToggle(u8 kb, u8 row, u8 column, u8 depressed)
 	    delay_slowest = (kc->delay_key[key] * delay_slowest) / 1000;
 	}
 #endif
-	velocity = KEYBOARD_GetVelocity(delay, delay_slowest, delay_fastest);
+	velocity = KEYBOARD_GetVelocity(delay, delay_slowest, delay_fastest, kc->velocity_curve);
 
 	if( kc->verbose_level >= 2 )
 	  DEBUG_MSG("RELEASED note=%s, delay=%d, velocity=%d (from a %s key)\n",
@@ -672,7 +700,7 @@ static void KEYBOARD_NotifyToggle(u8 kb, u8 row, u8 column, u8 depressed)
 	}
 #endif
 
-	velocity = KEYBOARD_GetVelocity(delay, delay_slowest, delay_fastest);
+	velocity = KEYBOARD_GetVelocity(delay, delay_slowest, delay_fastest, kc->velocity_curve);
 
 	if( kc->verbose_level >= 2 )
 	  DEBUG_MSG("PRESSED note=%s, delay=%d, velocity=%d (played from a %s key)\n",
@@ -701,7 +729,7 @@ void KEYBOARD_Periodic_1mS(void)
   keyboard_config_t *kc = (keyboard_config_t *)&keyboard_config[0];
   for(kb=0; kb<connected_keyboards_num; ++kb, ++kc) {
     // number of pins per row depends on assigned DINs:
-    int pins_per_row = kc->din_sr2 ? 16 : 8;
+    u16 pins_mask = kc->din_sr2 ? 0xffff : 0x00ff;
 
     int row;
     for(row=0; row<kc->num_rows; ++row) {
@@ -711,16 +739,14 @@ void KEYBOARD_Periodic_1mS(void)
       din_value_changed[kb][row] = 0;
       MIOS32_IRQ_Enable();
 
-      // any pin change at this SR?
-      if( !changed )
-	continue;
+      // notify only the changed pins of the two SRs
+      changed &= pins_mask;
+      while( changed ) {
+	u8 sr_pin = __builtin_ctz(changed);
+	changed &= changed - 1; // clear lowest flag
 
-      // check the 16 captured pins of the two SRs
-      int sr_pin;
-      u16 mask = 0x01;
-      for(sr_pin=0; sr_pin<pins_per_row; ++sr_pin, mask <<= 1)
-	if( changed & mask )
-	  KEYBOARD_NotifyToggle(kb, row, sr_pin, (din_value[kb][row] & mask) ? 1 : 0);
+	KEYBOARD_NotifyToggle(kb, row, sr_pin, (din_value[kb][row] & (1 << sr_pin)) ? 1 : 0);
+      }
     }
   }
 }
@@ -833,7 +859,7 @@ void KEYBOARD_AIN_NotifyChange(u32 pin, u32 pin_value)
 /////////////////////////////////////////////////////////////////////////////
 // Help function to get MIDI velocity from measured delay
 /////////////////////////////////////////////////////////////////////////////
-static int KEYBOARD_GetVelocity(u16 delay, u16 delay_slowest, u16 delay_fastest)
+static int KEYBOARD_GetVelocity(u16 delay, u16 delay_slowest, u16 delay_fastest, u8 velocity_curve)
 {
   int velocity = 127;
 
@@ -850,7 +876,7 @@ static int KEYBOARD_GetVelocity(u16 delay, u16 delay_slowest, u16 delay_fastest)
 
   if( delay > delay_fastest ) {
     // determine velocity depending on delay
-    // lineary scaling - here we could also apply a curve table
+    // lineary scaling, the curve table is applied below
     velocity = 127 - (((delay - delay_fastest) * 127) / (delay_slowest - delay_fastest));
 
     // saturate to ensure that range 1..127 won't be exceeded
@@ -858,6 +884,10 @@ static int KEYBOARD_GetVelocity(u16 delay, u16 delay_slowest, u16 delay_fastest)
       velocity = 1;
     if( velocity > 127 )
       velocity = 127;
+
+    // optional non-linear curve
+    if( velocity_curve > KEYBOARD_VELOCITY_CURVE_LINEAR && velocity_curve < KEYBOARD_VELOCITY_CURVE_NUM )
+      velocity = velocity_curve_table[velocity_curve-1][velocity];
   }
 
   return velocity;
@@ -1062,6 +1092,7 @@ s32 KEYBOARD_TerminalHelp(void *_output_function)
   out("  set kb <1|2> delay_fastest_release_black_keys <0-65535>: opt.fastest release delay for black keys");
   out("  set kb <1|2> delay_slowest <0-65535>:   slowest delay for velocity calculation");
   out("  set kb <1|2> delay_slowest_release <0-65535>: slowest release delay for velocity calculation");
+  out("  set kb <1|2> velocity_curve <linear|soft|hard>: curve which is applied on the velocity");
 #if !KEYBOARD_DONT_USE_AIN
   out("  set kb <1|2> ain_pitchwheel <0..7/128..135> or off: assigns pitchwheel to given analog pin");
   out("  set kb <1|2> ctrl_pitchwheel <0-129>:               assigns CC/PB(=128)/AT(=129) to PitchWheel");
@@ -1528,6 +1559,26 @@ s32 KEYBOARD_TerminalParseLine(char *input, void *_output_function)
 	    out("Keyboard #%d: delay_slowest set to %d!", kb+1, kc->delay_slowest);
 	  }
 	/////////////////////////////////////////////////////////////////////
+	} else if( strcmp(parameter, "velocity_curve") == 0 ) {
+	  if( !(parameter = strtok_r(NULL, separators, &brkt)) ) {
+	    out("Please specify the velocity curve (linear, soft or hard)!");
+	    return 1; // command taken
+	  }
+
+	  int curve;
+	  for(curve=0; curve<KEYBOARD_VELOCITY_CURVE_NUM; ++curve) {
+	    if( strcmp(parameter, velocity_curve_name[curve]) == 0 )
+	      break;
+	  }
+
+	  if( curve >= KEYBOARD_VELOCITY_CURVE_NUM ) {
+	    out("Expecting 'linear', 'soft' or 'hard'!");
+	    return 1; // command taken
+	  } else {
+	    kc->velocity_curve = curve;
+	    out("Keyboard #%d: velocity_curve set to %s!", kb+1, velocity_curve_name[kc->velocity_curve]);
+	  }
+	/////////////////////////////////////////////////////////////////////
 	} else if( strcmp(parameter, "delay_slowest_release") == 0 ) {
 	  if( !(parameter = strtok_r(NULL, separators, &brkt)) ) {
 	    out("Please specify the slowest release delay for velocity calculation!");
@@ -1869,6 +1920,7 @@ s32 KEYBOARD_TerminalPrintConfig(int kb, void *_output_function)
   out("kb %d delay_fastest_release_black_keys %d", kb+1, kc->delay_fastest_release_black_keys);
   out("kb %d delay_slowest %d", kb+1, kc->delay_slowest);
   out("kb %d delay_slowest_release %d", kb+1, kc->delay_slowest_release);
+  out("kb %d velocity_curve %s", kb+1, (kc->velocity_curve < KEYBOARD_VELOCITY_CURVE_NUM) ? velocity_curve_name[kc->velocity_curve] : "linear");
 
 #if !KEYBOARD_DONT_USE_AIN
   if( kc->ain_pin[KEYBOARD_AIN_PITCHWHEEL] )
@@ -60,6 +60,23 @@
 #define KEYBOARD_MAX_KEYS 128
 #endif
 
+// optional timestamp source for velocity measurements
+// by default the SRIO scan counter is used, which means that delays are measured in scan cycles.
+// A free running hardware timer can be used for a higher resolution, e.g. in mios32_config.h:
+//   #define KEYBOARD_TIMESTAMP_GET() ((u16)TIM5->CNT)
+// the macro has to return a 16bit value which wraps at 0xffff,
+// the delay_fastest/delay_slowest values have to be specified in ticks of this timer!
+#ifndef KEYBOARD_TIMESTAMP_GET
+//#define KEYBOARD_TIMESTAMP_GET() ((u16)TIM5->CNT)
+#endif
+
+
+// velocity curves
+#define KEYBOARD_VELOCITY_CURVE_LINEAR 0
+#define KEYBOARD_VELOCITY_CURVE_SOFT   1
+#define KEYBOARD_VELOCITY_CURVE_HARD   2
+#define KEYBOARD_VELOCITY_CURVE_NUM    3
+
 
 /////////////////////////////////////////////////////////////////////////////
 // Global Types
@@ -94,6 +111,8 @@ typedef struct {
   u8  break_is_make:1;
   u8  key_calibration:1;
 
+  u8  velocity_curve;
+
   u16 delay_fastest;
   u16 delay_fastest_black_keys;
   u16 delay_fastest_release;
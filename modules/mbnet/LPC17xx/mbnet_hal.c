@@ -210,10 +210,11 @@ s32 MBNET_HAL_Send(mbnet_id_t mbnet_id, mbnet_msg_t msg, u8 dlc)
     // TODO: timeout required?
     u32 sr = MBNET_CAN->SR;
 
-    if     ( sr & (1 << 2) ) // TBS1
+    // the controller sends pending buffers by identifier priority. Wait until
+    // the previous message has been sent, so that windowed requests to the
+    // same slave can't overtake each other
+    if( (sr & ((1 << 2) | (1 << 10))) == ((1 << 2) | (1 << 10)) ) // TBS1 and TBS2
       mailbox = 0;
-    else if( sr & (1 << 10) ) // TBS2
-      mailbox = 1;
 #if 0
     // assigned for interrupt driven transfers
     else if( sr & (1 << 18) ) // TBS3
@@ -87,6 +87,10 @@ s32 MBNET_HAL_Init(u32 mode)
   // enable receive FIFO locked mode (if FIFO is full, next incoming message will be discarded)
   CAN1->MCR |= (1 << 3); // CAN_MCR_RFLM
 
+  // transmit mailboxes in chronological order (and not by identifier), so that
+  // windowed requests to the same slave can't overtake each other
+  CAN1->MCR |= (1 << 2); // CAN_MCR_TXFP
+
   // bit timings for 2 MBaud:
   // -> 72 Mhz / 2 / 3 -> 12 MHz --> 6 quanta for 2 MBaud
   //          normal mode               Resynch. Jump Width   Time Segment 1         Time Segment 2       Prescaler
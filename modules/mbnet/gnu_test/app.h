@@ -0,0 +1,10 @@
+// application hooks which are called by the slave part of mbnet.c
+#ifndef _APP_H
+#define _APP_H
+
+extern void APP_Init(void);
+extern void APP_MIDI_NotifyPackage(mios32_midi_port_t port, mios32_midi_package_t midi_package);
+extern void APP_DIN_NotifyToggle(u32 pin, u32 pin_value);
+extern void APP_ENC_NotifyChange(u32 encoder, s32 incrementer);
+
+#endif /* _APP_H */
@@ -0,0 +1,556 @@
+// Host simulation of the MBNet CAN bus
+//
+// mbnet.c runs as master (node 0x00) on top of a simulated HAL. The slaves
+// are modelled like MIOS32 based MBNet slaves: incoming requests are stored
+// in a receive FIFO which discards new messages when it is full (RFLM), and
+// the MBNet task of the slave handles the FIFO once per mS. Legacy slaves
+// can only buffer a single request. The acknowledge FIFO of the master has
+// 3 entries like FIFO1 of the STM32 CAN controller.
+//
+// The bus has a configurable latency and frame loss (a lost frame never
+// arrives). The master needs 2 uS per acknowledge poll, so that
+// MBNET_WaitAck() times out after 10 mS like on the target.
+//
+// Benchmark: a 512 byte patch is written with 8 byte RAM write requests
+// - stop-and-wait: MBNET_SendReq() + MBNET_WaitAck() like
+//   apps/misc/mbsid_can_osc_proxy did for each parameter
+// - windowed: MBNET_SendReqWindowed() with different window sizes
+//   (window 4 exceeds the FIFO of the slave, the legacy slave only buffers 1 request)
+// Each transfer is verified against the RAM of the slave, and the patch is
+// read back with windowed RAM read requests.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "mios32.h"
+#include "../mbnet.h"
+#include "../mbnet_hal.h"
+
+#define FRAME_US          65  // extended frame with 8 bytes at 2 MBaud, incl. stuffing
+#define POLL_US            2  // CPU time of an acknowledge poll
+#define SEND_US            2  // CPU time to fill a mailbox
+#define SLAVE_PERIOD_US 1000  // MBNet task of the slave
+#define SLAVE_SERVICE_US  10  // CPU time of the slave per request
+
+#define NUM_SLAVES        3   // slave IDs 1..3
+#define SLAVE_FIFO_MAX    3
+#define ACK_FIFO_SIZE     3
+#define MAX_FRAMES       64
+
+#define PATCH_SIZE       512
+#define PATCHES           10  // transfers per benchmark cell
+
+typedef unsigned long long u64;
+
+typedef struct {
+  u64 t; // delivery time
+  mbnet_packet_t p;
+} frame_t;
+
+typedef struct {
+  u8 fifo_depth;
+  u8 fifo_num;
+  mbnet_packet_t fifo[SLAVE_FIFO_MAX];
+  u64 next_poll;
+  u8 mem[PATCH_SIZE];
+} slave_t;
+
+static u64 now; // simulated time in uS
+static u64 bus_free; // end of the last frame on the bus
+static u64 mailbox_busy[3]; // transmit mailboxes of the master
+
+static frame_t frames[MAX_FRAMES];
+static int num_frames;
+
+static slave_t slaves[NUM_SLAVES+1];
+
+static mbnet_packet_t ack_fifo[ACK_FIFO_SIZE];
+static int ack_fifo_num;
+
+// bus configuration
+static u32 latency_us;
+static double loss;
+static double retry_prob;
+
+// statistics
+static u32 requests_sent;
+static u32 frames_lost;
+static u32 fifo_overflows;
+
+static u8 patch[PATCH_SIZE];
+static int errors;
+
+
+// ------- bus model -------
+static double rnd(void)
+{
+  return (double)rand() / ((double)RAND_MAX + 1.0);
+}
+
+// puts a frame on the bus, returns the end of the transmission
+static u64 bus_send(u64 t, mbnet_packet_t *p)
+{
+  u64 start = (t > bus_free) ? t : bus_free;
+  bus_free = start + FRAME_US;
+
+  if( rnd() < loss ) {
+    ++frames_lost; // occupies the bus, but never arrives
+  } else if( num_frames < MAX_FRAMES ) {
+    // frames arrive in the order in which they have been sent
+    frames[num_frames].t = bus_free + latency_us;
+    frames[num_frames].p = *p;
+    ++num_frames;
+  }
+
+  return bus_free;
+}
+
+// MBNet task of a slave: handles all buffered requests
+static void slave_poll(int slave_id)
+{
+  slave_t *s = &slaves[slave_id];
+  u64 t = s->next_poll;
+  int i, j;
+
+  for(i=0; i<s->fifo_num; ++i) {
+    mbnet_packet_t *req = &s->fifo[i];
+    mbnet_packet_t ack;
+
+    t += SLAVE_SERVICE_US;
+    ack.id.ALL = 0;
+    ack.id.control = slave_id;
+    ack.id.ack = 1;
+    ack.id.node = req->id.ms << 4;
+    ack.msg.data_l = ack.msg.data_h = 0;
+    ack.dlc = 0;
+
+    if( retry_prob > 0 && rnd() < retry_prob ) {
+      ack.id.tos = MBNET_ACK_RETRY; // slave busy
+    } else {
+      switch( req->id.tos ) {
+      case MBNET_REQ_RAM_WRITE:
+	for(j=0; j<req->dlc; ++j)
+	  if( req->id.control + j < PATCH_SIZE )
+	    s->mem[req->id.control + j] = req->msg.bytes[j];
+	ack.id.tos = MBNET_ACK_OK;
+	break;
+
+      case MBNET_REQ_RAM_READ:
+	for(j=0; j<8; ++j)
+	  ack.msg.bytes[j] = (req->id.control + j < PATCH_SIZE) ? s->mem[req->id.control + j] : 0;
+	ack.dlc = 8;
+	ack.id.tos = MBNET_ACK_READ;
+	break;
+
+      case MBNET_REQ_PING:
+	ack.msg.protocol_version = 1;
+	memcpy(ack.msg.node_type, "SIM ", 4);
+	ack.dlc = 8;
+	ack.id.tos = MBNET_ACK_OK;
+	break;
+
+      default:
+	ack.id.tos = MBNET_ACK_ERROR;
+      }
+    }
+
+    bus_send(t, &ack);
+  }
+
+  s->fifo_num = 0;
+  s->next_poll += SLAVE_PERIOD_US;
+}
+
+// processes all events up to the given time
+static void sim_run(u64 t)
+{
+  while( 1 ) {
+    // next event: frame delivery or slave poll
+    int i, next_frame = -1, next_slave = -1;
+    u64 next_t = t + 1;
+
+    for(i=0; i<num_frames; ++i)
+      if( frames[i].t < next_t ) {
+	next_t = frames[i].t;
+	next_frame = i;
+      }
+
+    for(i=1; i<=NUM_SLAVES; ++i)
+      if( slaves[i].next_poll < next_t ) {
+	next_t = slaves[i].next_poll;
+	next_slave = i;
+	next_frame = -1;
+      }
+
+    if( next_slave > 0 ) {
+      slave_poll(next_slave);
+    } else if( next_frame >= 0 ) {
+      mbnet_packet_t p = frames[next_frame].p;
+      memmove(&frames[next_frame], &frames[next_frame+1], (num_frames-next_frame-1)*sizeof(frame_t));
+      --num_frames;
+
+      if( p.id.ack ) {
+	if( ack_fifo_num < ACK_FIFO_SIZE )
+	  ack_fifo[ack_fifo_num++] = p;
+	else
+	  ++fifo_overflows;
+      } else if( p.id.node >= 1 && p.id.node <= NUM_SLAVES ) {
+	slave_t *s = &slaves[p.id.node];
+	if( s->fifo_num < s->fifo_depth )
+	  s->fifo[s->fifo_num++] = p;
+	else
+	  ++fifo_overflows; // FIFO locked mode: new message discarded
+      }
+    } else {
+      return;
+    }
+  }
+}
+
+static void sim_init(u32 _latency_us, double _loss, double _retry_prob, u8 fifo_depth)
+{
+  int i;
+
+  latency_us = _latency_us;
+  loss = _loss;
+  retry_prob = _retry_prob;
+
+  now = bus_free = 0;
+  mailbox_busy[0] = mailbox_busy[1] = mailbox_busy[2] = 0;
+  num_frames = 0;
+  ack_fifo_num = 0;
+  requests_sent = frames_lost = fifo_overflows = 0;
+
+  memset(slaves, 0, sizeof(slaves));
+  for(i=1; i<=NUM_SLAVES; ++i) {
+    slaves[i].fifo_depth = fifo_depth;
+    slaves[i].next_poll = 137 * i; // different phases
+  }
+
+  MBNET_Init(0);
+  MBNET_NodeIDSet(0x00);
+}
+
+
+// ------- simulated HAL -------
+s32 MBNET_HAL_Init(u32 mode)
+{
+  ack_fifo_num = 0;
+  return 0;
+}
+
+s32 MBNET_HAL_FilterInit(u8 node_id)
+{
+  return 0;
+}
+
+s32 MBNET_HAL_Send(mbnet_id_t mbnet_id, mbnet_msg_t msg, u8 dlc)
+{
+  mbnet_packet_t p;
+  int mailbox;
+
+  now += SEND_US;
+  sim_run(now);
+
+  // wait for a free mailbox (they are sent in chronological order)
+  while( 1 ) {
+    for(mailbox=0; mailbox<3; ++mailbox)
+      if( mailbox_busy[mailbox] <= now )
+	break;
+    if( mailbox < 3 )
+      break;
+    now = mailbox_busy[0];
+    for(mailbox=1; mailbox<3; ++mailbox)
+      if( mailbox_busy[mailbox] < now )
+	now = mailbox_busy[mailbox];
+    sim_run(now);
+  }
+
+  p.id = mbnet_id;
+  p.msg = msg;
+  p.dlc = dlc;
+  mailbox_busy[mailbox] = bus_send(now, &p);
+
+  if( !mbnet_id.ack )
+    ++requests_sent;
+
+  return 1;
+}
+
+s32 MBNET_HAL_ReceiveAck(mbnet_packet_t *p)
+{
+  now += POLL_US;
+  sim_run(now);
+
+  if( !ack_fifo_num )
+    return 0;
+
+  *p = ack_fifo[0];
+  --ack_fifo_num;
+  memmove(&ack_fifo[0], &ack_fifo[1], ack_fifo_num*sizeof(mbnet_packet_t));
+  return 1;
+}
+
+s32 MBNET_HAL_ReceiveReq(mbnet_packet_t *p)
+{
+  return 0; // the master doesn't get requests
+}
+
+s32 MBNET_HAL_BusErrorCheck(void)
+{
+  return 0;
+}
+
+s32 MBNET_HAL_InstallTxHandler(s32 (*tx_handler_callback)(mbnet_id_t *mbnet_id, mbnet_msg_t *msg, u8 *dlc))
+{
+  return -1;
+}
+
+s32 MBNET_HAL_TriggerTxHandler(void)
+{
+  return -1;
+}
+
+s32 MIOS32_TIMESTAMP_Get(void)
+{
+  return now / 1000;
+}
+
+s32 MIOS32_TIMESTAMP_GetDelay(u32 captured_timestamp)
+{
+  return MIOS32_TIMESTAMP_Get() - captured_timestamp;
+}
+
+void APP_Init(void) {}
+void APP_MIDI_NotifyPackage(mios32_midi_port_t port, mios32_midi_package_t midi_package) {}
+void APP_DIN_NotifyToggle(u32 pin, u32 pin_value) {}
+void APP_ENC_NotifyChange(u32 encoder, s32 incrementer) {}
+
+
+// ------- transfers -------
+static u32 cb_done;
+static u32 cb_errors;
+
+static mbnet_msg_t patch_msg(u16 addr)
+{
+  mbnet_msg_t msg;
+  memcpy(msg.bytes, &patch[addr], 8);
+  return msg;
+}
+
+static s32 write_stop_and_wait(u8 slave_id)
+{
+  u16 addr;
+
+  for(addr=0; addr<PATCH_SIZE; addr+=8) {
+    int tries = 0;
+    mbnet_msg_t ack_msg;
+    u8 dlc;
+
+    // MBNET_WaitAck() resends on retry acknowledges, the caller on timeouts
+    do {
+      if( ++tries > 16 )
+	return -1;
+      MBNET_SendReq(slave_id, MBNET_REQ_RAM_WRITE, addr, patch_msg(addr), 8);
+    } while( MBNET_WaitAck(slave_id, &ack_msg, &dlc) < 0 );
+  }
+
+  return 0;
+}
+
+static void write_callback(u8 slave_id, s32 status, mbnet_tos_ack_t tos_ack, mbnet_msg_t ack_msg, u8 dlc, u32 arg)
+{
+  ++cb_done;
+  if( status < 0 || tos_ack != MBNET_ACK_OK )
+    ++cb_errors;
+}
+
+static void read_callback(u8 slave_id, s32 status, mbnet_tos_ack_t tos_ack, mbnet_msg_t ack_msg, u8 dlc, u32 arg)
+{
+  ++cb_done;
+  if( status < 0 || tos_ack != MBNET_ACK_READ || dlc != 8 || memcmp(ack_msg.bytes, &patch[arg], 8) != 0 )
+    ++cb_errors;
+}
+
+static s32 transfer_windowed(u8 slave_id, mbnet_tos_req_t tos, mbnet_req_callback_t callback)
+{
+  u16 addr;
+  s32 status;
+
+  cb_done = cb_errors = 0;
+  for(addr=0; addr<PATCH_SIZE; addr+=8) {
+    mbnet_msg_t msg = patch_msg(addr);
+    u8 dlc = (tos == MBNET_REQ_RAM_WRITE) ? 8 : 0;
+    while( (status=MBNET_SendReqWindowed(slave_id, tos, addr, msg, dlc, callback, addr)) == -9 )
+      MBNET_WindowHandler(); // queue full
+    if( status < 0 )
+      return status;
+  }
+
+  while( MBNET_WindowPendingGet(slave_id) > 0 )
+    MBNET_WindowHandler();
+
+  return (cb_errors || cb_done != PATCH_SIZE/8) ? -1 : 0;
+}
+
+
+// ------- benchmark -------
+typedef struct {
+  const char *name;
+  u32 latency_us;
+  double loss;
+  double retry_prob;
+  u8 fifo_depth;
+} scenario_t;
+
+static const scenario_t scenarios[] = {
+  { "ideal bus",            0, 0.00, 0.00, 3 },
+  { "latency 200 uS",     200, 0.00, 0.00, 3 },
+  { "1% frame loss",        0, 0.01, 0.00, 3 },
+  { "5% frame loss",        0, 0.05, 0.00, 3 },
+  { "5% retry acks",        0, 0.00, 0.05, 3 },
+  { "legacy slave",         0, 0.00, 0.00, 1 },
+};
+
+// window 0 selects stop-and-wait
+static void bench(const scenario_t *sc, u8 window, double *ms_per_patch)
+{
+  const u8 slave_id = 1;
+  int i, j;
+  u64 t_start, t_write = 0;
+  u32 requests = 0;
+
+  sim_init(sc->latency_us, sc->loss, sc->retry_prob, sc->fifo_depth);
+  srand(1);
+  if( window )
+    MBNET_WindowSizeSet(slave_id, window);
+
+  for(i=0; i<PATCHES; ++i) {
+    for(j=0; j<PATCH_SIZE; ++j)
+      patch[j] = rand();
+
+    t_start = now;
+    requests_sent = 0;
+    if( (window ? transfer_windowed(slave_id, MBNET_REQ_RAM_WRITE, write_callback) : write_stop_and_wait(slave_id)) < 0 ) {
+      printf("ERROR: %s, %s: transfer failed\n", sc->name, window ? "windowed" : "stop-and-wait");
+      ++errors;
+    }
+    t_write += now - t_start;
+    requests += requests_sent;
+
+    if( memcmp(slaves[slave_id].mem, patch, PATCH_SIZE) != 0 ) {
+      printf("ERROR: %s: patch corrupted in slave RAM\n", sc->name);
+      ++errors;
+    }
+
+    // read back (with the same window)
+    if( window && transfer_windowed(slave_id, MBNET_REQ_RAM_READ, read_callback) < 0 ) {
+      printf("ERROR: %s: windowed read back failed (%d errors)\n", sc->name, cb_errors);
+      ++errors;
+    }
+  }
+
+  *ms_per_patch = t_write / 1000.0 / PATCHES;
+  printf("%-18s %-14s %8.1f %8.1f %9.2f %7d\n",
+	 sc->name,
+	 window ? (window == 1 ? "window 1" : window == 2 ? "window 2" : window == 3 ? "window 3" : "window 4") : "stop-and-wait",
+	 *ms_per_patch,
+	 PATCH_SIZE / *ms_per_patch, // bytes per mS = KB/s
+	 (double)requests / (PATCHES * PATCH_SIZE/8),
+	 window ? MBNET_WindowSizeGet(slave_id) : 1);
+}
+
+
+// ------- acknowledge hand-off between the windowed and the blocking path -------
+static void handoff(void)
+{
+  mbnet_msg_t msg, ack_msg;
+  u8 dlc;
+  u16 addr;
+  u64 t;
+  s32 status;
+
+  sim_init(0, 0.0, 0.0, 3);
+  MBNET_WindowSizeSet(1, 3);
+  memset(patch, 0x55, sizeof(patch));
+  msg.data_l = msg.data_h = 0;
+
+  // the window handler receives the acknowledge of the blocking request
+  cb_done = cb_errors = 0;
+  for(addr=0; addr<9*8; addr+=8)
+    MBNET_SendReqWindowed(1, MBNET_REQ_RAM_WRITE, addr, patch_msg(addr), 8, write_callback, addr);
+  MBNET_SendReq(2, MBNET_REQ_PING, 0x0000, msg, 0);
+  while( MBNET_WindowPendingGet(1) > 0 )
+    MBNET_WindowHandler();
+  t = now;
+  status = MBNET_WaitAck(2, &ack_msg, &dlc);
+  printf("hand-off: ping while the window handler runs: status %d after %d uS\n", status, (int)(now - t));
+  if( status < 0 || dlc != 8 || ack_msg.protocol_version != 1 || now - t > 10*POLL_US ) {
+    printf("ERROR: acknowledge of the blocking request got lost\n");
+    ++errors;
+  }
+
+  // MBNET_WaitAck() receives the acknowledges of the windowed requests
+  for(addr=0; addr<9*8; addr+=8)
+    MBNET_SendReqWindowed(1, MBNET_REQ_RAM_WRITE, addr, patch_msg(addr), 8, write_callback, addr);
+  MBNET_SendReq(2, MBNET_REQ_PING, 0x0000, msg, 0);
+  status = MBNET_WaitAck(2, &ack_msg, &dlc);
+  while( MBNET_WindowPendingGet(1) > 0 )
+    MBNET_WindowHandler();
+  printf("hand-off: windowed requests while waiting for the ping: status %d, %d/%d completed, %d errors\n",
+	 status, cb_done, 2*9, cb_errors);
+  if( status < 0 || cb_done != 2*9 || cb_errors ) {
+    printf("ERROR: acknowledges of the windowed requests got lost\n");
+    ++errors;
+  }
+
+  // special requests can't be sent windowed
+  if( MBNET_SendReqWindowed(1, MBNET_REQ_SPECIAL, 0x0000, msg, 0, NULL, 0) != -10 ) {
+    printf("ERROR: special request accepted\n");
+    ++errors;
+  }
+}
+
+
+int main(int argc, char *argv[])
+{
+  int i;
+  u8 window;
+  double stop_and_wait_ms, ms[5];
+
+  printf("MBNet CAN simulation: %d byte patch in 8 byte RAM writes, slave task period %d uS\n\n",
+	 PATCH_SIZE, SLAVE_PERIOD_US);
+  printf("%-18s %-14s %8s %8s %9s %7s\n", "scenario", "mode", "mS/patch", "KB/s", "req/write", "window");
+
+  for(i=0; i<sizeof(scenarios)/sizeof(scenario_t); ++i) {
+    const scenario_t *sc = &scenarios[i];
+    bench(sc, 0, &stop_and_wait_ms);
+    for(window=1; window<=4; ++window)
+      bench(sc, window, &ms[window]);
+    printf("\n");
+
+    // a window which fits into the FIFO of the slave has to be faster on a
+    // lossless bus. Lost frames and windows which exceed the FIFO of the slave
+    // lead to timeouts and a smaller window, but it shouldn't get much slower
+    // than stop-and-wait
+    if( sc->fifo_depth >= 3 && sc->loss == 0.0 && ms[3] * 2 > stop_and_wait_ms ) {
+      printf("ERROR: %s: window 3 isn't faster than stop-and-wait\n", sc->name);
+      ++errors;
+    }
+    for(window=1; window<=4; ++window)
+      if( ms[window] > stop_and_wait_ms * 1.25 ) {
+	printf("ERROR: %s: window %d is much slower than stop-and-wait\n", sc->name, window);
+	++errors;
+      }
+  }
+
+  handoff();
+
+  if( errors ) {
+    printf("%d errors\n", errors);
+    return 1;
+  }
+
+  printf("MBNet simulation passed.\n");
+  return 0;
+}
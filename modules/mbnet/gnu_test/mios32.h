@@ -0,0 +1,27 @@
+// minimal MIOS32 environment to compile mbnet.c on the host
+#ifndef _MIOS32_H
+#define _MIOS32_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <strings.h>
+
+typedef uint8_t  u8;
+typedef uint16_t u16;
+typedef uint32_t u32;
+typedef int8_t   s8;
+typedef int32_t  s32;
+typedef u8 mios32_midi_port_t;
+
+typedef union {
+  u32 ALL;
+} mios32_midi_package_t;
+
+// the simulated time base of can_sim.c
+extern s32 MIOS32_TIMESTAMP_Get(void);
+extern s32 MIOS32_TIMESTAMP_GetDelay(u32 captured_timestamp);
+
+#define MIOS32_MIDI_SendDebugMessage printf
+
+#endif /* _MIOS32_H */
@@ -42,6 +42,33 @@
 
 #define MBNET_TIMEOUT_CTR_MAX 5000
 
+// states of a windowed request
+#define MBNET_WINDOW_ENTRY_FREE   0
+#define MBNET_WINDOW_ENTRY_QUEUED 1 // waiting for the window of the slave
+#define MBNET_WINDOW_ENTRY_SENT   2 // acknowledge outstanding
+#define MBNET_WINDOW_ENTRY_ACKED  3 // acknowledged, waiting for the remaining batch
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Local types
+/////////////////////////////////////////////////////////////////////////////
+
+typedef struct {
+  u8                   state;
+  u8                   slave_id;
+  u8                   dlc;
+  u8                   retry_ctr;
+  u8                   ack_tos;
+  u8                   ack_dlc;
+  u32                  seq;       // order in which the request has been queued
+  u32                  timestamp; // when the batch has been sent
+  mbnet_id_t           mbnet_id;
+  mbnet_msg_t          msg;
+  mbnet_msg_t          ack_msg;
+  mbnet_req_callback_t callback;
+  u32                  arg;
+} mbnet_window_entry_t;
+
 
 /////////////////////////////////////////////////////////////////////////////
 // Local variables
@@ -72,6 +99,26 @@ static u8          last_req_dlc;
 // turns to 1 if scan for MBNet nodes is finished
 static u8 scan_finished;
 
+// master only: windowed requests
+static mbnet_window_entry_t window_queue[MBNET_WINDOW_QUEUE_SIZE];
+static u8 window_size_max[MBNET_SLAVE_NODES_END-MBNET_SLAVE_NODES_BEGIN+1]; // configured window
+static u8 window_size[MBNET_SLAVE_NODES_END-MBNET_SLAVE_NODES_BEGIN+1]; // current window
+static u8 window_limit[MBNET_SLAVE_NODES_END-MBNET_SLAVE_NODES_BEGIN+1]; // the window doesn't grow beyond this size after timeouts
+static u8 window_probe_ctr[MBNET_SLAVE_NODES_END-MBNET_SLAVE_NODES_BEGIN+1]; // successful batches since the limit has been reached
+static u8 window_num_used;
+static u32 window_seq;
+
+// acknowledges which have been received by MBNET_WindowHandler() but don't
+// belong to a windowed request; they are handed over to MBNET_WaitAck*()
+static mbnet_packet_t ack_stash[MBNET_ACK_STASH_SIZE];
+static u8 ack_stash_num;
+
+// statistics of windowed requests
+static u32 window_sent_ctr;
+static u32 window_resent_ctr;
+static u32 window_timeout_ctr;
+static u32 window_error_ctr;
+
 // for debugging
 static u8 verbose_level = 1; // default verbose level
 static u32 tos12_ctr = 0;
@@ -81,6 +128,8 @@ static u32 tos12_ctr = 0;
 // Local prototypes
 /////////////////////////////////////////////////////////////////////////////
 static s32 MBNET_BusErrorCheck(void);
+static s32 MBNET_WindowAck(mbnet_packet_t *p);
+static void MBNET_WindowClear(void);
 
 
 /////////////////////////////////////////////////////////////////////////////
@@ -101,6 +150,15 @@ s32 MBNET_Init(u32 mode)
   // The application has to use MBNET_NodeIDSet() to initialise it, and to configure the CAN filters
   my_node_id = 0xff;
 
+  // stop-and-wait for all slaves by default
+  {
+    int i;
+    for(i=0; i<=MBNET_SLAVE_NODES_END-MBNET_SLAVE_NODES_BEGIN; ++i) {
+      window_size_max[i] = window_size[i] = window_limit[i] = 1;
+      window_probe_ctr[i] = 0;
+    }
+  }
+
   // invalidate slave informations
   MBNET_Reconnect();
 
@@ -241,6 +299,9 @@ s32 MBNET_Reconnect(void)
     slave_nodes_info[i].data_h = 0;
   }
 
+  // cancel windowed requests
+  MBNET_WindowClear();
+
   return 0; // no error
 }
 
@@ -412,10 +473,18 @@ s32 MBNET_WaitAck_NonBlocking(u8 slave_id, mbnet_msg_t *ack_msg, u8 *dlc)
     return -3; // transmission error
 
   // check for incoming acknowledge messages
+  // acknowledges which have already been received by MBNET_WindowHandler() are taken first
   mbnet_packet_t p;
   s32 got_msg;
   do {
-    got_msg = MBNET_HAL_ReceiveAck(&p);
+    if( ack_stash_num ) {
+      p = ack_stash[0];
+      --ack_stash_num;
+      memmove(&ack_stash[0], &ack_stash[1], ack_stash_num*sizeof(mbnet_packet_t));
+      got_msg = 1;
+    } else {
+      got_msg = MBNET_HAL_ReceiveAck(&p);
+    }
 
     if( got_msg > 0 ) {
       // get EID, MSG and DLC
@@ -442,7 +511,7 @@ s32 MBNET_WaitAck_NonBlocking(u8 slave_id, mbnet_msg_t *ack_msg, u8 *dlc)
 	}
 
 	return 0; // wait ack successful!
-      } else {
+      } else if( MBNET_WindowAck(&p) < 1 ) { // acknowledge of a windowed request?
 	  if( verbose_level >= 3 ) {
 	    DEBUG_MSG("[MBNET] ERROR: ACK from unexpected slave ID 0x%02x (TOS=%d DLC=%d MSG=%02x %02x %02x...)\n",
 		      p.id.control & 0xff,
@@ -495,6 +564,490 @@ s32 MBNET_WaitAck(u8 slave_id, mbnet_msg_t *ack_msg, u8 *dlc)
 }
 
 
+/////////////////////////////////////////////////////////////////////////////
+// Sets the number of requests which MBNET_SendReqWindowed() sends to a slave
+// without waiting for the acknowledges (the window).
+// 1 (default) selects stop-and-wait transfers. Legacy slaves can only buffer
+// a single request, MIOS32 based slaves buffer 3 requests in the CAN FIFO.
+// The window is halved on timeouts and grows again with each batch which has
+// been completely acknowledged. It only grows up to the size of the timed out
+// batch - 1 (e.g. if the slave can't buffer the whole window), this limit is
+// raised again after MBNET_WINDOW_PROBE_BATCHES successful batches.
+// IN: <slave_id>: slave node ID (MBNET_SLAVE_NODES_BEGIN..MBNET_SLAVE_NODES_END)
+//     <size>: 1..MBNET_WINDOW_SIZE_MAX
+// OUT: returns 0 on success
+//      returns -1 if slave index outside allowed range
+//      returns -2 if invalid window size
+/////////////////////////////////////////////////////////////////////////////
+s32 MBNET_WindowSizeSet(u8 slave_id, u8 size)
+{
+#if MBNET_SLAVE_NODES_BEGIN > 0
+  if( slave_id < MBNET_SLAVE_NODES_BEGIN || slave_id > MBNET_SLAVE_NODES_END )
+#else
+  if( slave_id > MBNET_SLAVE_NODES_END )
+#endif
+    return -1; // outside allowed range
+
+  if( size < 1 || size > MBNET_WINDOW_SIZE_MAX )
+    return -2; // invalid window size
+
+  window_size_max[slave_id-MBNET_SLAVE_NODES_BEGIN] = size;
+  window_size[slave_id-MBNET_SLAVE_NODES_BEGIN] = size;
+  window_limit[slave_id-MBNET_SLAVE_NODES_BEGIN] = size;
+  window_probe_ctr[slave_id-MBNET_SLAVE_NODES_BEGIN] = 0;
+
+  return 0; // no error
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// Returns the current window size of a slave (can be smaller than the
+// configured size after timeouts), or -1 if slave index outside allowed range
+/////////////////////////////////////////////////////////////////////////////
+s32 MBNET_WindowSizeGet(u8 slave_id)
+{
+#if MBNET_SLAVE_NODES_BEGIN > 0
+  if( slave_id < MBNET_SLAVE_NODES_BEGIN || slave_id > MBNET_SLAVE_NODES_END )
+#else
+  if( slave_id > MBNET_SLAVE_NODES_END )
+#endif
+    return -1; // outside allowed range
+
+  return window_size[slave_id-MBNET_SLAVE_NODES_BEGIN];
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Local function: completes a windowed request and calls its callback
+/////////////////////////////////////////////////////////////////////////////
+static void MBNET_WindowComplete(mbnet_window_entry_t *e, s32 status)
+{
+  // free entry before calling the callback, so that it can queue a new request
+  u8 slave_id = e->slave_id;
+  mbnet_req_callback_t callback = e->callback;
+  u32 arg = e->arg;
+  mbnet_tos_ack_t ack_tos = e->ack_tos;
+  mbnet_msg_t ack_msg = e->ack_msg;
+  u8 ack_dlc = e->ack_dlc;
+
+  e->state = MBNET_WINDOW_ENTRY_FREE;
+  --window_num_used;
+
+  if( status < 0 ) {
+    ++window_error_ctr;
+    ack_tos = MBNET_ACK_ERROR;
+    ack_msg.data_l = ack_msg.data_h = 0;
+    ack_dlc = 0;
+    if( verbose_level >= 2 ) {
+      DEBUG_MSG("[MBNET] windowed request to slave ID 0x%02x failed with status %d\n", slave_id, status);
+    }
+  }
+
+  if( callback )
+    callback(slave_id, status, ack_tos, ack_msg, ack_dlc, arg);
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Local function: cancels all windowed requests and stashed acknowledges
+/////////////////////////////////////////////////////////////////////////////
+static void MBNET_WindowClear(void)
+{
+  int i;
+  mbnet_window_entry_t *e = &window_queue[0];
+  for(i=0; i<MBNET_WINDOW_QUEUE_SIZE; ++i, ++e)
+    if( e->state != MBNET_WINDOW_ENTRY_FREE )
+      MBNET_WindowComplete(e, -3);
+
+  ack_stash_num = 0;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Local function: returns the number of sent and acknowledged requests of
+// the current batch of a slave, and the oldest request which is still
+// waiting for the acknowledge
+/////////////////////////////////////////////////////////////////////////////
+static u8 MBNET_WindowBatch(u8 slave_id, mbnet_window_entry_t **oldest_sent)
+{
+  int i;
+  u8 num = 0;
+  mbnet_window_entry_t *e = &window_queue[0];
+  *oldest_sent = NULL;
+  for(i=0; i<MBNET_WINDOW_QUEUE_SIZE; ++i, ++e) {
+    if( e->slave_id == slave_id &&
+	(e->state == MBNET_WINDOW_ENTRY_SENT || e->state == MBNET_WINDOW_ENTRY_ACKED) ) {
+      ++num;
+      if( e->state == MBNET_WINDOW_ENTRY_SENT && (*oldest_sent == NULL || (s32)(e->seq - (*oldest_sent)->seq) < 0) )
+	*oldest_sent = e;
+    }
+  }
+
+  return num;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Local function: sends the next batch to each slave which doesn't wait for
+// acknowledges anymore. A batch consists of up to <window_size> queued
+// requests, they are sent in the queued order.
+/////////////////////////////////////////////////////////////////////////////
+static void MBNET_WindowTransmit(void)
+{
+  int i;
+  mbnet_window_entry_t *e = &window_queue[0];
+  for(i=0; i<MBNET_WINDOW_QUEUE_SIZE; ++i, ++e) {
+    if( e->state != MBNET_WINDOW_ENTRY_QUEUED )
+      continue;
+
+    u8 slave_id = e->slave_id;
+    mbnet_window_entry_t *oldest_sent;
+    if( MBNET_WindowBatch(slave_id, &oldest_sent) )
+      continue; // batch of this slave still outstanding
+
+    u8 num = 0;
+    u8 max = window_size[slave_id-MBNET_SLAVE_NODES_BEGIN];
+    u32 timestamp = MIOS32_TIMESTAMP_Get();
+    while( num < max ) {
+      // oldest queued request of this slave
+      mbnet_window_entry_t *next = NULL;
+      int j;
+      mbnet_window_entry_t *e2 = &window_queue[0];
+      for(j=0; j<MBNET_WINDOW_QUEUE_SIZE; ++j, ++e2) {
+	if( e2->state == MBNET_WINDOW_ENTRY_QUEUED && e2->slave_id == slave_id &&
+	    (next == NULL || (s32)(e2->seq - next->seq) < 0) )
+	  next = e2;
+      }
+
+      if( next == NULL )
+	break; // no more requests for this slave
+
+      ++window_sent_ctr;
+      if( MBNET_SendMsg(next->mbnet_id, next->msg, next->dlc) < 0 ) {
+	MBNET_WindowComplete(next, -3);
+      } else {
+	next->state = MBNET_WINDOW_ENTRY_SENT;
+	next->timestamp = timestamp;
+	++num;
+      }
+    }
+  }
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Local function: called when all requests of a batch have been acknowledged
+/////////////////////////////////////////////////////////////////////////////
+static void MBNET_WindowBatchDone(u8 slave_id)
+{
+  // Each acknowledge could be assigned to its request, since none got lost
+  // -> complete the requests in the queued order, send requests which got a
+  // retry acknowledge again with the next batch
+  u8 retry = 0;
+  while( 1 ) {
+    mbnet_window_entry_t *oldest = NULL;
+    int i;
+    mbnet_window_entry_t *e = &window_queue[0];
+    for(i=0; i<MBNET_WINDOW_QUEUE_SIZE; ++i, ++e) {
+      if( e->state == MBNET_WINDOW_ENTRY_ACKED && e->slave_id == slave_id &&
+	  (oldest == NULL || (s32)(e->seq - oldest->seq) < 0) )
+	oldest = e;
+    }
+
+    if( oldest == NULL )
+      break;
+
+    if( oldest->ack_tos == MBNET_ACK_RETRY ) {
+      retry = 1;
+      if( ++oldest->retry_ctr > MBNET_WINDOW_RETRY_MAX ) {
+	MBNET_WindowComplete(oldest, -4);
+      } else {
+	++window_resent_ctr;
+	oldest->state = MBNET_WINDOW_ENTRY_QUEUED; // keeps its position in the queue
+      }
+    } else {
+      MBNET_WindowComplete(oldest, 0);
+    }
+  }
+
+  if( retry ) {
+    if( verbose_level >= 3 ) {
+      DEBUG_MSG("[MBNET] Slave ID 0x%02x requested to retry windowed transfers!\n", slave_id);
+    }
+  } else {
+    // grow the window again after timeouts
+    u8 ix = slave_id-MBNET_SLAVE_NODES_BEGIN;
+    if( window_size[ix] < window_limit[ix] ) {
+      ++window_size[ix];
+    } else if( window_limit[ix] < window_size_max[ix] &&
+	       ++window_probe_ctr[ix] >= MBNET_WINDOW_PROBE_BATCHES ) {
+      // try a larger window again
+      window_probe_ctr[ix] = 0;
+      ++window_limit[ix];
+    }
+  }
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Local function: assigns a received acknowledge to the oldest outstanding
+// windowed request of the slave
+// OUT: returns 1 if the acknowledge has been taken, 0 if the slave has no
+//      windowed requests
+/////////////////////////////////////////////////////////////////////////////
+static s32 MBNET_WindowAck(mbnet_packet_t *p)
+{
+  if( !window_num_used )
+    return 0; // no windowed request
+
+  u8 slave_id = p->id.control & 0xff;
+#if MBNET_SLAVE_NODES_BEGIN > 0
+  if( slave_id < MBNET_SLAVE_NODES_BEGIN || slave_id > MBNET_SLAVE_NODES_END )
+#else
+  if( slave_id > MBNET_SLAVE_NODES_END )
+#endif
+    return 0; // not a windowed slave
+
+  mbnet_window_entry_t *oldest_sent;
+  if( !MBNET_WindowBatch(slave_id, &oldest_sent) )
+    return 0; // no batch outstanding for this slave
+
+  if( oldest_sent == NULL ) {
+    // more acknowledges than requests: a late acknowledge of a previous batch
+    if( verbose_level >= 3 ) {
+      DEBUG_MSG("[MBNET] dropped surplus ACK from slave ID 0x%02x\n", slave_id);
+    }
+    return 1; // taken
+  }
+
+  oldest_sent->state   = MBNET_WINDOW_ENTRY_ACKED;
+  oldest_sent->ack_tos = p->id.tos;
+  oldest_sent->ack_msg = p->msg;
+  oldest_sent->ack_dlc = p->dlc;
+
+  mbnet_window_entry_t *e;
+  MBNET_WindowBatch(slave_id, &e);
+  if( e == NULL )
+    MBNET_WindowBatchDone(slave_id); // all requests of the batch acknowledged
+
+  return 1; // acknowledge taken
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Local function: checks for batches with missing acknowledges
+/////////////////////////////////////////////////////////////////////////////
+static void MBNET_WindowTimeoutCheck(void)
+{
+  int i;
+  mbnet_window_entry_t *e = &window_queue[0];
+  for(i=0; i<MBNET_WINDOW_QUEUE_SIZE; ++i, ++e) {
+    // Acknowledges don't contain a sequence number. If a request or an
+    // acknowledge got lost, the received acknowledges can't be assigned to
+    // their requests anymore, therefore the whole batch is sent again.
+    // Late acknowledges are still accepted until the doubled timeout, so that
+    // they can't be taken for acknowledges of the resent batch.
+    if( e->state != MBNET_WINDOW_ENTRY_SENT || MIOS32_TIMESTAMP_GetDelay(e->timestamp) <= 2*MBNET_WINDOW_TIMEOUT )
+      continue;
+
+    u8 slave_id = e->slave_id;
+    u8 ix = slave_id-MBNET_SLAVE_NODES_BEGIN;
+    if( verbose_level >= 3 ) {
+      DEBUG_MSG("[MBNET] windowed requests to slave ID 0x%02x timed out (window size %d)!\n", slave_id, window_size[ix]);
+    }
+
+    ++window_timeout_ctr;
+    // the slave might not be able to buffer the whole batch
+    mbnet_window_entry_t *oldest_sent;
+    u8 batch_size = MBNET_WindowBatch(slave_id, &oldest_sent);
+    u8 limit = (batch_size > 1) ? (batch_size - 1) : 1;
+    if( window_limit[ix] > limit )
+      window_limit[ix] = limit;
+    window_probe_ctr[ix] = 0;
+    window_size[ix] = (window_size[ix] > 1) ? (window_size[ix] / 2) : 1;
+
+    int j;
+    mbnet_window_entry_t *e2 = &window_queue[0];
+    for(j=0; j<MBNET_WINDOW_QUEUE_SIZE; ++j, ++e2) {
+      if( e2->slave_id == slave_id &&
+	  (e2->state == MBNET_WINDOW_ENTRY_SENT || e2->state == MBNET_WINDOW_ENTRY_ACKED) ) {
+	if( ++e2->retry_ctr > MBNET_WINDOW_RETRY_MAX ) {
+	  MBNET_WindowComplete(e2, -6);
+	} else {
+	  ++window_resent_ctr;
+	  e2->state = MBNET_WINDOW_ENTRY_QUEUED; // keeps its position in the queue
+	}
+      }
+    }
+  }
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Queues a request to a slave node and returns immediately (non-blocking).
+// The request is sent once the window of the slave allows it (see
+// MBNET_WindowSizeSet), the acknowledge is forwarded to the callback which
+// is called from MBNET_WindowHandler() (or from MBNET_WaitAck*() if the last
+// acknowledge of a batch is received while waiting for another slave).
+//
+// Requests are sent in batches of up to <window size> requests. A batch is
+// completed once all acknowledges have been received. Requests which got a
+// retry acknowledge are sent again. If acknowledges are missing, the whole
+// batch will be sent again, therefore only RAM read/write and ping requests
+// are allowed, which can be executed multiple times. Requests to the same
+// slave should not depend on each other.
+//
+// Like all MBNET functions, this function has to be called while the MBNET
+// mutex of the application is taken. Windowed and blocking requests
+// (MBNET_SendReq/MBNET_WaitAck) shouldn't be mixed for the same slave.
+//
+// IN: <slave_id>: slave node ID (MBNET_SLAVE_NODES_BEGIN..MBNET_SLAVE_NODES_END)
+//     <tos_req>: request TOS (MBNET_REQ_RAM_READ, MBNET_REQ_RAM_WRITE or MBNET_REQ_PING)
+//     <control>: 16bit control field of ID
+//     <msg>: MBNet message (see mbnet_msg_t structure)
+//     <dlc>: data field length (0..8)
+//     <callback>: completion callback (can be NULL)
+//     <arg>: optional argument which is forwarded to the callback
+// OUT: returns 0 if request has been queued
+//      returns -1 if this node hasn't been configured yet
+//      returns -2 if this node isn't configured as master
+//      returns -3 on transmission error
+//      returns -8 if slave index outside allowed range
+//      returns -9 if queue is full (call MBNET_WindowHandler and try again)
+//      returns -10 if the request TOS can't be sent windowed
+/////////////////////////////////////////////////////////////////////////////
+s32 MBNET_SendReqWindowed(u8 slave_id, mbnet_tos_req_t tos_req, u16 control, mbnet_msg_t msg, u8 dlc, mbnet_req_callback_t callback, u32 arg)
+{
+  if( my_node_id >= 128 )
+    return -1; // node not configured
+
+  if( my_node_id & 0x0f )
+    return -2; // this node isn's configured as master
+
+#if MBNET_SLAVE_NODES_BEGIN > 0
+  if( slave_id < MBNET_SLAVE_NODES_BEGIN || slave_id > MBNET_SLAVE_NODES_END )
+#else
+  if( slave_id > MBNET_SLAVE_NODES_END )
+#endif
+    return -8; // outside allowed range
+
+  if( tos_req == MBNET_REQ_SPECIAL )
+    return -10; // special requests (e.g. lock/unlock) can't be repeated
+
+  if( MBNET_BusErrorCheck() < 0 )
+    return -3; // transmission error
+
+  // search for a free entry
+  int i;
+  mbnet_window_entry_t *e = &window_queue[0];
+  for(i=0; i<MBNET_WINDOW_QUEUE_SIZE; ++i, ++e)
+    if( e->state == MBNET_WINDOW_ENTRY_FREE )
+      break;
+
+  if( i >= MBNET_WINDOW_QUEUE_SIZE )
+    return -9; // queue full
+
+  e->mbnet_id.control = control;
+  e->mbnet_id.tos     = tos_req;
+  e->mbnet_id.ms      = my_node_id >> 4;
+  e->mbnet_id.ack     = 0;
+  e->mbnet_id.node    = slave_id;
+  e->msg       = msg;
+  e->dlc       = dlc;
+  e->slave_id  = slave_id;
+  e->retry_ctr = 0;
+  e->callback  = callback;
+  e->arg       = arg;
+  e->seq       = window_seq++;
+  e->state     = MBNET_WINDOW_ENTRY_QUEUED;
+  ++window_num_used;
+
+  // send immediately if the window allows it
+  MBNET_WindowTransmit();
+
+  return 0; // no error
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Returns the number of queued and outstanding windowed requests of a slave
+// (0 if all requests have been completed)
+// Returns -8 if slave index outside allowed range
+/////////////////////////////////////////////////////////////////////////////
+s32 MBNET_WindowPendingGet(u8 slave_id)
+{
+#if MBNET_SLAVE_NODES_BEGIN > 0
+  if( slave_id < MBNET_SLAVE_NODES_BEGIN || slave_id > MBNET_SLAVE_NODES_END )
+#else
+  if( slave_id > MBNET_SLAVE_NODES_END )
+#endif
+    return -8; // outside allowed range
+
+  int i;
+  s32 num = 0;
+  mbnet_window_entry_t *e = &window_queue[0];
+  for(i=0; i<MBNET_WINDOW_QUEUE_SIZE; ++i, ++e)
+    if( e->state != MBNET_WINDOW_ENTRY_FREE && e->slave_id == slave_id )
+      ++num;
+
+  return num;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Handles windowed requests, called from MBNET_Handler() if this node is a
+// master. Can also be called directly to wait for the completion of queued
+// requests.
+// - receives acknowledges and forwards them to the completion callbacks.
+//   Acknowledges of other slaves are kept for MBNET_WaitAck*()
+// - checks for timeouts
+// - sends queued requests
+// OUT: returns 0 if no error
+//      returns -3 on transmission error (all requests are cancelled)
+/////////////////////////////////////////////////////////////////////////////
+s32 MBNET_WindowHandler(void)
+{
+  if( !window_num_used )
+    return 0; // nothing to do
+
+  // cancel all requests on CAN bus errors
+  if( MBNET_BusErrorCheck() < 0 ) {
+    MBNET_WindowClear();
+    return -3; // transmission error
+  }
+
+  // check for incoming acknowledge messages
+  mbnet_packet_t p;
+  while( MBNET_HAL_ReceiveAck(&p) > 0 ) {
+    if( MBNET_WindowAck(&p) < 1 ) {
+      // not for a windowed request: keep it for MBNET_WaitAck*()
+      if( ack_stash_num >= MBNET_ACK_STASH_SIZE ) {
+	if( verbose_level >= 3 ) {
+	  DEBUG_MSG("[MBNET] ERROR: ACK from unexpected slave ID 0x%02x (TOS=%d DLC=%d MSG=%02x %02x %02x...)\n",
+		    ack_stash[0].id.control & 0xff,
+		    ack_stash[0].id.tos,
+		    ack_stash[0].dlc,
+		    ack_stash[0].msg.bytes[0], ack_stash[0].msg.bytes[1], ack_stash[0].msg.bytes[2]);
+	}
+	--ack_stash_num; // drop the oldest one
+	memmove(&ack_stash[0], &ack_stash[1], ack_stash_num*sizeof(mbnet_packet_t));
+      }
+      ack_stash[ack_stash_num++] = p;
+    }
+
+    if( !window_num_used )
+      return 0; // all requests completed, keep remaining acknowledges in CAN FIFO
+  }
+
+  // check for missing acknowledges
+  MBNET_WindowTimeoutCheck();
+
+  // send queued requests
+  MBNET_WindowTransmit();
+
+  return 0; // no error
+}
+
+
 /////////////////////////////////////////////////////////////////////////////
 // Handles CAN messages, should be called periodically to check the BUS
 // state and to check for incoming messages
@@ -505,6 +1058,9 @@ s32 MBNET_WaitAck(u8 slave_id, mbnet_msg_t *ack_msg, u8 *dlc)
 // In any case, the function has to send an acknowledge message back
 // to the master node!
 //
+// If this node is a master, windowed requests are handled as well
+// (see MBNET_SendReqWindowed)
+//
 // IN: pointer to callback function
 // OUT: returns < 0 on errors
 /////////////////////////////////////////////////////////////////////////////
@@ -599,6 +1155,10 @@ s32 MBNET_Handler(void (*callback)(u8 master_id, mbnet_tos_req_t tos, u16 contro
     }
   }
 
+  // windowed requests if this node is a master
+  if( (my_node_id & 0x0f) == 0 )
+    MBNET_WindowHandler();
+
   u8 got_msg;
   mbnet_packet_t p;
   s8 locked = -1; // contains MS node ID if slave has been locked, otherwise -1 if not locked
@@ -963,6 +1523,9 @@ s32 MBNET_TerminalPrintStatus(void *_output_function)
     }
   }
 
+  out("MBNET Windowed Requests: %d sent, %d resent, %d timeouts, %d errors, %d pending",
+      window_sent_ctr, window_resent_ctr, window_timeout_ctr, window_error_ctr, window_num_used);
+
   out("MBNET Verbose Level: %d", MBNET_VerboseLevelGet());
 
   return 0; // no error
@@ -42,6 +42,40 @@ extern "C" {
 #define MBNET_NODE_SCAN_RETRY 32
 #endif
 
+// relevant if configured as master: number of requests which can be queued
+// for windowed transfers (see MBNET_SendReqWindowed)
+#ifndef MBNET_WINDOW_QUEUE_SIZE
+#define MBNET_WINDOW_QUEUE_SIZE 16
+#endif
+
+// maximum number of outstanding requests per slave
+// (the actual window size is configured with MBNET_WindowSizeSet)
+#ifndef MBNET_WINDOW_SIZE_MAX
+#define MBNET_WINDOW_SIZE_MAX 4
+#endif
+
+// timeout in mS for the acknowledges of a batch of windowed requests
+// (late acknowledges are accepted until the doubled timeout)
+#ifndef MBNET_WINDOW_TIMEOUT
+#define MBNET_WINDOW_TIMEOUT 5
+#endif
+
+// number of successful batches after which a window which has been limited
+// by a timeout is allowed to grow again
+#ifndef MBNET_WINDOW_PROBE_BATCHES
+#define MBNET_WINDOW_PROBE_BATCHES 64
+#endif
+
+// how often should a windowed request be sent again after retry acknowledges or timeouts?
+#ifndef MBNET_WINDOW_RETRY_MAX
+#define MBNET_WINDOW_RETRY_MAX 16
+#endif
+
+// number of acknowledges which MBNET_WindowHandler() keeps for MBNET_WaitAck*()
+#ifndef MBNET_ACK_STASH_SIZE
+#define MBNET_ACK_STASH_SIZE 4
+#endif
+
 /////////////////////////////////////////////////////////////////////////////
 // Global Types
 /////////////////////////////////////////////////////////////////////////////
@@ -100,6 +134,12 @@ typedef union {
 } mbnet_state_t;
 
 
+// completion callback of windowed requests
+// status: 0 if acknowledged (see tos_ack), -3 on transmission error or if the request has been
+// cancelled by MBNET_Reconnect, -4 if retries exceeded, -6 on timeout
+typedef void (*mbnet_req_callback_t)(u8 slave_id, s32 status, mbnet_tos_ack_t tos_ack, mbnet_msg_t ack_msg, u8 dlc, u32 arg);
+
+
 /////////////////////////////////////////////////////////////////////////////
 // Prototypes
 /////////////////////////////////////////////////////////////////////////////
@@ -126,6 +166,12 @@ extern s32 MBNET_SendAck(u8 master_id, mbnet_tos_ack_t tos_ack, mbnet_msg_t msg,
 extern s32 MBNET_WaitAck_NonBlocking(u8 slave_id, mbnet_msg_t *ack_msg, u8 *dlc);
 extern s32 MBNET_WaitAck(u8 slave_id, mbnet_msg_t *ack_msg, u8 *dlc);
 
+extern s32 MBNET_WindowSizeSet(u8 slave_id, u8 size);
+extern s32 MBNET_WindowSizeGet(u8 slave_id);
+extern s32 MBNET_SendReqWindowed(u8 slave_id, mbnet_tos_req_t tos_req, u16 control, mbnet_msg_t msg, u8 dlc, mbnet_req_callback_t callback, u32 arg);
+extern s32 MBNET_WindowPendingGet(u8 slave_id);
+extern s32 MBNET_WindowHandler(void);
+
 extern s32 MBNET_Handler(void (*callback)(u8 master_id, mbnet_tos_req_t tos, u16 control, mbnet_msg_t req_msg, u8 dlc));
 
 extern s32 MBNET_InstallTxHandler(s32 (*tx_handler_callback)(mbnet_id_t *mbnet_id, mbnet_msg_t *msg, u8 *dlc));
@@ -0,0 +1,280 @@
+// Benchmark of the MINFS block cache and block allocation
+//
+// Runs sequential, random and metadata-heavy workloads on the RAM device
+// with different cache configurations, and compares the number of device
+// accesses and the throughput. The device time is modeled after a SPI
+// flash/FRAM (DEV_ACCESS_US per access + DEV_BYTE_US per byte), as the
+// RAM device itself is not representative.
+//
+// All data is verified, the program exits with 1 on errors.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "../minfs.h"
+#include "../minfs_ram.h"
+
+#define DEV_ACCESS_US 25.0
+#define DEV_BYTE_US 0.4
+
+#define SEQ_FILE_SIZE 16384
+#define SEQ_CHUNK 256
+#define RND_FILE_SIZE 8192
+#define RND_OPS 400
+#define RND_CHUNK 32
+#define META_NUM_FILES 48
+#define META_FILE_SIZE 40
+#define CHURN_FILE_SIZE 4096
+
+typedef struct{
+  const char *name;
+  uint8_t num_buffers;
+  uint8_t mode;
+} bench_config_t;
+
+static const bench_config_t configs[] = {
+  { "direct, 1 buffer", 1, MINFS_RAM_MODE_DIRECT },
+  { "write-back, 1 buffer", 1, MINFS_RAM_MODE_WRITE_BACK },
+  { "write-back, 4 buffers", 4, MINFS_RAM_MODE_WRITE_BACK },
+  { "write-back, 16 buffers", 16, MINFS_RAM_MODE_WRITE_BACK },
+};
+#define NUM_CONFIGS (sizeof(configs) / sizeof(bench_config_t))
+
+typedef struct{
+  const char *name;
+  uint32_t (*run)(void);
+} bench_workload_t;
+
+static MINFS_fs_t fs;
+static MINFS_file_t f;
+static uint8_t data[SEQ_FILE_SIZE];
+static uint8_t shadow[SEQ_FILE_SIZE];
+static uint32_t rnd_seed;
+static uint32_t churn_fragments;
+static uint32_t dev_accesses[4][NUM_CONFIGS];
+static int errors;
+
+
+// ------- local helpers -------
+static void check(int condition, const char *msg){
+  if( !condition ){
+    printf("ERROR: %s\n", msg);
+    ++errors;
+  }
+}
+
+static uint32_t rnd(void){
+  rnd_seed = rnd_seed * 1103515245 + 12345;
+  return (rnd_seed >> 16) & 0x7fff;
+}
+
+static double now_us(void){
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000.0 + ts.tv_nsec / 1000.0;
+}
+
+static void fill(uint8_t *buf, uint32_t len, uint32_t seed){
+  uint32_t i;
+  for(i = 0; i < len; i++)
+    buf[i] = (uint8_t)(seed + i * 7 + (i >> 8));
+}
+
+static int32_t file_write(uint32_t file_id, uint8_t *buf, uint32_t len){
+  int32_t status;
+  if( status = MINFS_FileOpen(&fs, file_id, &f, NULL) )
+    return status;
+  if( (status = MINFS_FileWrite(&f, buf, len, NULL)) && status != MINFS_STATUS_EOF )
+    return status;
+  return 0;
+}
+
+static int32_t file_verify(uint32_t file_id, uint8_t *buf, uint32_t len){
+  static uint8_t rbuf[SEQ_CHUNK];
+  uint32_t pos, rlen;
+  int32_t status;
+  if( status = MINFS_FileOpen(&fs, file_id, &f, NULL) )
+    return status;
+  if( f.info.size != len )
+    return -1000;
+  for(pos = 0; pos < len; pos += rlen){
+    rlen = (len - pos > SEQ_CHUNK) ? SEQ_CHUNK : len - pos;
+    if( (status = MINFS_FileRead(&f, rbuf, &rlen, NULL)) && status != MINFS_STATUS_EOF )
+      return status;
+    if( rlen == 0 || memcmp(rbuf, buf + pos, rlen) )
+      return -1001;
+  }
+  return 0;
+}
+
+// counts the parts of a file which are not stored in contiguous blocks
+// (reads the block-map directly from the device)
+static uint32_t file_fragments(MINFS_file_t *p_file){
+  uint8_t *map = MINFS_RAM_DevBlockGet(0);
+  uint32_t block_n = p_file->first_block_n, next_block_n, fragments = 1;
+  for(;;){
+    uint8_t *p = map + sizeof(MINFS_fs_header_t) + fs.calc.bp_size * (block_n - fs.calc.first_datablock_n);
+    next_block_n = p[0];
+    if( fs.calc.bp_size > 1 )
+      next_block_n |= p[1] << 8;
+    if( fs.calc.bp_size > 2 )
+      next_block_n |= (p[2] << 16) | (p[3] << 24);
+    if( next_block_n == MINFS_BLOCK_EOC )
+      break;
+    if( next_block_n != block_n + 1 )
+      ++fragments;
+    block_n = next_block_n;
+  }
+  return fragments;
+}
+
+
+// ------- workloads -------
+// each workload returns the number of payload bytes transfered
+
+// writes a file in chunks and reads it back
+static uint32_t bench_sequential(void){
+  uint32_t pos;
+  fill(data, SEQ_FILE_SIZE, 1);
+  check(MINFS_FileOpen(&fs, 1, &f, NULL) == 0, "sequential: open");
+  for(pos = 0; pos < SEQ_FILE_SIZE; pos += SEQ_CHUNK){
+    int32_t status = MINFS_FileWrite(&f, data + pos, SEQ_CHUNK, NULL);
+    check(status == 0 || status == MINFS_STATUS_EOF, "sequential: write");
+  }
+  check(file_verify(1, data, SEQ_FILE_SIZE) == 0, "sequential: verify");
+  return 2 * SEQ_FILE_SIZE;
+}
+
+// reads and writes small chunks at random positions
+static uint32_t bench_random(void){
+  static uint8_t chunk[RND_CHUNK];
+  uint32_t i, pos, len, bytes = 0;
+  int32_t status;
+  fill(shadow, RND_FILE_SIZE, 2);
+  check(file_write(2, shadow, RND_FILE_SIZE) == 0, "random: create");
+  bytes += RND_FILE_SIZE;
+  rnd_seed = 42;
+  for(i = 0; i < RND_OPS; i++){
+    pos = rnd() % (RND_FILE_SIZE - RND_CHUNK);
+    status = MINFS_FileSeek(&f, pos, NULL);
+    check(status == 0, "random: seek");
+    len = RND_CHUNK;
+    if( rnd() & 1 ){
+      fill(chunk, RND_CHUNK, i);
+      status = MINFS_FileWrite(&f, chunk, len, NULL);
+      check(status == 0 || status == MINFS_STATUS_EOF, "random: write");
+      memcpy(shadow + pos, chunk, RND_CHUNK);
+    } else {
+      status = MINFS_FileRead(&f, chunk, &len, NULL);
+      check((status == 0 || status == MINFS_STATUS_EOF) && len == RND_CHUNK, "random: read");
+      check(memcmp(chunk, shadow + pos, RND_CHUNK) == 0, "random: read data");
+    }
+    bytes += RND_CHUNK;
+  }
+  check(file_verify(2, shadow, RND_FILE_SIZE) == 0, "random: verify");
+  return bytes + RND_FILE_SIZE;
+}
+
+// creates many small files, unlinks every second one and checks the rest
+static uint32_t bench_metadata(void){
+  uint32_t i;
+  for(i = 0; i < META_NUM_FILES; i++){
+    fill(data, META_FILE_SIZE, 10 + i);
+    check(file_write(10 + i, data, META_FILE_SIZE) == 0, "metadata: create");
+  }
+  for(i = 0; i < META_NUM_FILES; i += 2)
+    check(MINFS_FileUnlink(&fs, 10 + i, 0, NULL) == 0, "metadata: unlink");
+  for(i = 0; i < META_NUM_FILES; i++){
+    int32_t status = MINFS_FileExists(&fs, 10 + i, NULL);
+    check((i & 1) ? (status == 0) : (status == MINFS_ERROR_FILE_NOT_EXISTS), "metadata: exists");
+    if( i & 1 ){
+      fill(data, META_FILE_SIZE, 10 + i);
+      check(file_verify(10 + i, data, META_FILE_SIZE) == 0, "metadata: verify");
+    }
+  }
+  return META_NUM_FILES * META_FILE_SIZE + (META_NUM_FILES / 2) * META_FILE_SIZE;
+}
+
+// appends to a file after the metadata workload has scattered the free blocks
+static uint32_t bench_churn(void){
+  uint32_t pos;
+  fill(data, CHURN_FILE_SIZE, 3);
+  check(MINFS_FileOpen(&fs, 3, &f, NULL) == 0, "churn: open");
+  for(pos = 0; pos < CHURN_FILE_SIZE; pos += SEQ_CHUNK){
+    int32_t status = MINFS_FileWrite(&f, data + pos, SEQ_CHUNK, NULL);
+    check(status == 0 || status == MINFS_STATUS_EOF, "churn: write");
+  }
+  check(file_verify(3, data, CHURN_FILE_SIZE) == 0, "churn: verify");
+  check(MINFS_RAM_Flush(&fs) == 0, "churn: flush");
+  churn_fragments = file_fragments(&f);
+  return 2 * CHURN_FILE_SIZE;
+}
+
+static const bench_workload_t workloads[] = {
+  { "sequential", bench_sequential },
+  { "random", bench_random },
+  { "metadata", bench_metadata },
+  { "append after churn", bench_churn },
+};
+#define NUM_WORKLOADS (sizeof(workloads) / sizeof(bench_workload_t))
+
+
+// ------- main -------
+int main(void){
+  uint32_t c, w;
+
+  printf("MINFS benchmark: %d blocks of %d bytes, MINFS_ALLOC_RUN_SEARCH=%d\n",
+	 MINFS_RAM_DEV_NUM_BLOCKS, MINFS_RAM_DEV_BLOCK_SIZE, MINFS_ALLOC_RUN_SEARCH);
+  printf("device model: %.1f uS per access + %.2f uS per byte\n\n", DEV_ACCESS_US, DEV_BYTE_US);
+  printf("%-20s %-24s %8s %8s %9s %9s %8s %10s\n",
+	 "workload", "cache", "reads", "writes", "dev bytes", "hit rate", "host mS", "KB/s");
+
+  for(c = 0; c < NUM_CONFIGS; c++){
+    // format and open a fresh file-system
+    MINFS_RAM_Init(configs[c].num_buffers, configs[c].mode);
+    fs.info.block_size = 6;
+    fs.info.num_blocks = MINFS_RAM_DEV_NUM_BLOCKS;
+    fs.info.flags = MINFS_FLAGS_NOPEC;
+    fs.info.os_flags = 0;
+    fs.fs_id = 1;
+    check(MINFS_Format(&fs, NULL) == 0, "format");
+    check(MINFS_RAM_Flush(&fs) == 0, "flush after format");
+    check(MINFS_FSOpen(&fs, NULL) == 0, "FS open");
+
+    for(w = 0; w < NUM_WORKLOADS; w++){
+      MINFS_RAM_stats_t s;
+      MINFS_RAM_StatsReset();
+      double t = now_us();
+      uint32_t bytes = workloads[w].run();
+      check(MINFS_RAM_Flush(&fs) == 0, "flush");
+      t = now_us() - t;
+      MINFS_RAM_StatsGet(&s);
+
+      uint32_t requests = s.hits + s.misses;
+      double dev_us = (s.dev_reads + s.dev_writes) * DEV_ACCESS_US + (s.dev_read_bytes + s.dev_write_bytes) * DEV_BYTE_US;
+      dev_accesses[w][c] = s.dev_reads + s.dev_writes;
+      printf("%-20s %-24s %8u %8u %9u %8.1f%% %8.3f %10.1f\n",
+	     workloads[w].name, configs[c].name, s.dev_reads, s.dev_writes,
+	     s.dev_read_bytes + s.dev_write_bytes, requests ? 100.0 * s.hits / requests : 0.0,
+	     t / 1000.0, bytes / 1.024 / (t + dev_us) * 1000.0);
+    }
+    printf("%-20s %-24s %u fragments in %u bytes\n\n", "", "", churn_fragments, CHURN_FILE_SIZE);
+
+    // drop the cache and check the data on the device
+    MINFS_RAM_Init(configs[c].num_buffers, configs[c].mode);
+    check(MINFS_FSOpen(&fs, NULL) == 0, "FS reopen");
+    fill(data, SEQ_FILE_SIZE, 1);
+    check(file_verify(1, data, SEQ_FILE_SIZE) == 0, "sequential: verify after reopen");
+    check(file_verify(2, shadow, RND_FILE_SIZE) == 0, "random: verify after reopen");
+    fill(data, CHURN_FILE_SIZE, 3);
+    check(file_verify(3, data, CHURN_FILE_SIZE) == 0, "churn: verify after reopen");
+  }
+
+  // the write-back cache has to save device accesses in all workloads
+  for(w = 0; w < NUM_WORKLOADS; w++)
+    check(dev_accesses[w][NUM_CONFIGS - 1] < dev_accesses[w][0], "write-back cache doesn't reduce device accesses");
+
+  printf(errors ? "FAILED with %d errors\n" : "PASSED\n", errors);
+  return errors ? 1 : 0;
+}
@@ -2,6 +2,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include "../minfs.h"
+#include "../minfs_ram.h"
 
 #define DATA_LEN 255
  
@@ -19,6 +20,13 @@ static uint32_t file_open(uint16_t file_i);
 static uint32_t file_write(void);
 static uint32_t file_read(void);
 
+static uint32_t regression_fs_init(uint32_t num_blocks);
+static uint32_t regression_write(uint32_t file_id, uint32_t offset, uint32_t len);
+static uint32_t regression_verify(uint32_t file_id, uint32_t offset, uint32_t len);
+static uint32_t regression_seek(void);
+static uint32_t regression_full(void);
+static uint32_t regression_wide_pointers(void);
+
 
 // ------- main -------
 int main(void){
@@ -44,14 +52,22 @@ int main(void){
 
   file_read();
 
+  // write cached blocks to the device
+  if( status = MINFS_RAM_Flush(&fs) )
+    printf("Error on flush: %d\n", status);
+
+  // regression tests
+  if( regression_seek() || regression_full() || regression_wide_pointers() )
+    exit(1);
 
+  printf("Regression tests passed.\n");
   exit(0);
 }
 
 // ------- helper functions -------
 static uint32_t fs_init(void){
   // initialize buffers
-  MINFS_RAM_Init();
+  MINFS_RAM_Init(MINFS_RAM_CACHE_BLOCKS, MINFS_RAM_MODE_WRITE_BACK);
   // format file-system
   fs.info.block_size = 6;
   fs.info.num_blocks = 64;
@@ -104,3 +120,148 @@ static uint32_t file_read(void){
   printf("\n%s\n\n", data);
   return 0;
 }
+
+// ------- regression tests -------
+// the data of a file is a pattern of its position, so every byte can be checked
+static uint8_t pattern(uint32_t file_id, uint32_t pos){
+  return (uint8_t)(pos * 7 + (pos >> 8) + file_id);
+}
+
+static uint32_t regression_fs_init(uint32_t num_blocks){
+  fs.info.block_size = 6;
+  fs.info.num_blocks = num_blocks;
+  fs.info.flags = MINFS_FLAGS_NOPEC;
+  fs.info.os_flags = 0;
+  fs.fs_id = 1;
+  if( (status = MINFS_Format(&fs, NULL)) || (status = MINFS_FSOpen(&fs, NULL)) ){
+    printf("Error on FS-format/open: %d\n", status);
+    return 1;
+  }
+  return 0;
+}
+
+// writes len pattern bytes at offset
+static uint32_t regression_write(uint32_t file_id, uint32_t offset, uint32_t len){
+  uint8_t buf[100];
+  uint32_t i, n;
+  if( (status = MINFS_FileOpen(&fs, file_id, &f, NULL)) || ((status = MINFS_FileSeek(&f, offset, NULL)) < 0 && status != MINFS_STATUS_EOF) ){
+    printf("Error on open/seek file %d: %d\n", file_id, status);
+    return 1;
+  }
+  while( len ){
+    n = len > sizeof(buf) ? sizeof(buf) : len;
+    for(i = 0; i < n; i++)
+      buf[i] = pattern(file_id, offset + i);
+    if( (status = MINFS_FileWrite(&f, buf, n, NULL)) && status != MINFS_STATUS_EOF )
+      return 1; // caller checks status
+    offset += n;
+    len -= n;
+  }
+  return 0;
+}
+
+// reads len bytes at offset and compares them with the pattern
+static uint32_t regression_verify(uint32_t file_id, uint32_t offset, uint32_t len){
+  uint8_t buf[100];
+  uint32_t i, n;
+  if( (status = MINFS_FileOpen(&fs, file_id, &f, NULL)) || ((status = MINFS_FileSeek(&f, offset, NULL)) < 0 && status != MINFS_STATUS_EOF) ){
+    printf("Error on open/seek file %d: %d\n", file_id, status);
+    return 1;
+  }
+  while( len ){
+    n = len > sizeof(buf) ? sizeof(buf) : len;
+    if( ((status = MINFS_FileRead(&f, buf, &n, NULL)) < 0 && status != MINFS_STATUS_EOF) || n == 0 ){
+      printf("Error on read of file %d at %d: %d\n", file_id, offset, status);
+      return 1;
+    }
+    for(i = 0; i < n; i++)
+      if( buf[i] != pattern(file_id, offset + i) ){
+        printf("Data mismatch in file %d at %d\n", file_id, offset + i);
+        return 1;
+      }
+    offset += n;
+    len -= n;
+  }
+  return 0;
+}
+
+// forward seeks starting at a block end have to land in the right block
+static uint32_t regression_seek(void){
+  const uint32_t size = 1000;
+  uint32_t pos, dist, len;
+  uint8_t b;
+  if( regression_fs_init(64) || regression_write(1, 0, size) ){
+    printf("Error on seek test setup: %d\n", status);
+    return 1;
+  }
+  // read up to every position (including all block ends), then seek forward
+  for(pos = 1; pos < size; pos++){
+    for(dist = 1; pos + dist < size && dist <= 2 * fs.calc.block_data_len; dist++){
+      if( (status = MINFS_FileSeek(&f, pos - 1, NULL)) )
+        return 1;
+      len = 1;
+      MINFS_FileRead(&f, &b, &len, NULL);
+      if( (status = MINFS_FileSeek(&f, pos + dist, NULL)) ){
+        printf("Error on seek from %d to %d: %d\n", pos, pos + dist, status);
+        return 1;
+      }
+      len = 1;
+      if( ((status = MINFS_FileRead(&f, &b, &len, NULL)) && status != MINFS_STATUS_EOF) || b != pattern(1, pos + dist) ){
+        printf("Seek from %d to %d read wrong data\n", pos, pos + dist);
+        return 1;
+      }
+    }
+  }
+  printf("Regression: forward seek OK\n");
+  return 0;
+}
+
+// a file which doesn't fit must return MINFS_STATUS_FULL without damaging other files
+static uint32_t regression_full(void){
+  const uint32_t num_blocks = 32;
+  if( regression_fs_init(num_blocks) || regression_write(1, 0, 300) ){
+    printf("Error on full test setup: %d\n", status);
+    return 1;
+  }
+  regression_write(2, 0, num_blocks * 64);
+  if( status != MINFS_STATUS_FULL ){
+    printf("Oversized file write returned %d instead of MINFS_STATUS_FULL\n", status);
+    return 1;
+  }
+  if( regression_verify(1, 0, 300) )
+    return 1;
+  printf("Regression: file-system full OK\n");
+  return 0;
+}
+
+// more than 255 blocks need 2-byte block pointers. Truncating a file relinks
+// chain entries which pointed to blocks > 255 to EOC.
+static uint32_t regression_wide_pointers(void){
+  const uint32_t size = 250 * 60;
+  if( regression_fs_init(300) || regression_write(1, 0, size) ){
+    printf("Error on wide pointer test setup: %d\n", status);
+    return 1;
+  }
+  if( fs.calc.bp_size != 2 ){
+    printf("Unexpected block pointer size %d\n", fs.calc.bp_size);
+    return 1;
+  }
+  // truncate file 1 and reuse its blocks for file 2
+  if( (status = MINFS_FileOpen(&fs, 1, &f, NULL)) || (status = MINFS_FileSetSize(&f, 1000, NULL)) ){
+    printf("Error on truncate: %d\n", status);
+    return 1;
+  }
+  if( regression_write(2, 0, size) ){
+    printf("Error on write of file 2: %d\n", status);
+    return 1;
+  }
+  // grow file 1 again
+  if( regression_write(1, 1000, 2000) ){
+    printf("Error on append to file 1: %d\n", status);
+    return 1;
+  }
+  if( regression_verify(1, 0, 3000) || regression_verify(2, 0, size) )
+    return 1;
+  printf("Regression: 2-byte block pointers OK\n");
+  return 0;
+}
@@ -58,11 +58,11 @@ static const uint32_t BECV = 1; // dummy value to check endianes
 #define LE_SET(p_dst, src, len){ \
   *( (uint8_t*)p_dst ) = (uint8_t)src; \
   if( len > 1 ) \
-    *( (uint8_t*)(p_dst + 1) ) |= (uint8_t)( src >> 8 ); \
+    *( (uint8_t*)(p_dst + 1) ) = (uint8_t)( src >> 8 ); \
   if( len > 2 ) \
-    *( (uint8_t*)(p_dst + 2) ) |= (uint8_t)( src >> 16 ); \
+    *( (uint8_t*)(p_dst + 2) ) = (uint8_t)( src >> 16 ); \
   if( len > 3 ) \
-    *( (uint8_t*)(p_dst + 3) ) |= (uint8_t)( src >> 24 ); \
+    *( (uint8_t*)(p_dst + 3) ) = (uint8_t)( src >> 24 ); \
 }
 
 // copies 1-4 bytes type-casted
@@ -203,7 +203,8 @@ static int32_t File_HeaderWrite(MINFS_fs_t *p_fs, uint32_t block_n, uint32_t fil
 // Block chain layer
 static int32_t BlockChain_Seek(MINFS_fs_t *p_fs, uint32_t block_n, uint32_t offset, MINFS_block_buf_t **pp_block_buf);
 static int32_t BlockChain_Link(MINFS_fs_t *p_fs, uint32_t block_n, uint32_t block_target, MINFS_block_buf_t **pp_block_buf);
-static int32_t BlockChain_PopFree(MINFS_fs_t *p_fs, uint32_t num_blocks, MINFS_block_buf_t **pp_block_buf);
+static int32_t BlockChain_PopFree(MINFS_fs_t *p_fs, uint32_t num_blocks, uint32_t hint_block_n, MINFS_block_buf_t **pp_block_buf);
+static int32_t BlockChain_FindRun(MINFS_fs_t *p_fs, uint32_t num_blocks, uint32_t hint_block_n, uint32_t *p_prev_block, MINFS_block_buf_t **pp_block_buf);
 static int32_t BlockChain_PushFree(MINFS_fs_t *p_fs, uint32_t start_block, MINFS_block_buf_t **pp_block_buf);
 
 // Buffer and RW layer
@@ -871,7 +872,7 @@ static int32_t File_Touch(MINFS_file_t *p_file_0, uint32_t file_id, MINFS_block_
   if( status != MINFS_ERROR_FILE_NOT_EXISTS )
     return status; // return error status
   // file does not exists, pop a free block
-  if( (block_n = BlockChain_PopFree( p_file_0->p_fs, 1, pp_block_buf )) < 0 )
+  if( (block_n = BlockChain_PopFree( p_file_0->p_fs, 1, MINFS_BLOCK_NULL, pp_block_buf )) < 0 )
     return block_n; // return error status
   // set file pointer to the free block
   if( status = File_SetFilePointer(p_file_0, file_id, block_n, pp_block_buf) )
@@ -940,7 +941,7 @@ static int32_t File_Seek(MINFS_file_t *p_file, uint32_t pos, MINFS_block_buf_t *
   if( pos == p_file->data_ptr )
     return 0;
   int32_t ret_status = 0;
-  uint32_t seek_start_data_ptr;
+  uint32_t seek_start_block_i; // index of the seek start block in the file's block chain
   uint32_t seek_start_block_n;
   // move forward ?
   if( pos > p_file->data_ptr ){
@@ -961,8 +962,10 @@ static int32_t File_Seek(MINFS_file_t *p_file, uint32_t pos, MINFS_block_buf_t *
       p_file->data_ptr = pos;
       return ret_status;
     } 
-    // seek from current position
-    seek_start_data_ptr = p_file->data_ptr;
+    // seek from current block. NOTE: data_ptr_block_offset may be block_data_len
+    // (data_ptr at the end of the current block), so the index has to be
+    // calculated from the start of the block
+    seek_start_block_i = (p_file->data_ptr + sizeof(MINFS_file_header_t) - p_file->data_ptr_block_offset) / p_file->p_fs->calc.block_data_len;
     seek_start_block_n = p_file->current_block_n;
   } else {
     // still in current buffer ?
@@ -972,12 +975,12 @@ static int32_t File_Seek(MINFS_file_t *p_file, uint32_t pos, MINFS_block_buf_t *
       return ret_status;
     }
     // seek from start
-    seek_start_data_ptr = 0;
+    seek_start_block_i = 0;
     seek_start_block_n = p_file->first_block_n;
   }
   // calculate block offset and seek
   uint32_t block_n_offset = (pos + sizeof(MINFS_file_header_t)) / p_file->p_fs->calc.block_data_len 
-      - ( seek_start_data_ptr + sizeof(MINFS_file_header_t)) /  p_file->p_fs->calc.block_data_len;
+      - seek_start_block_i;
   int32_t status;
   if( (status = BlockChain_Seek(p_file->p_fs, seek_start_block_n, block_n_offset, pp_block_buf)) < 0)
     return status; // return error status
@@ -1015,7 +1018,7 @@ static int32_t File_SetSize(MINFS_file_t *p_file, uint32_t new_size, MINFS_block
       int32_t fbc_cont_block;
       // find new last block
       uint32_t new_num_blocks = ( new_size + sizeof(MINFS_file_header_t)) / p_file->p_fs->calc.block_data_len
-        + ( ( new_size + sizeof(MINFS_file_header_t)) % p_file->p_fs->calc.block_data_len ) ? 1 : 0;
+        + ( ( ( new_size + sizeof(MINFS_file_header_t)) % p_file->p_fs->calc.block_data_len ) ? 1 : 0 );
       if( (new_last_block_n = BlockChain_Seek(p_file->p_fs, p_file->first_block_n, new_num_blocks - 1, pp_block_buf)) < 0 )
         return new_last_block_n; // return error status
       // if EOC, the file's block chain is broken
@@ -1066,8 +1069,9 @@ static int32_t File_SetSize(MINFS_file_t *p_file, uint32_t new_size, MINFS_block
       uint32_t add_block_bytes_count = (add_bytes_count - last_block_bytes_left );
       uint32_t add_blocks_count = add_block_bytes_count / p_file->p_fs->calc.block_data_len + 1;
 
+      // prefer a contiguous run directly behind the file's last block
       int32_t add_blocks_first_n;
-      if( (add_blocks_first_n = BlockChain_PopFree(p_file->p_fs, add_blocks_count, pp_block_buf)) < 0)
+      if( (add_blocks_first_n = BlockChain_PopFree(p_file->p_fs, add_blocks_count, file_last_block_n + 1, pp_block_buf)) < 0)
         return add_blocks_first_n; // return error status
       // add free blocks to files block-chain
       int32_t status;
@@ -1187,30 +1191,46 @@ static int32_t File_HeaderWrite(MINFS_fs_t *p_fs, uint32_t block_n, uint32_t fil
 
 /////////////////////////////////////////////////////////////////////////////
 // Pops num_block from the free-block-chain and returns the first block number.
+// If MINFS_ALLOC_RUN_SEARCH is > 0, a run of physically contiguous blocks is
+// taken from the fbc if one can be found (see BlockChain_FindRun), else the
+// first num_blocks blocks of the fbc are popped.
 //
 // IN:  <p_fs> Pointer to a populated fs-structure
 //      <num_blocks> Number of free blocks to pop
+//      <hint_block_n> Preferred first block (usually the block behind the
+//                     last block of a growing file), or MINFS_BLOCK_NULL
 //      <block_buf> Pointer to a MINFS_block_buf_t pointer
 // OUT: First block number, on error < 0 (MINFS_ERROR_XXXX or MINFS_STATUS_FULL)
 /////////////////////////////////////////////////////////////////////////////
-static int32_t BlockChain_PopFree(MINFS_fs_t *p_fs, uint32_t num_blocks, MINFS_block_buf_t **pp_block_buf){
+static int32_t BlockChain_PopFree(MINFS_fs_t *p_fs, uint32_t num_blocks, uint32_t hint_block_n, MINFS_block_buf_t **pp_block_buf){
   if( num_blocks == 0 )
     return MINFS_BLOCK_EOC; // return EOC-pointer
-  // seek first block to pop off the fbc 
   // p_fs->info.num_blocks is the virtual start block of the fbc
-  int32_t start_block;
-  if( (start_block = BlockChain_Seek(p_fs, p_fs->info.num_blocks, 1, pp_block_buf)) < 0 )
-    return start_block; // return error status
-  else if(start_block == MINFS_BLOCK_EOC)
-    return MINFS_STATUS_FULL; // no more free blocks
-  // seek last block to pop off the fbc
+  uint32_t prev_block = p_fs->info.num_blocks; // fbc-element pointing to start_block
+  int32_t start_block = MINFS_BLOCK_EOC;
   int32_t end_block;
-  if( num_blocks > 1 ){
-    if( (end_block  = BlockChain_Seek(p_fs, start_block, num_blocks-1, pp_block_buf)) < 0 )
-      return end_block; // return error status
-    else if(end_block == MINFS_BLOCK_EOC)
-      return MINFS_STATUS_FULL; // can't get the requested number of free blocks
-  } else end_block = start_block;
+#if MINFS_ALLOC_RUN_SEARCH > 0
+  // search a contiguous run of free blocks
+  if( (start_block = BlockChain_FindRun(p_fs, num_blocks, hint_block_n, &prev_block, pp_block_buf)) < 0 )
+    return start_block; // return error status
+#endif
+  if( start_block != MINFS_BLOCK_EOC ){
+    // the blocks of the run are chained in ascending order
+    end_block = start_block + num_blocks - 1;
+  } else {
+    // seek first block to pop off the fbc 
+    if( (start_block = BlockChain_Seek(p_fs, prev_block, 1, pp_block_buf)) < 0 )
+      return start_block; // return error status
+    else if(start_block == MINFS_BLOCK_EOC)
+      return MINFS_STATUS_FULL; // no more free blocks
+    // seek last block to pop off the fbc
+    if( num_blocks > 1 ){
+      if( (end_block  = BlockChain_Seek(p_fs, start_block, num_blocks-1, pp_block_buf)) < 0 )
+        return end_block; // return error status
+      else if(end_block == MINFS_BLOCK_EOC)
+        return MINFS_STATUS_FULL; // can't get the requested number of free blocks
+    } else end_block = start_block;
+  }
   // now get the block-number next in chain after the last block to pop off the fbc
   int32_t fbc_cont_block;
   if( (fbc_cont_block = BlockChain_Seek(p_fs, end_block, 1, pp_block_buf)) < 0 )
@@ -1221,13 +1241,61 @@ static int32_t BlockChain_PopFree(MINFS_fs_t *p_fs, uint32_t num_blocks, MINFS_b
   if( status = BlockChain_Link(p_fs, end_block, MINFS_BLOCK_EOC, pp_block_buf) )
     return status;
   // continue free blocks chain at entry after the last popped block
-  if( status = BlockChain_Link(p_fs, p_fs->info.num_blocks, fbc_cont_block, pp_block_buf) )
+  if( status = BlockChain_Link(p_fs, prev_block, fbc_cont_block, pp_block_buf) )
     return status;
   // success, return start block of poped blocks chain
   return start_block;  
 }
 
 
+/////////////////////////////////////////////////////////////////////////////
+// Walks the first MINFS_ALLOC_RUN_SEARCH elements of the free-blocks-chain
+// to find num_blocks blocks which are chained in ascending physical order
+// (block_n, block_n + 1, ...). Such runs keep the data of a growing file
+// together on the device and their chain-entries in the same block-map
+// buffer. A run starting at hint_block_n is preferred, else the first run
+// found will be returned.
+//
+// IN:  <p_fs> Pointer to a populated fs-structure
+//      <num_blocks> Length of the run
+//      <hint_block_n> Preferred first block of the run, or MINFS_BLOCK_NULL
+//      <p_prev_block> Will be set to the fbc-element pointing to the run
+//      <block_buf> Pointer to a MINFS_block_buf_t pointer
+// OUT: First block of the run, MINFS_BLOCK_EOC if no run was found,
+//      on error < 0 (MINFS_ERROR_XXXX)
+/////////////////////////////////////////////////////////////////////////////
+static int32_t BlockChain_FindRun(MINFS_fs_t *p_fs, uint32_t num_blocks, uint32_t hint_block_n, uint32_t *p_prev_block, MINFS_block_buf_t **pp_block_buf){
+  uint32_t block_n = p_fs->info.num_blocks; // start at the virtual fbc-block
+  uint32_t run_prev_block = block_n, run_start_block = MINFS_BLOCK_EOC, run_len = 0, i;
+  int32_t next_block_n, found_block_n = MINFS_BLOCK_EOC;
+  for(i = 0; i < MINFS_ALLOC_RUN_SEARCH; i++){
+    if( (next_block_n = BlockChain_Seek(p_fs, block_n, 1, pp_block_buf)) < 0 )
+      return next_block_n; // return error status
+    if( next_block_n == MINFS_BLOCK_EOC )
+      break; // end of fbc reached
+    // continue the current run, or start a new one
+    if( run_len && next_block_n == block_n + 1 )
+      run_len++;
+    else {
+      run_prev_block = block_n;
+      run_start_block = next_block_n;
+      run_len = 1;
+    }
+    block_n = next_block_n;
+    if( run_len == num_blocks ){
+      // remember the first run, and the one starting at hint_block_n
+      if( found_block_n == MINFS_BLOCK_EOC || run_start_block == hint_block_n ){
+        found_block_n = run_start_block;
+        *p_prev_block = run_prev_block;
+      }
+      if( hint_block_n == MINFS_BLOCK_NULL || run_start_block == hint_block_n )
+        break;
+    }
+  }
+  return found_block_n;
+}
+
+
 /////////////////////////////////////////////////////////////////////////////
 // Adds a block-chain (start_block -> EOC) to the free-blocks-chain
 // 
@@ -1277,6 +1345,8 @@ static int32_t BlockChain_Seek(MINFS_fs_t *p_fs, uint32_t block_n, uint32_t offs
   uint32_t block_chain_block_n, last_block_n;
   uint16_t block_chain_entry_offset;
   int32_t status;
+  // offset will be decremented while seeking, remember if seek-end was requested
+  uint8_t seek_end = (offset == MINFS_SEEK_END);
   while( offset > 0 ){
     // calculate block and offset where the next block-pointer is stored
     block_chain_entry_offset = sizeof(MINFS_fs_header_t) + p_fs->calc.bp_size * (block_n - p_fs->calc.first_datablock_n); // chain-pointer offset from beginning of fs
@@ -1294,7 +1364,7 @@ static int32_t BlockChain_Seek(MINFS_fs_t *p_fs, uint32_t block_n, uint32_t offs
     // check if EOC
     if( block_n == MINFS_BLOCK_EOC ){
       // if seek-end requested, return the last block number
-      if( offset = MINFS_SEEK_END )
+      if( seek_end )
         return last_block_n;
       // offset was not reached, return EOC
       return MINFS_BLOCK_EOC;
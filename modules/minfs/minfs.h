@@ -76,6 +76,12 @@
 #define MINFS_MAX_NUMBLOCKS 0x000FFFFF
 #define MINFS_MAX_FILE_ID 0x000FFFFD
 
+// number of free-blocks-chain elements searched for a run of contiguous
+// blocks when a file grows (0: always take the first free blocks)
+#ifndef MINFS_ALLOC_RUN_SEARCH
+#define MINFS_ALLOC_RUN_SEARCH 32
+#endif
+
 // modes
 #define MINFS_MODE_FFID_NEXT 0
 #define MINFS_MODE_FFID_FIRST 0
@@ -1,12 +1,19 @@
 /*
  * MINFS caching layer
  *
+ * Provides a RAM device (fs_id 1) behind a cache of up to
+ * MINFS_RAM_CACHE_BLOCKS block-buffers, which are replaced in LRU order.
+ * In MINFS_RAM_MODE_WRITE_BACK, blocks are populated completely on the
+ * first access and changed data is only written to the device when the
+ * buffer is evicted, or by MINFS_RAM_Flush.
+ * fs_id 0 is an in-memory filesystem which accesses the blocks directly.
+ *
  * ==========================================================================
  *
  *  Copyright (C) 2009 Matthias Mächler (maechler@mm-computing.ch / thismaechler@gmx.ch)
  *  Licensed for personal non-commercial use only.
  *  All other rights reserved.
- * 
+ *
  * ==========================================================================
  */
 
@@ -15,32 +22,99 @@
 /////////////////////////////////////////////////////////////////////////////
 
 #include "minfs.h"
+#include "minfs_ram.h"
 #include <string.h>
 
 
-#define DEV_BLOCK_SIZE 64
-#define DEV_NUM_BLOCKS 32
-
 /////////////////////////////////////////////////////////////////////////////
 // Local variables
 /////////////////////////////////////////////////////////////////////////////
 
-typedef uint8_t databuf_t[DEV_BLOCK_SIZE];
+typedef uint8_t databuf_t[MINFS_RAM_DEV_BLOCK_SIZE];
 
 // virtual device blocks (or memory-fs)
-static databuf_t storage_blocks[DEV_NUM_BLOCKS];
+static databuf_t storage_blocks[MINFS_RAM_DEV_NUM_BLOCKS];
+
+// block-buffers of the cache
+static MINFS_block_buf_t cache_buf[MINFS_RAM_CACHE_BLOCKS];
+static databuf_t cache_buf_buffer[MINFS_RAM_CACHE_BLOCKS];
+static uint32_t cache_buf_used[MINFS_RAM_CACHE_BLOCKS]; // LRU timestamps
+static uint32_t cache_clock;
+static uint8_t cache_num_buffers;
+static uint8_t cache_mode;
+
+// block-buffer of the in-memory-filesystem
+static MINFS_block_buf_t direct_buf;
+
+// device access counters
+static MINFS_RAM_stats_t stats;
 
-// block-buffer
-static MINFS_block_buf_t block_buf;
-static databuf_t block_buf_buffer;
 
 /////////////////////////////////////////////////////////////////////////////
 // Blockbuffer initialization
-////////////////////////////////////////////////////////////////////////////
+// Dismisses all cached blocks, call MINFS_RAM_Flush before if the cache
+// contains changes!
+//
+// IN:  <num_buffers> number of block-buffers to use (1..MINFS_RAM_CACHE_BLOCKS)
+//      <mode> MINFS_RAM_MODE_DIRECT or MINFS_RAM_MODE_WRITE_BACK
+// OUT: number of block-buffers in use
+/////////////////////////////////////////////////////////////////////////////
+int32_t MINFS_RAM_Init(uint8_t num_buffers, uint8_t mode){
+  uint8_t i;
+  if( num_buffers < 1 )
+    num_buffers = 1;
+  else if( num_buffers > MINFS_RAM_CACHE_BLOCKS )
+    num_buffers = MINFS_RAM_CACHE_BLOCKS;
+  for(i = 0; i < MINFS_RAM_CACHE_BLOCKS; i++){
+    MINFS_InitBlockBuffer(&cache_buf[i]);
+    cache_buf[i].p_buf = cache_buf_buffer[i];
+    cache_buf_used[i] = 0;
+  }
+  MINFS_InitBlockBuffer(&direct_buf);
+  cache_clock = 0;
+  cache_num_buffers = num_buffers;
+  cache_mode = mode;
+  return num_buffers;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// Writes all changed block-buffers to the device. Has to be called at the
+// end of each MINFS-session (e.g. before the device is powered down or
+// removed), and before MINFS_RAM_Init.
+//
+// IN:  <p_fs> Pointer to the filesystem-info structure
+// OUT: 0 on success, else < 0 (MINFS_ERROR_XXXX)
+/////////////////////////////////////////////////////////////////////////////
+int32_t MINFS_RAM_Flush(MINFS_fs_t *p_fs){
+  int32_t status;
+  uint8_t i;
+  for(i = 0; i < cache_num_buffers; i++){
+    if( cache_buf[i].block_n != MINFS_BLOCK_NULL && cache_buf[i].flags.changed ){
+      if( status = MINFS_FlushBlockBuffer(p_fs, &cache_buf[i]) )
+        return status; // return error status
+    }
+  }
+  return 0;
+}
 
-void MINFS_RAM_Init(void){
-  MINFS_InitBlockBuffer(&block_buf);
-  block_buf.p_buf = block_buf_buffer;
+/////////////////////////////////////////////////////////////////////////////
+// Device access counters
+/////////////////////////////////////////////////////////////////////////////
+int32_t MINFS_RAM_StatsGet(MINFS_RAM_stats_t *p_stats){
+  *p_stats = stats;
+  return 0;
+}
+
+int32_t MINFS_RAM_StatsReset(void){
+  memset(&stats, 0, sizeof(MINFS_RAM_stats_t));
+  return 0;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// Returns a pointer to a block of the virtual device (bypasses the cache)
+/////////////////////////////////////////////////////////////////////////////
+uint8_t *MINFS_RAM_DevBlockGet(uint32_t block_n){
+  return (block_n < MINFS_RAM_DEV_NUM_BLOCKS) ? storage_blocks[block_n] : NULL;
 }
 
 /////////////////////////////////////////////////////////////////////////////
@@ -49,12 +123,25 @@ void MINFS_RAM_Init(void){
 int32_t MINFS_Read(MINFS_fs_t *p_fs, MINFS_block_buf_t *p_block_buf, uint16_t data_offset, uint16_t data_len){
   if( p_fs->fs_id == 1){
     // simulate an external storage device (with random-access ability).
-    // if PEC is enabled, only whole blocks will be read (data_len == 0)
-    if(!data_len){
-      data_len = DEV_BLOCK_SIZE; // read entire block
+    if( p_block_buf->block_n >= MINFS_RAM_DEV_NUM_BLOCKS )
+      return MINFS_ERROR_BLOCK_N;
+    // a changed buffer which was never populated has been composed completely
+    // (only happens on format with PEC), the device content is outdated
+    if( p_block_buf->flags.changed ){
+      p_block_buf->flags.populated = 1;
+      return 0;
+    }
+    // if PEC is enabled, only whole blocks will be read (data_len == 0).
+    // The write-back cache populates whole blocks, so that further portions
+    // are served from the buffer
+    if( !data_len || cache_mode == MINFS_RAM_MODE_WRITE_BACK ){
+      data_offset = 0;
+      data_len = MINFS_RAM_DEV_BLOCK_SIZE; // read entire block
       p_block_buf->flags.populated = 1; // indicate that the whole block was read and copied to the buffer
-   }
+    }
     memcpy( (uint8_t*)( (uint8_t*)(p_block_buf->p_buf) + data_offset ), (uint8_t*)( (uint8_t*)(storage_blocks[p_block_buf->block_n]) + data_offset ), data_len);
+    stats.dev_reads++;
+    stats.dev_read_bytes += data_len;
   }
   return 0;
 }
@@ -62,22 +149,54 @@ int32_t MINFS_Read(MINFS_fs_t *p_fs, MINFS_block_buf_t *p_block_buf, uint16_t da
 int32_t MINFS_Write(MINFS_fs_t *p_fs, MINFS_block_buf_t *p_block_buf, uint16_t data_offset, uint16_t data_len){
   if( p_fs->fs_id == 1){
     // simulate an external storage device (with random-access ability).
+    if( p_block_buf->block_n >= MINFS_RAM_DEV_NUM_BLOCKS )
+      return MINFS_ERROR_BLOCK_N;
+    // write-back: keep the changed-flag set, the block will be written when the
+    // buffer gets evicted or flushed. Portions of non-populated buffers are
+    // written immediately, as the rest of the buffer is not valid.
+    if( data_len && cache_mode == MINFS_RAM_MODE_WRITE_BACK && p_block_buf->flags.populated )
+      return 0;
     // if PEC is enabled, only whole blocks will be written (data_len == 0)
-    memcpy(&(storage_blocks[p_block_buf->block_n][data_offset]), (uint8_t*)(p_block_buf->p_buf) + data_offset, data_len ? data_len : DEV_BLOCK_SIZE);
+    if( !data_len ){
+      data_offset = 0;
+      data_len = MINFS_RAM_DEV_BLOCK_SIZE;
+    }
+    memcpy(&(storage_blocks[p_block_buf->block_n][data_offset]), (uint8_t*)(p_block_buf->p_buf) + data_offset, data_len);
     p_block_buf->flags.changed = 0;
+    stats.dev_writes++;
+    stats.dev_write_bytes += data_len;
   }
   return 0;
 }
 
 int32_t MINFS_GetBlockBuffer(MINFS_fs_t *p_fs, MINFS_block_buf_t **pp_block_buf, uint32_t block_n, uint32_t file_id){
-  // assign blockbuffer to return
-  (*pp_block_buf) = &block_buf;
   // if used as in-memory-filesystem, the data-block is assigned directly
   // flags and block_n are set, no call to read or write - hook will ever occur!
   if( p_fs->fs_id == 0){
-    block_buf.block_n = block_n;
-    block_buf.flags.populated = 1;
-    block_buf.p_buf = storage_blocks[block_n];
+    if( block_n >= MINFS_RAM_DEV_NUM_BLOCKS )
+      return MINFS_ERROR_BLOCK_N;
+    direct_buf.block_n = block_n;
+    direct_buf.flags.populated = 1;
+    direct_buf.p_buf = storage_blocks[block_n];
+    (*pp_block_buf) = &direct_buf;
+    return 0;
+  }
+  // return the cached buffer if the block is already assigned to one, else
+  // the least recently used buffer. MINFS flushes the buffer if it contains
+  // changes of another block.
+  uint8_t i, lru_i = 0;
+  for(i = 0; i < cache_num_buffers; i++){
+    if( cache_buf[i].block_n == block_n ){
+      stats.hits++;
+      cache_buf_used[i] = ++cache_clock;
+      (*pp_block_buf) = &cache_buf[i];
+      return 0;
+    }
+    if( cache_buf_used[i] < cache_buf_used[lru_i] )
+      lru_i = i;
   }
+  stats.misses++;
+  cache_buf_used[lru_i] = ++cache_clock;
+  (*pp_block_buf) = &cache_buf[lru_i];
   return 0;
 }
@@ -0,0 +1,70 @@
+/*
+ * Header file for minfs_ram.c
+ *
+ * ==========================================================================
+ *
+ *  Copyright (C) 2009 Matthias Mächler (maechler@mm-computing.ch / thismaechler@gmx.ch)
+ *  Licensed for personal non-commercial use only.
+ *  All other rights reserved.
+ *
+ * ==========================================================================
+ */
+
+#include "minfs.h"
+
+
+#ifndef _MINFS_RAM_H
+#define _MINFS_RAM_H
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Global definitions
+/////////////////////////////////////////////////////////////////////////////
+
+// size of a block of the virtual device (fs_id 0 and 1)
+#ifndef MINFS_RAM_DEV_BLOCK_SIZE
+#define MINFS_RAM_DEV_BLOCK_SIZE 64
+#endif
+
+// number of blocks of the virtual device
+#ifndef MINFS_RAM_DEV_NUM_BLOCKS
+#define MINFS_RAM_DEV_NUM_BLOCKS 32
+#endif
+
+// maximum number of block-buffers in the cache
+#ifndef MINFS_RAM_CACHE_BLOCKS
+#define MINFS_RAM_CACHE_BLOCKS 4
+#endif
+
+// cache modes
+#define MINFS_RAM_MODE_DIRECT 0 // data portions are read/written immediately
+#define MINFS_RAM_MODE_WRITE_BACK 1 // whole blocks are read, written on eviction/flush
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Global Types
+/////////////////////////////////////////////////////////////////////////////
+
+typedef struct{
+  uint32_t dev_reads; // number of device read accesses
+  uint32_t dev_writes; // number of device write accesses
+  uint32_t dev_read_bytes; // bytes read from the device
+  uint32_t dev_write_bytes; // bytes written to the device
+  uint32_t hits; // block-buffer requests served by the cache
+  uint32_t misses; // block-buffer requests which had to evict a buffer
+} MINFS_RAM_stats_t;
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Prototypes
+/////////////////////////////////////////////////////////////////////////////
+extern int32_t MINFS_RAM_Init(uint8_t num_buffers, uint8_t mode);
+extern int32_t MINFS_RAM_Flush(MINFS_fs_t *p_fs);
+
+extern int32_t MINFS_RAM_StatsGet(MINFS_RAM_stats_t *p_stats);
+extern int32_t MINFS_RAM_StatsReset(void);
+
+extern uint8_t *MINFS_RAM_DevBlockGet(uint32_t block_n);
+
+
+#endif /* _MINFS_RAM_H */
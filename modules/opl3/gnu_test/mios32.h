@@ -0,0 +1,69 @@
+// minimal MIOS32 environment to compile opl3.c on the host
+#ifndef _MIOS32_H
+#define _MIOS32_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+typedef uint8_t  u8;
+typedef uint16_t u16;
+typedef uint32_t u32;
+typedef uint64_t u64;
+typedef int8_t   s8;
+typedef int16_t  s16;
+typedef int32_t  s32;
+
+// two chips, like MIDIbox FM V2.1
+#define MIOS32_BOARD_MBHP_CORE_STM32F4
+#define OPL3_COUNT    2
+#define OPL3_CS_PINS  {12,13}
+#define OPL3_CS_MASKS {1<<4,1<<5}
+
+#define MIOS32_IRQ_Disable() do {} while(0)
+#define MIOS32_IRQ_Enable()  do {} while(0)
+
+#define MIOS32_MIDI_SendDebugMessage(...) do {} while(0)
+#define DEBUG_MSG printf
+
+// advances the simulated time
+extern void Bus_Delay_uS(u32 us);
+#define MIOS32_DELAY_Wait_uS(us) Bus_Delay_uS(us)
+
+typedef struct {
+  u32 MODER;
+  u32 OTYPER;
+  u32 OSPEEDR;
+  u32 PUPDR;
+  u32 IDR;
+  u32 ODR;
+} GPIO_TypeDef;
+
+typedef struct {
+  u32 GPIO_Pin;
+  u32 GPIO_Mode;
+  u32 GPIO_Speed;
+  u32 GPIO_OType;
+} GPIO_InitTypeDef;
+
+#define GPIO_Pin_8        (1 << 8)
+#define GPIO_Mode_OUT     1
+#define GPIO_Speed_50MHz  2
+#define GPIO_OType_PP     0
+#define GPIO_StructInit(s) ((void)(s))
+#define GPIO_Init(p, s)    ((void)(p), (void)(s))
+
+#define MIOS32_BOARD_PIN_MODE_OUTPUT_PP 0
+#define MIOS32_BOARD_J10_PinInit(pin, mode) ((void)(pin))
+#define MIOS32_BOARD_J10_PinSet(pin, value) ((void)(pin))
+#define MIOS32_SYS_STM_PINSET(port, pin, value) do {} while(0)
+
+extern GPIO_TypeDef test_gpiob;
+#define GPIOB (&test_gpiob)
+
+// Every access to port E goes through Bus_Port(), so the test double in
+// opl3_sim.c sees the value written before by the driver on the next access
+extern GPIO_TypeDef *Bus_Port(void);
+#define GPIOE (Bus_Port())
+
+#endif /* _MIOS32_H */
@@ -0,0 +1,298 @@
+// Host simulation of the OPL3 bus
+//
+// opl3.c is compiled against a port E in memory (see mios32.h). The test
+// double decodes the address and data phases of each write from the /CS
+// strobes and applies them to a register image of both chips. The time the
+// driver waits on the bus (with interrupts disabled) is counted per frame.
+//
+// The workload is a 1 mS control refresh like MBFM_BackgroundTick() with all
+// 36 voices playing: vibrato via OPL3_SetFrequency() on every frame, tremolo
+// on the carriers, a slow sweep of the modulator levels, retriggered notes
+// with new envelopes, and a patch change of all voices in the middle.
+//
+// The makefile builds it twice: skipping unchanged registers
+// (OPL3_SKIP_UNCHANGED=1) and writing every queued register without a
+// budget, like the refresh queues before (OPL3_SKIP_UNCHANGED=0). Both runs
+// check that all operator registers are in place whenever a key on is
+// written, and that the chips end with the driver state.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "mios32.h"
+#include "opl3.h"
+
+#define NUM_FRAMES    6000
+#define PATCH_FRAME   3000
+#define DRAIN_FRAMES  20
+
+// not exported by opl3.h
+extern s32 OPL3_RefreshOperator(u8 op, u8 reg);
+extern s32 OPL3_RefreshChannel(u8 chan, u8 reg);
+extern s32 OPL3_RefreshChip(u8 chip, u8 reg);
+
+GPIO_TypeDef test_gpiob;
+static GPIO_TypeDef test_gpioe;
+
+static u8 regs[OPL3_COUNT][2][256]; // register image of the chips
+static u8 latch[OPL3_COUNT][2];     // last address written
+static u8 strobe_active;
+static u32 frame_us;                // bus time of the current frame
+
+typedef struct {
+  u32 writes;
+  u32 max_writes;
+  u64 bus_us;
+  u32 max_bus_us;
+  u32 budget_frames;
+  u32 keyons;
+  u32 keyon_errors;
+} stats_t;
+
+static stats_t stats;
+static u32 frame_writes;
+static int errors;
+
+// operator and channel mapping, see the table in opl3.h
+static const u8 oper_reg[5] = { 0x20, 0x40, 0x60, 0x80, 0xe0 };
+static const u8 chan_reg[3] = { 0xa0, 0xb0, 0xc0 };
+static const u8 reg_offset[18] = {
+  0x00, 0x03, 0x01, 0x04, 0x02, 0x05, 0x08, 0x0b, 0x09,
+  0x0c, 0x0a, 0x0d, 0x10, 0x13, 0x11, 0x14, 0x12, 0x15
+};
+static const u8 channel_map[18] = {
+  0, 3, 1, 4, 2, 5, 9, 12, 10, 13, 11, 14, 15, 16, 17, 6, 7, 8
+};
+static const u8 chip_reg[4]    = { 0x05, 0x08, 0xbd, 0x04 };
+static const u8 chip_reg_hi[4] = { 1, 0, 0, 1 };
+
+
+// ------- register image of the driver state -------
+static u8 *oper_image(u8 op, u8 reg)
+{
+  u8 chip = op / 36;
+  u8 chan = channel_map[(op % 36) >> 1];
+  u8 index = ((chan % 9) << 1) + (op & 1);
+  return &regs[chip][chan >= 9][oper_reg[reg] + reg_offset[index]];
+}
+
+static u8 *chan_image(u8 ch, u8 reg)
+{
+  u8 chan = channel_map[ch % 18];
+  return &regs[ch / 18][chan >= 9][chan_reg[reg] + (chan % 9)];
+}
+
+// number of operator registers which differ from the driver state
+static u32 opers_not_sent(void)
+{
+  u32 n = 0;
+  u16 op;
+  u8 reg;
+  for(op=0; op<36*OPL3_COUNT; op++)
+    for(reg=0; reg<5; reg++)
+      n += *oper_image(op, reg) != opl3_operators[op].ALL[reg];
+  return n;
+}
+
+static u32 regs_not_sent(void)
+{
+  u32 n = opers_not_sent();
+  u8 ch, reg, chip;
+  for(ch=0; ch<18*OPL3_COUNT; ch++)
+    for(reg=0; reg<3; reg++)
+      n += *chan_image(ch, reg) != opl3_channels[ch].ALL[reg];
+  for(chip=0; chip<OPL3_COUNT; chip++)
+    for(reg=0; reg<4; reg++)
+      n += regs[chip][chip_reg_hi[reg]][chip_reg[reg]] != opl3_chip[chip].ALL[reg];
+  return n;
+}
+
+
+// ------- bus test double -------
+static void bus_strobe(u32 e)
+{
+  u8 chip = (e & (1 << 4)) ? 1 : 0; // the /CS which is low
+  u8 hi = (e >> 7) & 1;
+  u8 value = (e >> 8) & 0xff;
+
+  if( !(e & (1 << 6)) ) {
+    latch[chip][hi] = value; // A0 = 0: address
+    return;
+  }
+
+  // data: a key on has to find the operators in place
+  if( latch[chip][hi] >= 0xb0 && latch[chip][hi] <= 0xb8 &&
+      (value & 0x20) && !(regs[chip][hi][latch[chip][hi]] & 0x20) ) {
+    ++stats.keyons;
+    if( opers_not_sent() )
+      ++stats.keyon_errors;
+  }
+
+  regs[chip][hi][latch[chip][hi]] = value;
+  ++frame_writes;
+}
+
+GPIO_TypeDef *Bus_Port(void)
+{
+  u32 e = test_gpioe.ODR;
+  u8 strobe = (e & 0x30) != 0x30; // a /CS is low
+
+  if( strobe && !strobe_active )
+    bus_strobe(e);
+  strobe_active = strobe;
+
+  return &test_gpioe;
+}
+
+void Bus_Delay_uS(u32 us)
+{
+  frame_us += us;
+}
+
+
+// ------- workload -------
+static void set_patch(u8 variant)
+{
+  u16 op;
+  u8 ch;
+  for(op=0; op<36*OPL3_COUNT; op++) {
+    u8 carrier = op & 1;
+    OPL3_SetFMult(op, carrier ? 1 : 1 + variant + (op % 3));
+    OPL3_SetWaveform(op, carrier ? 0 : variant + 1);
+    OPL3_SetVibrato(op, 0);
+    OPL3_DoSustain(op, 1);
+    OPL3_SetVolume(op, carrier ? 52 : 40);
+    OPL3_SetKSL(op, variant);
+    OPL3_SetAttack(op, carrier ? 1 : 2 + variant);
+    OPL3_SetDecay(op, 6);
+    OPL3_SetSustain(op, 10 - 2*variant);
+    OPL3_SetRelease(op, 5 + variant);
+  }
+  for(ch=0; ch<18*OPL3_COUNT; ch++) {
+    OPL3_SetFeedback(ch, 3 + variant);
+    OPL3_SetAlgorithm(ch, 0);
+    OPL3_OutLeft(ch, 1);
+    OPL3_OutRight(ch, 1);
+  }
+}
+
+static void control_refresh(u32 frame)
+{
+  double t = frame / 1000.0;
+  u8 ch;
+
+  if( frame == PATCH_FRAME )
+    set_patch(1);
+
+  for(ch=0; ch<18*OPL3_COUNT; ch++) {
+    u32 period = 150 + 7*ch;
+    u32 phase = (frame + 13*ch) % period;
+    u16 fnum = 0x157 + 8*(ch % 12) + (s16)(2.5 * sin(2*M_PI*6.0*t + ch));
+    u8 mod = 2*ch, car = 2*ch + 1;
+
+    // note off, retrigger with a new envelope two refreshes later
+    if( phase == 0 ) {
+      OPL3_Gate(ch, 0);
+    } else if( phase == 2 ) {
+      OPL3_SetAttack(car, 1 + (frame / period) % 3);
+      OPL3_SetRelease(car, 4 + (frame / period) % 4);
+      OPL3_Gate(ch, 1);
+    }
+
+    // vibrato: the frequency is sent on every refresh
+    OPL3_SetFrequency(ch, fnum, 4);
+
+    // tremolo and modulator sweep
+    OPL3_SetVolume(car, (u8)(52.5 + 4.0 * sin(2*M_PI*4.0*t + ch)));
+    OPL3_SetVolume(mod, (u8)(40.5 + 12.0 * sin(2*M_PI*0.3*t + ch)));
+  }
+}
+
+static void frame_done(void)
+{
+  stats.writes += frame_writes;
+  if( frame_writes > stats.max_writes )
+    stats.max_writes = frame_writes;
+  if( frame_writes >= OPL3_MAX_WRITES_PER_FRAME )
+    ++stats.budget_frames;
+  stats.bus_us += frame_us;
+  if( frame_us > stats.max_bus_us )
+    stats.max_bus_us = frame_us;
+  frame_writes = 0;
+  frame_us = 0;
+}
+
+
+int main(int argc, char *argv[])
+{
+  u32 frame;
+  u16 i;
+  u8 j;
+
+  test_gpioe.ODR = 0x30; // /CS of both chips high
+  OPL3_Init();
+  OPL3_RefreshAll();
+  set_patch(0);
+  for(j=0; j<OPL3_COUNT; j++) {
+    OPL3_SetOpl3Mode(j, 1);
+    OPL3_SetNoteSel(j, 1);
+    OPL3_SetVibratoDepth(j, 1);
+    OPL3_SetTremeloDepth(j, 1);
+  }
+  // the demo patch bypassed the driver state: send everything once
+  for(i=0; i<36*OPL3_COUNT; i++)
+    for(j=0; j<5; j++)
+      OPL3_RefreshOperator(i, j);
+  for(i=0; i<18*OPL3_COUNT; i++)
+    for(j=0; j<3; j++)
+      OPL3_RefreshChannel(i, j);
+  for(i=0; i<OPL3_COUNT; i++)
+    for(j=0; j<4; j++)
+      OPL3_RefreshChip(i, j);
+  OPL3_OnFrame();
+  frame_writes = 0;
+  frame_us = 0;
+
+  if( regs_not_sent() ) {
+    printf("ERROR: chips not initialized with the driver state\n");
+    ++errors;
+  }
+
+  for(frame=0; frame<NUM_FRAMES; frame++) {
+    control_refresh(frame);
+    OPL3_OnFrame();
+    frame_done();
+  }
+
+  for(frame=0; frame<DRAIN_FRAMES; frame++) {
+    OPL3_OnFrame();
+    frame_done();
+  }
+
+  printf("%s: %d chips, %d refreshes of 1 mS\n",
+	 OPL3_SKIP_UNCHANGED ? "skip unchanged" : "write queued", OPL3_COUNT, NUM_FRAMES);
+  printf("  writes per refresh: %.1f average, %u max, %u refreshes at the budget of %d\n",
+	 (double)stats.writes / NUM_FRAMES, stats.max_writes, stats.budget_frames, OPL3_MAX_WRITES_PER_FRAME);
+  printf("  bus time with IRQs disabled: %.1f uS average, %u uS max per refresh\n",
+	 (double)stats.bus_us / NUM_FRAMES, stats.max_bus_us);
+  printf("  key ons: %u, %u with operators not sent yet\n", stats.keyons, stats.keyon_errors);
+
+  if( stats.keyon_errors ) {
+    printf("ERROR: key on written before the operators\n");
+    ++errors;
+  }
+
+  if( regs_not_sent() ) {
+    printf("ERROR: %u registers differ from the driver state\n", regs_not_sent());
+    ++errors;
+  }
+
+  if( errors ) {
+    printf("%d errors\n", errors);
+    return 1;
+  }
+
+  printf("OPL3 bus simulation passed.\n");
+  return 0;
+}
@@ -44,13 +44,16 @@ opl3_chip_t opl3_chip[OPL3_COUNT];
 // Local variables
 /////////////////////////////////////////////////////////////////////////////
 
-// Queues for what registers need to be updated
-static u16 opl3_op_queue[36*5*OPL3_COUNT];
-static u8 opl3_chan_queue[18*3*OPL3_COUNT];
-static u8 opl3_chip_queue[4*OPL3_COUNT];
-static u16 op_queue_idx;
-static u8 chan_queue_idx;
-static u8 chip_queue_idx;
+// Dirty bitmaps for what registers need to be updated: one bit per register
+// index of opl3_operators[].ALL, opl3_channels[].ALL and opl3_chip[].ALL
+static u8 opl3_op_dirty[36*OPL3_COUNT];
+static u8 opl3_chan_dirty[18*OPL3_COUNT];
+static u8 opl3_chip_dirty[OPL3_COUNT];
+static u8 opl3_any_dirty;
+
+// Copy of the values last written to each register of each chip, indexed by
+// [chip][addrhigh][addr]
+static u8 opl3_regs_sent[OPL3_COUNT][2][256];
 
 
 /////////////////////////////////////////////////////////////////////////////
@@ -110,6 +113,8 @@ static const u8 OPL3ChannelMap[18] = {
 */
 
 s32 OPL3_SendAddrData(u8 chip, u8 addrhigh, u8 addr, u8 data){
+  //Remember what the chip has now
+  opl3_regs_sent[chip][(addrhigh > 0) & 1][addr] = data;
   //Turn off interrupts
   MIOS32_IRQ_Disable();
   //-------------------------------------------------------------
@@ -161,9 +166,17 @@ s32 OPL3_SendAddrData(u8 chip, u8 addrhigh, u8 addr, u8 data){
   return 0;
 }
 
-s32 OPL3_RefreshOperator(u8 op, u8 reg){
-  if(op >= 36*OPL3_COUNT) return -1;
-  if(reg >= 5) return -1;
+//Sends data to a register, unless the chip already has that value and force
+//is not set. Returns 1 if it was sent.
+static u8 OPL3_SendIfChanged(u8 chip, u8 addrhigh, u8 addr, u8 data, u8 force){
+#if OPL3_SKIP_UNCHANGED
+  if(!force && opl3_regs_sent[chip][addrhigh][addr] == data) return 0;
+#endif
+  OPL3_SendAddrData(chip, addrhigh, addr, data);
+  return 1;
+}
+
+static u8 OPL3_FlushOperator(u8 op, u8 reg, u8 force){
   u8 chip = op / 36;
   u8 chipop = op % 36; //Op within the chip
   u8 chan = OPL3ChannelMap[chipop >> 1]; //Channel mapped to OPL3 way
@@ -171,29 +184,43 @@ s32 OPL3_RefreshOperator(u8 op, u8 reg){
   u8 index = ((chan % 9) << 1) + (chipop & 1); //Which operator, with channels mapped OPL3 way but ops not yet mapped
   u8 addr = OPL3OperRegBegin[reg] + OPL3RegOffset[index];
   u8 data = opl3_operators[op].ALL[reg];
-  OPL3_SendAddrData(chip, addrhigh, addr, data);
-  return 0;
+  return OPL3_SendIfChanged(chip, addrhigh, addr, data, force);
 }
 
-s32 OPL3_RefreshChannel(u8 chan, u8 reg){
-  if(chan >= 18*OPL3_COUNT) return -1;
-  if(reg >= 3) return -1;
+static u8 OPL3_FlushChannel(u8 chan, u8 reg, u8 force){
   u8 chip = chan / 18;
   u8 chipchan = chan % 18;
   u8 mappedchan = OPL3ChannelMap[chipchan];
   u8 addrhigh = mappedchan >= 9;
   u8 addr = OPL3ChanRegBegin[reg] + (mappedchan % 9);
   u8 data = opl3_channels[chan].ALL[reg];
-  OPL3_SendAddrData(chip, addrhigh, addr, data);
-  return 0;
+  return OPL3_SendIfChanged(chip, addrhigh, addr, data, force);
 }
 
-s32 OPL3_RefreshChip(u8 chip, u8 reg){
-  if(reg >= 4*OPL3_COUNT) return -1;
+static u8 OPL3_FlushChip(u8 chip, u8 reg, u8 force){
   u8 addrhigh = OPL3ChipRegHigh[reg];
   u8 addr = OPL3ChipReg[reg];
   u8 data = opl3_chip[chip].ALL[reg];
-  OPL3_SendAddrData(chip, addrhigh, addr, data);
+  return OPL3_SendIfChanged(chip, addrhigh, addr, data, force);
+}
+
+s32 OPL3_RefreshOperator(u8 op, u8 reg){
+  if(op >= 36*OPL3_COUNT) return -1;
+  if(reg >= 5) return -1;
+  OPL3_FlushOperator(op, reg, 1);
+  return 0;
+}
+
+s32 OPL3_RefreshChannel(u8 chan, u8 reg){
+  if(chan >= 18*OPL3_COUNT) return -1;
+  if(reg >= 3) return -1;
+  OPL3_FlushChannel(chan, reg, 1);
+  return 0;
+}
+
+s32 OPL3_RefreshChip(u8 chip, u8 reg){
+  if(reg >= 4*OPL3_COUNT) return -1;
+  OPL3_FlushChip(chip, reg, 1);
   return 0;
 }
 
@@ -298,127 +325,85 @@ void OPL3_SendDemoPatch(){
   
 }
 
-u8 toggle;
 s32 OPL3_OnFrame(){
-  u8 op, chan, chip, reg;
-  u16 val, q=0;
-  while(q < op_queue_idx){
-    if(q >= 36*5*OPL3_COUNT){
-      DEBUG_MSG("PANIC!! [opl3.c] Op queue overflow q==%d!", q);
+  u16 i;
+  u8 reg, bits;
+  s32 budget = OPL3_MAX_WRITES_PER_FRAME;
+  if(!opl3_any_dirty) return 0;
+  //Same order as a full refresh: operator parameters first, so they are in
+  //place before the key on in the channel registers, then the chip registers.
+  //Whatever doesn't fit in the budget stays dirty until the next frame.
+  for(i=0; i<36*OPL3_COUNT; i++){
+    bits = opl3_op_dirty[i];
+    for(reg=0; bits; reg++, bits >>= 1){
+      if(!(bits & 1)) continue;
+      if(budget <= 0) return 0;
+      budget -= OPL3_FlushOperator(i, reg, 0);
+      opl3_op_dirty[i] &= ~(1 << reg);
     }
-    val = opl3_op_queue[q];
-    op = val / 5;
-    reg = val % 5;
-    OPL3_RefreshOperator(op, reg);
-    q++;
-  }
-  op_queue_idx = 0;
-  q = 0;
-  if(chan_queue_idx > 20){
-    DEBUG_MSG("chan_queue_idx=%d", chan_queue_idx);
-  }
-  while(q < chan_queue_idx){
-    if(q >= 18*3*OPL3_COUNT){
-      DEBUG_MSG("PANIC!! [opl3.c] Chan queue overflow q==%d!", q);
+  }
+  for(i=0; i<18*OPL3_COUNT; i++){
+    bits = opl3_chan_dirty[i];
+    for(reg=0; bits; reg++, bits >>= 1){
+      if(!(bits & 1)) continue;
+      if(budget <= 0) return 0;
+      budget -= OPL3_FlushChannel(i, reg, 0);
+      opl3_chan_dirty[i] &= ~(1 << reg);
     }
-    val = opl3_chan_queue[q];
-    chan = val / 3;
-    reg = val % 3;
-    OPL3_RefreshChannel(chan, reg);
-    q++;
-  }
-  chan_queue_idx = 0;
-  q = 0;
-  while(q < chip_queue_idx){
-    if(q >= 4*OPL3_COUNT){
-      DEBUG_MSG("PANIC!! [opl3.c] Chip queue overflow q==%d!", q);
+  }
+  for(i=0; i<OPL3_COUNT; i++){
+    bits = opl3_chip_dirty[i];
+    for(reg=0; bits; reg++, bits >>= 1){
+      if(!(bits & 1)) continue;
+      if(budget <= 0) return 0;
+      budget -= OPL3_FlushChip(i, reg, 0);
+      opl3_chip_dirty[i] &= ~(1 << reg);
     }
-    val = opl3_chip_queue[q];
-    chip = val / 4;
-    reg = val % 4;
-    OPL3_RefreshChip(chip, reg);
-    q++;
   }
-  chip_queue_idx = 0;
+  opl3_any_dirty = 0;
   return 0;
 }
 
 
 s32 OPL3_AddOperQueue(u8 op, u8 reg){
   if(op >= 36*OPL3_COUNT){
-    DEBUG_MSG("PANIC!! [opl3.c] Invalid op %d passed to OPL3_AddOperQueue! op_queue_idx=%d", op, op_queue_idx);
+    DEBUG_MSG("PANIC!! [opl3.c] Invalid op %d passed to OPL3_AddOperQueue!", op);
     return -9001;
   }
   if(reg >= 5){
-    DEBUG_MSG("PANIC!! [opl3.c] Invalid reg %d passed to OPL3_AddOperQueue! op_queue_idx=%d", reg, op_queue_idx);
+    DEBUG_MSG("PANIC!! [opl3.c] Invalid reg %d passed to OPL3_AddOperQueue!", reg);
     return -9001;
   }
-  u16 val = (0x0005*((u16)op))+reg;
-  //See if it's on the queue
-  u16 q;
-  for(q=0; q<op_queue_idx; q++){
-    if(opl3_op_queue[q] == val){
-      return 0;
-    }
-  }
-  opl3_op_queue[op_queue_idx] = val;
-  op_queue_idx++;
-  if(op_queue_idx >= 36*5*OPL3_COUNT){
-    DEBUG_MSG("PANIC!! [opl3.c] Op queue overflow on write op_queue_idx==%d!", op_queue_idx);
-    op_queue_idx = (36*5*OPL3_COUNT)-1;
-  }
+  opl3_op_dirty[op] |= (1 << reg);
+  opl3_any_dirty = 1;
   return 0;
 }
 
 s32 OPL3_AddChanQueue(u8 chan, u8 reg){
   if(chan >= 18*OPL3_COUNT){
-    DEBUG_MSG("PANIC!! [opl3.c] Invalid chan %d passed to OPL3_AddChanQueue! chan_queue_idx=%d", chan, chan_queue_idx);
+    DEBUG_MSG("PANIC!! [opl3.c] Invalid chan %d passed to OPL3_AddChanQueue!", chan);
     return -9001;
   }
   if(reg >= 3){
-    DEBUG_MSG("PANIC!! [opl3.c] Invalid reg %d passed to OPL3_AddChanQueue! chan_queue_idx=%d", reg, chan_queue_idx);
+    DEBUG_MSG("PANIC!! [opl3.c] Invalid reg %d passed to OPL3_AddChanQueue!", reg);
     return -9001;
   }
-  u8 val = (3*chan)+reg;
-  //See if it's on the queue
-  u8 q;
-  for(q=0; q<chan_queue_idx; q++){
-    if(opl3_chan_queue[q] == val){
-      return 0;
-    }
-  }
-  opl3_chan_queue[chan_queue_idx] = val;
-  chan_queue_idx++;
-  if(chan_queue_idx >= 18*3*OPL3_COUNT){
-    DEBUG_MSG("PANIC!! [opl3.c] Chan queue overflow on write chan_queue_idx==%d!", chan_queue_idx);
-    chan_queue_idx = (18*3*OPL3_COUNT)-1;
-  }
+  opl3_chan_dirty[chan] |= (1 << reg);
+  opl3_any_dirty = 1;
   return 0;
 }
 
 s32 OPL3_AddChipQueue(u8 chip, u8 reg){
   if(chip >= OPL3_COUNT){
-    DEBUG_MSG("PANIC!! [opl3.c] Invalid chip %d passed to OPL3_AddChipQueue! chip_queue_idx=%d", chip, chip_queue_idx);
+    DEBUG_MSG("PANIC!! [opl3.c] Invalid chip %d passed to OPL3_AddChipQueue!", chip);
     return -9001;
   }
   if(reg >= 4){
-    DEBUG_MSG("PANIC!! [opl3.c] Invalid reg %d passed to OPL3_AddChipQueue! chip_queue_idx=%d", reg, chip_queue_idx);
+    DEBUG_MSG("PANIC!! [opl3.c] Invalid reg %d passed to OPL3_AddChipQueue!", reg);
     return -9001;
   }
-  u8 val = (4*chip)+reg;
-  //See if it's on the queue
-  u8 q;
-  for(q=0; q<chip_queue_idx; q++){
-    if(opl3_chip_queue[q] == val){
-      return 0;
-    }
-  }
-  opl3_chip_queue[chip_queue_idx] = val;
-  chip_queue_idx++;
-  if(chip_queue_idx >= 4*OPL3_COUNT){
-    DEBUG_MSG("PANIC!! [opl3.c] Chip queue overflow on write chip_queue_idx==%d!", chip_queue_idx);
-    chip_queue_idx = 4*OPL3_COUNT;
-  }
+  opl3_chip_dirty[chip] |= (1 << reg);
+  opl3_any_dirty = 1;
   return 0;
 }
 
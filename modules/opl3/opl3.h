@@ -97,6 +97,18 @@ Chan | 2-Op Mode |   4-Op Mode    |Chan | 2-Op Mode |   4-Op Mode    |
 #define OPL3_CS_MASKS {1<<5} //{1<<4,1<<5}
 #endif
 
+//Maximum number of register writes OPL3_OnFrame() sends in one call; each
+//takes about 5 us. Registers which don't fit are sent on the next frame.
+#ifndef OPL3_MAX_WRITES_PER_FRAME
+#define OPL3_MAX_WRITES_PER_FRAME 128
+#endif
+
+//If 1, OPL3_OnFrame() skips registers which already have the value to be
+//written. 0 writes every queued register, like the old refresh queues.
+#ifndef OPL3_SKIP_UNCHANGED
+#define OPL3_SKIP_UNCHANGED 1
+#endif
+
 /////////////////////////////////////////////////////////////////////////////
 // Global Types
 /////////////////////////////////////////////////////////////////////////////
@@ -220,8 +232,12 @@ extern s32 OPL3_RefreshAll(void);
 // right.
 extern void OPL3_SendDemoPatch(void);
 
+// Writes a value to a register directly. The driver keeps a copy of every value
+// written, which OPL3_OnFrame() uses to skip registers that haven't changed.
+extern s32 OPL3_SendAddrData(u8 chip, u8 addrhigh, u8 addr, u8 data);
+
 // Call this after every control refresh. Refreshes any OPL3 registers that have
-// changed since last time.
+// changed since last time, up to OPL3_MAX_WRITES_PER_FRAME of them.
 extern s32 OPL3_OnFrame(void);
 
 // Convenience functions for interacting with OPL3
@@ -88,6 +88,9 @@ static s32 SEQ_BPM_TimerInit(void);
 static void SEQ_BPM_Timer_Slave(void);
 static void SEQ_BPM_Timer_Master(void);
 static s32 SEQ_BPM_DigitUpdate(void);
+#ifdef SEQ_BPM_TICK_TIMESTAMP
+static void SEQ_BPM_TickTimestampCapture(void);
+#endif
 
 
 /////////////////////////////////////////////////////////////////////////////
@@ -124,6 +127,12 @@ static u32 sent_clk_delay;
 static u16 new_song_pos;
 static u8  receive_song_pos_state;
 
+#ifdef SEQ_BPM_TICK_TIMESTAMP
+static u32 bpm_tick_timestamp;
+static u32 bpm_tick_period;
+static u8  bpm_tick_timestamp_valid;
+#endif
+
 
 /////////////////////////////////////////////////////////////////////////////
 //! Initialisation of BPM generator
@@ -289,6 +298,41 @@ s32 SEQ_BPM_TickSet(u32 tick)
   return 0; // no error
 }
 
+#ifdef SEQ_BPM_TICK_TIMESTAMP
+/////////////////////////////////////////////////////////////////////////////
+//! Returns the SEQ_BPM_TICK_TIMESTAMP() value at which the given BPM tick
+//! has been reached.<BR>
+//! Note that the sequencer gets the clock request for a tick with the next
+//! tick, so that generated events are sent one tick later.<BR>
+//! Only the timestamp of the last tick is stored, earlier (and later) ticks
+//! are extrapolated with the measured period between the last two ticks.
+//! \param[in] tick BPM tick value
+//! \return timestamp
+/////////////////////////////////////////////////////////////////////////////
+u32 SEQ_BPM_TickTimestampGet(u32 tick)
+{
+  MIOS32_IRQ_Disable();
+  u32 timestamp = bpm_tick_timestamp - (bpm_tick - tick) * bpm_tick_period;
+  MIOS32_IRQ_Enable();
+
+  return timestamp;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// Called from the timer interrupt whenever bpm_tick has been incremented
+/////////////////////////////////////////////////////////////////////////////
+static void SEQ_BPM_TickTimestampCapture(void)
+{
+  u32 timestamp = SEQ_BPM_TICK_TIMESTAMP();
+
+  // the first tick after start/continue keeps the previous period
+  if( bpm_tick_timestamp_valid )
+    bpm_tick_period = timestamp - bpm_tick_timestamp;
+  bpm_tick_timestamp = timestamp;
+  bpm_tick_timestamp_valid = 1;
+}
+#endif
+
 
 /////////////////////////////////////////////////////////////////////////////
 //! BPM generator running?
@@ -373,6 +417,9 @@ static void SEQ_BPM_Timer_Master(void)
   if( run_mode == SEQ_BPM_RUN_MODE_Clocked ) {
     ++bpm_tick;
     ++bpm_req_clk_ctr;
+#ifdef SEQ_BPM_TICK_TIMESTAMP
+    SEQ_BPM_TickTimestampCapture();
+#endif
   }
 }
 
@@ -395,6 +442,9 @@ static void SEQ_BPM_Timer_Slave(void)
       if( run_mode == SEQ_BPM_RUN_MODE_Clocked ) {
 	++bpm_tick;
 	++bpm_req_clk_ctr;
+#ifdef SEQ_BPM_TICK_TIMESTAMP
+	SEQ_BPM_TickTimestampCapture();
+#endif
       }
     }
   }
@@ -472,6 +522,9 @@ s32 SEQ_BPM_NotifyMIDIRx(u8 midi_byte)
 	sent_clk_ctr = 1;
 	++bpm_tick;
 	++bpm_req_clk_ctr;
+#ifdef SEQ_BPM_TICK_TIMESTAMP
+	SEQ_BPM_TickTimestampCapture();
+#endif
       } else {
 	// sequencer not running: don't request new clock(s)
 	sent_clk_ctr = 0;
@@ -619,6 +672,9 @@ s32 SEQ_BPM_Stop(void)
   MIOS32_IRQ_Disable();
   bpm_req_stop = 1;
   run_mode = SEQ_BPM_RUN_MODE_Off;
+#ifdef SEQ_BPM_TICK_TIMESTAMP
+  bpm_tick_timestamp_valid = 0;
+#endif
   MIOS32_IRQ_Enable();
 
   return 0; // no error
@@ -27,6 +27,10 @@ extern "C" {
 #define SEQ_BPM_MIOS32_TIMER_NUM 0
 #endif
 
+// optional timestamp which is captured with each BPM tick (e.g. the DWT cycle counter)
+// it allows to determine the output latency of scheduled events with SEQ_BPM_TickTimestampGet()
+// Example: #define SEQ_BPM_TICK_TIMESTAMP() MIOS32_CYCLES_Get()
+
 
 /////////////////////////////////////////////////////////////////////////////
 // Global Types
@@ -64,6 +68,9 @@ extern s32 SEQ_BPM_PPQN_Set(u16 ppqn);
 
 extern u32 SEQ_BPM_TickGet(void);
 extern s32 SEQ_BPM_TickSet(u32 tick);
+#ifdef SEQ_BPM_TICK_TIMESTAMP
+extern u32 SEQ_BPM_TickTimestampGet(u32 tick);
+#endif
 
 extern s32 SEQ_BPM_IsRunning(void);
 extern seq_bpm_run_mode_t SEQ_BPM_RunModeGet(void);
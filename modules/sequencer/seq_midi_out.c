@@ -58,6 +58,9 @@ typedef struct seq_midi_out_queue_item_t {
 
 static seq_midi_out_queue_item_t *SEQ_MIDI_OUT_SlotMalloc(void);
 static void SEQ_MIDI_OUT_SlotFree(seq_midi_out_queue_item_t *item);
+#if SEQ_MIDI_OUT_BATCH_SIZE > 1
+static s32 SEQ_MIDI_OUT_BatchFlush(s32 (*sent)(mios32_midi_port_t port, mios32_midi_package_t midi_package, u32 timestamp, u32 bpm_tick), u32 bpm_tick);
+#endif
 
 
 /////////////////////////////////////////////////////////////////////////////
@@ -82,9 +85,18 @@ static s32 (*callback_midi_send_package)(mios32_midi_port_t port, mios32_midi_pa
 static s32 (*callback_bpm_is_running)(void);
 static u32 (*callback_bpm_tick_get)(void);
 static s32 (*callback_bpm_set)(float bpm);
+static s32 (*callback_sent)(mios32_midi_port_t port, mios32_midi_package_t midi_package, u32 timestamp, u32 bpm_tick);
 
 static seq_midi_out_queue_item_t *midi_queue;
 
+#if SEQ_MIDI_OUT_BATCH_SIZE > 1
+// packages which are sent together by SEQ_MIDI_OUT_Handler()
+static mios32_midi_port_t batch_port;
+static u8 batch_len;
+static mios32_midi_package_t batch_package[SEQ_MIDI_OUT_BATCH_SIZE];
+static u32 batch_timestamp[SEQ_MIDI_OUT_BATCH_SIZE];
+#endif
+
 
 #if SEQ_MIDI_OUT_MALLOC_METHOD >= 0 && SEQ_MIDI_OUT_MALLOC_METHOD <= 3
 
@@ -130,6 +142,7 @@ s32 SEQ_MIDI_OUT_Init(u32 mode)
   SEQ_MIDI_OUT_Callback_BPM_IsRunning_Set(NULL);
   SEQ_MIDI_OUT_Callback_BPM_TickGet_Set(NULL);
   SEQ_MIDI_OUT_Callback_BPM_Set_Set(NULL);
+  SEQ_MIDI_OUT_Callback_Sent_Set(NULL);
 
   // don't re-initialize queue to ensure that memory can be delocated properly
   // when this function is called multiple times
@@ -276,6 +289,35 @@ s32 SEQ_MIDI_OUT_Callback_BPM_Set_Set(void *_callback_bpm_set)
   return 0; // no error
 }
 
+/////////////////////////////////////////////////////////////////////////////
+//! Allows to install a function which is called after a scheduled event
+//! has been sent.
+//!
+//! This becomes useful to measure the latency between the scheduled
+//! timestamp and the actual output (e.g. with SEQ_BPM_TickTimestampGet()).
+//! The function won't be called while the output is rendered with a private
+//! BPM tick callback (e.g. into a MIDI file).
+//!
+//! \param[in] *_callback_sent pointer to callback function:<BR>
+//! \code
+//!   s32 callback_sent(mios32_midi_port_t port, mios32_midi_package_t midi_package, u32 timestamp, u32 bpm_tick)
+//!   {
+//!     // timestamp: the bpm_tick at which the event was scheduled
+//!     // bpm_tick: the bpm_tick at which the event has been sent
+//!
+//!     return 0; // no error
+//!   }
+//! \endcode
+//! If set to NULL, no function will be called (default).
+//! \return < 0 on errors
+/////////////////////////////////////////////////////////////////////////////
+s32 SEQ_MIDI_OUT_Callback_Sent_Set(void *_callback_sent)
+{
+  callback_sent = _callback_sent;
+
+  return 0; // no error
+}
+
 /////////////////////////////////////////////////////////////////////////////
 //! This function schedules a MIDI event, which will be sent over a given
 //! port at a given bpm_tick
@@ -613,8 +655,20 @@ s32 SEQ_MIDI_OUT_Handler(void)
   // note that we are going through a sorted list, therefore we can exit once a timestamp
   // has been found which has to be played later than now
 
+  // latency measurements only for realtime output
+  s32 (*sent)(mios32_midi_port_t port, mios32_midi_package_t midi_package, u32 timestamp, u32 bpm_tick) =
+    (callback_bpm_tick_get == SEQ_BPM_TickGet) ? callback_sent : NULL;
+
+#if SEQ_MIDI_OUT_BATCH_SIZE > 1
+  // with the default callback, consecutive packages of the same port are
+  // collected and sent as a block
+  u8 batch_enabled = callback_midi_send_package == MIOS32_MIDI_SendPackage;
+  batch_len = 0;
+#endif
+
   seq_midi_out_queue_item_t *item;
-  while( (item=midi_queue) != NULL && item->timestamp <= callback_bpm_tick_get() ) {
+  u32 bpm_tick = 0;
+  while( (item=midi_queue) != NULL && item->timestamp <= (bpm_tick=callback_bpm_tick_get()) ) {
 #if DEBUG_VERBOSE_LEVEL >= 2
 #if DEBUG_VERBOSE_LEVEL == 2
     if( item->event_type != SEQ_MIDI_OUT_ClkEvent )
@@ -624,9 +678,27 @@ s32 SEQ_MIDI_OUT_Handler(void)
 
     // if tempo event: change BPM stored in midi_package.ALL
     if( item->event_type == SEQ_MIDI_OUT_TempoEvent ) {
+#if SEQ_MIDI_OUT_BATCH_SIZE > 1
+      SEQ_MIDI_OUT_BatchFlush(sent, bpm_tick);
+#endif
       callback_bpm_set(item->package.ALL);
     } else {
-      callback_midi_send_package(item->port, item->package);
+#if SEQ_MIDI_OUT_BATCH_SIZE > 1
+      if( batch_enabled ) {
+	if( batch_len && (batch_port != item->port || batch_len >= SEQ_MIDI_OUT_BATCH_SIZE) )
+	  SEQ_MIDI_OUT_BatchFlush(sent, bpm_tick);
+
+	batch_port = item->port;
+	batch_timestamp[batch_len] = item->timestamp;
+	batch_package[batch_len++] = item->package;
+      } else
+#endif
+      {
+	callback_midi_send_package(item->port, item->package);
+
+	if( sent != NULL )
+	  sent(item->port, item->package, item->timestamp, bpm_tick);
+      }
     }
 
     // schedule Off event if requested
@@ -671,10 +743,40 @@ s32 SEQ_MIDI_OUT_Handler(void)
     }
   }
 
+#if SEQ_MIDI_OUT_BATCH_SIZE > 1
+  SEQ_MIDI_OUT_BatchFlush(sent, bpm_tick);
+#endif
+
   return 0; // no error
 }
 
 
+#if SEQ_MIDI_OUT_BATCH_SIZE > 1
+/////////////////////////////////////////////////////////////////////////////
+// Local function which sends the collected packages of SEQ_MIDI_OUT_Handler()
+// The sent callback is called afterwards, so that latency measurements
+// include the output
+/////////////////////////////////////////////////////////////////////////////
+static s32 SEQ_MIDI_OUT_BatchFlush(s32 (*sent)(mios32_midi_port_t port, mios32_midi_package_t midi_package, u32 timestamp, u32 bpm_tick), u32 bpm_tick)
+{
+  if( !batch_len )
+    return 0; // nothing to send
+
+  s32 status = MIOS32_MIDI_SendPackageMulti(batch_port, batch_package, batch_len);
+
+  if( sent != NULL ) {
+    int i;
+    for(i=0; i<batch_len; ++i)
+      sent(batch_port, batch_package[i], batch_timestamp[i], bpm_tick);
+  }
+
+  batch_len = 0;
+
+  return status;
+}
+#endif
+
+
 /////////////////////////////////////////////////////////////////////////////
 // Local function to allocate memory
 // returns NULL if no memory free
@@ -51,6 +51,12 @@ extern "C" {
 #define SEQ_MIDI_OUT_SUPPORT_DELAY 0
 #endif
 
+// max number of packages which are sent as a block with MIOS32_MIDI_SendPackageMulti()
+// (only used with the default MIDI_SendPackage callback, 0 disables blocks)
+#ifndef SEQ_MIDI_OUT_BATCH_SIZE
+#define SEQ_MIDI_OUT_BATCH_SIZE 16
+#endif
+
 
 /////////////////////////////////////////////////////////////////////////////
 // Global Types
@@ -76,6 +82,7 @@ extern s32 SEQ_MIDI_OUT_Callback_MIDI_SendPackage_Set(void *_callback_midi_send_
 extern s32 SEQ_MIDI_OUT_Callback_BPM_IsRunning_Set(void *_callback_bpm_is_running);
 extern s32 SEQ_MIDI_OUT_Callback_BPM_TickGet_Set(void *_callback_bpm_tick_get);
 extern s32 SEQ_MIDI_OUT_Callback_BPM_Set_Set(void *_callback_bpm_set);
+extern s32 SEQ_MIDI_OUT_Callback_Sent_Set(void *_callback_sent);
 
 extern s32 SEQ_MIDI_OUT_Send(mios32_midi_port_t port, mios32_midi_package_t midi_package, seq_midi_out_event_type_t event_type, u32 timestamp, u32 len);
 extern s32 SEQ_MIDI_OUT_ReSchedule(u8 tag, seq_midi_out_event_type_t event_type, u32 timestamp, u32 *reschedule_filter);
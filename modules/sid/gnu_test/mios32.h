@@ -0,0 +1,28 @@
+// minimal MIOS32 environment to compile sid.c with the MBNET transfer on the host
+#ifndef _MIOS32_H
+#define _MIOS32_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+typedef uint8_t  u8;
+typedef uint16_t u16;
+typedef uint32_t u32;
+typedef int32_t  s32;
+
+// SID configuration
+#define SID_NUM 2
+#define SID_USE_MBNET 1
+
+#define MIOS32_SYS_CPU_FREQUENCY 1000000000 // host time in nS
+
+#define MIOS32_IRQ_Disable() do {} while(0)
+#define MIOS32_IRQ_Enable()  do {} while(0)
+
+extern s32 MIOS32_MIDI_SendDebugMessage(const char *format, ...);
+#define DEBUG_MSG MIOS32_MIDI_SendDebugMessage
+
+#define MIOS32_CYCLES_Init(mode) 0
+extern u32 MIOS32_CYCLES_Get(void);
+
+#endif /* _MIOS32_H */
@@ -0,0 +1,249 @@
+// Host loopback test of the SID register transfer via MBNET
+//
+// Modulates the SID registers like a running MBSID engine, calls SID_Update()
+// once per frame and passes the messages of the installed Tx handler to
+// simulated slaves. After each frame the SID registers of the slaves are
+// compared with sid_regs[], and the number of messages is compared with the
+// previous transfer in fixed 8-byte-aligned blocks. SID_PrintStatistics()
+// reports the CPU time in host nS.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <time.h>
+#include "mios32.h"
+#include "sid.h"
+#include "mbnet.h"
+
+#define FRAMES 20000
+
+static s32 (*tx_handler)(mbnet_id_t *mbnet_id, mbnet_msg_t *msg, u8 *dlc);
+static int errors;
+
+// simulated slaves: one node serves two SIDs, RAM offset 0x00 and 0x20
+static u8 slave_ram[SID_NUM/2][0x40];
+static u8 slave_sid[SID_NUM/2][0x40];
+
+static u32 num_msgs;
+static u32 num_msgs_aligned;
+static u32 num_updates;
+
+
+// ------- MIOS32 and MBNET stubs -------
+s32 MIOS32_MIDI_SendDebugMessage(const char *format, ...)
+{
+  va_list args;
+  va_start(args, format);
+  vprintf(format, args);
+  va_end(args);
+  printf("\n");
+  return 0;
+}
+
+u32 MIOS32_CYCLES_Get(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (u32)(ts.tv_sec * 1000000000ull + ts.tv_nsec);
+}
+
+s32 MBNET_NodeIDGet(void)
+{
+  return 0x00;
+}
+
+s32 MBNET_InstallTxHandler(s32 (*tx_handler_callback)(mbnet_id_t *mbnet_id, mbnet_msg_t *msg, u8 *dlc))
+{
+  tx_handler = tx_handler_callback;
+  return 0;
+}
+
+s32 MBNET_TriggerTxHandler(void)
+{
+  return 0; // messages are fetched by transfer_messages()
+}
+
+
+// ------- local helpers -------
+static void slave_receive(mbnet_id_t *mbnet_id, mbnet_msg_t *msg, u8 dlc)
+{
+  u8 cmd = mbnet_id->control >> 8;
+  u8 addr = mbnet_id->control & 0xff;
+
+  if( mbnet_id->tos != MBNET_REQ_RAM_WRITE || (cmd != 0xfe && cmd != 0xfd) ||
+      mbnet_id->node >= (SID_NUM/2) || dlc != 8 || (addr & 0x1f) > (SID_REGS_NUM-8) ) {
+    printf("ERROR: unexpected message node %d tos %d control %04x dlc %d\n",
+	   mbnet_id->node, mbnet_id->tos, mbnet_id->control, dlc);
+    ++errors;
+    return;
+  }
+
+  memcpy(&slave_ram[mbnet_id->node][addr], msg->bytes, 8);
+
+  // 0xfd: transfer the RAM into the SID registers
+  if( cmd == 0xfd ) {
+    memcpy(slave_sid[mbnet_id->node], slave_ram[mbnet_id->node], 0x40);
+    ++num_updates;
+  }
+}
+
+// calls the Tx handler until it has nothing to send, returns the number of messages
+static u32 transfer_messages(u32 max)
+{
+  mbnet_id_t mbnet_id;
+  mbnet_msg_t msg;
+  u8 dlc;
+  u32 msgs = 0;
+
+  while( msgs < max && tx_handler && tx_handler(&mbnet_id, &msg, &dlc) > 0 ) {
+    slave_receive(&mbnet_id, &msg, dlc);
+    ++msgs;
+  }
+
+  num_msgs += msgs;
+  return msgs;
+}
+
+// number of messages of the previous transfer: one per changed 8 byte block
+static void count_aligned_blocks(const sid_regs_t *prev)
+{
+  int sid, block, reg;
+
+  for(sid=0; sid<SID_NUM; ++sid) {
+    for(block=0; block<SID_REGS_NUM; block+=8) {
+      for(reg=block; reg<block+8; ++reg) {
+	if( sid_regs[sid].ALL[reg] != prev[sid].ALL[reg] ) {
+	  ++num_msgs_aligned;
+	  break;
+	}
+      }
+    }
+  }
+}
+
+static void check_slaves(u32 frame)
+{
+  int sid;
+
+  for(sid=0; sid<SID_NUM; ++sid) {
+    if( memcmp(&slave_sid[sid/2][0x20*(sid&1)], sid_regs[sid].ALL, SID_REGS_NUM) != 0 ) {
+      printf("ERROR: SID%d registers differ from the slave after frame %u\n", sid+1, frame);
+      ++errors;
+    }
+  }
+}
+
+// modulates the registers like a running patch: LFOs on frequency, pulse
+// width and filter, envelopes with gate changes and rare patch changes
+static void modulate(u32 frame)
+{
+  int sid, voice;
+
+  for(sid=0; sid<SID_NUM; ++sid) {
+    for(voice=0; voice<3; ++voice) {
+      u8 *v = sid_regs[sid].v[voice];
+
+      if( (rand() % 4) == 0 ) { // vibrato
+	u16 frq = v[0] | (v[1] << 8);
+	frq += (rand() % 64) - 32;
+	v[0] = frq & 0xff;
+	v[1] = frq >> 8;
+      }
+
+      if( (rand() % 8) == 0 ) { // PWM
+	u16 pw = (v[2] | (v[3] << 8)) + 16;
+	v[2] = pw & 0xff;
+	v[3] = (pw >> 8) & 0x0f;
+      }
+
+      if( (rand() % 32) == 0 ) // gate
+	v[4] ^= 0x01;
+    }
+
+    if( (rand() % 2) == 0 ) { // filter sweep
+      u16 filter = (sid_regs[sid].filter_l | (sid_regs[sid].filter_h << 3)) + 5;
+      sid_regs[sid].filter_l = filter & 0x07;
+      sid_regs[sid].filter_h = (filter >> 3) & 0xff;
+    }
+
+    if( (frame % 1000) == 999 ) { // patch change
+      int reg;
+      for(reg=0; reg<SID_REGS_NUM; ++reg)
+	sid_regs[sid].ALL[reg] = rand();
+    }
+  }
+}
+
+
+int main(int argc, char *argv[])
+{
+  sid_regs_t prev[SID_NUM];
+  u32 frame;
+
+  srand(1);
+
+  SID_Init(0);
+  SID_AvailableSet((1 << SID_NUM)-1);
+  if( !tx_handler ) {
+    printf("ERROR: no Tx handler installed\n");
+    return 1;
+  }
+
+  // initial transfer of all registers
+  SID_Update(1);
+  transfer_messages(1000);
+  check_slaves(0);
+
+  num_msgs = 0;
+  num_updates = 0;
+
+  for(frame=1; frame<=FRAMES; ++frame) {
+    memcpy(prev, sid_regs, sizeof(prev));
+    modulate(frame);
+    count_aligned_blocks(prev);
+
+    SID_Update(0);
+
+    if( (frame % 16) == 0 ) {
+      // the engine changes registers while a transfer is running
+      transfer_messages(1);
+      memcpy(prev, sid_regs, sizeof(prev));
+      modulate(frame);
+      count_aligned_blocks(prev);
+      SID_Update(0);
+      transfer_messages(1000);
+
+      // the remaining changes are sent with the next update
+      SID_Update(0);
+    }
+
+    transfer_messages(1000);
+    check_slaves(frame);
+  }
+
+  // nothing should be sent without changes
+  {
+    u32 msgs = num_msgs;
+    SID_Update(0);
+    transfer_messages(1000);
+    if( num_msgs != msgs ) {
+      printf("ERROR: %u messages sent without register changes\n", num_msgs - msgs);
+      ++errors;
+    }
+  }
+
+  printf("%u frames: %u messages (%.2f per frame), %u remote updates\n",
+	 FRAMES, num_msgs, (double)num_msgs / FRAMES, num_updates);
+  printf("fixed 8 byte blocks would have sent %u messages (%.2f per frame)\n",
+	 num_msgs_aligned, (double)num_msgs_aligned / FRAMES);
+  SID_PrintStatistics();
+
+  if( errors ) {
+    printf("%d errors\n", errors);
+    return 1;
+  }
+
+  printf("Loopback passed.\n");
+  return 0;
+}
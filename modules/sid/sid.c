@@ -61,14 +61,15 @@
 // Global variables
 /////////////////////////////////////////////////////////////////////////////
 
-sid_regs_t sid_regs[SID_NUM];
+// aligned to allow word-wise comparisons with the shadow registers
+sid_regs_t sid_regs[SID_NUM] __attribute__((aligned(4)));
 
 
 /////////////////////////////////////////////////////////////////////////////
 // Local variables
 /////////////////////////////////////////////////////////////////////////////
 
-static sid_regs_t sid_regs_shadow[SID_NUM]; // to determine register changes
+static sid_regs_t sid_regs_shadow[SID_NUM] __attribute__((aligned(4))); // to determine register changes
 #if SID_USE_MBNET
 static u32 sid_regs_shadow_updated[SID_NUM];
 #endif
@@ -84,13 +85,20 @@ static const u8 update_order[SID_REGS_NUM] = {
 
 static u8 sid_available;
 
+// CPU time of SID_Update() since the last SID_PrintStatistics() call
+static u32 update_ctr;
+static u32 update_cycles_total;
+static u32 update_cycles_max;
+
 #if SID_USE_MBNET
 static u8 mbnet_tx_state;
-static u8 mbnet_tx_reg_ctr;
 static u8 mbnet_my_node_id;
 static u32 mbnet_tx_msg_ctr;
 static u32 mbnet_tx_msg_ctr_min;
 static u32 mbnet_tx_msg_ctr_max;
+static u32 mbnet_tx_msg_total;
+static u32 mbnet_tx_reg_total;
+static u32 mbnet_tx_cycles_total;
 #endif
 
 #if !SID_USE_MBNET && defined(MIOS32_FAMILY_STM32F10x)
@@ -140,6 +148,8 @@ static inline void SID_UpdateReg(sid_cs_pin_t *cs_pin0, sid_cs_pin_t *cs_pin1, u
 #else
 s32 SID_MBNET_TxHandler(mbnet_id_t *mbnet_id, mbnet_msg_t *msg, u8 *dlc);
 #endif
+static inline u32 SID_ChangedRegs(u8 sid);
+static void SID_UpdateCyclesAdd(u32 cycles);
 
 /////////////////////////////////////////////////////////////////////////////
 // Initializes the SID module
@@ -162,15 +172,23 @@ s32 SID_Init(u32 mode)
 #if SID_USE_MBNET
   sid_available = 0x00; // set after node scan
   mbnet_tx_state = MBNET_TX_STATE_NOP;
-  mbnet_tx_reg_ctr = 0;
   mbnet_tx_msg_ctr = 0;
   mbnet_tx_msg_ctr_min = 0;
   mbnet_tx_msg_ctr_max = 0;
+  mbnet_tx_msg_total = 0;
+  mbnet_tx_reg_total = 0;
+  mbnet_tx_cycles_total = 0;
   mbnet_my_node_id = 0xff;
 #else
   sid_available = (u8)((1 << SID_NUM)-1);
 #endif
 
+  // for the CPU time in SID_PrintStatistics()
+  MIOS32_CYCLES_Init(0);
+  update_ctr = 0;
+  update_cycles_total = 0;
+  update_cycles_max = 0;
+
 #ifdef SIDEMU_ENABLED
   SYNTH_Init(0);
 #endif
@@ -292,7 +310,6 @@ s32 SID_AvailableSet(u8 available)
   if( sid_available && mbnet_tx_state == MBNET_TX_STATE_NOP ) {
     // start MBNet transfers once SIDs have been found
     mbnet_tx_state = MBNET_TX_STATE_SID1;
-    mbnet_tx_reg_ctr = 0;
     mbnet_tx_msg_ctr = 0;
     mbnet_tx_msg_ctr_min = 0;
     mbnet_tx_msg_ctr_max = 0;
@@ -315,6 +332,46 @@ u8 SID_AvailableGet(void)
 }
 
 
+/////////////////////////////////////////////////////////////////////////////
+// Returns a mask of the registers which differ from the shadow registers
+// (bit n set: register n changed). The registers are compared word-wise, so
+// that a SID without changes only takes a few cycles.
+/////////////////////////////////////////////////////////////////////////////
+static inline u32 SID_ChangedRegs(u8 sid)
+{
+  u32 *regs = (u32 *)&sid_regs[sid].ALL[0];
+  u32 *regs_shadow = (u32 *)&sid_regs_shadow[sid].ALL[0];
+  u32 changed = 0;
+  int word;
+
+  for(word=0; word<(SID_REGS_NUM/4); ++word) {
+    u32 diff = regs[word] ^ regs_shadow[word];
+    if( diff ) {
+      u32 mask = 0;
+      if( diff & 0x000000ff ) mask |= 1;
+      if( diff & 0x0000ff00 ) mask |= 2;
+      if( diff & 0x00ff0000 ) mask |= 4;
+      if( diff & 0xff000000 ) mask |= 8;
+      changed |= mask << (4*word);
+    }
+  }
+
+  return changed;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Adds the CPU time of a SID_Update() call to the statistics
+/////////////////////////////////////////////////////////////////////////////
+static void SID_UpdateCyclesAdd(u32 cycles)
+{
+  ++update_ctr;
+  update_cycles_total += cycles;
+  if( cycles > update_cycles_max )
+    update_cycles_max = cycles;
+}
+
+
 /////////////////////////////////////////////////////////////////////////////
 // Updates all SID registers
 // IN: <mode>: if 0: only register changes will be transfered to SID(s)
@@ -325,7 +382,8 @@ u8 SID_AvailableGet(void)
 #if SID_USE_MBNET
 s32 SID_Update(u32 mode)
 {
-  int sid, reg;
+  u32 cycles = MIOS32_CYCLES_Get();
+  int sid;
   // if register update should be forced, just inverse all shadow register values
   if( mode >= 1 ) { // (also for reset mode)
     MIOS32_IRQ_Disable();
@@ -337,13 +395,10 @@ s32 SID_Update(u32 mode)
   // transfer SID registers to shadow registers and check for updates
   MIOS32_IRQ_Disable();
   for(sid=0; sid<SID_NUM; ++sid) {
-    u8 *regs = (u8 *)&sid_regs[sid];
-    u8 *regs_shadow = (u8 *)&sid_regs_shadow[sid];
-
-    for(reg=0; reg<SID_REGS_NUM; ++reg) {
-      if( *regs_shadow != *regs )
-	sid_regs_shadow_updated[sid] |= (1 << reg);
-      *regs_shadow++ = *regs++;
+    u32 changed = SID_ChangedRegs(sid);
+    if( changed ) {
+      sid_regs_shadow_updated[sid] |= changed;
+      sid_regs_shadow[sid] = sid_regs[sid];
     }
   }
   MIOS32_IRQ_Enable();
@@ -356,12 +411,13 @@ s32 SID_Update(u32 mode)
       mbnet_tx_msg_ctr_max = mbnet_tx_msg_ctr;
 
     mbnet_tx_msg_ctr = 0;
-    mbnet_tx_reg_ctr = 0;
 
     mbnet_tx_state = MBNET_TX_STATE_SID1;
     MBNET_TriggerTxHandler();
   }
 
+  SID_UpdateCyclesAdd(MIOS32_CYCLES_Get() - cycles);
+
   return 0; // no error
 }
 
@@ -375,43 +431,37 @@ s32 SID_MBNET_TxHandler(mbnet_id_t *mbnet_id, mbnet_msg_t *msg, u8 *dlc)
   if( mbnet_tx_state == MBNET_TX_STATE_DONE )
     return 0; // nothing else to do...
 
-  // - search for next register set of 8 bytes which have been updated (-> tx_required)
-  // - check if there are remaining bytes which have to be updated - if not, set remote_reg_update
-  // - if all registers for all SIDs have been updated, change to MBNET_TX_STATE_DONE
-  u8 tx_sid = 0;
-  u8 tx_addr = 0;
-  u8 tx_required = 0;
+  // - search for the first SID with updated registers
+  // - send the 8 registers starting at the first updated one, so that changes
+  //   which cross an 8 byte boundary don't require two messages
+  // - if no updated registers remain afterwards, set remote_reg_update and
+  //   change to MBNET_TX_STATE_DONE
+  u32 cycles = MIOS32_CYCLES_Get();
+  u8 tx_sid;
+  u8 tx_addr;
   u8 remote_reg_update = 0;
+  u32 updated;
   while( 1 ) {
-    u8 sid = (mbnet_tx_state-MBNET_TX_STATE_SID1);
-    u8 addr = mbnet_tx_reg_ctr;
-
-    if( sid_regs_shadow_updated[sid] & (0xff << addr) ) {
-      if( tx_required )
-	break; // ok, this isn't the last update for this SID
-      else {
-	tx_required = 1;
-	tx_sid = sid;
-	tx_addr = addr;
-      }
-    }
+    tx_sid = (mbnet_tx_state-MBNET_TX_STATE_SID1);
+    if( (updated=sid_regs_shadow_updated[tx_sid]) )
+      break;
 
-    mbnet_tx_reg_ctr += 8;
-    if( mbnet_tx_reg_ctr >= SID_REGS_NUM ) {
-      mbnet_tx_reg_ctr = 0;
-      if( ++mbnet_tx_state == MBNET_TX_STATE_SID3 ) {
-	mbnet_tx_state = MBNET_TX_STATE_DONE;
-
-	if( !tx_required )
-	  return 0; // abort loop, because register update has finished
-	else {
-	  remote_reg_update = 1; // update SID registers at remote side
-	  break;
-	}
-      }
+    if( ++mbnet_tx_state == MBNET_TX_STATE_SID3 ) {
+      mbnet_tx_state = MBNET_TX_STATE_DONE;
+      return 0; // abort loop, because register update has finished
     }
   }
 
+  tx_addr = __builtin_ctz(updated);
+  if( tx_addr > (SID_REGS_NUM-8) )
+    tx_addr = SID_REGS_NUM-8;
+
+  if( !(updated & ~(0xff << tx_addr)) &&
+      (mbnet_tx_state == (MBNET_TX_STATE_SID3-1) || !sid_regs_shadow_updated[tx_sid+1]) ) {
+    mbnet_tx_state = MBNET_TX_STATE_DONE;
+    remote_reg_update = 1; // update SID registers at remote side
+  }
+
   // create MBNet message
   mbnet_id->control = (remote_reg_update ? 0xfd00 : 0xfe00) + tx_addr + 0x20*(tx_sid&1);
   mbnet_id->tos     = MBNET_REQ_RAM_WRITE;
@@ -439,12 +489,16 @@ s32 SID_MBNET_TxHandler(mbnet_id_t *mbnet_id, mbnet_msg_t *msg, u8 *dlc)
   MIOS32_IRQ_Enable();
 
   ++mbnet_tx_msg_ctr;
+  ++mbnet_tx_msg_total;
+  mbnet_tx_reg_total += __builtin_popcount(updated & (0xff << tx_addr));
+  mbnet_tx_cycles_total += MIOS32_CYCLES_Get() - cycles;
 
   return 1;
 }
 #else
 s32 SID_Update(u32 mode)
 {
+  u32 cycles = MIOS32_CYCLES_Get();
   int sid, reg, i;
 
   // trigger reset?
@@ -470,6 +524,11 @@ s32 SID_Update(u32 mode)
   // this loop should run so fast as possible, 
   // we consider to update two SIDs at once if values are identical
   for(sid=0; sid<SID_NUM; sid+=2) {
+    // compare word-wise first, so that only changed registers have to be checked
+    u32 changed = SID_ChangedRegs(sid+0) | SID_ChangedRegs(sid+1);
+    if( !changed )
+      continue;
+
     u8 *update_order_ptr = (u8 *)&update_order[0];
     u8 *sidl = (u8 *)&sid_regs[sid+0].ALL[0];
     u8 *sidl_shadow = (u8 *)&sid_regs_shadow[sid+0].ALL[0];
@@ -490,6 +549,8 @@ s32 SID_Update(u32 mode)
       u8 data;
 
       reg = *update_order_ptr;
+      if( !(changed & (1 << reg)) )
+	continue;
 
       // check if update of left/right channel SID are required
       // partly duplicated code ensures best performance in all cases!
@@ -517,6 +578,8 @@ s32 SID_Update(u32 mode)
     }
   }
 
+  SID_UpdateCyclesAdd(MIOS32_CYCLES_Get() - cycles);
+
   return 0; // no error
 }
 
@@ -645,13 +708,29 @@ s32 SID_PrintStatistics(void)
 {
 #if SID_USE_MBNET
   if( mbnet_tx_msg_ctr_min ) {
-    MIOS32_MIDI_SendDebugMessage("MBNET MSG Min:%d Max:%d", mbnet_tx_msg_ctr_min, mbnet_tx_msg_ctr_max);
+    // totals are counted since the last call (-> per second if called each second)
+    MIOS32_MIDI_SendDebugMessage("MBNET MSG Min:%d Max:%d Total:%d Regs:%d TxHandler:%d uS",
+				 mbnet_tx_msg_ctr_min, mbnet_tx_msg_ctr_max, mbnet_tx_msg_total, mbnet_tx_reg_total,
+				 mbnet_tx_cycles_total / (MIOS32_SYS_CPU_FREQUENCY/1000000));
 
     mbnet_tx_msg_ctr_min = 0;
     mbnet_tx_msg_ctr_max = 0;
+    mbnet_tx_msg_total = 0;
+    mbnet_tx_reg_total = 0;
+    mbnet_tx_cycles_total = 0;
   }
 #endif
 
+  if( update_ctr ) {
+    // CPU time of the change detection (and of the transfers to MBHP_SID modules)
+    MIOS32_MIDI_SendDebugMessage("SID_Update Calls:%d Avg:%d Max:%d Total:%d cycles",
+				 update_ctr, update_cycles_total / update_ctr, update_cycles_max, update_cycles_total);
+
+    update_ctr = 0;
+    update_cycles_total = 0;
+    update_cycles_max = 0;
+  }
+
   return 0; // no error
 }
 
@@ -0,0 +1,471 @@
+// Trace replay harness for vgm_heap2
+//
+// Replays an allocation trace with the current allocator (../vgm_heap2.c)
+// and with the previous single free list allocator (vgm_heap2_ref.c), and
+// compares allocation time, fallbacks to the main heap and fragmentation.
+// The contents of all allocations are verified on each realloc and free.
+//
+// Usage: heap_replay [<trace file>]
+//
+// A trace is the terminal output of a Quad Genesis session with VGMH2_TRACE
+// enabled (see vgm_heap2.h); lines which don't start with "vgmh2 " are
+// ignored. Without a file, a synthetic tracker session is replayed.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "mios32.h"
+#include "../vgm_heap2.h"
+#include "vgm_heap2_ref.h"
+
+#define MAX_IDS   65536
+#define MAX_OPS   4000000
+
+// fragmentation is sampled every FRAG_SAMPLE_OPS operations
+#define FRAG_SAMPLE_OPS 500
+
+u8 vgmh2_test_heap[VGMH2_HEAPSIZE] __attribute__((aligned(8)));
+
+typedef struct {
+  char op; // 'm', 'r' or 'f'
+  u32  id;
+  u32  size;
+} trace_op_t;
+
+static trace_op_t *ops;
+static u32 num_ops;
+static u32 num_ids;
+
+static int errors;
+
+
+// ------- host clock -------
+static u32 clock_ns(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (u32)(ts.tv_sec * 1000000000ull + ts.tv_nsec);
+}
+
+u32 test_cycles(void)
+{
+  return clock_ns();
+}
+
+
+// ------- trace -------
+static void add_op(char op, u32 id, u32 size)
+{
+  if( num_ops >= MAX_OPS ) {
+    printf("ERROR: trace too long\n");
+    exit(1);
+  }
+  ops[num_ops].op = op;
+  ops[num_ops].id = id;
+  ops[num_ops].size = size;
+  ++num_ops;
+}
+
+// recorded addresses are mapped to ids, which are replayed on both heaps
+#define ADDR_HASH_SIZE (2*MAX_IDS)
+static u32 addr_key[ADDR_HASH_SIZE];
+static u32 addr_id[ADDR_HASH_SIZE];
+
+static u32 *addr_slot(u32 addr)
+{
+  u32 i = (addr * 2654435761u) % ADDR_HASH_SIZE;
+  while( addr_key[i] && addr_key[i] != addr )
+    i = (i + 1) % ADDR_HASH_SIZE;
+  addr_key[i] = addr;
+  return &addr_id[i];
+}
+
+static s32 addr_take(u32 addr)
+{
+  u32 *slot = addr_slot(addr);
+  s32 id = (s32)*slot - 1;
+  *slot = 0; // (the key stays occupied, so probe chains aren't broken)
+  return id;
+}
+
+static u32 new_id(void)
+{
+  if( num_ids >= MAX_IDS ) {
+    printf("ERROR: too many allocations in trace\n");
+    exit(1);
+  }
+  return num_ids++;
+}
+
+static void trace_load(const char *filename)
+{
+  FILE *f = fopen(filename, "r");
+  char line[256];
+  if( !f ) {
+    printf("ERROR: can't open %s\n", filename);
+    exit(1);
+  }
+
+  while( fgets(line, sizeof(line), f) ) {
+    char *p = strstr(line, "vgmh2 ");
+    char op;
+    u32 ptr, result, size;
+    if( !p || sscanf(p, "vgmh2 %c %x %x %u", &op, &ptr, &result, &size) != 4 )
+      continue;
+
+    if( op == 'm' ) {
+      if( result ) {
+        u32 id = new_id();
+        *addr_slot(result) = id + 1;
+        add_op('m', id, size);
+      }
+    } else if( op == 'r' ) {
+      s32 id = ptr ? addr_take(ptr) : -1;
+      if( id < 0 ) {
+        if( !result )
+          continue;
+        id = new_id(); // realloc(NULL, size), or pointer allocated before the trace started
+        add_op('m', id, size);
+      } else if( !result ) {
+        add_op('f', id, 0); // freed (size 0, or out of memory)
+        continue;
+      } else {
+        add_op('r', id, size);
+      }
+      *addr_slot(result) = id + 1;
+    } else if( op == 'f' ) {
+      s32 id = ptr ? addr_take(ptr) : -1;
+      if( id >= 0 )
+        add_op('f', id, 0);
+    }
+  }
+
+  fclose(f);
+}
+
+// synthetic tracker session: VGM files loaded into RAM, edited command by
+// command (each insertion or deletion reallocates the command list, see
+// vgmram.c), streamed files, file browser paths and temporary strings
+#define SYNTH_MAX_SOURCES 10
+#define SYNTH_CMD_SIZE    8   // sizeof(VgmChipWriteCmd)
+
+static u32 synth_rand(void)
+{
+  static u32 seed = 12345;
+  seed = seed * 1103515245 + 12345;
+  return (seed >> 8) & 0xffffff;
+}
+
+static void trace_synthesize(u32 num_edits)
+{
+  struct {
+    u32 head, source, vsr, cmds;
+    u32 numcmds;
+  } src[SYNTH_MAX_SOURCES];
+  u32 num_sources = 0;
+  u32 stream_head = 0, stream_path = 0, num_streams = 0;
+  u32 i;
+
+  // file browser buffers, kept for the whole session
+  add_op('m', new_id(), 256);
+  add_op('m', new_id(), 13);
+
+  for(i=0; i<num_edits; ++i) {
+    u32 r = synth_rand() % 1000;
+
+    if( num_sources == 0 || (r < 3 && num_sources < SYNTH_MAX_SOURCES) ) {
+      // load a VGM file into RAM
+      u32 n = num_sources++;
+      src[n].head = new_id(); add_op('m', src[n].head, 96);
+      src[n].source = new_id(); add_op('m', src[n].source, 40);
+      src[n].vsr = new_id(); add_op('m', src[n].vsr, 12);
+      src[n].numcmds = 50 + synth_rand() % 1200;
+      src[n].cmds = new_id(); add_op('m', src[n].cmds, src[n].numcmds * SYNTH_CMD_SIZE);
+    } else if( r < 6 && num_sources > 1 ) {
+      // delete a file
+      u32 n = synth_rand() % num_sources;
+      add_op('f', src[n].cmds, 0);
+      add_op('f', src[n].vsr, 0);
+      add_op('f', src[n].source, 0);
+      add_op('f', src[n].head, 0);
+      src[n] = src[--num_sources];
+    } else if( r < 30 ) {
+      // start or stop a stream
+      if( num_streams ) {
+        add_op('f', stream_path, 0);
+        add_op('f', stream_head, 0);
+        num_streams = 0;
+      } else {
+        stream_head = new_id(); add_op('m', stream_head, 160);
+        stream_path = new_id(); add_op('m', stream_path, 13 + synth_rand() % 40);
+        num_streams = 1;
+      }
+    } else if( r < 80 ) {
+      // temporary message string
+      u32 id = new_id();
+      add_op('m', id, (r & 1) ? 36 : 64);
+      add_op('f', id, 0);
+    } else {
+      // insert or delete a command
+      u32 n = synth_rand() % num_sources;
+      if( (r & 1) || src[n].numcmds <= 1 )
+        ++src[n].numcmds;
+      else
+        --src[n].numcmds;
+      add_op('r', src[n].cmds, src[n].numcmds * SYNTH_CMD_SIZE);
+    }
+  }
+}
+
+
+// ------- replay -------
+typedef struct {
+  const char *name;
+  u8 *heap;
+  void (*init)();
+  void *(*malloc)(size_t size);
+  void *(*realloc)(void *ptr, size_t size);
+  void (*free)(void *ptr);
+} allocator_t;
+
+typedef struct {
+  u64 total_ns;
+  u32 max_ns;
+  u32 num_fallbacks;
+  u32 frag_samples;
+  double frag_sum;
+  u32 frag_max;
+  u32 largest_free_min;
+  u32 free_blocks_end;
+  u32 fragments_end;
+  u32 largest_free_end;
+} result_t;
+
+static void **ptrs;
+static u32 *sizes;
+
+static u8 pattern(u32 id, u32 offset)
+{
+  return (u8)(id * 7 + offset);
+}
+
+static void fill(u32 id, u32 from, u32 to)
+{
+  u8 *p = (u8 *)ptrs[id];
+  u32 i;
+  for(i=from; i<to; ++i)
+    p[i] = pattern(id, i);
+}
+
+static void verify(const allocator_t *a, u32 id, u32 size)
+{
+  u8 *p = (u8 *)ptrs[id];
+  u32 i;
+  for(i=0; i<size; ++i) {
+    if( p[i] != pattern(id, i) ) {
+      printf("ERROR: %s: allocation %u corrupted at offset %u\n", a->name, id, i);
+      ++errors;
+      return;
+    }
+  }
+}
+
+static int in_heap(const allocator_t *a, void *ptr)
+{
+  return (u8 *)ptr >= a->heap && (u8 *)ptr < a->heap + VGMH2_HEAPSIZE;
+}
+
+// walks the physical block chain (same block layout in both allocators):
+// free space in the lists, number of free regions and the largest region,
+// including the space behind the end of the heap
+static void heap_walk(const allocator_t *a, u32 *free_blocks, u32 *fragments, u32 *largest)
+{
+  const u16 *blocks = (const u16 *)a->heap; // next, prev, (free next, free prev)
+  u32 c = 0, n, size, tail;
+
+  *free_blocks = *fragments = *largest = 0;
+  while( (n = (blocks[4*c] & 0x7fff)) != 0 ) {
+    if( blocks[4*c] & 0x8000 ) {
+      size = n - c;
+      *free_blocks += size;
+      ++*fragments;
+      if( size > *largest )
+        *largest = size;
+    }
+    c = n;
+  }
+
+  tail = VGMH2_NUMBLOCKS - 1 - c;
+  *free_blocks += tail;
+  if( tail > *largest )
+    *largest = tail;
+}
+
+static void sample_fragmentation(const allocator_t *a, result_t *res)
+{
+  u32 free_blocks, fragments, largest, frag;
+  heap_walk(a, &free_blocks, &fragments, &largest);
+
+  // fragmentation: share of the free space which isn't part of the largest region
+  frag = free_blocks ? (100 * (free_blocks - largest) / free_blocks) : 0;
+  ++res->frag_samples;
+  res->frag_sum += frag;
+  if( frag > res->frag_max )
+    res->frag_max = frag;
+  if( largest < res->largest_free_min )
+    res->largest_free_min = largest;
+}
+
+// the statistics of the current allocator have to match the heap
+static void check_stats(const allocator_t *a)
+{
+  vgmh2_stats_t stats;
+  u32 free_blocks, fragments, largest;
+
+  vgmh2_getstats(&stats);
+  heap_walk(a, &free_blocks, &fragments, &largest);
+  if( stats.free_blocks + stats.tail_blocks != free_blocks ||
+      stats.free_fragments != fragments || stats.largest_free != largest ) {
+    printf("ERROR: statistics don't match the heap: free %u+%u (%u), fragments %u (%u), largest %u (%u)\n",
+           stats.free_blocks, stats.tail_blocks, free_blocks,
+           stats.free_fragments, fragments, stats.largest_free, largest);
+    ++errors;
+  }
+}
+
+static void replay(const allocator_t *a, result_t *res)
+{
+  u32 i, t, dt;
+
+  memset(res, 0, sizeof(result_t));
+  res->largest_free_min = VGMH2_NUMBLOCKS;
+  memset(ptrs, 0, num_ids * sizeof(void *));
+  memset(sizes, 0, num_ids * sizeof(u32));
+
+  a->init();
+
+  for(i=0; i<num_ops; ++i) {
+    const trace_op_t *op = &ops[i];
+    void *p = NULL;
+
+    switch( op->op ) {
+    case 'm':
+      t = clock_ns();
+      p = a->malloc(op->size);
+      dt = clock_ns() - t;
+      break;
+    case 'r':
+      verify(a, op->id, sizes[op->id]);
+      t = clock_ns();
+      p = a->realloc(ptrs[op->id], op->size);
+      dt = clock_ns() - t;
+      break;
+    default:
+      verify(a, op->id, sizes[op->id]);
+      t = clock_ns();
+      a->free(ptrs[op->id]);
+      dt = clock_ns() - t;
+      ptrs[op->id] = NULL;
+      sizes[op->id] = 0;
+      break;
+    }
+
+    res->total_ns += dt;
+    if( dt > res->max_ns )
+      res->max_ns = dt;
+
+    if( op->op != 'f' ) {
+      if( !p ) {
+        printf("ERROR: %s: out of memory\n", a->name);
+        exit(1);
+      }
+      // moved into the main heap (reallocs of such allocations stay there)
+      if( !in_heap(a, p) && (!ptrs[op->id] || in_heap(a, ptrs[op->id])) )
+        ++res->num_fallbacks;
+      ptrs[op->id] = p;
+      if( op->op == 'r' && op->size > sizes[op->id] ) {
+        verify(a, op->id, sizes[op->id]);
+        fill(op->id, sizes[op->id], op->size);
+      } else if( op->op == 'm' ) {
+        fill(op->id, 0, op->size);
+      }
+      sizes[op->id] = op->size;
+    }
+
+    if( (i % FRAG_SAMPLE_OPS) == 0 )
+      sample_fragmentation(a, res);
+  }
+
+  sample_fragmentation(a, res);
+  heap_walk(a, &res->free_blocks_end, &res->fragments_end, &res->largest_free_end);
+  if( a->init == vgmh2_init )
+    check_stats(a);
+
+  // release everything, the heap has to be empty again
+  for(i=0; i<num_ids; ++i) {
+    if( ptrs[i] ) {
+      verify(a, i, sizes[i]);
+      a->free(ptrs[i]);
+      ptrs[i] = NULL;
+    }
+  }
+}
+
+static void print_result(const allocator_t *a, const result_t *res)
+{
+  printf("%-10s %8.1f %8u %9u %8.1f %8u %10u %9u %8u\n",
+         a->name,
+         (double)res->total_ns / num_ops, res->max_ns,
+         res->num_fallbacks,
+         res->frag_sum / res->frag_samples, res->frag_max,
+         res->largest_free_min * 8,
+         res->fragments_end, res->largest_free_end * 8);
+}
+
+
+int main(int argc, char *argv[])
+{
+  allocator_t current = { "current", vgmh2_test_heap, vgmh2_init, vgmh2_malloc, vgmh2_realloc, vgmh2_free };
+  allocator_t previous = { "previous", vgmh2ref_test_heap, vgmh2ref_init, vgmh2ref_malloc, vgmh2ref_realloc, vgmh2ref_free };
+  result_t res_current, res_previous;
+  vgmh2_stats_t stats;
+
+  ops = (trace_op_t *)malloc(MAX_OPS * sizeof(trace_op_t));
+  ptrs = (void **)malloc(MAX_IDS * sizeof(void *));
+  sizes = (u32 *)malloc(MAX_IDS * sizeof(u32));
+
+  if( argc > 1 ) {
+    trace_load(argv[1]);
+    printf("Trace %s: %u operations, %u allocations\n", argv[1], num_ops, num_ids);
+  } else {
+    trace_synthesize(20000);
+    printf("Synthetic session: %u operations, %u allocations\n", num_ops, num_ids);
+  }
+
+  replay(&previous, &res_previous);
+  replay(&current, &res_current);
+
+  printf("\n           -- time/op (nS) -- fallbacks -- fragmentation (%%) -- min largest -- at end of trace --\n");
+  printf("allocator      avg      max                 avg      max  free (B)   fragments  largest (B)\n");
+  print_result(&previous, &res_previous);
+  print_result(&current, &res_current);
+
+  vgmh2_getstats(&stats);
+  if( stats.free_fragments != 0 || stats.tail_blocks != VGMH2_NUMBLOCKS - 1 - VGMH2_NUMBINS ) {
+    printf("ERROR: heap not empty after freeing all allocations\n");
+    ++errors;
+  }
+
+  printf("\n%u mallocs, %u reallocs, %u frees, %u fallbacks, peak %u bytes\n",
+         stats.num_mallocs, stats.num_reallocs, stats.num_frees, stats.num_fallbacks,
+         stats.peak_used_blocks * 8);
+
+  if( errors ) {
+    printf("%d error(s)\n", errors);
+    return 1;
+  }
+
+  printf("Replay passed.\n");
+  return 0;
+}
@@ -0,0 +1,22 @@
+// minimal MIOS32 environment to compile vgm_heap2.c on the host
+#ifndef _MIOS32_H
+#define _MIOS32_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+typedef uint8_t  u8;
+typedef uint16_t u16;
+typedef uint32_t u32;
+typedef uint64_t u64;
+typedef int32_t  s32;
+
+// vgm_heap2 is only available for STM32F4
+#define MIOS32_BOARD_STM32F4DISCOVERY
+
+// allocation time statistics are taken from the host clock (nS)
+#define VGMH2_CYCLES() test_cycles()
+extern u32 test_cycles(void);
+
+#endif /* _MIOS32_H */
@@ -0,0 +1,3 @@
+// the CCM RAM of the heap is a static array of the host test
+extern u8 vgmh2_test_heap[];
+#define CCMDATARAM_BASE ((size_t)vgmh2_test_heap)
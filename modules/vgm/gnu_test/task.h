@@ -0,0 +1,3 @@
+// the host test is single threaded
+#define vTaskSuspendAll() do {} while(0)
+#define xTaskResumeAll()  ((void)0)
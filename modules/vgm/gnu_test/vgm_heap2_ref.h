@@ -0,0 +1,17 @@
+// previous single free list allocator, reference for heap_replay
+#ifndef _VGM_HEAP2_REF_H
+#define _VGM_HEAP2_REF_H
+
+#include "mios32.h"
+
+extern u8 vgmh2ref_test_heap[];
+
+extern void vgmh2ref_init();
+
+extern void* vgmh2ref_malloc(size_t size);
+extern void* vgmh2ref_realloc(void* ptr, size_t size);
+extern void vgmh2ref_free(void* ptr);
+
+extern volatile u16 vgmh2ref_numusedblocks;
+
+#endif /* _VGM_HEAP2_REF_H */
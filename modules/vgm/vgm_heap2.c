@@ -20,8 +20,15 @@
  * For clarity (this is the same in the original implementation): next and
  * previous blocks are the actual block numbers of the consecutive blocks.
  * I.e. sizeof(c) == NBLOCK(c) - c, and sizeof(previous) == c - PBLOCK(c).
- * However next and previous FREE blocks are in an arbitrary order; newly
- * freed blocks are added to the head of the free list.
+ * 
+ * Unlike the original, free blocks are not kept in a single list. Blocks
+ * 0 through VGMH2_NUMBINS-1 are the heads of circular free lists ("bins"),
+ * one per size class; newly freed blocks are added to the head of the list
+ * for their size. vgmh2_binmap has a bit set for each bin which is not empty,
+ * so finding a free block which is large enough is a count-trailing-zeros
+ * instead of a walk over the whole free list. The free space at the end of
+ * the heap is not part of any bin; vgmh2_tail is the block marking the end of
+ * the heap, and freed blocks directly before it are merged back into it.
  */
 
 
@@ -58,6 +65,12 @@ vgmh2_block *const vgmh2_heap = (vgmh2_block *const)(VGMH2_HEAPSTART);
 
 volatile u16 vgmh2_numusedblocks;
 
+static u16 vgmh2_tail; //Block marking the end of the heap
+static u32 vgmh2_binmap; //Bit n set if bin n is not empty
+static u16 vgmh2_numfreeblocks; //Total size of all blocks in the bins
+static u16 vgmh2_numfragments; //Number of blocks in the bins
+static vgmh2_stats_t vgmh2_stats; //Only the counters are kept up to date here
+
 //---------------------Some macros for quick access-----------------------------
 
 #define VGMH2_BLOCK(b)  (vgmh2_heap[b])
@@ -76,6 +89,12 @@ u16 vgmh2_blocks(size_t size){
     return 2 + ((size-5)/8);
 }
 
+//Which bin are free blocks of this many blocks kept in?
+static inline u8 vgmh2_bin(u16 blocks){
+    if(blocks <= VGMH2_EXACTBINS) return blocks - 1;
+    return VGMH2_EXACTBINS + (27 - __builtin_clz(blocks)); //16-31 -> first power-of-two bin
+}
+
 //Create a new block at c+blocks, link it into the list.
 void vgmh2_make_new_block(u16 c, u16 blocks, u16 c_freemask){
      VGMH2_NBLOCK(c+blocks) = VGMH2_NBLOCK(c) & VGMH2_BLOCKNO_MASK; //New block's N is originally-next block
@@ -85,11 +104,30 @@ void vgmh2_make_new_block(u16 c, u16 blocks, u16 c_freemask){
      VGMH2_NBLOCK(c)                                    = (c+blocks) | c_freemask; //Current block's N is new block, and mark the current block as free or not
 }
 
+//Add this (not free) block to the head of the free list for its size, and mark it as free.
+static void vgmh2_connect_to_free_list(u16 c){
+    u16 size = VGMH2_NBLOCK(c) - c;
+    u8 bin = vgmh2_bin(size);
+    VGMH2_PFREE(VGMH2_NFREE(bin)) = c; //Previous of the first free block points to current one
+    VGMH2_NFREE(c)                = VGMH2_NFREE(bin); //Current-next points to originally first free
+    VGMH2_PFREE(c)                = bin; //Previous of current is the bin head
+    VGMH2_NFREE(bin)              = c; //First free block (next of bin head) is current
+    VGMH2_NBLOCK(c)              |= VGMH2_FREELIST_MASK; //Mark current block as free
+    vgmh2_binmap |= (1 << bin);
+    vgmh2_numfreeblocks += size;
+    ++vgmh2_numfragments;
+}
+
 //Disconnect this block from the free list.
 void vgmh2_disconnect_from_free_list(u16 c){
+    u16 size = (VGMH2_NBLOCK(c) & VGMH2_BLOCKNO_MASK) - c;
+    u8 bin = vgmh2_bin(size);
     VGMH2_NFREE(VGMH2_PFREE(c)) = VGMH2_NFREE(c); //Connect previous to next
     VGMH2_PFREE(VGMH2_NFREE(c)) = VGMH2_PFREE(c); //Connect next to previous
     VGMH2_NBLOCK(c) &= (~VGMH2_FREELIST_MASK); //Mark current block as not free
+    if(VGMH2_NFREE(bin) == bin) vgmh2_binmap &= ~(1 << bin); //Bin is empty now
+    vgmh2_numfreeblocks -= size;
+    --vgmh2_numfragments;
 }
 
 //If the next block is free, combine the current block with it.
@@ -108,116 +146,206 @@ u16 vgmh2_assimilate_down(u16 c, u16 p_freemask){
     return VGMH2_PBLOCK(c); //Return previous
 }
 
-//------------------------------Main functions----------------------------------
-
-void vgmh2_init(){
-    //Clear heap data 4 bytes at a time
-    u32* head = (u32*)(vgmh2_heap);
-    u32* end = (u32*)((u8*)head + VGMH2_HEAPSIZE);
-    while(head < end) *head++ = 0;
-    //Initialize used blocks counter
-    vgmh2_numusedblocks = 2; //The head and the tail
-    //Initialize head of heap
-    VGMH2_NBLOCK(0) = 1;
-    VGMH2_NFREE(0)  = 1;
-}
-
-void *vgmh2_malloc(size_t size){
-    if(size == 0) return NULL;
-    u16 blocksNeeded, blockSize, bestSize, bestBlock, cf;
-    blocksNeeded = vgmh2_blocks(size);
-    vTaskSuspendAll(); //Enter critical section
-
-    //Scan free list to find first/best fit
-    cf = VGMH2_NFREE(0);
-    bestBlock = cf;
-    bestSize  = 0x7FFF;
-    blockSize = 0;
-    while(VGMH2_NFREE(cf)){
-        blockSize = (VGMH2_NBLOCK(cf) & VGMH2_BLOCKNO_MASK) - cf;
-        //#if defined VGMH2_FIRST_FIT
-        //if((blockSize >= blocksNeeded))
-        //    break;
-        //#elif defined VGMH2_BEST_FIT
-        if((blockSize >= blocksNeeded) && (blockSize < bestSize)){
-            bestBlock = cf;
-            bestSize  = blockSize;
+//Find room for blocksNeeded blocks and mark it as used. Returns the block
+//number, or 0 if there is no room left in this heap. Doesn't touch the
+//used blocks counter. Must be called in a critical section.
+static u16 vgmh2_alloc_blocks(u16 blocksNeeded){
+    u16 cf = 0, blockSize, bestSize;
+    u8 bin = vgmh2_bin(blocksNeeded);
+    u32 m;
+
+    if(vgmh2_binmap & (1 << bin)){
+        if(bin < VGMH2_EXACTBINS){
+            //Every block in this bin is exactly the right size
+            cf = VGMH2_NFREE(bin);
+        }else{
+            //Blocks in this bin are of different sizes, find the best fit
+            u16 c = VGMH2_NFREE(bin);
+            bestSize = 0x7FFF;
+            while(c != bin){
+                blockSize = (VGMH2_NBLOCK(c) & VGMH2_BLOCKNO_MASK) - c;
+                if((blockSize >= blocksNeeded) && (blockSize < bestSize)){
+                    cf       = c;
+                    bestSize = blockSize;
+                    if(blockSize == blocksNeeded) break;
+                }
+                c = VGMH2_NFREE(c);
+            }
         }
-        //#endif
-        cf = VGMH2_NFREE(cf);
     }
-    if(0x7FFF != bestSize){
-        cf        = bestBlock;
-        blockSize = bestSize;
-    }//else there are no free blocks, try at the end of the heap
-    //Now cf is the block we're going to use, and blockSize is its size
+    if(!cf){
+        //Any block in a larger bin is big enough, take the first one from the smallest of them
+        m = vgmh2_binmap & ~((2ul << bin) - 1);
+        if(m) cf = VGMH2_NFREE(__builtin_ctz(m));
+    }
 
-    if(VGMH2_NBLOCK(cf) & VGMH2_BLOCKNO_MASK){
+    if(cf){
         //cf is a free block, allocate within that
-        if(blockSize == blocksNeeded){
-            //Exact fit, just mark it as not free
-            vgmh2_disconnect_from_free_list(cf);
-        }else{
-            //Create our block in the later half of this block; mark the original
-            //(lower/remaining) portion as free
-            vgmh2_make_new_block(cf, blockSize-blocksNeeded, VGMH2_FREELIST_MASK);
+        blockSize = (VGMH2_NBLOCK(cf) & VGMH2_BLOCKNO_MASK) - cf;
+        vgmh2_disconnect_from_free_list(cf);
+        if(blockSize > blocksNeeded){
+            //Create our block in the later half of this block; put the original
+            //(lower/remaining) portion back in the free list for its new size
+            vgmh2_make_new_block(cf, blockSize-blocksNeeded, 0);
+            vgmh2_connect_to_free_list(cf);
             //Going to return the later block
             cf += blockSize-blocksNeeded;
         }
     }else{
-        //cf is the block starting the free space at the end of the heap
+        //Allocate at the end of the heap
         //Is there enough remaining heap space to allocate the desired number of blocks?
+        cf = vgmh2_tail;
         u16 newEndOfHeap = cf + blocksNeeded; //The block to mark the end of the heap
         if(newEndOfHeap >= VGMH2_NUMBLOCKS){
             //The end of heap block would be outside the memory segment
-            xTaskResumeAll(); //Leave critical section
-            return malloc(size); //Allocate in primary heap instead
+            return 0;
         }
-        VGMH2_NFREE(VGMH2_PFREE(cf)) = newEndOfHeap; //Previous-next point to the end of the heap
-        memcpy(&VGMH2_BLOCK(newEndOfHeap), &VGMH2_BLOCK(cf), sizeof(vgmh2_block)); //Copied data: NBLOCK and NFREE are zeros, PFREE is whatever the last free block is, and PBLOCK will be overwritten next
+        VGMH2_NBLOCK(newEndOfHeap) = 0; //End of the heap has no next
         VGMH2_PBLOCK(newEndOfHeap) = cf; //Previous of the end of the heap is current
         VGMH2_NBLOCK(cf)           = newEndOfHeap; //Next of current is the end of the heap
+        vgmh2_tail = newEndOfHeap;
+    }
+    return cf;
+}
+
+//Mark this used block as free, combining it with its neighbors. Doesn't touch
+//the used blocks counter. Must be called in a critical section.
+static void vgmh2_free_blocks(u16 c){
+    //Combine this block with the next if possible
+    vgmh2_assimilate_up(c);
+
+    //If the previous block is free, combine this with it
+    if(VGMH2_NBLOCK(VGMH2_PBLOCK(c)) & VGMH2_FREELIST_MASK){
+        vgmh2_disconnect_from_free_list(VGMH2_PBLOCK(c)); //It's going to change size
+        c = vgmh2_assimilate_down(c, 0);
+    }
+
+    if(VGMH2_NBLOCK(c) == vgmh2_tail){
+        //This is the last block before the end of the heap, give it back to the end
+        VGMH2_NBLOCK(c) = 0;
+        vgmh2_tail = c;
+    }else{
+        vgmh2_connect_to_free_list(c);
+    }
+}
+
+//CPU cycle counter, for the allocation time statistics
+static inline u32 vgmh2_cycles(){
+    return VGMH2_CYCLES();
+}
+
+static void vgmh2_count_used(){
+    if(vgmh2_numusedblocks > vgmh2_stats.peak_used_blocks){
+        vgmh2_stats.peak_used_blocks = vgmh2_numusedblocks;
+    }
+}
+
+//------------------------------Main functions----------------------------------
+
+void vgmh2_init(){
+    u16 b;
+    //Clear heap data 4 bytes at a time
+    u32* head = (u32*)(vgmh2_heap);
+    u32* end = (u32*)((u8*)head + VGMH2_HEAPSIZE);
+    while(head < end) *head++ = 0;
+    //Initialize the bin heads: each is a one-block used block, whose free list
+    //is empty (points to itself)
+    for(b=0; b<VGMH2_NUMBINS; ++b){
+        VGMH2_NBLOCK(b) = b+1;
+        VGMH2_PBLOCK(b) = b ? b-1 : 0;
+        VGMH2_NFREE(b)  = b;
+        VGMH2_PFREE(b)  = b;
+    }
+    //Initialize end of heap, right after the bin heads
+    vgmh2_tail = VGMH2_NUMBINS;
+    vgmh2_binmap = 0;
+    vgmh2_numfreeblocks = 0;
+    vgmh2_numfragments = 0;
+    //Initialize used blocks counter
+    vgmh2_numusedblocks = VGMH2_NUMBINS + 1; //The bin heads and the tail
+    memset(&vgmh2_stats, 0, sizeof(vgmh2_stats_t));
+    vgmh2_stats.peak_used_blocks = vgmh2_numusedblocks;
+#ifdef VGMH2_CYCLES_MIOS32
+    MIOS32_CYCLES_Init(0);
+#endif
+}
+
+static void *vgmh2_do_malloc(size_t size){
+    if(size == 0) return NULL;
+    u16 blocksNeeded, cf;
+    u32 cycles;
+    u8 b;
+    blocksNeeded = vgmh2_blocks(size);
+    vTaskSuspendAll(); //Enter critical section
+
+    cycles = vgmh2_cycles();
+    cf = vgmh2_alloc_blocks(blocksNeeded);
+    cycles = vgmh2_cycles() - cycles;
+
+    ++vgmh2_stats.num_mallocs;
+    if(cycles > vgmh2_stats.malloc_cycles_max) vgmh2_stats.malloc_cycles_max = cycles;
+    for(b=0; b<VGMH2_TIMEHIST_BUCKETS-1 && cycles >= (64ul << b); ++b);
+    ++vgmh2_stats.malloc_time_hist[b];
+
+    if(!cf){
+        ++vgmh2_stats.num_fallbacks;
+        xTaskResumeAll(); //Leave critical section
+        return malloc(size); //Allocate in primary heap instead
     }
 
     vgmh2_numusedblocks += blocksNeeded; //Count the number of blocks used
+    vgmh2_count_used();
     xTaskResumeAll(); //Leave critical section
     return((void *)&VGMH2_DATA(cf)); //Return a pointer to the data section of the current block
 }
 
 // ----------------------------------------------------------------------------
 
-void *vgmh2_realloc(void *ptr, size_t size){
-    if(ptr == NULL) return vgmh2_malloc(size);
+static void vgmh2_do_free(void *ptr);
+
+static void *vgmh2_do_realloc(void *ptr, size_t size){
+    if(ptr == NULL) return vgmh2_do_malloc(size);
     if(size == 0){
-        vgmh2_free(ptr);
+        vgmh2_do_free(ptr);
         return NULL;
     }
     if(ptr < (void*)(VGMH2_HEAPSTART) || ptr >= (void*)(VGMH2_HEAPSTART + VGMH2_HEAPSIZE)){
         //The pointer is outside this heap, it must have been created with normal malloc
         return realloc(ptr, size);
     }
-    u16 blocksNeeded, curSizeBlocks, c, new_numusedblocks;
+    u16 blocksNeeded, curSizeBlocks, c, n;
     size_t curSizeBytes;
     vTaskSuspendAll(); //Enter critical section
+    ++vgmh2_stats.num_reallocs;
 
     blocksNeeded = vgmh2_blocks(size);
     c = (ptr-(void *)(VGMH2_HEAPSTART))/sizeof(vgmh2_block); //What block this pointer points to
     curSizeBlocks = (VGMH2_NBLOCK(c) - c); //Current size of region in blocks
     curSizeBytes  = (curSizeBlocks*8)-4; //Current size of region in bytes
-    new_numusedblocks = vgmh2_numusedblocks + blocksNeeded - curSizeBlocks; //Save the overall change in number of used blocks for if we succeed, because the malloc and free operations in here will mess up vgmh2_numusedblocks
 
     if(curSizeBlocks == blocksNeeded){
         //No change, or change by less than a block
         xTaskResumeAll(); //Leave critical section
         return(ptr);
     }
+    vgmh2_numusedblocks -= curSizeBlocks; //Whatever block we end up with is counted again below
 
     //Combine this block with any free space following it (this checks whether the next block is free)
     vgmh2_assimilate_up(c);
 
+    //If this is the last block before the end of the heap, just move the end
+    n = c + blocksNeeded;
+    if(VGMH2_NBLOCK(c) == vgmh2_tail && n > vgmh2_tail && n < VGMH2_NUMBLOCKS){
+        VGMH2_NBLOCK(n) = 0;
+        VGMH2_PBLOCK(n) = c;
+        VGMH2_NBLOCK(c) = n;
+        vgmh2_tail = n;
+    }
+
     //If the previous block is free, and the combined previous and current blocks
     //would be enough space, combine them and move the data down to the lower block
-    if((VGMH2_NBLOCK(VGMH2_PBLOCK(c)) & VGMH2_FREELIST_MASK) &&
+    if((VGMH2_NBLOCK(c) - c < blocksNeeded) &&
+            (VGMH2_NBLOCK(VGMH2_PBLOCK(c)) & VGMH2_FREELIST_MASK) &&
             (blocksNeeded <= (VGMH2_NBLOCK(c)-VGMH2_PBLOCK(c)))){
         vgmh2_disconnect_from_free_list(VGMH2_PBLOCK(c)); //Mark lower block as not free
         c = vgmh2_assimilate_down(c, 0); //Combine the blocks, don't mark lower block as free, and now point to the lower one
@@ -232,31 +360,34 @@ void *vgmh2_realloc(void *ptr, size_t size){
         //Make a new block in the upper (unused) portion; mark the lower one as used
         vgmh2_make_new_block(c, blocksNeeded, 0);
         //Free the new (upper) block
-        vgmh2_free((void *)&VGMH2_DATA(c+blocksNeeded));
+        vgmh2_free_blocks(c+blocksNeeded);
     }else{
         //We still don't have enough room
-        void *oldptr = ptr; //Save original pointer
-        ptr = vgmh2_malloc(size); //Malloc a new block that's actually big enough
-        if(ptr != NULL){
-            memcpy(ptr, oldptr, curSizeBytes); //Copy our data to it
+        n = vgmh2_alloc_blocks(blocksNeeded); //Allocate a new block that's actually big enough
+        if(n){
+            memcpy((void *)&VGMH2_DATA(n), ptr, curSizeBytes); //Copy our data to it
+            ptr = (void *)&VGMH2_DATA(n);
+        }else{
+            //Out of room in this heap, move it to the primary heap
+            ++vgmh2_stats.num_fallbacks;
+            void *newptr = malloc(size);
+            if(newptr != NULL){
+                memcpy(newptr, ptr, curSizeBytes);
+            }
+            vgmh2_free_blocks(c); //In both cases free the original block
+            xTaskResumeAll(); //Leave critical section
+            return(newptr); //Return newptr whether it's null or not
         }
-        vgmh2_free(oldptr); //In both cases free the original pointer
-        //Return ptr whether it's null or not
-    }
-
-    if(ptr != NULL){
-        //Realloc succeeded, store the new size (calculated above):
-        vgmh2_numusedblocks = new_numusedblocks;
-    }else{
-        //New malloc failed, so free already took away and un-counted the used
-        //memory; vgmh2_numusedblocks was only updated by free, and is now correct
+        vgmh2_free_blocks(c); //Free the original block
     }
 
+    vgmh2_numusedblocks += blocksNeeded;
+    vgmh2_count_used();
     xTaskResumeAll(); //Leave critical section
     return(ptr);
 }
 
-void vgmh2_free(void *ptr){
+static void vgmh2_do_free(void *ptr){
     if(ptr == NULL) return;
     if(ptr < (void*)(VGMH2_HEAPSTART) || ptr >= (void*)(VGMH2_HEAPSTART + VGMH2_HEAPSIZE)){
         //The pointer is outside this heap, it must have been created with normal malloc
@@ -265,24 +396,58 @@ void vgmh2_free(void *ptr){
     }
     u16 c;
     vTaskSuspendAll(); //Enter critical section
+    ++vgmh2_stats.num_frees;
     c = (ptr-(void *)(&(vgmh2_heap[0])))/sizeof(vgmh2_block); //What block this pointer points to
     vgmh2_numusedblocks -= (VGMH2_NBLOCK(c) - c); //Mark the size of this block as unused
+    vgmh2_free_blocks(c);
+    xTaskResumeAll(); //Leave critical section
+}
 
-    //Combine this block with the next if possible
-    vgmh2_assimilate_up(c);
+// ----------------------------------------------------------------------------
 
-    //If the previous block is free,
-    if(VGMH2_NBLOCK(VGMH2_PBLOCK(c)) & VGMH2_FREELIST_MASK){
-        //combine this with it, marking the lower block as free
-        c = vgmh2_assimilate_down(c, VGMH2_FREELIST_MASK);
-    }else{
-        //Add this block to the head of the free list
-        VGMH2_PFREE(VGMH2_NFREE(0)) = c; //Previous of the first free block points to current one
-        VGMH2_NFREE(c)              = VGMH2_NFREE(0); //Current-next points to originally first free
-        VGMH2_PFREE(c)              = 0; //Previous of current is the head
-        VGMH2_NFREE(0)              = c; //First free block (next of head) is current
-        VGMH2_NBLOCK(c)          |= VGMH2_FREELIST_MASK; //Mark current block as free
+void *vgmh2_malloc(size_t size){
+    void *result = vgmh2_do_malloc(size);
+    VGMH2_TRACE('m', NULL, result, size);
+    return result;
+}
+
+void *vgmh2_realloc(void *ptr, size_t size){
+    void *result = vgmh2_do_realloc(ptr, size);
+    VGMH2_TRACE('r', ptr, result, size);
+    return result;
+}
+
+void vgmh2_free(void *ptr){
+    vgmh2_do_free(ptr);
+    VGMH2_TRACE('f', ptr, NULL, 0);
+}
+
+// ----------------------------------------------------------------------------
+
+void vgmh2_getstats(vgmh2_stats_t* stats){
+    u16 c, size, largest = 0;
+    u8 bin;
+    vTaskSuspendAll(); //Enter critical section
+    *stats = vgmh2_stats;
+    stats->used_blocks    = vgmh2_numusedblocks;
+    stats->free_blocks    = vgmh2_numfreeblocks;
+    stats->free_fragments = vgmh2_numfragments;
+    stats->tail_blocks    = VGMH2_NUMBLOCKS - 1 - vgmh2_tail;
+    //The largest free block is in the highest non-empty bin
+    if(vgmh2_binmap){
+        bin = 31 - __builtin_clz(vgmh2_binmap);
+        for(c = VGMH2_NFREE(bin); c != bin; c = VGMH2_NFREE(c)){
+            size = (VGMH2_NBLOCK(c) & VGMH2_BLOCKNO_MASK) - c;
+            if(size > largest) largest = size;
+        }
     }
+    stats->largest_free = (stats->tail_blocks > largest) ? stats->tail_blocks : largest;
     xTaskResumeAll(); //Leave critical section
 }
 
+void vgmh2_resetstats(){
+    vTaskSuspendAll(); //Enter critical section
+    memset(&vgmh2_stats, 0, sizeof(vgmh2_stats_t));
+    vgmh2_stats.peak_used_blocks = vgmh2_numusedblocks;
+    xTaskResumeAll(); //Leave critical section
+}
@@ -31,6 +31,46 @@
 
 #define VGMH2_NUMBLOCKS (VGMH2_HEAPSIZE / 8)
 
+//Free blocks are kept in segregated lists by size: one list for each exact
+//size up to VGMH2_EXACTBINS blocks, then one per power of two above that
+#define VGMH2_EXACTBINS 15
+#define VGMH2_NUMBINS (VGMH2_EXACTBINS + 11)
+
+//Buckets of the allocation time histogram: bucket n counts allocations taking
+//less than (64 << n) CPU cycles, the last bucket counts everything slower
+#define VGMH2_TIMEHIST_BUCKETS 8
+
+//CPU cycle counter for the allocation time statistics
+#ifndef VGMH2_CYCLES
+#define VGMH2_CYCLES() MIOS32_CYCLES_Get()
+#define VGMH2_CYCLES_MIOS32
+#endif
+
+//Optional hook which records each heap operation, e.g. to capture an
+//allocation trace of a session for the replay harness in gnu_test/.
+//op is 'm' (malloc), 'r' (realloc) or 'f' (free), ptr the pointer passed in,
+//result the returned pointer. It's called outside of the critical section.
+//Example for mios32_config.h:
+//#define VGMH2_TRACE(op, ptr, result, size) DEBUG_MSG("vgmh2 %c %x %x %d", op, (u32)(ptr), (u32)(result), (u32)(size))
+#ifndef VGMH2_TRACE
+#define VGMH2_TRACE(op, ptr, result, size) do {} while(0)
+#endif
+
+typedef struct {
+    u32 num_mallocs;
+    u32 num_reallocs;
+    u32 num_frees;
+    u32 num_fallbacks; //Allocations which didn't fit and went to the main heap
+    u16 used_blocks;
+    u16 peak_used_blocks;
+    u16 free_blocks; //Blocks in the free lists, not counting the end of the heap
+    u16 free_fragments; //Number of separate free regions in the free lists
+    u16 tail_blocks; //Blocks available past the end of the heap
+    u16 largest_free; //Largest allocation (in blocks) which would currently succeed
+    u32 malloc_cycles_max;
+    u32 malloc_time_hist[VGMH2_TIMEHIST_BUCKETS];
+} vgmh2_stats_t;
+
 extern void vgmh2_init();
 
 extern void* vgmh2_malloc(size_t size);
@@ -39,4 +79,7 @@ extern void vgmh2_free(void* ptr);
 
 extern volatile u16 vgmh2_numusedblocks;
 
+extern void vgmh2_getstats(vgmh2_stats_t* stats);
+extern void vgmh2_resetstats();
+
 #endif /* _VGM_HEAP2_H */
@@ -45,9 +45,33 @@ u8 VGM_PerfMon_GetTaskCPU(u8 task){
 
 vgm_meminfo_t VGM_PerfMon_GetMemInfo(){
     vgm_meminfo_t ret;
+    vgmh2_stats_t st;
+    u32 freeblocks;
+    vgmh2_getstats(&st);
     ret.main_total = configTOTAL_HEAP_SIZE >> 3;
     ret.main_used = ret.main_total - (xPortGetFreeHeapSize() >> 3);
     ret.vgmh2_total = VGMH2_NUMBLOCKS;
-    ret.vgmh2_used = vgmh2_numusedblocks;
+    ret.vgmh2_used = st.used_blocks;
+    ret.vgmh2_largest = st.largest_free;
+    freeblocks = (u32)st.free_blocks + (u32)st.tail_blocks;
+    ret.vgmh2_frag = freeblocks ? (u8)(100 - ((u32)st.largest_free * 100 / freeblocks)) : 0;
     return ret;
 }
+
+void VGM_PerfMon_PrintHeapStats(){
+    vgmh2_stats_t st;
+    u8 b;
+    vgmh2_getstats(&st);
+    DBG("Heap2: %d/%d blocks used (peak %d), %d free in %d fragments, %d at end",
+            st.used_blocks, VGMH2_NUMBLOCKS, st.peak_used_blocks,
+            st.free_blocks, st.free_fragments, st.tail_blocks);
+    DBG("Heap2: largest free %d blocks, %d allocs, %d reallocs, %d frees, %d fell back to main heap",
+            st.largest_free, st.num_mallocs, st.num_reallocs, st.num_frees, st.num_fallbacks);
+    for(b=0; b<VGMH2_TIMEHIST_BUCKETS; ++b){
+        if(b < VGMH2_TIMEHIST_BUCKETS-1){
+            DBG("Heap2: alloc < %4d cycles: %d", 64 << b, st.malloc_time_hist[b]);
+        }else{
+            DBG("Heap2: alloc slower:       %d (max %d cycles)", st.malloc_time_hist[b], st.malloc_cycles_max);
+        }
+    }
+}
@@ -31,8 +31,11 @@ typedef struct {
     u16 main_used;
     u16 vgmh2_total;
     u16 vgmh2_used;
+    u16 vgmh2_largest;
+    u8 vgmh2_frag; //Percentage of free secondary heap not in the largest free block
 } vgm_meminfo_t;
 
 extern vgm_meminfo_t VGM_PerfMon_GetMemInfo();
+extern void VGM_PerfMon_PrintHeapStats();
 
 #endif /* _VGMPERFMON_H */
@@ -74,6 +74,13 @@ u16 VgmPlayer_WorkCallback(){
                     if(chip >= GENESIS_COUNT || subcmd > 4 || subcmd == 1){
                         VGM_Head_cmdNext(h, vgm_time);
                         wrotetochip = 1;
+                    }else if(VGMP_DROPREDUNDANTWRITES && (subcmd == 0
+                            ? Genesis_PSGWriteIsRedundant(chip, cmd.data)
+                            : Genesis_OPN2WriteIsRedundant(chip, (cmd.cmd & 0x01), cmd.addr, cmd.data))){
+                        //The chip already has this value, skip the write and
+                        //don't wait for the chip to be ready
+                        VGM_Head_cmdNext(h, vgm_time);
+                        wrotetochip = 1;
                     }else if(subcmd == 0){
                         //PSG write
                         u = TIM2->CNT - chipdata[chip].psg_lastwritetime;
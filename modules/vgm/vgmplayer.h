@@ -25,6 +25,12 @@
 #define VGMP_PSGBUSYDELAY 672
 #define VGMP_OPN2BUSYDELAY 2100 //1512 or 2016?
 
+// Skip chip writes which wouldn't change any register (see
+// Genesis_OPN2WriteIsRedundant), so they don't take up bus or busy time
+#ifndef VGMP_DROPREDUNDANTWRITES
+#define VGMP_DROPREDUNDANTWRITES 1
+#endif
+
 
 static inline u32 VGM_Player_GetHRTime() { return TIM2->CNT; }
 static inline u32 VGM_Player_GetVGMTime() { return TIM5->CNT; }
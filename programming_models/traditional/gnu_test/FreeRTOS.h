@@ -0,0 +1,19 @@
+// FreeRTOS emulation with POSIX threads, see midi_latency.c
+#ifndef _FREERTOS_H
+#define _FREERTOS_H
+
+typedef unsigned long portTickType;
+#define portCHAR      char
+#define portBASE_TYPE long
+
+#define pdFALSE 0
+#define pdTRUE  1
+#define portTICK_RATE_MS 1
+#define tskIDLE_PRIORITY 0
+#define configMINIMAL_STACK_SIZE 128
+#define configAPPLICATION_ALLOCATED_HEAP 0
+
+// the emulated low priority IRQ returns before the task runs
+#define portEND_SWITCHING_ISR(xSwitchRequired) do { (void)(xSwitchRequired); } while(0)
+
+#endif /* _FREERTOS_H */
@@ -0,0 +1,374 @@
+// Host test of the MIDI receive latency of the traditional programming model
+//
+// ../main.c, mios32_midi.c and mios32_uart_midi.c are compiled on the host
+// with MIOS32_FAMILY_STM32F4xx, and FreeRTOS is emulated with POSIX threads:
+// a tick thread increments the tick count each mS, and the tasks which are
+// created with xTaskCreate() are started as threads (only TASK_MIDI_Hooks,
+// the other hooks aren't used by this test). main() of ../main.c is renamed
+// to traditional_main().
+//
+// A thread plays the UART receive interrupt: MIDI events are sent with pseudo
+// random gaps, and the bytes of an event are 320 uS apart like on a 31250
+// baud wire. Each byte is forwarded to MIOS32_MIDI_SendByteToRxCallback() and
+// put into the Rx buffer while "interrupts" are disabled (a mutex which is
+// also taken by MIOS32_IRQ_Disable()). A pended NVIC IRQ is executed after
+// the interrupt, as the low priority IRQ would do on the target.
+//
+// The latency is measured from the last byte of an event until the event
+// arrives at APP_MIDI_NotifyPackage(). The makefile builds this test twice:
+// with the Rx notification of TASK_MIDI_Hooks (default), and with the
+// previous 1 mS polling loop (MIOS32_DONT_USE_MIDI_RX_NOTIFY). Both report
+// a latency histogram, and the wake-ups of the MIDI task without and with
+// incoming events. The host scheduler adds its own wake-up latency of some
+// uS, so the absolute numbers are higher than on the target.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <mios32.h>
+#include <FreeRTOS.h>
+#include <task.h>
+#include <semphr.h>
+#include "app.h"
+
+typedef unsigned long long u64;
+
+#define NUM_EVENTS     3000
+#define IDLE_MS        1000
+#define BYTE_TIME_US   320 // 31250 baud
+#define MIN_GAP_US     200
+#define MAX_GAP_US     3000
+
+extern int traditional_main(void);
+extern void vApplicationTickHook(void);
+extern void DCMI_IRQHandler(void);
+
+static pthread_mutex_t irq_mutex;    // locked while "interrupts" are disabled
+static pthread_mutex_t kernel_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t kernel_cond = PTHREAD_COND_INITIALIZER;
+static volatile portTickType tick_count;
+static volatile int running = 1;
+
+static pdTASK_CODE midi_task;
+static volatile u32 task_wakeups;
+static volatile u8 irq_pending;
+
+// UART0 Rx buffer
+static u8 rx_buffer[256];
+static u32 rx_head, rx_tail;
+
+// events
+static u64 event_time_ns[NUM_EVENTS];
+static volatile u32 events_received;
+static u32 latency_us[NUM_EVENTS];
+static u32 lfsr;
+static int errors;
+
+
+static u64 now_ns(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (u64)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static void sleep_until_ns(u64 t)
+{
+  struct timespec ts;
+  ts.tv_sec = t / 1000000000ull;
+  ts.tv_nsec = t % 1000000000ull;
+  while( clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) != 0 );
+}
+
+static u32 random_number(void)
+{
+  lfsr ^= lfsr << 13;
+  lfsr ^= lfsr >> 17;
+  lfsr ^= lfsr << 5;
+  return lfsr;
+}
+
+
+// ------- FreeRTOS emulation -------
+struct test_semaphore {
+  u8 given;
+};
+
+xSemaphoreHandle TEST_SemaphoreCreateBinary(void)
+{
+  xSemaphoreHandle s = calloc(1, sizeof(struct test_semaphore));
+  s->given = 1; // like vSemaphoreCreateBinary()
+  return s;
+}
+
+portBASE_TYPE xSemaphoreTake(xSemaphoreHandle xSemaphore, portTickType xBlockTime)
+{
+  portBASE_TYPE taken = pdFALSE;
+
+  pthread_mutex_lock(&kernel_mutex);
+  portTickType timeout = tick_count + xBlockTime;
+  while( !xSemaphore->given && (long)(timeout - tick_count) > 0 )
+    pthread_cond_wait(&kernel_cond, &kernel_mutex);
+  if( xSemaphore->given ) {
+    xSemaphore->given = 0;
+    taken = pdTRUE;
+  }
+  ++task_wakeups;
+  pthread_mutex_unlock(&kernel_mutex);
+
+  return taken;
+}
+
+portBASE_TYPE xSemaphoreGiveFromISR(xSemaphoreHandle xSemaphore, portBASE_TYPE *pxHigherPriorityTaskWoken)
+{
+  pthread_mutex_lock(&kernel_mutex);
+  xSemaphore->given = 1;
+  pthread_cond_broadcast(&kernel_cond);
+  pthread_mutex_unlock(&kernel_mutex);
+
+  *pxHigherPriorityTaskWoken = pdTRUE;
+  return pdTRUE;
+}
+
+portTickType xTaskGetTickCount(void)
+{
+  return tick_count;
+}
+
+void vTaskDelayUntil(portTickType *pxPreviousWakeTime, portTickType xTimeIncrement)
+{
+  pthread_mutex_lock(&kernel_mutex);
+  *pxPreviousWakeTime += xTimeIncrement;
+  while( (long)(*pxPreviousWakeTime - tick_count) > 0 )
+    pthread_cond_wait(&kernel_cond, &kernel_mutex);
+  ++task_wakeups;
+  pthread_mutex_unlock(&kernel_mutex);
+}
+
+portBASE_TYPE xTaskCreate(pdTASK_CODE pvTaskCode, const char *pcName, unsigned short usStackDepth,
+			  void *pvParameters, unsigned portBASE_TYPE uxPriority, void *pvCreatedTask)
+{
+  if( strcmp(pcName, "MIDI_Hooks") == 0 )
+    midi_task = pvTaskCode;
+  return pdTRUE;
+}
+
+static void *task_thread(void *arg)
+{
+  midi_task(NULL);
+  return NULL;
+}
+
+static void *tick_thread(void *arg)
+{
+  u64 t = now_ns();
+
+  while( running ) {
+    t += 1000000;
+    sleep_until_ns(t);
+
+    pthread_mutex_lock(&kernel_mutex);
+    ++tick_count;
+    pthread_cond_broadcast(&kernel_cond);
+    pthread_mutex_unlock(&kernel_mutex);
+
+    vApplicationTickHook();
+  }
+
+  return NULL;
+}
+
+void vTaskStartScheduler(void)
+{
+  pthread_t thread;
+
+  pthread_create(&thread, NULL, tick_thread, NULL);
+  pthread_create(&thread, NULL, task_thread, NULL);
+  // on the target this function doesn't return, here the test continues in main()
+}
+
+
+// ------- MIOS32 stubs -------
+s32 MIOS32_IRQ_Disable(void) { pthread_mutex_lock(&irq_mutex); return 0; }
+s32 MIOS32_IRQ_Enable(void) { pthread_mutex_unlock(&irq_mutex); return 0; }
+s32 MIOS32_IRQ_Install(u8 IRQn, u8 priority) { return 0; }
+
+void NVIC_SetPendingIRQ(IRQn_Type IRQn) { irq_pending = 1; }
+void NVIC_ClearPendingIRQ(IRQn_Type IRQn) { irq_pending = 0; }
+
+s32 MIOS32_SYS_Reset(void) { return 0; }
+u32 MIOS32_SYS_ChipIDGet(void) { return 0; }
+u32 MIOS32_SYS_FlashSizeGet(void) { return 0; }
+u32 MIOS32_SYS_RAMSizeGet(void) { return 0; }
+s32 MIOS32_SYS_SerialNumberGet(char *str) { str[0] = 0; return 0; }
+s32 MIOS32_USB_MIDI_Periodic_mS(void) { return 0; }
+s32 MIOS32_BOARD_LED_Set(u32 leds, u32 value) { return 0; }
+u32 MIOS32_BOARD_LED_Get(void) { return 0; }
+void __libc_init_array(void) {}
+
+s32 MIOS32_UART_Init(u32 mode) { return 0; }
+s32 MIOS32_UART_IsAssignedToMIDI(u8 uart) { return uart == 0; }
+s32 MIOS32_UART_TxBufferPutMore(u8 uart, u8 *buffer, u16 len) { return 0; }
+
+s32 MIOS32_UART_RxBufferGet(u8 uart)
+{
+  s32 b = -1;
+
+  MIOS32_IRQ_Disable();
+  if( uart == 0 && rx_tail != rx_head )
+    b = rx_buffer[rx_tail++ % sizeof(rx_buffer)];
+  MIOS32_IRQ_Enable();
+
+  return b;
+}
+
+// like the UART Rx interrupt of mios32_uart.c
+static void uart_rx_irq(u8 b)
+{
+  MIOS32_IRQ_Disable();
+  if( MIOS32_MIDI_SendByteToRxCallback(UART0, b) == 0 )
+    rx_buffer[rx_head++ % sizeof(rx_buffer)] = b;
+  MIOS32_IRQ_Enable();
+
+#if !defined(MIOS32_DONT_USE_MIDI_RX_NOTIFY)
+  // the low priority IRQ is executed when the UART interrupt returns
+  if( irq_pending )
+    DCMI_IRQHandler();
+#endif
+}
+
+
+// ------- application -------
+void APP_Init(void)
+{
+}
+
+void APP_Background(void)
+{
+}
+
+void APP_Tick(void)
+{
+}
+
+void APP_MIDI_Tick(void)
+{
+}
+
+void APP_MIDI_NotifyPackage(mios32_midi_port_t port, mios32_midi_package_t midi_package)
+{
+  u64 t = now_ns();
+  u32 event = events_received;
+
+  // the event number is coded into note and velocity
+  if( event >= NUM_EVENTS || port != UART0 || midi_package.event != NoteOn ||
+      midi_package.note != (event & 0x7f) || midi_package.velocity != ((event >> 7) & 0x3f) + 1 ) {
+    if( errors < 10 )
+      printf("ERROR: unexpected package %08x at event #%u\n", midi_package.ALL, event);
+    ++errors;
+    return;
+  }
+
+  latency_us[event] = (t - event_time_ns[event]) / 1000;
+  events_received = event + 1;
+}
+
+
+// ------- test -------
+static int compare_u32(const void *a, const void *b)
+{
+  u32 x = *(const u32 *)a, y = *(const u32 *)b;
+  return (x > y) - (x < y);
+}
+
+int main(int argc, char *argv[])
+{
+  static const u32 histogram_limit_us[] = { 50, 100, 200, 500, 1000, 2000, 0xffffffff };
+  u32 histogram[sizeof(histogram_limit_us)/sizeof(u32)];
+  pthread_mutexattr_t attr;
+  u32 wakeups_idle, wakeups_busy;
+  u64 t, t_busy;
+  u32 event, i;
+
+  pthread_mutexattr_init(&attr);
+  pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+  pthread_mutex_init(&irq_mutex, &attr);
+
+  traditional_main();
+
+  // idle ports
+  task_wakeups = 0;
+  sleep_until_ns(now_ns() + IDLE_MS * 1000000ull);
+  wakeups_idle = task_wakeups;
+
+  // events with pseudo random gaps
+  lfsr = 2463534242u;
+  task_wakeups = 0;
+  t = t_busy = now_ns();
+  for(event=0; event<NUM_EVENTS; ++event) {
+    u8 bytes[3] = { 0x90, event & 0x7f, ((event >> 7) & 0x3f) + 1 };
+
+    t += (MIN_GAP_US + random_number() % (MAX_GAP_US - MIN_GAP_US)) * 1000ull;
+    for(i=0; i<3; ++i) {
+      sleep_until_ns(t);
+      if( i == 2 )
+	event_time_ns[event] = now_ns();
+      uart_rx_irq(bytes[i]);
+      if( i < 2 )
+	t += BYTE_TIME_US * 1000ull;
+    }
+  }
+  sleep_until_ns(now_ns() + 10000000ull); // last events
+  t_busy = now_ns() - t_busy;
+  wakeups_busy = task_wakeups;
+  running = 0;
+
+  if( events_received != NUM_EVENTS ) {
+    printf("ERROR: only %u of %d events received\n", events_received, NUM_EVENTS);
+    ++errors;
+  }
+
+  memset(histogram, 0, sizeof(histogram));
+  for(event=0; event<events_received; ++event) {
+    for(i=0; latency_us[event] >= histogram_limit_us[i]; ++i);
+    ++histogram[i];
+  }
+
+  printf("%s: %u events, gaps %d..%d uS\n",
+#if defined(MIOS32_DONT_USE_MIDI_RX_NOTIFY)
+	 "1 mS polling",
+#else
+	 "Rx notification",
+#endif
+	 events_received, MIN_GAP_US, MAX_GAP_US);
+
+  printf("latency histogram:\n");
+  for(i=0; i<sizeof(histogram_limit_us)/sizeof(u32); ++i) {
+    if( histogram_limit_us[i] == 0xffffffff )
+      printf("   >= %4u uS: %5u\n", histogram_limit_us[i-1], histogram[i]);
+    else
+      printf("    < %4u uS: %5u\n", histogram_limit_us[i], histogram[i]);
+  }
+
+  if( events_received ) {
+    u64 sum = 0;
+    for(event=0; event<events_received; ++event)
+      sum += latency_us[event];
+    qsort(latency_us, events_received, sizeof(u32), compare_u32);
+    printf("latency: average %u uS, median %u uS, 99%% %u uS, max %u uS\n",
+	   (u32)(sum / events_received), latency_us[events_received/2],
+	   latency_us[(events_received*99)/100], latency_us[events_received-1]);
+  }
+
+  printf("MIDI task wake-ups: %u/s idle, %.0f/s with events\n",
+	 wakeups_idle * 1000 / IDLE_MS, wakeups_busy / (t_busy / 1e9));
+
+  if( errors ) {
+    printf("%d errors\n", errors);
+    return 1;
+  }
+
+  return 0;
+}
@@ -0,0 +1,29 @@
+// configuration of the host test, see midi_latency.c
+// only the MIDI task of main.c and a single UART MIDI port are used
+#ifndef _MIOS32_CONFIG_H
+#define _MIOS32_CONFIG_H
+
+#define MIOS32_DONT_USE_SYS
+#define MIOS32_DONT_USE_DELAY
+#define MIOS32_DONT_USE_TIMESTAMP
+#define MIOS32_DONT_USE_BOARD
+#define MIOS32_DONT_USE_SPI
+#define MIOS32_DONT_USE_SPI_MIDI
+#define MIOS32_DONT_USE_SRIO
+#define MIOS32_DONT_USE_DIN
+#define MIOS32_DONT_USE_DOUT
+#define MIOS32_DONT_USE_ENC
+#define MIOS32_DONT_USE_MF
+#define MIOS32_DONT_USE_AIN
+#define MIOS32_DONT_USE_IIC
+#define MIOS32_DONT_USE_IIC_BS
+#define MIOS32_DONT_USE_IIC_MIDI
+#define MIOS32_DONT_USE_USB
+#define MIOS32_DONT_USE_OSC
+#define MIOS32_DONT_USE_COM
+#define MIOS32_DONT_USE_LCD
+
+#define MIOS32_BOARD_STR  "host"
+#define MIOS32_FAMILY_STR "host"
+
+#endif /* _MIOS32_CONFIG_H */
@@ -0,0 +1 @@
+// FreeRTOS emulation with POSIX threads, see midi_latency.c
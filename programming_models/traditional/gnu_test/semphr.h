@@ -0,0 +1,13 @@
+// FreeRTOS emulation with POSIX threads, see midi_latency.c
+#ifndef _SEMPHR_H
+#define _SEMPHR_H
+
+typedef struct test_semaphore *xSemaphoreHandle;
+
+extern xSemaphoreHandle TEST_SemaphoreCreateBinary(void);
+#define vSemaphoreCreateBinary(xSemaphore) do { (xSemaphore) = TEST_SemaphoreCreateBinary(); } while(0)
+
+extern portBASE_TYPE xSemaphoreTake(xSemaphoreHandle xSemaphore, portTickType xBlockTime);
+extern portBASE_TYPE xSemaphoreGiveFromISR(xSemaphoreHandle xSemaphore, portBASE_TYPE *pxHigherPriorityTaskWoken);
+
+#endif /* _SEMPHR_H */
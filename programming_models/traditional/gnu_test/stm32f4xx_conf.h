@@ -0,0 +1,15 @@
+// replaces the STM32F4 drivers for the host test, see midi_latency.c
+// the NVIC functions of the MIDI Rx notification are provided by the test
+#ifndef _STM32F4XX_CONF_H
+#define _STM32F4XX_CONF_H
+
+#include <mios32_datatypes.h>
+
+typedef enum {
+  DCMI_IRQn = 78,
+} IRQn_Type;
+
+extern void NVIC_SetPendingIRQ(IRQn_Type IRQn);
+extern void NVIC_ClearPendingIRQ(IRQn_Type IRQn);
+
+#endif /* _STM32F4XX_CONF_H */
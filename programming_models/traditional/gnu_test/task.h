@@ -0,0 +1,14 @@
+// FreeRTOS emulation with POSIX threads, see midi_latency.c
+#ifndef _TASK_H
+#define _TASK_H
+
+typedef void (*pdTASK_CODE)(void *pvParameters);
+typedef void *xTaskHandle;
+
+extern portBASE_TYPE xTaskCreate(pdTASK_CODE pvTaskCode, const char *pcName, unsigned short usStackDepth,
+				 void *pvParameters, unsigned portBASE_TYPE uxPriority, void *pvCreatedTask);
+extern void vTaskStartScheduler(void);
+extern portTickType xTaskGetTickCount(void);
+extern void vTaskDelayUntil(portTickType *pxPreviousWakeTime, portTickType xTimeIncrement);
+
+#endif /* _TASK_H */
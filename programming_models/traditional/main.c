@@ -25,6 +25,7 @@
 #include <FreeRTOS.h>
 #include <task.h>
 #include <queue.h>
+#include <semphr.h>
 
 
 /////////////////////////////////////////////////////////////////////////////
@@ -48,11 +49,49 @@ extern void __libc_init_array(void);  /* calls CTORS of static objects */
 #endif
 
 
+/////////////////////////////////////////////////////////////////////////////
+// MIDI Rx notification
+// The UART/USB receive interrupts are running above
+// configMAX_SYSCALL_INTERRUPT_PRIORITY, therefore they can't give a semaphore
+// directly. Instead they pend an otherwise unused IRQ channel which is
+// installed with MIOS32_IRQ_PRIO_LOW, and its handler wakes up the MIDI task.
+// Can be disabled with MIOS32_DONT_USE_MIDI_RX_NOTIFY in mios32_config.h
+// (the MIDI task will poll each mS like before)
+/////////////////////////////////////////////////////////////////////////////
+
+#if !defined(MIOS32_DONT_USE_MIDI) && !defined(MIOS32_DONT_USE_MIDI_RX_NOTIFY)
+# if defined(MIOS32_FAMILY_STM32F4xx)
+#  define MIDI_RX_NOTIFY_IRQn       DCMI_IRQn
+#  define MIDI_RX_NOTIFY_IRQHandler DCMI_IRQHandler
+# elif defined(MIOS32_FAMILY_STM32F10x)
+#  define MIDI_RX_NOTIFY_IRQn       RTCAlarm_IRQn
+#  define MIDI_RX_NOTIFY_IRQHandler RTCAlarm_IRQHandler
+# elif defined(MIOS32_FAMILY_LPC17xx)
+#  define MIDI_RX_NOTIFY_IRQn       QEI_IRQn
+#  define MIDI_RX_NOTIFY_IRQHandler QEI_IRQHandler
+# else
+#  define MIOS32_DONT_USE_MIDI_RX_NOTIFY
+# endif
+#endif
+
+
 /////////////////////////////////////////////////////////////////////////////
 // Local prototypes
 /////////////////////////////////////////////////////////////////////////////
 static void TASK_Hooks(void *pvParameters);
 static void TASK_MIDI_Hooks(void *pvParameters);
+#if !defined(MIOS32_DONT_USE_MIDI) && !defined(MIOS32_DONT_USE_MIDI_RX_NOTIFY)
+static void MIDI_RxNotify(void);
+#endif
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Local variables
+/////////////////////////////////////////////////////////////////////////////
+
+#if !defined(MIOS32_DONT_USE_MIDI) && !defined(MIOS32_DONT_USE_MIDI_RX_NOTIFY)
+static xSemaphoreHandle xMIDIRxSemaphore;
+#endif
 
 
 /////////////////////////////////////////////////////////////////////////////
@@ -176,6 +215,12 @@ int main(void)
   // start the task which calls the application hooks
   xTaskCreate(TASK_Hooks, "Hooks", (MIOS32_TASK_HOOKS_STACK_SIZE)/4, NULL, PRIORITY_TASK_HOOKS, NULL);
 #if !defined(MIOS32_DONT_USE_MIDI)
+# if !defined(MIOS32_DONT_USE_MIDI_RX_NOTIFY)
+  // wake up the MIDI task whenever a new package has been received
+  vSemaphoreCreateBinary(xMIDIRxSemaphore);
+  MIOS32_IRQ_Install(MIDI_RX_NOTIFY_IRQn, MIOS32_IRQ_PRIO_LOW);
+  MIOS32_MIDI_RxNotifyCallback_Init(MIDI_RxNotify);
+# endif
   xTaskCreate(TASK_MIDI_Hooks, "MIDI_Hooks", (MIOS32_TASK_MIDI_HOOKS_STACK_SIZE)/4, NULL, PRIORITY_TASK_HOOKS, NULL);
 #endif
 
@@ -234,6 +279,63 @@ void vApplicationIdleHook(void)
 // MIDI events if a hook in TASK_Hooks() blocks)
 /////////////////////////////////////////////////////////////////////////////
 #if !defined(MIOS32_DONT_USE_MIDI)
+#if !defined(MIOS32_DONT_USE_MIDI_RX_NOTIFY)
+// called from the MIDI receive interrupts (high priority)
+static void MIDI_RxNotify(void)
+{
+  NVIC_SetPendingIRQ(MIDI_RX_NOTIFY_IRQn);
+}
+
+// low priority IRQ which is allowed to access the FreeRTOS API
+void MIDI_RX_NOTIFY_IRQHandler(void)
+{
+  portBASE_TYPE xHigherPriorityTaskWoken = pdFALSE;
+
+  NVIC_ClearPendingIRQ(MIDI_RX_NOTIFY_IRQn);
+  xSemaphoreGiveFromISR(xMIDIRxSemaphore, &xHigherPriorityTaskWoken);
+  portEND_SWITCHING_ISR(xHigherPriorityTaskWoken);
+}
+
+static void TASK_MIDI_Hooks(void *pvParameters)
+{
+  portTickType xLastExecutionTime;
+
+  // Initialise the xLastExecutionTime variable on task entry
+  xLastExecutionTime = xTaskGetTickCount();
+
+  while( 1 ) {
+    // wait for incoming MIDI data, but at least each mS for the periodic handlers
+    xSemaphoreTake(xMIDIRxSemaphore, 1 / portTICK_RATE_MS);
+
+    // skip delay gap if we had to wait for more than 5 ticks to avoid
+    // unnecessary repeats until xLastExecutionTime reached xTaskGetTickCount() again
+    portTickType xCurrentTickCount = xTaskGetTickCount();
+    if( (portTickType)(xCurrentTickCount - xLastExecutionTime) > 5 )
+      xLastExecutionTime = xCurrentTickCount - 1;
+
+    if( xLastExecutionTime == xCurrentTickCount ) {
+      // woken up by incoming MIDI data within the same tick:
+      // check for incoming MIDI packages and call hook
+      MIOS32_MIDI_Receive_Handler(APP_MIDI_NotifyPackage);
+    } else {
+      // periodic handlers once for each elapsed tick (like vTaskDelayUntil() would do)
+      while( xLastExecutionTime != xCurrentTickCount ) {
+        ++xLastExecutionTime;
+
+        // handle timeout/expire counters and USB packages
+        MIOS32_MIDI_Periodic_mS();
+
+        // check for incoming MIDI packages and call hook
+        MIOS32_MIDI_Receive_Handler(APP_MIDI_NotifyPackage);
+
+        // optional application specific hook (called once per tick)
+        // helps to save memory (re-use the TASK_Hooks for other purposes...)
+        APP_MIDI_Tick();
+      }
+    }
+  }
+}
+#else
 static void TASK_MIDI_Hooks(void *pvParameters)
 {
   portTickType xLastExecutionTime;
@@ -262,6 +364,7 @@ static void TASK_MIDI_Hooks(void *pvParameters)
   }
 }
 #endif
+#endif
 
 
 /////////////////////////////////////////////////////////////////////////////
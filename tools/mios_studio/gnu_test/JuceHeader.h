@@ -0,0 +1,20 @@
+/*
+    Replaces ../JuceLibraryCode/JuceHeader.h for the SysEx Librarian test:
+    only the modules which are needed by the worker and src/includes.h,
+    so that the test can be built without the GUI and audio modules
+    (e.g. with the JUCE 3.0 modules of midibox_sid_v3/juce)
+*/
+
+#pragma once
+
+#include "AppConfig.h"
+
+#include <juce_core/juce_core.h>
+#include <juce_events/juce_events.h>
+#include <juce_data_structures/juce_data_structures.h>
+
+#if ! DONT_SET_USING_JUCE_NAMESPACE
+ // If your code uses a lot of JUCE classes, then this will obviously save you
+ // a lot of typing, but can be disabled by setting DONT_SET_USING_JUCE_NAMESPACE.
+ using namespace juce;
+#endif
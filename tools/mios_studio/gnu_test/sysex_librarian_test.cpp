@@ -0,0 +1,520 @@
+/* -*- mode:C++; tab-width:4; c-basic-offset:4; indent-tabs-mode:nil -*- */
+// $Id$
+/*
+ * SysEx Librarian Test
+ *
+ * Parses a large synthetic .syx library with different numbers of jobs, and
+ * transfers banks to and from a loopback stand-in of a MIDIbox SID V2.
+ * The loopback device models the MIDI line speed, the time which is needed
+ * to store a patch and the receive buffer of the device. It runs SPEEDUP
+ * times faster than a real device, throughputs are reported for real time.
+ *
+ * Usage: sysex_librarian_test [<number of patches in library>]
+ *
+ * ==========================================================================
+ *
+ *  Copyright (C) 2026 agent (agent@local)
+ *  Licensed for personal non-commercial use only.
+ *  All other rights reserved.
+ *
+ * ==========================================================================
+ */
+
+#include "../src/SysexLibrarianWorker.h"
+
+#include <stdio.h>
+#include <set>
+#include <vector>
+
+
+// the loopback device is faster than real time by this factor
+#define SPEEDUP 50
+
+// MIDI: 31250 baud, 10 bits per byte
+#define MIDI_BYTES_PER_SECOND 3125
+
+// MIDIbox SID V2 Patch
+#define SPEC 0
+#define DEVICE_ID 0
+
+
+//==============================================================================
+//==============================================================================
+//==============================================================================
+class LoopbackDevice
+    : public Thread
+    , public SysexLibrarianMidiSender
+{
+public:
+    LoopbackDevice(SysexPatchDb *_sysexPatchDb)
+        : Thread("LoopbackDevice")
+        , sysexPatchDb(_sysexPatchDb)
+        , worker(0)
+        , rxBufferSize(64)
+        , writeTime(60.0)
+        , readTime(5.0)
+        , slowWriteTime(0)
+        , slowWriteInterval(0)
+        , sendAcknowledge(true)
+        , numDropped(0)
+        , numWrites(0)
+        , lineFree(0)
+        , returnLineFree(0)
+        , deviceFree(0)
+    {
+        const int numPatches = sysexPatchDb->getNumBanks(SPEC) * sysexPatchDb->getNumPatchesPerBank(SPEC);
+        for(int i=0; i<numPatches; ++i)
+            memory.add(new Array<uint8>());
+
+        startThread(8);
+    }
+
+    ~LoopbackDevice()
+    {
+        stopThread(2000);
+    }
+
+    //==============================================================================
+    void reset(const int& _rxBufferSize, const bool& _sendAcknowledge, const int& _slowWriteInterval)
+    {
+        const ScopedLock sl(lock);
+        rxBufferSize = _rxBufferSize;
+        sendAcknowledge = _sendAcknowledge;
+        slowWriteInterval = _slowWriteInterval;
+        numDropped = 0;
+        numWrites = 0;
+    }
+
+    int getNumPendingResponses()
+    {
+        const ScopedLock sl(lock);
+        return responses.size();
+    }
+
+    Array<uint8>* getPatch(const int& bank, const int& patch)
+    {
+        return memory[bank * sysexPatchDb->getNumPatchesPerBank(SPEC) + patch];
+    }
+
+    //==============================================================================
+    // MIDI In of the device, called from the worker thread
+    void sendSysex(const Array<uint8>& data)
+    {
+        const ScopedLock sl(lock);
+        const uint8 *msg = (const uint8 *)data.begin();
+        const uint32 size = data.size();
+        const double now = Time::getMillisecondCounterHiRes();
+
+        // the message is received byte by byte over the MIDI line
+        double rxStart = jmax(now, lineFree);
+        double rxEnd = rxStart + lineTime(size);
+        lineFree = rxEnd;
+
+        // while the device is busy, incoming bytes are buffered - a message gets lost if they don't fit
+        if( jmin(deviceFree, rxEnd) - rxStart > lineTime(rxBufferSize) ) {
+            ++numDropped;
+            return;
+        }
+
+        double processingTime = 0;
+        Array<uint8> response;
+
+        if( sysexPatchDb->isValidWritePatch(SPEC, msg, size, DEVICE_ID, 0, -1, -1) ) {
+            if( size != sysexPatchDb->getPatchSize(SPEC) || !sysexPatchDb->hasValidChecksum(SPEC, msg, size) ) {
+                response = createAcknowledge(0x0e);
+            } else {
+                int bank = sysexPatchDb->getBankOfDump(SPEC, msg, size);
+                int patch = sysexPatchDb->getPatchOfDump(SPEC, msg, size);
+                *getPatch(bank, patch) = sysexPatchDb->getPayload(SPEC, msg, size);
+                processingTime = writeTime / SPEEDUP;
+                if( slowWriteInterval && (++numWrites % slowWriteInterval) == 0 )
+                    processingTime = slowWriteTime / SPEEDUP; // e.g. flash sector erase
+                if( sendAcknowledge )
+                    response = createAcknowledge(0x0f);
+            }
+        } else if( sysexPatchDb->isValidReadPatch(SPEC, msg, size, DEVICE_ID, 0, -1, -1) ) {
+            int bank = sysexPatchDb->getBankOfDump(SPEC, msg, size);
+            int patch = sysexPatchDb->getPatchOfDump(SPEC, msg, size);
+            Array<uint8>* p = getPatch(bank, patch);
+            processingTime = readTime / SPEEDUP;
+            if( p->size() )
+                response = sysexPatchDb->createWritePatch(SPEC, DEVICE_ID, 0, bank, patch, &p->getReference(0), p->size());
+            else
+                response = createAcknowledge(0x0e);
+        } else {
+            return;
+        }
+
+        deviceFree = jmax(rxEnd, deviceFree) + processingTime;
+
+        if( response.size() ) {
+            // the device continues once the response has been sent
+            double txStart = jmax(deviceFree, returnLineFree);
+            returnLineFree = txStart + lineTime(response.size());
+            deviceFree = returnLineFree;
+
+            ScheduledResponseT scheduled;
+            scheduled.time = returnLineFree;
+            scheduled.data = response;
+            responses.add(scheduled);
+            notify();
+        }
+    }
+
+    //==============================================================================
+    // MIDI Out of the device
+    void run()
+    {
+        while( !threadShouldExit() ) {
+            Array<uint8> response;
+            double remaining = 10;
+
+            {
+                const ScopedLock sl(lock);
+                if( responses.size() ) {
+                    remaining = responses.getReference(0).time - Time::getMillisecondCounterHiRes();
+                    if( remaining <= 0 ) {
+                        response = responses.getReference(0).data;
+                        responses.remove(0);
+                    }
+                }
+            }
+
+            if( response.size() ) {
+                // the lock is released, since the worker might send the next message meanwhile
+                if( worker )
+                    worker->handleIncomingSysex(&response.getReference(0), response.size());
+            } else {
+                wait(jmax(1, (int)remaining));
+            }
+        }
+    }
+
+    //==============================================================================
+    SysexPatchDb *sysexPatchDb;
+    SysexLibrarianWorker *worker;
+
+    int rxBufferSize;
+    double writeTime; // mS
+    double readTime;  // mS
+    double slowWriteTime; // mS, each slowWriteInterval'th write
+    int slowWriteInterval;
+    bool sendAcknowledge;
+    int numDropped;
+    int numWrites;
+
+protected:
+    double lineTime(const int& numBytes)
+    {
+        return ((double)numBytes * 1000.0) / (MIDI_BYTES_PER_SECOND * SPEEDUP);
+    }
+
+    Array<uint8> createAcknowledge(const uint8& cmd)
+    {
+        Array<uint8> data(sysexPatchDb->createHeader(SPEC, DEVICE_ID));
+        data.add(cmd);
+        data.add(0x00);
+        data.add(0xf7);
+        return data;
+    }
+
+    typedef struct ScheduledResponseT {
+        double time;
+        Array<uint8> data;
+    } ScheduledResponseT;
+
+    CriticalSection lock;
+    Array<ScheduledResponseT> responses;
+    OwnedArray<Array<uint8> > memory;
+
+    double lineFree;
+    double returnLineFree;
+    double deviceFree;
+};
+
+
+//==============================================================================
+//==============================================================================
+//==============================================================================
+static int numFailures = 0;
+
+static void check(const bool& condition, const char* description)
+{
+    if( !condition ) {
+        printf("FAILED: %s\n", description);
+        ++numFailures;
+    }
+}
+
+
+//==============================================================================
+static Array<uint8> createPayload(SysexPatchDb& sysexPatchDb, Random& random, const int& num)
+{
+    const int payloadSize = sysexPatchDb.getPatchSize(SPEC) - 12; // without header, device, cmd, type, bank, patch, checksum and F7
+    Array<uint8> payload;
+    for(int i=0; i<payloadSize; ++i)
+        payload.add(random.nextInt(16)); // nibbles
+    sysexPatchDb.replacePatchNameInPayload(SPEC, payload, String(T("Patch ")) + String(num));
+    return payload;
+}
+
+// creates a library with duplicates, invalid checksums and foreign SysEx messages
+static Array<uint8> createLibrary(SysexPatchDb& sysexPatchDb, const int& numPatches,
+                                  Array<int>& offsets, int& numDuplicates, int& numChecksumErrors)
+{
+    Random random(4711);
+    Array<uint8> syx;
+    Array<Array<uint8> > payloads;
+    std::set<std::vector<uint8> > uniquePayloads;
+
+    numDuplicates = 0;
+    numChecksumErrors = 0;
+
+    for(int i=0; i<numPatches; ++i) {
+        if( (i % 3) == 0 ) {
+            // foreign SysEx message
+            int length = random.nextInt(64);
+            syx.add(0xf0);
+            syx.add(0x43);
+            for(int j=0; j<length; ++j)
+                syx.add(random.nextInt(128));
+            syx.add(0xf7);
+        }
+
+        if( (i % 97) == 50 ) {
+            // truncated dump
+            Array<uint8> header(sysexPatchDb.createHeader(SPEC, DEVICE_ID));
+            syx.addArray((const uint8 *)header.getRawDataPointer(), header.size());
+            syx.add(0xf7);
+        }
+
+        Array<uint8> payload;
+        if( i >= 5 && (i % 8) == 0 )
+            payload = payloads[i - 5];
+        else
+            payload = createPayload(sysexPatchDb, random, i);
+        payloads.add(payload);
+
+        std::vector<uint8> key(payload.getRawDataPointer(), payload.getRawDataPointer() + payload.size());
+        if( !uniquePayloads.insert(key).second )
+            ++numDuplicates;
+
+        Array<uint8> dump(sysexPatchDb.createWritePatch(SPEC, DEVICE_ID, 0, (i / 128) % 8, i % 128,
+                                                        payload.getRawDataPointer(), payload.size()));
+        if( (i % 101) == 100 ) {
+            // invalid checksum
+            dump.set(sysexPatchDb.getPatchSize(SPEC)-2, dump[sysexPatchDb.getPatchSize(SPEC)-2] ^ 0x01);
+            ++numChecksumErrors;
+        }
+
+        offsets.add(syx.size());
+        syx.addArray((const uint8 *)dump.getRawDataPointer(), dump.size());
+    }
+
+    return syx;
+}
+
+// the sequential scan which was used by the librarian before
+static Array<int> scanSequential(SysexPatchDb& sysexPatchDb, const Array<uint8>& syx)
+{
+    const uint8 *buffer = (const uint8 *)syx.begin();
+    const int size = syx.size();
+    const int patchSize = sysexPatchDb.getPatchSize(SPEC);
+    Array<int> offsets;
+
+    int pos = 0;
+    while( (pos+patchSize) <= size ) {
+        if( sysexPatchDb.isValidWritePatch(SPEC, &buffer[pos], patchSize, -1, -1, -1, -1) ||
+            sysexPatchDb.isValidWriteBuffer(SPEC, &buffer[pos], patchSize, -1, -1, -1, -1) ) {
+            offsets.add(pos);
+            pos += patchSize;
+        } else {
+            // search for next F0
+            while( ((++pos+patchSize) <= size) && (buffer[pos] != 0xf0) );
+        }
+    }
+
+    return offsets;
+}
+
+
+//==============================================================================
+static void testParse(SysexPatchDb& sysexPatchDb, SysexLibrarianWorker& worker, const int& numPatches)
+{
+    Array<int> expectedOffsets;
+    int expectedDuplicates, expectedChecksumErrors;
+    Array<uint8> syx(createLibrary(sysexPatchDb, numPatches, expectedOffsets, expectedDuplicates, expectedChecksumErrors));
+    Array<int> sequentialOffsets(scanSequential(sysexPatchDb, syx));
+
+    check(sequentialOffsets == expectedOffsets, "sequential scan finds all dumps");
+
+    printf("Library: %d patches, %d duplicates, %d checksum errors, %.2f MB\n",
+           numPatches, expectedDuplicates, expectedChecksumErrors, syx.size() / (1024.0*1024.0));
+
+    Array<int64> referenceHashes;
+    const int jobConfig[] = { 1, 2, 4, 8, 0 };
+    for(int config=0; config<5; ++config) {
+        const int numJobs = jobConfig[config];
+
+        // best of 3
+        float bestTime = 0;
+        for(int run=0; run<3; ++run) {
+            worker.parse(SPEC, (const uint8 *)syx.getRawDataPointer(), syx.size(), numJobs);
+            if( run == 0 || worker.timeParse < bestTime )
+                bestTime = worker.timeParse;
+        }
+
+        printf("  parse with %2d job(s)%-7s %8.2f mS, %7.1f MB/s\n",
+               numJobs ? numJobs : SystemStats::getNumCpus(), numJobs ? "" : " (CPUs)",
+               bestTime * 1000.0, (syx.size() / (1024.0*1024.0)) / bestTime);
+
+        Array<int> offsets;
+        Array<int64> hashes;
+        for(int i=0; i<worker.library.size(); ++i) {
+            offsets.add(worker.library.getReference(i).offset);
+            hashes.add(worker.library.getReference(i).hash);
+        }
+
+        check(offsets == sequentialOffsets, "parallel parse matches sequential scan");
+        check(worker.numDuplicates == expectedDuplicates, "number of duplicates");
+        check(worker.numChecksumErrors == expectedChecksumErrors, "number of checksum errors");
+        if( config == 0 )
+            referenceHashes = hashes;
+        else
+            check(hashes == referenceHashes, "hashes independent from number of jobs");
+    }
+
+    if( worker.library.size() > 1 ) {
+        check(worker.library.getReference(1).name == String(T("Patch 1")), "patch name indexed");
+        check(worker.library.getReference(1).bank == 0 && worker.library.getReference(1).patch == 1, "bank/patch indexed");
+    }
+}
+
+
+//==============================================================================
+static void runTransfer(SysexPatchDb& sysexPatchDb, SysexLibrarianWorker& worker, LoopbackDevice& device,
+                        const char* description, const bool& receive, const int& numPatches,
+                        const int& pipelineDepth, const int& rxBufferSize, const bool& sendAcknowledge,
+                        const int& slowWriteInterval = 0)
+{
+    Random random(42);
+    const int bank = 1;
+    Array<SysexLibrarianWorker::TransferItemT> items;
+
+    for(int patch=0; patch<numPatches; ++patch) {
+        SysexLibrarianWorker::TransferItemT item;
+        item.patch = patch;
+        if( receive )
+            *device.getPatch(bank, patch) = createPayload(sysexPatchDb, random, patch);
+        else
+            item.payload = createPayload(sysexPatchDb, random, patch);
+        items.add(item);
+    }
+
+    device.reset(rxBufferSize, sendAcknowledge, slowWriteInterval);
+    worker.readPipelineDepth = pipelineDepth;
+    worker.writePipelineDepth = pipelineDepth;
+
+    if( receive )
+        worker.startReceive(SPEC, DEVICE_ID, bank, -1, items);
+    else
+        worker.startSend(SPEC, DEVICE_ID, bank, -1, items);
+
+    Array<SysexLibrarianWorker::TransferItemT> receivedItems;
+    SysexLibrarianWorker::TransferItemT item;
+    do {
+        Thread::sleep(1);
+        while( worker.getReceivedPatch(item) )
+            receivedItems.add(item);
+    } while( worker.busy() );
+    while( worker.getReceivedPatch(item) )
+        receivedItems.add(item);
+
+    // all responses have to be assigned, late responses would be taken for the next transfer
+    check(device.getNumPendingResponses() == 0, "no responses after the transfer");
+
+    String errorMessage(worker.finish());
+    check(errorMessage.isEmpty(), description);
+    if( !errorMessage.isEmpty() )
+        printf("  %s\n", errorMessage.toRawUTF8());
+
+    // verify the transfered patches
+    bool patchesOk = true;
+    if( receive ) {
+        patchesOk = receivedItems.size() == numPatches;
+        for(int i=0; patchesOk && i<receivedItems.size(); ++i)
+            patchesOk = receivedItems.getReference(i).payload == *device.getPatch(bank, receivedItems.getReference(i).patch);
+    } else {
+        for(int i=0; patchesOk && i<items.size(); ++i)
+            patchesOk = items.getReference(i).payload == *device.getPatch(bank, items.getReference(i).patch);
+    }
+    check(patchesOk, description);
+
+    // late acknowledges of slow writes shouldn't cause retries
+    if( slowWriteInterval )
+        check(worker.numRetries == 0, "no retries on late acknowledges");
+
+    float realTime = worker.timeTransfer * SPEEDUP;
+    printf("  %-44s %6.2f s, %5.2f patches/s, %6.0f bytes/s, %d retries, %d dropped%s\n",
+           description, realTime, numPatches / realTime, (worker.bytesSent + worker.bytesReceived) / realTime,
+           worker.numRetries, device.numDropped, worker.usedFallbackDelay ? ", fallback delay" : "");
+}
+
+static void testTransfer(SysexPatchDb& sysexPatchDb)
+{
+    LoopbackDevice device(&sysexPatchDb);
+    SysexLibrarianWorker worker(&sysexPatchDb, &device);
+    device.worker = &worker;
+
+    const int numPatches = sysexPatchDb.getNumPatchesPerBank(SPEC);
+    const int writeDelay = sysexPatchDb.getDelayBetweenWrites(SPEC);
+    const int readDelay = sysexPatchDb.getDelayBetweenReads(SPEC);
+
+    // the delays of the spec are scaled to the speed of the loopback device
+    worker.responseTimeout = readDelay / SPEEDUP;
+    worker.fallbackDelay = writeDelay / SPEEDUP;
+
+    // slow writes are acknowledged after the response timeout, but before a second timeout
+    device.slowWriteTime = readDelay * 1.3;
+
+    printf("Bank transfers (%d patches of %d bytes, %d baud):\n", numPatches, sysexPatchDb.getPatchSize(SPEC), MIDI_BYTES_PER_SECOND*10);
+    printf("  %-44s %6.2f s\n", "paced by delay of patch spec (reference)", (numPatches * writeDelay) / 1000.0);
+
+    runTransfer(sysexPatchDb, worker, device, "send, acknowledged", false, numPatches, 1, 64, true);
+    runTransfer(sysexPatchDb, worker, device, "send, pipeline depth 2, 64 byte buffer", false, numPatches, 2, 64, true);
+    runTransfer(sysexPatchDb, worker, device, "send, pipeline depth 2, 2k buffer", false, numPatches, 2, 2048, true);
+    runTransfer(sysexPatchDb, worker, device, "send, each 16th acknowledge late", false, numPatches, 1, 64, true, 16);
+    runTransfer(sysexPatchDb, worker, device, "send, no acknowledge (16 patches)", false, 16, 1, 64, false);
+    runTransfer(sysexPatchDb, worker, device, "receive, pipeline depth 1", true, numPatches, 1, 64, true);
+    runTransfer(sysexPatchDb, worker, device, "receive, pipeline depth 2", true, numPatches, 2, 64, true);
+    runTransfer(sysexPatchDb, worker, device, "receive, pipeline depth 4", true, numPatches, 4, 64, true);
+
+    // no responses after the worker has been deleted
+    device.stopThread(2000);
+}
+
+
+//==============================================================================
+int main(int argc, char* argv[])
+{
+    int numPatches = 8192;
+    if( argc > 1 )
+        numPatches = atoi(argv[1]);
+
+    SysexPatchDb sysexPatchDb;
+
+    {
+        SysexLibrarianWorker worker(&sysexPatchDb, 0);
+        testParse(sysexPatchDb, worker, numPatches);
+    }
+
+    testTransfer(sysexPatchDb);
+
+    if( numFailures ) {
+        printf("%d check(s) FAILED!\n", numFailures);
+        return 1;
+    }
+
+    printf("All checks passed.\n");
+    return 0;
+}
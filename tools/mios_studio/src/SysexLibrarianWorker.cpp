@@ -0,0 +1,634 @@
+/* -*- mode:C++; tab-width:4; c-basic-offset:4; indent-tabs-mode:nil -*- */
+// $Id$
+/*
+ * SysEx Librarian Worker
+ *
+ * ==========================================================================
+ *
+ *  Copyright (C) 2026 agent (agent@local)
+ *  Licensed for personal non-commercial use only.
+ *  All other rights reserved.
+ *
+ * ==========================================================================
+ */
+
+#include "SysexLibrarianWorker.h"
+
+
+//==============================================================================
+//==============================================================================
+//==============================================================================
+// Checks the F0 positions in [begin, end[ for dumps, the dumps may exceed the
+// section. A scan over the whole data continues behind each found dump,
+// therefore candidates which overlap a previous dump are sorted out when the
+// results of all jobs are merged.
+class SysexLibrarianParseJob
+    : public ThreadPoolJob
+{
+public:
+    SysexLibrarianParseJob(SysexPatchDb *_sysexPatchDb, const unsigned& _spec, const uint8 *_data, const int& _size, const int& _begin, const int& _end)
+        : ThreadPoolJob("SysexLibrarianParseJob")
+        , sysexPatchDb(_sysexPatchDb)
+        , spec(_spec)
+        , data(_data)
+        , size(_size)
+        , begin(_begin)
+        , end(_end)
+    {
+    }
+
+    JobStatus runJob()
+    {
+        const int patchSize = sysexPatchDb->getPatchSize(spec);
+
+        for(int pos=begin; pos<end && (pos+patchSize) <= size; ++pos) {
+            if( data[pos] != 0xf0 )
+                continue;
+
+            const uint8 *patchPtr = &data[pos];
+            if( sysexPatchDb->isValidWritePatch(spec, patchPtr, patchSize, -1, -1, -1, -1) ||
+                sysexPatchDb->isValidWriteBuffer(spec, patchPtr, patchSize, -1, -1, -1, -1) ) {
+                SysexLibrarianWorker::PatchEntryT entry;
+                entry.payload = sysexPatchDb->getPayload(spec, patchPtr, patchSize);
+                entry.name = sysexPatchDb->getPatchNameFromPayload(spec, entry.payload);
+                entry.hash = SysexLibrarianWorker::calcPayloadHash(entry.payload);
+                entry.duplicateOf = -1;
+                entry.offset = pos;
+                entry.bank = sysexPatchDb->getBankOfDump(spec, patchPtr, patchSize);
+                entry.patch = sysexPatchDb->getPatchOfDump(spec, patchPtr, patchSize);
+                entry.checksumOk = sysexPatchDb->hasValidChecksum(spec, patchPtr, patchSize);
+                entries.add(entry);
+
+                if( shouldExit() )
+                    break;
+            }
+        }
+
+        return jobHasFinished;
+    }
+
+    Array<SysexLibrarianWorker::PatchEntryT> entries;
+
+protected:
+    SysexPatchDb *sysexPatchDb;
+    unsigned spec;
+    const uint8 *data;
+    int size;
+    int begin;
+    int end;
+};
+
+
+//==============================================================================
+//==============================================================================
+//==============================================================================
+SysexLibrarianWorker::SysexLibrarianWorker(SysexPatchDb *_sysexPatchDb, SysexLibrarianMidiSender *_midiSender)
+    : numDuplicates(0)
+    , numChecksumErrors(0)
+    , timeParse(0.0)
+    , readPipelineDepth(SYSEX_LIBRARIAN_READ_PIPELINE_DEPTH)
+    , writePipelineDepth(SYSEX_LIBRARIAN_WRITE_PIPELINE_DEPTH)
+    , responseTimeout(0)
+    , fallbackDelay(0)
+    , maxRetries(SYSEX_LIBRARIAN_MAX_RETRIES)
+    , numRetries(0)
+    , bytesSent(0)
+    , bytesReceived(0)
+    , usedFallbackDelay(false)
+    , timeTransfer(0.0)
+    , sysexPatchDb(_sysexPatchDb)
+    , midiSender(_midiSender)
+    , workerThread(0)
+    , numDone(0)
+    , numItems(0)
+    , currentPatch(-1)
+{
+}
+
+SysexLibrarianWorker::~SysexLibrarianWorker()
+{
+    finish();
+}
+
+
+//==============================================================================
+bool SysexLibrarianWorker::busy(void)
+{
+    return workerThread && workerThread->isThreadRunning();
+}
+
+
+//==============================================================================
+bool SysexLibrarianWorker::startParse(const unsigned& spec, const File& syxFile)
+{
+    if( busy() )
+        return false;
+
+    finish();
+
+    library.clear();
+    numDuplicates = 0;
+    numChecksumErrors = 0;
+    numDone = 0;
+    numItems = 0;
+
+    workerThread = new SysexLibrarianWorkerThread(this, spec, SysexLibrarianWorkerThread::JOB_PARSE);
+    workerThread->syxFile = syxFile;
+    workerThread->startThread(8); // start thread with pretty high priority (1..10)
+
+    return true;
+}
+
+
+//==============================================================================
+bool SysexLibrarianWorker::startSend(const unsigned& spec, const uint8& deviceId, const uint8& bank, const int& bufferNum, const Array<TransferItemT>& items)
+{
+    if( busy() )
+        return false;
+
+    finish();
+
+    numRetries = 0;
+    bytesSent = 0;
+    bytesReceived = 0;
+    usedFallbackDelay = false;
+    numDone = 0;
+    numItems = items.size();
+    currentPatch = -1;
+
+    workerThread = new SysexLibrarianWorkerThread(this, spec, SysexLibrarianWorkerThread::JOB_SEND);
+    workerThread->deviceId = deviceId;
+    workerThread->bank = bank;
+    workerThread->bufferNum = bufferNum;
+    workerThread->items = items;
+    workerThread->startThread(8); // start thread with pretty high priority (1..10)
+
+    return true;
+}
+
+bool SysexLibrarianWorker::startReceive(const unsigned& spec, const uint8& deviceId, const uint8& bank, const int& bufferNum, const Array<TransferItemT>& items)
+{
+    if( busy() )
+        return false;
+
+    finish();
+
+    {
+        const ScopedLock sl(receivedPatchesLock); // lock will be released at end of this scope
+        receivedPatches.clear();
+    }
+
+    numRetries = 0;
+    bytesSent = 0;
+    bytesReceived = 0;
+    usedFallbackDelay = false;
+    numDone = 0;
+    numItems = items.size();
+    currentPatch = -1;
+
+    workerThread = new SysexLibrarianWorkerThread(this, spec, SysexLibrarianWorkerThread::JOB_RECEIVE);
+    workerThread->deviceId = deviceId;
+    workerThread->bank = bank;
+    workerThread->bufferNum = bufferNum;
+    workerThread->items = items;
+    workerThread->startThread(8); // start thread with pretty high priority (1..10)
+
+    return true;
+}
+
+
+//==============================================================================
+// returns error message or String::empty if thread passed
+// must always be called before startParse(), startSend() or startReceive() is called again
+String SysexLibrarianWorker::finish(void)
+{
+    const ScopedLock sl(workerThreadLock); // lock will be released at end of function
+
+    if( workerThread ) {
+        String errorStatusMessage = workerThread->errorStatusMessage;
+        deleteAndZero(workerThread); // stops the thread if it is still running
+        return errorStatusMessage;
+    }
+
+    return String::empty;
+}
+
+
+//==============================================================================
+int SysexLibrarianWorker::parse(const unsigned& spec, const uint8 *data, const int& size, int numJobs)
+{
+    double startTime = Time::getMillisecondCounterHiRes();
+
+    library.clear();
+    numDuplicates = 0;
+    numChecksumErrors = 0;
+
+    if( numJobs <= 0 )
+        numJobs = SystemStats::getNumCpus();
+    if( numJobs > size / SYSEX_LIBRARIAN_MIN_PARSE_JOB_SIZE )
+        numJobs = size / SYSEX_LIBRARIAN_MIN_PARSE_JOB_SIZE;
+    if( numJobs < 1 )
+        numJobs = 1;
+
+    OwnedArray<SysexLibrarianParseJob> jobs;
+    const int sectionSize = (size + numJobs - 1) / numJobs;
+    for(int begin=0; begin<size; begin+=sectionSize)
+        jobs.add(new SysexLibrarianParseJob(sysexPatchDb, spec, data, size, begin, jmin(begin+sectionSize, size)));
+
+    if( jobs.size() == 1 ) {
+        jobs[0]->runJob();
+    } else if( jobs.size() > 1 ) {
+        ThreadPool pool(jobs.size());
+        for(int i=0; i<jobs.size(); ++i)
+            pool.addJob(jobs[i], false);
+        for(int i=0; i<jobs.size(); ++i)
+            pool.waitForJobToFinish(jobs[i], -1);
+    }
+
+    // merge the results in the order of the data
+    const int patchSize = sysexPatchDb->getPatchSize(spec);
+    HashMap<int64, int> firstEntryOfHash;
+    int resumePos = 0;
+    for(int i=0; i<jobs.size(); ++i) {
+        Array<PatchEntryT>& entries = jobs[i]->entries;
+
+        for(int j=0; j<entries.size(); ++j) {
+            PatchEntryT& entry = entries.getReference(j);
+
+            // continue behind the previous dump
+            if( entry.offset < resumePos )
+                continue;
+            resumePos = entry.offset + patchSize;
+
+            if( !firstEntryOfHash.contains(entry.hash) ) {
+                firstEntryOfHash.set(entry.hash, library.size());
+            } else {
+                int firstEntry = firstEntryOfHash[entry.hash];
+                if( library.getReference(firstEntry).payload == entry.payload ) {
+                    entry.duplicateOf = firstEntry;
+                    ++numDuplicates;
+                }
+            }
+
+            if( !entry.checksumOk )
+                ++numChecksumErrors;
+
+            library.add(entry);
+        }
+    }
+
+    timeParse = (float)((Time::getMillisecondCounterHiRes() - startTime) / 1000.0);
+
+    return library.size();
+}
+
+
+//==============================================================================
+int64 SysexLibrarianWorker::calcPayloadHash(const Array<uint8>& payload)
+{
+    uint64 hash = 0xcbf29ce484222325ULL;
+
+    for(int i=0; i<payload.size(); ++i) {
+        hash ^= payload.getUnchecked(i);
+        hash *= 0x00000100000001b3ULL;
+    }
+
+    return (int64)hash;
+}
+
+
+//==============================================================================
+double SysexLibrarianWorker::getProgress(void)
+{
+    return numItems ? ((double)numDone / (double)numItems) : 0.0;
+}
+
+int SysexLibrarianWorker::getCurrentPatch(void)
+{
+    return currentPatch;
+}
+
+bool SysexLibrarianWorker::getReceivedPatch(TransferItemT& item)
+{
+    const ScopedLock sl(receivedPatchesLock); // lock will be released at end of function
+
+    if( !receivedPatches.size() )
+        return false;
+
+    item = receivedPatches.getReference(0);
+    receivedPatches.remove(0);
+
+    return true;
+}
+
+
+//==============================================================================
+void SysexLibrarianWorker::handleIncomingSysex(const uint8 *data, const uint32& size)
+{
+    const ScopedLock sl(workerThreadLock); // lock will be released at end of function
+
+    if( workerThread && workerThread->isThreadRunning() )
+        workerThread->handleIncomingSysex(data, size);
+}
+
+
+//==============================================================================
+//==============================================================================
+//==============================================================================
+SysexLibrarianWorkerThread::SysexLibrarianWorkerThread(SysexLibrarianWorker *_worker, const unsigned& _spec, const int& _job)
+    : Thread("SysexLibrarianWorkerThread")
+    , worker(_worker)
+    , sysexPatchDb(_worker->sysexPatchDb)
+    , spec(_spec)
+    , job(_job)
+    , deviceId(0)
+    , bank(0)
+    , bufferNum(-1)
+{
+    // thread will be started by SysexLibrarianWorker once the job has been set up
+}
+
+
+SysexLibrarianWorkerThread::~SysexLibrarianWorkerThread()
+{
+    stopThread(2000); // give it a chance for 2 seconds
+}
+
+
+//==============================================================================
+void SysexLibrarianWorkerThread::run()
+{
+    if( job == JOB_PARSE ) {
+        runParse();
+    } else {
+        double startTime = Time::getMillisecondCounterHiRes();
+        runTransfer();
+        worker->timeTransfer = (float)((Time::getMillisecondCounterHiRes() - startTime) / 1000.0);
+    }
+}
+
+
+//==============================================================================
+void SysexLibrarianWorkerThread::runParse(void)
+{
+    MemoryBlock syxData;
+
+    if( !syxFile.loadFileAsData(syxData) ) {
+        errorStatusMessage = String(T("cannot be read completely!"));
+        return;
+    }
+
+    worker->parse(spec, (const uint8 *)syxData.getData(), (int)syxData.getSize(), 0);
+}
+
+
+//==============================================================================
+void SysexLibrarianWorkerThread::runTransfer(void)
+{
+    const bool receiveDump = job == JOB_RECEIVE;
+
+    // the device acknowledges each write, or sends the dump on a read request.
+    // Without acknowledge, writes are paced by the delay of the patch spec
+    bool useFallbackDelay = !receiveDump && !sysexPatchDb->hasAcknowledge(spec);
+
+    int pipelineDepth = receiveDump ? worker->readPipelineDepth : worker->writePipelineDepth;
+    pipelineDepth = jlimit(1, SYSEX_LIBRARIAN_MAX_PIPELINE_DEPTH, pipelineDepth);
+
+    int timeout = worker->responseTimeout;
+    if( timeout <= 0 )
+        timeout = receiveDump ? sysexPatchDb->getDelayBetweenReads(spec) : sysexPatchDb->getDelayBetweenWrites(spec);
+
+    int fallbackDelay = worker->fallbackDelay;
+    if( fallbackDelay <= 0 )
+        fallbackDelay = sysexPatchDb->getDelayBetweenWrites(spec);
+
+    Array<int> pendingItems; // sent, but not responded yet (in send order)
+    Array<int> retryItems;
+    int nextItem = 0;
+    bool gotResponse = false;
+    bool waitForLateResponses = false;
+    double lastEventTime = Time::getMillisecondCounterHiRes();
+
+    while( worker->numDone < items.size() ) {
+        if( threadShouldExit() )
+            return;
+
+        if( useFallbackDelay ) {
+            sendItem(nextItem++);
+            ++worker->numDone;
+
+            if( worker->numDone < items.size() ) {
+                double sendTime = Time::getMillisecondCounterHiRes();
+                int remaining;
+                while( !threadShouldExit() &&
+                       (remaining=(int)(sendTime + fallbackDelay - Time::getMillisecondCounterHiRes())) > 0 )
+                    wait(remaining);
+            }
+            continue;
+        }
+
+        // fill the pipeline
+        while( !waitForLateResponses && pendingItems.size() < pipelineDepth && (retryItems.size() || nextItem < items.size()) ) {
+            if( !pendingItems.size() )
+                lastEventTime = Time::getMillisecondCounterHiRes(); // timeout starts with the first pending item
+
+            int item = nextItem;
+            if( retryItems.size() ) {
+                item = retryItems[0];
+                retryItems.remove(0);
+            } else {
+                ++nextItem;
+            }
+            sendItem(item);
+            pendingItems.add(item);
+        }
+
+        // take over the responses
+        Array<ResponseT> newResponses;
+        {
+            const ScopedLock sl(responsesLock); // lock will be released at end of this scope
+            newResponses.swapWith(responses);
+        }
+
+        for(int i=0; i<newResponses.size(); ++i) {
+            ResponseT& response = newResponses.getReference(i);
+
+            if( response.errorAcknowledge ) {
+                errorStatusMessage = String(T("Got Error response!\nCheck:\n- if a valid patch has been uploaded\n- error code in MIDI IN monitor"));
+                return;
+            }
+
+            // acknowledges don't contain the patch number - they are received in the order of the writes.
+            // Dumps are assigned by patch number, dumps of patches which have been requested again are ignored
+            int pendingIx = -1;
+            if( !receiveDump || bufferNum >= 0 || response.patch < 0 ) {
+                if( pendingItems.size() )
+                    pendingIx = 0;
+            } else {
+                for(int j=0; j<pendingItems.size(); ++j) {
+                    if( items.getReference(pendingItems[j]).patch == response.patch ) {
+                        pendingIx = j;
+                        break;
+                    }
+                }
+            }
+
+            if( pendingIx < 0 )
+                continue;
+
+            if( receiveDump ) {
+                if( !response.checksumOk ) {
+                    errorStatusMessage = String(T("Detected checksum error!\nCheck:\n- MIDI In/Out connections\n- your MIDI interface"));
+                    return;
+                }
+
+                SysexLibrarianWorker::TransferItemT receivedItem;
+                receivedItem.patch = items.getReference(pendingItems[pendingIx]).patch;
+                receivedItem.payload = response.payload;
+
+                const ScopedLock sl(worker->receivedPatchesLock); // lock will be released at end of this scope
+                worker->receivedPatches.add(receivedItem);
+            }
+
+            pendingItems.remove(pendingIx);
+            ++worker->numDone;
+
+            gotResponse = true;
+            waitForLateResponses = false;
+            lastEventTime = Time::getMillisecondCounterHiRes();
+        }
+
+        if( newResponses.size() || !pendingItems.size() )
+            continue; // next items can be sent
+
+        int remaining = (int)(lastEventTime + timeout - Time::getMillisecondCounterHiRes());
+        if( remaining > 0 ) {
+            wait(remaining); // will be notified by handleIncomingSysex()
+            continue;
+        }
+
+        // timeout
+        if( !receiveDump && !gotResponse ) {
+            // no acknowledge at all: device doesn't send them (e.g. older firmware, or MIDI IN not connected)
+            // the pending items have been sent, continue with the delay of the patch spec
+            worker->usedFallbackDelay = true;
+            useFallbackDelay = true;
+            worker->numDone += pendingItems.size();
+            pendingItems.clear();
+            continue;
+        }
+
+        if( !waitForLateResponses ) {
+            // the device could be only slow: wait for late responses before the pending items are sent again,
+            // otherwise the acknowledges of the lost writes would be assigned to the retries
+            waitForLateResponses = true;
+            lastEventTime = Time::getMillisecondCounterHiRes();
+            continue;
+        }
+        waitForLateResponses = false;
+
+        if( ++worker->numRetries > worker->maxRetries ) {
+            if( receiveDump )
+                errorStatusMessage = String(T("No response from device.\nCheck:\n- MIDI In/Out connections\n- Device ID\n- that MIDIbox firmware has been uploaded"));
+            else
+                errorStatusMessage = String(T("No acknowledge from device.\nCheck:\n- MIDI In/Out connections\n- Device ID\n- that MIDIbox firmware has been uploaded"));
+            return;
+        }
+
+        // the pending items got lost (e.g. the device couldn't buffer them), send them again without pipelining
+        retryItems.addArray(pendingItems);
+        pendingItems.clear();
+        pipelineDepth = 1;
+    }
+}
+
+
+//==============================================================================
+void SysexLibrarianWorkerThread::sendItem(const int& item)
+{
+    SysexLibrarianWorker::TransferItemT& transferItem = items.getReference(item);
+    const bool receiveDump = job == JOB_RECEIVE;
+    Array<uint8> data;
+
+    worker->currentPatch = transferItem.patch;
+
+    if( bufferNum >= 0 ) {
+        uint8 bufferNumInCmd = (uint8)bufferNum;
+        Array<uint8> selectBuffer = sysexPatchDb->createSelectBuffer(spec, deviceId, (uint8)bufferNum);
+        if( selectBuffer.size() ) {
+            sendSysex(selectBuffer);
+            bufferNumInCmd = 0; // don't transfer offset in this case
+        }
+
+        if( receiveDump ) {
+            data = sysexPatchDb->createReadBuffer(spec, deviceId, bufferNumInCmd, bank, (uint8)transferItem.patch);
+        } else {
+            data = sysexPatchDb->createWriteBuffer(spec, deviceId, bufferNumInCmd, bank, (uint8)transferItem.patch,
+                                                   &transferItem.payload.getReference(0), transferItem.payload.size());
+        }
+    } else {
+        if( receiveDump ) {
+            data = sysexPatchDb->createReadPatch(spec, deviceId, 0, bank, (uint8)transferItem.patch);
+        } else {
+            data = sysexPatchDb->createWritePatch(spec, deviceId, 0, bank, (uint8)transferItem.patch,
+                                                  &transferItem.payload.getReference(0), transferItem.payload.size());
+        }
+    }
+
+    sendSysex(data);
+}
+
+void SysexLibrarianWorkerThread::sendSysex(const Array<uint8>& data)
+{
+    worker->bytesSent += data.size();
+    worker->midiSender->sendSysex(data);
+}
+
+
+//==============================================================================
+void SysexLibrarianWorkerThread::handleIncomingSysex(const uint8 *data, const uint32& size)
+{
+    ResponseT response;
+    response.errorAcknowledge = false;
+    response.checksumOk = true;
+    response.patch = -1;
+
+    if( job == JOB_RECEIVE ) {
+        bool validDump;
+
+        if( bufferNum >= 0 ) {
+            int bufferNumInDump = bufferNum;
+            if( sysexPatchDb->createSelectBuffer(spec, deviceId, (uint8)bufferNum).size() )
+                bufferNumInDump = 0; // offset not transfered in this case
+
+            validDump = sysexPatchDb->isValidWriteBuffer(spec, data, size, deviceId, bufferNumInDump, -1, -1);
+        } else {
+            validDump = sysexPatchDb->isValidWritePatch(spec, data, size, deviceId, 0, -1, -1);
+            response.patch = sysexPatchDb->getPatchOfDump(spec, data, size);
+        }
+
+        if( !validDump )
+            return;
+
+        if( size != sysexPatchDb->getPatchSize(spec) || !sysexPatchDb->hasValidChecksum(spec, data, size) )
+            response.checksumOk = false;
+        else
+            response.payload = sysexPatchDb->getPayload(spec, data, size);
+    } else if( job == JOB_SEND && sysexPatchDb->hasAcknowledge(spec) ) {
+        if( sysexPatchDb->isValidErrorAcknowledge(spec, data, size, deviceId) )
+            response.errorAcknowledge = true;
+        else if( !sysexPatchDb->isValidAcknowledge(spec, data, size, deviceId) )
+            return;
+    } else {
+        return;
+    }
+
+    worker->bytesReceived += size;
+
+    {
+        const ScopedLock sl(responsesLock); // lock will be released at end of this scope
+        responses.add(response);
+    }
+
+    notify(); // wakeup run() thread
+}
@@ -0,0 +1,208 @@
+/* -*- mode:C++; tab-width:4; c-basic-offset:4; indent-tabs-mode:nil -*- */
+// $Id$
+/*
+ * SysEx Librarian Worker
+ *
+ * Parses and indexes .syx libraries with parallel jobs, and runs bank
+ * transfers paced by the responses of the device outside of the GUI thread.
+ *
+ * ==========================================================================
+ *
+ *  Copyright (C) 2026 agent (agent@local)
+ *  Licensed for personal non-commercial use only.
+ *  All other rights reserved.
+ *
+ * ==========================================================================
+ */
+
+#ifndef _SYSEX_LIBRARIAN_WORKER_H
+#define _SYSEX_LIBRARIAN_WORKER_H
+
+#include "includes.h"
+#include "SysexPatchDb.h"
+
+
+// number of read requests which are sent before the first dump has been received
+#define SYSEX_LIBRARIAN_READ_PIPELINE_DEPTH  2
+
+// number of patches which are sent before the first acknowledge has been received
+// (MIOS8 based devices can't buffer a dump while they are writing into the BankStick)
+#define SYSEX_LIBRARIAN_WRITE_PIPELINE_DEPTH 1
+
+#define SYSEX_LIBRARIAN_MAX_PIPELINE_DEPTH   8
+
+// retries on missing responses before a transfer is aborted
+#define SYSEX_LIBRARIAN_MAX_RETRIES          16
+
+// libraries below this size are parsed without job pool
+#define SYSEX_LIBRARIAN_MIN_PARSE_JOB_SIZE   65536
+
+
+class SysexLibrarianWorker; // forward declaration
+class SysexLibrarianWorkerThread; // forward declaration
+
+
+//==============================================================================
+//! MIDI Out of a transfer, implemented by the SysEx Librarian and by the
+//! loopback device of the test program. Called from the worker thread!
+class SysexLibrarianMidiSender
+{
+public:
+    virtual ~SysexLibrarianMidiSender() {}
+
+    virtual void sendSysex(const Array<uint8>& data) = 0;
+};
+
+
+//==============================================================================
+class SysexLibrarianWorker
+{
+public:
+    //==============================================================================
+    SysexLibrarianWorker(SysexPatchDb *_sysexPatchDb, SysexLibrarianMidiSender *_midiSender);
+    ~SysexLibrarianWorker();
+
+    //==============================================================================
+    typedef struct PatchEntryT {
+        Array<uint8> payload;
+        String name;
+        int64 hash;        // checksum over the payload
+        int   duplicateOf; // index of the first entry with the same payload, -1 if unique
+        int   offset;      // position of the dump in the .syx data
+        int   bank;        // bank and patch number stored in the dump (-1 if not available)
+        int   patch;
+        bool  checksumOk;
+    } PatchEntryT;
+
+    typedef struct TransferItemT {
+        int patch;
+        Array<uint8> payload; // sent or received payload
+    } TransferItemT;
+
+    //==============================================================================
+    bool busy(void);
+
+    bool startParse(const unsigned& spec, const File& syxFile);
+    bool startSend(const unsigned& spec, const uint8& deviceId, const uint8& bank, const int& bufferNum, const Array<TransferItemT>& items);
+    bool startReceive(const unsigned& spec, const uint8& deviceId, const uint8& bank, const int& bufferNum, const Array<TransferItemT>& items);
+
+    // returns error message or String::empty if thread passed (or has been stopped)
+    // must always be called before startParse(), startSend() or startReceive() is called again
+    String finish(void);
+
+    //==============================================================================
+    //! parses the .syx data with <numJobs> parallel jobs (0: one per CPU) into the library
+    //! returns the number of patches
+    int parse(const unsigned& spec, const uint8 *data, const int& size, int numJobs);
+
+    //! FNV-1a hash over the payload
+    static int64 calcPayloadHash(const Array<uint8>& payload);
+
+    //==============================================================================
+    double getProgress(void);
+    int getCurrentPatch(void);
+
+    //! takes over the next received patch, returns false if no patch available
+    bool getReceivedPatch(TransferItemT& item);
+
+    //==============================================================================
+    //! has to be called for each incoming SysEx message during a transfer
+    void handleIncomingSysex(const uint8 *data, const uint32& size);
+
+    //==============================================================================
+    // parsed library
+    Array<PatchEntryT> library;
+    int numDuplicates;
+    int numChecksumErrors;
+    float timeParse;
+
+    // transfer options, 0 selects the delays of the patch spec
+    int readPipelineDepth;
+    int writePipelineDepth;
+    int responseTimeout;
+    int fallbackDelay;
+    int maxRetries;
+
+    // transfer statistics
+    int numRetries;
+    int bytesSent;
+    int bytesReceived;
+    bool usedFallbackDelay;
+    float timeTransfer;
+
+protected:
+    friend class SysexLibrarianWorkerThread;
+
+    //==============================================================================
+    SysexPatchDb *sysexPatchDb;
+    SysexLibrarianMidiSender *midiSender;
+
+    SysexLibrarianWorkerThread *workerThread;
+    CriticalSection workerThreadLock;
+
+    CriticalSection receivedPatchesLock;
+    Array<TransferItemT> receivedPatches;
+
+    volatile int numDone;
+    volatile int numItems;
+    volatile int currentPatch;
+};
+
+
+//==============================================================================
+class SysexLibrarianWorkerThread
+    : public Thread
+{
+public:
+    SysexLibrarianWorkerThread(SysexLibrarianWorker *_worker, const unsigned& _spec, const int& _job);
+    ~SysexLibrarianWorkerThread();
+
+    void run();
+
+    enum {
+        JOB_PARSE = 0,
+        JOB_SEND,
+        JOB_RECEIVE
+    };
+
+    SysexLibrarianWorker *worker;
+    SysexPatchDb *sysexPatchDb;
+
+    unsigned spec;
+    int job;
+
+    // parse job
+    File syxFile;
+
+    // transfer jobs
+    uint8 deviceId;
+    uint8 bank;
+    int bufferNum; // -1 for patch transfers
+    Array<SysexLibrarianWorker::TransferItemT> items;
+
+    // error status message from run() thread
+    String errorStatusMessage;
+
+    //==============================================================================
+    // called by SysexLibrarianWorker::handleIncomingSysex()
+    void handleIncomingSysex(const uint8 *data, const uint32& size);
+
+protected:
+    void runParse(void);
+    void runTransfer(void);
+    void sendItem(const int& item);
+    void sendSysex(const Array<uint8>& data);
+
+    // responses of the device, collected by handleIncomingSysex()
+    typedef struct ResponseT {
+        bool errorAcknowledge;
+        bool checksumOk;
+        int patch;
+        Array<uint8> payload;
+    } ResponseT;
+
+    CriticalSection responsesLock;
+    Array<ResponseT> responses;
+};
+
+#endif /* _SYSEX_LIBRARIAN_WORKER_H */
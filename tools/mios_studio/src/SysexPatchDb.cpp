@@ -810,6 +810,32 @@ bool SysexPatchDb::isValidAcknowledge(const unsigned& spec, const uint8 *data, c
     return isValidCmd(spec, data, size, deviceId, ps->cmdAcknowledge, -1, -1, -1);
 }
 
+bool SysexPatchDb::hasAcknowledge(const unsigned& spec)
+{
+    // 0x00: not available (e.g. Blofeld and Virus)
+    return patchSpec[spec].cmdAcknowledge != 0x00;
+}
+
+int SysexPatchDb::getBankOfDump(const unsigned& spec, const uint8 *data, const uint32 &size)
+{
+    PatchSpecT *ps = (PatchSpecT *)&patchSpec.getReference(spec); // we assume that the user has checked the 'spec' index!
+
+    if( ps->bankPos == 0 || size <= ps->bankPos )
+        return -1;
+
+    return (data[ps->bankPos] - ps->bankSelectOffset) & 0x7f;
+}
+
+int SysexPatchDb::getPatchOfDump(const unsigned& spec, const uint8 *data, const uint32 &size)
+{
+    PatchSpecT *ps = (PatchSpecT *)&patchSpec.getReference(spec); // we assume that the user has checked the 'spec' index!
+
+    if( ps->patchPos == 0 || size <= ps->patchPos )
+        return -1;
+
+    return (data[ps->patchPos] - ps->patchSelectOffset) & 0x7f;
+}
+
 bool SysexPatchDb::hasValidChecksum(const unsigned& spec, const uint8 *data, const uint32 &size)
 {
     PatchSpecT *ps = (PatchSpecT *)&patchSpec.getReference(spec); // we assume that the user has checked the 'spec' index!
@@ -145,6 +145,13 @@ public:
     bool isValidErrorAcknowledge(const unsigned& spec, const uint8 *data, const uint32 &size, const int &deviceId);
     bool isValidAcknowledge(const unsigned& spec, const uint8 *data, const uint32 &size, const int &deviceId);
 
+    //! true if the device acknowledges patch writes
+    bool hasAcknowledge(const unsigned& spec);
+
+    //! bank and patch number stored in a dump or request (-1 if not available)
+    int getBankOfDump(const unsigned& spec, const uint8 *data, const uint32 &size);
+    int getPatchOfDump(const unsigned& spec, const uint8 *data, const uint32 &size);
+
     bool hasValidChecksum(const unsigned& spec, const uint8 *data, const uint32 &size);
 
     Array<uint8> getPayload(const unsigned& spec, const uint8 *data, const uint32 &size);
@@ -310,17 +310,15 @@ void SysexLibrarianBank::buttonClicked(Button* buttonThatWasClicked)
 SysexLibrarianControl::SysexLibrarianControl(MiosStudio *_miosStudio, SysexLibrarian *_sysexLibrarian)
     : miosStudio(_miosStudio)
     , sysexLibrarian(_sysexLibrarian)
-    , currentPatch(0)
-    , timerRestartDelay(10)
-    , retryCtr(0)
     , progress(0)
     , receiveDump(false)
     , handleSinglePatch(false)
-    , bufferTransfer(false)
-    , dumpReceived(false)
-    , checksumError(false)
-    , errorResponse(false)
+    , parseInProgress(false)
+    , parseIntoBank(false)
+    , parseSpec(0)
 {
+    sysexLibrarianWorker = new SysexLibrarianWorker(miosStudio->sysexPatchDb, this);
+
     addAndMakeVisible(deviceTypeLabel = new Label(T("MIDI Device:"), T("MIDI Device:")));
     deviceTypeLabel->setJustificationType(Justification::right);
 
@@ -405,6 +403,7 @@ SysexLibrarianControl::SysexLibrarianControl(MiosStudio *_miosStudio, SysexLibra
 
 SysexLibrarianControl::~SysexLibrarianControl()
 {
+    deleteAndZero(sysexLibrarianWorker); // stops a running transfer
 }
 
 //==============================================================================
@@ -493,28 +492,12 @@ void SysexLibrarianControl::buttonClicked(Button* buttonThatWasClicked)
                buttonThatWasClicked == receivePatchButton ||
                buttonThatWasClicked == sendBufferButton ||
                buttonThatWasClicked == receiveBufferButton ) {
-        deviceIdSlider->setEnabled(false);
-        bankSelectSlider->setEnabled(false);
-        loadBankButton->setEnabled(false);
-        saveBankButton->setEnabled(false);
-        sendBankButton->setEnabled(false);
-        receiveBankButton->setEnabled(false);
-        loadPatchButton->setEnabled(false);
-        savePatchButton->setEnabled(false);
-        sendPatchButton->setEnabled(false);
-        receivePatchButton->setEnabled(false);
-        bufferSlider->setEnabled(false);
-        sendBufferButton->setEnabled(false);
-        receiveBufferButton->setEnabled(false);
-        stopButton->setEnabled(true);
-
-        currentPatch = (buttonThatWasClicked == sendBankButton || buttonThatWasClicked == receiveBankButton) ? 0 : sysexLibrarian->sysexLibrarianBank->getSelectedPatch();
-        progress = 0;
-        dumpRequested = false;
-        errorResponse = false;
-        checksumError = false;
+        int spec = deviceTypeSelector->getSelectedId()-1;
+        if( spec < 0 || spec >= miosStudio->sysexPatchDb->getNumSpecs() || sysexLibrarianWorker->busy() )
+            return;
 
-        retryCtr = 0; // no retry yet
+        enableControls(false);
+        progress = 0;
 
         handleSinglePatch =
             buttonThatWasClicked == sendPatchButton ||
@@ -522,7 +505,7 @@ void SysexLibrarianControl::buttonClicked(Button* buttonThatWasClicked)
             buttonThatWasClicked == sendBufferButton ||
             buttonThatWasClicked == receiveBufferButton;
 
-        bufferTransfer =
+        bool bufferTransfer =
             buttonThatWasClicked == sendBufferButton ||
             buttonThatWasClicked == receiveBufferButton;
 
@@ -531,7 +514,42 @@ void SysexLibrarianControl::buttonClicked(Button* buttonThatWasClicked)
             buttonThatWasClicked == receivePatchButton ||
             buttonThatWasClicked == receiveBufferButton;
 
-        startTimer(1);
+        // collect the patches which should be transfered:
+        // - bank: all patches (sent: only patches which are available)
+        // - patch: the selected patch, received: also the following selected patches
+        // - buffer: the selected patch
+        SysexLibrarianBank *bank = sysexLibrarian->sysexLibrarianBank;
+        Array<SysexLibrarianWorker::TransferItemT> items;
+        int numPatches = miosStudio->sysexPatchDb->getNumPatchesPerBank(spec);
+        int firstPatch = handleSinglePatch ? bank->getSelectedPatch() : 0;
+        for(int patch=firstPatch; patch<numPatches; ++patch) {
+            if( handleSinglePatch && patch != firstPatch &&
+                (!receiveDump || bufferTransfer || !bank->isSelectedPatch(patch)) )
+                break;
+
+            SysexLibrarianWorker::TransferItemT item;
+            item.patch = patch;
+
+            if( !receiveDump ) {
+                Array<uint8>* p = (patch < bank->getNumRows()) ? bank->getPatch(patch) : NULL;
+                if( p == NULL || !p->size() )
+                    continue;
+                item.payload = *p;
+            }
+
+            items.add(item);
+        }
+
+        uint8 deviceId = (uint8)deviceIdSlider->getValue();
+        uint8 bankNum = (uint8)bankSelectSlider->getValue()-1;
+        int bufferNum = bufferTransfer ? ((int)bufferSlider->getValue() - 1) : -1;
+
+        if( receiveDump )
+            sysexLibrarianWorker->startReceive(spec, deviceId, bankNum, bufferNum, items);
+        else
+            sysexLibrarianWorker->startSend(spec, deviceId, bankNum, bufferNum, items);
+
+        startTimer(50); // polls the worker
     }
 }
 
@@ -584,283 +602,112 @@ void SysexLibrarianControl::setSpec(const unsigned& spec)
             bufferSlider->setEnabled(false);
         }
 
-        // starting delay - will be increased if synth needs more time
-        timerRestartDelay = 10;
     }
 }
 
 //==============================================================================
 
+void SysexLibrarianControl::enableControls(const bool& enable)
+{
+    deviceIdSlider->setEnabled(enable);
+    bankSelectSlider->setEnabled(enable);
+    loadBankButton->setEnabled(enable);
+    saveBankButton->setEnabled(enable);
+    sendBankButton->setEnabled(enable);
+    receiveBankButton->setEnabled(enable);
+    loadPatchButton->setEnabled(enable);
+    savePatchButton->setEnabled(enable);
+    sendPatchButton->setEnabled(enable);
+    receivePatchButton->setEnabled(enable);
+    bufferSlider->setEnabled(enable);
+    sendBufferButton->setEnabled(enable);
+    receiveBufferButton->setEnabled(enable);
+    stopButton->setEnabled(!enable);
+}
+
+//==============================================================================
+
 void SysexLibrarianControl::stopTransfer(void)
 {
     stopTimer();
+    sysexLibrarianWorker->finish(); // stops the worker thread if it is still running
 
+    parseInProgress = false;
     progress = 0;
-    deviceIdSlider->setEnabled(true);
-    bankSelectSlider->setEnabled(true);
-    loadBankButton->setEnabled(true);
-    saveBankButton->setEnabled(true);
-    sendBankButton->setEnabled(true);
-    receiveBankButton->setEnabled(true);
-    loadPatchButton->setEnabled(true);
-    savePatchButton->setEnabled(true);
-    sendPatchButton->setEnabled(true);
-    receivePatchButton->setEnabled(true);
-    bufferSlider->setEnabled(true);
-    sendBufferButton->setEnabled(true);
-    receiveBufferButton->setEnabled(true);
-    stopButton->setEnabled(false);
+    enableControls(true);
 }
 
 //==============================================================================
 void SysexLibrarianControl::timerCallback()
 {
-    stopTimer(); // will be restarted if required
-
-    // transfer has been stopped?
-    if( !stopButton->isEnabled() )
-        return;
-
-    bool transferFinished = false;
-
-    if( receiveDump ) {
-        if( dumpRequested ) {
-            if( checksumError ) {
-                transferFinished = true;
-                AlertWindow::showMessageBox(AlertWindow::WarningIcon,
-                                            T("Detected checksum error!"),
-                                            T("Check:\n- MIDI In/Out connections\n- your MIDI interface"),
-                                            String::empty);
-            } else if( !dumpReceived ) {
-                if( ++retryCtr < 16 ) {
-                    --currentPatch;
-                    timerRestartDelay = 100*retryCtr; // delay increases with each retry
-                } else {
-                    transferFinished = true;
-                    timerRestartDelay = 10; // next time we will start with short delay again
-                    AlertWindow::showMessageBox(AlertWindow::WarningIcon,
-                                                T("No response from device."),
-                                                T("Check:\n- MIDI In/Out connections\n- Device ID\n- that MIDIbox firmware has been uploaded"),
-                                                String::empty);
-                }
-            }
-        }
+    // take over the patches which have been received by the worker thread
+    SysexLibrarianWorker::TransferItemT item;
+    while( sysexLibrarianWorker->getReceivedPatch(item) ) {
+        sysexLibrarian->sysexLibrarianBank->setPatch(item.patch, item.payload);
+        sysexLibrarian->sysexLibrarianBank->selectPatch(item.patch);
+        // leads to endless download if a single patch is selected and received, since the handler checks for the selection...
+        //sysexLibrarian->sysexLibrarianBank->incPatchIfSingleSelection();
+    }
 
-        if( !transferFinished ) {
-            int spec = deviceTypeSelector->getSelectedId()-1;
-            if( spec < 0 || spec >= miosStudio->sysexPatchDb->getNumSpecs() ) {
-                transferFinished = true;
-            } else if( (handleSinglePatch && !sysexLibrarian->sysexLibrarianBank->isSelectedPatch(currentPatch)) ||
-                       (currentPatch >= miosStudio->sysexPatchDb->getNumPatchesPerBank(spec)) ) {
-                transferFinished = true;
-            } else {
-                dumpReceived = false;
-                checksumError = false;
-                errorResponse = false;
-                int spec = deviceTypeSelector->getSelectedId()-1;
-                if( spec < 0 || spec >= miosStudio->sysexPatchDb->getNumSpecs() ) {
-                    dumpReceived = true;
-                } else {
-                    Array<uint8> data;
-
-                    if( bufferTransfer ) {
-                        uint8 bufferNum = (uint8)bufferSlider->getValue() - 1;
-                        Array<uint8> selectBuffer = miosStudio->sysexPatchDb->createSelectBuffer(spec,
-                                                                                                 (uint8)deviceIdSlider->getValue(),
-                                                                                                 bufferNum);
-                        if( selectBuffer.size() ) {
-                            Array<uint8> data(selectBuffer);
-                            MidiMessage message = SysexHelper::createMidiMessage(data);
-                            miosStudio->sendMidiMessage(message);
-                            bufferNum = 0; // don't transfer offset in this case
-                        }
-
-                        data = miosStudio->sysexPatchDb->createReadBuffer(spec,
-                                                                          (uint8)deviceIdSlider->getValue(),
-                                                                          bufferNum,
-                                                                          (uint8)bankSelectSlider->getValue()-1,
-                                                                          currentPatch);
-                    } else {
-                        data = miosStudio->sysexPatchDb->createReadPatch(spec,
-                                                                         (uint8)deviceIdSlider->getValue(),
-                                                                         0,
-                                                                         (uint8)bankSelectSlider->getValue()-1,
-                                                                         currentPatch);
-                    }
-                    MidiMessage message = SysexHelper::createMidiMessage(data);
-                    miosStudio->sendMidiMessage(message);
-
-                    dumpRequested = true;
-                    ++currentPatch;
-
-                    if( handleSinglePatch )
-                        progress = 1;
-                    else
-                        progress = (double)currentPatch / (double)miosStudio->sysexPatchDb->getNumPatchesPerBank(spec);
-                    startTimer(miosStudio->sysexPatchDb->getDelayBetweenReads(spec));
-                }
-            }
-        }
-    } else {
-        int spec = deviceTypeSelector->getSelectedId()-1;
-        if( spec < 0 || spec >= miosStudio->sysexPatchDb->getNumSpecs() ) {
-            transferFinished = true;
-        } else {
-            if( errorResponse ) {
-                transferFinished = true;
-                AlertWindow::showMessageBox(AlertWindow::WarningIcon,
-                                            T("Got Error response!"),
-                                            T("Check:\n- if a valid patch has been uploaded\n- error code in MIDI IN monitor"),
-                                            String::empty);
-            } else {
-                if( (handleSinglePatch && currentPatch != sysexLibrarian->sysexLibrarianBank->getSelectedPatch()) ||
-                    currentPatch >= miosStudio->sysexPatchDb->getNumPatchesPerBank(spec) ) {
-                    transferFinished = true;
-                } else {
-                    Array<uint8>* p = NULL;
-                    while( currentPatch < sysexLibrarian->sysexLibrarianBank->getNumRows() &&
-                           (p=sysexLibrarian->sysexLibrarianBank->getPatch(currentPatch)) == NULL )
-                        ++currentPatch;
-
-                    if( p == NULL ) {
-                        transferFinished = true;
-                    } else {
-                        errorResponse = false;
-
-                        Array<uint8> data;
-
-                        if( bufferTransfer ) {
-                            uint8 bufferNum = (uint8)bufferSlider->getValue() - 1;
-                            Array<uint8> selectBuffer = miosStudio->sysexPatchDb->createSelectBuffer(spec,
-                                                                                                     (uint8)deviceIdSlider->getValue(),
-                                                                                                     bufferNum);
-                            if( selectBuffer.size() ) {
-                                Array<uint8> data(selectBuffer);
-                                MidiMessage message = SysexHelper::createMidiMessage(data);
-                                miosStudio->sendMidiMessage(message);
-                                bufferNum = 0; // don't transfer offset in this case
-                            }
-
-                            data = miosStudio->sysexPatchDb->createWriteBuffer(spec,
-                                                                              (uint8)deviceIdSlider->getValue(),
-                                                                              bufferNum,
-                                                                              (uint8)bankSelectSlider->getValue()-1,
-                                                                              currentPatch,
-                                                                              &p->getReference(0),
-                                                                              p->size());
-                        } else {
-                            data = miosStudio->sysexPatchDb->createWritePatch(spec,
-                                                                              (uint8)deviceIdSlider->getValue(),
-                                                                              0,
-                                                                              (uint8)bankSelectSlider->getValue()-1,
-                                                                              currentPatch,
-                                                                              &p->getReference(0),
-                                                                              p->size());
-                        }
-
-                        MidiMessage message = SysexHelper::createMidiMessage(data);
-                        miosStudio->sendMidiMessage(message);
-
-                        ++currentPatch;
-
-                        if( handleSinglePatch )
-                            progress = 1;
-                        else {
-                            progress = (double)currentPatch / (double)miosStudio->sysexPatchDb->getNumPatchesPerBank(spec);
-                            sysexLibrarian->sysexLibrarianBank->selectPatch(currentPatch-1);
-                        }
-
-                        startTimer(miosStudio->sysexPatchDb->getDelayBetweenWrites(spec));
-                    }
-                }
-            }
+    if( sysexLibrarianWorker->busy() ) {
+        if( !parseInProgress ) {
+            progress = handleSinglePatch ? 1 : sysexLibrarianWorker->getProgress();
+
+            int currentPatch = sysexLibrarianWorker->getCurrentPatch();
+            if( !receiveDump && !handleSinglePatch && currentPatch >= 0 &&
+                sysexLibrarian->sysexLibrarianBank->getSelectedPatch() != currentPatch )
+                sysexLibrarian->sysexLibrarianBank->selectPatch(currentPatch);
         }
+        return; // timer continues
     }
 
-    if( transferFinished ) {
-        stopTransfer();
+    stopTimer();
+    String errorMessage(sysexLibrarianWorker->finish());
+
+    if( parseInProgress ) {
+        finishLoadSyx(errorMessage);
+    } else if( !errorMessage.isEmpty() ) {
+        // first line is the title
+        AlertWindow::showMessageBox(AlertWindow::WarningIcon,
+                                    errorMessage.upToFirstOccurrenceOf(T("\n"), false, false),
+                                    errorMessage.fromFirstOccurrenceOf(T("\n"), false, false),
+                                    String::empty);
     }
+
+    stopTransfer();
 }
 
 //==============================================================================
 void SysexLibrarianControl::handleIncomingMidiMessage(const MidiMessage& message, uint8 runningStatus)
 {
-    uint8 *data = (uint8 *)message.getRawData();
-    uint32 size = message.getRawDataSize();
-
-    int spec = deviceTypeSelector->getSelectedId()-1;
-    if( spec < 0 || spec >= miosStudio->sysexPatchDb->getNumSpecs() )
-        return;
-
-    if( receiveDump ) {
-        int receivedPatch = currentPatch-1;
-        uint8 bufferNum = (uint8)bufferSlider->getValue() - 1;
-        Array<uint8> selectBuffer = miosStudio->sysexPatchDb->createSelectBuffer(spec,
-                                                                                 (uint8)deviceIdSlider->getValue(),
-                                                                                 bufferNum);
-        if( selectBuffer.size() ) {
-            bufferNum = 0; // offset not transfered in this case
-        }
-
-        if( (bufferTransfer && miosStudio->sysexPatchDb->isValidWriteBuffer(spec,
-                                                                            data, size,
-                                                                            (int)deviceIdSlider->getValue(),
-                                                                            bufferNum,
-                                                                            -1,
-                                                                            -1))
-            ||
-            (!bufferTransfer && miosStudio->sysexPatchDb->isValidWritePatch(spec,
-                                                                            data, size,
-                                                                            (int)deviceIdSlider->getValue(),
-                                                                            0,
-                                                                            -1,
-                                                                            -1))
-            ) {
-
-            dumpReceived = true;
-
-            if( size != miosStudio->sysexPatchDb->getPatchSize(spec) ||
-                !miosStudio->sysexPatchDb->hasValidChecksum(spec, data, size) ) {
-                checksumError = true;
-            } else {
-                Array<uint8> payload(miosStudio->sysexPatchDb->getPayload(spec, data, size));
-                sysexLibrarian->sysexLibrarianBank->setPatch(receivedPatch, payload);
-                sysexLibrarian->sysexLibrarianBank->selectPatch(receivedPatch);
-                // leads to endless download if a single patch is selected and received, since the handler checks for the selection...
-                //sysexLibrarian->sysexLibrarianBank->incPatchIfSingleSelection();
-            }
-
-            // trigger timer immediately with variable delay (will be increased if timeouts have been notified)
-            stopTimer();
-            startTimer(timerRestartDelay);
-        }
-    } else if( isTimerRunning() ) {
-        if( miosStudio->sysexPatchDb->isValidErrorAcknowledge(spec, data, size, (int)deviceIdSlider->getValue()) ) {
-            // trigger timer immediately
-            errorResponse = true;
-            stopTimer();
-            startTimer(100);
-        } else if( miosStudio->sysexPatchDb->isValidAcknowledge(spec, data, size, (int)deviceIdSlider->getValue()) ) {
-            // trigger timer immediately
-            stopTimer();
-            startTimer(100);
-        }
+    // acknowledges and dumps are handled by the worker thread
+    if( sysexLibrarianWorker->busy() ) {
+        uint8 *data = (uint8 *)message.getRawData();
+        uint32 size = message.getRawDataSize();
+        sysexLibrarianWorker->handleIncomingSysex(data, size);
     }
 }
 
+//==============================================================================
+void SysexLibrarianControl::sendSysex(const Array<uint8>& data)
+{
+    // called from the worker thread
+    Array<uint8> dataArray(data);
+    MidiMessage message = SysexHelper::createMidiMessage(dataArray);
+    miosStudio->sendMidiMessage(message);
+}
+
 
 //==============================================================================
 bool SysexLibrarianControl::loadSyx(File &syxFile, const bool& loadBank)
 {
-    FileInputStream *inFileStream = syxFile.createInputStream();
-
-    if( !inFileStream ) {
+    if( !syxFile.existsAsFile() ) {
         AlertWindow::showMessageBox(AlertWindow::WarningIcon,
                                     T("The file ") + syxFile.getFileName(),
                                     T("doesn't exist!"),
                                     String::empty);
         return false;
-    } else if( inFileStream->isExhausted() || !inFileStream->getTotalLength() ) {
+    } else if( !syxFile.getSize() ) {
         AlertWindow::showMessageBox(AlertWindow::WarningIcon,
                                     T("The file ") + syxFile.getFileName(),
                                     T("is empty!"),
@@ -868,76 +715,90 @@ bool SysexLibrarianControl::loadSyx(File &syxFile, const bool& loadBank)
         return false;
     }
 
-    int64 size = inFileStream->getTotalLength();
-    uint8 *buffer = (uint8 *)juce_malloc(size);
-    int64 readNumBytes = inFileStream->read(buffer, size);
-    String errorMessage;
     int spec = deviceTypeSelector->getSelectedId()-1;
+    if( spec < 0 || spec >= miosStudio->sysexPatchDb->getNumSpecs() ) {
+        AlertWindow::showMessageBox(AlertWindow::WarningIcon,
+                                    T("The file ") + syxFile.getFileName(),
+                                    T("invalid patch type selected!"),
+                                    String::empty);
+        return false;
+    }
+
+    // the file is parsed by the worker thread, the patches are taken over by finishLoadSyx()
+    if( !sysexLibrarianWorker->startParse(spec, syxFile) )
+        return false;
 
-    if( readNumBytes != size ) {
-        errorMessage = String(T("cannot be read completely!"));
-    } else if( spec < 0 || spec >= miosStudio->sysexPatchDb->getNumSpecs() ) {
+    parseInProgress = true;
+    parseIntoBank = loadBank;
+    parseSpec = spec;
+    parseSyxFile = syxFile;
+
+    enableControls(false);
+    progress = 0;
+    startTimer(50); // polls the worker
+
+    return true;
+}
+
+void SysexLibrarianControl::finishLoadSyx(String errorMessage)
+{
+    SysexLibrarianBank *bank = sysexLibrarian->sysexLibrarianBank;
+
+    if( errorMessage.isEmpty() && bank->getPatchSpec() != parseSpec ) {
         errorMessage = String(T("invalid patch type selected!"));
-    } else {
-        int patchSize = miosStudio->sysexPatchDb->getPatchSize(spec);
-        int maxPatches = miosStudio->sysexPatchDb->getNumPatchesPerBank(spec);
+    }
+
+    if( errorMessage.isEmpty() ) {
+        Array<SysexLibrarianWorker::PatchEntryT>& library = sysexLibrarianWorker->library;
+        int maxPatches = miosStudio->sysexPatchDb->getNumPatchesPerBank(parseSpec);
+
+        // libraries which exceed a bank are taken over without duplicates,
+        // bank dumps keep their layout
+        bool skipDuplicates = library.size() > maxPatches;
 
-        if( loadBank ) {
-            sysexLibrarian->sysexLibrarianBank->initBank(spec);
+        if( parseIntoBank ) {
+            bank->initBank(parseSpec);
         }
 
         unsigned patch = 0;
         unsigned numPatches = 0;
-        int pos = 0;
-        while( errorMessage.isEmpty() &&
-               (pos+patchSize) <= size ) {
-            uint8* patchPtr = &buffer[pos];
-            if( miosStudio->sysexPatchDb->isValidWritePatch(spec, patchPtr, patchSize, -1, -1, -1, -1) ||
-                miosStudio->sysexPatchDb->isValidWriteBuffer(spec, patchPtr, patchSize, -1, -1, -1, -1) ) {
-
-                if( !loadBank ) {
-                    while( patch < maxPatches && !sysexLibrarian->sysexLibrarianBank->isSelectedPatch(patch) )
-                        ++patch;
-                }
-                if( patch >= maxPatches )
-                    break;
+        for(int i=0; i<library.size(); ++i) {
+            SysexLibrarianWorker::PatchEntryT& entry = library.getReference(i);
+            if( skipDuplicates && entry.duplicateOf >= 0 )
+                continue;
+
+            if( !parseIntoBank ) {
+                while( patch < maxPatches && !bank->isSelectedPatch(patch) )
+                    ++patch;
+            }
+            if( patch >= maxPatches )
+                break;
 
-                Array<uint8> payload(miosStudio->sysexPatchDb->getPayload(spec, patchPtr, patchSize));
-                sysexLibrarian->sysexLibrarianBank->setPatch(patch, payload);
-                if( loadBank ) {
-                    sysexLibrarian->sysexLibrarianBank->selectPatch(patch);
-                }
-                sysexLibrarian->sysexLibrarianBank->incPatchIfSingleSelection();
-
-                ++numPatches;
-                ++patch;
-                pos += patchSize;
-            } else {
-                // search for next F0
-                while( ((++pos+patchSize) <= size) && (buffer[pos] != 0xf0) );
+            bank->setPatch(patch, entry.payload);
+            if( parseIntoBank ) {
+                bank->selectPatch(patch);
             }
+            bank->incPatchIfSingleSelection();
+
+            ++numPatches;
+            ++patch;
         }
 
         if( numPatches == 0 ) {
-            errorMessage = String(T("doesn't contain any valid SysEx dump for a ") + miosStudio->sysexPatchDb->getSpecName(spec));
+            errorMessage = String(T("doesn't contain any valid SysEx dump for a ") + miosStudio->sysexPatchDb->getSpecName(parseSpec));
         } else {
-            if( loadBank ) {
-                sysexLibrarian->sysexLibrarianBank->selectPatch(0); // select the first patch in bank
+            if( parseIntoBank ) {
+                bank->selectPatch(0); // select the first patch in bank
             }
         }
     }
 
-    juce_free(buffer);
-
     if( !errorMessage.isEmpty() ) {
         AlertWindow::showMessageBox(AlertWindow::WarningIcon,
-                                    T("The file ") + syxFile.getFileName(),
+                                    T("The file ") + parseSyxFile.getFileName(),
                                     errorMessage,
                                     String::empty);
-        return false;
     }
-
-    return true;
 }
 
 bool SysexLibrarianControl::saveSyx(File &syxFile, const bool& saveBank)
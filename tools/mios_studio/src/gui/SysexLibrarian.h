@@ -17,6 +17,7 @@
 
 #include "../includes.h"
 #include "ConfigTableComponents.h"
+#include "../SysexLibrarianWorker.h"
 
 class MiosStudio; // forward declaration
 class SysexLibrarian;
@@ -100,6 +101,7 @@ class SysexLibrarianControl
     , public Slider::Listener
     , public ComboBox::Listener
     , public Timer
+    , public SysexLibrarianMidiSender
 {
 public:
     //==============================================================================
@@ -124,12 +126,17 @@ public:
 
     //==============================================================================
     void handleIncomingMidiMessage(const MidiMessage& message, uint8 runningStatus);
+    void sendSysex(const Array<uint8>& data);
 
     //==============================================================================
     bool loadSyx(File &syxFile, const bool& loadBank);
     bool saveSyx(File &syxFile, const bool& saveBank);
 
 protected:
+    //==============================================================================
+    void enableControls(const bool& enable);
+    void finishLoadSyx(String errorMessage);
+
     //==============================================================================
     Label*      deviceTypeLabel;
     ComboBox*   deviceTypeSelector;
@@ -162,18 +169,17 @@ protected:
     //==============================================================================
     SysexLibrarian *sysexLibrarian;
 
+    //==============================================================================
+    SysexLibrarianWorker *sysexLibrarianWorker;
+
     //==============================================================================
     File syxFile;
-    int currentPatch;
-    unsigned timerRestartDelay;
-    unsigned retryCtr;
     bool handleSinglePatch;
-    bool bufferTransfer;
     bool receiveDump;
-    bool dumpRequested;
-    bool dumpReceived;
-    bool checksumError;
-    bool errorResponse;
+    bool parseInProgress;
+    bool parseIntoBank;
+    unsigned parseSpec;
+    File parseSyxFile;
 
     //==============================================================================
     MiosStudio *miosStudio;